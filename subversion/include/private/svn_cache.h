@@ -292,8 +292,9 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
  * @a thread_safe may be set to @c FALSE for maximum performance.
  *
  * There is no limit on the number of threads reading a given cache segment
- * concurrently.  Writes, however, need an exclusive lock on the respective
- * segment.  @a allow_blocking_writes controls contention is handled here.
+ * concurrently.  Where supported, lookups don't acquire the segment lock
+ * and only fall back to it if they collided with a write.  Writes, however,
+ * need an exclusive lock on the respective segment.  @a allow_blocking_writes controls contention is handled here.
  * If set to TRUE, writes will wait until the lock becomes available, i.e.
  * reads should be short.  If set to FALSE, write attempts will be ignored
  * (no data being written to the cache) if some reader or another writer
@@ -310,6 +311,27 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   svn_boolean_t allow_blocking_writes,
                                   apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__membuffer_cache_create() but allocate the cache in a new
+ * anonymous shared memory block.  All processes forked from the current
+ * one after this call will then read and write the same cache contents.
+ * The resulting cache is always thread-safe and uses robust process-shared
+ * mutexes.  Should a process die while holding one of them, the affected
+ * cache segment will be cleared.
+ *
+ * Return #SVN_ERR_UNSUPPORTED_FEATURE if the platform does not support
+ * shared memory or robust process-shared mutexes.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *result_pool);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -391,6 +413,73 @@ svn_cache__create_null(svn_cache__t **cache_p,
                        const char *id,
                        apr_pool_t *result_pool);
 
+/**
+ * An opaque structure representing a memory-mapped cache file that
+ * persists across process restarts.
+ *
+ * @since New in 1.15.
+ */
+typedef struct svn_cache__persistent_t svn_cache__persistent_t;
+
+/**
+ * Open the persistent cache file at @a path in @a *store_p, creating it
+ * with a total size of about @a size bytes if necessary.  Use
+ * @a scratch_pool for temporary allocations.
+ *
+ * If no other process uses the file, it will be resized and its contents
+ * be discarded if it has a different size or is not a valid cache file.
+ * Otherwise, the file will be used with the size it already has,
+ * regardless of @a size.  Return #SVN_ERR_BAD_VERSION_FILE_FORMAT if
+ * other processes use the file in a format that we don't understand.
+ *
+ * Every file will be opened only once per process; subsequent calls for
+ * the same @a path return the same object, regardless of @a size.  The
+ * object lives until the end of the process.  It may be used from multiple
+ * threads and multiple processes concurrently.  Processes forked after
+ * opening the file must not use it.
+ *
+ * Return #SVN_ERR_UNSUPPORTED_FEATURE if the platform does not support
+ * memory-mapped files or mutexes shared between processes.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__persistent_open(svn_cache__persistent_t **store_p,
+                           const char *path,
+                           apr_uint64_t size,
+                           apr_pool_t *scratch_pool);
+
+/**
+ * Creates a new cache in @a *cache_p that uses @a l1_cache as its first
+ * level and @a store as a second level that survives process restarts.
+ * Lookups that miss @a l1_cache will be tried in @a store and hits there
+ * will be copied into @a l1_cache.  All data written to the cache will be
+ * written to both levels.
+ *
+ * The elements in @a store will be indexed by @a prefix plus the key of
+ * length @a klen, which may be APR_HASH_KEY_STRING if they are strings.
+ * Since @a store outlives the process, @a prefix must uniquely identify
+ * the data source across restarts as well.  Values will be serialized
+ * using @a serialize_func and deserialized using @a deserialize_func.
+ * If @a deserialize_func is NULL, then the data is returned as an
+ * svn_stringbuf_t; if @a serialize_func is NULL, then the data is
+ * assumed to be an svn_stringbuf_t.  These should be the same functions
+ * that @a l1_cache uses.  @a *cache_p will be allocated in @a result_pool.
+ *
+ * These caches do not support svn_cache__iter.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_cache__create_persistent(svn_cache__t **cache_p,
+                             svn_cache__t *l1_cache,
+                             svn_cache__persistent_t *store,
+                             svn_cache__serialize_func_t serialize_func,
+                             svn_cache__deserialize_func_t deserialize_func,
+                             apr_ssize_t klen,
+                             const char *prefix,
+                             apr_pool_t *result_pool);
+
 /**
  * Sets @a handler to be @a cache's error handling routine.  If any
  * error is returned from a call to svn_cache__get or svn_cache__set, @a
@@ -561,6 +650,16 @@ svn_cache__get_global_membuffer_cache(void);
 svn_cache__info_t *
 svn_cache__membuffer_get_global_info(apr_pool_t *pool);
 
+/**
+ * Set @a *gets and @a *hits to the total number of read accesses and
+ * successful read accesses, respectively, over all membuffer caches.
+ * Unlike svn_cache__membuffer_get_global_info(), this is cheap enough to
+ * be called very frequently.  Both will be 0 if there is no global cache.
+ */
+void
+svn_cache__membuffer_get_global_access_counts(apr_uint64_t *gets,
+                                              apr_uint64_t *hits);
+
 /**
  * Remove all current contents from CACHE.
  *
@@ -101,6 +101,53 @@ svn_delta__delta_from_editor(const svn_delta_editor_t **deditor,
                              struct svn_delta__extra_baton *exb,
                              apr_pool_t *pool);
 
+/** The first svndiff version that allows for delta windows larger than
+ * the standard window size and that uses relative instruction offsets.
+ *
+ * @since New in 1.15.
+ */
+#define SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS 3
+
+/** Return the maximum length of source and target views in delta windows
+ * that a consumer of svndiff version @a svndiff_version data accepts.
+ *
+ * @since New in 1.15.
+ */
+apr_size_t
+svn_txdelta__max_window_size(int svndiff_version);
+
+/** Like svn_txdelta2() but produce delta windows suitable for encoding
+ * in svndiff version @a svndiff_version.
+ *
+ * Starting with #SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS, the windows
+ * may be up to svn_txdelta__max_window_size() bytes long and each source
+ * view starts where the source data matched by the previous window ended.
+ * Thus, the views keep following each other even if data got inserted
+ * into or removed from the target.
+ *
+ * @since New in 1.15.
+ */
+void
+svn_txdelta__create(svn_txdelta_stream_t **stream,
+                    svn_stream_t *source,
+                    svn_stream_t *target,
+                    svn_boolean_t calculate_checksum,
+                    int svndiff_version,
+                    apr_pool_t *pool);
+
+/** Like svn_txdelta_target_push() but produce delta windows suitable for
+ * encoding in svndiff version @a svndiff_version.  See
+ * svn_txdelta__create() for details.
+ *
+ * @since New in 1.15.
+ */
+svn_stream_t *
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         int svndiff_version,
+                         apr_pool_t *pool);
+
 /** Read the txdelta window header from @a stream and return the total
     length of the unparsed window data in @a *window_len. */
 svn_error_t *
@@ -108,6 +155,16 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
                                  apr_pool_t *pool);
 
+/** Enable or disable the use of vector instructions when computing text
+ * deltas.  They are enabled by default, if the CPU supports them.  Either
+ * way, the resulting deltas will be identical.  Return TRUE if vector
+ * instructions will be used.
+ *
+ * This is a process-wide setting meant for testing and benchmarking.
+ */
+svn_boolean_t
+svn_txdelta__enable_simd(svn_boolean_t enable);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
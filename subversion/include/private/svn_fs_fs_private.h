@@ -309,10 +309,33 @@ typedef svn_error_t *
                                 void *baton,
                                 apr_pool_t *scratch_pool);
 
+/* Callback function type that opens another instance of the repository
+ * FS that is currently being processed and returns it in *FS, allocated
+ * in RESULT_POOL.  BATON is user provided.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+typedef svn_error_t *
+(*svn_fs_fs__open_fs_func_t)(svn_fs_t **fs,
+                             void *baton,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
 typedef struct svn_fs_fs__ioctl_get_stats_input_t
 {
   svn_fs_progress_notify_func_t progress_func;
   void *progress_baton;
+
+  /* Number of threads to use.  Values > 1 require OPEN_FS_FUNC to be set
+   * and the cancel function to be thread-safe.
+   *
+   * @since New in 1.15. */
+  int thread_count;
+
+  /* Opens one svn_fs_t per worker thread; called with OPEN_FS_BATON.
+   *
+   * @since New in 1.15. */
+  svn_fs_fs__open_fs_func_t open_fs_func;
+  void *open_fs_baton;
 } svn_fs_fs__ioctl_get_stats_input_t;
 
 typedef struct svn_fs_fs__ioctl_get_stats_output_t
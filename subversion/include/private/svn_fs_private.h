@@ -68,6 +68,26 @@ svn_fs__access_get_lock_tokens(svn_fs_access_t *access_ctx);
 svn_error_t *
 svn_fs__path_valid(const char *path, apr_pool_t *pool);
 
+/** Return the warning callback and baton currently set for @a fs in
+ * @a *warning and @a *warning_baton, respectively.
+ *
+ * @see svn_fs_set_warning_func()
+ */
+void
+svn_fs__get_warning_func(svn_fs_warning_callback_t *warning,
+                         void **warning_baton,
+                         svn_fs_t *fs);
+
+/** Hint that the contents of the files at @a paths (const char *) under
+ * @a root will be read soon.  The backend may start loading them in the
+ * background.  Backends without such support ignore this call.
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_fs__prefetch_file_contents(svn_fs_root_t *root,
+                               const apr_array_header_t *paths,
+                               apr_pool_t *scratch_pool);
+
 
 
 /** Editors
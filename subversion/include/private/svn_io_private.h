@@ -85,12 +85,57 @@ svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
 
+/** Tell the OS that the @a length bytes of @a file starting at @a offset
+ * will be read soon, so it may start loading them in the background.
+ * This is only a hint and a no-op on platforms that don't support it.
+ */
+void
+svn_io__file_readahead(apr_file_t *file,
+                       apr_off_t offset,
+                       apr_off_t length);
+
+
 /** Return the underlying file, if any, associated with the stream, or
  * NULL if not available.  Accessing the file bypasses the stream.
+ * The stream's data starts at the file's current offset and ends at
+ * svn_stream__aprfile_end().
  */
 apr_file_t *
 svn_stream__aprfile(svn_stream_t *stream);
 
+/** Return the offset within the file returned by svn_stream__aprfile()
+ * at which the data of @a stream ends, or -1 if it extends to the end
+ * of that file.
+ */
+apr_off_t
+svn_stream__aprfile_end(svn_stream_t *stream);
+
+/** Make svn_stream__aprfile() return @a file and svn_stream__aprfile_end()
+ * return @a end for @a stream.  Only valid for read-only streams that
+ * return the contents of @a file unmodified, starting at its current
+ * offset.  Callers that access @a file directly bypass whatever checks
+ * the stream itself performs.
+ */
+void
+svn_stream__set_aprfile(svn_stream_t *stream,
+                        apr_file_t *file,
+                        apr_off_t end);
+
+/** Set @a *stream to a read-only stream that returns the section of
+ * @a file from offset @a start up to but not including offset @a end.
+ * The stream supports full reads and skipping only.  Unless @a disown
+ * is set, closing the stream will close @a file.  Allocate the stream
+ * in @a result_pool and use @a scratch_pool for temporaries.
+ */
+svn_error_t *
+svn_stream__from_aprfile_range(svn_stream_t **stream,
+                               apr_file_t *file,
+                               apr_off_t start,
+                               apr_off_t end,
+                               svn_boolean_t disown,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool);
+
 /* Creates as *INSTALL_STREAM a stream that once completed can be installed
    using Windows checkouts much slower than Unix.
 
@@ -149,6 +194,14 @@ svn_error_t *
 svn_stream__install_delete(svn_stream_t *install_stream,
                            apr_pool_t *scratch_pool);
 
+/* Return a stream that wraps STREAM.  Data written to it gets compressed
+   in independent LZ4 blocks before being passed on to STREAM.  Reading
+   from it decompresses data in that same, Subversion specific format.
+   Closing the returned stream closes STREAM.  Allocate it in POOL. */
+svn_stream_t *
+svn_stream__lz4_compressed(svn_stream_t *stream,
+                           apr_pool_t *pool);
+
 /* Internal version of svn_stream_from_aprfile2() supporting the
    additional TRUNCATE_ON_SEEK argument. */
 svn_stream_t *
@@ -83,6 +83,30 @@ svn_ra__assert_capable_server(svn_ra_session_t *ra_session,
                               const char *path_or_url,
                               apr_pool_t *pool);
 
+/** Fetch the entries of the directories @a paths (an array of
+ * <tt>const char *</tt> relpaths relative to @a session's URL) at
+ * @a revision, as svn_ra_get_dir2() would with @a dirent_fields.
+ * Set @a *dirents to an array of <tt>apr_hash_t *</tt>, one per element
+ * of @a paths and in the same order, each mapping entry names to
+ * <tt>svn_dirent_t *</tt>.
+ *
+ * Where the RA layer supports it, all requests are sent before the
+ * responses are read, saving a network round trip per directory.
+ *
+ * Allocate @a *dirents in @a result_pool. Perform temporary allocations
+ * in @a scratch_pool.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_ra__get_dirs(svn_ra_session_t *session,
+                 apr_array_header_t **dirents,
+                 const apr_array_header_t *paths,
+                 svn_revnum_t revision,
+                 apr_uint32_t dirent_fields,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool);
+
 
 /*** Operational Locks ***/
 
@@ -146,6 +146,44 @@ svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
 apr_pool_t *
 svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn);
 
+/** Callback invoked by svn_ra_svn__handle_command() right before running
+ * the handler of the command @a cmdname.  Use @a scratch_pool for
+ * temporary allocations.
+ */
+typedef svn_error_t *
+(*svn_ra_svn__command_start_func_t)(void *baton,
+                                    const char *cmdname,
+                                    apr_pool_t *scratch_pool);
+
+/** Callback invoked by svn_ra_svn__handle_command() after the command
+ * @a cmdname has been processed and its response been written.
+ * @a duration is the time it took to process the command, @a bytes_in and
+ * @a bytes_out are the number of bytes received for the command and sent
+ * in response, respectively.  @a failed is set if the command returned an
+ * error.  Use @a scratch_pool for temporary allocations.
+ */
+typedef svn_error_t *
+(*svn_ra_svn__command_done_func_t)(void *baton,
+                                   const char *cmdname,
+                                   apr_interval_time_t duration,
+                                   apr_uint64_t bytes_in,
+                                   apr_uint64_t bytes_out,
+                                   svn_boolean_t failed,
+                                   apr_pool_t *scratch_pool);
+
+/**
+ * Make svn_ra_svn__handle_command() call @a start_func and @a done_func
+ * with @a baton for every known command received on @a conn.  Commands
+ * that get handled while processing another command, e.g. the report
+ * commands of an update, are considered part of that outer command and
+ * will not be passed to the callbacks.  Either function may be @c NULL.
+ */
+void
+svn_ra_svn__set_command_hooks(svn_ra_svn_conn_t *conn,
+                              svn_ra_svn__command_start_func_t start_func,
+                              svn_ra_svn__command_done_func_t done_func,
+                              void *baton);
+
 /**
  * @defgroup ra_svn_deprecated ra_svn low-level functions
  * @{
@@ -169,6 +207,22 @@ svn_ra_svn__write_string(svn_ra_svn_conn_t *conn,
                          apr_pool_t *pool,
                          const svn_string_t *str);
 
+/** Write a string over the net, taking its @a len bytes of contents from
+ * @a file, starting at @a offset.
+ *
+ * If the connection is a plain socket, the contents will be sent using
+ * sendfile() without copying them into user space.  The current position
+ * of @a file is undefined afterwards.
+ *
+ * @since New in 1.15.
+ */
+svn_error_t *
+svn_ra_svn__write_string_from_file(svn_ra_svn_conn_t *conn,
+                                   apr_pool_t *pool,
+                                   apr_file_t *file,
+                                   apr_off_t offset,
+                                   apr_size_t len);
+
 /** Write a cstring over the net.
  *
  * Writes will be buffered until the next read or flush.
@@ -773,6 +827,10 @@ svn_ra_svn__write_cmd_get_file(svn_ra_svn_conn_t *conn,
 /** Send a "update" command over connection @a conn.
  * Use @a pool for allocations.
  *
+ * If @a text_deltas is FALSE, ask the server to omit the file contents
+ * from the editor drive.  Only servers announcing
+ * #SVN_RA_SVN_CAP_UPDATE_TEXT_DELTAS honor that.
+ *
  * @see #svn_ra_do_update3 for a description.
  */
 svn_error_t *
@@ -783,7 +841,8 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              svn_boolean_t recurse,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry);
+                             svn_boolean_t ignore_ancestry,
+                             svn_boolean_t text_deltas);
 
 /** Send a "switch" command over connection @a conn.
  * Use @a pool for allocations.
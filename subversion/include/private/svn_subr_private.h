@@ -268,6 +268,68 @@ svn_checksum_t *
 svn_checksum__from_digest_fnv1a_32x4(const unsigned char *digest,
                                      apr_pool_t *result_pool);
 
+/**
+ * Internal function for creating a SHA-256 checksum from a binary
+ * digest.
+ *
+ * @since New in 1.15
+ */
+svn_checksum_t *
+svn_checksum__from_digest_sha256(const unsigned char *digest,
+                                 apr_pool_t *result_pool);
+
+
+/**
+ * Opaque type for calculating checksums of several kinds over the same
+ * data.  For the common combination of MD5 and SHA-1, this uses a single
+ * kernel that interleaves the rounds of both algorithms, which takes
+ * less CPU time than feeding the data into two #svn_checksum_ctx_t.
+ *
+ * @since New in 1.15
+ */
+typedef struct svn_checksum__multi_ctx_t svn_checksum__multi_ctx_t;
+
+/**
+ * Return a new context for calculating checksums of the @a count checksum
+ * @a kinds, allocated in @a pool.
+ *
+ * @since New in 1.15
+ */
+svn_checksum__multi_ctx_t *
+svn_checksum__multi_ctx_create(const svn_checksum_kind_t *kinds,
+                               int count,
+                               apr_pool_t *pool);
+
+/**
+ * Reset all checksum calculations in @a ctx to their initial state.
+ *
+ * @since New in 1.15
+ */
+svn_error_t *
+svn_checksum__multi_ctx_reset(svn_checksum__multi_ctx_t *ctx);
+
+/**
+ * Update all checksum calculations in @a ctx with @a len bytes of @a data.
+ *
+ * @since New in 1.15
+ */
+svn_error_t *
+svn_checksum__multi_update(svn_checksum__multi_ctx_t *ctx,
+                           const void *data,
+                           apr_size_t len);
+
+/**
+ * Finalize the checksum of the given @a kind in @a ctx and return it in
+ * @a *checksum, allocated in @a pool.  If @a ctx does not calculate a
+ * checksum of that @a kind, set @a *checksum to NULL.
+ *
+ * @since New in 1.15
+ */
+svn_error_t *
+svn_checksum__multi_final(svn_checksum_t **checksum,
+                          const svn_checksum__multi_ctx_t *ctx,
+                          svn_checksum_kind_t kind,
+                          apr_pool_t *pool);
 
 /**
  * Return a stream that calculates a checksum of type @a kind over all
@@ -284,6 +346,25 @@ svn_checksum__wrap_write_stream(svn_checksum_t **checksum,
                                 svn_checksum_kind_t kind,
                                 apr_pool_t *pool);
 
+/**
+ * Like svn_checksum__wrap_write_stream() but calculate checksums of all
+ * @a count checksum @a kinds in a single pass over the data.  When the
+ * returned stream gets closed, write the checksum of kind @a kinds[i] to
+ * @a *checksums[i] unless @a checksums[i] is NULL.
+ * Allocate the result in @a pool.
+ *
+ * @note The stream returned only supports #svn_stream_write and
+ * #svn_stream_close.
+ *
+ * @since New in 1.15
+ */
+svn_stream_t *
+svn_checksum__wrap_write_stream_multi(svn_checksum_t **checksums[],
+                                      const svn_checksum_kind_t kinds[],
+                                      int count,
+                                      svn_stream_t *inner_stream,
+                                      apr_pool_t *pool);
+
 /**
  * Return a stream that calculates a 32 bit modified FNV-1a checksum
  * over all data written to the @a inner_stream and writes the digest
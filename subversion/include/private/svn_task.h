@@ -167,7 +167,13 @@ typedef svn_error_t *(*svn_task__thread_context_constructor_t)(
  * For each worker thread - or the current thread in single-threaded
  * execution - a context object may be created if @a context_constructor
  * is not @c NULL.  The respective contexts are being created by calling
- * this constructor function with @a context_baton as parameter.
+ * this constructor function with @a context_baton as parameter.  All
+ * contexts get constructed in the current thread before any processing
+ * starts.
+ *
+ * Output functions will always be called in the current thread.  Process
+ * functions may be called from any of the worker threads, hence
+ * @a cancel_func must be safe to call concurrently from multiple threads.
  *
  * Allocate the result in @a result_pool.  The context is passed in to the
  * process function as-is and may be @c NULL.
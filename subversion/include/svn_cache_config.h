@@ -83,6 +83,27 @@ svn_cache_config_get(void);
 void
 svn_cache_config_set(const svn_cache_config_t *settings);
 
+/** Create the process-global cache now, according to the current cache
+   configuration, and place it in shared memory.  All processes forked
+   from the current one after this call will use the same cache contents
+   instead of each one warming up a private copy.  The cache size then
+   applies to the whole process tree.
+
+   Call this function from the initialization code of the parent process,
+   after svn_cache_config_set() and before forking any worker processes.
+   Calling it again after a successful call has no effect.
+
+   If the platform does not support anonymous shared memory or the
+   process-global cache has already been created, return an error.
+   Each process will then use a private cache as before.
+
+   This function is not thread-safe.
+
+   @since New in 1.15.
+ */
+svn_error_t *
+svn_cache_config_share(void);
+
 /** @} */
 
 /** @} */
@@ -58,7 +58,11 @@ typedef enum svn_checksum_kind_t
   /** The checksum is (or should be set to) a modified FNV-1a 32 bit,
    * in big endian byte order.
    * @since New in 1.9. */
-  svn_checksum_fnv1a_32x4
+  svn_checksum_fnv1a_32x4,
+
+  /** The checksum is (or should be set to) a SHA-256 checksum.
+   * @since New in 1.15. */
+  svn_checksum_sha256
 } svn_checksum_kind_t;
 
 /**
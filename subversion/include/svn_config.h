@@ -117,6 +117,8 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_SERF_LOG_COMPONENTS       "serf-log-components"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_SERF_LOG_LEVEL            "serf-log-level"
+/** @since New in 1.15. */
+#define SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS       "svn-max-connections"
 
 
 #define SVN_CONFIG_CATEGORY_CONFIG          "config"
@@ -171,6 +173,10 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_SQLITE_EXCLUSIVE_CLIENTS  "exclusive-locking-clients"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_SQLITE_BUSY_TIMEOUT       "busy-timeout"
+/** @since New in 1.15. */
+#define SVN_CONFIG_OPTION_WORKER_THREADS            "worker-threads"
+/** @since New in 1.15. */
+#define SVN_CONFIG_OPTION_COMPRESS_PRISTINES        "compress-pristines"
 /** @} */
 
 /** @name Repository conf directory configuration files strings
@@ -235,6 +241,8 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_DEFAULT_OPTION_STORE_SSL_CLIENT_CERT_PP_PLAINTEXT \
                                                              SVN_CONFIG_ASK
 #define SVN_CONFIG_DEFAULT_OPTION_HTTP_MAX_CONNECTIONS       4
+/** @since New in 1.15. */
+#define SVN_CONFIG_DEFAULT_OPTION_SVN_MAX_CONNECTIONS        1
 
 /** Read configuration information from the standard sources and merge it
  * into the hash @a *cfg_hash.  If @a config_dir is not NULL it specifies a
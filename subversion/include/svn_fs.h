@@ -166,6 +166,18 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_FSFS_LOG_ADDRESSING       "fsfs-log-addressing"
 
+/** String with a decimal representation of the number of revisions that
+ * FSFS shall combine into a stage pack file while their shard is still
+ * incomplete.  Zero ("0") disables pack stages.  Stage packs require
+ * logical addressing and must be smaller than the shard size.
+ *
+ * This option will only be used during the creation of new repositories
+ * and is otherwise ignored.
+ *
+ * @since New in 1.15.
+ */
+#define SVN_FS_CONFIG_FSFS_PACK_STAGE_SIZE      "fsfs-pack-stage-size"
+
 /* Note to maintainers: if you add further SVN_FS_CONFIG_FSFS_CACHE_* knobs,
    update fs_fs.c:verify_as_revision_before_current_plus_plus(). */
 
@@ -50,6 +50,7 @@ extern "C" {
 #define SVN_RA_SVN_CAP_EDIT_PIPELINE "edit-pipeline"
 #define SVN_RA_SVN_CAP_SVNDIFF1 "svndiff1"
 #define SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED "accepts-svndiff2"
+#define SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED "accepts-svndiff3"
 #define SVN_RA_SVN_CAP_ABSENT_ENTRIES "absent-entries"
 /* maps to SVN_RA_CAPABILITY_COMMIT_REVPROPS: */
 #define SVN_RA_SVN_CAP_COMMIT_REVPROPS "commit-revprops"
@@ -71,6 +72,10 @@ extern "C" {
 #define SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE "file-revs-reverse"
 /* maps to SVN_RA_CAPABILITY_LIST */
 #define SVN_RA_SVN_CAP_LIST "list"
+/* the server accepts pipelined get-dir commands (see the protocol doc) */
+#define SVN_RA_SVN_CAP_COMMAND_PIPELINE "command-pipeline"
+/* the server honors the text-deltas parameter of the update command */
+#define SVN_RA_SVN_CAP_UPDATE_TEXT_DELTAS "update-text-deltas"
 
 
 /** ra_svn passes @c svn_dirent_t fields over the wire as a list of
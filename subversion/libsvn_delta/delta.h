@@ -44,6 +44,10 @@ extern "C" {
 
 #define SVN_DELTA_WINDOW_SIZE 102400
 
+/* The size of one svndiff window for svndiff version 3 and later. */
+
+#define SVN_DELTA_LARGE_WINDOW_SIZE 1048576
+
 
 /* Context/baton for building an operation sequence. */
 
@@ -39,13 +39,16 @@
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
 static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
+static const char SVNDIFF_V3[] = { 'S', 'V', 'N', 3 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static const char *
 get_svndiff_header(int version)
 {
-  if (version == 2)
+  if (version == 3)
+    return SVNDIFF_V3;
+  else if (version == 2)
     return SVNDIFF_V2;
   else if (version == 1)
     return SVNDIFF_V1;
@@ -70,9 +73,51 @@ struct encoder_baton {
 /* This is at least as big as the largest size for a single instruction. */
 #define MAX_INSTRUCTION_LEN (2*SVN__MAX_ENCODED_UINT_LEN+1)
 /* This is at least as big as the largest possible instructions
-   section: in theory, the instructions could be SVN_DELTA_WINDOW_SIZE
-   1-byte copy-from-source instructions (though this is very unlikely). */
-#define MAX_INSTRUCTION_SECTION_LEN (SVN_DELTA_WINDOW_SIZE*MAX_INSTRUCTION_LEN)
+   section for windows of up to WINDOW_SIZE bytes: in theory, the
+   instructions could be WINDOW_SIZE 1-byte copy-from-source instructions
+   (though this is very unlikely). */
+#define MAX_INSTRUCTION_SECTION_LEN(window_size) \
+  ((window_size) * MAX_INSTRUCTION_LEN)
+
+apr_size_t
+svn_txdelta__max_window_size(int svndiff_version)
+{
+  return svndiff_version >= SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS
+       ? SVN_DELTA_LARGE_WINDOW_SIZE
+       : SVN_DELTA_WINDOW_SIZE;
+}
+
+/* Starting with svndiff version 3, instruction offsets are relative:
+   Source copies are encoded as the signed distance from the end of the
+   previous source copy, target copies as the distance back from the
+   current target position.  Both tend to be much smaller than the
+   absolute offsets and therefore need fewer bytes. */
+
+/* Encode the source view OFFSET relative to SOURCE_POS into the buffer at
+   P and return the end of the encoded data.  Negative distances are
+   mapped to odd numbers, positive ones to even numbers. */
+static unsigned char *
+encode_source_offset(unsigned char *p,
+                     apr_size_t offset,
+                     apr_size_t source_pos)
+{
+  apr_uint64_t value = offset >= source_pos
+                     ? (apr_uint64_t)(offset - source_pos) << 1
+                     : ((apr_uint64_t)(source_pos - offset) << 1) - 1;
+
+  return svn__encode_uint(p, value);
+}
+
+/* Encode the target view OFFSET relative to the current target view
+   position TPOS into the buffer at P and return the end of the encoded
+   data.  OFFSET must be smaller than TPOS. */
+static unsigned char *
+encode_target_offset(unsigned char *p,
+                     apr_size_t offset,
+                     apr_size_t tpos)
+{
+  return svn__encode_uint(p, (apr_uint64_t)(tpos - offset - 1));
+}
 
 
 /* Append an encoded integer to a string.  */
@@ -169,6 +214,10 @@ encode_window(svn_stringbuf_t **instructions_p,
   const svn_string_t *newdata;
   unsigned char ibuf[MAX_INSTRUCTION_LEN], *ip;
   const svn_txdelta_op_t *op;
+  svn_boolean_t relative_offsets
+    = version >= SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS;
+  apr_size_t tpos = 0;
+  apr_size_t source_pos = 0;
 
   /* create the necessary data buffers */
   instructions = svn_stringbuf_create_empty(pool);
@@ -189,9 +238,23 @@ encode_window(svn_stringbuf_t **instructions_p,
         *ip++ |= (unsigned char)op->length;
       else
         ip = svn__encode_uint(ip + 1, op->length);
-      if (op->action_code != svn_txdelta_new)
-        ip = svn__encode_uint(ip, op->offset);
+      if (!relative_offsets)
+        {
+          if (op->action_code != svn_txdelta_new)
+            ip = svn__encode_uint(ip, op->offset);
+        }
+      else if (op->action_code == svn_txdelta_source)
+        {
+          ip = encode_source_offset(ip, op->offset, source_pos);
+          source_pos = op->offset + op->length;
+        }
+      else if (op->action_code == svn_txdelta_target)
+        {
+          ip = encode_target_offset(ip, op->offset, tpos);
+        }
+
       svn_stringbuf_appendbytes(instructions, (const char *)ibuf, ip - ibuf);
+      tpos += op->length;
     }
 
   /* Encode the header.  */
@@ -206,7 +269,7 @@ encode_window(svn_stringbuf_t **instructions_p,
                                 compressed_instructions));
       instructions = compressed_instructions;
     }
-  else if (version == 1)
+  else if (version == 1 || version == 3)
     {
       svn_stringbuf_t *compressed_instructions;
       compressed_instructions = svn_stringbuf_create_empty(pool);
@@ -225,7 +288,7 @@ encode_window(svn_stringbuf_t **instructions_p,
                                 compressed));
       newdata = svn_stringbuf__morph_into_string(compressed);
     }
-  else if (version == 1)
+  else if (version == 1 || version == 3)
     {
       svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
 
@@ -424,11 +487,72 @@ decode_size(apr_size_t *val,
   return result;
 }
 
+/* Decode a source view offset encoded by encode_source_offset() relative
+   to SOURCE_POS into *OFFSET.  Return the end of the encoded data or NULL
+   if it is invalid. */
+static const unsigned char *
+decode_source_offset(apr_size_t *offset,
+                     apr_size_t source_pos,
+                     const unsigned char *p,
+                     const unsigned char *end)
+{
+  apr_uint64_t temp = 0;
+
+  p = svn__decode_uint(&temp, p, end);
+  if (p == NULL)
+    return NULL;
+
+  if (temp & 1)
+    {
+      temp = (temp >> 1) + 1;
+      if (temp > source_pos)
+        return NULL;
+
+      *offset = source_pos - (apr_size_t)temp;
+    }
+  else
+    {
+      temp >>= 1;
+      if (temp > APR_SIZE_MAX - source_pos)
+        return NULL;
+
+      *offset = source_pos + (apr_size_t)temp;
+    }
+
+  return p;
+}
+
+/* Decode a target view offset encoded by encode_target_offset() relative
+   to TPOS into *OFFSET.  Return the end of the encoded data or NULL if it
+   is invalid. */
+static const unsigned char *
+decode_target_offset(apr_size_t *offset,
+                     apr_size_t tpos,
+                     const unsigned char *p,
+                     const unsigned char *end)
+{
+  apr_uint64_t temp = 0;
+
+  p = svn__decode_uint(&temp, p, end);
+  if (p == NULL || temp >= tpos)
+    return NULL;
+
+  *offset = tpos - 1 - (apr_size_t)temp;
+  return p;
+}
+
 /* Decode an instruction into OP, returning a pointer to the text
    after the instruction.  Note that if the action code is
-   svn_txdelta_new, the offset field of *OP will not be set.  */
+   svn_txdelta_new, the offset field of *OP will not be set.
+
+   If RELATIVE_OFFSETS is set, the offsets are encoded relative to
+   *SOURCE_POS and TPOS, respectively, as in svndiff version 3.  In that
+   case, *SOURCE_POS will be updated for source copies.  */
 static const unsigned char *
 decode_instruction(svn_txdelta_op_t *op,
+                   svn_boolean_t relative_offsets,
+                   apr_size_t *source_pos,
+                   apr_size_t tpos,
                    const unsigned char *p,
                    const unsigned char *end)
 {
@@ -458,11 +582,20 @@ decode_instruction(svn_txdelta_op_t *op,
       if (p == NULL)
         return NULL;
     }
-  if (action != svn_txdelta_new)
+  if (!relative_offsets)
     {
-      p = decode_size(&op->offset, p, end);
-      if (p == NULL)
-        return NULL;
+      if (action != svn_txdelta_new)
+        p = decode_size(&op->offset, p, end);
+    }
+  else if (action == svn_txdelta_source)
+    {
+      p = decode_source_offset(&op->offset, *source_pos, p, end);
+      if (p)
+        *source_pos = op->offset + op->length;
+    }
+  else if (action == svn_txdelta_target)
+    {
+      p = decode_target_offset(&op->offset, tpos, p, end);
     }
 
   return p;
@@ -471,9 +604,10 @@ decode_instruction(svn_txdelta_op_t *op,
 /* Count the instructions in the range [P..END-1] and make sure they
    are valid for the given window lengths.  Return an error if the
    instructions are invalid; otherwise set *NINST to the number of
-   instructions.  */
+   instructions.  RELATIVE_OFFSETS is passed on to decode_instruction().  */
 static svn_error_t *
 count_and_verify_instructions(int *ninst,
+                              svn_boolean_t relative_offsets,
                               const unsigned char *p,
                               const unsigned char *end,
                               apr_size_t sview_len,
@@ -482,11 +616,12 @@ count_and_verify_instructions(int *ninst,
 {
   int n = 0;
   svn_txdelta_op_t op;
-  apr_size_t tpos = 0, npos = 0;
+  apr_size_t tpos = 0, npos = 0, source_pos = 0;
 
   while (p < end)
     {
-      p = decode_instruction(&op, p, end);
+      p = decode_instruction(&op, relative_offsets, &source_pos, tpos,
+                             p, end);
 
       /* Detect any malformed operations from the instruction stream. */
       if (p == NULL)
@@ -555,9 +690,12 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 {
   const unsigned char *insend;
   int ninst;
-  apr_size_t npos;
+  apr_size_t npos, tpos, source_pos;
   svn_txdelta_op_t *ops, *op;
   svn_string_t *new_data;
+  apr_size_t max_window_size = svn_txdelta__max_window_size(version);
+  svn_boolean_t relative_offsets
+    = version >= SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS;
 
   window->sview_offset = sview_offset;
   window->sview_len = sview_len;
@@ -571,9 +709,10 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
       SVN_ERR(svn__decompress_lz4(insend, newlen, ndout,
-                                  SVN_DELTA_WINDOW_SIZE));
-      SVN_ERR(svn__decompress_lz4(data, insend - data, instout,
-                                  MAX_INSTRUCTION_SECTION_LEN));
+                                  max_window_size));
+      SVN_ERR(svn__decompress_lz4(
+                data, insend - data, instout,
+                MAX_INSTRUCTION_SECTION_LEN(max_window_size)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -581,15 +720,16 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
       new_data = svn_stringbuf__morph_into_string(ndout);
     }
-  else if (version == 1)
+  else if (version == 1 || version == 3)
     {
       svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
       svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
 
       SVN_ERR(svn__decompress_zlib(insend, newlen, ndout,
-                                   SVN_DELTA_WINDOW_SIZE));
-      SVN_ERR(svn__decompress_zlib(data, insend - data, instout,
-                                   MAX_INSTRUCTION_SECTION_LEN));
+                                   max_window_size));
+      SVN_ERR(svn__decompress_zlib(
+                data, insend - data, instout,
+                MAX_INSTRUCTION_SECTION_LEN(max_window_size)));
 
       newlen = ndout->len;
       data = (unsigned char *)instout->data;
@@ -605,16 +745,20 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
     }
 
   /* Count the instructions and make sure they are all valid.  */
-  SVN_ERR(count_and_verify_instructions(&ninst, data, insend,
+  SVN_ERR(count_and_verify_instructions(&ninst, relative_offsets,
+                                        data, insend,
                                         sview_len, tview_len, newlen));
 
   /* Allocate a buffer for the instructions and decode them. */
   ops = apr_palloc(pool, ninst * sizeof(*ops));
   npos = 0;
+  tpos = 0;
+  source_pos = 0;
   window->src_ops = 0;
   for (op = ops; op < ops + ninst; op++)
     {
-      data = decode_instruction(op, data, insend);
+      data = decode_instruction(op, relative_offsets, &source_pos, tpos,
+                                data, insend);
       if (op->action_code == svn_txdelta_source)
         ++window->src_ops;
       else if (op->action_code == svn_txdelta_new)
@@ -622,6 +766,8 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
           op->offset = npos;
           npos += op->length;
         }
+
+      tpos += op->length;
     }
   SVN_ERR_ASSERT(data == insend);
 
@@ -653,6 +799,8 @@ write_handler(void *baton,
         db->version = 1;
       else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
         db->version = 2;
+      else if (memcmp(buffer, SVNDIFF_V3 + db->header_bytes, nheader) == 0)
+        db->version = 3;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -689,6 +837,8 @@ write_handler(void *baton,
           svn_filesize_t sview_offset;
           apr_size_t sview_len, tview_len, inslen, newlen;
           const unsigned char *hdr_start = p;
+          apr_size_t max_window_size
+            = svn_txdelta__max_window_size(db->version);
 
           p = decode_file_offset(&sview_offset, p, end);
           if (p == NULL)
@@ -710,11 +860,11 @@ write_handler(void *baton,
           if (p == NULL)
               break;
 
-          if (tview_len > SVN_DELTA_WINDOW_SIZE ||
-              sview_len > SVN_DELTA_WINDOW_SIZE ||
+          if (tview_len > max_window_size ||
+              sview_len > max_window_size ||
               /* for svndiff1, newlen includes the original length */
-              newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-              inslen > MAX_INSTRUCTION_SECTION_LEN)
+              newlen > max_window_size + SVN__MAX_ENCODED_UINT_LEN ||
+              inslen > MAX_INSTRUCTION_SECTION_LEN(max_window_size))
             return svn_error_create(
                      SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                      _("Svndiff contains a too-large window"));
@@ -894,14 +1044,17 @@ read_one_size(apr_size_t *size,
   return SVN_NO_ERROR;
 }
 
-/* Read a window header from STREAM and check it for integer overflow. */
+/* Read a window header of svndiff version SVNDIFF_VERSION data from
+   STREAM and check it for integer overflow. */
 static svn_error_t *
-read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
+read_window_header(svn_stream_t *stream, int svndiff_version,
+                   svn_filesize_t *sview_offset,
                    apr_size_t *sview_len, apr_size_t *tview_len,
                    apr_size_t *inslen, apr_size_t *newlen,
                    apr_size_t *header_len)
 {
   unsigned char c;
+  apr_size_t max_window_size = svn_txdelta__max_window_size(svndiff_version);
 
   /* Read the source view offset by hand, since it's not an apr_size_t. */
   *header_len = 0;
@@ -921,11 +1074,11 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
   SVN_ERR(read_one_size(inslen, header_len, stream));
   SVN_ERR(read_one_size(newlen, header_len, stream));
 
-  if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
-      *sview_len > SVN_DELTA_WINDOW_SIZE ||
+  if (*tview_len > max_window_size ||
+      *sview_len > max_window_size ||
       /* for svndiff1, newlen includes the original length */
-      *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
-      *inslen > MAX_INSTRUCTION_SECTION_LEN)
+      *newlen > max_window_size + SVN__MAX_ENCODED_UINT_LEN ||
+      *inslen > MAX_INSTRUCTION_SECTION_LEN(max_window_size))
     return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
                             _("Svndiff contains a too-large window"));
 
@@ -949,8 +1102,9 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
   apr_size_t sview_len, tview_len, inslen, newlen, len, header_len;
   unsigned char *buf;
 
-  SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+  SVN_ERR(read_window_header(stream, svndiff_version, &sview_offset,
+                             &sview_len, &tview_len, &inslen, &newlen,
+                             &header_len));
   len = inslen + newlen;
   buf = apr_palloc(pool, len);
   SVN_ERR(svn_stream_read_full(stream, (char*)buf, &len));
@@ -973,8 +1127,9 @@ svn_txdelta_skip_svndiff_window(apr_file_t *file,
   apr_size_t sview_len, tview_len, inslen, newlen, header_len;
   apr_off_t offset;
 
-  SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
-                             &inslen, &newlen, &header_len));
+  SVN_ERR(read_window_header(stream, svndiff_version, &sview_offset,
+                             &sview_len, &tview_len, &inslen, &newlen,
+                             &header_len));
 
   offset = inslen + newlen;
   return svn_io_file_seek(file, APR_CUR, &offset, pool);
@@ -988,7 +1143,11 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
   svn_filesize_t sview_offset;
   apr_size_t sview_len, tview_len, inslen, newlen, header_len;
 
-  SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
+  /* We don't know the svndiff version here, so accept the largest windows
+     any version allows.  The window contents will be checked against the
+     actual version once they get decoded. */
+  SVN_ERR(read_window_header(stream, SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS,
+                             &sview_offset, &sview_len, &tview_len,
                              &inslen, &newlen, &header_len));
 
   *window_len = inslen + newlen + header_len;
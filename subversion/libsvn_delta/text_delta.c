@@ -33,6 +33,7 @@
 #include "svn_pools.h"
 #include "svn_checksum.h"
 
+#include "private/svn_delta_private.h"
 #include "delta.h"
 
 
@@ -54,7 +55,11 @@ struct txdelta_baton {
   /* Private data */
   svn_boolean_t more_source;    /* FALSE if source stream hit EOF. */
   svn_boolean_t more;           /* TRUE if there are more data in the pool. */
-  svn_filesize_t pos;           /* Offset of next read in source file. */
+  svn_filesize_t source_offset; /* Offset of the source data in BUF. */
+  apr_size_t source_len;        /* Length of the source data in BUF. */
+  svn_filesize_t next_offset;   /* Where the next source view shall start. */
+  apr_size_t window_size;       /* Maximum source and target view length. */
+  svn_boolean_t sliding;        /* Let source views follow the matches. */
   char *buf;                    /* Buffer for input data. */
 
   svn_checksum_ctx_t *context;  /* If not NULL, the context for computing
@@ -79,7 +84,11 @@ struct tpush_baton {
   svn_filesize_t source_offset;
   apr_size_t source_len;
   svn_boolean_t source_done;
+  svn_boolean_t need_source;
+  svn_filesize_t next_offset;
   apr_size_t target_len;
+  apr_size_t window_size;
+  svn_boolean_t sliding;
 };
 
 
@@ -352,6 +361,76 @@ svn_txdelta_md5_digest(svn_txdelta_stream_t *stream)
 }
 
 
+
+/* Sliding source views. */
+
+/* Return the source offset at which the source view of the window
+   following WINDOW shall start.  With SLIDING set, that is the end of the
+   source data that the last source copy in WINDOW used.  Otherwise, the
+   next source view simply follows the current one. */
+static svn_filesize_t
+next_source_offset(const svn_txdelta_window_t *window,
+                   svn_boolean_t sliding)
+{
+  int i;
+
+  if (sliding)
+    for (i = window->num_ops - 1; i >= 0; --i)
+      if (window->ops[i].action_code == svn_txdelta_source)
+        return window->sview_offset
+             + window->ops[i].offset + window->ops[i].length;
+
+  /* Without any matches, we can only assume that source and target
+     continue to advance at the same rate. */
+  return window->sview_offset
+       + (sliding ? window->tview_len : window->sview_len);
+}
+
+/* BUF contains *BUF_LEN bytes of source data, starting at *BUF_OFFSET
+   in SOURCE.  Move the source view such that it starts at OFFSET, or
+   as close as possible to it, and fill it up with up to WINDOW_SIZE bytes
+   of data read from SOURCE.  Source views never slide backwards.  Data
+   beyond the current view is never skipped.  Set *MORE_SOURCE to FALSE
+   when SOURCE hit EOF and don't read from it anymore after that. */
+static svn_error_t *
+slide_source_view(char *buf,
+                  svn_filesize_t *buf_offset,
+                  apr_size_t *buf_len,
+                  svn_boolean_t *more_source,
+                  svn_stream_t *source,
+                  svn_filesize_t offset,
+                  apr_size_t window_size)
+{
+  apr_size_t drop;
+
+  if (offset < *buf_offset)
+    offset = *buf_offset;
+  else if (offset > *buf_offset + *buf_len)
+    offset = *buf_offset + *buf_len;
+
+  /* Discard data before the new view's start. */
+  drop = (apr_size_t)(offset - *buf_offset);
+  if (drop && drop < *buf_len)
+    memmove(buf, buf + drop, *buf_len - drop);
+
+  *buf_len -= drop;
+  *buf_offset = offset;
+
+  /* Top up the view. */
+  if (*more_source && *buf_len < window_size)
+    {
+      apr_size_t to_read = window_size - *buf_len;
+      apr_size_t len = to_read;
+
+      SVN_ERR(svn_stream_read_full(source, buf + *buf_len, &len));
+      *more_source = (len == to_read);
+      *buf_len += len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
 
 static svn_error_t *
 txdelta_next_window(svn_txdelta_window_t **window,
@@ -359,21 +438,16 @@ txdelta_next_window(svn_txdelta_window_t **window,
                     apr_pool_t *pool)
 {
   struct txdelta_baton *b = baton;
-  apr_size_t source_len = SVN_DELTA_WINDOW_SIZE;
-  apr_size_t target_len = SVN_DELTA_WINDOW_SIZE;
+  apr_size_t target_len = b->window_size;
 
   /* Read the source stream. */
-  if (b->more_source)
-    {
-      SVN_ERR(svn_stream_read_full(b->source, b->buf, &source_len));
-      b->more_source = (source_len == SVN_DELTA_WINDOW_SIZE);
-    }
-  else
-    source_len = 0;
+  SVN_ERR(slide_source_view(b->buf, &b->source_offset, &b->source_len,
+                            &b->more_source, b->source, b->next_offset,
+                            b->window_size));
 
   /* Read the target stream. */
-  SVN_ERR(svn_stream_read_full(b->target, b->buf + source_len, &target_len));
-  b->pos += source_len;
+  SVN_ERR(svn_stream_read_full(b->target, b->buf + b->source_len,
+                               &target_len));
 
   if (target_len == 0)
     {
@@ -386,10 +460,12 @@ txdelta_next_window(svn_txdelta_window_t **window,
       return SVN_NO_ERROR;
     }
   else if (b->context != NULL)
-    SVN_ERR(svn_checksum_update(b->context, b->buf + source_len, target_len));
+    SVN_ERR(svn_checksum_update(b->context, b->buf + b->source_len,
+                                target_len));
 
-  *window = compute_window(b->buf, source_len, target_len,
-                           b->pos - source_len, pool);
+  *window = compute_window(b->buf, b->source_len, target_len,
+                           b->source_offset, pool);
+  b->next_offset = next_source_offset(*window, b->sliding);
 
   /* That's it. */
   return SVN_NO_ERROR;
@@ -434,7 +510,7 @@ svn_txdelta_run(svn_stream_t *source,
   tb.target = target;
   tb.more_source = TRUE;
   tb.more = TRUE;
-  tb.pos = 0;
+  tb.window_size = SVN_DELTA_WINDOW_SIZE;
   tb.buf = apr_palloc(scratch_pool, 2 * SVN_DELTA_WINDOW_SIZE);
   tb.result_pool = result_pool;
 
@@ -467,11 +543,12 @@ svn_txdelta_run(svn_stream_t *source,
 
 
 void
-svn_txdelta2(svn_txdelta_stream_t **stream,
-             svn_stream_t *source,
-             svn_stream_t *target,
-             svn_boolean_t calculate_checksum,
-             apr_pool_t *pool)
+svn_txdelta__create(svn_txdelta_stream_t **stream,
+                    svn_stream_t *source,
+                    svn_stream_t *target,
+                    svn_boolean_t calculate_checksum,
+                    int svndiff_version,
+                    apr_pool_t *pool)
 {
   struct txdelta_baton *b = apr_pcalloc(pool, sizeof(*b));
 
@@ -479,7 +556,9 @@ svn_txdelta2(svn_txdelta_stream_t **stream,
   b->target = target;
   b->more_source = TRUE;
   b->more = TRUE;
-  b->buf = apr_palloc(pool, 2 * SVN_DELTA_WINDOW_SIZE);
+  b->window_size = svn_txdelta__max_window_size(svndiff_version);
+  b->sliding = svndiff_version >= SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS;
+  b->buf = apr_palloc(pool, 2 * b->window_size);
   b->context = calculate_checksum
              ? svn_checksum_ctx_create(svn_checksum_md5, pool)
              : NULL;
@@ -489,6 +568,16 @@ svn_txdelta2(svn_txdelta_stream_t **stream,
                                       txdelta_md5_digest, pool);
 }
 
+void
+svn_txdelta2(svn_txdelta_stream_t **stream,
+             svn_stream_t *source,
+             svn_stream_t *target,
+             svn_boolean_t calculate_checksum,
+             apr_pool_t *pool)
+{
+  svn_txdelta__create(stream, source, target, calculate_checksum, 0, pool);
+}
+
 void
 svn_txdelta(svn_txdelta_stream_t **stream,
             svn_stream_t *source,
@@ -518,16 +607,19 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
       svn_pool_clear(pool);
 
       /* Make sure we're all full up on source data, if possible. */
-      if (tb->source_len == 0 && !tb->source_done)
+      if (tb->need_source)
         {
-          tb->source_len = SVN_DELTA_WINDOW_SIZE;
-          SVN_ERR(svn_stream_read_full(tb->source, tb->buf, &tb->source_len));
-          if (tb->source_len < SVN_DELTA_WINDOW_SIZE)
-            tb->source_done = TRUE;
+          svn_boolean_t more_source = !tb->source_done;
+          SVN_ERR(slide_source_view(tb->buf, &tb->source_offset,
+                                    &tb->source_len, &more_source,
+                                    tb->source, tb->next_offset,
+                                    tb->window_size));
+          tb->source_done = !more_source;
+          tb->need_source = FALSE;
         }
 
-      /* Copy in the target data, up to SVN_DELTA_WINDOW_SIZE. */
-      chunk_len = SVN_DELTA_WINDOW_SIZE - tb->target_len;
+      /* Copy in the target data, up to TB->WINDOW_SIZE. */
+      chunk_len = tb->window_size - tb->target_len;
       if (chunk_len > data_len)
         chunk_len = data_len;
       memcpy(tb->buf + tb->source_len + tb->target_len, data, chunk_len);
@@ -536,13 +628,13 @@ tpush_write_handler(void *baton, const char *data, apr_size_t *len)
       tb->target_len += chunk_len;
 
       /* If we're full of target data, compute and fire off a window. */
-      if (tb->target_len == SVN_DELTA_WINDOW_SIZE)
+      if (tb->target_len == tb->window_size)
         {
           window = compute_window(tb->buf, tb->source_len, tb->target_len,
                                   tb->source_offset, pool);
           SVN_ERR(tb->wh(window, tb->whb));
-          tb->source_offset += tb->source_len;
-          tb->source_len = 0;
+          tb->next_offset = next_source_offset(window, tb->sliding);
+          tb->need_source = TRUE;
           tb->target_len = 0;
         }
     }
@@ -575,9 +667,11 @@ tpush_close_handler(void *baton)
 
 
 svn_stream_t *
-svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
-                        void *handler_baton, svn_stream_t *source,
-                        apr_pool_t *pool)
+svn_txdelta__target_push(svn_txdelta_window_handler_t handler,
+                         void *handler_baton,
+                         svn_stream_t *source,
+                         int svndiff_version,
+                         apr_pool_t *pool)
 {
   struct tpush_baton *tb;
   svn_stream_t *stream;
@@ -588,10 +682,14 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
   tb->wh = handler;
   tb->whb = handler_baton;
   tb->pool = pool;
-  tb->buf = apr_palloc(pool, 2 * SVN_DELTA_WINDOW_SIZE);
+  tb->window_size = svn_txdelta__max_window_size(svndiff_version);
+  tb->sliding = svndiff_version >= SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS;
+  tb->buf = apr_palloc(pool, 2 * tb->window_size);
   tb->source_offset = 0;
   tb->source_len = 0;
   tb->source_done = FALSE;
+  tb->need_source = TRUE;
+  tb->next_offset = 0;
   tb->target_len = 0;
 
   /* Create and return writable stream. */
@@ -601,6 +699,14 @@ svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
   return stream;
 }
 
+svn_stream_t *
+svn_txdelta_target_push(svn_txdelta_window_handler_t handler,
+                        void *handler_baton, svn_stream_t *source,
+                        apr_pool_t *pool)
+{
+  return svn_txdelta__target_push(handler, handler_baton, source, 0, pool);
+}
+
 
 
 /* Functions for applying deltas.  */
@@ -29,8 +29,30 @@
 
 #include "svn_hash.h"
 #include "svn_delta.h"
+#include "private/svn_atomic.h"
+#include "private/svn_delta_private.h"
 #include "private/svn_string_private.h"
 #include "delta.h"
+
+/* Vector instructions are only used on x86 and only with compilers that
+   let us compile code for instruction sets that may not be available at
+   run-time.  XDELTA_TARGET(isa) enables ISA for the following function. */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && (__GNUC__ >= 5 || defined(__clang__))
+#  define XDELTA_X86_SIMD
+#  define XDELTA_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && _MSC_VER >= 1800 \
+      && (defined(_M_X64) || defined(_M_IX86))
+#  define XDELTA_X86_SIMD
+#  define XDELTA_TARGET(isa)
+#endif
+
+#ifdef XDELTA_X86_SIMD
+#  include <immintrin.h>
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  endif
+#endif
 
 /* This is pseudo-adler32. It is adler32 without the prime modulus.
    The idea is borrowed from monotone, and is a translation of the C++
@@ -103,6 +125,138 @@ init_adler32(const char *data)
   return s2 * 0x10000 + s1;
 }
 
+#ifdef XDELTA_X86_SIMD
+
+/* Return the index of the least significant bit set in the non-zero VALUE.
+ */
+static APR_INLINE int
+first_set_bit(apr_uint32_t value)
+{
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return (int)index;
+#else
+  return __builtin_ctz(value);
+#endif
+}
+
+/* Like init_adler32() but using SSE4.2 instructions. */
+XDELTA_TARGET("sse4.2")
+static apr_uint32_t
+init_adler32_sse42(const char *data)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  __m128i s1 = zero;
+  __m128i s2 = zero;
+  int i;
+
+  /* S2 is the sum of all bytes weighted by their distance to the end of
+     the block.  Byte pairs multiplied by those weights fit into 16 bits. */
+  for (i = 0; i < MATCH_BLOCKSIZE; i += 16)
+    {
+      const char w = (char)(MATCH_BLOCKSIZE - i);
+      __m128i weights = _mm_setr_epi8(w,      w - 1,  w - 2,  w - 3,
+                                      w - 4,  w - 5,  w - 6,  w - 7,
+                                      w - 8,  w - 9,  w - 10, w - 11,
+                                      w - 12, w - 13, w - 14, w - 15);
+      __m128i input = _mm_loadu_si128((const __m128i *)(data + i));
+
+      s1 = _mm_add_epi64(s1, _mm_sad_epu8(input, zero));
+      s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_maddubs_epi16(input, weights),
+                                            ones));
+    }
+
+  s1 = _mm_add_epi64(s1, _mm_unpackhi_epi64(s1, s1));
+  s2 = _mm_add_epi32(s2, _mm_shuffle_epi32(s2, _MM_SHUFFLE(1, 0, 3, 2)));
+  s2 = _mm_add_epi32(s2, _mm_shuffle_epi32(s2, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return (apr_uint32_t)_mm_cvtsi128_si32(s2) * 0x10000
+       + (apr_uint32_t)_mm_cvtsi128_si32(s1);
+}
+
+/* Like init_adler32() but using AVX2 instructions. */
+XDELTA_TARGET("avx2")
+static apr_uint32_t
+init_adler32_avx2(const char *data)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i weights_lo = _mm256_setr_epi8(64, 63, 62, 61, 60, 59, 58, 57,
+                                              56, 55, 54, 53, 52, 51, 50, 49,
+                                              48, 47, 46, 45, 44, 43, 42, 41,
+                                              40, 39, 38, 37, 36, 35, 34, 33);
+  const __m256i weights_hi = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                              24, 23, 22, 21, 20, 19, 18, 17,
+                                              16, 15, 14, 13, 12, 11, 10,  9,
+                                               8,  7,  6,  5,  4,  3,  2,  1);
+  __m256i input_lo = _mm256_loadu_si256((const __m256i *)data);
+  __m256i input_hi = _mm256_loadu_si256((const __m256i *)(data + 32));
+  __m256i s1 = _mm256_add_epi64(_mm256_sad_epu8(input_lo, zero),
+                                _mm256_sad_epu8(input_hi, zero));
+  __m256i s2 = _mm256_add_epi32(
+      _mm256_madd_epi16(_mm256_maddubs_epi16(input_lo, weights_lo), ones),
+      _mm256_madd_epi16(_mm256_maddubs_epi16(input_hi, weights_hi), ones));
+  __m128i s1x = _mm_add_epi64(_mm256_castsi256_si128(s1),
+                              _mm256_extracti128_si256(s1, 1));
+  __m128i s2x = _mm_add_epi32(_mm256_castsi256_si128(s2),
+                              _mm256_extracti128_si256(s2, 1));
+
+  s1x = _mm_add_epi64(s1x, _mm_unpackhi_epi64(s1x, s1x));
+  s2x = _mm_add_epi32(s2x, _mm_shuffle_epi32(s2x, _MM_SHUFFLE(1, 0, 3, 2)));
+  s2x = _mm_add_epi32(s2x, _mm_shuffle_epi32(s2x, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return (apr_uint32_t)_mm_cvtsi128_si32(s2x) * 0x10000
+       + (apr_uint32_t)_mm_cvtsi128_si32(s1x);
+}
+
+/* Like svn_cstring__match_length() but comparing 16 bytes at once. */
+XDELTA_TARGET("sse4.2")
+static apr_size_t
+match_length_sse42(const char *a,
+                   const char *b,
+                   apr_size_t max_len)
+{
+  apr_size_t pos;
+
+  for (pos = 0; max_len - pos >= 16; pos += 16)
+    {
+      __m128i va = _mm_loadu_si128((const __m128i *)(a + pos));
+      __m128i vb = _mm_loadu_si128((const __m128i *)(b + pos));
+      apr_uint32_t mask = (apr_uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(va,
+                                                                         vb));
+      if (mask != 0xffff)
+        return pos + first_set_bit(~mask);
+    }
+
+  return pos + svn_cstring__match_length(a + pos, b + pos, max_len - pos);
+}
+
+/* Like svn_cstring__match_length() but comparing 32 bytes at once. */
+XDELTA_TARGET("avx2")
+static apr_size_t
+match_length_avx2(const char *a,
+                  const char *b,
+                  apr_size_t max_len)
+{
+  apr_size_t pos;
+
+  for (pos = 0; max_len - pos >= 32; pos += 32)
+    {
+      __m256i va = _mm256_loadu_si256((const __m256i *)(a + pos));
+      __m256i vb = _mm256_loadu_si256((const __m256i *)(b + pos));
+      apr_uint32_t mask
+        = (apr_uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+      if (mask != 0xffffffff)
+        return pos + first_set_bit(~mask);
+    }
+
+  return pos + svn_cstring__match_length(a + pos, b + pos, max_len - pos);
+}
+
+#endif /* XDELTA_X86_SIMD */
+
 /* Information for a block of the delta source.  The length of the
    block is the smaller of MATCH_BLOCKSIZE and the difference between
    the size of the source data and the position of this block. */
@@ -137,8 +291,9 @@ struct blocks
      as "known not to have a match".
      The mapping of adler32 checksum bits is [0..2][16..27] (LSB -> MSB),
      i.e. address the byte by the multiplicative part of adler32 and address
-     the bits in that byte by the additive part of adler32. */
-  char flags[FLAGS_COUNT / 8];
+     the bits in that byte by the additive part of adler32.
+     The extra bytes at the end allow for 32 bit reads at any offset. */
+  char flags[FLAGS_COUNT / 8 + 3];
 
   /* The vector of blocks.  A pos value of NO_POSITION represents an unused
      slot. */
@@ -165,6 +320,259 @@ static apr_uint32_t hash_flags(apr_uint32_t sum)
   return (sum >> 16) & ((FLAGS_COUNT / 8) - 1);
 }
 
+/* Return TRUE if BLOCKS may contain a block with the adler32 SUM. */
+static APR_INLINE svn_boolean_t
+may_match(const struct blocks *blocks, apr_uint32_t sum)
+{
+  return (blocks->flags[hash_flags(sum)] & (1 << (sum & 7))) != 0;
+}
+
+/* Starting at position LO in B and the adler32 checksum *ROLLING_P for that
+   position, quickly skip positions whose checksums definitely do not match
+   any block in BLOCKS.  Stop at UPPER.  Return the new position and set
+   *ROLLING_P to the checksum for it. */
+static apr_size_t
+skip_no_match(const struct blocks *blocks,
+              apr_uint32_t *rolling_p,
+              const char *b,
+              apr_size_t lo,
+              apr_size_t upper)
+{
+  apr_uint32_t rolling = *rolling_p;
+
+  while (!may_match(blocks, rolling) && lo < upper)
+    {
+      rolling = adler32_replace(rolling, b[lo], b[lo+MATCH_BLOCKSIZE]);
+      lo++;
+    }
+
+  *rolling_p = rolling;
+  return lo;
+}
+
+#ifdef XDELTA_X86_SIMD
+
+/* A note on skip_no_match_avx2():
+
+   adler32_replace() is a linear function modulo 2^32:
+
+     R(k+1) = M * (R(k) + D(k))
+
+   with M = 0x10001 and D(k) = in(k) - (MATCH_BLOCKSIZE * 0x10000 + 1) * out(k).
+   Since M^k = k * 0x10000 + 1 (modulo 2^32), the checksums for the next N
+   positions are
+
+     R(k+1) = M^(k+1) * R(0) + sum_{j<=k} M^(k+1-j) * D(j)
+
+   The sum is a weighted prefix sum, which we calculate in log2(N) steps
+   using shifts and adds only.  Thus, we get bit-identical checksums for
+   N positions at once.
+
+   Computing the checksums alone does not gain much, though, as the scalar
+   loop is limited by the per-position lookup in BLOCKS->FLAGS.  AVX2 lets
+   us gather those flags for all positions at once, too.  There is no such
+   instruction in SSE4.2, so that variant uses the scalar loop. */
+
+/* Like skip_no_match() but checking 8 positions at once. */
+XDELTA_TARGET("avx2")
+static apr_size_t
+skip_no_match_avx2(const struct blocks *blocks,
+                   apr_uint32_t *rolling_p,
+                   const char *b,
+                   apr_size_t lo,
+                   apr_size_t upper)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i factors = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 8);
+  const __m256i shift1 = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+  const __m256i shift2 = _mm256_setr_epi32(0, 0, 0, 1, 2, 3, 4, 5);
+  const __m256i shift4 = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 2, 3);
+  const __m256i last = _mm256_set1_epi32(7);
+  const __m256i offset_mask = _mm256_set1_epi32(FLAGS_COUNT / 8 - 1);
+  const __m256i bit_mask = _mm256_set1_epi32(7);
+  __m256i rolling;
+
+  if (may_match(blocks, *rolling_p))
+    return lo;
+
+  rolling = _mm256_set1_epi32((int)*rolling_p);
+  while (lo + 8 <= upper)
+    {
+      __m256i out = _mm256_cvtepu8_epi32(
+                      _mm_loadl_epi64((const __m128i *)(b + lo)));
+      __m256i in = _mm256_cvtepu8_epi32(
+                     _mm_loadl_epi64((const __m128i *)(b + lo
+                                                       + MATCH_BLOCKSIZE)));
+      __m256i t, s, flags;
+      int mask;
+
+      /* D(k) * M */
+      t = _mm256_sub_epi32(_mm256_sub_epi32(in, out),
+                           _mm256_slli_epi32(out, 22));
+      t = _mm256_add_epi32(t, _mm256_slli_epi32(t, 16));
+
+      /* Weighted prefix sum. */
+      s = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(t, shift1),
+                             zero, 0x01);
+      t = _mm256_add_epi32(t, _mm256_add_epi32(s, _mm256_slli_epi32(s, 16)));
+      s = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(t, shift2),
+                             zero, 0x03);
+      t = _mm256_add_epi32(t, _mm256_add_epi32(s, _mm256_slli_epi32(s, 17)));
+      s = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(t, shift4),
+                             zero, 0x0f);
+      t = _mm256_add_epi32(t, _mm256_add_epi32(s, _mm256_slli_epi32(s, 18)));
+
+      /* + M^(k+1) * R(0) */
+      t = _mm256_add_epi32(t, _mm256_add_epi32(
+            rolling,
+            _mm256_mullo_epi32(_mm256_slli_epi32(rolling, 16), factors)));
+
+      /* may_match() for all 8 checksums. */
+      flags = _mm256_i32gather_epi32(
+                (const int *)blocks->flags,
+                _mm256_and_si256(_mm256_srli_epi32(t, 16), offset_mask),
+                1);
+      flags = _mm256_srlv_epi32(flags, _mm256_and_si256(t, bit_mask));
+      mask = _mm256_movemask_ps(
+               _mm256_castsi256_ps(_mm256_slli_epi32(flags, 31)));
+      if (mask)
+        {
+          apr_uint32_t sums[8];
+          int i = first_set_bit((apr_uint32_t)mask);
+
+          _mm256_storeu_si256((__m256i *)sums, t);
+          *rolling_p = sums[i];
+          return lo + i + 1;
+        }
+
+      rolling = _mm256_permutevar8x32_epi32(t, last);
+      lo += 8;
+    }
+
+  /* _mm256_cvtsi256_si32() is missing from older compilers. */
+  *rolling_p = (apr_uint32_t)_mm_cvtsi128_si32(
+                               _mm256_castsi256_si128(rolling));
+  return skip_no_match(blocks, rolling_p, b, lo, upper);
+}
+
+#endif /* XDELTA_X86_SIMD */
+
+/* The implementations of the performance-critical steps in compute_delta().
+   All of them produce identical results. */
+typedef struct xdelta_vtable_t
+{
+  /* See init_adler32(). */
+  apr_uint32_t (*init_adler32)(const char *data);
+
+  /* See svn_cstring__match_length(). */
+  apr_size_t (*match_length)(const char *a,
+                             const char *b,
+                             apr_size_t max_len);
+
+  /* See skip_no_match(). */
+  apr_size_t (*skip_no_match)(const struct blocks *blocks,
+                              apr_uint32_t *rolling_p,
+                              const char *b,
+                              apr_size_t lo,
+                              apr_size_t upper);
+} xdelta_vtable_t;
+
+static const xdelta_vtable_t scalar_vtable =
+{
+  init_adler32,
+  svn_cstring__match_length,
+  skip_no_match
+};
+
+#ifdef XDELTA_X86_SIMD
+
+static const xdelta_vtable_t sse42_vtable =
+{
+  init_adler32_sse42,
+  match_length_sse42,
+  skip_no_match
+};
+
+static const xdelta_vtable_t avx2_vtable =
+{
+  init_adler32_avx2,
+  match_length_avx2,
+  skip_no_match_avx2
+};
+
+/* The best implementation supported by the CPU.  Set by select_vtable(). */
+static const xdelta_vtable_t *cpu_vtable = &scalar_vtable;
+
+/* Initialization state of CPU_VTABLE as used by svn_atomic__init_once. */
+static volatile svn_atomic_t cpu_vtable_initialized = 0;
+
+/* Implements svn_atomic__str_init_func_t.
+   Set CPU_VTABLE according to the instruction sets available. */
+static const char *
+select_vtable(void *baton)
+{
+#ifdef _MSC_VER
+  int info[4];
+
+  __cpuid(info, 0);
+  if (info[0] >= 7)
+    {
+      /* AVX2 also requires the OS to preserve the YMM registers. */
+      __cpuid(info, 1);
+      if ((info[2] & (1 << 27)) && (info[2] & (1 << 28))
+          && (_xgetbv(0) & 6) == 6)
+        {
+          __cpuidex(info, 7, 0);
+          if (info[1] & (1 << 5))
+            {
+              cpu_vtable = &avx2_vtable;
+              return NULL;
+            }
+        }
+
+      __cpuid(info, 1);
+      if (info[2] & (1 << 20))
+        cpu_vtable = &sse42_vtable;
+    }
+#else
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    cpu_vtable = &avx2_vtable;
+  else if (__builtin_cpu_supports("sse4.2"))
+    cpu_vtable = &sse42_vtable;
+#endif
+
+  return NULL;
+}
+
+#endif /* XDELTA_X86_SIMD */
+
+/* If not set, always use SCALAR_VTABLE. */
+static svn_boolean_t simd_enabled = TRUE;
+
+/* Return the fastest xdelta implementation that we may use. */
+static const xdelta_vtable_t *
+get_vtable(void)
+{
+#ifdef XDELTA_X86_SIMD
+  if (simd_enabled)
+    {
+      svn_atomic__init_once_no_error(&cpu_vtable_initialized, select_vtable,
+                                     NULL);
+      return cpu_vtable;
+    }
+#endif
+
+  return &scalar_vtable;
+}
+
+svn_boolean_t
+svn_txdelta__enable_simd(svn_boolean_t enable)
+{
+  simd_enabled = enable;
+  return get_vtable() != &scalar_vtable;
+}
+
 /* Insert a block with the checksum ADLERSUM at position POS in the source
    data into the table BLOCKS.  Ignore true duplicates, i.e. blocks with
    actually the same content. */
@@ -206,9 +614,11 @@ find_block(const struct blocks *blocks,
 
 /* Initialize the matches table from DATA of size DATALEN.  This goes
    through every block of MATCH_BLOCKSIZE bytes in the source and
-   checksums it, inserting the result into the BLOCKS table.  */
+   checksums it, inserting the result into the BLOCKS table.  Use the
+   implementation given by VTABLE. */
 static void
-init_blocks_table(const char *data,
+init_blocks_table(const xdelta_vtable_t *vtable,
+                  const char *data,
                   apr_size_t datalen,
                   struct blocks *blocks,
                   apr_pool_t *pool)
@@ -254,7 +664,7 @@ init_blocks_table(const char *data,
      not use that shorter block for deltification (only indirectly
      as an extension of some previous block). */
   for (i = 0; i + MATCH_BLOCKSIZE <= datalen; i += MATCH_BLOCKSIZE)
-    add_block(blocks, init_adler32(data + i), i);
+    add_block(blocks, vtable->init_adler32(data + i), i);
 }
 
 /* Try to find a match for the target data B in BLOCKS, and then
@@ -264,10 +674,11 @@ init_blocks_table(const char *data,
    position within B given in BPOSP. PENDING_INSERT_START sets the
    lower limit to BPOSP.
    Return number of matching bytes starting at ASOP.  Return 0 if
-   no match has been found.
+   no match has been found.  Use the implementation given by VTABLE.
  */
 static apr_size_t
-find_match(const struct blocks *blocks,
+find_match(const xdelta_vtable_t *vtable,
+           const struct blocks *blocks,
            const apr_uint32_t rolling,
            const char *a,
            apr_size_t asize,
@@ -290,9 +701,9 @@ find_match(const struct blocks *blocks,
   max_delta = asize - apos - MATCH_BLOCKSIZE < bsize - bpos - MATCH_BLOCKSIZE
             ? asize - apos - MATCH_BLOCKSIZE
             : bsize - bpos - MATCH_BLOCKSIZE;
-  delta = svn_cstring__match_length(a + apos + MATCH_BLOCKSIZE,
-                                    b + bpos + MATCH_BLOCKSIZE,
-                                    max_delta);
+  delta = vtable->match_length(a + apos + MATCH_BLOCKSIZE,
+                               b + bpos + MATCH_BLOCKSIZE,
+                               max_delta);
 
   /* See if we can extend backwards (max MATCH_BLOCKSIZE-1 steps because A's
      content has been sampled only every MATCH_BLOCKSIZE positions).  */
@@ -375,6 +786,7 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
               apr_size_t bsize,
               apr_pool_t *pool)
 {
+  const xdelta_vtable_t *vtable = get_vtable();
   struct blocks blocks;
   apr_uint32_t rolling;
   apr_size_t lo = 0, pending_insert_start = 0, upper;
@@ -382,7 +794,7 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
   /* Optimization: directly compare window starts. If more than 4
    * bytes match, we can immediately create a matching windows.
    * Shorter sequences result in a net data increase. */
-  lo = svn_cstring__match_length(a, b, asize > bsize ? bsize : asize);
+  lo = vtable->match_length(a, b, asize > bsize ? bsize : asize);
   if ((lo > 4) || (lo == bsize))
     {
       svn_txdelta__insert_op(build_baton, svn_txdelta_source,
@@ -403,10 +815,10 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
   upper = bsize - MATCH_BLOCKSIZE; /* this is now known to be >= LO */
 
   /* Initialize the matches table.  */
-  init_blocks_table(a, asize, &blocks, pool);
+  init_blocks_table(vtable, a, asize, &blocks, pool);
 
   /* Initialize our rolling checksum.  */
-  rolling = init_adler32(b + lo);
+  rolling = vtable->init_adler32(b + lo);
   while (lo < upper)
     {
       apr_size_t matchlen;
@@ -414,17 +826,12 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
 
       /* Quickly skip positions whose respective ROLLING checksums
          definitely do not match any SLOT in BLOCKS. */
-      while (!(blocks.flags[hash_flags(rolling)] & (1 << (rolling & 7)))
-             && lo < upper)
-        {
-          rolling = adler32_replace(rolling, b[lo], b[lo+MATCH_BLOCKSIZE]);
-          lo++;
-        }
+      lo = vtable->skip_no_match(&blocks, &rolling, b, lo, upper);
 
       /* LO is still <= UPPER, i.e. the following lookup is legal:
          Closely check whether we've got a match for the current location.
          Due to the above pre-filter, chances are that we find one. */
-      matchlen = find_match(&blocks, rolling, a, asize, b, bsize,
+      matchlen = find_match(vtable, &blocks, rolling, a, asize, b, bsize,
                             &lo, &apos, pending_insert_start);
 
       /* If we didn't find a real match, insert the byte at the target
@@ -471,7 +878,7 @@ compute_delta(svn_txdelta__ops_baton_t *build_baton,
            * Ignore short buffers at the end of B.
            */
           if (lo + MATCH_BLOCKSIZE <= bsize)
-            rolling = init_adler32(b + lo);
+            rolling = vtable->init_adler32(b + lo);
         }
     }
 
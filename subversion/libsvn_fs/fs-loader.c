@@ -521,6 +521,15 @@ svn_fs_set_warning_func(svn_fs_t *fs, svn_fs_warning_callback_t warning,
   fs->warning_baton = warning_baton;
 }
 
+void
+svn_fs__get_warning_func(svn_fs_warning_callback_t *warning,
+                         void **warning_baton,
+                         svn_fs_t *fs)
+{
+  *warning = fs->warning;
+  *warning_baton = fs->warning_baton;
+}
+
 svn_error_t *
 svn_fs_create2(svn_fs_t **fs_p,
                const char *path,
@@ -1475,6 +1484,18 @@ svn_fs_dir_optimal_order(apr_array_header_t **ordered_p,
                                                          scratch_pool));
 }
 
+svn_error_t *
+svn_fs__prefetch_file_contents(svn_fs_root_t *root,
+                               const apr_array_header_t *paths,
+                               apr_pool_t *scratch_pool)
+{
+  if (root->vtable->prefetch_file_contents == NULL || paths->nelts == 0)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(root->vtable->prefetch_file_contents(root, paths,
+                                                              scratch_pool));
+}
+
 svn_error_t *
 svn_fs_make_dir(svn_fs_root_t *root, const char *path, apr_pool_t *pool)
 {
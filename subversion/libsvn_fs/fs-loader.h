@@ -440,6 +440,11 @@ typedef struct root_vtable_t
                                 svn_fs_mergeinfo_receiver_t receiver,
                                 void *baton,
                                 apr_pool_t *scratch_pool);
+
+  /* Prefetching.  NULL if not supported by the backend. */
+  svn_error_t *(*prefetch_file_contents)(svn_fs_root_t *root,
+                                         const apr_array_header_t *paths,
+                                         apr_pool_t *scratch_pool);
 } root_vtable_t;
 
 
@@ -90,8 +90,9 @@ dbg_log_access(svn_fs_t *fs,
   apr_off_t offset;
   svn_fs_fs__revision_file_t *rev_file;
 
-  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, revision,
-                                           scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file_mapped(&rev_file, fs, revision,
+                                                  scratch_pool,
+                                                  scratch_pool));
 
   /* determine rev / pack file offset */
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, revision, NULL,
@@ -193,19 +194,17 @@ dbg_log_access(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-/* Convenience wrapper around svn_io_file_aligned_seek, taking filesystem
-   FS instead of a block size. */
+/* Convenience wrapper around svn_fs_fs__rev_file_seek, taking filesystem
+   FS for symmetry with the other accessors.  FS is currently unused. */
 static svn_error_t *
 aligned_seek(svn_fs_t *fs,
-             apr_file_t *file,
+             svn_fs_fs__revision_file_t *file,
              apr_off_t *buffer_start,
              apr_off_t offset,
              apr_pool_t *pool)
 {
-  fs_fs_data_t *ffd = fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(file, ffd->block_size,
-                                                  buffer_start, offset,
-                                                  pool));
+  return svn_error_trace(svn_fs_fs__rev_file_seek(file, buffer_start,
+                                                  offset, pool));
 }
 
 /* Open the revision file for revision REV in filesystem FS and store
@@ -223,11 +222,12 @@ open_and_seek_revision(svn_fs_fs__revision_file_t **file,
 
   SVN_ERR(svn_fs_fs__ensure_revision_exists(rev, fs, pool));
 
-  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, rev, pool, pool));
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file_mapped(&rev_file, fs, rev,
+                                                  pool, pool));
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rev, NULL, item,
                                  pool));
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(aligned_seek(fs, rev_file, NULL, offset, pool));
 
   *file = rev_file;
 
@@ -249,7 +249,7 @@ open_and_seek_transaction(svn_fs_fs__revision_file_t **file,
 
   SVN_ERR(svn_fs_fs__item_offset(&offset, fs, NULL, SVN_INVALID_REVNUM,
                                  &rep->txn_id, rep->item_index, pool));
-  SVN_ERR(aligned_seek(fs, (*file)->file, NULL, offset, pool));
+  SVN_ERR(aligned_seek(fs, *file, NULL, offset, pool));
 
   return SVN_NO_ERROR;
 }
@@ -547,7 +547,7 @@ get_fs_id_at_offset(svn_fs_id_t **id_p,
 {
   node_revision_t *noderev;
 
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  SVN_ERR(aligned_seek(fs, rev_file, NULL, offset, pool));
   SVN_ERR(svn_fs_fs__read_noderev(&noderev,
                                   rev_file->stream,
                                   pool, pool));
@@ -581,7 +581,6 @@ get_root_changes_offset(apr_off_t *root_offset,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   apr_off_t rev_offset;
-  apr_seek_where_t seek_relative;
   svn_stringbuf_t *trailer;
   char buffer[64];
   apr_off_t start;
@@ -598,15 +597,9 @@ get_root_changes_offset(apr_off_t *root_offset,
      just seek to the end of the pack file -- just like we do in the
      non-packed case. */
   if (rev_file->is_packed && ((rev + 1) % ffd->max_files_per_dir != 0))
-    {
-      SVN_ERR(svn_fs_fs__get_packed_offset(&end, fs, rev + 1, pool));
-      seek_relative = APR_SET;
-    }
+    SVN_ERR(svn_fs_fs__get_packed_offset(&end, fs, rev + 1, pool));
   else
-    {
-      seek_relative = APR_END;
-      end = 0;
-    }
+    SVN_ERR(svn_fs_fs__rev_file_size(&end, rev_file, pool));
 
   /* Offset of the revision from the start of the pack file, if applicable. */
   if (rev_file->is_packed)
@@ -616,8 +609,6 @@ get_root_changes_offset(apr_off_t *root_offset,
 
   /* We will assume that the last line containing the two offsets
      will never be longer than 64 characters. */
-  SVN_ERR(svn_io_file_seek(rev_file->file, seek_relative, &end, pool));
-
   if (end < sizeof(buffer))
     {
       len = (apr_size_t)end;
@@ -630,9 +621,8 @@ get_root_changes_offset(apr_off_t *root_offset,
     }
 
   /* Read in this last block, from which we will identify the last line. */
-  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, start, pool));
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, buffer, len, NULL, NULL,
-                                 pool));
+  SVN_ERR(aligned_seek(fs, rev_file, NULL, start, pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, len, pool));
 
   /* Parse the last line. */
   trailer = svn_stringbuf_ncreate(buffer, len, pool);
@@ -676,8 +666,9 @@ svn_fs_fs__rev_get_root(svn_fs_id_t **root_id_p,
       if (is_cached)
         return SVN_NO_ERROR;
 
-      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&revision_file, fs, rev,
-                                               scratch_pool, scratch_pool));
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file_mapped(&revision_file, fs,
+                                                      rev, scratch_pool,
+                                                      scratch_pool));
       SVN_ERR(get_root_changes_offset(&root_offset, NULL,
                                       revision_file, fs, rev,
                                       scratch_pool));
@@ -746,27 +737,25 @@ typedef struct rep_state_t
   int chunk_index;  /* number of the window to read */
 } rep_state_t;
 
-/* Simple wrapper around svn_io_file_get_offset to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_offset to simplify callers. */
 static svn_error_t *
 get_file_offset(apr_off_t *offset,
                 rep_state_t *rs,
                 apr_pool_t *pool)
 {
-  return svn_error_trace(svn_io_file_get_offset(offset,
-                                                rs->sfile->rfile->file,
-                                                pool));
+  return svn_error_trace(svn_fs_fs__rev_file_offset(offset,
+                                                    rs->sfile->rfile,
+                                                    pool));
 }
 
-/* Simple wrapper around svn_io_file_aligned_seek to simplify callers. */
+/* Simple wrapper around svn_fs_fs__rev_file_seek to simplify callers. */
 static svn_error_t *
 rs_aligned_seek(rep_state_t *rs,
                 apr_off_t *buffer_start,
                 apr_off_t offset,
                 apr_pool_t *pool)
 {
-  fs_fs_data_t *ffd = rs->sfile->fs->fsap_data;
-  return svn_error_trace(svn_io_file_aligned_seek(rs->sfile->rfile->file,
-                                                  ffd->block_size,
+  return svn_error_trace(svn_fs_fs__rev_file_seek(rs->sfile->rfile,
                                                   buffer_start, offset,
                                                   pool));
 }
@@ -776,9 +765,10 @@ static svn_error_t*
 auto_open_shared_file(shared_file_t *file)
 {
   if (file->rfile == NULL)
-    SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&file->rfile, file->fs,
-                                             file->revision, file->pool,
-                                             file->pool));
+    SVN_ERR(svn_fs_fs__open_pack_or_rev_file_mapped(&file->rfile, file->fs,
+                                                    file->revision,
+                                                    file->pool,
+                                                    file->pool));
 
   return SVN_NO_ERROR;
 }
@@ -809,8 +799,8 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
     {
       char buf[4];
       SVN_ERR(rs_aligned_seek(rs, NULL, rs->start, pool));
-      SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                     sizeof(buf), NULL, NULL, pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf, sizeof(buf),
+                                       pool));
 
       /* ### Layering violation */
       if (! ((buf[0] == 'S') && (buf[1] == 'V') && (buf[2] == 'N')))
@@ -845,7 +835,7 @@ create_rep_state_body(rep_state_t **rep_state,
   /* If the hint is
    * - given,
    * - refers to a valid revision,
-   * - refers to a packed revision,
+   * - refers to a packed or stage-packed revision,
    * - as does the rep we want to read, and
    * - refers to the same pack file as the rep
    * we can re-use the same, already open file object
@@ -853,10 +843,10 @@ create_rep_state_body(rep_state_t **rep_state,
   svn_boolean_t reuse_shared_file
     =    shared_file && *shared_file && (*shared_file)->rfile
       && SVN_IS_VALID_REVNUM((*shared_file)->revision)
-      && (*shared_file)->revision < ffd->min_unpacked_rev
-      && rep->revision < ffd->min_unpacked_rev
-      && (   ((*shared_file)->revision / ffd->max_files_per_dir)
-          == (rep->revision / ffd->max_files_per_dir));
+      && (   rep->revision < ffd->min_unpacked_rev
+          || svn_fs_fs__is_stage_packed_rev(fs, rep->revision))
+      && (   svn_fs_fs__packed_base_rev(fs, (*shared_file)->revision)
+          == svn_fs_fs__packed_base_rev(fs, rep->revision));
 
   pair_cache_key_t key;
   key.revision = rep->revision;
@@ -1041,8 +1031,10 @@ svn_fs_fs__check_rep(representation_t *rep,
         rev_file = *(svn_fs_fs__revision_file_t **)hint;
 
       if (rev_file == NULL || rev_file->start_revision != start_rev)
-        SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, rep->revision,
-                                                 scratch_pool, scratch_pool));
+        SVN_ERR(svn_fs_fs__open_pack_or_rev_file_mapped(&rev_file, fs,
+                                                        rep->revision,
+                                                        scratch_pool,
+                                                        scratch_pool));
 
       if (hint)
         *hint = rev_file;
@@ -1602,8 +1594,22 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   while (rs->chunk_index < this_chunk)
     {
       svn_pool_clear(iterpool);
-      SVN_ERR(svn_txdelta_skip_svndiff_window(rs->sfile->rfile->file,
-                                              rs->ver, iterpool));
+      if (rs->sfile->rfile->mmap)
+        {
+          /* Mapped files have no meaningful APR file pointer.
+           * Parse the window header from the stream instead. */
+          apr_size_t window_len;
+          SVN_ERR(svn_txdelta__read_raw_window_len(&window_len,
+                                                   rs->sfile->rfile->stream,
+                                                   iterpool));
+          SVN_ERR(rs_aligned_seek(rs, NULL, start_offset + window_len,
+                                  iterpool));
+        }
+      else
+        {
+          SVN_ERR(svn_txdelta_skip_svndiff_window(rs->sfile->rfile->file,
+                                                  rs->ver, iterpool));
+        }
       rs->chunk_index++;
       SVN_ERR(get_file_offset(&start_offset, rs, iterpool));
       rs->current = start_offset - rs->start;
@@ -1651,8 +1657,8 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
 
   /* Read the plain data. */
   *nwin = svn_stringbuf_create_ensure(size, result_pool);
-  SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, (*nwin)->data, size,
-                                 NULL, NULL, result_pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, (*nwin)->data, size,
+                                   result_pool));
   (*nwin)->data[size] = 0;
 
   /* Update RS. */
@@ -1840,8 +1846,8 @@ get_contents_from_windows(struct rep_read_baton *rb,
 
           offset = rs->start + rs->current;
           SVN_ERR(rs_aligned_seek(rs, NULL, offset, rb->pool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, cur,
-                                         copy_len, NULL, NULL, rb->pool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, cur, copy_len,
+                                           rb->pool));
         }
 
       rs->current += copy_len;
@@ -2210,6 +2216,181 @@ rep_read_contents(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* PLAIN file representations of at least this many bytes will be read
+   directly from the rev / pack file, bypassing all caches. */
+#define PLAIN_FILE_STREAM_THRESHOLD 0x100000
+
+/* Baton type for plain_read_contents(). */
+typedef struct plain_read_baton_t
+{
+  /* The range of the rev / pack file containing the PLAIN rep. */
+  svn_stream_t *range_stream;
+
+  /* Checksums over the data read so far.  SHA1_CTX is NULL if the rep
+     does not provide a SHA1 checksum. */
+  svn_checksum_ctx_t *md5_ctx;
+  svn_checksum_ctx_t *sha1_ctx;
+
+  /* The expected checksums. */
+  svn_checksum_t md5_expected;
+  svn_checksum_t sha1_expected;
+
+  /* Number of bytes expected but not read yet. */
+  svn_filesize_t remaining;
+
+  /* Set once the checksums have been compared. */
+  svn_boolean_t checked;
+
+  apr_pool_t *pool;
+} plain_read_baton_t;
+
+/* Return an error if the data read through PB does not match the expected
+   length and checksums. */
+static svn_error_t *
+plain_read_verify(plain_read_baton_t *pb)
+{
+  svn_checksum_t *md5_actual, *sha1_actual;
+
+  pb->checked = TRUE;
+  if (pb->remaining != 0)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Length mismatch while reading "
+                              "representation"));
+
+  SVN_ERR(svn_checksum_final(&md5_actual, pb->md5_ctx, pb->pool));
+  if (!svn_checksum_match(md5_actual, &pb->md5_expected))
+    return svn_error_create(SVN_ERR_FS_CORRUPT,
+             svn_checksum_mismatch_err(&pb->md5_expected, md5_actual,
+               pb->pool,
+               _("Checksum mismatch while reading representation")),
+             NULL);
+
+  if (pb->sha1_ctx)
+    {
+      SVN_ERR(svn_checksum_final(&sha1_actual, pb->sha1_ctx, pb->pool));
+      if (!svn_checksum_match(sha1_actual, &pb->sha1_expected))
+        return svn_error_create(SVN_ERR_FS_CORRUPT,
+                 svn_checksum_mismatch_err(&pb->sha1_expected, sha1_actual,
+                   pb->pool,
+                   _("Checksum mismatch while reading representation")),
+                 NULL);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* BATON is of type `plain_read_baton_t'; read the next *LEN bytes of the
+   PLAIN rep and store them in *BUF.  Sum as we read and verify the
+   checksums at the end, just like rep_read_contents() does. */
+static svn_error_t *
+plain_read_contents(void *baton,
+                    char *buf,
+                    apr_size_t *len)
+{
+  plain_read_baton_t *pb = baton;
+  apr_size_t requested = *len;
+
+  SVN_ERR(svn_stream_read_full(pb->range_stream, buf, len));
+  if (pb->checked)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_checksum_update(pb->md5_ctx, buf, *len));
+  if (pb->sha1_ctx)
+    SVN_ERR(svn_checksum_update(pb->sha1_ctx, buf, *len));
+  pb->remaining -= *len;
+
+  /* Check as soon as we reached either end of the data. */
+  if (pb->remaining <= 0 || *len < requested)
+    SVN_ERR(plain_read_verify(pb));
+
+  return SVN_NO_ERROR;
+}
+
+/* BATON is of type `plain_read_baton_t'; close the underlying file. */
+static svn_error_t *
+plain_read_contents_close(void *baton)
+{
+  plain_read_baton_t *pb = baton;
+
+  return svn_error_trace(svn_stream_close(pb->range_stream));
+}
+
+/* If REP in FS is a committed PLAIN representation of at least
+   PLAIN_FILE_STREAM_THRESHOLD bytes, set *CONTENTS_P to a stream over
+   its contents within the rev / pack file.  Otherwise, set it to NULL.
+   Reading from the stream verifies the checksums of the data.  The
+   range of the file remains accessible via svn_stream__aprfile() and
+   svn_stream__aprfile_end(), in which case the caller is responsible
+   for the checks.  Allocate *CONTENTS_P in RESULT_POOL and use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_plain_file_stream(svn_stream_t **contents_p,
+                      svn_fs_t *fs,
+                      representation_t *rep,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__rep_header_t *rep_header;
+  plain_read_baton_t *pb;
+  apr_off_t offset;
+
+  *contents_p = NULL;
+
+  /* PLAIN reps are never compressed, so their size must match the
+     fulltext size. */
+  if (   svn_fs_fs__id_txn_used(&rep->txn_id)
+      || !SVN_IS_VALID_REVNUM(rep->revision)
+      || rep->size != rep->expanded_size
+      || rep->expanded_size < PLAIN_FILE_STREAM_THRESHOLD)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__ensure_revision_exists(rep->revision, fs,
+                                            scratch_pool));
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, rep->revision,
+                                           result_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rep->revision,
+                                 NULL, rep->item_index, scratch_pool));
+  SVN_ERR(aligned_seek(fs, rev_file, NULL, offset, scratch_pool));
+  SVN_ERR(svn_fs_fs__read_rep_header(&rep_header, rev_file->stream,
+                                     scratch_pool, scratch_pool));
+
+  if (rep_header->type != svn_fs_fs__rep_plain)
+    return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+
+  /* The range stream takes ownership of the file. */
+  pb = apr_pcalloc(result_pool, sizeof(*pb));
+  offset += rep_header->header_size;
+  SVN_ERR(svn_stream__from_aprfile_range(&pb->range_stream, rev_file->file,
+                                         offset, offset + rep->size,
+                                         FALSE, result_pool,
+                                         scratch_pool));
+
+  pb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, result_pool);
+  pb->md5_expected.kind = svn_checksum_md5;
+  pb->md5_expected.digest = rep->md5_digest;
+  if (rep->has_sha1)
+    {
+      pb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1,
+                                             result_pool);
+      pb->sha1_expected.kind = svn_checksum_sha1;
+      pb->sha1_expected.digest = rep->sha1_digest;
+    }
+  pb->remaining = rep->expanded_size;
+  pb->pool = result_pool;
+
+  *contents_p = svn_stream_create(pb, result_pool);
+  svn_stream_set_read2(*contents_p, NULL /* only full read support */,
+                       plain_read_contents);
+  svn_stream_set_close(*contents_p, plain_read_contents_close);
+
+  /* Allow the server layers to send the data directly from disk. */
+  svn_stream__set_aprfile(*contents_p, rev_file->file,
+                          offset + rep->size);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__get_contents(svn_stream_t **contents_p,
                         svn_fs_t *fs,
@@ -2230,6 +2411,11 @@ svn_fs_fs__get_contents(svn_stream_t **contents_p,
       fulltext_cache_key.revision = rep->revision;
       fulltext_cache_key.second = rep->item_index;
 
+      /* Large PLAIN reps can be sent directly from disk. */
+      SVN_ERR(get_plain_file_stream(contents_p, fs, rep, pool, pool));
+      if (*contents_p)
+        return SVN_NO_ERROR;
+
       /* Initialize the reader baton.  Some members may added lazily
        * while reading from the stream */
       SVN_ERR(rep_read_get_baton(&rb, fs, rep, fulltext_cache_key, pool));
@@ -2294,9 +2480,10 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
   rs->sfile->rfile->start_revision = SVN_INVALID_REVNUM;
   rs->sfile->rfile->file = file;
   rs->sfile->rfile->stream = svn_stream_from_aprfile2(file, TRUE, pool);
+  rs->sfile->rfile->block_size = ((fs_fs_data_t *)fs->fsap_data)->block_size;
 
   /* Read the rep header. */
-  SVN_ERR(aligned_seek(fs, file, NULL, offset, pool));
+  SVN_ERR(aligned_seek(fs, rs->sfile->rfile, NULL, offset, pool));
   SVN_ERR(svn_fs_fs__read_rep_header(&rh, rs->sfile->rfile->stream,
                                      pool, pool));
   SVN_ERR(get_file_offset(&rs->start, rs, pool));
@@ -3092,11 +3279,9 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
           SVN_ERR(svn_fs_fs__ensure_revision_exists(context->revision,
                                                     context->fs,
                                                     scratch_pool));
-          SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&context->revision_file,
-                                                   context->fs,
-                                                   context->revision,
-                                                   context->rev_file_pool,
-                                                   scratch_pool));
+          SVN_ERR(svn_fs_fs__open_pack_or_rev_file_mapped(
+                    &context->revision_file, context->fs, context->revision,
+                    context->rev_file_pool, scratch_pool));
         }
 
       if (use_block_read(context->fs))
@@ -3142,7 +3327,7 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
             }
 
           /* Actual reading and parsing are the same, though. */
-          SVN_ERR(aligned_seek(context->fs, context->revision_file->file,
+          SVN_ERR(aligned_seek(context->fs, context->revision_file,
                                NULL, changes_offset + context->next_offset,
                                scratch_pool));
 
@@ -3153,9 +3338,9 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
 
           /* Construct the info object for the entries block we just read. */
           changes_list = apr_pcalloc(scratch_pool, sizeof(*changes_list));
-          SVN_ERR(svn_io_file_get_offset(&changes_list->end_offset,
-                                         context->revision_file->file,
-                                         scratch_pool));
+          SVN_ERR(svn_fs_fs__rev_file_offset(&changes_list->end_offset,
+                                             context->revision_file,
+                                             scratch_pool));
           changes_list->end_offset -= changes_offset;
           changes_list->start_offset = context->next_offset;
           changes_list->count = (*changes)->nelts;
@@ -3338,8 +3523,8 @@ cache_windows(svn_fs_t *fs,
           /* Read the raw window. */
           buf = apr_palloc(iterpool, window_len + 1);
           SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                         window_len, NULL, NULL, iterpool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf,
+                                           window_len, iterpool));
           buf[window_len] = 0;
 
           /* update relative offset in representation */
@@ -3415,12 +3600,12 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
       /* for larger reps, the header may have crossed a block boundary.
        * make sure we still read blocks properly aligned, i.e. don't use
        * plain seek here. */
-      SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, scratch_pool));
+      SVN_ERR(aligned_seek(fs, rev_file, NULL, offset, scratch_pool));
 
       plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
-                                     rs.size, &plaintext->len, NULL,
-                                     result_pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, plaintext->data,
+                                       rs.size, result_pool));
+      plaintext->len = rs.size;
       plaintext->data[plaintext->len] = 0;
       rs.current += rs.size;
 
@@ -3510,16 +3695,18 @@ read_item(svn_stream_t **stream,
   apr_uint32_t digest;
   svn_checksum_t *expected, *actual;
   apr_uint32_t plain_digest;
+  svn_string_t *text;
 
-  /* Read item into string buffer. */
-  svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
-  text->len = entry->size;
-  text->data[text->len] = 0;
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
-                                 NULL, NULL, pool));
+  /* Get the item contents.  This won't copy data for mapped files.
+   * The item gets parsed before REV_FILE is closed, so that is fine.
+   * TEXT may not be NUL-terminated but string streams and the checksum
+   * only use its length. */
+  SVN_ERR(svn_fs_fs__rev_file_read_string(&text, rev_file,
+                                          (apr_size_t)entry->size,
+                                          pool, pool));
 
   /* Return (construct, calculate) stream and checksum. */
-  *stream = svn_stream_from_stringbuf(text, pool);
+  *stream = svn_stream_from_string(text, pool);
   digest = svn__fnv1a_32x4(text->data, text->len);
 
   /* Checksums will match most of the time. */
@@ -3718,7 +3905,7 @@ block_read(void **result,
                                           ffd->block_size, scratch_pool,
                                           scratch_pool));
 
-      SVN_ERR(aligned_seek(fs, revision_file->file, &block_start, offset,
+      SVN_ERR(aligned_seek(fs, revision_file, &block_start, offset,
                            iterpool));
 
       /* read all items from the block */
@@ -3751,8 +3938,8 @@ block_read(void **result,
                             && entry->size < ffd->block_size))
             {
               void *item = NULL;
-              SVN_ERR(svn_io_file_seek(revision_file->file, APR_SET,
-                                       &entry->offset, iterpool));
+              SVN_ERR(svn_fs_fs__rev_file_seek(revision_file, NULL,
+                                               entry->offset, iterpool));
               switch (entry->type)
                 {
                   case SVN_FS_FS__ITEM_TYPE_FILE_REP:
@@ -3804,3 +3991,191 @@ block_read(void **result,
 
   return SVN_NO_ERROR;
 }
+
+/* A representation to prefetch along with where to find it. */
+typedef struct prefetch_rep_t
+{
+  /* The representation to read ahead. */
+  representation_t *rep;
+
+  /* The open rev / pack file containing REP. */
+  svn_fs_fs__revision_file_t *rev_file;
+
+  /* Offset of REP's header within REV_FILE. */
+  apr_off_t offset;
+} prefetch_rep_t;
+
+/* Set *REV_FILE to the rev / pack file containing REVISION in FS.
+ * FILES maps the first revision of each file (svn_revnum_t) opened so
+ * far to that file, so that every file gets opened only once.  Open new
+ * files in FILES' pool and use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+get_prefetch_file(svn_fs_fs__revision_file_t **rev_file,
+                  svn_fs_t *fs,
+                  apr_hash_t *files,
+                  svn_revnum_t revision,
+                  apr_pool_t *scratch_pool)
+{
+  apr_pool_t *result_pool = apr_hash_pool_get(files);
+  svn_revnum_t *base_rev = apr_palloc(result_pool, sizeof(*base_rev));
+
+  *base_rev = svn_fs_fs__packed_base_rev(fs, revision);
+  *rev_file = apr_hash_get(files, base_rev, sizeof(*base_rev));
+  if (*rev_file)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(rev_file, fs, revision,
+                                           result_pool, scratch_pool));
+  apr_hash_set(files, base_rev, sizeof(*base_rev), *rev_file);
+
+  return SVN_NO_ERROR;
+}
+
+/* Append the base representation that REP_HEADER refers to, if any, to
+ * the array of representation_t * in NEXT.  Allocate it in NEXT's pool. */
+static void
+add_prefetch_base(apr_array_header_t *next,
+                  const svn_fs_fs__rep_header_t *rep_header)
+{
+  representation_t *base;
+
+  if (rep_header->type != svn_fs_fs__rep_delta)
+    return;
+
+  base = apr_pcalloc(next->pool, sizeof(*base));
+  base->revision = rep_header->base_revision;
+  base->item_index = rep_header->base_item_index;
+  base->size = rep_header->base_length;
+  svn_fs_fs__id_txn_reset(&base->txn_id);
+
+  APR_ARRAY_PUSH(next, representation_t *) = base;
+}
+
+svn_error_t *
+svn_fs_fs__prefetch_contents(svn_fs_t *fs,
+                             const apr_array_header_t *reps,
+                             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_hash_t *seen, *files;
+  apr_hash_index_t *hi;
+  apr_array_header_t *level;
+  apr_pool_t *iterpool;
+  int i;
+
+  if (!ffd->prefetch_file_contents)
+    return SVN_NO_ERROR;
+
+  seen = apr_hash_make(scratch_pool);
+  files = apr_hash_make(scratch_pool);
+  level = apr_array_make(scratch_pool, reps->nelts,
+                         sizeof(representation_t *));
+  iterpool = svn_pool_create(scratch_pool);
+
+  /* Fulltexts that are cached already don't need their delta chains. */
+  for (i = 0; i < reps->nelts; ++i)
+    {
+      representation_t *rep = APR_ARRAY_IDX(reps, i, representation_t *);
+      svn_boolean_t is_cached = FALSE;
+
+      if (!rep || svn_fs_fs__id_txn_used(&rep->txn_id))
+        continue;
+
+      if (ffd->fulltext_cache)
+        {
+          pair_cache_key_t key;
+          key.revision = rep->revision;
+          key.second = rep->item_index;
+
+          SVN_ERR(svn_cache__has_key(&is_cached, ffd->fulltext_cache, &key,
+                                     iterpool));
+        }
+
+      if (!is_cached)
+        APR_ARRAY_PUSH(level, representation_t *) = rep;
+    }
+
+  /* Walk all delta chains side by side, one link at a time.  Issue the
+   * read-aheads for all reps of a link before reading any of their
+   * headers.  That way, the OS may fetch them in whatever order suits
+   * the disk best while we only wait for the first one. */
+  while (level->nelts)
+    {
+      apr_array_header_t *pending
+        = apr_array_make(iterpool, level->nelts, sizeof(prefetch_rep_t));
+      apr_array_header_t *next
+        = apr_array_make(scratch_pool, level->nelts,
+                         sizeof(representation_t *));
+
+      for (i = 0; i < level->nelts; ++i)
+        {
+          representation_t *rep = APR_ARRAY_IDX(level, i,
+                                                representation_t *);
+          pair_cache_key_t *key = apr_palloc(scratch_pool, sizeof(*key));
+          prefetch_rep_t *entry;
+
+          /* Delta chains tend to share their base reps. */
+          key->revision = rep->revision;
+          key->second = rep->item_index;
+          if (apr_hash_get(seen, key, sizeof(*key)))
+            continue;
+          apr_hash_set(seen, key, sizeof(*key), key);
+
+          /* On a warm server, the chain can be followed without any I/O.
+           * The data itself is then likely to be cached as well. */
+          if (ffd->rep_header_cache)
+            {
+              svn_fs_fs__rep_header_t *rep_header;
+              svn_boolean_t is_cached;
+
+              SVN_ERR(svn_cache__get((void **)&rep_header, &is_cached,
+                                     ffd->rep_header_cache, key, iterpool));
+              if (is_cached)
+                {
+                  add_prefetch_base(next, rep_header);
+                  continue;
+                }
+            }
+
+          entry = apr_array_push(pending);
+          entry->rep = rep;
+          SVN_ERR(get_prefetch_file(&entry->rev_file, fs, files,
+                                    rep->revision, iterpool));
+          SVN_ERR(svn_fs_fs__item_offset(&entry->offset, fs,
+                                         entry->rev_file, rep->revision,
+                                         NULL, rep->item_index, iterpool));
+
+          /* The rep header precedes the REP->SIZE bytes of data and is
+           * much shorter than the extra bytes we ask for here. */
+          svn_io__file_readahead(entry->rev_file->file, entry->offset,
+                                 rep->size + 0x100);
+        }
+
+      /* Reading the headers puts them into the rep header cache. */
+      for (i = 0; i < pending->nelts; ++i)
+        {
+          prefetch_rep_t *entry = &APR_ARRAY_IDX(pending, i, prefetch_rep_t);
+          svn_fs_fs__rep_header_t *rep_header;
+          pair_cache_key_t key;
+
+          key.revision = entry->rep->revision;
+          key.second = entry->rep->item_index;
+
+          SVN_ERR(aligned_seek(fs, entry->rev_file, NULL, entry->offset,
+                               iterpool));
+          SVN_ERR(read_rep_header(&rep_header, fs, entry->rev_file->stream,
+                                  &key, iterpool, iterpool));
+          add_prefetch_base(next, rep_header);
+        }
+
+      svn_pool_clear(iterpool);
+      level = next;
+    }
+
+  for (hi = apr_hash_first(iterpool, files); hi; hi = apr_hash_next(hi))
+    SVN_ERR(svn_fs_fs__close_revision_file(apr_hash_this_val(hi)));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
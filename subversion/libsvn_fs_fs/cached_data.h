@@ -84,7 +84,10 @@ svn_fs_fs__rep_chain_length(int *chain_length,
 /* Set *CONTENTS_P to be a readable svn_stream_t that receives the text
    representation REP as seen in filesystem FS.  If CACHE_FULLTEXT is
    not set, bypass fulltext cache lookup for this rep and don't put the
-   reconstructed fulltext into cache.
+   reconstructed fulltext into cache.  For large PLAIN reps,
+   svn_stream__aprfile() returns the rev / pack file, positioned at the
+   start of the contents.  Sending from that file skips the checksum
+   verification that reading from the stream performs.
    Use POOL for allocations. */
 svn_error_t *
 svn_fs_fs__get_contents(svn_stream_t **contents_p,
@@ -93,6 +96,17 @@ svn_fs_fs__get_contents(svn_stream_t **contents_p,
                         svn_boolean_t cache_fulltext,
                         apr_pool_t *pool);
 
+/* Tell the OS to read the delta chains of all representations REPS
+   (representation_t *) in FS into its file cache in the background.
+   Reps that are NULL, not yet committed or have a cached fulltext get
+   skipped.  The rep headers along the chains will be cached.  Do nothing
+   if prefetching has been disabled in FS' configuration.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__prefetch_contents(svn_fs_t *fs,
+                             const apr_array_header_t *reps,
+                             apr_pool_t *scratch_pool);
+
 /* Set *CONTENTS_P to be a readable svn_stream_t that receives the text
    representation REP as seen in filesystem FS.  Read the latest element
    of the delta chain from FILE at offset OFFSET.
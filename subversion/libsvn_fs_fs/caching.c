@@ -30,11 +30,13 @@
 #include "../libsvn_fs/fs-loader.h"
 
 #include "svn_config.h"
+#include "svn_dirent_uri.h"
 #include "svn_cache_config.h"
 
 #include "svn_private_config.h"
 #include "svn_hash.h"
 #include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "private/svn_debug.h"
 #include "private/svn_subr_private.h"
@@ -346,6 +348,105 @@ create_cache(svn_cache__t **cache_p,
   return SVN_NO_ERROR;
 }
 
+/* If both *CACHE_P and STORE are not NULL, replace *CACHE_P with a cache
+ * that keeps a copy of all its contents in the persistent cache file STORE.
+ * SERIALIZER, DESERIALIZER and KLEN must match the values used to create
+ * *CACHE_P.  PREFIX identifies the cache contents in STORE and must be
+ * unique across process restarts.
+ *
+ * Unless NO_HANDLER is true, register an error handler that reports errors
+ * as warnings to the FS warning callback.
+ *
+ * The new cache is allocated in RESULT_POOL.
+ */
+static svn_error_t *
+add_persistent_cache(svn_cache__t **cache_p,
+                     svn_cache__persistent_t *store,
+                     svn_cache__serialize_func_t serializer,
+                     svn_cache__deserialize_func_t deserializer,
+                     apr_ssize_t klen,
+                     const char *prefix,
+                     svn_fs_t *fs,
+                     svn_boolean_t no_handler,
+                     apr_pool_t *result_pool)
+{
+  if (*cache_p == NULL || store == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__create_persistent(cache_p, *cache_p, store,
+                                       serializer, deserializer, klen,
+                                       prefix, result_pool));
+
+  /* Like memcached, the cache file is an optional feature. */
+  SVN_ERR(init_callbacks(*cache_p, fs,
+                         no_handler ? NULL : warn_and_continue_on_cache_errors,
+                         result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *STORE_P to the persistent cache file configured for FS or to NULL,
+ * if there is none.  Report errors as warnings unless NO_HANDLER is true.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+open_persistent_cache(svn_cache__persistent_t **store_p,
+                      svn_fs_t *fs,
+                      svn_boolean_t no_handler,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_uint64_t size = (apr_uint64_t)MAX(ffd->persistent_cache_size, 0)
+                    * 0x100000;
+  svn_error_t *err;
+
+  *store_p = NULL;
+  if (ffd->persistent_cache_path == NULL)
+    return SVN_NO_ERROR;
+
+  err = svn_cache__persistent_open(store_p, ffd->persistent_cache_path,
+                                   size, scratch_pool);
+  if (err && !no_handler)
+    {
+      *store_p = NULL;
+      return svn_error_trace(warn_and_continue_on_cache_errors(err, fs,
+                                                               scratch_pool));
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Set *GENERATION to a string that identifies the on-disk copy of FS.
+ * Unlike the instance ID, it changes when the repository gets replaced by
+ * a copy, e.g. when restoring a backup or hotcopy, because that creates
+ * new files.  Allocate *GENERATION in RESULT_POOL.
+ */
+static svn_error_t *
+get_persistent_generation(const char **generation,
+                          svn_fs_t *fs,
+                          apr_pool_t *result_pool)
+{
+  apr_finfo_t finfo;
+  apr_uint64_t inode;
+  apr_time_t ctime;
+
+  /* The UUID file only gets written when the repository is created,
+   * copied or assigned a new UUID. */
+  SVN_ERR(svn_io_stat(&finfo, svn_dirent_join(fs->path, PATH_UUID,
+                                              result_pool),
+                      APR_FINFO_INODE | APR_FINFO_CTIME | APR_FINFO_MTIME,
+                      result_pool));
+
+  inode = (finfo.valid & APR_FINFO_INODE) ? (apr_uint64_t)finfo.inode : 0;
+  ctime = (finfo.valid & APR_FINFO_CTIME) ? finfo.ctime : 0;
+  *generation = apr_psprintf(result_pool,
+                             "%" APR_UINT64_T_FMT "-%" APR_TIME_T_FMT
+                             "-%" APR_TIME_T_FMT,
+                             inode, ctime, finfo.mtime);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__initialize_caches(svn_fs_t *fs,
                              apr_pool_t *pool)
@@ -356,7 +457,10 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                                    "/", normalize_key_part(fs->path, pool),
                                    ":",
                                    SVN_VA_NULL);
+  const char *persistent_prefix = NULL;
+  const char *generation;
   svn_membuffer_t *membuffer;
+  svn_cache__persistent_t *persistent = NULL;
   svn_boolean_t no_handler = ffd->fail_stop;
   svn_boolean_t cache_txdeltas;
   svn_boolean_t cache_fulltexts;
@@ -377,6 +481,19 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
 
   membuffer = svn_cache__get_global_membuffer_cache();
 
+  /* The persistent cache outlives this process.  Don't fill it with data
+   * that will soon be useless and make sure that stale data from other
+   * repository instances or from before a restore won't be found. */
+  if (!has_namespace)
+    SVN_ERR(open_persistent_cache(&persistent, fs, no_handler, pool));
+
+  if (persistent)
+    {
+      SVN_ERR(get_persistent_generation(&generation, fs, pool));
+      persistent_prefix = apr_pstrcat(pool, prefix, ffd->instance_id, ":",
+                                      generation, ":", SVN_VA_NULL);
+    }
+
   /* General rules for assigning cache priorities:
    *
    * - Data that can be reconstructed from other elements has low prio
@@ -452,6 +569,16 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        fs,
                        no_handler,
                        fs->pool, pool));
+  SVN_ERR(add_persistent_cache(&(ffd->dir_cache),
+                               persistent,
+                               svn_fs_fs__serialize_dir_entries,
+                               svn_fs_fs__deserialize_dir_entries,
+                               sizeof(pair_cache_key_t),
+                               apr_pstrcat(pool, persistent_prefix, "DIR",
+                                           SVN_VA_NULL),
+                               fs,
+                               no_handler,
+                               fs->pool));
 
   /* 8 kBytes per entry (1000 revs / shared, one file offset per rev).
      Covering about 8 pack files gives us an "o.k." hit rate. */
@@ -546,6 +673,15 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+      SVN_ERR(add_persistent_cache(&(ffd->fulltext_cache),
+                                   persistent,
+                                   NULL, NULL,
+                                   sizeof(pair_cache_key_t),
+                                   apr_pstrcat(pool, persistent_prefix,
+                                               "TEXT", SVN_VA_NULL),
+                                   fs,
+                                   no_handler,
+                                   fs->pool));
 
       SVN_ERR(create_cache(&(ffd->mergeinfo_cache),
                            NULL,
@@ -1002,6 +1002,36 @@ svn_fs_fs__dag_get_file_delta_stream(svn_txdelta_stream_t **stream_p,
 }
 
 
+svn_error_t *
+svn_fs_fs__dag_prefetch_contents(const apr_array_header_t *files,
+                                 apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *reps;
+  svn_fs_t *fs = NULL;
+  int i;
+
+  reps = apr_array_make(scratch_pool, files->nelts,
+                        sizeof(representation_t *));
+  for (i = 0; i < files->nelts; ++i)
+    {
+      dag_node_t *file = APR_ARRAY_IDX(files, i, dag_node_t *);
+      node_revision_t *noderev;
+
+      if (file->kind != svn_node_file)
+        continue;
+
+      SVN_ERR(get_node_revision(&noderev, file));
+      APR_ARRAY_PUSH(reps, representation_t *) = noderev->data_rep;
+      fs = file->fs;
+    }
+
+  if (fs)
+    SVN_ERR(svn_fs_fs__prefetch_contents(fs, reps, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_fs_fs__dag_try_process_file_contents(svn_boolean_t *success,
                                          dag_node_t *node,
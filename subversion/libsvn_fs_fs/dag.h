@@ -413,6 +413,15 @@ svn_error_t *svn_fs_fs__dag_get_contents(svn_stream_t **contents,
                                          dag_node_t *file,
                                          apr_pool_t *pool);
 
+/* Start loading the contents of all FILES (dag_node_t *) in the
+   background.  Nodes that are no files will be ignored.
+
+   Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__dag_prefetch_contents(const apr_array_header_t *files,
+                                 apr_pool_t *scratch_pool);
+
 /* Attempt to fetch the contents of NODE and pass it along with the BATON
    to the PROCESSOR.   Set *SUCCESS only of the data could be provided
    and the processor had been called.
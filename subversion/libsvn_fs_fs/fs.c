@@ -274,6 +274,9 @@ fs_ioctl(svn_fs_t *fs, svn_fs_ioctl_code_t ctlcode,
           SVN_ERR(svn_fs_fs__get_stats(&output->stats, fs,
                                        input->progress_func,
                                        input->progress_baton,
+                                       input->thread_count,
+                                       input->open_fs_func,
+                                       input->open_fs_baton,
                                        cancel_func, cancel_baton,
                                        result_pool, scratch_pool));
           *output_p = output;
@@ -427,12 +430,20 @@ fs_open(svn_fs_t *fs,
         apr_pool_t *scratch_pool,
         apr_pool_t *common_pool)
 {
+  fs_fs_data_t *ffd;
   apr_pool_t *subpool = svn_pool_create(scratch_pool);
 
   SVN_ERR(svn_fs__check_fs(fs, FALSE));
 
   SVN_ERR(initialize_fs_struct(fs));
 
+  /* Servers open the same repositories over and over again.
+     Skip re-reading the metadata files that did not change. */
+  ffd = fs->fsap_data;
+  SVN_MUTEX__WITH_LOCK(common_pool_lock,
+                       svn_fs_fs__get_metadata_cache(&ffd->metadata_cache,
+                                                     common_pool));
+
   SVN_ERR(svn_fs_fs__open(fs, path, subpool));
 
   SVN_ERR(svn_fs_fs__initialize_caches(fs, subpool));
@@ -705,6 +716,8 @@ svn_fs_fs__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(fs_version(), checklist, svn_ver_equal));
 
+  SVN_ERR(svn_fs__batch_fsync_init(common_pool));
+
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
 }
@@ -100,6 +100,8 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_PERSISTENT_CACHE   "persistent-cache"
+#define CONFIG_OPTION_PERSISTENT_CACHE_SIZE "persistent-cache-size"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
@@ -107,6 +109,7 @@ extern "C" {
 #define CONFIG_OPTION_ENABLE_PROPS_DELTIFICATION "enable-props-deltification"
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
+#define CONFIG_OPTION_PLAIN_FILE_THRESHOLD       "plain-file-threshold"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
@@ -115,6 +118,8 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_MEMORY_MAP_REV_FILES "memory-map-rev-files"
+#define CONFIG_OPTION_PREFETCH_FILE_CONTENTS "prefetch-file-contents"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
@@ -127,7 +132,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -200,6 +205,20 @@ extern "C" {
     database. */
 #define SVN_FS_FS__MIN_REP_CACHE_SCHEMA_V2_FORMAT 8
 
+/* The minimum format number that supports pack stages, i.e. small pack
+   files covering a few revisions within a not yet packed shard. */
+#define SVN_FS_FS__MIN_PACK_STAGES_FORMAT 9
+
+/* The minimum format number that stores a copy of the repository UUID
+   and instance ID in the format file, such that opening the repository
+   does not need to read the 'uuid' file. */
+#define SVN_FS_FS__MIN_FORMAT_FILE_IDS_FORMAT 9
+
+/* The minimum format number that distributes the per-node files and the
+   SHA1 mapping files of a transaction over sub-folders of the transaction
+   folder.  Those are named after the hex representation of one byte. */
+#define SVN_FS_FS__MIN_SHARDED_TXN_FORMAT 9
+
 /* On most operating systems apr implements file locks per process, not
    per file.  On Windows apr implements the locking as per file handle
    locks, so we don't have to add our own mutex for just in-process
@@ -280,6 +299,12 @@ typedef struct fs_fs_shared_data_t
   apr_pool_t *common_pool;
 } fs_fs_shared_data_t;
 
+/* Process-wide cache for the contents of the small metadata files that
+   need to be read whenever a filesystem gets opened, e.g. 'format' and
+   'fsfs.conf'.  Entries are revalidated using the file's size, mtime and
+   inode.  Objects of this type are allocated in the common pool. */
+typedef struct fs_fs_metadata_cache_t fs_fs_metadata_cache_t;
+
 /* Data structure for the 1st level DAG node cache. */
 typedef struct fs_fs_dag_cache_t fs_fs_dag_cache_t;
 
@@ -333,6 +358,11 @@ typedef struct fs_fs_data_t
      physical addressing. */
   svn_boolean_t use_log_addressing;
 
+  /* The number of revisions per stage pack or zero, if the revisions of
+     not yet packed shards shall remain in their individual rev files.
+     Always less than MAX_FILES_PER_DIR. */
+  int pack_stage_size;
+
   /* Rev / pack file read granularity in bytes. */
   apr_int64_t block_size;
 
@@ -347,6 +377,14 @@ typedef struct fs_fs_data_t
    * (not just the one bit that we need, atm). */
   svn_boolean_t use_block_read;
 
+  /* If set, read rev / pack files through a read-only memory mapping
+   * instead of buffered file I/O where the platform supports it. */
+  svn_boolean_t memory_map_rev_files;
+
+  /* If set, svn_fs_fs__prefetch_contents() reads ahead the delta chains
+   * of file contents about to be requested. */
+  svn_boolean_t prefetch_file_contents;
+
   /* The revision that was youngest, last time we checked. */
   svn_revnum_t youngest_rev_cache;
 
@@ -360,6 +398,13 @@ typedef struct fs_fs_data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Path of the file that backs up the fulltext and directory caches
+     across process restarts.  NULL if not configured. */
+  const char *persistent_cache_path;
+
+  /* Size of the file at PERSISTENT_CACHE_PATH in MB. */
+  apr_int64_t persistent_cache_size;
+
   /* A cache of revision root IDs, mapping from (svn_revnum_t *) to
      (svn_fs_id_t *).  (Not threadsafe.) */
   svn_cache__t *rev_root_id_cache;
@@ -459,6 +504,10 @@ typedef struct fs_fs_data_t
   /* Data shared between all svn_fs_t objects for a given filesystem. */
   fs_fs_shared_data_t *shared;
 
+  /* Metadata file cache to use when opening the filesystem.
+     NULL if the files shall always be read from disk. */
+  fs_fs_metadata_cache_t *metadata_cache;
+
   /* The sqlite database used for rep caching. */
   svn_sqlite__db_t *rep_cache_db;
 
@@ -469,6 +518,11 @@ typedef struct fs_fs_data_t
    * if revprop packing has been enabled by the FSFS format version. */
   svn_revnum_t min_unpacked_rev;
 
+  /* The oldest revision that is neither in a pack file nor in a stage
+   * pack file.  May be less than MIN_UNPACKED_REV.  Always 0 if the
+   * format does not support pack stages. */
+  svn_revnum_t min_loose_rev;
+
   /* Whether rep-sharing is supported by the filesystem
    * and allowed by the configuration. */
   svn_boolean_t rep_sharing_allowed;
@@ -493,6 +547,10 @@ typedef struct fs_fs_data_t
    * deltification history after which skip deltas will be used. */
   apr_int64_t max_linear_deltification;
 
+  /* File representations with at least this many bytes of fulltext will
+   * be stored as PLAIN reps.  0 disables that feature. */
+  apr_int64_t plain_file_threshold;
+
   /* Compression type to use with txdelta storage format in new revs. */
   compression_type_t delta_compression_type;
 
@@ -28,6 +28,8 @@
 
 #include "svn_checksum.h"
 #include "svn_hash.h"
+#include "svn_path.h"
+#include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_time.h"
 #include "svn_dirent_uri.h"
@@ -59,6 +61,13 @@
 #define SVN_FS_FS_DEFAULT_MAX_FILES_PER_DIR 1000
 #endif
 
+/* Number of revisions to combine into a stage pack file before their
+   shard is complete.  Small enough to keep the number of loose rev
+   files low, large enough to give the pack logic something to arrange. */
+#ifndef SVN_FS_FS_DEFAULT_PACK_STAGE_SIZE
+#define SVN_FS_FS_DEFAULT_PACK_STAGE_SIZE 16
+#endif
+
 /* Begin deltification after a node history exceeded this this limit.
    Useful values are 4 to 64 with 16 being a good compromise between
    computational overhead and repository size savings.
@@ -417,6 +426,205 @@ svn_fs_fs__with_all_locks(svn_fs_t *fs,
 }
 
 
+/** Metadata file cache. */
+
+/* Files that have been modified less than this long before we read them
+   may be modified again without changing their size and timestamps.
+   This covers file systems with a timestamp resolution of up to 2 seconds
+   as well as small clock differences between NFS clients and servers. */
+#define METADATA_RACY_INTERVAL apr_time_from_sec(3)
+
+/* A cached copy of a metadata file, see read_metadata_file(). */
+typedef struct metadata_file_t
+{
+  /* Fingerprint of the file that CONTENT has been read from.
+     CTIME and INODE are 0, if the platform does not provide them. */
+  apr_time_t mtime;
+  apr_time_t ctime;
+  apr_off_t size;
+  apr_ino_t inode;
+
+  /* Time at which we started reading CONTENT. */
+  apr_time_t read_time;
+
+  /* The file contents. */
+  svn_stringbuf_t *content;
+
+  /* The pool containing this entry.  Destroyed upon replacement. */
+  apr_pool_t *pool;
+} metadata_file_t;
+
+struct fs_fs_metadata_cache_t
+{
+  /* Serializes all access to FILES and the entries in it. */
+  svn_mutex__t *mutex;
+
+  /* Maps file paths (const char *) to metadata_file_t *. */
+  apr_hash_t *files;
+
+  /* Parent pool of all entry pools. */
+  apr_pool_t *pool;
+};
+
+/* The common pool userdata key under which we store the metadata cache. */
+#define METADATA_CACHE_USERDATA_KEY "svn-fsfs-metadata-cache"
+
+svn_error_t *
+svn_fs_fs__get_metadata_cache(fs_fs_metadata_cache_t **cache,
+                              apr_pool_t *common_pool)
+{
+  void *val;
+  apr_status_t status;
+
+  status = apr_pool_userdata_get(&val, METADATA_CACHE_USERDATA_KEY,
+                                 common_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't fetch FSFS metadata cache"));
+
+  if (!val)
+    {
+      fs_fs_metadata_cache_t *new_cache = apr_pcalloc(common_pool,
+                                                      sizeof(*new_cache));
+      SVN_ERR(svn_mutex__init(&new_cache->mutex, TRUE, common_pool));
+      new_cache->pool = svn_pool_create(common_pool);
+      new_cache->files = svn_hash__make(new_cache->pool);
+
+      status = apr_pool_userdata_set(new_cache, METADATA_CACHE_USERDATA_KEY,
+                                     NULL, common_pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't store FSFS metadata cache"));
+
+      val = new_cache;
+    }
+
+  *cache = val;
+  return SVN_NO_ERROR;
+}
+
+/* Set *CONTENT to a copy of the contents of PATH in CACHE, allocated in
+   RESULT_POOL, if the cached entry matches the fingerprint in FINFO.
+   Otherwise, set it to NULL.  CACHE->MUTEX must be held by the caller.
+
+   An entry that has been read within METADATA_RACY_INTERVAL of the last
+   modification never matches.  The file might have been modified again
+   since without changing its fingerprint. */
+static svn_error_t *
+lookup_metadata_file(svn_stringbuf_t **content,
+                     fs_fs_metadata_cache_t *cache,
+                     const char *path,
+                     const apr_finfo_t *finfo,
+                     apr_pool_t *result_pool)
+{
+  metadata_file_t *file = svn_hash_gets(cache->files, path);
+  apr_time_t ctime = (finfo->valid & APR_FINFO_CTIME) ? finfo->ctime : 0;
+  apr_ino_t inode = (finfo->valid & APR_FINFO_INODE) ? finfo->inode : 0;
+
+  if (   file
+      && file->mtime == finfo->mtime
+      && file->ctime == ctime
+      && file->size == finfo->size
+      && file->inode == inode
+      && file->read_time - MAX(file->mtime, file->ctime)
+           >= METADATA_RACY_INTERVAL)
+    *content = svn_stringbuf_dup(file->content, result_pool);
+  else
+    *content = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Store CONTENT, read from PATH with the fingerprint FINFO, in CACHE,
+   replacing any previous entry for PATH.  READ_TIME is the time before
+   FINFO has been obtained.  CACHE->MUTEX must be held by the caller. */
+static svn_error_t *
+store_metadata_file(fs_fs_metadata_cache_t *cache,
+                    const char *path,
+                    const apr_finfo_t *finfo,
+                    apr_time_t read_time,
+                    const svn_stringbuf_t *content)
+{
+  metadata_file_t *file = svn_hash_gets(cache->files, path);
+  apr_pool_t *pool;
+
+  /* The hash key is allocated in the old entry's pool. */
+  if (file)
+    {
+      svn_hash_sets(cache->files, path, NULL);
+      svn_pool_destroy(file->pool);
+    }
+
+  pool = svn_pool_create(cache->pool);
+  file = apr_pcalloc(pool, sizeof(*file));
+  file->mtime = finfo->mtime;
+  file->ctime = (finfo->valid & APR_FINFO_CTIME) ? finfo->ctime : 0;
+  file->size = finfo->size;
+  file->inode = (finfo->valid & APR_FINFO_INODE) ? finfo->inode : 0;
+  file->read_time = read_time;
+  file->content = svn_stringbuf_dup(content, pool);
+  file->pool = pool;
+
+  svn_hash_sets(cache->files, apr_pstrdup(pool, path), file);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the file at PATH into *CONTENT, allocated in RESULT_POOL.
+   If CACHE is not NULL, return the cached contents unless the file's
+   size, mtime, ctime or inode changed and update CACHE otherwise.
+   Use SCRATCH_POOL for temporary allocations.
+
+   Recently modified files are always read from disk, see
+   lookup_metadata_file().  Any later modification will then change
+   the fingerprint, even if the file gets replaced by one with the same
+   size and a recycled inode number. */
+static svn_error_t *
+read_metadata_file(svn_stringbuf_t **content,
+                   fs_fs_metadata_cache_t *cache,
+                   const char *path,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  const char *path_apr;
+  apr_status_t status;
+  apr_time_t read_time;
+
+  if (cache == NULL)
+    return svn_error_trace(svn_stringbuf_from_file2(content, path,
+                                                    result_pool));
+
+  /* A stat() is much cheaper than open() + read() + close(), in particular
+     on network file systems.  Without size and mtime, we could not tell
+     whether the file changed, though. */
+  SVN_ERR(svn_path_cstring_from_utf8(&path_apr, path, scratch_pool));
+  read_time = apr_time_now();
+  status = apr_stat(&finfo, path_apr,
+                    APR_FINFO_MTIME | APR_FINFO_CTIME | APR_FINFO_SIZE
+                    | APR_FINFO_INODE,
+                    scratch_pool);
+  if (   (status && status != APR_INCOMPLETE)
+      || (finfo.valid & (APR_FINFO_MTIME | APR_FINFO_SIZE))
+         != (APR_FINFO_MTIME | APR_FINFO_SIZE))
+    return svn_error_trace(svn_stringbuf_from_file2(content, path,
+                                                    result_pool));
+
+  SVN_MUTEX__WITH_LOCK(cache->mutex,
+                       lookup_metadata_file(content, cache, path, &finfo,
+                                            result_pool));
+  if (*content)
+    return SVN_NO_ERROR;
+
+  /* If the file gets replaced after our stat(), the cached fingerprint
+     will not match the next time and we simply read it again. */
+  SVN_ERR(svn_stringbuf_from_file2(content, path, result_pool));
+  SVN_MUTEX__WITH_LOCK(cache->mutex,
+                       store_metadata_file(cache, path, &finfo, read_time,
+                                           *content));
+
+  return SVN_NO_ERROR;
+}
+
 
 
 
@@ -458,20 +666,30 @@ check_format(int format)
 }
 
 /* Read the format number and maximum number of files per directory
-   from PATH and return them in *PFORMAT, *MAX_FILES_PER_DIR and
-   USE_LOG_ADDRESSIONG respectively.
+   from PATH and return them in *PFORMAT, *MAX_FILES_PER_DIR,
+   USE_LOG_ADDRESSIONG and *PACK_STAGE_SIZE respectively.  If CACHE is
+   not NULL, use it to access the file contents.
 
    *MAX_FILES_PER_DIR is obtained from the 'layout' format option, and
    will be set to zero if a linear scheme should be used.
    *USE_LOG_ADDRESSIONG is obtained from the 'addressing' format option,
    and will be set to FALSE for physical addressing.
+   *PACK_STAGE_SIZE is obtained from the 'pack-stage-size' format option,
+   and will be set to zero if pack stages are not used.
+   *UUID and *INSTANCE_ID are obtained from the 'uuid' and 'instance-id'
+   format options, and will be set to NULL if they are not present.
 
-   Use POOL for temporary allocation. */
+   Allocate *UUID and *INSTANCE_ID in POOL and use it for temporary
+   allocation as well. */
 static svn_error_t *
 read_format(int *pformat,
             int *max_files_per_dir,
             svn_boolean_t *use_log_addressing,
+            int *pack_stage_size,
+            const char **uuid,
+            const char **instance_id,
             const char *path,
+            fs_fs_metadata_cache_t *cache,
             apr_pool_t *pool)
 {
   svn_error_t *err;
@@ -480,7 +698,10 @@ read_format(int *pformat,
   svn_stringbuf_t *buf;
   svn_boolean_t eos = FALSE;
 
-  err = svn_stringbuf_from_file2(&content, path, pool);
+  *uuid = NULL;
+  *instance_id = NULL;
+
+  err = read_metadata_file(&content, cache, path, pool, pool);
   if (err && APR_STATUS_IS_ENOENT(err->apr_err))
     {
       /* Treat an absent format file as format 1.  Do not try to
@@ -494,6 +715,7 @@ read_format(int *pformat,
       *pformat = 1;
       *max_files_per_dir = 0;
       *use_log_addressing = FALSE;
+      *pack_stage_size = 0;
 
       return SVN_NO_ERROR;
     }
@@ -519,6 +741,7 @@ read_format(int *pformat,
   /* Set the default values for anything that can be set via an option. */
   *max_files_per_dir = 0;
   *use_log_addressing = FALSE;
+  *pack_stage_size = 0;
 
   /* Read any options. */
   while (!eos)
@@ -561,6 +784,29 @@ read_format(int *pformat,
             }
         }
 
+      if (*pformat >= SVN_FS_FS__MIN_PACK_STAGES_FORMAT &&
+          strncmp(buf->data, "pack-stage-size ", 16) == 0)
+        {
+          /* Check that the argument is numeric. */
+          SVN_ERR(check_format_file_buffer_numeric(buf->data, 16, path, pool));
+          SVN_ERR(svn_cstring_atoi(pack_stage_size, buf->data + 16));
+          continue;
+        }
+
+      if (*pformat >= SVN_FS_FS__MIN_FORMAT_FILE_IDS_FORMAT &&
+          strncmp(buf->data, "uuid ", 5) == 0)
+        {
+          *uuid = apr_pstrdup(pool, buf->data + 5);
+          continue;
+        }
+
+      if (*pformat >= SVN_FS_FS__MIN_FORMAT_FILE_IDS_FORMAT &&
+          strncmp(buf->data, "instance-id ", 12) == 0)
+        {
+          *instance_id = apr_pstrdup(pool, buf->data + 12);
+          continue;
+        }
+
       return svn_error_createf(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
          _("'%s' contains invalid filesystem format option '%s'"),
          svn_dirent_local_style(path, pool), buf->data);
@@ -575,6 +821,21 @@ read_format(int *pformat,
        _("'%s' specifies logical addressing for a non-sharded repository"),
        svn_dirent_local_style(path, pool));
 
+  /* Stage packs are only supported with logical addressing and must be
+   * smaller than the shards that they are part of. */
+  if (*pack_stage_size
+      && (   !*use_log_addressing
+          || *pack_stage_size >= *max_files_per_dir))
+    return svn_error_createf(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
+       _("'%s' specifies an invalid pack stage size"),
+       svn_dirent_local_style(path, pool));
+
+  /* The repository IDs come in pairs. */
+  if (!*uuid != !*instance_id)
+    return svn_error_createf(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
+       _("'%s' specifies an incomplete set of repository IDs"),
+       svn_dirent_local_style(path, pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -614,6 +875,19 @@ svn_fs_fs__write_format(svn_fs_t *fs,
         svn_stringbuf_appendcstr(sb, "addressing physical\n");
     }
 
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_STAGES_FORMAT)
+    svn_stringbuf_appendcstr(sb, apr_psprintf(pool, "pack-stage-size %d\n",
+                                              ffd->pack_stage_size));
+
+  /* Copy of the 'uuid' file contents, if they have already been set. */
+  if (ffd->format >= SVN_FS_FS__MIN_FORMAT_FILE_IDS_FORMAT && fs->uuid)
+    {
+      svn_stringbuf_appendcstr(sb, apr_psprintf(pool, "uuid %s\n",
+                                                fs->uuid));
+      svn_stringbuf_appendcstr(sb, apr_psprintf(pool, "instance-id %s\n",
+                                                ffd->instance_id));
+    }
+
   /* svn_io_write_version_file() does a load of magic to allow it to
      replace version files that already exist.  We only need to do
      that when we're allowed to overwrite an existing file. */
@@ -739,19 +1013,50 @@ parse_compression_option(compression_type_t *compression_type_p,
 }
 
 /* Read the configuration information of the file system at FS_PATH
- * and set the respective values in FFD.  Use pools as usual.
+ * and set the respective values in FFD.  If CACHE is not NULL, use it to
+ * access the file contents.  Use pools as usual.
  */
 static svn_error_t *
 read_config(fs_fs_data_t *ffd,
             const char *fs_path,
+            fs_fs_metadata_cache_t *cache,
             apr_pool_t *result_pool,
             apr_pool_t *scratch_pool)
 {
   svn_config_t *config;
+  const char *config_path = svn_dirent_join(fs_path, PATH_CONFIG,
+                                            scratch_pool);
+
+  if (cache)
+    {
+      svn_stringbuf_t *content;
+      svn_error_t *err = read_metadata_file(&content, cache, config_path,
+                                            scratch_pool, scratch_pool);
 
-  SVN_ERR(svn_config_read3(&config,
-                           svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
-                           FALSE, FALSE, FALSE, scratch_pool));
+      /* Same as svn_config_read3() with MUST_EXIST being FALSE. */
+      if (err && (   APR_STATUS_IS_ENOENT(err->apr_err)
+                  || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+        {
+          svn_error_clear(err);
+          SVN_ERR(svn_config_create2(&config, FALSE, FALSE, scratch_pool));
+        }
+      else
+        {
+          SVN_ERR(err);
+          SVN_ERR_W(svn_config_parse(&config,
+                                     svn_stream_from_stringbuf(content,
+                                                               scratch_pool),
+                                     FALSE, FALSE, scratch_pool),
+                    apr_psprintf(scratch_pool, _("Can't parse '%s'"),
+                                 svn_dirent_local_style(config_path,
+                                                        scratch_pool)));
+        }
+    }
+  else
+    {
+      SVN_ERR(svn_config_read3(&config, config_path,
+                               FALSE, FALSE, FALSE, scratch_pool));
+    }
 
   /* Initialize ffd->rep_sharing_allowed. */
   if (ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT)
@@ -780,6 +1085,11 @@ read_config(fs_fs_data_t *ffd,
                                    CONFIG_SECTION_DELTIFICATION,
                                    CONFIG_OPTION_MAX_LINEAR_DELTIFICATION,
                                    SVN_FS_FS_MAX_LINEAR_DELTIFICATION));
+      SVN_ERR(svn_config_get_int64(config, &ffd->plain_file_threshold,
+                                   CONFIG_SECTION_DELTIFICATION,
+                                   CONFIG_OPTION_PLAIN_FILE_THRESHOLD,
+                                   0));
+      ffd->plain_file_threshold = MAX(0, ffd->plain_file_threshold) * 1024;
     }
   else
     {
@@ -787,6 +1097,7 @@ read_config(fs_fs_data_t *ffd,
       ffd->deltify_properties = FALSE;
       ffd->max_deltification_walk = SVN_FS_FS_MAX_DELTIFICATION_WALK;
       ffd->max_linear_deltification = SVN_FS_FS_MAX_LINEAR_DELTIFICATION;
+      ffd->plain_file_threshold = 0;
     }
 
   /* Initialize revprop packing settings in ffd. */
@@ -840,15 +1151,27 @@ read_config(fs_fs_data_t *ffd,
       ffd->block_size *= 0x400;
       ffd->p2l_page_size *= 0x400;
       /* L2P pages are in entries - not in (k)Bytes */
+
+      SVN_ERR(svn_config_get_bool(config, &ffd->memory_map_rev_files,
+                                  CONFIG_SECTION_IO,
+                                  CONFIG_OPTION_MEMORY_MAP_REV_FILES,
+                                  FALSE));
     }
   else
     {
+      ffd->memory_map_rev_files = FALSE;
+
       /* should be irrelevant but we initialize them anyway */
       ffd->block_size = 0x1000; /* Matches default APR file buffer size. */
       ffd->l2p_page_size = 0x2000;    /* Matches above default. */
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
     }
 
+  SVN_ERR(svn_config_get_bool(config, &ffd->prefetch_file_contents,
+                              CONFIG_SECTION_IO,
+                              CONFIG_OPTION_PREFETCH_FILE_CONTENTS,
+                              TRUE));
+
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
@@ -946,6 +1269,17 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  svn_config_get(config, &ffd->persistent_cache_path, CONFIG_SECTION_CACHES,
+                 CONFIG_OPTION_PERSISTENT_CACHE, NULL);
+  if (ffd->persistent_cache_path)
+    ffd->persistent_cache_path = svn_dirent_join(fs_path,
+                                                 ffd->persistent_cache_path,
+                                                 result_pool);
+  SVN_ERR(svn_config_get_int64(config, &ffd->persistent_cache_size,
+                               CONFIG_SECTION_CACHES,
+                               CONFIG_OPTION_PERSISTENT_CACHE_SIZE,
+                               1024));
+
   return SVN_NO_ERROR;
 }
 
@@ -978,6 +1312,19 @@ write_config(svn_fs_t *fs,
 "### configured (and ignoring it with file:// access).  To make"             NL
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
+"###"                                                                        NL
+"### Fulltexts and directory listings may also be kept in a memory-mapped"   NL
+"### file, ideally on a local SSD, that survives server restarts.  This"     NL
+"### avoids the high disk load while the in-memory caches warm up again."   NL
+"### Relative paths are relative to the repository's db directory.  The"    NL
+"### same file can be shared between repositories and processes."           NL
+"### Contents cached for a repository that has since been replaced, e.g."    NL
+"### by restoring a backup, will not be used."                              NL
+"# " CONFIG_OPTION_PERSISTENT_CACHE " = /var/cache/svn/fsfs.cache"         NL
+"### The size of that file in MB.  It will be created as a sparse file."    NL
+"### The default is 1024 MB.  A file that other processes are using keeps"  NL
+"### its size; it gets resized once no process has it open anymore."        NL
+"# " CONFIG_OPTION_PERSISTENT_CACHE_SIZE " = 1024"                          NL
 ""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
@@ -1056,6 +1403,14 @@ write_config(svn_fs_t *fs,
 "### For 1.8, the default value is 16; earlier versions use 1."              NL
 "# " CONFIG_OPTION_MAX_LINEAR_DELTIFICATION " = 16"                          NL
 "###"                                                                        NL
+"### Large binaries tend to deltify badly and cost CPU time to reconstruct." NL
+"### File contents of at least this size (in kBytes) will be stored as"      NL
+"### plain fulltext instead.  Servers may then send them directly from the"  NL
+"### rev and pack files.  Future revisions of such files will not be"        NL
+"### deltified either, so the repository may grow faster."                   NL
+"### A value of 0 disables this feature.  The default value is 0."           NL
+"# " CONFIG_OPTION_PLAIN_FILE_THRESHOLD " = 0"                               NL
+"###"                                                                        NL
 "### After deltification, we compress the data to minimize on-disk size."    NL
 "### This setting controls the compression algorithm, which will be used in" NL
 "### future revisions.  It can be used to either disable compression or to"  NL
@@ -1148,6 +1503,22 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### Revision and pack files may be read through a read-only memory mapping" NL
+"### instead of buffered file reads.  This saves a copy per block read and"  NL
+"### lets the OS page cache serve concurrent readers directly.  It requires" NL
+"### platform support for memory mapping and is ignored where there is none" NL
+"### or where a file does not fit into the address space.  Do not enable"   NL
+"### this if the repository lives on a network file system that may have"   NL
+"### files truncated underneath a running server.  Disabled by default."     NL
+"# " CONFIG_OPTION_MEMORY_MAP_REV_FILES " = false"                           NL
+"###"                                                                        NL
+"### While sending file contents, e.g. during updates, the server may ask"   NL
+"### the OS to read ahead the delta chains of the next few files and read"   NL
+"### their representation headers.  Disable this if the storage does not"   NL
+"### benefit from read-ahead or if the extra reads hurt a cold cache."       NL
+"### Enabled by default."                                                    NL
+"# " CONFIG_OPTION_PREFETCH_FILE_CONTENTS " = true"                          NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1184,80 +1555,111 @@ read_global_config(svn_fs_t *fs)
   return SVN_NO_ERROR;
 }
 
-/* Read FS's UUID file and store the data in the FS struct. */
+/* Read FS's UUID file and store the data in the FS struct.
+   If CACHE is not NULL, use it to access the file contents. */
 static svn_error_t *
 read_uuid(svn_fs_t *fs,
+          fs_fs_metadata_cache_t *cache,
           apr_pool_t *scratch_pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
-  apr_file_t *uuid_file;
-  char buf[APR_UUID_FORMATTED_LENGTH + 2];
-  apr_size_t limit;
+  svn_stringbuf_t *content;
+  svn_stream_t *stream;
+  svn_stringbuf_t *buf;
+  svn_boolean_t eof;
 
   /* Read the repository uuid. */
-  SVN_ERR(svn_io_file_open(&uuid_file, path_uuid(fs, scratch_pool),
-                           APR_READ | APR_BUFFERED, APR_OS_DEFAULT,
-                           scratch_pool));
+  SVN_ERR(read_metadata_file(&content, cache, path_uuid(fs, scratch_pool),
+                             scratch_pool, scratch_pool));
+  stream = svn_stream_from_stringbuf(content, scratch_pool);
 
-  limit = sizeof(buf);
-  SVN_ERR(svn_io_read_length_line(uuid_file, buf, &limit, scratch_pool));
-  fs->uuid = apr_pstrdup(fs->pool, buf);
+  SVN_ERR(svn_stream_readline(stream, &buf, "\n", &eof, scratch_pool));
+  fs->uuid = apr_pstrdup(fs->pool, buf->data);
 
   /* Read the instance ID. */
   if (ffd->format >= SVN_FS_FS__MIN_INSTANCE_ID_FORMAT)
     {
-      limit = sizeof(buf);
-      SVN_ERR(svn_io_read_length_line(uuid_file, buf, &limit,
-                                      scratch_pool));
-      ffd->instance_id = apr_pstrdup(fs->pool, buf);
+      SVN_ERR(svn_stream_readline(stream, &buf, "\n", &eof, scratch_pool));
+      ffd->instance_id = apr_pstrdup(fs->pool, buf->data);
     }
   else
     {
       ffd->instance_id = fs->uuid;
     }
 
-  SVN_ERR(svn_io_file_close(uuid_file, scratch_pool));
-
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_fs_fs__read_format_file(svn_fs_t *fs, apr_pool_t *scratch_pool)
+/* Read the 'format' file of fsfs filesystem FS and store its info in FS.
+   If the format file contains the repository IDs, set *UUID and
+   *INSTANCE_ID to them.  Otherwise, set them to NULL.  If CACHE is not
+   NULL, use it to access the file contents.
+
+   Allocate the IDs in SCRATCH_POOL and use it for temporary allocations
+   as well. */
+static svn_error_t *
+read_format_file(svn_fs_t *fs,
+                 const char **uuid,
+                 const char **instance_id,
+                 fs_fs_metadata_cache_t *cache,
+                 apr_pool_t *scratch_pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
-  int format, max_files_per_dir;
+  int format, max_files_per_dir, pack_stage_size;
   svn_boolean_t use_log_addressing;
 
   /* Read info from format file. */
   SVN_ERR(read_format(&format, &max_files_per_dir, &use_log_addressing,
-                      path_format(fs, scratch_pool), scratch_pool));
+                      &pack_stage_size, uuid, instance_id,
+                      path_format(fs, scratch_pool), cache, scratch_pool));
 
   /* Now that we've got *all* info, store / update values in FFD. */
   ffd->format = format;
   ffd->max_files_per_dir = max_files_per_dir;
   ffd->use_log_addressing = use_log_addressing;
+  ffd->pack_stage_size = pack_stage_size;
 
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__read_format_file(svn_fs_t *fs, apr_pool_t *scratch_pool)
+{
+  const char *uuid, *instance_id;
+
+  return svn_error_trace(read_format_file(fs, &uuid, &instance_id, NULL,
+                                          scratch_pool));
+}
+
 svn_error_t *
 svn_fs_fs__open(svn_fs_t *fs, const char *path, apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
+  const char *uuid, *instance_id;
   fs->path = apr_pstrdup(fs->pool, path);
 
   /* Read the FS format file. */
-  SVN_ERR(svn_fs_fs__read_format_file(fs, pool));
+  SVN_ERR(read_format_file(fs, &uuid, &instance_id, ffd->metadata_cache,
+                           pool));
 
-  /* Read in and cache the repository uuid. */
-  SVN_ERR(read_uuid(fs, pool));
+  /* Read in and cache the repository uuid, unless the format file already
+     provided it. */
+  if (uuid)
+    {
+      fs->uuid = apr_pstrdup(fs->pool, uuid);
+      ffd->instance_id = apr_pstrdup(fs->pool, instance_id);
+    }
+  else
+    {
+      SVN_ERR(read_uuid(fs, ffd->metadata_cache, pool));
+    }
 
   /* Read the min unpacked revision. */
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, pool));
 
   /* Read the configuration file. */
-  SVN_ERR(read_config(ffd, fs->path, fs->pool, pool));
+  SVN_ERR(read_config(ffd, fs->path, ffd->metadata_cache, fs->pool, pool));
 
   /* Global configuration options. */
   SVN_ERR(read_global_config(fs));
@@ -1267,6 +1669,18 @@ svn_fs_fs__open(svn_fs_t *fs, const char *path, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Return the pack stage size to use by default for a repository with
+   MAX_FILES_PER_DIR revisions per shard and USE_LOG_ADDRESSING. */
+static int
+default_pack_stage_size(int max_files_per_dir,
+                        svn_boolean_t use_log_addressing)
+{
+  return (use_log_addressing
+          && max_files_per_dir > SVN_FS_FS_DEFAULT_PACK_STAGE_SIZE)
+       ? SVN_FS_FS_DEFAULT_PACK_STAGE_SIZE
+       : 0;
+}
+
 /* Wrapper around svn_io_file_create which ignores EEXIST. */
 static svn_error_t *
 create_file_ignore_eexist(const char *file,
@@ -1299,15 +1713,17 @@ upgrade_body(void *baton, apr_pool_t *pool)
   struct upgrade_baton_t *upgrade_baton = baton;
   svn_fs_t *fs = upgrade_baton->fs;
   fs_fs_data_t *ffd = fs->fsap_data;
-  int format, max_files_per_dir;
+  int format, max_files_per_dir, pack_stage_size;
   svn_boolean_t use_log_addressing;
+  const char *uuid, *instance_id;
   const char *format_path = path_format(fs, pool);
   svn_node_kind_t kind;
   svn_boolean_t needs_revprop_shard_cleanup = FALSE;
 
   /* Read the FS format number and max-files-per-dir setting. */
   SVN_ERR(read_format(&format, &max_files_per_dir, &use_log_addressing,
-                      format_path, pool));
+                      &pack_stage_size, &uuid, &instance_id, format_path,
+                      NULL, pool));
 
   /* If the config file does not exist, create one. */
   SVN_ERR(svn_io_check_path(svn_dirent_join(fs->path, PATH_CONFIG, pool),
@@ -1356,6 +1772,12 @@ upgrade_body(void *baton, apr_pool_t *pool)
     SVN_ERR(svn_io_file_create(svn_fs_fs__path_min_unpacked_rev(fs, pool),
                                "0\n", pool));
 
+  /* No revision is stage-packed, yet.  A 'min-unpacked-rev' file without
+     a min-loose-rev line tells just that. */
+  if (format < SVN_FS_FS__MIN_PACK_STAGES_FORMAT)
+    pack_stage_size = default_pack_stage_size(max_files_per_dir,
+                                              use_log_addressing);
+
   /* If the file system supports revision packing but not revprop packing
      *and* the FS has been sharded, pack the revprops up to the point that
      revision data has been packed.  However, keep the non-packed revprop
@@ -1376,13 +1798,15 @@ upgrade_body(void *baton, apr_pool_t *pool)
   /* We will need the UUID info shortly ...
      Read it before the format bump as the UUID file still uses the old
      format. */
-  SVN_ERR(read_uuid(fs, pool));
+  SVN_ERR(read_uuid(fs, NULL, pool));
 
   /* Update the format info in the FS struct.  Upgrade steps further
      down will use the format from FS to create missing info. */
   ffd->format = SVN_FS_FS__FORMAT_NUMBER;
   ffd->max_files_per_dir = max_files_per_dir;
   ffd->use_log_addressing = use_log_addressing;
+  ffd->pack_stage_size = pack_stage_size;
+  ffd->min_loose_rev = 0;
 
   /* Always add / bump the instance ID such that no form of caching
      accidentally uses outdated information.  Keep the UUID. */
@@ -1816,6 +2240,7 @@ svn_fs_fs__create_file_tree(svn_fs_t *fs,
                             int format,
                             int shard_size,
                             svn_boolean_t use_log_addressing,
+                            int pack_stage_size,
                             apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
@@ -1835,6 +2260,14 @@ svn_fs_fs__create_file_tree(svn_fs_t *fs,
   else
     ffd->use_log_addressing = FALSE;
 
+  /* Pack stages are only possible within shards and with log. addressing. */
+  if (   format >= SVN_FS_FS__MIN_PACK_STAGES_FORMAT
+      && ffd->use_log_addressing
+      && pack_stage_size < ffd->max_files_per_dir)
+    ffd->pack_stage_size = pack_stage_size;
+  else
+    ffd->pack_stage_size = 0;
+
   /* Create the revision data directories. */
   if (ffd->max_files_per_dir)
     SVN_ERR(svn_io_make_dir_recursively(svn_fs_fs__path_rev_shard(fs, 0,
@@ -1881,7 +2314,7 @@ svn_fs_fs__create_file_tree(svn_fs_t *fs,
   if (ffd->format >= SVN_FS_FS__MIN_CONFIG_FILE)
     SVN_ERR(write_config(fs, pool));
 
-  SVN_ERR(read_config(ffd, fs->path, fs->pool, pool));
+  SVN_ERR(read_config(ffd, fs->path, NULL, fs->pool, pool));
 
   /* Global configuration options. */
   SVN_ERR(read_global_config(fs));
@@ -1889,8 +2322,12 @@ svn_fs_fs__create_file_tree(svn_fs_t *fs,
   /* Add revision 0. */
   SVN_ERR(write_revision_zero(fs, pool));
 
-  /* Create the min unpacked rev file. */
-  if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
+  /* Create the min unpacked rev file.  With pack stages, it also holds
+     the min loose rev. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_STAGES_FORMAT)
+    SVN_ERR(svn_io_file_create(svn_fs_fs__path_min_unpacked_rev(fs, pool),
+                               "0\n0\n", pool));
+  else if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     SVN_ERR(svn_io_file_create(svn_fs_fs__path_min_unpacked_rev(fs, pool),
                                "0\n", pool));
 
@@ -1916,6 +2353,7 @@ svn_fs_fs__create(svn_fs_t *fs,
 {
   int format = SVN_FS_FS__FORMAT_NUMBER;
   int shard_size = SVN_FS_FS_DEFAULT_MAX_FILES_PER_DIR;
+  int pack_stage_size = -1;
   svn_boolean_t log_addressing;
 
   /* Process the given filesystem config. */
@@ -1923,6 +2361,7 @@ svn_fs_fs__create(svn_fs_t *fs,
     {
       svn_version_t *compatible_version;
       const char *shard_size_str;
+      const char *pack_stage_size_str;
       SVN_ERR(svn_fs__compatible_version(&compatible_version, fs->config,
                                          pool));
 
@@ -1952,6 +2391,13 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 9: format = 7;
                   break;
 
+          case 10:
+          case 11:
+          case 12:
+          case 13:
+          case 14: format = 8;
+                   break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -1964,15 +2410,28 @@ svn_fs_fs__create(svn_fs_t *fs,
 
           shard_size = (int) val;
         }
+
+      pack_stage_size_str = svn_hash_gets(fs->config,
+                                          SVN_FS_CONFIG_FSFS_PACK_STAGE_SIZE);
+      if (pack_stage_size_str)
+        {
+          apr_int64_t val;
+          SVN_ERR(svn_cstring_strtoi64(&val, pack_stage_size_str, 0,
+                                       APR_INT32_MAX, 10));
+
+          pack_stage_size = (int) val;
+        }
     }
 
   log_addressing = svn_hash__get_bool(fs->config,
                                       SVN_FS_CONFIG_FSFS_LOG_ADDRESSING,
                                       TRUE);
+  if (pack_stage_size < 0)
+    pack_stage_size = default_pack_stage_size(shard_size, log_addressing);
 
   /* Actual FS creation. */
   SVN_ERR(svn_fs_fs__create_file_tree(fs, path, format, shard_size,
-                                      log_addressing, pool));
+                                      log_addressing, pack_stage_size, pool));
 
   /* This filesystem is ready.  Stamp it with a format number. */
   SVN_ERR(svn_fs_fs__write_format(fs, FALSE, pool));
@@ -2018,6 +2477,16 @@ svn_fs_fs__set_uuid(svn_fs_t *fs,
   else
     ffd->instance_id = fs->uuid;
 
+  /* Keep the copy in the format file up to date.  During FS creation,
+     the format file gets written last and will pick up the IDs then. */
+  if (ffd->format >= SVN_FS_FS__MIN_FORMAT_FILE_IDS_FORMAT)
+    {
+      svn_node_kind_t kind;
+      SVN_ERR(svn_io_check_path(path_format(fs, pool), &kind, pool));
+      if (kind == svn_node_file)
+        SVN_ERR(svn_fs_fs__write_format(fs, TRUE, pool));
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -2323,8 +2792,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 15;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -30,8 +30,17 @@
 svn_error_t *
 svn_fs_fs__read_format_file(svn_fs_t *fs, apr_pool_t *scratch_pool);
 
+/* Set *CACHE to the process-wide metadata file cache allocated in
+   COMMON_POOL, creating it upon first use.  Access to COMMON_POOL must
+   be serialized by the caller. */
+svn_error_t *
+svn_fs_fs__get_metadata_cache(fs_fs_metadata_cache_t **cache,
+                              apr_pool_t *common_pool);
+
 /* Open the fsfs filesystem pointed to by PATH and associate it with
    filesystem object FS.  Use POOL for temporary allocations.
+   If FS's metadata cache has been set, the 'format', 'uuid' and
+   'fsfs.conf' files will be taken from that cache if they did not change.
 
    ### Some parts of *FS must have been initialized beforehand; some parts
        (including FS->path) are initialized by this function. */
@@ -134,8 +143,10 @@ svn_boolean_t svn_fs_fs__fs_supports_mergeinfo(svn_fs_t *fs);
 
 /* Under the repository db PATH, create a FSFS repository with FORMAT,
  * the given SHARD_SIZE. If USE_LOG_ADDRESSING is non-zero, repository
- * will use logical addressing. If not supported by the respective format,
- * the latter two parameters will be ignored. FS will be updated.
+ * will use logical addressing.  PACK_STAGE_SIZE is the number of revisions
+ * per stage pack, 0 disables pack stages.  If not supported by the
+ * respective format, the latter three parameters will be ignored.
+ * FS will be updated.
  *
  * The only file not being written is the 'format' file.  This allows
  * callers such as hotcopy to modify the contents before turning the
@@ -149,6 +160,7 @@ svn_fs_fs__create_file_tree(svn_fs_t *fs,
                             int format,
                             int shard_size,
                             svn_boolean_t use_log_addressing,
+                            int pack_stage_size,
                             apr_pool_t *pool);
 
 /* Create a fs_fs fileysystem referenced by FS at path PATH.  Get any
@@ -307,6 +319,12 @@ svn_fs_fs__reset_txn_caches(svn_fs_t *fs);
 /* Scan all contents of the repository FS and return statistics in *STATS,
  * allocated in RESULT_POOL.  Report progress through PROGRESS_FUNC with
  * PROGRESS_BATON, if PROGRESS_FUNC is not NULL.
+ *
+ * If THREAD_COUNT > 1 and OPEN_FS_FUNC is not NULL, read the rev and pack
+ * files with up to THREAD_COUNT threads, each one using its own FS instance
+ * provided by OPEN_FS_FUNC with OPEN_FS_BATON.  CANCEL_FUNC must then be
+ * thread-safe.  The result does not depend on THREAD_COUNT.
+ *
  * Use SCRATCH_POOL for temporary allocations.
  */
 svn_error_t *
@@ -314,6 +332,9 @@ svn_fs_fs__get_stats(svn_fs_fs__stats_t **stats,
                      svn_fs_t *fs,
                      svn_fs_progress_notify_func_t progress_func,
                      void *progress_baton,
+                     int thread_count,
+                     svn_fs_fs__open_fs_func_t open_fs_func,
+                     void *open_fs_baton,
                      svn_cancel_func_t cancel_func,
                      void *cancel_baton,
                      apr_pool_t *result_pool,
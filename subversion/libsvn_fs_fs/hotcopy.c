@@ -362,6 +362,7 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
     {
       *dst_min_unpacked_rev = rev + max_files_per_dir;
       SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
+                                                *dst_min_unpacked_rev,
                                                 *dst_min_unpacked_rev,
                                                 scratch_pool));
     }
@@ -369,6 +370,45 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
   return SVN_NO_ERROR;
 }
 
+/* Copy the stage pack file starting at revision REV, which covers
+ * PACK_STAGE_SIZE revisions, from SRC_FS to DST_FS.  Assume a sharding
+ * layout based on MAX_FILES_PER_DIR.
+ * Set *SKIPPED_P to FALSE only if the file was copied, do not change the
+ * value in *SKIPPED_P otherwise. SKIPPED_P may be NULL if not required.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+hotcopy_copy_stage_pack(svn_boolean_t *skipped_p,
+                        svn_fs_t *src_fs,
+                        svn_fs_t *dst_fs,
+                        svn_revnum_t rev,
+                        int max_files_per_dir,
+                        apr_pool_t *scratch_pool)
+{
+  const char *shard = apr_psprintf(scratch_pool, "%ld",
+                                   rev / max_files_per_dir);
+  const char *src_subdir = svn_dirent_join(src_fs->path, PATH_REVS_DIR,
+                                           scratch_pool);
+  const char *dst_subdir = svn_dirent_join(dst_fs->path, PATH_REVS_DIR,
+                                           scratch_pool);
+  const char *dst_subdir_shard = svn_dirent_join(dst_subdir, shard,
+                                                 scratch_pool);
+
+  /* The destination shard may not exist, yet. */
+  SVN_ERR(svn_io_make_dir_recursively(dst_subdir_shard, scratch_pool));
+  SVN_ERR(svn_io_copy_perms(dst_subdir, dst_subdir_shard, scratch_pool));
+
+  SVN_ERR(hotcopy_io_dir_file_copy(skipped_p,
+                                   svn_dirent_join(src_subdir, shard,
+                                                   scratch_pool),
+                                   dst_subdir_shard,
+                                   apr_psprintf(scratch_pool,
+                                                "%ld" PATH_EXT_PACKED_SHARD,
+                                                rev),
+                                   scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Remove file PATH, if it exists - even if it is read-only.
  * Use POOL for temporary allocations. */
 static svn_error_t *
@@ -507,6 +547,14 @@ hotcopy_incremental_check_preconditions(svn_fs_t *src_fs,
                               "of the hotcopy source does not match "
                               "the sharding layout configuration of "
                               "the hotcopy destination"));
+
+  /* Stage packs must cover the same revisions on both sides. */
+  if (src_ffd->pack_stage_size != dst_ffd->pack_stage_size)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("The pack stage configuration "
+                              "of the hotcopy source does not match "
+                              "the pack stage configuration of "
+                              "the hotcopy destination"));
   return SVN_NO_ERROR;
 }
 
@@ -561,6 +609,7 @@ hotcopy_revisions(svn_fs_t *src_fs,
   int max_files_per_dir = src_ffd->max_files_per_dir;
   svn_revnum_t src_min_unpacked_rev;
   svn_revnum_t dst_min_unpacked_rev;
+  svn_revnum_t src_min_loose_rev = 0;
   svn_revnum_t rev;
   apr_pool_t *iterpool;
 
@@ -568,9 +617,10 @@ hotcopy_revisions(svn_fs_t *src_fs,
   if (src_ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_fs_fs__read_min_unpacked_rev(&src_min_unpacked_rev,
+                                               &src_min_loose_rev,
                                                src_fs, pool));
       SVN_ERR(svn_fs_fs__read_min_unpacked_rev(&dst_min_unpacked_rev,
-                                               dst_fs, pool));
+                                               NULL, dst_fs, pool));
 
       /* We only support packs coming from the hotcopy source.
        * The destination should not be packed independently from
@@ -584,8 +634,11 @@ hotcopy_revisions(svn_fs_t *src_fs,
                                    dst_min_unpacked_rev - 1,
                                    src_min_unpacked_rev - 1);
 
-      SVN_ERR(svn_io_dir_file_copy(src_fs->path, dst_fs->path,
-                                   PATH_MIN_UNPACKED_REV, pool));
+      /* With pack stages, the file also lists the stage packs, which
+       * have not been copied, yet.  We'll write it once they are. */
+      if (src_ffd->format < SVN_FS_FS__MIN_PACK_STAGES_FORMAT)
+        SVN_ERR(svn_io_dir_file_copy(src_fs->path, dst_fs->path,
+                                     PATH_MIN_UNPACKED_REV, pool));
     }
   else
     {
@@ -666,6 +719,40 @@ hotcopy_revisions(svn_fs_t *src_fs,
   SVN_ERR_ASSERT(rev == src_min_unpacked_rev);
   SVN_ERR_ASSERT(src_min_unpacked_rev == dst_min_unpacked_rev);
 
+  /* Next, copy the stage packs of the current shard.  They must be in
+   * place before the 'min-unpacked-rev' file tells readers to use them. */
+  if (src_ffd->format >= SVN_FS_FS__MIN_PACK_STAGES_FORMAT)
+    {
+      for (; rev < src_min_loose_rev; rev += src_ffd->pack_stage_size)
+        {
+          svn_boolean_t skipped = TRUE;
+          svn_revnum_t pack_end_rev = rev + src_ffd->pack_stage_size - 1;
+
+          svn_pool_clear(iterpool);
+
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+
+          SVN_ERR(hotcopy_copy_stage_pack(&skipped, src_fs, dst_fs, rev,
+                                          max_files_per_dir, iterpool));
+
+          if (notify_func && !skipped)
+            notify_func(notify_baton, rev, pack_end_rev, iterpool);
+        }
+
+      SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs, src_min_unpacked_rev,
+                                                src_min_loose_rev, pool));
+
+      /* Remove revision files which are now stage-packed. */
+      if (incremental && src_min_unpacked_rev < src_min_loose_rev)
+        SVN_ERR(hotcopy_remove_rev_files(dst_fs, src_min_unpacked_rev,
+                                         src_min_loose_rev,
+                                         max_files_per_dir, pool));
+
+      /* Continue with the revprops of the stage-packed revisions. */
+      rev = src_min_unpacked_rev;
+    }
+
   /* Now, copy pairs of non-packed revisions and revprop files.
    * If necessary, update 'current' after copying all files from a shard. */
   for (; rev <= src_youngest; rev++)
@@ -690,11 +777,12 @@ hotcopy_revisions(svn_fs_t *src_fs,
        * hotcopy with an ENOENT (revision file moved to a pack, so it is no
        * longer where we expect it to be). */
 
-      /* Copy the rev file. */
-      SVN_ERR(hotcopy_copy_shard_file(&skipped,
-                                      src_revs_dir, dst_revs_dir, rev,
-                                      max_files_per_dir,
-                                      iterpool));
+      /* Copy the rev file unless it has been stage-packed. */
+      if (rev >= src_min_loose_rev)
+        SVN_ERR(hotcopy_copy_shard_file(&skipped,
+                                        src_revs_dir, dst_revs_dir, rev,
+                                        max_files_per_dir,
+                                        iterpool));
       /* Copy the revprop file. */
       SVN_ERR(hotcopy_copy_shard_file(&skipped,
                                       src_revprops_dir, dst_revprops_dir,
@@ -1058,6 +1146,7 @@ svn_fs_fs__hotcopy(svn_fs_t *src_fs,
       SVN_ERR(svn_fs_fs__create_file_tree(dst_fs, dst_path, src_ffd->format,
                                           src_ffd->max_files_per_dir,
                                           src_ffd->use_log_addressing,
+                                          src_ffd->pack_stage_size,
                                           pool));
 
       /* Copy the UUID.  Hotcopy destination receives a new instance ID, but
@@ -186,6 +186,10 @@ struct svn_fs_fs__packed_number_stream_t
   /* underlying data file containing the packed values */
   apr_file_t *file;
 
+  /* If not NULL, the contents of FILE mapped into memory.  Numbers get
+   * decoded directly from here instead of being read from FILE. */
+  const unsigned char *mapped_data;
+
   /* Offset within FILE at which the stream data starts
    * (i.e. which offset will reported as offset 0 by packed_stream_offset). */
   apr_off_t stream_start;
@@ -251,45 +255,56 @@ static svn_error_t *
 packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 {
   unsigned char buffer[MAX_NUMBER_PREFETCH];
+  const unsigned char *data = buffer;
   apr_size_t bytes_read = 0;
   apr_size_t i;
   value_position_pair_t *target;
   apr_off_t block_start = 0;
   apr_off_t block_left = 0;
-  apr_status_t err;
+  apr_status_t err = APR_SUCCESS;
 
   /* all buffered data will have been read starting here */
   stream->start_offset = stream->next_offset;
 
-  /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH blocks,
-   * i.e. the last number has been incomplete (and not buffered in stream)
-   * and need to be re-read.  Therefore, always correct the file pointer.
-   */
-  SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
-                                   &block_start, stream->next_offset,
-                                   stream->pool));
+  if (stream->mapped_data)
+    {
+      /* No I/O and no alignment issues.  Decode in place. */
+      data = stream->mapped_data + stream->next_offset;
+      bytes_read = (apr_size_t)MIN(sizeof(buffer),
+                                   stream->stream_end - stream->next_offset);
+    }
+  else
+    {
+      /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH blocks,
+       * i.e. the last number has been incomplete (and not buffered in stream)
+       * and need to be re-read.  Therefore, always correct the file pointer.
+       */
+      SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
+                                       &block_start, stream->next_offset,
+                                       stream->pool));
 
-  /* prefetch at least one number but, if feasible, don't cross block
-   * boundaries.  This shall prevent jumping back and forth between two
-   * blocks because the extra data was not actually request _now_.
-   */
-  bytes_read = sizeof(buffer);
-  block_left = stream->block_size - (stream->next_offset - block_start);
-  if (block_left >= 10 && block_left < bytes_read)
-    bytes_read = (apr_size_t)block_left;
-
-  /* Don't read beyond the end of the file section that belongs to this
-   * index / stream. */
-  bytes_read = (apr_size_t)MIN(bytes_read,
-                               stream->stream_end - stream->next_offset);
-
-  err = apr_file_read(stream->file, buffer, &bytes_read);
-  if (err && !APR_STATUS_IS_EOF(err))
-    return stream_error_create(stream, err,
-      _("Can't read index file '%s' at offset 0x%s"));
+      /* prefetch at least one number but, if feasible, don't cross block
+       * boundaries.  This shall prevent jumping back and forth between two
+       * blocks because the extra data was not actually request _now_.
+       */
+      bytes_read = sizeof(buffer);
+      block_left = stream->block_size - (stream->next_offset - block_start);
+      if (block_left >= 10 && block_left < bytes_read)
+        bytes_read = (apr_size_t)block_left;
+
+      /* Don't read beyond the end of the file section that belongs to this
+       * index / stream. */
+      bytes_read = (apr_size_t)MIN(bytes_read,
+                                   stream->stream_end - stream->next_offset);
+
+      err = apr_file_read(stream->file, buffer, &bytes_read);
+      if (err && !APR_STATUS_IS_EOF(err))
+        return stream_error_create(stream, err,
+          _("Can't read index file '%s' at offset 0x%s"));
+    }
 
   /* if the last number is incomplete, trim it from the buffer */
-  while (bytes_read > 0 && buffer[bytes_read-1] >= 0x80)
+  while (bytes_read > 0 && data[bytes_read-1] >= 0x80)
     --bytes_read;
 
   /* we call read() only if get() requires more data.  So, there must be
@@ -302,11 +317,11 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
   target = stream->buffer;
   for (i = 0; i < bytes_read;)
     {
-      if (buffer[i] < 0x80)
+      if (data[i] < 0x80)
         {
           /* numbers < 128 are relatively frequent and particularly easy
            * to decode.  Give them special treatment. */
-          target->value = buffer[i];
+          target->value = data[i];
           ++i;
           target->total_len = i;
           ++target;
@@ -315,14 +330,14 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
         {
           apr_uint64_t value = 0;
           apr_uint64_t shift = 0;
-          while (buffer[i] >= 0x80)
+          while (data[i] >= 0x80)
             {
-              value += ((apr_uint64_t)buffer[i] & 0x7f) << shift;
+              value += ((apr_uint64_t)data[i] & 0x7f) << shift;
               shift += 7;
               ++i;
             }
 
-          target->value = value + ((apr_uint64_t)buffer[i] << shift);
+          target->value = value + ((apr_uint64_t)data[i] << shift);
           ++i;
           target->total_len = i;
           ++target;
@@ -345,12 +360,15 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 
 /* Create and open a packed number stream reading from offsets START to
  * END in FILE and return it in *STREAM.  Access the file in chunks of
- * BLOCK_SIZE bytes.  Expect the stream to be prefixed by STREAM_PREFIX.
- * Allocate *STREAM in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ * BLOCK_SIZE bytes.  If MAPPED_DATA is not NULL, it is the contents of
+ * FILE mapped into memory and will be read instead of FILE.  Expect the
+ * stream to be prefixed by STREAM_PREFIX.  Allocate *STREAM in RESULT_POOL
+ * and use SCRATCH_POOL for temporaries.
  */
 static svn_error_t *
 packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
                    apr_file_t *file,
+                   const void *mapped_data,
                    apr_off_t start,
                    apr_off_t end,
                    const char *stream_prefix,
@@ -367,10 +385,21 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
   SVN_ERR_ASSERT(len < sizeof(buffer));
 
   /* Read the header prefix and compare it with the expected prefix */
-  SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
-                                   scratch_pool));
-  SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
-                                 scratch_pool));
+  if (mapped_data)
+    {
+      if (end - start < (apr_off_t)len)
+        return svn_error_create(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                                _("Index stream too short for its header"));
+
+      memcpy(buffer, (const char *)mapped_data + start, len);
+    }
+  else
+    {
+      SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
+                                       scratch_pool));
+      SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
+                                     scratch_pool));
+    }
 
   if (strncmp(buffer, stream_prefix, len))
     return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
@@ -383,6 +412,7 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
 
   result->pool = result_pool;
   result->file = file;
+  result->mapped_data = mapped_data;
   result->stream_start = start + len;
   result->stream_end = end;
 
@@ -932,6 +962,19 @@ svn_fs_fs__l2p_index_append(svn_checksum_t **checksum,
   return SVN_NO_ERROR;
 }
 
+/* Return the value to use as the "is packed" part of index cache keys
+ * for REV_FILE.  A stage pack and the shard pack replacing it later may
+ * start at the same revision, so their index data must not share keys.
+ */
+static int
+pack_kind(const svn_fs_fs__revision_file_t *rev_file)
+{
+  if (rev_file->is_packed)
+    return 1;
+
+  return rev_file->is_stage_packed ? 2 : 0;
+}
+
 /* If REV_FILE->L2P_STREAM is NULL, create a new stream for the log-to-phys
  * index for REVISION in FS and return it in REV_FILE.
  */
@@ -947,6 +990,7 @@ auto_open_l2p_index(svn_fs_fs__revision_file_t *rev_file,
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->l2p_stream,
                                  rev_file->file,
+                                 rev_file->mmap ? rev_file->mmap->mm : NULL,
                                  rev_file->l2p_offset,
                                  rev_file->p2l_offset,
                                  L2P_STREAM_PREFIX,
@@ -981,7 +1025,7 @@ get_l2p_header_body(l2p_header_t **header,
 
   pair_cache_key_t key;
   key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  key.second = pack_kind(rev_file);
 
   SVN_ERR(auto_open_l2p_index(rev_file, fs, revision));
   packed_stream_seek(rev_file->l2p_stream, 0);
@@ -1003,7 +1047,8 @@ get_l2p_header_body(l2p_header_t **header,
   SVN_ERR(packed_stream_get(&value, rev_file->l2p_stream));
   result->revision_count = (int)value;
   if (   result->revision_count != 1
-      && result->revision_count != (apr_uint64_t)ffd->max_files_per_dir)
+      && result->revision_count != (apr_uint64_t)ffd->max_files_per_dir
+      && result->revision_count != (apr_uint64_t)ffd->pack_stage_size)
     return svn_error_create(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
                             _("Invalid number of revisions in L2P index"));
 
@@ -1213,7 +1258,7 @@ get_l2p_page_info(l2p_page_info_baton_t *baton,
   /* try to find the info in the cache */
   pair_cache_key_t key;
   key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  key.second = pack_kind(rev_file);
   SVN_ERR(svn_cache__get_partial((void**)&dummy, &is_cached,
                                  ffd->l2p_header_cache, &key,
                                  l2p_page_info_access_func, baton,
@@ -1303,7 +1348,7 @@ get_l2p_page_table(apr_array_header_t *pages,
 
   pair_cache_key_t key;
   key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  key.second = pack_kind(rev_file);
 
   apr_array_clear(pages);
   baton.revision = revision;
@@ -1415,7 +1460,7 @@ prefetch_l2p_pages(svn_boolean_t *end,
   iterpool = svn_pool_create(scratch_pool);
   assert(revision <= APR_UINT32_MAX);
   key.revision = (apr_uint32_t)revision;
-  key.is_packed = rev_file->is_packed;
+  key.is_packed = pack_kind(rev_file);
 
   for (i = 0; i < pages->nelts && !*end; ++i)
     {
@@ -1554,7 +1599,7 @@ l2p_index_lookup(apr_off_t *offset,
 
   assert(revision <= APR_UINT32_MAX);
   key.revision = (apr_uint32_t)revision;
-  key.is_packed = svn_fs_fs__is_packed_rev(fs, revision);
+  key.is_packed = pack_kind(rev_file);
   key.page = info_baton.page_no;
 
   SVN_ERR(svn_cache__get_partial(&dummy, &is_cached,
@@ -1570,7 +1615,7 @@ l2p_index_lookup(apr_off_t *offset,
       svn_revnum_t prefetch_revision;
       svn_revnum_t last_revision
         = info_baton.first_revision
-          + (key.is_packed ? ffd->max_files_per_dir : 1);
+          + svn_fs_fs__pack_size(fs, info_baton.first_revision);
       svn_boolean_t end;
       apr_off_t max_offset
         = APR_ALIGN(info_baton.entry.offset + info_baton.entry.size,
@@ -1693,7 +1738,7 @@ get_l2p_header(l2p_header_t **header,
   /* first, try cache lookop */
   pair_cache_key_t key;
   key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  key.second = pack_kind(rev_file);
   SVN_ERR(svn_cache__get((void**)header, &is_cached, ffd->l2p_header_cache,
                          &key, result_pool));
   if (is_cached)
@@ -2139,6 +2184,7 @@ auto_open_p2l_index(svn_fs_fs__revision_file_t *rev_file,
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->p2l_stream,
                                  rev_file->file,
+                                 rev_file->mmap ? rev_file->mmap->mm : NULL,
                                  rev_file->p2l_offset,
                                  rev_file->footer_offset,
                                  P2L_STREAM_PREFIX,
@@ -2173,7 +2219,7 @@ get_p2l_header(p2l_header_t **header,
   /* look for the header data in our cache */
   pair_cache_key_t key;
   key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  key.second = pack_kind(rev_file);
 
   SVN_ERR(svn_cache__get((void**)header, &is_cached, ffd->p2l_header_cache,
                          &key, result_pool));
@@ -2348,7 +2394,7 @@ get_p2l_page_info(p2l_page_info_baton_t *baton,
   /* look for the header data in our cache */
   pair_cache_key_t key;
   key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  key.second = pack_kind(rev_file);
 
   SVN_ERR(svn_cache__get_partial(&dummy, &is_cached, ffd->p2l_header_cache,
                                  &key, p2l_page_info_func, baton,
@@ -2555,7 +2601,7 @@ prefetch_p2l_page(svn_boolean_t *end,
   /* do we have that page in our caches already? */
   assert(baton->first_revision <= APR_UINT32_MAX);
   key.revision = (apr_uint32_t)baton->first_revision;
-  key.is_packed = svn_fs_fs__is_packed_rev(fs, baton->first_revision);
+  key.is_packed = pack_kind(rev_file);
   key.page = baton->page_no;
   SVN_ERR(svn_cache__has_key(&already_cached, ffd->p2l_page_cache,
                              &key, scratch_pool));
@@ -2626,7 +2672,7 @@ get_p2l_keys(p2l_page_info_baton_t *page_info_p,
       svn_fs_fs__page_cache_key_t key = { 0 };
       assert(page_info.first_revision <= APR_UINT32_MAX);
       key.revision = (apr_uint32_t)page_info.first_revision;
-      key.is_packed = rev_file->is_packed;
+      key.is_packed = pack_kind(rev_file);
       key.page = page_info.page_no;
 
       *key_p = key;
@@ -3060,7 +3106,7 @@ p2l_get_max_offset(apr_off_t *offset,
   /* look for the header data in our cache */
   pair_cache_key_t key;
   key.revision = rev_file->start_revision;
-  key.second = rev_file->is_packed;
+  key.second = pack_kind(rev_file);
 
   SVN_ERR(svn_cache__get_partial((void **)&offset_p, &is_cached,
                                  ffd->p2l_header_cache, &key,
@@ -3114,15 +3160,15 @@ calc_fnv1(svn_fs_fs__p2l_entry_t *entry,
     }
 
   /* Read the block and feed it to the checksum calculator. */
-  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &entry->offset,
-                           scratch_pool));
+  SVN_ERR(svn_fs_fs__rev_file_seek(rev_file, NULL, entry->offset,
+                                   scratch_pool));
   while (size > 0)
     {
       apr_size_t to_read = size > sizeof(buffer)
                          ? sizeof(buffer)
                          : (apr_size_t)size;
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, buffer, to_read, NULL,
-                                     NULL, scratch_pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, to_read,
+                                       scratch_pool));
       SVN_ERR(svn_checksum_update(context, buffer, to_read));
       size -= to_read;
     }
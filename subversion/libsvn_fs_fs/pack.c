@@ -147,7 +147,8 @@ typedef struct pack_context_t
   /* baton to pass to CANCEL_FUNC */
   void *cancel_baton;
 
-  /* first revision in the shard (and future pack file) */
+  /* first revision in the shard (and future pack file).  When creating
+   * a stage pack, "shard" refers to the range of that stage pack. */
   svn_revnum_t shard_rev;
 
   /* first revision in the range to process (>= SHARD_REV) */
@@ -159,6 +160,10 @@ typedef struct pack_context_t
   /* first revision after the current shard */
   svn_revnum_t shard_end_rev;
 
+  /* array of apr_uint64_t, one per revision in the shard, giving the
+   * number of item indexes used by each revision. */
+  apr_array_header_t *max_ids;
+
   /* log-to-phys proto index for the whole pack file */
   apr_file_t *proto_l2p_index;
 
@@ -238,9 +243,9 @@ typedef struct pack_context_t
   svn_boolean_t flush_to_disk;
 } pack_context_t;
 
-/* Create and initialize a new pack context for packing shard SHARD_REV in
- * SHARD_DIR into PACK_FILE_DIR within filesystem FS.  Allocate it in POOL
- * and return the structure in *CONTEXT.
+/* Create and initialize a new pack context for packing the REV_COUNT
+ * revisions starting at SHARD_REV in SHARD_DIR into PACK_FILE_DIR within
+ * filesystem FS.  Allocate it in POOL and return the structure in *CONTEXT.
  *
  * Limit the number of items being copied per iteration to MAX_ITEMS.
  * Set FLUSH_TO_DISK, CANCEL_FUNC and CANCEL_BATON as well.
@@ -251,6 +256,7 @@ initialize_pack_context(pack_context_t *context,
                         const char *pack_file_dir,
                         const char *shard_dir,
                         svn_revnum_t shard_rev,
+                        int rev_count,
                         int max_items,
                         svn_boolean_t flush_to_disk,
                         svn_cancel_func_t cancel_func,
@@ -259,10 +265,11 @@ initialize_pack_context(pack_context_t *context,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   const char *temp_dir;
-  int max_revs = MIN(ffd->max_files_per_dir, max_items);
+  int max_revs = MIN(rev_count, max_items);
 
   SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_LOG_ADDRESSING_FORMAT);
-  SVN_ERR_ASSERT(shard_rev % ffd->max_files_per_dir == 0);
+  SVN_ERR_ASSERT(   shard_rev / ffd->max_files_per_dir
+                 == (shard_rev + rev_count - 1) / ffd->max_files_per_dir);
 
   /* where we will place our various temp files */
   SVN_ERR(svn_io_temp_dir(&temp_dir, pool));
@@ -275,7 +282,7 @@ initialize_pack_context(pack_context_t *context,
   context->shard_rev = shard_rev;
   context->start_rev = shard_rev;
   context->end_rev = shard_rev;
-  context->shard_end_rev = shard_rev + ffd->max_files_per_dir;
+  context->shard_end_rev = shard_rev + rev_count;
 
   /* the pool used for temp structures */
   context->info_pool = svn_pool_create(pool);
@@ -1338,6 +1345,19 @@ pack_range(pack_context_t *context,
 
   /* Phase 2: Copy items into various buckets and build tracking info */
   svn_revnum_t revision;
+  int first_item = 0;
+
+  /* Reserve a section in REPS for the items of each revision up-front.
+   * Stage pack files contain the items of several revisions interleaved,
+   * i.e. we can't simply grow REPS revision by revision. */
+  for (revision = context->start_rev; revision < context->end_rev; ++revision)
+    {
+      APR_ARRAY_PUSH(context->rev_offsets, int) = first_item;
+      first_item += (int)APR_ARRAY_IDX(context->max_ids,
+                                       revision - context->shard_rev,
+                                       apr_uint64_t);
+    }
+
   for (revision = context->start_rev; revision < context->end_rev; ++revision)
     {
       apr_off_t offset = 0;
@@ -1348,10 +1368,14 @@ pack_range(pack_context_t *context,
       /* Get the rev file dimensions (mainly index locations). */
       SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, context->fs,
                                                revision, revpool, iterpool));
-      SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
 
-      /* store the indirect array index */
-      APR_ARRAY_PUSH(context->rev_offsets, int) = context->reps->nelts;
+      /* We process stage pack files as a whole.  Skip them if we already
+       * did that while processing an earlier revision of this range. */
+      if (   rev_file->start_revision < revision
+          && revision > context->start_rev)
+        continue;
+
+      SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
 
       /* read the phys-to-log index file until we covered the whole rev file.
        * That index contains enough info to build both target indexes from it. */
@@ -1378,6 +1402,15 @@ pack_range(pack_context_t *context,
               if (offset > entry->offset)
                 continue;
 
+              /* stage pack files may contain revisions outside our range */
+              if (   entry->type != SVN_FS_FS__ITEM_TYPE_UNUSED
+                  && (   entry->item.revision < context->start_rev
+                      || entry->item.revision >= context->end_rev))
+                {
+                  offset = entry->offset + entry->size;
+                  continue;
+                }
+
               svn_pool_clear(iterpool2);
 
               /* process entry while inside the rev file */
@@ -1536,8 +1569,9 @@ append_revision(pack_context_t *context,
 
 /* Logical addressing mode packing logic.
  *
- * Pack the revision shard starting at SHARD_REV in filesystem FS from
- * SHARD_DIR into the PACK_FILE_DIR, using POOL for allocations.  Limit
+ * Pack the REV_COUNT revisions starting at SHARD_REV in filesystem FS
+ * from SHARD_DIR into the PACK_FILE_DIR, using POOL for allocations.
+ * This is either a whole shard or a single pack stage within it.  Limit
  * the extra memory consumption to MAX_MEM bytes.  If FLUSH_TO_DISK is
  * non-zero, do not return until the data has actually been written on
  * the disk.  CANCEL_FUNC and CANCEL_BATON are what you think they are.
@@ -1547,6 +1581,7 @@ pack_log_addressed(svn_fs_t *fs,
                    const char *pack_file_dir,
                    const char *shard_dir,
                    svn_revnum_t shard_rev,
+                   int rev_count,
                    apr_size_t max_mem,
                    svn_boolean_t flush_to_disk,
                    svn_cancel_func_t cancel_func,
@@ -1581,13 +1616,15 @@ pack_log_addressed(svn_fs_t *fs,
 
   /* set up a pack context */
   SVN_ERR(initialize_pack_context(&context, fs, pack_file_dir, shard_dir,
-                                  shard_rev, max_items, flush_to_disk,
-                                  cancel_func, cancel_baton, pool));
+                                  shard_rev, rev_count, max_items,
+                                  flush_to_disk, cancel_func, cancel_baton,
+                                  pool));
 
   /* phase 1: determine the size of the revisions to pack */
   SVN_ERR(svn_fs_fs__l2p_get_max_ids(&max_ids, fs, shard_rev,
                                      context.shard_end_rev - shard_rev,
                                      pool, pool));
+  context.max_ids = max_ids;
 
   /* pack revisions in ranges that don't exceed MAX_MEM */
   for (i = 0; i < max_ids->nelts; ++i)
@@ -1614,8 +1651,11 @@ pack_log_addressed(svn_fs_t *fs,
         context.start_rev = i + context.shard_rev;
         context.end_rev = context.start_rev + 1;
 
-        /* if this is a very large revision, we must place it as is */
-        if (APR_ARRAY_IDX(max_ids, i, apr_uint64_t) > max_items)
+        /* if this is a very large revision, we must place it as is.
+         * That is only possible if it has its own rev file.  Otherwise,
+         * pack it like any other range and exceed MAX_MEM. */
+        if (   APR_ARRAY_IDX(max_ids, i, apr_uint64_t) > max_items
+            && !svn_fs_fs__is_stage_packed_rev(fs, context.start_rev))
           {
             SVN_ERR(append_revision(&context, iterpool));
             context.start_rev++;
@@ -1840,8 +1880,9 @@ pack_rev_shard(svn_fs_t *fs,
   /* Index information files */
   if (svn_fs_fs__use_log_addressing(fs))
     SVN_ERR(pack_log_addressed(fs, pack_file_dir, shard_path,
-                               shard_rev, max_mem, flush_to_disk,
-                               cancel_func, cancel_baton, pool));
+                               shard_rev, max_files_per_dir, max_mem,
+                               flush_to_disk, cancel_func, cancel_baton,
+                               pool));
   else
     SVN_ERR(pack_phys_addressed(pack_file_dir, shard_path, shard_rev,
                                 max_files_per_dir, flush_to_disk,
@@ -1873,6 +1914,10 @@ struct pack_baton
 
   /* Additional entries valid when entering synced_pack_shard(). */
   const char *rev_shard_path;
+
+  /* First revision of the stage being packed.
+     Valid when entering synced_pack_stage(). */
+  svn_revnum_t stage_rev;
 };
 
 
@@ -1921,7 +1966,7 @@ synced_pack_shard(void *baton,
   /* Update the min-unpacked-rev file to reflect our newly packed shard. */
   SVN_ERR(svn_fs_fs__write_min_unpacked_rev(pb->fs,
                     (svn_revnum_t)((pb->shard + 1) * ffd->max_files_per_dir),
-                    pool));
+                    ffd->min_loose_rev, pool));
   ffd->min_unpacked_rev
     = (svn_revnum_t)((pb->shard + 1) * ffd->max_files_per_dir);
 
@@ -2009,8 +2054,126 @@ pack_shard(struct pack_baton *baton,
   return SVN_NO_ERROR;
 }
 
+/* Part of the stage packing process that requires global (write)
+ * synchronization.  Switch readers of the stage described by BATON over
+ * to the stage pack file and remove the now redundant rev files.
+ * The stage pack file has been put in place prior to calling this function.
+ */
+static svn_error_t *
+synced_pack_stage(void *baton,
+                  apr_pool_t *pool)
+{
+  struct pack_baton *pb = baton;
+  fs_fs_data_t *ffd = pb->fs->fsap_data;
+  svn_revnum_t end_rev = pb->stage_rev + ffd->pack_stage_size;
+  svn_revnum_t rev;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Update the min-unpacked-rev file to reflect our newly packed stage. */
+  SVN_ERR(svn_fs_fs__write_min_unpacked_rev(pb->fs, ffd->min_unpacked_rev,
+                                            end_rev, pool));
+
+  /* Readers that still see the old MIN_LOOSE_REV will fail to open the
+     rev files and retry after re-reading it. */
+  for (rev = pb->stage_rev; rev < end_rev; ++rev)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_remove_file2(svn_fs_fs__path_rev(pb->fs, rev, iterpool),
+                                  TRUE, iterpool));
+    }
+
+  ffd->min_loose_rev = end_rev;
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Combine the PACK_STAGE_SIZE revisions starting at STAGE_REV into a single
+ * stage pack file within their shard folder.  BATON provides the FS and
+ * the packing parameters.  Use POOL for allocations.
+ *
+ * The pack file gets assembled in a temporary sub-folder first, so that an
+ * interrupted run leaves no partial stage pack file behind.
+ */
+static svn_error_t *
+pack_stage(struct pack_baton *baton,
+           svn_revnum_t stage_rev,
+           apr_pool_t *pool)
+{
+  svn_fs_t *fs = baton->fs;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *shard_path, *pack_file_name, *pack_file_path, *tmp_dir;
+
+  /* Some useful paths. */
+  shard_path = svn_fs_fs__path_rev_shard(fs, stage_rev, pool);
+  pack_file_name = apr_psprintf(pool, "%ld" PATH_EXT_PACKED_SHARD,
+                                stage_rev);
+  pack_file_path = svn_dirent_join(shard_path, pack_file_name, pool);
+  tmp_dir = svn_dirent_join(shard_path,
+                            apr_pstrcat(pool, pack_file_name, ".tmp",
+                                        SVN_VA_NULL),
+                            pool);
+
+  /* Remove any leftovers from an interrupted run. */
+  SVN_ERR(svn_io_remove_dir2(tmp_dir, TRUE, baton->cancel_func,
+                             baton->cancel_baton, pool));
+  SVN_ERR(svn_io_dir_make(tmp_dir, APR_OS_DEFAULT, pool));
+
+  SVN_ERR(pack_log_addressed(fs, tmp_dir, shard_path, stage_rev,
+                             ffd->pack_stage_size, baton->max_mem,
+                             ffd->flush_to_disk, baton->cancel_func,
+                             baton->cancel_baton, pool));
+
+  /* Readers don't look at the stage pack file before MIN_LOOSE_REV gets
+     bumped.  So, we may safely replace any stale one. */
+  SVN_ERR(svn_io_remove_file2(pack_file_path, TRUE, pool));
+  SVN_ERR(svn_io_file_rename2(svn_dirent_join(tmp_dir, PATH_PACKED, pool),
+                              pack_file_path, ffd->flush_to_disk, pool));
+  SVN_ERR(svn_io_copy_perms(svn_fs_fs__path_rev(fs, stage_rev, pool),
+                            pack_file_path, pool));
+  SVN_ERR(svn_io_set_file_read_only(pack_file_path, FALSE, pool));
+  SVN_ERR(svn_io_remove_dir2(tmp_dir, FALSE, baton->cancel_func,
+                             baton->cancel_baton, pool));
+
+  /* Switch over to the stage pack file. */
+  baton->stage_rev = stage_rev;
+  SVN_ERR(svn_fs_fs__with_write_lock(fs, synced_pack_stage, baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the first revision of the next stage to pack in FS.  It will be
+ * stage-aligned within its shard.
+ */
+static svn_revnum_t
+next_stage_rev(svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  /* MIN_LOOSE_REV lags behind after a shard has been packed. */
+  return MAX(ffd->min_loose_rev, ffd->min_unpacked_rev);
+}
+
+/* Return TRUE, if the stage starting at STAGE_REV in FS is complete,
+ * i.e. its revisions have all been committed, and ends within its shard.
+ * YOUNGEST is the youngest revision in FS.
+ */
+static svn_boolean_t
+is_complete_stage(svn_fs_t *fs,
+                  svn_revnum_t stage_rev,
+                  svn_revnum_t youngest)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_revnum_t shard_end = stage_rev - (stage_rev % ffd->max_files_per_dir)
+                         + ffd->max_files_per_dir;
+  svn_revnum_t stage_end = stage_rev + ffd->pack_stage_size;
+
+  return (stage_end <= youngest + 1) && (stage_end <= shard_end);
+}
+
 /* Read the youngest rev and the first non-packed rev info for FS from disk.
-   Set *FULLY_PACKED when there is no completed unpacked shard.
+   Set *FULLY_PACKED when there is no completed unpacked shard and no
+   completed unpacked stage.
    Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
@@ -2022,7 +2185,8 @@ get_pack_status(svn_boolean_t *fully_packed,
   apr_int64_t completed_shards;
   svn_revnum_t youngest;
 
-  SVN_ERR(svn_fs_fs__read_min_unpacked_rev(&ffd->min_unpacked_rev, fs,
+  SVN_ERR(svn_fs_fs__read_min_unpacked_rev(&ffd->min_unpacked_rev,
+                                           &ffd->min_loose_rev, fs,
                                            scratch_pool));
 
   SVN_ERR(svn_fs_fs__youngest_rev(&youngest, fs, scratch_pool));
@@ -2034,6 +2198,12 @@ get_pack_status(svn_boolean_t *fully_packed,
   else
     *fully_packed = FALSE;
 
+  /* The same for the stages within the latest shard. */
+  if (   *fully_packed
+      && ffd->pack_stage_size
+      && is_complete_stage(fs, next_stage_rev(fs), youngest))
+    *fully_packed = FALSE;
+
   return SVN_NO_ERROR;
 }
 
@@ -2093,6 +2263,23 @@ pack_body(void *baton,
       SVN_ERR(pack_shard(pb, iterpool));
     }
 
+  /* Combine the revisions of the yet incomplete shard into stage packs. */
+  if (ffd->pack_stage_size)
+    {
+      svn_revnum_t stage_rev;
+      for (stage_rev = next_stage_rev(pb->fs);
+           is_complete_stage(pb->fs, stage_rev, ffd->youngest_rev_cache);
+           stage_rev += ffd->pack_stage_size)
+        {
+          svn_pool_clear(iterpool);
+
+          if (pb->cancel_func)
+            SVN_ERR(pb->cancel_func(pb->cancel_baton));
+
+          SVN_ERR(pack_stage(pb, stage_rev, iterpool));
+        }
+    }
+
   svn_pool_destroy(iterpool);
   return SVN_NO_ERROR;
 }
@@ -28,6 +28,9 @@
 
 #include "../libsvn_fs/fs-loader.h"
 
+#include "svn_dirent_uri.h"
+#include "svn_sorts.h"
+
 #include "private/svn_io_private.h"
 #include "svn_private_config.h"
 
@@ -42,10 +45,13 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
   fs_fs_data_t *ffd = fs->fsap_data;
 
   file->is_packed = svn_fs_fs__is_packed_rev(fs, revision);
+  file->is_stage_packed = svn_fs_fs__is_stage_packed_rev(fs, revision);
   file->start_revision = svn_fs_fs__packed_base_rev(fs, revision);
 
   file->file = NULL;
   file->stream = NULL;
+  file->mmap = NULL;
+  file->mmap_offset = 0;
   file->p2l_stream = NULL;
   file->l2p_stream = NULL;
   file->block_size = ffd->block_size;
@@ -159,6 +165,7 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
           file->stream = svn_stream_from_aprfile2(apr_file, TRUE,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
+          file->is_stage_packed = svn_fs_fs__is_stage_packed_rev(fs, rev);
 
           return SVN_NO_ERROR;
         }
@@ -213,6 +220,138 @@ svn_fs_fs__open_pack_or_rev_file(svn_fs_fs__revision_file_t **file,
                                                result_pool, scratch_pool));
 }
 
+#if APR_HAS_MMAP
+
+/* Implements svn_read_fn_t for streams on mapped revision files.
+ * BATON is the svn_fs_fs__revision_file_t. */
+static svn_error_t *
+mapped_read_fn(void *baton,
+               char *buffer,
+               apr_size_t *len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  apr_off_t remaining = (apr_off_t)file->mmap->size - file->mmap_offset;
+
+  if (remaining <= 0)
+    *len = 0;
+  else if ((apr_off_t)*len > remaining)
+    *len = (apr_size_t)remaining;
+
+  memcpy(buffer, (const char *)file->mmap->mm + file->mmap_offset, *len);
+  file->mmap_offset += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_skip_fn_t for streams on mapped revision files.
+ * BATON is the svn_fs_fs__revision_file_t. */
+static svn_error_t *
+mapped_skip_fn(void *baton,
+               apr_size_t len)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  file->mmap_offset = MIN(file->mmap_offset + (apr_off_t)len,
+                          (apr_off_t)file->mmap->size);
+
+  return SVN_NO_ERROR;
+}
+
+/* Stream mark for streams on mapped revision files. */
+typedef struct mapped_mark_t
+{
+  apr_off_t offset;
+} mapped_mark_t;
+
+/* Implements svn_stream_mark_fn_t for streams on mapped revision files.
+ * BATON is the svn_fs_fs__revision_file_t. */
+static svn_error_t *
+mapped_mark_fn(void *baton,
+               svn_stream_mark_t **mark,
+               apr_pool_t *pool)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  mapped_mark_t *mapped_mark = apr_palloc(pool, sizeof(*mapped_mark));
+
+  mapped_mark->offset = file->mmap_offset;
+  *mark = (svn_stream_mark_t *)mapped_mark;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_seek_fn_t for streams on mapped revision files.
+ * BATON is the svn_fs_fs__revision_file_t. */
+static svn_error_t *
+mapped_seek_fn(void *baton,
+               const svn_stream_mark_t *mark)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  file->mmap_offset = mark ? ((const mapped_mark_t *)mark)->offset : 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* If enabled in FS' config, map the already opened FILE into memory
+ * and redirect its stream to that mapping.  Leave FILE unchanged if that
+ * fails for any reason.  Allocate the mapping in RESULT_POOL and use
+ * SCRATCH_POOL for temporaries. */
+static svn_error_t *
+auto_map_file(svn_fs_fs__revision_file_t *file,
+              svn_fs_t *fs,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_filesize_t size;
+  apr_mmap_t *mmap;
+  svn_stream_t *stream;
+
+  if (!ffd->memory_map_rev_files)
+    return SVN_NO_ERROR;
+
+  /* Empty files can't be mapped.  Also, don't exhaust the address space
+   * on 32 bit systems. */
+  SVN_ERR(svn_io_file_size_get(&size, file->file, scratch_pool));
+  if (size <= 0 || (apr_uint64_t)size > APR_SIZE_MAX / 16)
+    return SVN_NO_ERROR;
+
+  /* Mapping is an optimization only.  Fall back to normal reads if the
+   * OS won't let us. */
+  if (apr_mmap_create(&mmap, file->file, 0, (apr_size_t)size,
+                      APR_MMAP_READ, result_pool))
+    return SVN_NO_ERROR;
+
+  stream = svn_stream_create(file, result_pool);
+  svn_stream_set_read2(stream, mapped_read_fn, mapped_read_fn);
+  svn_stream_set_skip(stream, mapped_skip_fn);
+  svn_stream_set_mark(stream, mapped_mark_fn);
+  svn_stream_set_seek(stream, mapped_seek_fn);
+
+  /* The old stream does not own the file; nothing to close here. */
+  file->stream = stream;
+  file->mmap = mmap;
+  file->mmap_offset = 0;
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+svn_error_t *
+svn_fs_fs__open_pack_or_rev_file_mapped(svn_fs_fs__revision_file_t **file,
+                                        svn_fs_t *fs,
+                                        svn_revnum_t rev,
+                                        apr_pool_t *result_pool,
+                                        apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(file, fs, rev, result_pool,
+                                           scratch_pool));
+#if APR_HAS_MMAP
+  SVN_ERR(auto_map_file(*file, fs, result_pool, scratch_pool));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__open_pack_or_rev_file_writable(svn_fs_fs__revision_file_t** file,
                                           svn_fs_t* fs,
@@ -237,22 +376,22 @@ svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
       svn_stringbuf_t *footer;
 
       /* Determine file size. */
-      SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize, file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_size(&filesize, file, file->pool));
 
       /* Read last byte (containing the length of the footer). */
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
-                                       filesize - 1, file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, &footer_length,
-                                     sizeof(footer_length), NULL, NULL,
-                                     file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL, filesize - 1,
+                                       file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, &footer_length,
+                                       sizeof(footer_length), file->pool));
 
       /* Read footer. */
       footer = svn_stringbuf_create_ensure(footer_length, file->pool);
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
+      SVN_ERR(svn_fs_fs__rev_file_seek(file, NULL,
                                        filesize - 1 - footer_length,
                                        file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, footer->data, footer_length,
-                                     &footer->len, NULL, file->pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(file, footer->data, footer_length,
+                                       file->pool));
+      footer->len = footer_length;
       footer->data[footer->len] = '\0';
 
       /* Extract index locations. */
@@ -284,8 +423,139 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
   *file = apr_pcalloc(result_pool, sizeof(**file));
   (*file)->file = apr_file;
   (*file)->is_packed = FALSE;
+  (*file)->is_stage_packed = FALSE;
   (*file)->start_revision = SVN_INVALID_REVNUM;
   (*file)->stream = svn_stream_from_aprfile2(apr_file, TRUE, result_pool);
+  (*file)->block_size = ((fs_fs_data_t *)fs->fsap_data)->block_size;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset,
+                         apr_pool_t *scratch_pool)
+{
+  if (file->mmap)
+    {
+      /* There is no buffer to fill.  Just report the block boundary
+       * that the aligned seek would have used. */
+      if (buffer_start)
+        *buffer_start = offset - (offset % file->block_size);
+
+      file->mmap_offset = offset;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_aligned_seek(file->file,
+                                                  file->block_size,
+                                                  buffer_start, offset,
+                                                  scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file,
+                           apr_pool_t *scratch_pool)
+{
+  if (file->mmap)
+    {
+      *offset = file->mmap_offset;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_get_offset(offset, file->file,
+                                                scratch_pool));
+}
+
+/* Return a pointer to the next LEN bytes of the mapped FILE and advance
+ * its read position accordingly.  Error out if the file is too short.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+consume_mapped(const char **data,
+               svn_fs_fs__revision_file_t *file,
+               apr_size_t len,
+               apr_pool_t *scratch_pool)
+{
+  if (   file->mmap_offset < 0
+      || (apr_off_t)len > (apr_off_t)file->mmap->size - file->mmap_offset)
+    {
+      const char *path;
+      SVN_ERR(svn_io_file_name_get(&path, file->file, scratch_pool));
+      return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                               _("Unexpected end of revision file '%s'"),
+                               svn_dirent_local_style(path, scratch_pool));
+    }
+
+  *data = (const char *)file->mmap->mm + file->mmap_offset;
+  file->mmap_offset += len;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buffer,
+                         apr_size_t len,
+                         apr_pool_t *scratch_pool)
+{
+  if (file->mmap)
+    {
+      const char *data;
+      SVN_ERR(consume_mapped(&data, file, len, scratch_pool));
+      memcpy(buffer, data, len);
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_io_file_read_full2(file->file, buffer, len,
+                                                NULL, NULL, scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_read_string(svn_string_t **str,
+                                svn_fs_fs__revision_file_t *file,
+                                apr_size_t len,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool)
+{
+  svn_string_t *result = apr_palloc(result_pool, sizeof(*result));
+
+  if (file->mmap)
+    {
+      SVN_ERR(consume_mapped(&result->data, file, len, scratch_pool));
+    }
+  else
+    {
+      char *data = apr_palloc(result_pool, len + 1);
+      SVN_ERR(svn_io_file_read_full2(file->file, data, len, NULL, NULL,
+                                     scratch_pool));
+      data[len] = '\0';
+      result->data = data;
+    }
+
+  result->len = len;
+  *str = result;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_size(apr_off_t *size,
+                         svn_fs_fs__revision_file_t *file,
+                         apr_pool_t *scratch_pool)
+{
+  svn_filesize_t filesize;
+
+  if (file->mmap)
+    {
+      *size = (apr_off_t)file->mmap->size;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_io_file_size_get(&filesize, file->file, scratch_pool));
+  *size = (apr_off_t)filesize;
 
   return SVN_NO_ERROR;
 }
@@ -293,6 +563,16 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+      apr_status_t status = apr_mmap_delete(file->mmap);
+      file->mmap = NULL;
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unmap revision file"));
+    }
+#endif
+
   if (file->stream)
     SVN_ERR(svn_stream_close(file->stream));
   if (file->file)
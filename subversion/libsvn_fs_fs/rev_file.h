@@ -23,6 +23,8 @@
 #ifndef SVN_LIBSVN_FS__REV_FILE_H
 #define SVN_LIBSVN_FS__REV_FILE_H
 
+#include <apr_mmap.h>
+
 #include "svn_fs.h"
 #include "id.h"
 
@@ -51,12 +53,25 @@ typedef struct svn_fs_fs__revision_file_t
   /* the revision was packed when the first file / stream got opened */
   svn_boolean_t is_packed;
 
+  /* the revision was in a stage pack file when the first file / stream
+   * got opened.  Mutually exclusive with IS_PACKED. */
+  svn_boolean_t is_stage_packed;
+
   /* rev / pack file */
   apr_file_t *file;
 
-  /* stream based on FILE and not NULL exactly when FILE is not NULL */
+  /* stream based on FILE and not NULL exactly when FILE is not NULL.
+   * If MMAP is not NULL, this reads from the mapping instead. */
   svn_stream_t *stream;
 
+  /* Read-only mapping of the whole of FILE or NULL.  Only set when the
+   * file has been opened by svn_fs_fs__open_pack_or_rev_file_mapped. */
+  apr_mmap_t *mmap;
+
+  /* Current read position within MMAP.  Independent from FILE's offset.
+   * Only used if MMAP is not NULL. */
+  apr_off_t mmap_offset;
+
   /* the opened P2L index stream or NULL.  Always NULL for txns. */
   svn_fs_fs__packed_number_stream_t *p2l_stream;
 
@@ -106,6 +121,21 @@ svn_fs_fs__open_pack_or_rev_file(svn_fs_fs__revision_file_t **file,
                                  apr_pool_t *result_pool,
                                  apr_pool_t *scratch_pool);
 
+/* Like svn_fs_fs__open_pack_or_rev_file but, if enabled in FS' config and
+ * supported by the platform, also map the whole file into memory and make
+ * the STREAM member read from that mapping.
+ *
+ * Callers must only use svn_fs_fs__rev_file_seek, svn_fs_fs__rev_file_offset,
+ * svn_fs_fs__rev_file_read and STREAM to access the rev / pack contents of
+ * *FILE.  Silently fall back to normal file access if the mapping cannot be
+ * created. */
+svn_error_t *
+svn_fs_fs__open_pack_or_rev_file_mapped(svn_fs_fs__revision_file_t **file,
+                                        svn_fs_t *fs,
+                                        svn_revnum_t rev,
+                                        apr_pool_t *result_pool,
+                                        apr_pool_t *scratch_pool);
+
 /* Open the correct revision file for REV with read and write access.
  * If necessary, temporarily reset the file's read-only state.  If the
  * filesystem FS has been packed, *FILE will be set to the packed file;
@@ -137,6 +167,54 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool);
 
+/* Position the read pointer of FILE at OFFSET.  If BUFFER_START is not
+ * NULL, set it to the start offset of the block that contains OFFSET.
+ * This is svn_io_file_aligned_seek for unmapped files.  Use SCRATCH_POOL
+ * for temporary allocations. */
+svn_error_t *
+svn_fs_fs__rev_file_seek(svn_fs_fs__revision_file_t *file,
+                         apr_off_t *buffer_start,
+                         apr_off_t offset,
+                         apr_pool_t *scratch_pool);
+
+/* Set *OFFSET to the current read position in FILE.
+ * Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__rev_file_offset(apr_off_t *offset,
+                           svn_fs_fs__revision_file_t *file,
+                           apr_pool_t *scratch_pool);
+
+/* Read exactly LEN bytes from the current position in FILE into BUFFER
+ * and advance the read position accordingly.  Reading beyond the end of
+ * the file is an error.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buffer,
+                         apr_size_t len,
+                         apr_pool_t *scratch_pool);
+
+/* Return the next LEN bytes from the current position in FILE in *STR and
+ * advance the read position accordingly.  If FILE is mapped, the data is
+ * not copied and *STR points into the mapping.  It then remains valid
+ * only until FILE gets closed.  Otherwise, the data is read into
+ * RESULT_POOL.  Use SCRATCH_POOL for temporaries.
+ *
+ * Note that (*STR)->data is NOT guaranteed to be NUL-terminated, so
+ * callers must never treat it as a C string. */
+svn_error_t *
+svn_fs_fs__rev_file_read_string(svn_string_t **str,
+                                svn_fs_fs__revision_file_t *file,
+                                apr_size_t len,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
+/* Set *SIZE to the size of FILE in bytes.
+ * Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__rev_file_size(apr_off_t *size,
+                         svn_fs_fs__revision_file_t *file,
+                         apr_pool_t *scratch_pool);
+
 /* Close all files and streams in FILE.
  */
 svn_error_t *
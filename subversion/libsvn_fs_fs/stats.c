@@ -28,6 +28,7 @@
 #include "private/svn_cache.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
+#include "private/svn_task.h"
 
 #include "index.h"
 #include "pack.h"
@@ -123,6 +124,33 @@ typedef struct rep_ref_t
 
 } rep_ref_t;
 
+/* A noderev's reference to a representation in some revision before the
+ * range of revisions covered by the current query.  Those cannot be
+ * resolved until the results of the respective queries get merged.
+ * The remaining members describe the representation in case it has not
+ * been seen before. */
+typedef struct foreign_ref_t
+{
+  /* Revision that contains the representation. */
+  svn_revnum_t revision;
+
+  /* Item index of the representation within REVISION. */
+  apr_uint64_t item_index;
+
+  /* On-disk and expanded size of the representation. */
+  apr_uint64_t size;
+  apr_uint64_t expanded_size;
+
+  /* Path of the referencing node. */
+  const char *path;
+
+  /* Classification of the representation.  Values of rep_kind_t. */
+  char kind;
+
+  /* Whether the referencing node has no predecessor. */
+  svn_boolean_t plain_added;
+} foreign_ref_t;
+
 /* Represents a single revision.
  * There will be only one instance per revision. */
 typedef struct revision_info_t
@@ -182,9 +210,20 @@ typedef struct query_t
   /* First non-packed revision. */
   svn_revnum_t min_unpacked_rev;
 
-  /* all revisions */
+  /* all revisions covered by this query, starting at START_REV */
   apr_array_header_t *revisions;
 
+  /* First revision in REVISIONS.  0 for the query covering the whole
+   * repository. */
+  svn_revnum_t start_rev;
+
+  /* rep_ref_t * of all delta chain links found but not resolved, yet. */
+  apr_array_header_t *rep_refs;
+
+  /* foreign_ref_t * of all references to representations in revisions
+   * before START_REV. */
+  apr_array_header_t *foreign_refs;
+
   /* empty representation.
    * Used as a dummy base for DELTA reps without base. */
   rep_stats_t *null_base;
@@ -203,6 +242,20 @@ typedef struct query_t
 
   /* Baton for CANCEL_FUNC. */
   void *cancel_baton;
+
+  /* Callback opening further instances of FS for worker threads.
+   * NULL if we shall read all data in the current thread. */
+  svn_fs_fs__open_fs_func_t open_fs_func;
+
+  /* Baton for OPEN_FS_FUNC. */
+  void *open_fs_baton;
+
+  /* Maximum number of worker threads to use. */
+  int thread_count;
+
+  /* Pool to allocate the revision info and representations in.  Tasks
+   * will create sub-pools in it, possibly from within worker threads. */
+  apr_pool_t *data_pool;
 } query_t;
 
 /* Initialize the LARGEST_CHANGES member in STATS with a capacity of COUNT
@@ -255,24 +308,18 @@ add_to_histogram(svn_fs_fs__histogram_t *histogram,
   histogram->lines[(apr_size_t)shift].sum += size;
 }
 
-/* Update data aggregators in STATS with this representation of type KIND,
- * on-disk REP_SIZE and expanded node size EXPANDED_SIZE for PATH in REVSION.
- * PLAIN_ADDED indicates whether the node has a deltification predecessor.
+/* Add the change of REP_SIZE for PATH in REVISION to LARGEST_CHANGES,
+ * if it is among the largest ones.
  */
 static void
-add_change(svn_fs_fs__stats_t *stats,
-           apr_uint64_t rep_size,
-           apr_uint64_t expanded_size,
-           svn_revnum_t revision,
-           const char *path,
-           rep_kind_t kind,
-           svn_boolean_t plain_added)
+add_largest_change(svn_fs_fs__largest_changes_t *largest_changes,
+                   apr_uint64_t rep_size,
+                   svn_revnum_t revision,
+                   const char *path)
 {
-  /* identify largest reps */
-  if (rep_size >= stats->largest_changes->min_size)
+  if (rep_size >= largest_changes->min_size)
     {
       apr_size_t i;
-      svn_fs_fs__largest_changes_t *largest_changes = stats->largest_changes;
       svn_fs_fs__large_change_info_t *info
         = largest_changes->changes[largest_changes->count - 1];
       info->size = rep_size;
@@ -291,6 +338,23 @@ add_change(svn_fs_fs__stats_t *stats,
       largest_changes->min_size
         = largest_changes->changes[largest_changes->count-1]->size;
     }
+}
+
+/* Update data aggregators in STATS with this representation of type KIND,
+ * on-disk REP_SIZE and expanded node size EXPANDED_SIZE for PATH in REVSION.
+ * PLAIN_ADDED indicates whether the node has a deltification predecessor.
+ */
+static void
+add_change(svn_fs_fs__stats_t *stats,
+           apr_uint64_t rep_size,
+           apr_uint64_t expanded_size,
+           svn_revnum_t revision,
+           const char *path,
+           rep_kind_t kind,
+           svn_boolean_t plain_added)
+{
+  /* identify largest reps */
+  add_largest_change(stats->largest_changes, rep_size, revision, path);
 
   /* global histograms */
   add_to_histogram(&stats->rep_size_histogram, rep_size);
@@ -355,6 +419,93 @@ add_change(svn_fs_fs__stats_t *stats,
     }
 }
 
+/* Add all entries of SOURCE to TARGET.
+ */
+static void
+merge_histogram(svn_fs_fs__histogram_t *target,
+                const svn_fs_fs__histogram_t *source)
+{
+  apr_size_t i;
+
+  target->total.count += source->total.count;
+  target->total.sum += source->total.sum;
+  for (i = 0; i < sizeof(target->lines) / sizeof(target->lines[0]); ++i)
+    {
+      target->lines[i].count += source->lines[i].count;
+      target->lines[i].sum += source->lines[i].sum;
+    }
+}
+
+/* Merge the data aggregators of SOURCE into TARGET, i.e. everything that
+ * add_change() updates.  Entries of SOURCE are considered younger than
+ * those already in TARGET.  Use SCRATCH_POOL for temporary allocations.
+ */
+static void
+merge_changes(svn_fs_fs__stats_t *target,
+              const svn_fs_fs__stats_t *source,
+              apr_pool_t *scratch_pool)
+{
+  apr_size_t i;
+  apr_hash_index_t *hi;
+  apr_pool_t *pool = apr_hash_pool_get(target->by_extension);
+
+  /* largest reps, unused entries have no valid revision */
+  for (i = 0; i < source->largest_changes->count; ++i)
+    {
+      svn_fs_fs__large_change_info_t *info
+        = source->largest_changes->changes[i];
+      if (SVN_IS_VALID_REVNUM(info->revision))
+        add_largest_change(target->largest_changes, info->size,
+                           info->revision, info->path->data);
+    }
+
+  /* global histograms */
+  merge_histogram(&target->rep_size_histogram, &source->rep_size_histogram);
+  merge_histogram(&target->node_size_histogram,
+                  &source->node_size_histogram);
+  merge_histogram(&target->added_rep_size_histogram,
+                  &source->added_rep_size_histogram);
+  merge_histogram(&target->added_node_size_histogram,
+                  &source->added_node_size_histogram);
+
+  /* specific histograms by type */
+  merge_histogram(&target->unused_rep_histogram,
+                  &source->unused_rep_histogram);
+  merge_histogram(&target->dir_prop_rep_histogram,
+                  &source->dir_prop_rep_histogram);
+  merge_histogram(&target->dir_prop_histogram, &source->dir_prop_histogram);
+  merge_histogram(&target->file_prop_rep_histogram,
+                  &source->file_prop_rep_histogram);
+  merge_histogram(&target->file_prop_histogram,
+                  &source->file_prop_histogram);
+  merge_histogram(&target->dir_rep_histogram, &source->dir_rep_histogram);
+  merge_histogram(&target->dir_histogram, &source->dir_histogram);
+  merge_histogram(&target->file_rep_histogram, &source->file_rep_histogram);
+  merge_histogram(&target->file_histogram, &source->file_histogram);
+
+  /* by extension */
+  for (hi = apr_hash_first(scratch_pool, source->by_extension);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const svn_fs_fs__extension_info_t *source_info = apr_hash_this_val(hi);
+      svn_fs_fs__extension_info_t *info
+        = apr_hash_get(target->by_extension, source_info->extension,
+                       APR_HASH_KEY_STRING);
+      if (info == NULL)
+        {
+          info = apr_pcalloc(pool, sizeof(*info));
+          info->extension = apr_pstrdup(pool, source_info->extension);
+
+          apr_hash_set(target->by_extension, info->extension,
+                       APR_HASH_KEY_STRING, info);
+        }
+
+      merge_histogram(&info->node_histogram, &source_info->node_histogram);
+      merge_histogram(&info->rep_histogram, &source_info->rep_histogram);
+    }
+}
+
 /* Comparator used for binary search comparing the absolute file offset
  * of a representation to some other offset. DATA is a *rep_stats_t,
  * KEY is a pointer to an apr_uint64_t.
@@ -370,6 +521,46 @@ compare_representation_item_index(const void *data, const void *key)
   return (lhs > rhs ? 1 : 0);
 }
 
+/* Return the revision_info_t object for REVISION in QUERY.
+ */
+static revision_info_t *
+get_revision_info(query_t *query,
+                  svn_revnum_t revision)
+{
+  return APR_ARRAY_IDX(query->revisions, revision - query->start_rev,
+                       revision_info_t *);
+}
+
+/* Record the delta chain link given by HEADER for the representation at
+ * ITEM_INDEX in REVISION in QUERY.  We will resolve it later in
+ * resolve_representation_refs().
+ */
+static void
+add_rep_ref(query_t *query,
+            svn_revnum_t revision,
+            apr_uint64_t item_index,
+            svn_fs_fs__rep_header_t *header)
+{
+  rep_ref_t *ref = apr_pcalloc(query->rep_refs->pool, sizeof(*ref));
+
+  ref->header_size = header->header_size;
+  ref->revision = revision;
+  ref->item_index = item_index;
+
+  if (header->type == svn_fs_fs__rep_delta)
+    {
+      ref->base_item_index = header->base_item_index;
+      ref->base_revision = header->base_revision;
+    }
+  else
+    {
+      ref->base_item_index = SVN_FS_FS__ITEM_INDEX_UNUSED;
+      ref->base_revision = SVN_INVALID_REVNUM;
+    }
+
+  APR_ARRAY_PUSH(query->rep_refs, rep_ref_t *) = ref;
+}
+
 /* Find the revision_info_t object to the given REVISION in QUERY and
  * return it in *REVISION_INFO. For performance reasons, we skip the
  * lookup if the info is already provided.
@@ -393,7 +584,7 @@ find_representation(int *idx,
   info = revision_info ? *revision_info : NULL;
   if (info == NULL || info->revision != revision)
     {
-      info = APR_ARRAY_IDX(query->revisions, revision, revision_info_t*);
+      info = get_revision_info(query, revision);
       if (revision_info)
         *revision_info = info;
     }
@@ -468,24 +659,8 @@ parse_representation(rep_stats_t **representation,
                                              revision_info->rev_file->stream,
                                              scratch_pool, scratch_pool));
 
-          result->header_size = header->header_size;
-
-          /* Determine length of the delta chain. */
-          if (header->type == svn_fs_fs__rep_delta)
-            {
-              int base_idx;
-              rep_stats_t *base_rep
-                = find_representation(&base_idx, query, NULL,
-                                      header->base_revision,
-                                      header->base_item_index);
-
-              result->chain_length = 1 + MIN(base_rep->chain_length,
-                                             (apr_byte_t)0xfe);
-            }
-          else
-            {
-              result->chain_length = 1;
-            }
+          /* Determine length of the delta chain later. */
+          add_rep_ref(query, rep->revision, rep->item_index, header);
         }
 
       SVN_ERR(svn_sort__array_insert2(revision_info->representations, &result, idx));
@@ -497,6 +672,32 @@ parse_representation(rep_stats_t **representation,
 }
 
 
+/* Record a reference to REP, which lives in a revision before the range
+ * covered by QUERY, by the node at PATH.  KIND is the classification the
+ * representation would get if it has not been referenced before and
+ * PLAIN_ADDED indicates whether the node has no predecessor.
+ */
+static void
+add_foreign_ref(query_t *query,
+                representation_t *rep,
+                const char *path,
+                rep_kind_t kind,
+                svn_boolean_t plain_added)
+{
+  apr_pool_t *pool = query->foreign_refs->pool;
+  foreign_ref_t *ref = apr_pcalloc(pool, sizeof(*ref));
+
+  ref->revision = rep->revision;
+  ref->item_index = rep->item_index;
+  ref->size = rep->size;
+  ref->expanded_size = rep->expanded_size;
+  ref->path = apr_pstrdup(pool, path);
+  ref->kind = kind;
+  ref->plain_added = plain_added;
+
+  APR_ARRAY_PUSH(query->foreign_refs, foreign_ref_t *) = ref;
+}
+
 /* forward declaration */
 static svn_error_t *
 read_noderev(query_t *query,
@@ -622,7 +823,16 @@ read_noderev(query_t *query,
   SVN_ERR(svn_fs_fs__fixup_expanded_size(query->fs, noderev->prop_rep,
                                          scratch_pool));
 
-  if (noderev->data_rep)
+  /* References to reps outside our range will be counted when merging
+   * the query results.  They cannot be the first use of the respective rep
+   * unless the repository is inconsistent. */
+  if (noderev->data_rep && noderev->data_rep->revision < query->start_rev)
+    {
+      add_foreign_ref(query, noderev->data_rep, noderev->created_path,
+                      noderev->kind == svn_node_dir ? dir_rep : file_rep,
+                      !noderev->predecessor_id);
+    }
+  else if (noderev->data_rep)
     {
       SVN_ERR(parse_representation(&text, query,
                                    noderev->data_rep, revision_info,
@@ -633,7 +843,14 @@ read_noderev(query_t *query,
         text->kind = noderev->kind == svn_node_dir ? dir_rep : file_rep;
     }
 
-  if (noderev->prop_rep)
+  if (noderev->prop_rep && noderev->prop_rep->revision < query->start_rev)
+    {
+      add_foreign_ref(query, noderev->prop_rep, noderev->created_path,
+                      noderev->kind == svn_node_dir ? dir_property_rep
+                                                    : file_property_rep,
+                      !noderev->predecessor_id);
+    }
+  else if (noderev->prop_rep)
     {
       SVN_ERR(parse_representation(&props, query,
                                    noderev->prop_rep, revision_info,
@@ -817,10 +1034,6 @@ read_phys_pack_file(query_t *query,
   /* Done with this pack file. */
   SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
 
-  /* one more pack file processed */
-  if (query->progress_func)
-    query->progress_func(base, query->progress_baton, scratch_pool);
-
   return SVN_NO_ERROR;
 }
 
@@ -866,15 +1079,6 @@ read_phys_revision_file(query_t *query,
   /* put it into our container */
   APR_ARRAY_PUSH(query->revisions, revision_info_t*) = info;
 
-  /* show progress every 1000 revs or so */
-  if (query->progress_func)
-    {
-      if (query->shard_size && (revision % query->shard_size == 0))
-        query->progress_func(revision, query->progress_baton, scratch_pool);
-      if (!query->shard_size && (revision % 1000 == 0))
-        query->progress_func(revision, query->progress_baton, scratch_pool);
-    }
-
   return SVN_NO_ERROR;
 }
 
@@ -1008,12 +1212,6 @@ read_log_rev_or_packfile(query_t *query,
   int i;
   svn_fs_fs__revision_file_t *rev_file;
 
-  /* We collect the delta chain links as we scan the file.  Afterwards,
-   * we determine the lengths of those delta chains and throw this
-   * temporary container away. */
-  apr_array_header_t *rep_refs = apr_array_make(scratch_pool, 64,
-                                                sizeof(rep_ref_t *));
-
   /* we will process every revision in the rev / pack file */
   for (i = 0; i < count; ++i)
     {
@@ -1034,7 +1232,7 @@ read_log_rev_or_packfile(query_t *query,
 
   /* record the whole pack size in the first rev so the total sum will
      still be correct */
-  APR_ARRAY_IDX(query->revisions, base, revision_info_t*)->end = max_offset;
+  get_revision_info(query, base)->end = max_offset;
 
   /* for all offsets in the file, get the P2L index entries and process
      the interesting items (change lists, noderevs) */
@@ -1070,8 +1268,7 @@ read_log_rev_or_packfile(query_t *query,
             continue;
 
           /* read and process interesting items */
-          info = APR_ARRAY_IDX(query->revisions, entry->item.revision,
-                               revision_info_t*);
+          info = get_revision_info(query, entry->item.revision);
 
           if (entry->type == SVN_FS_FS__ITEM_TYPE_NODEREV)
             {
@@ -1092,7 +1289,6 @@ read_log_rev_or_packfile(query_t *query,
             {
               /* Collect the delta chain link. */
               svn_fs_fs__rep_header_t *header;
-              rep_ref_t *ref = apr_pcalloc(scratch_pool, sizeof(*ref));
 
               SVN_ERR(svn_io_file_aligned_seek(rev_file->file,
                                                rev_file->block_size,
@@ -1102,22 +1298,8 @@ read_log_rev_or_packfile(query_t *query,
                                                  rev_file->stream,
                                                  iterpool, iterpool));
 
-              ref->header_size = header->header_size;
-              ref->revision = entry->item.revision;
-              ref->item_index = entry->item.number;
-
-              if (header->type == svn_fs_fs__rep_delta)
-                {
-                  ref->base_item_index = header->base_item_index;
-                  ref->base_revision = header->base_revision;
-                }
-              else
-                {
-                  ref->base_item_index = SVN_FS_FS__ITEM_INDEX_UNUSED;
-                  ref->base_revision = SVN_INVALID_REVNUM;
-                }
-
-              APR_ARRAY_PUSH(rep_refs, rep_ref_t *) = ref;
+              add_rep_ref(query, entry->item.revision, entry->item.number,
+                          header);
             }
 
           /* advance offset */
@@ -1125,108 +1307,12 @@ read_log_rev_or_packfile(query_t *query,
         }
     }
 
-  /* Resolve the delta chain links. */
-  SVN_ERR(resolve_representation_refs(query, rep_refs));
-
   /* clean up and close file handles */
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
 }
 
-/* Read the content of the pack file staring at revision BASE logical
- * addressing mode and store it in QUERY.
- *
- * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
- * temporaries.
- */
-static svn_error_t *
-read_log_pack_file(query_t *query,
-                   svn_revnum_t base,
-                   apr_pool_t *result_pool,
-                   apr_pool_t *scratch_pool)
-{
-  SVN_ERR(read_log_rev_or_packfile(query, base, query->shard_size,
-                                   result_pool, scratch_pool));
-
-  /* one more pack file processed */
-  if (query->progress_func)
-    query->progress_func(base, query->progress_baton, scratch_pool);
-
-  return SVN_NO_ERROR;
-}
-
-/* Read the content of the file for REVISION in logical addressing mode
- * and store its contents in QUERY.
- *
- * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
- * temporaries.
- */
-static svn_error_t *
-read_log_revision_file(query_t *query,
-                       svn_revnum_t revision,
-                       apr_pool_t *result_pool,
-                       apr_pool_t *scratch_pool)
-{
-  SVN_ERR(read_log_rev_or_packfile(query, revision, 1,
-                                   result_pool, scratch_pool));
-
-  /* show progress every 1000 revs or so */
-  if (query->progress_func)
-    {
-      if (query->shard_size && (revision % query->shard_size == 0))
-        query->progress_func(revision, query->progress_baton, scratch_pool);
-      if (!query->shard_size && (revision % 1000 == 0))
-        query->progress_func(revision, query->progress_baton, scratch_pool);
-    }
-
-  return SVN_NO_ERROR;
-}
-
-/* Read the repository and collect the stats info in QUERY.
- *
- * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
- * temporaries.
- */
-static svn_error_t *
-read_revisions(query_t *query,
-               apr_pool_t *result_pool,
-               apr_pool_t *scratch_pool)
-{
-  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  svn_revnum_t revision;
-
-  /* read all packed revs */
-  for ( revision = 0
-      ; revision < query->min_unpacked_rev
-      ; revision += query->shard_size)
-    {
-      svn_pool_clear(iterpool);
-
-      if (svn_fs_fs__use_log_addressing(query->fs))
-        SVN_ERR(read_log_pack_file(query, revision, result_pool, iterpool));
-      else
-        SVN_ERR(read_phys_pack_file(query, revision, result_pool, iterpool));
-    }
-
-  /* read non-packed revs */
-  for ( ; revision <= query->head; ++revision)
-    {
-      svn_pool_clear(iterpool);
-
-      if (svn_fs_fs__use_log_addressing(query->fs))
-        SVN_ERR(read_log_revision_file(query, revision, result_pool,
-                                       iterpool));
-      else
-        SVN_ERR(read_phys_revision_file(query, revision, result_pool,
-                                        iterpool));
-    }
-
-  svn_pool_destroy(iterpool);
-
-  return SVN_NO_ERROR;
-}
-
 /* Accumulate stats of REP in STATS.
  */
 static void
@@ -1333,6 +1419,11 @@ create_stats(apr_pool_t *result_pool)
 /* Create a *QUERY, allocated in RESULT_POOL, reading filesystem FS and
  * collecting results in STATS.  Store the optional PROCESS_FUNC and
  * PROGRESS_BATON as well as CANCEL_FUNC and CANCEL_BATON in *QUERY, too.
+ * If THREAD_COUNT is larger than 1 and OPEN_FS_FUNC is not NULL, prepare
+ * for reading the data in up to THREAD_COUNT threads, each opening its own
+ * FS instance through OPEN_FS_FUNC with OPEN_FS_BATON.
+ *
+ * The caller must destroy the *QUERY's DATA_POOL when done with it.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
@@ -1341,11 +1432,16 @@ create_query(query_t **query,
              svn_fs_fs__stats_t *stats,
              svn_fs_progress_notify_func_t progress_func,
              void *progress_baton,
+             int thread_count,
+             svn_fs_fs__open_fs_func_t open_fs_func,
+             void *open_fs_baton,
              svn_cancel_func_t cancel_func,
              void *cancel_baton,
              apr_pool_t *result_pool,
              apr_pool_t *scratch_pool)
 {
+  svn_boolean_t concurrent = thread_count > 1 && open_fs_func;
+
   *query = apr_pcalloc(result_pool, sizeof(**query));
 
   /* Read repository dimensions. */
@@ -1364,6 +1460,10 @@ create_query(query_t **query,
                                        sizeof(revision_info_t *));
   (*query)->null_base = apr_pcalloc(result_pool,
                                     sizeof(*(*query)->null_base));
+  (*query)->start_rev = 0;
+  (*query)->rep_refs = apr_array_make(result_pool, 0, sizeof(rep_ref_t *));
+  (*query)->foreign_refs = apr_array_make(result_pool, 0,
+                                          sizeof(foreign_ref_t *));
 
   /* Store other parameters */
   (*query)->fs = fs;
@@ -1372,30 +1472,329 @@ create_query(query_t **query,
   (*query)->progress_baton = progress_baton;
   (*query)->cancel_func = cancel_func;
   (*query)->cancel_baton = cancel_baton;
+  (*query)->open_fs_func = concurrent ? open_fs_func : NULL;
+  (*query)->open_fs_baton = open_fs_baton;
+  (*query)->thread_count = concurrent ? thread_count : 1;
+
+  /* Tasks may add sub-pools to this one from within worker threads. */
+  (*query)->data_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(concurrent));
+
+  return SVN_NO_ERROR;
+}
+
+/* Parameters of a task reading revisions START_REV to START_REV + COUNT - 1
+ * of the repository described by QUERY.  PACKED is set if these are the
+ * contents of a single pack file.
+ */
+typedef struct range_baton_t
+{
+  query_t *query;
+  svn_revnum_t start_rev;
+  int count;
+  svn_boolean_t packed;
+} range_baton_t;
+
+/* Return a new query for the revisions given by RANGE, reading from FS and
+ * using the repository dimensions found in RANGE->QUERY.  Check for
+ * cancellation using CANCEL_FUNC and CANCEL_BATON.
+ *
+ * Allocate the result in RESULT_POOL.
+ */
+static query_t *
+create_range_query(const range_baton_t *range,
+                   svn_fs_t *fs,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *result_pool)
+{
+  query_t *query = apr_pcalloc(result_pool, sizeof(*query));
+
+  query->fs = fs;
+  query->head = range->query->head;
+  query->shard_size = range->query->shard_size;
+  query->min_unpacked_rev = range->query->min_unpacked_rev;
+  query->revisions = apr_array_make(result_pool, range->count,
+                                    sizeof(revision_info_t *));
+  query->null_base = range->query->null_base;
+  query->start_rev = range->start_rev;
+  query->rep_refs = apr_array_make(result_pool, 64, sizeof(rep_ref_t *));
+  query->foreign_refs = apr_array_make(result_pool, 16,
+                                       sizeof(foreign_ref_t *));
+  query->stats = create_stats(result_pool);
+  query->cancel_func = cancel_func;
+  query->cancel_baton = cancel_baton;
+
+  return query;
+}
 
+/* Implements svn_task__thread_context_constructor_t.
+ *
+ * Return the svn_fs_t to read from in *THREAD_CONTEXT.  Use a new
+ * instance if the query_t given as CONTEXT_BATON tells us to.
+ */
+static svn_error_t *
+open_thread_fs(void **thread_context,
+               void *context_baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  query_t *query = context_baton;
+  svn_fs_t *fs = query->fs;
+
+  if (query->open_fs_func)
+    SVN_ERR(query->open_fs_func(&fs, query->open_fs_baton, result_pool,
+                                scratch_pool));
+
+  *thread_context = fs;
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_task__process_func_t.
+ *
+ * Read the revisions described by the range_baton_t given as
+ * PROCESS_BATON from the svn_fs_t given as THREAD_CONTEXT.  Return the
+ * data collected in a new query_t in *RESULT.
+ */
+static svn_error_t *
+read_range(void **result,
+           svn_task__t *task,
+           void *thread_context,
+           void *process_baton,
+           svn_cancel_func_t cancel_func,
+           void *cancel_baton,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  range_baton_t *range = process_baton;
+  query_t *query = create_range_query(range, thread_context,
+                                      cancel_func, cancel_baton,
+                                      result_pool);
+
+  /* Revision info and representations must survive this task. */
+  apr_pool_t *data_pool = svn_pool_create(range->query->data_pool);
+
+  if (range->packed)
+    {
+      if (svn_fs_fs__use_log_addressing(query->fs))
+        SVN_ERR(read_log_rev_or_packfile(query, range->start_rev,
+                                         range->count, data_pool,
+                                         scratch_pool));
+      else
+        SVN_ERR(read_phys_pack_file(query, range->start_rev, data_pool,
+                                    scratch_pool));
+    }
+  else
+    {
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+      svn_revnum_t revision;
+
+      for (revision = range->start_rev;
+           revision < range->start_rev + range->count;
+           ++revision)
+        {
+          svn_pool_clear(iterpool);
+
+          if (svn_fs_fs__use_log_addressing(query->fs))
+            SVN_ERR(read_log_rev_or_packfile(query, revision, 1, data_pool,
+                                             iterpool));
+          else
+            SVN_ERR(read_phys_revision_file(query, revision, data_pool,
+                                            iterpool));
+        }
+
+      svn_pool_destroy(iterpool);
+    }
+
+  *result = query;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ *
+ * Merge the range query_t given as RESULT into the query_t given as
+ * OUTPUT_BATON, which already contains all older revisions.  Report
+ * progress as we go.
+ */
+static svn_error_t *
+merge_range(svn_task__t *task,
+            void *result,
+            void *output_baton,
+            svn_cancel_func_t cancel_func,
+            void *cancel_baton,
+            apr_pool_t *result_pool,
+            apr_pool_t *scratch_pool)
+{
+  query_t *range_query = result;
+  query_t *query = output_baton;
+  svn_revnum_t revision;
+  int i;
+
+  /* put the revisions into our container */
+  for (i = 0; i < range_query->revisions->nelts; ++i)
+    APR_ARRAY_PUSH(query->revisions, revision_info_t *)
+      = APR_ARRAY_IDX(range_query->revisions, i, revision_info_t *);
+
+  /* count the references to older representations */
+  for (i = 0; i < range_query->foreign_refs->nelts; ++i)
+    {
+      foreign_ref_t *ref = APR_ARRAY_IDX(range_query->foreign_refs, i,
+                                         foreign_ref_t *);
+      revision_info_t *revision_info = NULL;
+      int idx;
+      rep_stats_t *rep = find_representation(&idx, query, &revision_info,
+                                             ref->revision, ref->item_index);
+
+      /* Not referenced by its own revision.  Add it just like
+       * parse_representation() would do in log. addressing mode. */
+      if (!rep)
+        {
+          apr_pool_t *pool = revision_info->representations->pool;
+
+          rep = apr_pcalloc(pool, sizeof(*rep));
+          rep->revision = ref->revision;
+          rep->expanded_size = ref->expanded_size;
+          rep->item_index = ref->item_index;
+          rep->size = ref->size;
+
+          SVN_ERR(svn_sort__array_insert2(revision_info->representations,
+                                          &rep, idx));
+        }
+
+      if (++rep->ref_count == 1)
+        {
+          rep->kind = ref->kind;
+          add_change(query->stats, rep->size, rep->expanded_size,
+                     rep->revision, ref->path, rep->kind, ref->plain_added);
+        }
+    }
+
+  /* histograms etc. */
+  merge_changes(query->stats, range_query->stats, scratch_pool);
+
+  /* now that all older revisions are known, determine the delta chains */
+  SVN_ERR(resolve_representation_refs(query, range_query->rep_refs));
+
+  /* one more pack file processed or
+   * show progress every 1000 revs or so */
+  if (query->progress_func)
+    {
+      if (range_query->start_rev < query->min_unpacked_rev)
+        query->progress_func(range_query->start_rev, query->progress_baton,
+                             scratch_pool);
+      else
+        for (revision = range_query->start_rev;
+             revision < range_query->start_rev
+                        + range_query->revisions->nelts;
+             ++revision)
+          {
+            if (query->shard_size && (revision % query->shard_size == 0))
+              query->progress_func(revision, query->progress_baton,
+                                   scratch_pool);
+            if (!query->shard_size && (revision % 1000 == 0))
+              query->progress_func(revision, query->progress_baton,
+                                   scratch_pool);
+          }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+ *
+ * Add a sub-task per pack file, per stage pack file and per shard of
+ * non-packed revisions for the query_t given as PROCESS_BATON.
+ */
+static svn_error_t *
+add_range_tasks(void **result,
+                svn_task__t *task,
+                void *thread_context,
+                void *process_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  query_t *query = process_baton;
+  int range_size = query->shard_size ? query->shard_size : 1000;
+  svn_revnum_t revision;
+
+  for (revision = 0; revision <= query->head; )
+    {
+      apr_pool_t *process_pool = svn_task__create_process_pool(task);
+      range_baton_t *range = apr_pcalloc(process_pool, sizeof(*range));
+
+      range->query = query;
+      range->start_rev = revision;
+
+      /* Shard packs and stage packs must be read as a whole.  REVISION is
+       * always the first revision of its pack file here. */
+      range->packed = svn_fs_fs__is_packed_rev(query->fs, revision)
+                   || svn_fs_fs__is_stage_packed_rev(query->fs, revision);
+      SVN_ERR_ASSERT(!range->packed
+                     || svn_fs_fs__packed_base_rev(query->fs, revision)
+                          == revision);
+      range->count = range->packed
+                   ? (int)svn_fs_fs__pack_size(query->fs, revision)
+                   : (int)MIN(range_size - revision % range_size,
+                              query->head - revision + 1);
+
+      SVN_ERR(svn_task__add(task, process_pool, NULL,
+                            read_range, range, merge_range, query));
+
+      revision += range->count;
+    }
+
+  *result = NULL;
+  return SVN_NO_ERROR;
+}
+
+/* Read the repository and collect the stats info in QUERY.
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_revisions(query_t *query,
+               apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_task__run(query->thread_count,
+                                       add_range_tasks, query,
+                                       NULL, NULL,
+                                       open_thread_fs, query,
+                                       query->cancel_func,
+                                       query->cancel_baton,
+                                       scratch_pool, scratch_pool));
+}
+
 svn_error_t *
 svn_fs_fs__get_stats(svn_fs_fs__stats_t **stats,
                      svn_fs_t *fs,
                      svn_fs_progress_notify_func_t progress_func,
                      void *progress_baton,
+                     int thread_count,
+                     svn_fs_fs__open_fs_func_t open_fs_func,
+                     void *open_fs_baton,
                      svn_cancel_func_t cancel_func,
                      void *cancel_baton,
                      apr_pool_t *result_pool,
                      apr_pool_t *scratch_pool)
 {
   query_t *query;
+  svn_error_t *err;
 
   *stats = create_stats(result_pool);
   SVN_ERR(create_query(&query, fs, *stats, progress_func, progress_baton,
+                       thread_count, open_fs_func, open_fs_baton,
                        cancel_func, cancel_baton, scratch_pool,
                        scratch_pool));
-  SVN_ERR(read_revisions(query, scratch_pool, scratch_pool));
-  aggregate_stats(query->revisions, *stats);
 
-  return SVN_NO_ERROR;
+  err = read_revisions(query, scratch_pool);
+  if (!err)
+    aggregate_stats(query->revisions, *stats);
+
+  svn_pool_destroy(query->data_pool);
+
+  return svn_error_trace(err);
 }
 
 /* Baton for rev_size_index_entry_cb. */
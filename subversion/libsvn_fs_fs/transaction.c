@@ -61,13 +61,15 @@ path_txn_sha1(svn_fs_t *fs,
               const unsigned char *sha1,
               apr_pool_t *pool)
 {
+  const char *name;
   svn_checksum_t checksum;
   checksum.digest = sha1;
   checksum.kind = svn_checksum_sha1;
 
-  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, txn_id, pool),
-                         svn_checksum_to_cstring(&checksum, pool),
-                         pool);
+  name = svn_checksum_to_cstring(&checksum, pool);
+
+  return svn_dirent_join(svn_fs_fs__path_txn_shard(fs, txn_id, name, pool),
+                         name, pool);
 }
 
 static APR_INLINE const char *
@@ -498,6 +500,45 @@ purge_shared_txn(svn_fs_t *fs,
 }
 
 
+/* Open the in-transaction file PATH within FS for writing and return it
+ * in *FILE.  Truncate the file if it already exists.  If the transaction
+ * is sharded, create the sub-folder containing PATH as needed.  Use POOL
+ * for allocations.
+ */
+static svn_error_t *
+open_txn_file(apr_file_t **file,
+              svn_fs_t *fs,
+              const char *path,
+              apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_int32_t flags = APR_WRITE | APR_CREATE | APR_TRUNCATE | APR_BUFFERED;
+  svn_error_t *err = svn_io_file_open(file, path, flags, APR_OS_DEFAULT,
+                                      pool);
+
+  /* Shard folders only get created when the first file goes into them.
+   * In non-sharded transactions, a missing folder means that the whole
+   * transaction is gone. */
+  if (   err
+      && APR_STATUS_IS_ENOENT(err->apr_err)
+      && ffd->format >= SVN_FS_FS__MIN_SHARDED_TXN_FORMAT)
+    {
+      svn_error_clear(err);
+      err = svn_io_dir_make(svn_dirent_dirname(path, pool), APR_OS_DEFAULT,
+                            pool);
+      if (err && APR_STATUS_IS_EEXIST(err->apr_err))
+        {
+          svn_error_clear(err);
+          err = SVN_NO_ERROR;
+        }
+
+      SVN_ERR(err);
+      err = svn_io_file_open(file, path, flags, APR_OS_DEFAULT, pool);
+    }
+
+  return svn_error_trace(err);
+}
+
 svn_error_t *
 svn_fs_fs__put_node_revision(svn_fs_t *fs,
                              const svn_fs_id_t *id,
@@ -515,10 +556,8 @@ svn_fs_fs__put_node_revision(svn_fs_t *fs,
                              _("Attempted to write to non-transaction '%s'"),
                              svn_fs_fs__id_unparse(id, pool)->data);
 
-  SVN_ERR(svn_io_file_open(&noderev_file,
-                           svn_fs_fs__path_txn_node_rev(fs, id, pool),
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE
-                           | APR_BUFFERED, APR_OS_DEFAULT, pool));
+  SVN_ERR(open_txn_file(&noderev_file, fs,
+                        svn_fs_fs__path_txn_node_rev(fs, id, pool), pool));
 
   SVN_ERR(svn_fs_fs__write_noderev(svn_stream_from_aprfile2(noderev_file, TRUE,
                                                             pool),
@@ -558,9 +597,7 @@ store_sha1_rep_mapping(svn_fs_t *fs,
                                             ffd->format,
                                             (noderev->kind == svn_node_dir),
                                             scratch_pool, scratch_pool);
-      SVN_ERR(svn_io_file_open(&rep_file, file_name,
-                               APR_WRITE | APR_CREATE | APR_TRUNCATE
-                               | APR_BUFFERED, APR_OS_DEFAULT, scratch_pool));
+      SVN_ERR(open_txn_file(&rep_file, fs, file_name, scratch_pool));
 
       SVN_ERR(svn_io_file_write_full(rep_file, rep_string->data,
                                      rep_string->len, NULL, scratch_pool));
@@ -1902,6 +1939,11 @@ fnv1a_checksum_finalize(apr_uint32_t *digest,
   return SVN_NO_ERROR;
 }
 
+/* The checksums we calculate over representation contents.  Directory
+   representations only use the first one. */
+static const svn_checksum_kind_t fulltext_checksum_kinds[]
+  = { svn_checksum_md5, svn_checksum_sha1 };
+
 /* This baton is used by the representation writing streams.  It keeps
    track of the checksum information as well as the total size of the
    representation so far. */
@@ -1917,6 +1959,10 @@ struct rep_write_baton
      deltified, then eventually written to rep_stream. */
   svn_stream_t *delta_stream;
 
+  /* Contents collected while we don't know yet whether this rep will
+     reach the PLAIN threshold.  NULL once the rep header got written. */
+  svn_spillbuf_t *plain_buffer;
+
   /* Where is this representation header stored. */
   apr_off_t rep_offset;
 
@@ -1935,8 +1981,8 @@ struct rep_write_baton
      writing to it. */
   void *lockcookie;
 
-  svn_checksum_ctx_t *md5_checksum_ctx;
-  svn_checksum_ctx_t *sha1_checksum_ctx;
+  /* MD5 and SHA1 of the fulltext. */
+  svn_checksum__multi_ctx_t *checksum_ctx;
 
   /* calculate a modified FNV-1a checksum of the on-disk representation */
   svn_checksum_ctx_t *fnv1a_checksum_ctx;
@@ -1948,6 +1994,49 @@ struct rep_write_baton
   apr_pool_t *result_pool;
 };
 
+/* Write all contents collected in B->PLAIN_BUFFER to STREAM and release
+   the buffer. */
+static svn_error_t *
+flush_plain_buffer(struct rep_write_baton *b,
+                   svn_stream_t *stream)
+{
+  apr_pool_t *iterpool = svn_pool_create(b->scratch_pool);
+
+  while (TRUE)
+    {
+      const char *data;
+      apr_size_t len;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_spillbuf__read(&data, &len, b->plain_buffer, iterpool));
+      if (data == NULL)
+        break;
+
+      SVN_ERR(svn_stream_write(stream, data, &len));
+    }
+
+  svn_pool_destroy(iterpool);
+  b->plain_buffer = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write a PLAIN rep header to B->REP_STREAM, followed by the contents
+   buffered so far.  All further contents will be written verbatim. */
+static svn_error_t *
+begin_plain_rep(struct rep_write_baton *b)
+{
+  svn_fs_fs__rep_header_t header = { 0 };
+
+  header.type = svn_fs_fs__rep_plain;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  return svn_error_trace(flush_plain_buffer(b, b->rep_stream));
+}
+
 /* Handler for the write method of the representation writable stream.
    BATON is a rep_write_baton, DATA is the data to write, and *LEN is
    the length of this data. */
@@ -1958,10 +2047,22 @@ rep_write_contents(void *baton,
 {
   struct rep_write_baton *b = baton;
 
-  SVN_ERR(svn_checksum_update(b->md5_checksum_ctx, data, *len));
-  SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
+  SVN_ERR(svn_checksum__multi_update(b->checksum_ctx, data, *len));
   b->rep_size += *len;
 
+  /* Large contents will be stored as PLAIN; until then, buffer them. */
+  if (b->plain_buffer)
+    {
+      fs_fs_data_t *ffd = b->fs->fsap_data;
+
+      SVN_ERR(svn_spillbuf__write(b->plain_buffer, data, *len,
+                                  b->scratch_pool));
+      if (b->rep_size >= ffd->plain_file_threshold)
+        SVN_ERR(begin_plain_rep(b));
+
+      return SVN_NO_ERROR;
+    }
+
   /* If we are writing a delta, use that stream. */
   if (b->delta_stream)
     return svn_stream_write(b->delta_stream, data, len);
@@ -2188,6 +2289,52 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
                           ffd->delta_compression_level, pool);
 }
 
+/* Choose a delta base for B->NODEREV, write the corresponding DELTA rep
+   header to B->REP_STREAM and set B->DELTA_STREAM up to deltify all
+   contents against that base. */
+static svn_error_t *
+begin_delta_rep(struct rep_write_baton *b)
+{
+  representation_t *base_rep;
+  svn_stream_t *source;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  svn_fs_fs__rep_header_t header = { 0 };
+
+  /* Get the base for this delta. */
+  SVN_ERR(choose_delta_base(&base_rep, b->fs, b->noderev, FALSE,
+                            b->scratch_pool));
+  SVN_ERR(svn_fs_fs__get_contents(&source, b->fs, base_rep, TRUE,
+                                  b->scratch_pool));
+
+  /* Write out the rep header. */
+  if (base_rep)
+    {
+      header.base_revision = base_rep->revision;
+      header.base_item_index = base_rep->item_index;
+      header.base_length = base_rep->size;
+      header.type = svn_fs_fs__rep_delta;
+    }
+  else
+    {
+      header.type = svn_fs_fs__rep_self_delta;
+    }
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+
+  /* Now determine the offset of the actual svndiff data. */
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  /* Prepare to write the svndiff data. */
+  txdelta_to_svndiff(&wh, &whb, b->rep_stream, b->fs, b->result_pool);
+
+  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
+                                            b->scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Get a rep_write_baton and store it in *WB_P for the representation
    indicated by NODEREV in filesystem FS.  Perform allocations in
    POOL.  Only appropriate for file contents, not for props or
@@ -2198,18 +2345,14 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
                     node_revision_t *noderev,
                     apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_write_baton *b;
   apr_file_t *file;
-  representation_t *base_rep;
-  svn_stream_t *source;
-  svn_txdelta_window_handler_t wh;
-  void *whb;
-  svn_fs_fs__rep_header_t header = { 0 };
 
   b = apr_pcalloc(pool, sizeof(*b));
 
-  b->sha1_checksum_ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
-  b->md5_checksum_ctx = svn_checksum_ctx_create(svn_checksum_md5, pool);
+  b->checksum_ctx = svn_checksum__multi_ctx_create(fulltext_checksum_kinds,
+                                                   2, pool);
 
   b->fs = fs;
   b->result_pool = pool;
@@ -2230,39 +2373,17 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
 
   SVN_ERR(svn_io_file_get_offset(&b->rep_offset, file, b->scratch_pool));
 
-  /* Get the base for this delta. */
-  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE, b->scratch_pool));
-  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
-                                  b->scratch_pool));
-
-  /* Write out the rep header. */
-  if (base_rep)
-    {
-      header.base_revision = base_rep->revision;
-      header.base_item_index = base_rep->item_index;
-      header.base_length = base_rep->size;
-      header.type = svn_fs_fs__rep_delta;
-    }
-  else
-    {
-      header.type = svn_fs_fs__rep_self_delta;
-    }
-  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
-                                      b->scratch_pool));
-
-  /* Now determine the offset of the actual svndiff data. */
-  SVN_ERR(svn_io_file_get_offset(&b->delta_start, file,
-                                 b->scratch_pool));
-
   /* Cleanup in case something goes wrong. */
   apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
                             apr_pool_cleanup_null);
 
-  /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
-
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
+  /* We can only tell whether the contents shall be stored as PLAIN
+     once we have seen enough of them.  Otherwise, deltify them. */
+  if (ffd->plain_file_threshold)
+    b->plain_buffer = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE,
+                                           0x100000, b->scratch_pool);
+  else
+    SVN_ERR(begin_delta_rep(b));
 
   *wb_p = b;
 
@@ -2483,26 +2604,24 @@ get_shared_rep(representation_t **old_rep,
   return SVN_NO_ERROR;
 }
 
-/* Copy the hash sum calculation results from MD5_CTX, SHA1_CTX into REP.
- * SHA1 results are only be set if SHA1_CTX is not NULL.
+/* Copy the hash sum calculation results from CTX into REP.
+ * SHA1 results are only be set if CTX calculates a SHA1 checksum.
  * Use POOL for allocations.
  */
 static svn_error_t *
 digests_final(representation_t *rep,
-              const svn_checksum_ctx_t *md5_ctx,
-              const svn_checksum_ctx_t *sha1_ctx,
+              const svn_checksum__multi_ctx_t *ctx,
               apr_pool_t *pool)
 {
   svn_checksum_t *checksum;
 
-  SVN_ERR(svn_checksum_final(&checksum, md5_ctx, pool));
+  SVN_ERR(svn_checksum__multi_final(&checksum, ctx, svn_checksum_md5, pool));
   memcpy(rep->md5_digest, checksum->digest, svn_checksum_size(checksum));
-  rep->has_sha1 = sha1_ctx != NULL;
+
+  SVN_ERR(svn_checksum__multi_final(&checksum, ctx, svn_checksum_sha1, pool));
+  rep->has_sha1 = checksum != NULL;
   if (rep->has_sha1)
-    {
-      SVN_ERR(svn_checksum_final(&checksum, sha1_ctx, pool));
-      memcpy(rep->sha1_digest, checksum->digest, svn_checksum_size(checksum));
-    }
+    memcpy(rep->sha1_digest, checksum->digest, svn_checksum_size(checksum));
 
   return SVN_NO_ERROR;
 }
@@ -2520,6 +2639,13 @@ rep_write_contents_close(void *baton)
 
   rep = apr_pcalloc(b->result_pool, sizeof(*rep));
 
+  /* Contents below the PLAIN threshold get deltified as usual. */
+  if (b->plain_buffer)
+    {
+      SVN_ERR(begin_delta_rep(b));
+      SVN_ERR(flush_plain_buffer(b, b->delta_stream));
+    }
+
   /* Close our delta stream so the last bits of svndiff are written
      out. */
   if (b->delta_stream)
@@ -2536,8 +2662,7 @@ rep_write_contents_close(void *baton)
   rep->revision = SVN_INVALID_REVNUM;
 
   /* Finalize the checksum. */
-  SVN_ERR(digests_final(rep, b->md5_checksum_ctx, b->sha1_checksum_ctx,
-                        b->result_pool));
+  SVN_ERR(digests_final(rep, b->checksum_ctx, b->result_pool));
 
   /* Check and see if we already have a representation somewhere that's
      identical to the one we just wrote out. */
@@ -2713,10 +2838,8 @@ struct write_container_baton
 
   apr_size_t size;
 
-  svn_checksum_ctx_t *md5_ctx;
-
-  /* SHA1 calculation is optional. If not needed, this will be NULL. */
-  svn_checksum_ctx_t *sha1_ctx;
+  /* MD5 and, optionally, SHA1 of the container's serialized form. */
+  svn_checksum__multi_ctx_t *checksum_ctx;
 };
 
 /* The handler for the write_container_rep stream.  BATON is a
@@ -2729,9 +2852,7 @@ write_container_handler(void *baton,
 {
   struct write_container_baton *whb = baton;
 
-  SVN_ERR(svn_checksum_update(whb->md5_ctx, data, *len));
-  if (whb->sha1_ctx)
-    SVN_ERR(svn_checksum_update(whb->sha1_ctx, data, *len));
+  SVN_ERR(svn_checksum__multi_update(whb->checksum_ctx, data, *len));
 
   SVN_ERR(svn_stream_write(whb->stream, data, len));
   whb->size += *len;
@@ -2809,9 +2930,11 @@ write_container_rep(representation_t *rep,
   else
     fnv1a_checksum_ctx = NULL;
   whb->size = 0;
-  whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
-  if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
-    whb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, scratch_pool);
+  whb->checksum_ctx
+    = svn_checksum__multi_ctx_create(fulltext_checksum_kinds,
+                                     item_type == SVN_FS_FS__ITEM_TYPE_DIR_REP
+                                       ? 1 : 2,
+                                     scratch_pool);
 
   stream = svn_stream_create(whb, scratch_pool);
   svn_stream_set_write(stream, write_container_handler);
@@ -2821,7 +2944,7 @@ write_container_rep(representation_t *rep,
   SVN_ERR(writer(stream, collection, scratch_pool));
 
   /* Store the results. */
-  SVN_ERR(digests_final(rep, whb->md5_ctx, whb->sha1_ctx, scratch_pool));
+  SVN_ERR(digests_final(rep, whb->checksum_ctx, scratch_pool));
 
   /* Update size info. */
   rep->expanded_size = whb->size;
@@ -2953,9 +3076,11 @@ write_container_delta_rep(representation_t *rep,
   whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
                                         scratch_pool);
   whb->size = 0;
-  whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
-  if (item_type != SVN_FS_FS__ITEM_TYPE_DIR_REP)
-    whb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, scratch_pool);
+  whb->checksum_ctx
+    = svn_checksum__multi_ctx_create(fulltext_checksum_kinds,
+                                     item_type == SVN_FS_FS__ITEM_TYPE_DIR_REP
+                                       ? 1 : 2,
+                                     scratch_pool);
 
   /* serialize the hash */
   stream = svn_stream_create(whb, scratch_pool);
@@ -2965,7 +3090,7 @@ write_container_delta_rep(representation_t *rep,
   SVN_ERR(svn_stream_close(whb->stream));
 
   /* Store the results. */
-  SVN_ERR(digests_final(rep, whb->md5_ctx, whb->sha1_ctx, scratch_pool));
+  SVN_ERR(digests_final(rep, whb->checksum_ctx, scratch_pool));
 
   /* Update size info. */
   SVN_ERR(svn_io_file_get_offset(&rep_end, file, scratch_pool));
@@ -3593,13 +3718,14 @@ verify_locks(svn_fs_t *fs,
 }
 
 /* Writes final revision properties to file PATH applying permissions
-   from file PERMS_REFERENCE. This involves setting svn:date and
-   removing any temporary properties associated with the commit flags. */
+   from file PERMS_REFERENCE and schedule the necessary fsync calls in
+   BATCH. This involves setting svn:date and removing any temporary
+   properties associated with the commit flags. */
 static svn_error_t *
 write_final_revprop(const char *path,
                     const char *perms_reference,
                     svn_fs_txn_t *txn,
-                    svn_boolean_t flush_to_disk,
+                    svn_fs__batch_fsync_t *batch,
                     apr_pool_t *pool)
 {
   apr_hash_t *txnprops;
@@ -3629,20 +3755,16 @@ write_final_revprop(const char *path,
       svn_hash_sets(txnprops, SVN_PROP_REVISION_DATE, &date);
     }
 
-  /* Create new revprops file. Tell OS to truncate existing file,
-     since  file may already exists from failed transaction. */
-  SVN_ERR(svn_io_file_open(&revprop_file, path,
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE
-                           | APR_BUFFERED, APR_OS_DEFAULT, pool));
+  /* Create new revprops file. Remove any existing file first, since
+     file may already exists from failed transaction.  BATCH owns the
+     file handle and will close it. */
+  SVN_ERR(svn_io_remove_file2(path, TRUE, pool));
+  SVN_ERR(svn_fs__batch_fsync_open_file(&revprop_file, batch, path, pool));
 
   stream = svn_stream_from_aprfile2(revprop_file, TRUE, pool);
   SVN_ERR(svn_hash_write2(txnprops, stream, SVN_HASH_TERMINATOR, pool));
   SVN_ERR(svn_stream_close(stream));
 
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(revprop_file, pool));
-  SVN_ERR(svn_io_file_close(revprop_file, pool));
-
   SVN_ERR(svn_io_copy_perms(perms_reference, path, pool));
 
   return SVN_NO_ERROR;
@@ -3755,6 +3877,7 @@ commit_body(void *baton, apr_pool_t *pool)
   apr_hash_t *changed_paths;
   apr_array_header_t *directory_ids = apr_array_make(pool, 4,
                                                      sizeof(pair_cache_key_t));
+  svn_fs__batch_fsync_t *batch;
 
   /* Re-Read the current repository format.  All our repo upgrade and
      config evaluation strategies are such that existing information in
@@ -3799,6 +3922,11 @@ commit_body(void *baton, apr_pool_t *pool)
   /* We are going to be one better than this puny old revision. */
   new_rev = old_rev + 1;
 
+  /* Collect all files and directories that need to be flushed to physical
+     storage (to the degree our environment will allow) and fsync them
+     concurrently right before we bump 'current'. */
+  SVN_ERR(svn_fs__batch_fsync_create(&batch, ffd->flush_to_disk, pool));
+
   /* Get a write handle on the proto revision file. */
   SVN_ERR(get_writable_proto_rev(&proto_file, &proto_file_lockcookie,
                                  cb->fs, txn_id, pool));
@@ -3837,8 +3965,6 @@ commit_body(void *baton, apr_pool_t *pool)
                                      NULL, pool));
     }
 
-  if (ffd->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(proto_file, pool));
   SVN_ERR(svn_io_file_close(proto_file, pool));
 
   /* We don't unlock the prototype revision file immediately to avoid a
@@ -3863,6 +3989,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_fs__batch_fsync_new_path(batch, new_dir, pool));
         }
 
       /* Create the revprops shard. */
@@ -3879,6 +4006,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVPROPS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_fs__batch_fsync_new_path(batch, new_dir, pool));
         }
     }
 
@@ -3890,9 +4018,8 @@ commit_body(void *baton, apr_pool_t *pool)
   old_rev_filename = svn_fs_fs__path_rev_absolute(cb->fs, old_rev, pool);
   rev_filename = svn_fs_fs__path_rev(cb->fs, new_rev, pool);
   proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
-  SVN_ERR(svn_fs_fs__move_into_place(proto_filename, rev_filename,
-                                     old_rev_filename, ffd->flush_to_disk,
-                                     pool));
+  SVN_ERR(svn_fs_fs__batch_move_into_place(proto_filename, rev_filename,
+                                           old_rev_filename, batch, pool));
 
   /* Now that we've moved the prototype revision file out of the way,
      we can unlock it (since further attempts to write to the file
@@ -3904,7 +4031,11 @@ commit_body(void *baton, apr_pool_t *pool)
   SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
   revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
   SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
-                              cb->txn, ffd->flush_to_disk, pool));
+                              cb->txn, batch, pool));
+
+  /* Commit all changes to disk.  This must complete before 'current'
+     makes the new revision visible. */
+  SVN_ERR(svn_fs__batch_fsync_run(batch, pool));
 
   /* Run paranoia checks. */
   if (ffd->verify_before_commit)
@@ -2940,6 +2940,29 @@ fs_file_contents(svn_stream_t **contents,
   return SVN_NO_ERROR;
 }
 
+/* Implement root_vtable_t.prefetch_file_contents. */
+static svn_error_t *
+fs_prefetch_file_contents(svn_fs_root_t *root,
+                          const apr_array_header_t *paths,
+                          apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *files = apr_array_make(scratch_pool, paths->nelts,
+                                             sizeof(dag_node_t *));
+  int i;
+
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      const char *path = APR_ARRAY_IDX(paths, i, const char *);
+      dag_node_t *node;
+
+      SVN_ERR(get_dag(&node, root, path, scratch_pool));
+      APR_ARRAY_PUSH(files, dag_node_t *) = node;
+    }
+
+  return svn_error_trace(svn_fs_fs__dag_prefetch_contents(files,
+                                                          scratch_pool));
+}
+
 /* --- End machinery for svn_fs_file_contents() ---  */
 
 
@@ -4579,6 +4602,7 @@ static root_vtable_t root_vtable = {
   fs_get_file_delta_stream,
   fs_merge,
   fs_get_mergeinfo,
+  fs_prefetch_file_contents,
 };
 
 /* Construct a new root object in FS, allocated from POOL.  */
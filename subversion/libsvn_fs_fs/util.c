@@ -25,6 +25,7 @@
 #include "svn_ctype.h"
 #include "svn_dirent_uri.h"
 #include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
 
 #include "fs_fs.h"
 #include "pack.h"
@@ -43,6 +44,17 @@ svn_fs_fs__is_packed_rev(svn_fs_t *fs,
   return (rev < ffd->min_unpacked_rev);
 }
 
+svn_boolean_t
+svn_fs_fs__is_stage_packed_rev(svn_fs_t *fs,
+                               svn_revnum_t rev)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  /* MIN_LOOSE_REV may lag behind MIN_UNPACKED_REV after a shard has been
+   * packed.  The shard pack takes precedence then. */
+  return (rev < ffd->min_loose_rev) && (rev >= ffd->min_unpacked_rev);
+}
+
 svn_boolean_t
 svn_fs_fs__is_packed_revprop(svn_fs_t *fs,
                              svn_revnum_t rev)
@@ -60,9 +72,31 @@ svn_fs_fs__packed_base_rev(svn_fs_t *fs,
                            svn_revnum_t revision)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
-  return (revision < ffd->min_unpacked_rev)
-       ? (revision - (revision % ffd->max_files_per_dir))
-       : revision;
+
+  if (revision < ffd->min_unpacked_rev)
+    return revision - (revision % ffd->max_files_per_dir);
+
+  /* Stage packs are aligned relative to the start of their shard. */
+  if (svn_fs_fs__is_stage_packed_rev(fs, revision))
+    return revision
+         - ((revision % ffd->max_files_per_dir) % ffd->pack_stage_size);
+
+  return revision;
+}
+
+svn_revnum_t
+svn_fs_fs__pack_size(svn_fs_t *fs,
+                     svn_revnum_t revision)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (revision < ffd->min_unpacked_rev)
+    return ffd->max_files_per_dir;
+
+  if (svn_fs_fs__is_stage_packed_rev(fs, revision))
+    return ffd->pack_stage_size;
+
+  return 1;
 }
 
 const char *
@@ -118,6 +152,22 @@ svn_fs_fs__path_rev_packed(svn_fs_t *fs,
                               kind, SVN_VA_NULL);
 }
 
+const char *
+svn_fs_fs__path_rev_stage_packed(svn_fs_t *fs,
+                                 svn_revnum_t rev,
+                                 apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  assert(ffd->pack_stage_size);
+  assert(svn_fs_fs__is_stage_packed_rev(fs, rev));
+
+  return svn_dirent_join(svn_fs_fs__path_rev_shard(fs, rev, pool),
+                         apr_psprintf(pool, "%ld" PATH_EXT_PACKED_SHARD,
+                                      svn_fs_fs__packed_base_rev(fs, rev)),
+                         pool);
+}
+
 const char *
 svn_fs_fs__path_rev_shard(svn_fs_t *fs, svn_revnum_t rev, apr_pool_t *pool)
 {
@@ -136,6 +186,7 @@ svn_fs_fs__path_rev(svn_fs_t *fs, svn_revnum_t rev, apr_pool_t *pool)
   fs_fs_data_t *ffd = fs->fsap_data;
 
   assert(! svn_fs_fs__is_packed_rev(fs, rev));
+  assert(! svn_fs_fs__is_stage_packed_rev(fs, rev));
 
   if (ffd->max_files_per_dir)
     {
@@ -172,6 +223,9 @@ svn_fs_fs__path_rev_absolute(svn_fs_t *fs,
   svn_boolean_t is_packed = ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT
                          && svn_fs_fs__is_packed_rev(fs, rev);
 
+  if (svn_fs_fs__is_stage_packed_rev(fs, rev))
+    return svn_fs_fs__path_rev_stage_packed(fs, rev, pool);
+
   return path_rev_absolute_internal(fs, rev, is_packed, pool);
 }
 
@@ -317,6 +371,26 @@ svn_fs_fs__path_txn_proto_rev_lock(svn_fs_t *fs,
                            PATH_REV_LOCK, pool);
 }
 
+const char *
+svn_fs_fs__path_txn_shard(svn_fs_t *fs,
+                          const svn_fs_fs__id_part_t *txn_id,
+                          const char *name,
+                          apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *txn_dir = svn_fs_fs__path_txn_dir(fs, txn_id, pool);
+
+  if (ffd->format < SVN_FS_FS__MIN_SHARDED_TXN_FORMAT)
+    return txn_dir;
+
+  return svn_dirent_join(txn_dir,
+                         apr_psprintf(pool, "%02x",
+                                      (unsigned)(svn__fnv1a_32(name,
+                                                               strlen(name))
+                                                 & 0xff)),
+                         pool);
+}
+
 const char *
 svn_fs_fs__path_txn_node_rev(svn_fs_t *fs,
                              const svn_fs_id_t *id,
@@ -325,8 +399,9 @@ svn_fs_fs__path_txn_node_rev(svn_fs_t *fs,
   char *filename = (char *)svn_fs_fs__id_unparse(id, pool)->data;
   *strrchr(filename, '.') = '\0';
 
-  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, svn_fs_fs__id_txn_id(id),
-                                                 pool),
+  return svn_dirent_join(svn_fs_fs__path_txn_shard(fs,
+                                                   svn_fs_fs__id_txn_id(id),
+                                                   filename, pool),
                          apr_psprintf(pool, PATH_PREFIX_NODE "%s",
                                       filename),
                          pool);
@@ -390,28 +465,72 @@ svn_fs_fs__check_file_buffer_numeric(const char *buf,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_fs_fs__read_min_unpacked_rev(svn_revnum_t *min_unpacked_rev,
-                                 svn_fs_t *fs,
-                                 apr_pool_t *pool)
+/* Set *MIN_UNPACKED_REV to the revision number stored in the first line
+ * of the 'min-unpacked-rev' file at PATH.  Unless MIN_LOOSE_REV is NULL,
+ * set it to the revision number in the second line or to 0 if there is
+ * none.  The latter is the case for repositories that have been upgraded
+ * to a format with pack stages but have not been stage-packed, yet.
+ * Use POOL for temporary allocations.
+ */
+static svn_error_t *
+read_pack_revs_file(svn_revnum_t *min_unpacked_rev,
+                    svn_revnum_t *min_loose_rev,
+                    const char *path,
+                    apr_pool_t *pool)
 {
   char buf[80];
   apr_file_t *file;
   apr_size_t len;
 
-  SVN_ERR(svn_io_file_open(&file,
-                           svn_fs_fs__path_min_unpacked_rev(fs, pool),
-                           APR_READ | APR_BUFFERED,
-                           APR_OS_DEFAULT,
-                           pool));
+  SVN_ERR(svn_io_file_open(&file, path, APR_READ | APR_BUFFERED,
+                           APR_OS_DEFAULT, pool));
   len = sizeof(buf);
   SVN_ERR(svn_io_read_length_line(file, buf, &len, pool));
+  SVN_ERR(svn_revnum_parse(min_unpacked_rev, buf, NULL));
+
+  if (min_loose_rev)
+    {
+      svn_error_t *err;
+
+      len = sizeof(buf);
+      err = svn_io_read_length_line(file, buf, &len, pool);
+      if (err && APR_STATUS_IS_EOF(err->apr_err))
+        {
+          svn_error_clear(err);
+          *min_loose_rev = 0;
+        }
+      else
+        {
+          SVN_ERR(err);
+          SVN_ERR(svn_revnum_parse(min_loose_rev, buf, NULL));
+        }
+    }
+
   SVN_ERR(svn_io_file_close(file, pool));
 
-  SVN_ERR(svn_revnum_parse(min_unpacked_rev, buf, NULL));
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__read_min_unpacked_rev(svn_revnum_t *min_unpacked_rev,
+                                 svn_revnum_t *min_loose_rev,
+                                 svn_fs_t *fs,
+                                 apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (min_loose_rev && ffd->format < SVN_FS_FS__MIN_PACK_STAGES_FORMAT)
+    {
+      *min_loose_rev = 0;
+      min_loose_rev = NULL;
+    }
+
+  return svn_error_trace(read_pack_revs_file(min_unpacked_rev,
+                            min_loose_rev,
+                            svn_fs_fs__path_min_unpacked_rev(fs, pool),
+                            pool));
+}
+
 svn_error_t *
 svn_fs_fs__update_min_unpacked_rev(svn_fs_t *fs,
                                    apr_pool_t *pool)
@@ -420,24 +539,31 @@ svn_fs_fs__update_min_unpacked_rev(svn_fs_t *fs,
 
   SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT);
 
-  return svn_fs_fs__read_min_unpacked_rev(&ffd->min_unpacked_rev, fs, pool);
+  return svn_error_trace(svn_fs_fs__read_min_unpacked_rev(
+                                              &ffd->min_unpacked_rev,
+                                              &ffd->min_loose_rev,
+                                              fs, pool));
 }
 
 svn_error_t *
 svn_fs_fs__write_min_unpacked_rev(svn_fs_t *fs,
-                                  svn_revnum_t revnum,
+                                  svn_revnum_t min_unpacked_rev,
+                                  svn_revnum_t min_loose_rev,
                                   apr_pool_t *scratch_pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
-  const char *final_path;
-  char buf[SVN_INT64_BUFFER_SIZE];
-  apr_size_t len = svn__i64toa(buf, revnum);
-  buf[len] = '\n';
+  const char *path = svn_fs_fs__path_min_unpacked_rev(fs, scratch_pool);
+  char buf[2 * SVN_INT64_BUFFER_SIZE];
+  apr_size_t len = svn__i64toa(buf, min_unpacked_rev);
+  buf[len++] = '\n';
 
-  final_path = svn_fs_fs__path_min_unpacked_rev(fs, scratch_pool);
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_STAGES_FORMAT)
+    {
+      len += svn__i64toa(buf + len, min_loose_rev);
+      buf[len++] = '\n';
+    }
 
-  SVN_ERR(svn_io_write_atomic2(final_path, buf, len + 1,
-                               final_path /* copy_perms */,
+  SVN_ERR(svn_io_write_atomic2(path, buf, len, path /* copy_perms */,
                                ffd->flush_to_disk, scratch_pool));
 
   return SVN_NO_ERROR;
@@ -673,6 +799,57 @@ svn_fs_fs__move_into_place(const char *old_filename,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__batch_move_into_place(const char *old_filename,
+                                 const char *new_filename,
+                                 const char *perms_reference,
+                                 svn_fs__batch_fsync_t *batch,
+                                 apr_pool_t *pool)
+{
+  svn_error_t *err;
+  apr_file_t *file;
+
+  /* Schedule the file contents for fsync.  Do this before copying the
+     permissions, which may make the file read-only.  The handle kept in
+     BATCH remains valid after the rename below. */
+  SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, old_filename, pool));
+
+  /* Copying permissions is a no-op on WIN32. */
+  SVN_ERR(svn_io_copy_perms(perms_reference, old_filename, pool));
+
+  /* Move the file into place. */
+  err = svn_io_file_rename2(old_filename, new_filename, FALSE, pool);
+  if (err && APR_STATUS_IS_EXDEV(err->apr_err))
+    {
+      svn_stream_t *source;
+      svn_stream_t *target;
+
+      /* Can't rename across devices; fall back to copying.  Let BATCH
+         create the target, so it gets scheduled for fsync together with
+         its directory entry. */
+      svn_error_clear(err);
+      SVN_ERR(svn_io_remove_file2(new_filename, TRUE, pool));
+
+      source = svn_stream_from_aprfile2(file, TRUE, pool);
+      SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, new_filename,
+                                            pool));
+      target = svn_stream_from_aprfile2(file, TRUE, pool);
+      SVN_ERR(svn_stream_copy3(source, target, NULL, NULL, pool));
+
+      SVN_ERR(svn_io_copy_perms(perms_reference, new_filename, pool));
+    }
+  else if (err)
+    {
+      return svn_error_trace(err);
+    }
+  else
+    {
+      SVN_ERR(svn_fs__batch_fsync_new_path(batch, new_filename, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_boolean_t
 svn_fs_fs__use_log_addressing(svn_fs_t *fs)
 {
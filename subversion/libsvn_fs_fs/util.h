@@ -25,6 +25,7 @@
 
 #include "svn_fs.h"
 #include "id.h"
+#include "private/svn_fs_util.h"
 
 /* Functions for dealing with recoverable errors on mutable files
  *
@@ -71,6 +72,12 @@ svn_boolean_t
 svn_fs_fs__is_packed_rev(svn_fs_t *fs,
                          svn_revnum_t rev);
 
+/* Return TRUE is REV is not packed but stored in a stage pack file in FS,
+ * FALSE otherwise. */
+svn_boolean_t
+svn_fs_fs__is_stage_packed_rev(svn_fs_t *fs,
+                               svn_revnum_t rev);
+
 /* Return TRUE is REV's props have been packed in FS, FALSE otherwise. */
 svn_boolean_t
 svn_fs_fs__is_packed_revprop(svn_fs_t *fs,
@@ -82,6 +89,12 @@ svn_revnum_t
 svn_fs_fs__packed_base_rev(svn_fs_t *fs,
                            svn_revnum_t revision);
 
+/* Return the number of revisions in the pack / rev file containing
+ * REVISION in filesystem FS.  For non-packed revs, this will be 1. */
+svn_revnum_t
+svn_fs_fs__pack_size(svn_fs_t *fs,
+                     svn_revnum_t revision);
+
 /* Return the full path of the rev shard directory that will contain
  * revision REV in FS.  Allocate the result in POOL.
  */
@@ -108,6 +121,14 @@ svn_fs_fs__path_rev_packed(svn_fs_t *fs,
                            const char *kind,
                            apr_pool_t *pool);
 
+/* Return the path of the stage pack file containing revision REV in FS.
+ * The result will be allocated in POOL.
+ */
+const char *
+svn_fs_fs__path_rev_stage_packed(svn_fs_t *fs,
+                                 svn_revnum_t rev,
+                                 apr_pool_t *pool);
+
 /* Return the full path of the "txn-current" file in FS.
  * The result will be allocated in POOL.
  */
@@ -227,6 +248,18 @@ svn_fs_fs__path_txn_proto_rev_lock(svn_fs_t *fs,
                                    const svn_fs_fs__id_part_t *txn_id,
                                    apr_pool_t *pool);
 
+/* Return the path of the sub-folder of transaction TXN_ID in FS that
+ * contains the file NAME.  For formats that don't shard transactions,
+ * this is the transaction folder itself.  The sub-folder gets created
+ * when the first file is written to it.  The result will be allocated
+ * in POOL.
+ */
+const char *
+svn_fs_fs__path_txn_shard(svn_fs_t *fs,
+                          const svn_fs_fs__id_part_t *txn_id,
+                          const char *name,
+                          apr_pool_t *pool);
+
 /* Return the path of the file containing the in-transaction node revision
  * identified by ID in FS.  The result will be allocated in POOL.
  */
@@ -288,11 +321,15 @@ svn_fs_fs__path_node_origin(svn_fs_t *fs,
                             apr_pool_t *pool);
 
 /* Set *MIN_UNPACKED_REV to the integer value read from the file returned
- * by #svn_fs_fs__path_min_unpacked_rev() for FS.
+ * by #svn_fs_fs__path_min_unpacked_rev() for FS.  Unless MIN_LOOSE_REV is
+ * NULL, set *MIN_LOOSE_REV to the oldest revision that is neither packed
+ * nor stage-packed as stored in the same file.  It will be 0 for formats
+ * that don't support pack stages.
  * Use POOL for temporary allocations.
  */
 svn_error_t *
 svn_fs_fs__read_min_unpacked_rev(svn_revnum_t *min_unpacked_rev,
+                                 svn_revnum_t *min_loose_rev,
                                  svn_fs_t *fs,
                                  apr_pool_t *pool);
 
@@ -309,7 +346,8 @@ svn_fs_fs__check_file_buffer_numeric(const char *buf,
                                      const char *title,
                                      apr_pool_t *pool);
 
-/* Re-read the MIN_UNPACKED_REV member of FS from disk.
+/* Re-read the MIN_UNPACKED_REV member of FS from disk.  If the format
+ * supports pack stages, re-read the MIN_LOOSE_REV member as well.
  * Use POOL for temporary allocations.
  */
 svn_error_t *
@@ -317,11 +355,13 @@ svn_fs_fs__update_min_unpacked_rev(svn_fs_t *fs,
                                    apr_pool_t *pool);
 
 /* Atomically update the 'min-unpacked-rev' file in FS to hold the specified
- * REVNUM.  Perform temporary allocations in SCRATCH_POOL.
+ * MIN_UNPACKED_REV and, if the format supports pack stages, MIN_LOOSE_REV.
+ * Perform temporary allocations in SCRATCH_POOL.
  */
 svn_error_t *
 svn_fs_fs__write_min_unpacked_rev(svn_fs_t *fs,
-                                  svn_revnum_t revnum,
+                                  svn_revnum_t min_unpacked_rev,
+                                  svn_revnum_t min_loose_rev,
                                   apr_pool_t *scratch_pool);
 
 /* Set *REV, *NEXT_NODE_ID and *NEXT_COPY_ID to the values read from the
@@ -396,6 +436,18 @@ svn_fs_fs__move_into_place(const char *old_filename,
                            svn_boolean_t flush_to_disk,
                            apr_pool_t *pool);
 
+/* Like svn_fs_fs__move_into_place() but instead of flushing the data
+   immediately, schedule the contents of the file and its new directory
+   entry for fsync in BATCH.  The caller must run BATCH before the moved
+   file may become visible to readers, e.g. before bumping 'current'.
+   Temporary allocations are from POOL. */
+svn_error_t *
+svn_fs_fs__batch_move_into_place(const char *old_filename,
+                                 const char *new_filename,
+                                 const char *perms_reference,
+                                 svn_fs__batch_fsync_t *batch,
+                                 apr_pool_t *pool);
+
 /* Return TRUE, iff FS uses logical addressing. */
 svn_boolean_t
 svn_fs_fs__use_log_addressing(svn_fs_t *fs);
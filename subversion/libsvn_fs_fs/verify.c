@@ -787,14 +787,6 @@ verify_revprops(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-static svn_revnum_t
-pack_size(svn_fs_t *fs, svn_revnum_t rev)
-{
-  fs_fs_data_t *ffd = fs->fsap_data;
-
-  return rev < ffd->min_unpacked_rev ? ffd->max_files_per_dir : 1;
-}
-
 /* Verify that on-disk representation has not been tempered with (in a way
  * that leaves the repository in a corrupted state).  This compares log-to-
  * phys with phys-to-log indexes, verifies the low-level checksums and
@@ -822,7 +814,7 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
     {
       svn_error_t *err = SVN_NO_ERROR;
 
-      svn_revnum_t count = pack_size(fs, revision);
+      svn_revnum_t count = svn_fs_fs__pack_size(fs, revision);
       svn_revnum_t pack_start = svn_fs_fs__packed_base_rev(fs, revision);
       svn_revnum_t pack_end = pack_start + count;
 
@@ -858,8 +850,7 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
       if (err)
         {
           svn_error_t *err2
-            = svn_fs_fs__read_min_unpacked_rev(&ffd->min_unpacked_rev,
-                                               fs, pool);
+            = svn_fs_fs__update_min_unpacked_rev(fs, pool);
 
           /* Be careful to not leak ERR. */
           if (err2)
@@ -867,7 +858,7 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
         }
 
       /* retry the whole shard if it got packed in the meantime */
-      if (err && count != pack_size(fs, revision))
+      if (err && count != svn_fs_fs__pack_size(fs, revision))
         {
           svn_error_clear(err);
 
@@ -22,7 +22,7 @@
 
 #include <apr_thread_pool.h>
 
-#include "batch_fsync.h"
+#include "private/svn_fs_util.h"
 #include "svn_pools.h"
 #include "svn_hash.h"
 #include "svn_dirent_uri.h"
@@ -44,7 +44,7 @@
       return svn_error_wrap_apr(status_, msg);  \
   }
 
-/* Entry type for the svn_fs_x__batch_fsync_t collection.  There is one
+/* Entry type for the svn_fs__batch_fsync_t collection.  There is one
  * instance per file handle.
  */
 typedef struct to_sync_t
@@ -64,7 +64,7 @@ typedef struct to_sync_t
 } to_sync_t;
 
 /* The actual collection object. */
-struct svn_fs_x__batch_fsync_t
+struct svn_fs__batch_fsync_t
 {
   /* Maps open file handles: C-string path to to_sync_t *. */
   apr_hash_t *files;
@@ -126,7 +126,7 @@ thread_pool_pre_cleanup(void *data)
 
 #endif
 
-/* Core implementation of svn_fs_x__batch_fsync_init. */
+/* Core implementation of svn_fs__batch_fsync_init. */
 static svn_error_t *
 create_thread_pool(void *baton,
                    apr_pool_t *owning_pool)
@@ -139,7 +139,7 @@ create_thread_pool(void *baton,
   /* This thread pool will get cleaned up automatically when GLOBAL_POOL
      gets cleared.  No additional cleanup callback is needed. */
   WRAP_APR_ERR(apr_thread_pool_create(&thread_pool, 0, MAX_THREADS, pool),
-               _("Can't create fsync thread pool in FSX"));
+               _("Can't create fsync thread pool"));
 
   /* Work around an APR bug:  The cleanup must happen in the pre-cleanup
      hook instead of the normal cleanup hook.  Otherwise, the sub-pools
@@ -160,7 +160,7 @@ create_thread_pool(void *baton,
 }
 
 svn_error_t *
-svn_fs_x__batch_fsync_init(apr_pool_t *owning_pool)
+svn_fs__batch_fsync_init(apr_pool_t *owning_pool)
 {
   /* Protect against multiple calls. */
   return svn_error_trace(svn_atomic__init_once(&thread_pool_initialized,
@@ -168,12 +168,12 @@ svn_fs_x__batch_fsync_init(apr_pool_t *owning_pool)
                                                NULL, owning_pool));
 }
 
-/* Destructor for svn_fs_x__batch_fsync_t.  Releases all global pool memory
+/* Destructor for svn_fs__batch_fsync_t.  Releases all global pool memory
  * and closes all open file handles. */
 static apr_status_t
 fsync_batch_cleanup(void *data)
 {
-  svn_fs_x__batch_fsync_t *batch = data;
+  svn_fs__batch_fsync_t *batch = data;
   apr_hash_index_t *hi;
 
   /* Close all files (implicitly) and release memory. */
@@ -189,11 +189,11 @@ fsync_batch_cleanup(void *data)
 }
 
 svn_error_t *
-svn_fs_x__batch_fsync_create(svn_fs_x__batch_fsync_t **result_p,
-                             svn_boolean_t flush_to_disk,
-                             apr_pool_t *result_pool)
+svn_fs__batch_fsync_create(svn_fs__batch_fsync_t **result_p,
+                           svn_boolean_t flush_to_disk,
+                           apr_pool_t *result_pool)
 {
-  svn_fs_x__batch_fsync_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  svn_fs__batch_fsync_t *result = apr_pcalloc(result_pool, sizeof(*result));
   result->files = svn_hash__make(result_pool);
   result->flush_to_disk = flush_to_disk;
 
@@ -212,7 +212,7 @@ svn_fs_x__batch_fsync_create(svn_fs_x__batch_fsync_t **result_p,
  */
 static svn_error_t *
 internal_open_file(apr_file_t **file,
-                   svn_fs_x__batch_fsync_t *batch,
+                   svn_fs__batch_fsync_t *batch,
                    const char *path,
                    apr_int32_t flags,
                    apr_pool_t *scratch_pool)
@@ -237,7 +237,7 @@ internal_open_file(apr_file_t **file,
    * exists.  If it doesn't, be sure to schedule parent folder updates, if
    * required on this platform.
    *
-   * See svn_fs_x__batch_fsync_new_path() for when such extra fsyncs may be
+   * See svn_fs__batch_fsync_new_path() for when such extra fsyncs may be
    * needed at all. */
 
 #ifdef SVN_ON_POSIX
@@ -281,7 +281,7 @@ internal_open_file(apr_file_t **file,
 #ifdef SVN_ON_POSIX
 
   if (is_new_file)
-    SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, path, scratch_pool));
+    SVN_ERR(svn_fs__batch_fsync_new_path(batch, path, scratch_pool));
 
 #endif
 
@@ -289,10 +289,10 @@ internal_open_file(apr_file_t **file,
 }
 
 svn_error_t *
-svn_fs_x__batch_fsync_open_file(apr_file_t **file,
-                                svn_fs_x__batch_fsync_t *batch,
-                                const char *filename,
-                                apr_pool_t *scratch_pool)
+svn_fs__batch_fsync_open_file(apr_file_t **file,
+                              svn_fs__batch_fsync_t *batch,
+                              const char *filename,
+                              apr_pool_t *scratch_pool)
 {
   apr_off_t offset = 0;
 
@@ -304,9 +304,9 @@ svn_fs_x__batch_fsync_open_file(apr_file_t **file,
 }
 
 svn_error_t *
-svn_fs_x__batch_fsync_new_path(svn_fs_x__batch_fsync_t *batch,
-                               const char *path,
-                               apr_pool_t *scratch_pool)
+svn_fs__batch_fsync_new_path(svn_fs__batch_fsync_t *batch,
+                             const char *path,
+                             apr_pool_t *scratch_pool)
 {
   apr_file_t *file;
 
@@ -356,8 +356,8 @@ flush_task(apr_thread_t *tid,
 }
 
 svn_error_t *
-svn_fs_x__batch_fsync_run(svn_fs_x__batch_fsync_t *batch,
-                          apr_pool_t *scratch_pool)
+svn_fs__batch_fsync_run(svn_fs__batch_fsync_t *batch,
+                        apr_pool_t *scratch_pool)
 {
   apr_hash_index_t *hi;
 
@@ -26,8 +26,10 @@
 
 #include "svn_hash.h"
 #include "svn_ctype.h"
+#include "svn_dirent_uri.h"
 #include "svn_sorts.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_io_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
@@ -45,7 +47,7 @@
 #include "reps.h"
 
 #include "../libsvn_fs/fs-loader.h"
-#include "../libsvn_delta/delta.h"  /* for SVN_DELTA_WINDOW_SIZE */
+#include "../libsvn_delta/delta.h"  /* for SVN_DELTA_LARGE_WINDOW_SIZE */
 
 #include "svn_private_config.h"
 
@@ -126,6 +128,8 @@ dbg__log_access(svn_fs_t *fs,
         description = "  (txdelta window)";
       else if (header->type == svn_fs_x__rep_self_delta)
         description = "  DELTA";
+      else if (header->type == svn_fs_x__rep_large)
+        description = "  LARGE";
       else
         description = apr_psprintf(scratch_pool,
                                    "  DELTA against %ld/%" APR_UINT64_T_FMT,
@@ -596,7 +600,7 @@ create_rep_state_body(rep_state_t **rep_state,
    */
   estimated_window_storage
     = 4 * (  (rep->expanded_size ? rep->expanded_size : rep->size)
-           + SVN_DELTA_WINDOW_SIZE);
+           + SVN_DELTA_LARGE_WINDOW_SIZE);
   estimated_window_storage = MIN(estimated_window_storage, APR_SIZE_MAX);
 
   rs->window_cache =    ffd->txdelta_window_cache
@@ -1210,6 +1214,16 @@ build_rep_list(apr_array_header_t **list,
           break;
         }
 
+      /* Out-of-line fulltexts never get used as delta bases. */
+      if (rep_header->type == svn_fs_x__rep_large)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Delta base r%ld item %s is stored "
+                                   "out-of-line"),
+                                 svn_fs_x__get_revnum(rep.id.change_set),
+                                 apr_psprintf(scratch_pool,
+                                              "%" APR_UINT64_T_FMT,
+                                              rep.id.number));
+
       /* Push this rep onto the list.  If it's self-compressed, we're done. */
       APR_ARRAY_PUSH(*list, rep_state_t *) = rs;
       if (rep_header->type == svn_fs_x__rep_self_delta)
@@ -1573,11 +1587,15 @@ init_rep_state(rep_state_t *rs,
   rs->start = entry->offset + rs->header_size;
   rs->current = 4;
   rs->size = entry->size - rep_header->header_size - 7;
-  rs->ver = 1;
+  rs->ver = -1;
   rs->chunk_index = 0;
   rs->window_cache = ffd->txdelta_window_cache;
   rs->combined_cache = ffd->combined_window_cache;
 
+  /* Large reps have no svndiff data and thus no version to read. */
+  if (rs->size > 0)
+    SVN_ERR(auto_read_diff_version(rs, result_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -2108,6 +2126,145 @@ rep_read_contents(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Baton type for large_read_contents(). */
+typedef struct large_read_baton_t
+{
+  /* The out-of-line fulltext file. */
+  svn_stream_t *file_stream;
+
+  /* Path of that file, used in error messages. */
+  const char *path;
+
+  /* Checksums over the data read so far. */
+  svn_checksum_ctx_t *md5_ctx;
+  svn_checksum_ctx_t *sha1_ctx;
+
+  /* The expected checksums. */
+  svn_checksum_t md5_expected;
+  svn_checksum_t sha1_expected;
+
+  /* Number of bytes expected but not read yet. */
+  svn_filesize_t remaining;
+
+  /* Set once the checksums have been compared. */
+  svn_boolean_t checked;
+
+  apr_pool_t *pool;
+} large_read_baton_t;
+
+/* Return an error if the data read through LB does not match the expected
+ * checksums. */
+static svn_error_t *
+large_read_verify(large_read_baton_t *lb)
+{
+  svn_checksum_t *md5_actual, *sha1_actual;
+
+  lb->checked = TRUE;
+  if (lb->remaining != 0)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Out-of-line fulltext '%s' has the wrong "
+                               "size"),
+                             svn_dirent_local_style(lb->path, lb->pool));
+
+  SVN_ERR(svn_checksum_final(&md5_actual, lb->md5_ctx, lb->pool));
+  SVN_ERR(svn_checksum_final(&sha1_actual, lb->sha1_ctx, lb->pool));
+
+  if (!svn_checksum_match(md5_actual, &lb->md5_expected))
+    return svn_error_create(SVN_ERR_FS_CORRUPT,
+             svn_checksum_mismatch_err(&lb->md5_expected, md5_actual,
+               lb->pool,
+               _("Checksum mismatch while reading out-of-line fulltext "
+                 "'%s'"),
+               svn_dirent_local_style(lb->path, lb->pool)),
+             NULL);
+
+  if (!svn_checksum_match(sha1_actual, &lb->sha1_expected))
+    return svn_error_create(SVN_ERR_FS_CORRUPT,
+             svn_checksum_mismatch_err(&lb->sha1_expected, sha1_actual,
+               lb->pool,
+               _("Checksum mismatch while reading out-of-line fulltext "
+                 "'%s'"),
+               svn_dirent_local_style(lb->path, lb->pool)),
+             NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* BATON is of type `large_read_baton_t'; read the next *LEN bytes of the
+   out-of-line fulltext and store them in *BUF.  Sum as we read and verify
+   the MD5 and SHA1 sums at the end. */
+static svn_error_t *
+large_read_contents(void *baton,
+                    char *buf,
+                    apr_size_t *len)
+{
+  large_read_baton_t *lb = baton;
+  apr_size_t requested = *len;
+
+  SVN_ERR(svn_stream_read_full(lb->file_stream, buf, len));
+  if (lb->checked)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_checksum_update(lb->md5_ctx, buf, *len));
+  SVN_ERR(svn_checksum_update(lb->sha1_ctx, buf, *len));
+  lb->remaining -= *len;
+
+  /* Check as soon as we reached either end of the data. */
+  if (lb->remaining <= 0 || *len < requested)
+    SVN_ERR(large_read_verify(lb));
+
+  return SVN_NO_ERROR;
+}
+
+/* BATON is of type `large_read_baton_t'; close the underlying file. */
+static svn_error_t *
+large_read_contents_close(void *baton)
+{
+  large_read_baton_t *lb = baton;
+
+  return svn_error_trace(svn_stream_close(lb->file_stream));
+}
+
+/* Set *CONTENTS_P to a stream returning the out-of-line fulltext of the
+ * large REP in FS.  Reading from the stream verifies the checksums of
+ * the data.  The file itself remains accessible via svn_stream__aprfile(),
+ * in which case the caller is responsible for the checks.  Allocate the
+ * stream in RESULT_POOL. */
+static svn_error_t *
+get_large_contents(svn_stream_t **contents_p,
+                   svn_fs_t *fs,
+                   svn_fs_x__representation_t *rep,
+                   apr_pool_t *result_pool)
+{
+  large_read_baton_t *lb = apr_pcalloc(result_pool, sizeof(*lb));
+  apr_file_t *file;
+
+  lb->path = svn_fs_x__path_large(fs, rep->sha1_digest, result_pool);
+  SVN_ERR(svn_io_file_open(&file, lb->path,
+                           APR_READ | APR_BUFFERED | APR_SENDFILE_ENABLED,
+                           APR_OS_DEFAULT, result_pool));
+
+  lb->file_stream = svn_stream_from_aprfile2(file, FALSE, result_pool);
+  lb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, result_pool);
+  lb->sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, result_pool);
+  lb->md5_expected.kind = svn_checksum_md5;
+  lb->md5_expected.digest = rep->md5_digest;
+  lb->sha1_expected.kind = svn_checksum_sha1;
+  lb->sha1_expected.digest = rep->sha1_digest;
+  lb->remaining = rep->expanded_size;
+  lb->pool = result_pool;
+
+  *contents_p = svn_stream_create(lb, result_pool);
+  svn_stream_set_read2(*contents_p, NULL /* only full read support */,
+                       large_read_contents);
+  svn_stream_set_close(*contents_p, large_read_contents_close);
+
+  /* Allow the server layers to send the data directly from disk. */
+  svn_stream__set_aprfile(*contents_p, file, -1);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_x__get_contents(svn_stream_t **contents_p,
                        svn_fs_t *fs,
@@ -2119,6 +2276,11 @@ svn_fs_x__get_contents(svn_stream_t **contents_p,
     {
       *contents_p = svn_stream_empty(result_pool);
     }
+  else if (rep->large)
+    {
+      /* This bypasses our caches. */
+      SVN_ERR(get_large_contents(contents_p, fs, rep, result_pool));
+    }
   else
     {
       svn_fs_x__data_t *ffd = fs->fsap_data;
@@ -2364,6 +2526,25 @@ get_storaged_delta_stream(rep_state_t *rep_state,
                                    delta_read_md5_digest, result_pool);
 }
 
+/* Set *STANDARD_WINDOWS to TRUE if the delta windows in REP_STATE use an
+ * svndiff version that any consumer accepts, i.e. if they don't exceed
+ * the standard window size.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+has_standard_windows(svn_boolean_t *standard_windows,
+                     rep_state_t *rep_state,
+                     apr_pool_t *scratch_pool)
+{
+  SVN_ERR(auto_open_shared_file(rep_state->sfile));
+  SVN_ERR(auto_set_start_offset(rep_state, scratch_pool));
+  SVN_ERR(auto_read_diff_version(rep_state, scratch_pool));
+
+  *standard_windows
+    = rep_state->ver < SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_x__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
                                 svn_fs_t *fs,
@@ -2398,9 +2579,15 @@ svn_fs_x__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
                  == svn_fs_x__get_revnum(source->data_rep->id.change_set)
               && rep_header->base_item_index == source->data_rep->id.number)
             {
-              *stream_p = get_storaged_delta_stream(rep_state, target,
-                                                    result_pool);
-              return SVN_NO_ERROR;
+              svn_boolean_t standard_windows;
+              SVN_ERR(has_standard_windows(&standard_windows, rep_state,
+                                           scratch_pool));
+              if (standard_windows)
+                {
+                  *stream_p = get_storaged_delta_stream(rep_state, target,
+                                                        result_pool);
+                  return SVN_NO_ERROR;
+                }
             }
         }
       else if (!source)
@@ -2410,9 +2597,15 @@ svn_fs_x__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
              format. */
           if (rep_header->type == svn_fs_x__rep_self_delta)
             {
-              *stream_p = get_storaged_delta_stream(rep_state, target,
-                                                    result_pool);
-              return SVN_NO_ERROR;
+              svn_boolean_t standard_windows;
+              SVN_ERR(has_standard_windows(&standard_windows, rep_state,
+                                           scratch_pool));
+              if (standard_windows)
+                {
+                  *stream_p = get_storaged_delta_stream(rep_state, target,
+                                                        result_pool);
+                  return SVN_NO_ERROR;
+                }
             }
         }
 
@@ -2442,32 +2635,6 @@ svn_fs_x__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
   return SVN_NO_ERROR;
 }
 
-/* Return TRUE when all svn_fs_x__dirent_t* in ENTRIES are already sorted
-   by their respective name. */
-static svn_boolean_t
-sorted(apr_array_header_t *entries)
-{
-  int i;
-
-  const svn_fs_x__dirent_t * const *dirents = (const void *)entries->elts;
-  for (i = 0; i < entries->nelts-1; ++i)
-    if (strcmp(dirents[i]->name, dirents[i+1]->name) > 0)
-      return FALSE;
-
-  return TRUE;
-}
-
-/* Compare the names of the two dirents given in **A and **B. */
-static int
-compare_dirents(const void *a,
-                const void *b)
-{
-  const svn_fs_x__dirent_t *lhs = *((const svn_fs_x__dirent_t * const *) a);
-  const svn_fs_x__dirent_t *rhs = *((const svn_fs_x__dirent_t * const *) b);
-
-  return strcmp(lhs->name, rhs->name);
-}
-
 /* Compare the name of the dirents given in **A with the C string in *B. */
 static int
 compare_dirent_name(const void *a,
@@ -2479,111 +2646,6 @@ compare_dirent_name(const void *a,
   return strcmp(lhs->name, rhs);
 }
 
-/* Into ENTRIES, parse all directories entries from the serialized form in
- * DATA.  If INCREMENTAL is TRUE, read until the end of the STREAM and
- * update the data.  ID is provided for nicer error messages.
- *
- * The contents of DATA will be shared with the items in ENTRIES, i.e. it
- * must not be modified afterwards and must remain valid as long as ENTRIES
- * is valid.  Use SCRATCH_POOL for temporary allocations.
- */
-static svn_error_t *
-parse_dir_entries(apr_array_header_t **entries_p,
-                  const svn_stringbuf_t *data,
-                  svn_boolean_t incremental,
-                  const svn_fs_x__id_t *id,
-                  apr_pool_t *result_pool,
-                  apr_pool_t *scratch_pool)
-{
-  const apr_byte_t *p = (const apr_byte_t *)data->data;
-  const apr_byte_t *end = p + data->len;
-  apr_uint64_t count;
-  apr_hash_t *hash = incremental ? svn_hash__make(scratch_pool) : NULL;
-  apr_array_header_t *entries;
-
-  /* Construct the resulting container. */
-  p = svn__decode_uint(&count, p, end);
-  if (count > INT_MAX)
-    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                             _("Directory for '%s' is too large"),
-                             svn_fs_x__id_unparse(id, scratch_pool)->data);
-
-  entries = apr_array_make(result_pool, (int)count,
-                           sizeof(svn_fs_x__dirent_t *));
-
-  while (p != end)
-    {
-      apr_size_t len;
-      svn_fs_x__dirent_t *dirent;
-      dirent = apr_pcalloc(result_pool, sizeof(*dirent));
-
-      /* The part of the serialized entry that is not the name will be
-       * about 6 bytes or less.  Since APR allocates with an 8 byte
-       * alignment (4 bytes loss on average per string), simply using
-       * the name string in DATA already gives us near-optimal memory
-       * usage. */
-      dirent->name = (const char *)p;
-      len = strlen(dirent->name);
-      p += len + 1;
-      if (p == end)
-        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                            _("Directory entry missing kind in '%s'"),
-                            svn_fs_x__id_unparse(id, scratch_pool)->data);
-
-      dirent->kind = (svn_node_kind_t)*(p++);
-      if (p == end)
-        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                            _("Directory entry missing change set in '%s'"),
-                            svn_fs_x__id_unparse(id, scratch_pool)->data);
-
-      p = svn__decode_int(&dirent->id.change_set, p, end);
-      if (p == end)
-        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                            _("Directory entry missing item number in '%s'"),
-                            svn_fs_x__id_unparse(id, scratch_pool)->data);
-
-      p = svn__decode_uint(&dirent->id.number, p, end);
-
-      /* In incremental mode, update the hash; otherwise, write to the
-       * final array. */
-      if (incremental)
-        {
-          /* Insertion / update or a deletion? */
-          if (svn_fs_x__id_used(&dirent->id))
-            apr_hash_set(hash, dirent->name, len, dirent);
-          else
-            apr_hash_set(hash, dirent->name, len, NULL);
-        }
-      else
-        {
-          APR_ARRAY_PUSH(entries, svn_fs_x__dirent_t *) = dirent;
-        }
-    }
-
-  if (incremental)
-    {
-      /* Convert container into a sorted array. */
-      apr_hash_index_t *hi;
-      for (hi = apr_hash_first(scratch_pool, hash); hi; hi = apr_hash_next(hi))
-        APR_ARRAY_PUSH(entries, svn_fs_x__dirent_t *) = apr_hash_this_val(hi);
-
-      if (!sorted(entries))
-        svn_sort__array(entries, compare_dirents);
-    }
-  else
-    {
-      /* Check that we read the expected amount of entries. */
-      if ((apr_uint64_t)entries->nelts != count)
-        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                            _("Directory length mismatch in '%s'"),
-                            svn_fs_x__id_unparse(id, scratch_pool)->data);
-    }
-
- *entries_p = entries;
-
-  return SVN_NO_ERROR;
-}
-
 /* For directory NODEREV in FS, return the *FILESIZE of its in-txn
  * representation.  If the directory representation is committed data,
  * set *FILESIZE to SVN_INVALID_FILESIZE. Use SCRATCH_POOL for temporaries.
@@ -2615,24 +2677,28 @@ get_txn_dir_info(svn_filesize_t *filesize,
   return SVN_NO_ERROR;
 }
 
-/* Fetch the contents of a directory into DIR.  Values are stored
-   as filename to string mappings; further conversion is necessary to
-   convert them into svn_fs_x__dirent_t values. */
+/* Read the serialized contents of directory NODEREV in FS into *TEXT,
+   allocated in RESULT_POOL.  Set *INCREMENTAL to TRUE, if that is the
+   "children" file of a mutable directory and set *TXN_FILESIZE to its
+   size.  Otherwise, set them to FALSE and SVN_INVALID_FILESIZE,
+   respectively.  If the directory is empty and has no representation,
+   set *TEXT to NULL.  Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
-get_dir_contents(svn_fs_x__dir_data_t *dir,
-                 svn_fs_t *fs,
-                 svn_fs_x__noderev_t *noderev,
-                 apr_pool_t *result_pool,
-                 apr_pool_t *scratch_pool)
+get_dir_text(svn_stringbuf_t **text,
+             svn_boolean_t *incremental,
+             svn_filesize_t *txn_filesize,
+             svn_fs_t *fs,
+             svn_fs_x__noderev_t *noderev,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
 {
   svn_stream_t *contents;
   const svn_fs_x__id_t *id = &noderev->noderev_id;
   apr_size_t len;
-  svn_stringbuf_t *text;
-  svn_boolean_t incremental;
 
   /* Initialize the result. */
-  dir->txn_filesize = SVN_INVALID_FILESIZE;
+  *txn_filesize = SVN_INVALID_FILESIZE;
+  *incremental = FALSE;
 
   /* Read dir contents - unless there is none in which case we are done. */
   if (noderev->data_rep
@@ -2652,12 +2718,12 @@ get_dir_contents(svn_fs_x__dir_data_t *dir,
                                APR_OS_DEFAULT, scratch_pool));
 
       /* Obtain txn children file size. */
-      SVN_ERR(svn_io_file_size_get(&dir->txn_filesize, file, scratch_pool));
-      len = (apr_size_t)dir->txn_filesize;
+      SVN_ERR(svn_io_file_size_get(txn_filesize, file, scratch_pool));
+      len = (apr_size_t)*txn_filesize;
 
       /* Finally, provide stream access to FILE. */
       contents = svn_stream_from_aprfile2(file, FALSE, scratch_pool);
-      incremental = TRUE;
+      *incremental = TRUE;
     }
   else if (noderev->data_rep)
     {
@@ -2665,28 +2731,68 @@ get_dir_contents(svn_fs_x__dir_data_t *dir,
       len = noderev->data_rep->expanded_size;
       SVN_ERR(svn_fs_x__get_contents(&contents, fs, noderev->data_rep,
                                      FALSE, scratch_pool));
-      incremental = FALSE;
     }
   else
     {
       /* Empty representation == empty directory. */
-      dir->entries = apr_array_make(result_pool, 0,
-                                    sizeof(svn_fs_x__dirent_t *));
+      *text = NULL;
       return SVN_NO_ERROR;
     }
 
   /* Read the whole stream contents into a single buffer.
-   * Due to our LEN hint, no allocation overhead occurs.
-   *
-   * Also, a large portion of TEXT will be file / dir names which we
-   * directly reference from DIR->ENTRIES instead of copying them.
-   * Hence, we need to use the RESULT_POOL here. */
-  SVN_ERR(svn_stringbuf_from_stream(&text, contents, len, result_pool));
+   * Due to our LEN hint, no allocation overhead occurs. */
+  SVN_ERR(svn_stringbuf_from_stream(text, contents, len, result_pool));
   SVN_ERR(svn_stream_close(contents));
 
-  /* de-serialize hash */
-  SVN_ERR(parse_dir_entries(&dir->entries, text, incremental, id,
-                            result_pool, scratch_pool));
+  return SVN_NO_ERROR;
+}
+
+/* Parse the serialized directory TEXT as returned by get_dir_text() for
+   NODEREV into DIR.  INCREMENTAL and TXN_FILESIZE are the respective
+   outputs of get_dir_text().  DIR->ENTRIES will reference TEXT, so the
+   latter must live in RESULT_POOL or a pool that outlives it.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+parse_dir_text(svn_fs_x__dir_data_t *dir,
+               svn_stringbuf_t *text,
+               svn_boolean_t incremental,
+               svn_filesize_t txn_filesize,
+               svn_fs_x__noderev_t *noderev,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  dir->txn_filesize = txn_filesize;
+  if (text)
+    SVN_ERR(svn_fs_x__parse_dir_entries(&dir->entries, text, incremental,
+                                        &noderev->noderev_id, result_pool,
+                                        scratch_pool));
+  else
+    dir->entries = apr_array_make(result_pool, 0,
+                                  sizeof(svn_fs_x__dirent_t *));
+
+  return SVN_NO_ERROR;
+}
+
+/* Fetch the contents of a directory into DIR.  The entries will be sorted
+   by name. */
+static svn_error_t *
+get_dir_contents(svn_fs_x__dir_data_t *dir,
+                 svn_fs_t *fs,
+                 svn_fs_x__noderev_t *noderev,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *text;
+  svn_boolean_t incremental;
+  svn_filesize_t txn_filesize;
+
+  /* A large portion of TEXT will be file / dir names which we directly
+   * reference from DIR->ENTRIES instead of copying them.  Hence, we need
+   * to use the RESULT_POOL here. */
+  SVN_ERR(get_dir_text(&text, &incremental, &txn_filesize, fs, noderev,
+                       result_pool, scratch_pool));
+  SVN_ERR(parse_dir_text(dir, text, incremental, txn_filesize, noderev,
+                         result_pool, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -2822,17 +2928,32 @@ svn_fs_x__rep_contents_dir_entry(svn_fs_x__dirent_t **dirent,
       svn_fs_x__dirent_t *entry;
       svn_fs_x__dirent_t *entry_copy = NULL;
       svn_fs_x__dir_data_t dir;
-
-      /* Read in the directory contents. */
-      SVN_ERR(get_dir_contents(&dir, fs, noderev, scratch_pool,
-                               scratch_pool));
-
-      /* Update the cache, if we are to use one.
-       *
-       * Don't even attempt to serialize very large directories; it would
+      svn_stringbuf_t *text;
+      svn_boolean_t incremental;
+      int count = 0;
+
+      /* Read in the serialized directory contents. */
+      SVN_ERR(get_dir_text(&text, &incremental, &filesize, fs, noderev,
+                           scratch_pool, scratch_pool));
+      if (text)
+        SVN_ERR(svn_fs_x__dir_entry_count(&count, text, &noderev->noderev_id,
+                                          scratch_pool));
+
+      /* Don't even attempt to serialize very large directories; it would
        * cause an unnecessary memory allocation peak.  150 bytes / entry is
-       * about right. */
-      if (cache && svn_cache__is_cachable(cache, 150 * dir.entries->nelts))
+       * about right.  Instead, look up the entry directly in TEXT. */
+      if (text && !(cache && svn_cache__is_cachable(cache, 150 * count)))
+        return svn_error_trace(
+                 svn_fs_x__find_serialized_dir_entry(dirent, text,
+                                                     incremental, name,
+                                                     &noderev->noderev_id,
+                                                     result_pool,
+                                                     scratch_pool));
+
+      /* Update the cache, if we are to use one. */
+      SVN_ERR(parse_dir_text(&dir, text, incremental, filesize, noderev,
+                             scratch_pool, scratch_pool));
+      if (cache)
         SVN_ERR(svn_cache__set(cache, &key, &dir, scratch_pool));
 
       /* find desired entry and return a copy in POOL, if found */
@@ -70,7 +70,8 @@ svn_fs_x__rep_chain_length(int *chain_length,
 /* Set *CONTENTS_P to be a readable svn_stream_t that receives the text
    representation REP as seen in filesystem FS.  If CACHE_FULLTEXT is
    not set, bypass fulltext cache lookup for this rep and don't put the
-   reconstructed fulltext into cache.
+   reconstructed fulltext into cache.  For large reps, this will be a
+   plain file stream, i.e. svn_stream__aprfile() returns its file.
    Allocate *CONTENT_P in RESULT_POOL. */
 svn_error_t *
 svn_fs_x__get_contents(svn_stream_t **contents_p,
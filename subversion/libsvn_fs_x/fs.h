@@ -76,6 +76,7 @@ extern "C" {
                                                     to-log index */
 /* If you change this, look at tests/svn_test_fs.c(maybe_install_fsx_conf) */
 #define PATH_CONFIG           "fsx.conf"         /* Configuration */
+#define PATH_LARGE_DIR        "large"            /* Out-of-line fulltexts */
 
 /* Names of special files and file extensions for transactions */
 #define PATH_CHANGES       "changes"       /* Records changes made so far */
@@ -104,6 +105,7 @@ extern "C" {
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
+#define CONFIG_OPTION_LARGE_FILE_THRESHOLD "large-file-threshold"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
 #define CONFIG_OPTION_COMPRESS_PACKED_REVPROPS  "compress-packed-revprops"
@@ -121,11 +123,11 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_x__create() as well.
  */
-#define SVN_FS_X__FORMAT_NUMBER   2
+#define SVN_FS_X__FORMAT_NUMBER   3
 
 /* Latest experimental format number.  Experimental formats are only
    compatible with themselves. */
-#define SVN_FS_X__EXPERIMENTAL_FORMAT_NUMBER   2
+#define SVN_FS_X__EXPERIMENTAL_FORMAT_NUMBER   3
 
 /* On most operating systems apr implements file locks per process, not
    per file.  On Windows apr implements the locking as per file handle
@@ -394,6 +396,10 @@ typedef struct svn_fs_x__data_t
   /* Compression level to use with txdelta storage format in new revs. */
   int delta_compression_level;
 
+  /* File reps whose deltified size exceeds this number of bytes will be
+   * stored out-of-line as plain fulltext.  0 disables that feature. */
+  apr_int64_t large_file_threshold;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
@@ -456,6 +462,11 @@ typedef struct svn_fs_x__representation_t
   /* The size of the fulltext of the representation. */
   svn_filesize_t expanded_size;
 
+  /* If set, the fulltext is stored in a separate file under PATH_LARGE_DIR,
+     named after SHA1_DIGEST, and the rev / pack file only contains a stub.
+     Such reps are never used as delta bases.  Implies HAS_SHA1. */
+  svn_boolean_t large;
+
 } svn_fs_x__representation_t;
 
 
@@ -71,6 +71,11 @@
    Values < 1 disable deltification. */
 #define SVN_FS_X_MAX_DELTIFICATION_WALK 1023
 
+/* File representations whose deltified size exceeds this many kBytes
+   will be stored as plain fulltext in separate files.
+   Values < 1 disable that feature. */
+#define SVN_FS_X_LARGE_FILE_THRESHOLD 0x4000
+
 
 
 
@@ -288,6 +293,11 @@ read_config(svn_fs_x__data_t *ffd,
   ffd->delta_compression_level
     = (int)MIN(MAX(SVN_DELTA_COMPRESSION_LEVEL_NONE, compression_level),
                 SVN_DELTA_COMPRESSION_LEVEL_MAX);
+  SVN_ERR(svn_config_get_int64(config, &ffd->large_file_threshold,
+                               CONFIG_SECTION_DELTIFICATION,
+                               CONFIG_OPTION_LARGE_FILE_THRESHOLD,
+                               SVN_FS_X_LARGE_FILE_THRESHOLD));
+  ffd->large_file_threshold = MAX(0, ffd->large_file_threshold) * 1024;
 
   /* Initialize revprop packing settings in ffd. */
   SVN_ERR(svn_config_get_bool(config, &ffd->compress_packed_revprops,
@@ -457,6 +467,16 @@ write_config(svn_fs_t *fs,
 "### and 0 disabling it altogether."                                         NL
 "### The default value is 5."                                                NL
 "# " CONFIG_OPTION_COMPRESSION_LEVEL " = 5"                                  NL
+"###"                                                                        NL
+"### Large binaries tend to deltify badly and dilute the contents of rev"    NL
+"### and pack files, which makes caching and prefetching less effective."    NL
+"### File representations whose deltified size exceeds this threshold (in"   NL
+"### kBytes) will be stored as plain fulltext in a separate file within"     NL
+"### the 'large' folder.  Future revisions will not be deltified against"    NL
+"### them and servers may send their contents directly from disk."           NL
+"### A value of 0 disables this feature."                                    NL
+"### The default value is 16384."                                            NL
+"# " CONFIG_OPTION_LARGE_FILE_THRESHOLD " = 16384"                           NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
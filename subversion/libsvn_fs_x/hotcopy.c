@@ -624,6 +624,16 @@ hotcopy_body(void *baton,
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
+  /* Out-of-line fulltexts are immutable and may be referenced by any of
+   * the revisions to copy.  So, copy them first. */
+  src_subdir = svn_dirent_join(src_fs->path, PATH_LARGE_DIR, scratch_pool);
+  SVN_ERR(svn_io_check_path(src_subdir, &kind, scratch_pool));
+  if (kind == svn_node_dir)
+    SVN_ERR(hotcopy_io_copy_dir_recursively(NULL, src_subdir, dst_fs->path,
+                                            PATH_LARGE_DIR, TRUE,
+                                            cancel_func, cancel_baton,
+                                            scratch_pool));
+
   /* Split the logic for new and old FS formats. The latter is much simpler
    * due to the absence of sharding and packing. However, it requires special
    * care when updating the 'current' file (which contains not just the
@@ -63,6 +63,10 @@
 
 /* Kinds of representation. */
 #define REP_DELTA          "DELTA"
+#define REP_LARGE          "LARGE"
+
+/* Marker at the end of a representation line for out-of-line fulltexts. */
+#define REP_LARGE_FLAG     "L"
 
 /* An arbitrary maximum path length, so clients can't run us out of memory
  * by giving us arbitrarily large paths. */
@@ -350,6 +354,17 @@ svn_fs_x__parse_representation(svn_fs_x__representation_t **rep_p,
   if (checksum)
     memcpy(rep->sha1_digest, checksum->digest, sizeof(rep->sha1_digest));
 
+  /* Fulltexts stored outside the rev / pack files are marked explicitly. */
+  str = svn_cstring_tokenize(" ", &string);
+  if (str == NULL)
+    return SVN_NO_ERROR;
+
+  if (strcmp(str, REP_LARGE_FLAG) != 0 || !rep->has_sha1)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed text representation offset line in node-rev"));
+
+  rep->large = TRUE;
+
   return SVN_NO_ERROR;
 }
 
@@ -646,13 +661,14 @@ svn_fs_x__unparse_representation(svn_fs_x__representation_t *rep,
   return svn_stringbuf_createf
           (result_pool,
            "%" APR_INT64_T_FMT " %" APR_UINT64_T_FMT " %" SVN_FILESIZE_T_FMT
-           " %" SVN_FILESIZE_T_FMT " %s %s",
+           " %" SVN_FILESIZE_T_FMT " %s %s%s",
            rep->id.change_set, rep->id.number, rep->size,
            rep->expanded_size,
            format_digest(rep->md5_digest, svn_checksum_md5,
                          FALSE, scratch_pool),
            format_digest(rep->sha1_digest, svn_checksum_sha1,
-                         !rep->has_sha1, scratch_pool));
+                         !rep->has_sha1, scratch_pool),
+           rep->large ? " " REP_LARGE_FLAG : "");
 }
 
 
@@ -751,6 +767,13 @@ svn_fs_x__read_rep_header(svn_fs_x__rep_header_t **header,
       return SVN_NO_ERROR;
     }
 
+  if (strcmp(buffer->data, REP_LARGE) == 0)
+    {
+      /* The fulltext has been stored in a separate file. */
+      (*header)->type = svn_fs_x__rep_large;
+      return SVN_NO_ERROR;
+    }
+
   (*header)->type = svn_fs_x__rep_delta;
 
   /* We have hopefully a DELTA vs. a non-empty base revision. */
@@ -793,6 +816,10 @@ svn_fs_x__write_rep_header(svn_fs_x__rep_header_t *header,
         text = REP_DELTA "\n";
         break;
 
+      case svn_fs_x__rep_large:
+        text = REP_LARGE "\n";
+        break;
+
       default:
         text = apr_psprintf(scratch_pool, REP_DELTA " %ld %" APR_OFF_T_FMT
                                           " %" SVN_FILESIZE_T_FMT "\n",
@@ -1242,3 +1269,430 @@ svn_fs_x__write_properties(svn_stream_t *stream,
 
   return SVN_NO_ERROR;
 }
+
+/* Directory representations start with the number of entries, followed
+ * by an index of DIR_INDEX_ENTRY_SIZE bytes per entry.  Each index entry
+ * is the offset of the respective directory entry relative to the end of
+ * the index.  The directory entries themselves follow, sorted by name.
+ *
+ * The "children" file of a mutable directory in a transaction appends a
+ * sequence of further entries to that.  They are not sorted and each one
+ * replaces, adds or - if the ID is unused - deletes the entry of the same
+ * name.
+ */
+#define DIR_INDEX_ENTRY_SIZE 4
+
+/* Return the directory index entry encoded at P. */
+static apr_uint32_t
+decode_dir_index_entry(const apr_byte_t *p)
+{
+  return (apr_uint32_t)p[0]
+       | ((apr_uint32_t)p[1] << 8)
+       | ((apr_uint32_t)p[2] << 16)
+       | ((apr_uint32_t)p[3] << 24);
+}
+
+/* Encode VALUE as directory index entry into the buffer at P. */
+static void
+encode_dir_index_entry(apr_byte_t *p,
+                       apr_uint32_t value)
+{
+  p[0] = (apr_byte_t)(value & 0xff);
+  p[1] = (apr_byte_t)((value >> 8) & 0xff);
+  p[2] = (apr_byte_t)((value >> 16) & 0xff);
+  p[3] = (apr_byte_t)((value >> 24) & 0xff);
+}
+
+/* Provides structured access to a serialized directory representation. */
+typedef struct dir_reader_t
+{
+  /* Number of entries in the sorted part. */
+  int count;
+
+  /* Start of the offset index. */
+  const apr_byte_t *index;
+
+  /* Start of the sorted entries. */
+  const apr_byte_t *entries;
+
+  /* End of the sorted entries and start of the incremental changes. */
+  const apr_byte_t *changes;
+
+  /* End of the serialized data. */
+  const apr_byte_t *end;
+
+  /* Directory node, used for error messages only. */
+  const svn_fs_x__id_t *id;
+} dir_reader_t;
+
+/* Parse the directory entry at *P into DIRENT, with the data ending at END.
+ * Upon success, set *P to the first byte after the entry.  Use READER for
+ * error messages.  The name in DIRENT will reference the serialized data.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_dir_entry(svn_fs_x__dirent_t *dirent,
+               const apr_byte_t **p,
+               const apr_byte_t *end,
+               const dir_reader_t *reader,
+               apr_pool_t *scratch_pool)
+{
+  const apr_byte_t *next = *p;
+  const apr_byte_t *name_end = memchr(next, 0, end - next);
+
+  if (name_end == NULL)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                        _("Directory entry name not terminated in '%s'"),
+                        svn_fs_x__id_unparse(reader->id, scratch_pool)->data);
+
+  dirent->name = (const char *)next;
+  next = name_end + 1;
+  if (next == end)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                        _("Directory entry missing kind in '%s'"),
+                        svn_fs_x__id_unparse(reader->id, scratch_pool)->data);
+
+  dirent->kind = (svn_node_kind_t)*(next++);
+  if (next == end)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                        _("Directory entry missing change set in '%s'"),
+                        svn_fs_x__id_unparse(reader->id, scratch_pool)->data);
+
+  next = svn__decode_int(&dirent->id.change_set, next, end);
+  if (next == NULL || next == end)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                        _("Directory entry missing item number in '%s'"),
+                        svn_fs_x__id_unparse(reader->id, scratch_pool)->data);
+
+  next = svn__decode_uint(&dirent->id.number, next, end);
+  if (next == NULL)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                        _("Directory entry truncated in '%s'"),
+                        svn_fs_x__id_unparse(reader->id, scratch_pool)->data);
+
+  *p = next;
+  return SVN_NO_ERROR;
+}
+
+/* Parse the IDX-th entry of the sorted part of the directory in READER
+ * into DIRENT.  If NEXT is not NULL, set *NEXT to the first byte after
+ * that entry.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_indexed_dir_entry(svn_fs_x__dirent_t *dirent,
+                       const apr_byte_t **next,
+                       const dir_reader_t *reader,
+                       int idx,
+                       apr_pool_t *scratch_pool)
+{
+  const apr_byte_t *p;
+  apr_uint32_t offset
+    = decode_dir_index_entry(reader->index + idx * DIR_INDEX_ENTRY_SIZE);
+
+  if ((apr_size_t)offset >= (apr_size_t)(reader->end - reader->entries))
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                        _("Invalid directory index entry in '%s'"),
+                        svn_fs_x__id_unparse(reader->id, scratch_pool)->data);
+
+  p = reader->entries + offset;
+  SVN_ERR(read_dir_entry(dirent, &p, reader->end, reader, scratch_pool));
+  if (next)
+    *next = p;
+
+  return SVN_NO_ERROR;
+}
+
+/* Initialize READER for the serialized directory in DATA.  INCREMENTAL
+ * and ID are the same as for svn_fs_x__parse_dir_entries.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+open_dir_reader(dir_reader_t *reader,
+                const svn_stringbuf_t *data,
+                svn_boolean_t incremental,
+                const svn_fs_x__id_t *id,
+                apr_pool_t *scratch_pool)
+{
+  const apr_byte_t *p = (const apr_byte_t *)data->data;
+  apr_uint64_t count;
+
+  reader->id = id;
+  reader->end = p + data->len;
+
+  p = svn__decode_uint(&count, p, reader->end);
+  if (p == NULL)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Directory for '%s' is empty"),
+                             svn_fs_x__id_unparse(id, scratch_pool)->data);
+  if (count > INT_MAX)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Directory for '%s' is too large"),
+                             svn_fs_x__id_unparse(id, scratch_pool)->data);
+  if ((apr_uint64_t)(reader->end - p) / DIR_INDEX_ENTRY_SIZE < count)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Directory index truncated in '%s'"),
+                             svn_fs_x__id_unparse(id, scratch_pool)->data);
+
+  reader->count = (int)count;
+  reader->index = p;
+  reader->entries = p + reader->count * DIR_INDEX_ENTRY_SIZE;
+
+  /* The sorted part ends with the entry that the last index entry
+   * points to. */
+  if (reader->count)
+    {
+      svn_fs_x__dirent_t last;
+      SVN_ERR(read_indexed_dir_entry(&last, &reader->changes, reader,
+                                     reader->count - 1, scratch_pool));
+    }
+  else
+    {
+      reader->changes = reader->entries;
+    }
+
+  if (!incremental && reader->changes != reader->end)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Directory length mismatch in '%s'"),
+                             svn_fs_x__id_unparse(id, scratch_pool)->data);
+
+  return SVN_NO_ERROR;
+}
+
+/* Compare the name of the dirents given in **A with the C string in *B. */
+static int
+compare_dirent_name(const void *a,
+                    const void *b)
+{
+  const svn_fs_x__dirent_t *lhs = *((const svn_fs_x__dirent_t * const *) a);
+  const char *rhs = b;
+
+  return strcmp(lhs->name, rhs);
+}
+
+svn_error_t *
+svn_fs_x__parse_dir_entries(apr_array_header_t **entries_p,
+                            const svn_stringbuf_t *data,
+                            svn_boolean_t incremental,
+                            const svn_fs_x__id_t *id,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  dir_reader_t reader;
+  apr_array_header_t *entries;
+  const apr_byte_t *p;
+  int hint = -1;
+
+  SVN_ERR(open_dir_reader(&reader, data, incremental, id, scratch_pool));
+  entries = apr_array_make(result_pool, reader.count,
+                           sizeof(svn_fs_x__dirent_t *));
+
+  /* The sorted part maps 1:1 onto ENTRIES.
+   *
+   * The part of the serialized entry that is not the name will be
+   * about 6 bytes or less.  Since APR allocates with an 8 byte
+   * alignment (4 bytes loss on average per string), simply using
+   * the name string in DATA already gives us near-optimal memory
+   * usage. */
+  for (p = reader.entries; p != reader.changes; )
+    {
+      svn_fs_x__dirent_t *dirent = apr_pcalloc(result_pool, sizeof(*dirent));
+      SVN_ERR(read_dir_entry(dirent, &p, reader.changes, &reader,
+                             scratch_pool));
+      APR_ARRAY_PUSH(entries, svn_fs_x__dirent_t *) = dirent;
+    }
+
+  /* Check that we read the expected amount of entries. */
+  if (entries->nelts != reader.count)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Directory length mismatch in '%s'"),
+                             svn_fs_x__id_unparse(id, scratch_pool)->data);
+
+  /* Apply the changes in place, keeping ENTRIES sorted. */
+  while (p != reader.end)
+    {
+      svn_fs_x__dirent_t **existing;
+      svn_fs_x__dirent_t *dirent = apr_pcalloc(result_pool, sizeof(*dirent));
+      SVN_ERR(read_dir_entry(dirent, &p, reader.end, &reader,
+                             scratch_pool));
+
+      existing = svn_sort__array_lookup(entries, dirent->name, &hint,
+                                        compare_dirent_name);
+      if (svn_fs_x__id_used(&dirent->id))
+        {
+          if (existing)
+            *existing = dirent;
+          else
+            SVN_ERR(svn_sort__array_insert2(entries, &dirent, hint));
+        }
+      else if (existing)
+        {
+          SVN_ERR(svn_sort__array_delete2(entries, hint, 1));
+        }
+    }
+
+  *entries_p = entries;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_x__dir_entry_count(int *count,
+                          const svn_stringbuf_t *data,
+                          const svn_fs_x__id_t *id,
+                          apr_pool_t *scratch_pool)
+{
+  const apr_byte_t *p = (const apr_byte_t *)data->data;
+  apr_uint64_t value;
+
+  p = svn__decode_uint(&value, p, p + data->len);
+  if (p == NULL || value > INT_MAX)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Invalid directory size in '%s'"),
+                             svn_fs_x__id_unparse(id, scratch_pool)->data);
+
+  *count = (int)value;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_x__find_serialized_dir_entry(svn_fs_x__dirent_t **dirent,
+                                    const svn_stringbuf_t *data,
+                                    svn_boolean_t incremental,
+                                    const char *name,
+                                    const svn_fs_x__id_t *id,
+                                    apr_pool_t *result_pool,
+                                    apr_pool_t *scratch_pool)
+{
+  dir_reader_t reader;
+  svn_fs_x__dirent_t current;
+  svn_fs_x__dirent_t result;
+  svn_boolean_t found = FALSE;
+  const apr_byte_t *p;
+  int lower = 0;
+  int upper;
+
+  SVN_ERR(open_dir_reader(&reader, data, incremental, id, scratch_pool));
+
+  /* Binary search through the sorted part. */
+  upper = reader.count;
+  while (lower < upper)
+    {
+      int middle = lower + (upper - lower) / 2;
+      int diff;
+
+      SVN_ERR(read_indexed_dir_entry(&current, NULL, &reader, middle,
+                                     scratch_pool));
+      diff = strcmp(current.name, name);
+      if (diff == 0)
+        {
+          result = current;
+          found = TRUE;
+          break;
+        }
+
+      if (diff < 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  /* Later changes to that entry take precedence. */
+  for (p = reader.changes; p != reader.end; )
+    {
+      SVN_ERR(read_dir_entry(&current, &p, reader.end, &reader,
+                             scratch_pool));
+      if (strcmp(current.name, name) == 0)
+        {
+          result = current;
+          found = svn_fs_x__id_used(&current.id);
+        }
+    }
+
+  if (found)
+    {
+      *dirent = apr_pmemdup(result_pool, &result, sizeof(result));
+      (*dirent)->name = apr_pstrdup(result_pool, result.name);
+    }
+  else
+    {
+      *dirent = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Append the serialized form of DIRENT to BUFFER. */
+static void
+append_dir_entry(svn_stringbuf_t *buffer,
+                 const svn_fs_x__dirent_t *dirent)
+{
+  apr_byte_t numbers[1 + 2 * SVN__MAX_ENCODED_UINT_LEN];
+  apr_byte_t *p = numbers;
+
+  /* The entry name, terminated by NUL. */
+  svn_stringbuf_appendbytes(buffer, dirent->name, strlen(dirent->name) + 1);
+
+  /* The entry type. */
+  p = svn__encode_uint(p, dirent->kind);
+
+  /* The ID. */
+  p = svn__encode_int(p, dirent->id.change_set);
+  p = svn__encode_uint(p, dirent->id.number);
+
+  svn_stringbuf_appendbytes(buffer, (const char *)numbers, p - numbers);
+}
+
+svn_error_t *
+svn_fs_x__write_dir_entries(svn_stream_t *stream,
+                            apr_array_header_t *entries,
+                            apr_pool_t *scratch_pool)
+{
+  apr_byte_t buffer[SVN__MAX_ENCODED_UINT_LEN];
+  svn_stringbuf_t *index;
+  svn_stringbuf_t *body;
+  apr_size_t len;
+  int i;
+
+  /* Serialize all entries while recording where each one starts. */
+  index = svn_stringbuf_create_ensure(entries->nelts * DIR_INDEX_ENTRY_SIZE,
+                                      scratch_pool);
+  body = svn_stringbuf_create_empty(scratch_pool);
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      apr_byte_t offset[DIR_INDEX_ENTRY_SIZE];
+      const svn_fs_x__dirent_t *dirent
+        = APR_ARRAY_IDX(entries, i, const svn_fs_x__dirent_t *);
+
+      if ((apr_uint64_t)body->len > APR_UINT32_MAX)
+        return svn_error_create(SVN_ERR_FS_GENERAL, NULL,
+                                _("Directory representation too large"));
+
+      encode_dir_index_entry(offset, (apr_uint32_t)body->len);
+      svn_stringbuf_appendbytes(index, (const char *)offset, sizeof(offset));
+      append_dir_entry(body, dirent);
+    }
+
+  /* Write the number of entries, the index and the entries. */
+  len = svn__encode_uint(buffer, entries->nelts) - buffer;
+  SVN_ERR(svn_stream_write(stream, (const char *)buffer, &len));
+  SVN_ERR(svn_stream_write(stream, index->data, &index->len));
+  SVN_ERR(svn_stream_write(stream, body->data, &body->len));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_x__write_dir_entry(svn_stream_t *stream,
+                          const svn_fs_x__dirent_t *dirent,
+                          apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buffer
+    = svn_stringbuf_create_ensure(strlen(dirent->name) + 2
+                                  + 2 * SVN__MAX_ENCODED_UINT_LEN,
+                                  scratch_pool);
+
+  append_dir_entry(buffer, dirent);
+  SVN_ERR(svn_stream_write(stream, buffer->data, &buffer->len));
+
+  return SVN_NO_ERROR;
+}
@@ -125,7 +125,10 @@ typedef enum svn_fs_x__rep_type_t
   svn_fs_x__rep_delta,
 
   /* this is a representation in a star-delta container */
-  svn_fs_x__rep_container
+  svn_fs_x__rep_container,
+
+  /* this is a stub for a fulltext stored outside the rev / pack files */
+  svn_fs_x__rep_large
 } svn_fs_x__rep_type_t;
 
 /* This structure is used to hold the information stored in a representation
@@ -229,6 +232,70 @@ svn_fs_x__write_properties(svn_stream_t *stream,
                            apr_hash_t *proplist,
                            apr_pool_t *scratch_pool);
 
+/* Parse the directory representation serialized in DATA and return its
+   entries as svn_fs_x__dirent_t * sorted by name in *ENTRIES_P.  If
+   INCREMENTAL is TRUE, DATA is the contents of a "children" file of a
+   transaction and the entry changes following the base directory get
+   applied to the result.  ID is used for error messages only.
+
+   The names in *ENTRIES_P reference DATA, i.e. it must not be modified
+   afterwards and must remain valid as long as *ENTRIES_P is valid.
+   Allocate *ENTRIES_P in RESULT_POOL and use SCRATCH_POOL for temporary
+   allocations.
+ */
+svn_error_t *
+svn_fs_x__parse_dir_entries(apr_array_header_t **entries_p,
+                            const svn_stringbuf_t *data,
+                            svn_boolean_t incremental,
+                            const svn_fs_x__id_t *id,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Set *COUNT to the number of entries in the directory representation
+   serialized in DATA, not counting any incremental changes.  ID is used
+   for error messages only.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_x__dir_entry_count(int *count,
+                          const svn_stringbuf_t *data,
+                          const svn_fs_x__id_t *id,
+                          apr_pool_t *scratch_pool);
+
+/* Set *DIRENT to a copy of the entry NAME in the directory representation
+   serialized in DATA or to NULL, if there is no such entry.  INCREMENTAL
+   and ID are the same as for svn_fs_x__parse_dir_entries.  This uses the
+   index in DATA and does not parse any of the other entries.
+
+   Allocate *DIRENT in RESULT_POOL and use SCRATCH_POOL for temporary
+   allocations.
+ */
+svn_error_t *
+svn_fs_x__find_serialized_dir_entry(svn_fs_x__dirent_t **dirent,
+                                    const svn_stringbuf_t *data,
+                                    svn_boolean_t incremental,
+                                    const char *name,
+                                    const svn_fs_x__id_t *id,
+                                    apr_pool_t *result_pool,
+                                    apr_pool_t *scratch_pool);
+
+/* Write the directory given as array of svn_fs_x__dirent_t * in ENTRIES
+   to STREAM.  ENTRIES must be sorted by name.  Use SCRATCH_POOL for
+   temporary allocations.
+ */
+svn_error_t *
+svn_fs_x__write_dir_entries(svn_stream_t *stream,
+                            apr_array_header_t *entries,
+                            apr_pool_t *scratch_pool);
+
+/* Append DIRENT as an incremental change to the "children" file STREAM.
+   An unused ID in DIRENT marks the deletion of that entry.  Use
+   SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_x__write_dir_entry(svn_stream_t *stream,
+                          const svn_fs_x__dirent_t *dirent,
+                          apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
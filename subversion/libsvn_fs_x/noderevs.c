@@ -49,6 +49,15 @@
 /* the noderev has copy-root path and revision */
 #define NODEREV_HAS_CPATH    0x00040
 
+/* These flags will be used with the flags of serialized representations.
+ */
+
+/* the representation has a SHA1 checksum */
+#define REP_HAS_SHA1         0x00001
+
+/* the representation's fulltext is stored outside the rev / pack files */
+#define REP_LARGE            0x00002
+
 /* Our internal representation of a svn_fs_x__noderev_t.
  *
  * We will store path strings in a string container and reference them
@@ -454,7 +463,7 @@ create_rep_stream(svn_packed__int_stream_t *parent)
     = svn_packed__create_int_substream(parent, FALSE, FALSE);
 
   /* sub-streams for members - except for checksums */
-  /* has_sha1 */
+  /* has_sha1 and large flags */
   svn_packed__create_int_substream(stream, FALSE, FALSE);
 
   /* rev, item_index, size, expanded_size */
@@ -480,7 +489,8 @@ write_reps(svn_packed__int_stream_t *rep_stream,
       svn_fs_x__representation_t *rep
         = &APR_ARRAY_IDX(reps, i, svn_fs_x__representation_t);
 
-      svn_packed__add_uint(rep_stream, rep->has_sha1);
+      svn_packed__add_uint(rep_stream, (rep->has_sha1 ? REP_HAS_SHA1 : 0)
+                                     | (rep->large ? REP_LARGE : 0));
 
       svn_packed__add_uint(rep_stream, rep->id.change_set);
       svn_packed__add_uint(rep_stream, rep->id.number);
@@ -601,8 +611,10 @@ read_reps(apr_array_header_t **reps_p,
   for (i = 0; i < count; ++i)
     {
       svn_fs_x__representation_t rep;
+      apr_uint64_t flags = svn_packed__get_uint(rep_stream);
 
-      rep.has_sha1 = (svn_boolean_t)svn_packed__get_uint(rep_stream);
+      rep.has_sha1 = (flags & REP_HAS_SHA1) != 0;
+      rep.large = (flags & REP_LARGE) != 0;
 
       rep.id.change_set = (svn_revnum_t)svn_packed__get_uint(rep_stream);
       rep.id.number = svn_packed__get_uint(rep_stream);
@@ -53,6 +53,10 @@
 /* value of unused hash buckets */
 #define NO_OFFSET ((apr_uint32_t)(-1))
 
+/* Minimum number of consecutive instructions that we will replace by a
+ * reference to an identical instruction sub-sequence. */
+#define MIN_SUBSEQUENCE 2
+
 /* Byte strings are described by a series of copy instructions that each
  * do one of the following
  *
@@ -62,6 +66,11 @@
  *   that sequence shall be executed (i.e. a sub-sequence)
  * - copy a number of bytes from the base representation buffer starting
  *   at a given offset
+ *
+ * Base representations added to a builder are embedded in the text corpus,
+ * i.e. the containers that we write never refer to external bases and can
+ * be read with a single I/O.  Support for external bases on the reader
+ * side is limited to the respective instruction type.
  */
 
 /* The contents of a fulltext / representation is defined by its first
@@ -174,7 +183,13 @@ struct svn_fs_x__reps_builder_t
   /* array of instruction_t objects describing all instructions */
   apr_array_header_t *instructions;
 
-  /* number of bytes in the text corpus that belongs to bases */
+  /* maps pairs of consecutive copy instructions (instruction_t[2]) to the
+   * index (apr_uint32_t) of their first occurrence in INSTRUCTIONS.  Used
+   * to find instruction sub-sequences that we can reference instead of
+   * repeating them. */
+  apr_hash_t *instruction_pairs;
+
+  /* number of bytes at the start of the text corpus that belong to bases */
   apr_size_t base_text_len;
 };
 
@@ -399,48 +414,82 @@ svn_fs_x__reps_builder_create(svn_fs_t *fs,
   result->reps = apr_array_make(result_pool, 0, sizeof(rep_t));
   result->instructions = apr_array_make(result_pool, 0,
                                         sizeof(instruction_t));
+  result->instruction_pairs = apr_hash_make(result_pool);
 
   return result;
 }
 
-svn_error_t *
-svn_fs_x__reps_add_base(svn_fs_x__reps_builder_t *builder,
-                        svn_fs_x__representation_t *rep,
-                        int priority,
-                        apr_pool_t *scratch_pool)
+/* Return the priority of the base whose text contains OFFSET in BUILDER's
+ * text corpus.  OFFSET must be within the base text section.
+ */
+static int
+get_base_priority(const svn_fs_x__reps_builder_t *builder,
+                  apr_size_t offset)
 {
-  base_t base;
-  apr_size_t text_start_offset = builder->text->len;
-
-  svn_stream_t *stream;
-  svn_string_t *contents;
-  apr_size_t idx;
-  SVN_ERR(svn_fs_x__get_contents(&stream, builder->fs, rep, FALSE,
-                                 scratch_pool));
-  SVN_ERR(svn_string_from_stream2(&contents, stream, SVN__STREAM_CHUNK_SIZE,
-                                  scratch_pool));
-  SVN_ERR(svn_fs_x__reps_add(&idx, builder, contents));
-
-  base.revision = svn_fs_x__get_revnum(rep->id.change_set);
-  base.item_index = rep->id.number;
-  base.priority = priority;
-  base.rep = (apr_uint32_t)idx;
+  int i;
+  for (i = 0; i < builder->bases->nelts; ++i)
+    {
+      const base_t *base = &APR_ARRAY_IDX(builder->bases, i, base_t);
+      const rep_t *rep = &APR_ARRAY_IDX(builder->reps, base->rep, rep_t);
+      const instruction_t *instruction;
 
-  APR_ARRAY_PUSH(builder->bases, base_t) = base;
-  builder->base_text_len += builder->text->len - text_start_offset;
+      if (rep->instruction_count == 0)
+        continue;
 
-  return SVN_NO_ERROR;
+      /* Base texts are stored verbatim, i.e. in a single instruction. */
+      instruction = &APR_ARRAY_IDX(builder->instructions,
+                                   rep->first_instruction, instruction_t);
+      if (offset < (apr_size_t)instruction->offset + instruction->count)
+        return base->priority;
+    }
+
+  return 0;
+}
+
+/* Append a copy instruction for COUNT bytes starting at OFFSET in the
+ * text corpus to BUILDER.  If the previous instruction belongs to the
+ * same fulltext, i.e. is not before FIRST_INSTRUCTION, and the new one
+ * continues it, simply extend the previous one.
+ */
+static void
+add_copy(svn_fs_x__reps_builder_t *builder,
+         apr_size_t first_instruction,
+         apr_size_t offset,
+         apr_size_t count)
+{
+  instruction_t instruction;
+
+  if (builder->instructions->nelts > first_instruction)
+    {
+      instruction_t *last = &APR_ARRAY_IDX(builder->instructions,
+                                           builder->instructions->nelts - 1,
+                                           instruction_t);
+      if (   last->offset >= 0
+          && (apr_size_t)last->offset + last->count == offset)
+        {
+          last->count += (apr_uint32_t)count;
+          return;
+        }
+    }
+
+  instruction.offset = (apr_int32_t)offset;
+  instruction.count = (apr_uint32_t)count;
+  APR_ARRAY_PUSH(builder->instructions, instruction_t) = instruction;
 }
 
 /* Add LEN bytes from DATA to BUILDER's text corpus. Also, add a copy
- * operation for that text fragment.
+ * operation for that text fragment to the fulltext that started with
+ * FIRST_INSTRUCTION.  If BASE is not NULL, the text belongs to that base
+ * representation.
  */
 static void
 add_new_text(svn_fs_x__reps_builder_t *builder,
+             apr_size_t first_instruction,
              const char *data,
-             apr_size_t len)
+             apr_size_t len,
+             const base_t *base)
 {
-  instruction_t instruction;
+  apr_size_t text_start = builder->text->len;
   apr_size_t offset;
   apr_size_t buckets_required;
 
@@ -448,9 +497,7 @@ add_new_text(svn_fs_x__reps_builder_t *builder,
     return;
 
   /* new instruction */
-  instruction.offset = (apr_int32_t)builder->text->len;
-  instruction.count = (apr_uint32_t)len;
-  APR_ARRAY_PUSH(builder->instructions, instruction_t) = instruction;
+  add_copy(builder, first_instruction, text_start, len);
 
   /* add to text corpus */
   svn_stringbuf_appendbytes(builder->text, data, len);
@@ -461,18 +508,27 @@ add_new_text(svn_fs_x__reps_builder_t *builder,
     grow_hash(&builder->hash, builder->text, 2 * buckets_required);
 
   /* add hash entries for the new sequence */
-  for (offset = instruction.offset;
+  for (offset = text_start;
        offset + MATCH_BLOCKSIZE <= builder->text->len;
        offset += MATCH_BLOCKSIZE)
     {
       hash_key_t key = hash_key(builder->text->data + offset);
       size_t idx = hash_to_index(&builder->hash, key);
+      apr_uint32_t old_offset = builder->hash.offsets[idx];
 
       /* Don't replace hash entries that stem from the current text.
-       * This makes early matches more likely. */
-      if (builder->hash.offsets[idx] == NO_OFFSET)
+       * This makes early matches more likely.  Also, keep the entries
+       * of base representations unless we are adding a base with a
+       * higher priority.  That way, all fulltexts tend to copy from
+       * the same common base. */
+      if (old_offset == NO_OFFSET)
         ++builder->hash.used;
-      else if (builder->hash.offsets[idx] >= instruction.offset)
+      else if (old_offset >= text_start)
+        continue;
+      else if (   old_offset < builder->base_text_len
+               && (   base == NULL
+                   || get_base_priority(builder, old_offset)
+                        >= base->priority))
         continue;
 
       builder->hash.offsets[idx] = (apr_uint32_t)offset;
@@ -480,6 +536,140 @@ add_new_text(svn_fs_x__reps_builder_t *builder,
     }
 }
 
+/* Return TRUE if instruction LHS equals RHS. */
+static svn_boolean_t
+instructions_equal(const instruction_t *lhs,
+                   const instruction_t *rhs)
+{
+  return lhs->offset == rhs->offset && lhs->count == rhs->count;
+}
+
+/* Replace runs of instructions in BUILDER starting at FIRST_INSTRUCTION
+ * that also occur in an earlier fulltext by references to those earlier
+ * instruction sub-sequences.  Then, make the remaining copy instructions
+ * available to future fulltexts.  Return the number of instructions left
+ * for the current fulltext.
+ */
+static apr_uint32_t
+reference_subsequences(svn_fs_x__reps_builder_t *builder,
+                       apr_size_t first_instruction)
+{
+  instruction_t *instructions = (instruction_t *)builder->instructions->elts;
+  apr_size_t end = builder->instructions->nelts;
+  apr_size_t source = first_instruction;
+  apr_size_t target = first_instruction;
+  apr_pool_t *pool = apr_hash_pool_get(builder->instruction_pairs);
+
+  while (source < end)
+    {
+      apr_uint32_t *match = NULL;
+      apr_size_t count = 0;
+
+      if (source + 1 < end)
+        match = apr_hash_get(builder->instruction_pairs,
+                             &instructions[source],
+                             2 * sizeof(*instructions));
+
+      /* How far does the match extend?  Only earlier fulltexts may be
+       * referenced. */
+      if (match)
+        while (   source + count < end
+               && *match + count < first_instruction
+               && instructions_equal(&instructions[*match + count],
+                                     &instructions[source + count]))
+          ++count;
+
+      if (count >= MIN_SUBSEQUENCE)
+        {
+          instructions[target].offset = -(apr_int32_t)*match;
+          instructions[target].count = (apr_uint32_t)count;
+          source += count;
+        }
+      else
+        {
+          instructions[target] = instructions[source];
+          ++source;
+        }
+
+      ++target;
+    }
+
+  builder->instructions->nelts = (int)target;
+
+  /* Register all pairs of plain copy instructions.  Note that instruction
+   * index 0 cannot be referenced as it would be indistinguishable from a
+   * copy instruction. */
+  for (source = MAX(first_instruction, 1); source + 1 < target; ++source)
+    if (   instructions[source].offset >= 0
+        && instructions[source + 1].offset >= 0
+        && !apr_hash_get(builder->instruction_pairs, &instructions[source],
+                         2 * sizeof(*instructions)))
+      {
+        apr_uint32_t *index = apr_palloc(pool, sizeof(*index));
+        *index = (apr_uint32_t)source;
+        apr_hash_set(builder->instruction_pairs,
+                     apr_pmemdup(pool, &instructions[source],
+                                 2 * sizeof(*instructions)),
+                     2 * sizeof(*instructions), index);
+      }
+
+  return (apr_uint32_t)(target - first_instruction);
+}
+
+/* Verify that CONTENTS can be added to BUILDER without exceeding the
+ * container limits.
+ */
+static svn_error_t *
+check_capacity(const svn_fs_x__reps_builder_t *builder,
+               const svn_string_t *contents)
+{
+  if (builder->text->len + contents->len > MAX_TEXT_BODY)
+    return svn_error_create(SVN_ERR_FS_CONTAINER_SIZE, NULL,
+                      _("Text body exceeds star delta container capacity"));
+
+  if (  builder->instructions->nelts + 2 * contents->len / MATCH_BLOCKSIZE
+      > MAX_INSTRUCTIONS)
+    return svn_error_create(SVN_ERR_FS_CONTAINER_SIZE, NULL,
+              _("Instruction count exceeds star delta container capacity"));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_x__reps_add_base(apr_size_t *rep_idx,
+                        svn_fs_x__reps_builder_t *builder,
+                        const svn_fs_x__id_t *rep_id,
+                        const svn_string_t *contents,
+                        int priority)
+{
+  base_t base;
+  rep_t rep;
+
+  /* Base texts must form a contiguous section at the start of the text
+   * corpus. */
+  SVN_ERR_ASSERT(builder->reps->nelts == builder->bases->nelts);
+  SVN_ERR(check_capacity(builder, contents));
+
+  base.revision = svn_fs_x__get_revnum(rep_id->change_set);
+  base.item_index = rep_id->number;
+  base.priority = priority;
+  base.rep = (apr_uint32_t)builder->reps->nelts;
+
+  /* Store the base text verbatim, so the whole of it can be matched. */
+  rep.first_instruction = (apr_uint32_t)builder->instructions->nelts;
+  add_new_text(builder, rep.first_instruction, contents->data, contents->len,
+               &base);
+  rep.instruction_count = (apr_uint32_t)builder->instructions->nelts
+                        - rep.first_instruction;
+
+  APR_ARRAY_PUSH(builder->reps, rep_t) = rep;
+  APR_ARRAY_PUSH(builder->bases, base_t) = base;
+  builder->base_text_len = builder->text->len;
+
+  *rep_idx = base.rep;
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_x__reps_add(apr_size_t *rep_idx,
                    svn_fs_x__reps_builder_t *builder,
@@ -491,14 +681,7 @@ svn_fs_x__reps_add(apr_size_t *rep_idx,
   const char *end = current + contents->len;
   const char *last_to_test = end - MATCH_BLOCKSIZE - 1;
 
-  if (builder->text->len + contents->len > MAX_TEXT_BODY)
-    return svn_error_create(SVN_ERR_FS_CONTAINER_SIZE, NULL,
-                      _("Text body exceeds star delta container capacity"));
-
-  if (  builder->instructions->nelts + 2 * contents->len / MATCH_BLOCKSIZE
-      > MAX_INSTRUCTIONS)
-    return svn_error_create(SVN_ERR_FS_CONTAINER_SIZE, NULL,
-              _("Instruction count exceeds star delta container capacity"));
+  SVN_ERR(check_capacity(builder, contents));
 
   rep.first_instruction = (apr_uint32_t)builder->instructions->nelts;
   while (current < last_to_test)
@@ -527,8 +710,6 @@ svn_fs_x__reps_add(apr_size_t *rep_idx,
 
       if (current < last_to_test)
         {
-          instruction_t instruction;
-
           /* extend the match */
 
           size_t prefix_match
@@ -545,23 +726,23 @@ svn_fs_x__reps_add(apr_size_t *rep_idx,
 
           size_t new_copy = (current - processed) - prefix_match;
           if (new_copy)
-            add_new_text(builder, processed, new_copy);
+            add_new_text(builder, rep.first_instruction, processed, new_copy,
+                         NULL);
 
           /* add instruction for matching section */
 
-          instruction.offset = (apr_int32_t)(offset - prefix_match);
-          instruction.count = (apr_uint32_t)(prefix_match + postfix_match +
-                                             MATCH_BLOCKSIZE);
-          APR_ARRAY_PUSH(builder->instructions, instruction_t) = instruction;
+          add_copy(builder, rep.first_instruction, offset - prefix_match,
+                   prefix_match + postfix_match + MATCH_BLOCKSIZE);
 
           processed = current + MATCH_BLOCKSIZE + postfix_match;
           current = processed;
         }
     }
 
-  add_new_text(builder, processed, end - processed);
-  rep.instruction_count = (apr_uint32_t)builder->instructions->nelts
-                        - rep.first_instruction;
+  add_new_text(builder, rep.first_instruction, processed, end - processed,
+               NULL);
+  rep.instruction_count = reference_subsequences(builder,
+                                                 rep.first_instruction);
   APR_ARRAY_PUSH(builder->reps, rep_t) = rep;
 
   *rep_idx = (apr_size_t)(builder->reps->nelts - 1);
@@ -571,18 +752,17 @@ svn_fs_x__reps_add(apr_size_t *rep_idx,
 apr_size_t
 svn_fs_x__reps_estimate_size(const svn_fs_x__reps_builder_t *builder)
 {
-  /* approx: size of the text exclusive to us @ 50% compression rate
+  /* approx: size of the text corpus (incl. embedded bases)
+   *         @ 50% compression rate
    *       + 2 bytes per instruction
    *       + 2 bytes per representation
    *       + 8 bytes per base representation
-   *       + 1:8 inefficiency in using the base representations
    *       + 100 bytes static overhead
    */
-  return (builder->text->len - builder->base_text_len) / 2
+  return builder->text->len / 2
        + builder->instructions->nelts * 2
        + builder->reps->nelts * 2
        + builder->bases->nelts * 8
-       + builder->base_text_len / 8
        + 100;
 }
 
@@ -756,7 +936,8 @@ svn_fs_x__write_reps_container(svn_stream_t *stream,
       svn_packed__add_uint(instructions_stream, instruction->count);
     }
 
-  /* other elements */
+  /* other elements.
+   * Base texts are embedded in TEXT, so there is no external base text. */
   svn_packed__add_uint(misc_stream, 0);
 
   /* write to stream */
@@ -38,6 +38,13 @@
  * disk.  So, builders are write only and representation containers are
  * read-only.
  *
+ * Base representations are fulltexts that all other fulltexts in the
+ * container are preferably deltified against, i.e. they form the centre
+ * of the star.  They are embedded in the container, so it can always be
+ * read with a single I/O.  Moreover, fulltexts that repeat the copy
+ * instructions of earlier fulltexts simply reference those instead of
+ * storing them again.
+ *
  * Extracting data from a representation container is O(length) but it
  * may require multiple iterations if base representations outside the
  * container were used.  Therefore, you will first create an extractor
@@ -77,23 +84,26 @@ svn_fs_x__reps_builder_t *
 svn_fs_x__reps_builder_create(svn_fs_t *fs,
                               apr_pool_t *result_pool);
 
-/* To BUILDER, add reference to the fulltext currently stored in
- * representation REP.  Substrings matching with any of the base reps
- * in BUILDER can be removed from the text base and be replaced by
- * references to those base representations.
+/* To BUILDER, add the fulltext CONTENTS of the representation identified
+ * by REP_ID as a base representation.  Substrings of fulltexts added later
+ * that match with any of the base reps in BUILDER will be replaced by
+ * references to those base representations.  Return the item index under
+ * which the base fulltext itself can be retrieved from the final container
+ * in *REP_IDX.
+ *
+ * All bases must be added before any other fulltext gets added to BUILDER.
  *
  * The PRIORITY is a mere hint on which base representations should
  * preferred in case we could re-use the same contents from multiple bases.
  * Higher numerical value means higher priority / likelihood of being
  * selected over others.
- *
- * Use SCRATCH_POOL for temporary allocations.
  */
 svn_error_t *
-svn_fs_x__reps_add_base(svn_fs_x__reps_builder_t *builder,
-                        svn_fs_x__representation_t *rep,
-                        int priority,
-                        apr_pool_t *scratch_pool);
+svn_fs_x__reps_add_base(apr_size_t *rep_idx,
+                        svn_fs_x__reps_builder_t *builder,
+                        const svn_fs_x__id_t *rep_id,
+                        const svn_string_t *contents,
+                        int priority);
 
 /* Add the byte string CONTENTS to BUILDER.  Return the item index under
  * which the fulltext can be retrieved from the final container in *REP_IDX.
@@ -42,9 +42,9 @@
 #include "lock.h"
 #include "rep-cache.h"
 #include "index.h"
-#include "batch_fsync.h"
 #include "revprops.h"
 
+#include "private/svn_delta_private.h"
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
 #include "private/svn_sorts_private.h"
@@ -803,6 +803,40 @@ svn_fs_x__is_fresh_txn_root(svn_fs_x__noderev_t *noderev)
   return TRUE;
 }
 
+/* Open the in-transaction file PATH for writing and return it in *FILE.
+ * Truncate the file if it already exists.  Create the transaction shard
+ * folder containing PATH as needed.  Use SCRATCH_POOL for allocations.
+ */
+static svn_error_t *
+open_txn_file(apr_file_t **file,
+              const char *path,
+              apr_pool_t *scratch_pool)
+{
+  apr_int32_t flags = APR_WRITE | APR_CREATE | APR_TRUNCATE | APR_BUFFERED;
+  svn_error_t *err = svn_io_file_open(file, path, flags, APR_OS_DEFAULT,
+                                      scratch_pool);
+
+  /* Shard folders only get created when the first file goes into them.
+   * If the whole transaction is gone, creating the folder will fail. */
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      err = svn_io_dir_make(svn_dirent_dirname(path, scratch_pool),
+                            APR_OS_DEFAULT, scratch_pool);
+      if (err && APR_STATUS_IS_EEXIST(err->apr_err))
+        {
+          svn_error_clear(err);
+          err = SVN_NO_ERROR;
+        }
+
+      SVN_ERR(err);
+      err = svn_io_file_open(file, path, flags, APR_OS_DEFAULT,
+                             scratch_pool);
+    }
+
+  return svn_error_trace(err);
+}
+
 svn_error_t *
 svn_fs_x__put_node_revision(svn_fs_t *fs,
                             svn_fs_x__noderev_t *noderev,
@@ -816,11 +850,10 @@ svn_fs_x__put_node_revision(svn_fs_t *fs,
                              _("Attempted to write to non-transaction '%s'"),
                              svn_fs_x__id_unparse(id, scratch_pool)->data);
 
-  SVN_ERR(svn_io_file_open(&noderev_file,
-                           svn_fs_x__path_txn_node_rev(fs, id, scratch_pool,
-                                                       scratch_pool),
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE
-                           | APR_BUFFERED, APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(open_txn_file(&noderev_file,
+                        svn_fs_x__path_txn_node_rev(fs, id, scratch_pool,
+                                                    scratch_pool),
+                        scratch_pool));
 
   SVN_ERR(svn_fs_x__write_noderev(svn_stream_from_aprfile2(noderev_file, TRUE,
                                                            scratch_pool),
@@ -860,9 +893,7 @@ store_sha1_rep_mapping(svn_fs_t *fs,
                                            (noderev->kind == svn_node_dir),
                                            scratch_pool, scratch_pool);
 
-      SVN_ERR(svn_io_file_open(&rep_file, file_name,
-                               APR_WRITE | APR_CREATE | APR_TRUNCATE
-                               | APR_BUFFERED, APR_OS_DEFAULT, scratch_pool));
+      SVN_ERR(open_txn_file(&rep_file, file_name, scratch_pool));
 
       SVN_ERR(svn_io_file_write_full(rep_file, rep_string->data,
                                      rep_string->len, NULL, scratch_pool));
@@ -873,72 +904,6 @@ store_sha1_rep_mapping(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *
-unparse_dir_entry(svn_fs_x__dirent_t *dirent,
-                  svn_stream_t *stream,
-                  apr_pool_t *scratch_pool)
-{
-  apr_size_t to_write;
-  apr_size_t name_len = strlen(dirent->name);
-
-  /* A buffer with sufficient space for
-   * - entry name + 1 terminating NUL
-   * - 1 byte for the node kind
-   * - 2 numbers in 7b/8b encoding for the noderev-id
-   */
-  apr_byte_t *buffer = apr_palloc(scratch_pool,
-                                  name_len + 2 + 2 * SVN__MAX_ENCODED_UINT_LEN);
-
-  /* Now construct the value. */
-  apr_byte_t *p = buffer;
-
-  /* The entry name, terminated by NUL. */
-  memcpy(p, dirent->name, name_len + 1);
-  p += name_len + 1;
-
-  /* The entry type. */
-  p = svn__encode_uint(p, dirent->kind);
-
-  /* The ID. */
-  p = svn__encode_int(p, dirent->id.change_set);
-  p = svn__encode_uint(p, dirent->id.number);
-
-  /* Add the entry to the output stream. */
-  to_write = p - buffer;
-  SVN_ERR(svn_stream_write(stream, (const char *)buffer, &to_write));
-
-  return SVN_NO_ERROR;
-}
-
-/* Write the directory given as array of dirent structs in ENTRIES to STREAM.
-   Perform temporary allocations in SCRATCH_POOL. */
-static svn_error_t *
-unparse_dir_entries(apr_array_header_t *entries,
-                    svn_stream_t *stream,
-                    apr_pool_t *scratch_pool)
-{
-  apr_byte_t buffer[SVN__MAX_ENCODED_UINT_LEN];
-  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  int i;
-
-  /* Write the number of entries. */
-  apr_size_t to_write = svn__encode_uint(buffer, entries->nelts) - buffer;
-  SVN_ERR(svn_stream_write(stream, (const char *)buffer, &to_write));
-
-  /* Write all entries */
-  for (i = 0; i < entries->nelts; ++i)
-    {
-      svn_fs_x__dirent_t *dirent;
-
-      svn_pool_clear(iterpool);
-      dirent = APR_ARRAY_IDX(entries, i, svn_fs_x__dirent_t *);
-      SVN_ERR(unparse_dir_entry(dirent, stream, iterpool));
-    }
-
-  svn_pool_destroy(iterpool);
-  return SVN_NO_ERROR;
-}
-
 /* Return a deep copy of SOURCE and allocate it in RESULT_POOL.
  */
 static svn_fs_x__change_t *
@@ -1814,7 +1779,7 @@ svn_fs_x__set_entry(svn_fs_t *fs,
                                APR_WRITE | APR_CREATE | APR_BUFFERED,
                                APR_OS_DEFAULT, scratch_pool));
       out = svn_stream_from_aprfile2(file, TRUE, scratch_pool);
-      SVN_ERR(unparse_dir_entries(entries, out, subpool));
+      SVN_ERR(svn_fs_x__write_dir_entries(out, entries, subpool));
 
       /* Provide the parent with a data rep if it had none before
          (directories so far empty). */
@@ -1890,7 +1855,7 @@ svn_fs_x__set_entry(svn_fs_t *fs,
   entry.name = name;
   entry.kind = kind;
 
-  SVN_ERR(unparse_dir_entry(&entry, out, subpool));
+  SVN_ERR(svn_fs_x__write_dir_entry(out, &entry, subpool));
 
   /* Flush APR buffers. */
   SVN_ERR(svn_io_file_flush(file, subpool));
@@ -2156,6 +2121,10 @@ choose_delta_base(svn_fs_x__representation_t **rep,
   /* return a suitable base representation */
   *rep = props ? base->prop_rep : base->data_rep;
 
+  /* Fulltexts stored outside the rev / pack files never become bases. */
+  if (*rep && (*rep)->large)
+    *rep = NULL;
+
   /* if we encountered a shared rep, its parent chain may be different
    * from the node-rev parent chain. */
   if (*rep)
@@ -2250,7 +2219,7 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
   svn_stream_t *source;
   svn_txdelta_window_handler_t wh;
   void *whb;
-  int diff_version = 1;
+  int diff_version = SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS;
   svn_fs_x__rep_header_t header = { 0 };
   svn_fs_x__txn_id_t txn_id
     = svn_fs_x__get_txn_id(noderev->noderev_id.change_set);
@@ -2316,8 +2285,8 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
                           ffd->delta_compression_level,
                           result_pool);
 
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->result_pool);
+  b->delta_stream = svn_txdelta__target_push(wh, whb, source, diff_version,
+                                             b->result_pool);
 
   *wb_p = b;
 
@@ -2575,6 +2544,73 @@ digests_final(svn_fs_x__representation_t *rep,
   return SVN_NO_ERROR;
 }
 
+/* The representation REP has just been written to the proto-rev file of
+   the write baton B.  Copy its fulltext into the out-of-line storage and
+   replace the deltified data in the proto-rev file with a stub.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+store_large_rep(rep_write_baton_t *b,
+                svn_fs_x__representation_t *rep,
+                apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = b->fs->fsap_data;
+  svn_fs_x__rep_header_t header = { 0 };
+  const char *path = svn_fs_x__path_large(b->fs, rep->sha1_digest,
+                                          scratch_pool);
+  svn_node_kind_t kind;
+
+  SVN_ERR_ASSERT(rep->has_sha1);
+
+  /* The files are content-addressed, i.e. we may already have it. */
+  SVN_ERR(svn_io_check_path(path, &kind, scratch_pool));
+  if (kind == svn_node_none)
+    {
+      const char *dir = svn_dirent_dirname(path, scratch_pool);
+      const char *temp_path;
+      apr_file_t *file;
+      svn_stream_t *contents;
+
+      SVN_ERR(svn_fs_x__get_contents_from_file(&contents, b->fs, rep,
+                                               b->file, b->rep_offset,
+                                               scratch_pool));
+
+      SVN_ERR(svn_io_make_dir_recursively(dir, scratch_pool));
+      SVN_ERR(svn_io_open_unique_file3(&file, &temp_path, dir,
+                                       svn_io_file_del_none,
+                                       scratch_pool, scratch_pool));
+      SVN_ERR(svn_stream_copy3(contents,
+                               svn_stream_from_aprfile2(file, TRUE,
+                                                        scratch_pool),
+                               NULL, NULL, scratch_pool));
+      if (ffd->flush_to_disk)
+        SVN_ERR(svn_io_file_flush_to_disk(file, scratch_pool));
+      SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+      SVN_ERR(svn_io_file_rename2(temp_path, path, ffd->flush_to_disk,
+                                  scratch_pool));
+      SVN_ERR(svn_io_set_file_read_only(path, FALSE, scratch_pool));
+    }
+
+  /* Replace the svndiff data with a stub.  It still gets an item index,
+     so all index and pack logic will treat it like any other rep. */
+  SVN_ERR(svn_stream_close(b->rep_stream));
+  SVN_ERR(svn_io_file_trunc(b->file, b->rep_offset, scratch_pool));
+  SVN_ERR(svn_io_file_seek(b->file, APR_SET, &b->rep_offset, scratch_pool));
+  b->rep_stream = svn_checksum__wrap_write_stream_fnv1a_32x4(
+                              &b->fnv1a_checksum,
+                              svn_stream_from_aprfile2(b->file, TRUE,
+                                                       b->local_pool),
+                              b->local_pool);
+
+  header.type = svn_fs_x__rep_large;
+  SVN_ERR(svn_fs_x__write_rep_header(&header, b->rep_stream, scratch_pool));
+
+  rep->size = 0;
+  rep->large = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
 /* Close handler for the representation write stream.  BATON is a
    rep_write_baton_t.  Writes out a new node-rev that correctly
    references the representation we just finished writing. */
@@ -2582,6 +2618,7 @@ static svn_error_t *
 rep_write_contents_close(void *baton)
 {
   rep_write_baton_t *b = baton;
+  svn_fs_x__data_t *ffd = b->fs->fsap_data;
   svn_fs_x__representation_t *rep;
   svn_fs_x__representation_t *old_rep;
   apr_off_t offset;
@@ -2621,6 +2658,11 @@ rep_write_contents_close(void *baton)
     }
   else
     {
+      /* Keep large data that did not deltify well out of the rev file. */
+      if (   ffd->large_file_threshold
+          && rep->size > ffd->large_file_threshold)
+        SVN_ERR(store_large_rep(b, rep, b->local_pool));
+
       /* Write out our cosmetic end marker. */
       SVN_ERR(svn_stream_puts(b->rep_stream, "ENDREP\n"));
       SVN_ERR(allocate_item_index(&rep->id.number, b->fs, txn_id,
@@ -2831,7 +2873,7 @@ write_directory_to_stream(svn_stream_t *stream,
                           apr_pool_t *scratch_pool)
 {
   apr_array_header_t *dir = baton;
-  SVN_ERR(unparse_dir_entries(dir, stream, scratch_pool));
+  SVN_ERR(svn_fs_x__write_dir_entries(stream, dir, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -2886,7 +2928,7 @@ write_container_delta_rep(svn_fs_x__representation_t *rep,
   apr_off_t offset = 0;
 
   write_container_baton_t *whb;
-  int diff_version = 1;
+  int diff_version = SVN_DELTA__SVNDIFF_VERSION_LARGE_WINDOWS;
   svn_boolean_t is_props = (item_type == SVN_FS_X__ITEM_TYPE_FILE_PROPS)
                         || (item_type == SVN_FS_X__ITEM_TYPE_DIR_PROPS);
 
@@ -2926,8 +2968,8 @@ write_container_delta_rep(svn_fs_x__representation_t *rep,
                           scratch_pool);
 
   whb = apr_pcalloc(scratch_pool, sizeof(*whb));
-  whb->stream = svn_txdelta_target_push(diff_wh, diff_whb, source,
-                                        scratch_pool);
+  whb->stream = svn_txdelta__target_push(diff_wh, diff_whb, source,
+                                         diff_version, scratch_pool);
   whb->size = 0;
   whb->md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
   if (item_type != SVN_FS_X__ITEM_TYPE_DIR_REP)
@@ -3242,8 +3284,10 @@ write_final_rev(svn_fs_x__id_t *new_id_p,
 
   if (ffd->rep_sharing_allowed)
     {
-      /* Save the data representation's hash in the rep cache. */
+      /* Save the data representation's hash in the rep cache.
+         The latter can't tell out-of-line fulltexts from normal reps. */
       if (   noderev->data_rep && noderev->kind == svn_node_file
+          && !noderev->data_rep->large
           && svn_fs_x__get_revnum(noderev->data_rep->id.change_set) == rev)
         {
           SVN_ERR_ASSERT(reps_to_cache && reps_pool);
@@ -3481,7 +3525,7 @@ static svn_error_t *
 write_final_revprop(const char **path,
                     svn_fs_txn_t *txn,
                     svn_revnum_t revision,
-                    svn_fs_x__batch_fsync_t *batch,
+                    svn_fs__batch_fsync_t *batch,
                     apr_pool_t *result_pool,
                     apr_pool_t *scratch_pool)
 {
@@ -3514,7 +3558,7 @@ write_final_revprop(const char **path,
 
   /* Create a file at the final revprops location. */
   *path = svn_fs_x__path_revprops(txn->fs, revision, result_pool);
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, *path, scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, *path, scratch_pool));
 
   /* Write the new contents to the final revprops file. */
   SVN_ERR(svn_fs_x__write_non_packed_revprops(file, props, scratch_pool));
@@ -3571,7 +3615,7 @@ svn_fs_x__add_index_data(svn_fs_t *fs,
 static svn_error_t *
 auto_create_shard(svn_fs_t *fs,
                   svn_revnum_t revision,
-                  svn_fs_x__batch_fsync_t *batch,
+                  svn_fs__batch_fsync_t *batch,
                   apr_pool_t *scratch_pool)
 {
   svn_fs_x__data_t *ffd = fs->fsap_data;
@@ -3588,7 +3632,7 @@ auto_create_shard(svn_fs_t *fs,
       SVN_ERR(svn_io_copy_perms(svn_dirent_join(fs->path, PATH_REVS_DIR,
                                                 scratch_pool),
                                 new_dir, scratch_pool));
-      SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, new_dir, scratch_pool));
+      SVN_ERR(svn_fs__batch_fsync_new_path(batch, new_dir, scratch_pool));
     }
 
   return SVN_NO_ERROR;
@@ -3600,7 +3644,7 @@ auto_create_shard(svn_fs_t *fs,
 
    Note that the lifetime of *FILE is determined by BATCH instead of
    SCRATCH_POOL.  It will be invalidated by either BATCH being cleaned up
-   itself of by running svn_fs_x__batch_fsync_run on it.
+   itself of by running svn_fs__batch_fsync_run on it.
 
    This function will "destroy" the transaction by removing its prototype
    revision file, so it can at most be called once per transaction.  Also,
@@ -3615,7 +3659,7 @@ get_writable_final_rev(apr_file_t **file,
                        svn_fs_t *fs,
                        svn_fs_x__txn_id_t txn_id,
                        svn_revnum_t revision,
-                       svn_fs_x__batch_fsync_t *batch,
+                       svn_fs__batch_fsync_t *batch,
                        apr_pool_t *scratch_pool)
 {
   get_writable_proto_rev_baton_t baton;
@@ -3642,13 +3686,13 @@ get_writable_final_rev(apr_file_t **file,
                                                        scratch_pool),
                                    unlock_proto_rev(fs, txn_id, lockcookie,
                                                     scratch_pool)));
-  SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, final_rev_filename,
-                                         scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_new_path(batch, final_rev_filename,
+                                       scratch_pool));
 
   /* Now open the prototype revision file and seek to the end.
      Note that BATCH always seeks to position 0 before returning the file. */
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(file, batch, final_rev_filename,
-                                          scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_open_file(file, batch, final_rev_filename,
+                                        scratch_pool));
   SVN_ERR(svn_io_file_seek(*file, APR_END, &end_offset, scratch_pool));
 
   /* We don't want unused sections (such as leftovers from failed delta
@@ -3665,7 +3709,7 @@ get_writable_final_rev(apr_file_t **file,
 static svn_error_t *
 write_next_file(svn_fs_t *fs,
                 svn_revnum_t revision,
-                svn_fs_x__batch_fsync_t *batch,
+                svn_fs__batch_fsync_t *batch,
                 apr_pool_t *scratch_pool)
 {
   apr_file_t *file;
@@ -3674,7 +3718,7 @@ write_next_file(svn_fs_t *fs,
   char *buf;
 
   /* Create / open the 'next' file. */
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, path, scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, path, scratch_pool));
 
   /* Write its contents. */
   buf = apr_psprintf(scratch_pool, "%ld\n", revision);
@@ -3691,7 +3735,7 @@ write_next_file(svn_fs_t *fs,
 static svn_error_t *
 bump_current(svn_fs_t *fs,
              svn_revnum_t new_rev,
-             svn_fs_x__batch_fsync_t *batch,
+             svn_fs__batch_fsync_t *batch,
              apr_pool_t *scratch_pool)
 {
   const char *current_filename;
@@ -3700,7 +3744,7 @@ bump_current(svn_fs_t *fs,
   SVN_ERR(write_next_file(fs, new_rev, batch, scratch_pool));
 
   /* Commit all changes to disk. */
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_run(batch, scratch_pool));
 
   /* Make the revision visible to all processes and threads. */
   current_filename = svn_fs_x__path_current(fs, scratch_pool);
@@ -3709,7 +3753,7 @@ bump_current(svn_fs_t *fs,
                                     batch, scratch_pool));
 
   /* Make the new revision permanently visible. */
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_run(batch, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -3776,7 +3820,7 @@ commit_body(void *baton,
   apr_off_t initial_offset, changed_path_offset;
   svn_fs_x__txn_id_t txn_id = svn_fs_x__txn_get_id(cb->txn);
   apr_hash_t *changed_paths;
-  svn_fs_x__batch_fsync_t *batch;
+  svn_fs__batch_fsync_t *batch;
   apr_array_header_t *directory_ids
     = apr_array_make(scratch_pool, 4, sizeof(svn_fs_x__pair_cache_key_t));
 
@@ -3822,8 +3866,8 @@ commit_body(void *baton,
 
   /* Use this to force all data to be flushed to physical storage
      (to the degree our environment will allow). */
-  SVN_ERR(svn_fs_x__batch_fsync_create(&batch, ffd->flush_to_disk,
-                                       scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_create(&batch, ffd->flush_to_disk,
+                                     scratch_pool));
 
   /* Set up the target directory. */
   SVN_ERR(auto_create_shard(cb->fs, new_rev, batch, subpool));
@@ -3229,6 +3229,7 @@ static root_vtable_t root_vtable = {
   x_get_file_delta_stream,
   x_merge,
   x_get_mergeinfo,
+  NULL /* prefetch_file_contents */
 };
 
 /* Construct a new root object in FS, allocated from RESULT_POOL.  */
@@ -25,6 +25,7 @@
 #include "svn_ctype.h"
 #include "svn_dirent_uri.h"
 #include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
 
 #include "fs_x.h"
 #include "id.h"
@@ -306,6 +307,21 @@ svn_fs_x__path_txn_dir(svn_fs_t *fs,
   return construct_txn_path(fs, txn_id, NULL, result_pool);
 }
 
+const char *
+svn_fs_x__path_txn_shard(svn_fs_t *fs,
+                         svn_fs_x__txn_id_t txn_id,
+                         const char *name,
+                         apr_pool_t *result_pool)
+{
+  apr_uint32_t hash = svn__fnv1a_32(name, strlen(name));
+  char shard[3];
+  shard[0] = "0123456789abcdef"[(hash >> 4) & 0xf];
+  shard[1] = "0123456789abcdef"[hash & 0xf];
+  shard[2] = '\0';
+
+  return construct_txn_path(fs, txn_id, shard, result_pool);
+}
+
 /* Return the name of the sha1->rep mapping file in transaction TXN_ID
  * within FS for the given SHA1 checksum.  Use POOL for allocations.
  */
@@ -314,14 +330,32 @@ svn_fs_x__path_txn_sha1(svn_fs_t *fs,
                         svn_fs_x__txn_id_t txn_id,
                         const unsigned char *sha1,
                         apr_pool_t *pool)
+{
+  const char *name;
+  svn_checksum_t checksum;
+  checksum.digest = sha1;
+  checksum.kind = svn_checksum_sha1;
+
+  name = svn_checksum_to_cstring(&checksum, pool);
+  return svn_dirent_join(svn_fs_x__path_txn_shard(fs, txn_id, name, pool),
+                         name, pool);
+}
+
+const char *
+svn_fs_x__path_large(svn_fs_t *fs,
+                     const unsigned char *sha1,
+                     apr_pool_t *result_pool)
 {
   svn_checksum_t checksum;
+  const char *name;
   checksum.digest = sha1;
   checksum.kind = svn_checksum_sha1;
 
-  return svn_dirent_join(svn_fs_x__path_txn_dir(fs, txn_id, pool),
-                         svn_checksum_to_cstring(&checksum, pool),
-                         pool);
+  /* Fan out by the first two hex digits to keep the folders small. */
+  name = svn_checksum_to_cstring(&checksum, result_pool);
+  return svn_dirent_join_many(result_pool, fs->path, PATH_LARGE_DIR,
+                              apr_pstrndup(result_pool, name, 2), name,
+                              SVN_VA_NULL);
 }
 
 const char *
@@ -441,7 +475,8 @@ construct_txn_node_path(svn_fs_t *fs,
   const char *filename = svn_fs_x__id_unparse(id, result_pool)->data;
   apr_int64_t txn_id = svn_fs_x__get_txn_id(id->change_set);
 
-  return svn_dirent_join(svn_fs_x__path_txn_dir(fs, txn_id, scratch_pool),
+  return svn_dirent_join(svn_fs_x__path_txn_shard(fs, txn_id, filename,
+                                                  scratch_pool),
                          apr_psprintf(scratch_pool, PATH_PREFIX_NODE "%s%s",
                                       filename, suffix),
                          result_pool);
@@ -704,7 +739,7 @@ svn_error_t *
 svn_fs_x__move_into_place(const char *old_filename,
                           const char *new_filename,
                           const char *perms_reference,
-                          svn_fs_x__batch_fsync_t *batch,
+                          svn_fs__batch_fsync_t *batch,
                           apr_pool_t *scratch_pool)
 {
   /* Copying permissions is a no-op on WIN32. */
@@ -723,7 +758,7 @@ svn_fs_x__move_into_place(const char *old_filename,
                               scratch_pool));
 
   /* Schedule for synchronization. */
-  SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, new_filename, scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_new_path(batch, new_filename, scratch_pool));
 #else
   SVN_ERR(svn_io_file_rename2(old_filename, new_filename, TRUE,
                               scratch_pool));
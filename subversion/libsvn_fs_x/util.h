@@ -25,7 +25,7 @@
 
 #include "svn_fs.h"
 #include "id.h"
-#include "batch_fsync.h"
+#include "private/svn_fs_util.h"
 
 /* Functions for dealing with recoverable errors on mutable files
  *
@@ -233,6 +233,18 @@ const char *
 svn_fs_x__path_txns_dir(svn_fs_t *fs,
                         apr_pool_t *result_pool);
 
+/* Return the path of the sub-directory of transaction TXN_ID in FS that
+ * contains the file NAME.  Transactions store their per-node and sha1
+ * mapping files in 256 such sub-directories, which get created when the
+ * first file is written to them.  The result will be allocated in
+ * RESULT_POOL.
+ */
+const char *
+svn_fs_x__path_txn_shard(svn_fs_t *fs,
+                         svn_fs_x__txn_id_t txn_id,
+                         const char *name,
+                         apr_pool_t *result_pool);
+
 /* Return the name of the sha1->rep mapping file in transaction TXN_ID
  * within FS for the given SHA1 checksum.  Use POOL for allocations.
  */
@@ -242,6 +254,14 @@ svn_fs_x__path_txn_sha1(svn_fs_t *fs,
                         const unsigned char *sha1,
                         apr_pool_t *pool);
 
+/* Return the path of the out-of-line fulltext file for the representation
+ * with the given SHA1 checksum in FS.  Use RESULT_POOL for allocations.
+ */
+const char *
+svn_fs_x__path_large(svn_fs_t *fs,
+                     const unsigned char *sha1,
+                     apr_pool_t *result_pool);
+
 /* Return the path of the 'txn-protorevs' directory in FS, even if that
  * folder may not exist in FS.  The result will be allocated in RESULT_POOL.
  */
@@ -454,7 +474,7 @@ svn_error_t *
 svn_fs_x__move_into_place(const char *old_filename,
                           const char *new_filename,
                           const char *perms_reference,
-                          svn_fs_x__batch_fsync_t *batch,
+                          svn_fs__batch_fsync_t *batch,
                           apr_pool_t *scratch_pool);
 
 #endif
@@ -675,6 +675,103 @@ compare_p2l_to_rev(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Verify the checksums of all out-of-line fulltexts added in revisions
+ * START to START + COUNT-1 in FS.  If given, invoke CANCEL_FUNC with
+ * CANCEL_BATON at regular intervals.  Use SCRATCH_POOL for temporary
+ * allocations.
+ *
+ * Like compare_p2l_to_rev, this must only be called for a single rev /
+ * pack file.
+ */
+static svn_error_t *
+verify_large_reps(svn_fs_t *fs,
+                  svn_revnum_t start,
+                  svn_revnum_t count,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = fs->fsap_data;
+  apr_pool_t *blockpool = svn_pool_create(scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_off_t max_offset;
+  apr_off_t offset = 0;
+  svn_fs_x__revision_file_t *rev_file;
+
+  SVN_ERR(svn_fs_x__rev_file_init(&rev_file, fs, start, scratch_pool));
+  SVN_ERR(svn_fs_x__p2l_get_max_offset(&max_offset, fs, rev_file, start,
+                                       scratch_pool));
+
+  /* The node revisions tell us which reps are stored out-of-line. */
+  while (offset < max_offset)
+    {
+      apr_array_header_t *entries;
+      svn_fs_x__p2l_entry_t *last;
+      int i;
+
+      svn_pool_clear(blockpool);
+
+      SVN_ERR(svn_fs_x__p2l_index_lookup(&entries, fs, rev_file, start,
+                                         offset, ffd->p2l_page_size,
+                                         blockpool, blockpool));
+      if (entries->nelts == 0)
+        break;
+
+      for (i = 0; i < entries->nelts; ++i)
+        {
+          svn_fs_x__p2l_entry_t *entry
+            = &APR_ARRAY_IDX(entries, i, svn_fs_x__p2l_entry_t);
+          apr_uint32_t k;
+
+          /* skip bits we previously checked */
+          if (entry->offset < offset)
+            continue;
+
+          if (   entry->type != SVN_FS_X__ITEM_TYPE_NODEREV
+              && entry->type != SVN_FS_X__ITEM_TYPE_NODEREVS_CONT)
+            continue;
+
+          for (k = 0; k < entry->item_count; ++k)
+            {
+              svn_fs_x__noderev_t *noderev;
+              svn_fs_x__representation_t *rep;
+              svn_stream_t *contents;
+
+              svn_pool_clear(iterpool);
+
+              SVN_ERR(svn_fs_x__get_node_revision(&noderev, fs,
+                                                  &entry->items[k],
+                                                  iterpool, iterpool));
+
+              /* Reps added by earlier revisions got checked with those. */
+              rep = noderev->data_rep;
+              if (   !rep || !rep->large
+                  || rep->id.change_set != entry->items[k].change_set)
+                continue;
+
+              /* Reading the whole stream verifies the checksums. */
+              SVN_ERR(svn_fs_x__get_contents(&contents, fs, rep, FALSE,
+                                             iterpool));
+              SVN_ERR(svn_stream_copy3(contents, svn_stream_empty(iterpool),
+                                       cancel_func, cancel_baton,
+                                       iterpool));
+            }
+        }
+
+      last = &APR_ARRAY_IDX(entries, entries->nelts - 1,
+                            svn_fs_x__p2l_entry_t);
+      offset = last->offset + last->size;
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+    }
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(blockpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Verify that the revprops of the revisions START to END in FS can be
  * accessed.  Invoke CANCEL_FUNC with CANCEL_BATON at regular intervals.
  *
@@ -725,9 +822,9 @@ verify_revprops(svn_fs_t *fs,
 
 /* Verify that on-disk representation has not been tempered with (in a way
  * that leaves the repository in a corrupted state).  This compares log-to-
- * phys with phys-to-log indexes, verifies the low-level checksums and
- * checks that all revprops are available.  The function signature is
- * similar to svn_fs_x__verify.
+ * phys with phys-to-log indexes, verifies the low-level checksums as
+ * well as those of out-of-line fulltexts and checks that all revprops
+ * are available.  The function signature is similar to svn_fs_x__verify.
  *
  * The values of START and END have already been auto-selected and
  * verified.
@@ -775,6 +872,11 @@ verify_metadata_consistency(svn_fs_t *fs,
         err = compare_p2l_to_rev(fs, pack_start, pack_end - pack_start,
                                  cancel_func, cancel_baton, iterpool);
 
+      /* verify the checksums of the out-of-line fulltexts */
+      if (!err)
+        err = verify_large_reps(fs, pack_start, pack_end - pack_start,
+                                cancel_func, cancel_baton, iterpool);
+
       /* ensure that revprops are available and accessible */
       if (!err)
         err = verify_revprops(fs, pack_start, pack_end,
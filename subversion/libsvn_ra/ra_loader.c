@@ -648,6 +648,42 @@ svn_error_t *svn_ra_get_dir2(svn_ra_session_t *session,
                                   path, revision, dirent_fields, pool);
 }
 
+svn_error_t *
+svn_ra__get_dirs(svn_ra_session_t *session,
+                 apr_array_header_t **dirents,
+                 const apr_array_header_t *paths,
+                 svn_revnum_t revision,
+                 apr_uint32_t dirent_fields,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  int i;
+
+  for (i = 0; i < paths->nelts; i++)
+    SVN_ERR_ASSERT(svn_relpath_is_canonical(APR_ARRAY_IDX(paths, i,
+                                                          const char *)));
+
+  if (session->vtable->get_dirs)
+    return svn_error_trace(session->vtable->get_dirs(session, dirents, paths,
+                                                     revision, dirent_fields,
+                                                     result_pool,
+                                                     scratch_pool));
+
+  *dirents = apr_array_make(result_pool, paths->nelts, sizeof(apr_hash_t *));
+  for (i = 0; i < paths->nelts; i++)
+    {
+      apr_hash_t *dir_entries;
+
+      SVN_ERR(session->vtable->get_dir(session, &dir_entries, NULL, NULL,
+                                       APR_ARRAY_IDX(paths, i, const char *),
+                                       revision, dirent_fields,
+                                       result_pool));
+      APR_ARRAY_PUSH(*dirents, apr_hash_t *) = dir_entries;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_list(svn_ra_session_t *session,
             const char *path,
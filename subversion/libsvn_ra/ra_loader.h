@@ -380,6 +380,16 @@ typedef struct svn_ra__vtable_t {
     void *replay_baton,
     apr_pool_t *scratch_pool);
 
+  /* See svn_ra__get_dirs().  May be NULL, in which case the loader
+     falls back to one get_dir() call per path. */
+  svn_error_t *(*get_dirs)(svn_ra_session_t *session,
+                           apr_array_header_t **dirents,
+                           const apr_array_header_t *paths,
+                           svn_revnum_t revision,
+                           apr_uint32_t dirent_fields,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool);
+
 } svn_ra__vtable_t;
 
 /* The RA session object. */
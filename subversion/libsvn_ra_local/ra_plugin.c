@@ -1919,7 +1919,8 @@ static const svn_ra__vtable_t ra_local_vtable =
   svn_ra_local__list ,
   svn_ra_local__register_editor_shim_callbacks,
   svn_ra_local__get_commit_ev2,
-  NULL /* replay_range_ev2 */
+  NULL /* replay_range_ev2 */,
+  NULL /* get_dirs */
 };
 
 
@@ -1886,6 +1886,8 @@ negotiate_put_encoding(int *svndiff_version_p,
       if (session->supports_svndiff2 &&
           svn_ra_serf__is_low_latency_connection(session))
         svndiff_version = 2;
+      else if (session->supports_svndiff3)
+        svndiff_version = 3;
       else if (session->supports_svndiff1)
         svndiff_version = 1;
       else if (session->supports_svndiff2)
@@ -1895,15 +1897,18 @@ negotiate_put_encoding(int *svndiff_version_p,
     }
   else if (session->using_compression == svn_tristate_true)
     {
-      /* Otherwise, prefer svndiff1, as svndiff2 is not a reasonable
-       * substitute for svndiff1 with default compression level.  (It gives
-       * better speed and compression ratio comparable to svndiff1 with
-       * compression level 1, but not 5).
+      /* Otherwise, prefer svndiff3 or svndiff1, as svndiff2 is not a
+       * reasonable substitute for svndiff1 with default compression level.
+       * (It gives better speed and compression ratio comparable to svndiff1
+       * with compression level 1, but not 5).  svndiff3 compresses like
+       * svndiff1 but encodes the instructions more compactly.
        *
        * Note: For future compatibility, we also handle a theoretically
        * possible case where the server has advertised only svndiff2 support.
        */
-      if (session->supports_svndiff1)
+      if (session->supports_svndiff3)
+        svndiff_version = 3;
+      else if (session->supports_svndiff1)
         svndiff_version = 1;
       else if (session->supports_svndiff2)
         svndiff_version = 2;
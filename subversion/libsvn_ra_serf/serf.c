@@ -762,6 +762,7 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   /* supports_rev_rsrc_replay */
   /* supports_svndiff1 */
   /* supports_svndiff2 */
+  /* supports_svndiff3 */
   /* supports_put_result_checksum */
   /* conn_latency */
 
@@ -1070,7 +1071,8 @@ static const svn_ra__vtable_t serf_vtable = {
   svn_ra_serf__list,
   svn_ra_serf__register_editor_shim_callbacks,
   NULL /* commit_ev2 */,
-  NULL /* replay_range_ev2 */
+  NULL /* replay_range_ev2 */,
+  NULL /* get_dirs */
 };
 
 svn_error_t *
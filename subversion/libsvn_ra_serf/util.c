@@ -2057,23 +2057,25 @@ svn_ra_serf__setup_svndiff_accept_encoding(serf_bucket_t *headers,
            svn_ra_serf__is_low_latency_connection(session))
     {
       /* With http-compression=auto, advertise that we prefer svndiff2
-         to svndiff1 with a low latency connection (assuming the underlying
-         network has high bandwidth), as it is faster and in this case, we
-         don't care about worse compression ratio. */
+         to svndiff3 and svndiff1 with a low latency connection (assuming
+         the underlying network has high bandwidth), as it is faster and
+         in this case, we don't care about worse compression ratio. */
       serf_bucket_headers_setn(
         headers, "Accept-Encoding",
-        "gzip,svndiff2;q=0.9,svndiff1;q=0.8,svndiff;q=0.7");
+        "gzip,svndiff2;q=0.9,svndiff3;q=0.85,svndiff1;q=0.8,svndiff;q=0.7");
     }
   else
     {
-      /* Otherwise, advertise that we prefer svndiff1 over svndiff2.
-         svndiff2 is not a reasonable substitute for svndiff1 with default
-         compression level, because, while it is faster, it also gives worse
-         compression ratio.  While we can use svndiff2 in some cases (see
-         above), we can't do this generally. */
+      /* Otherwise, advertise that we prefer svndiff3 and svndiff1 over
+         svndiff2.  svndiff3 uses the same compression as svndiff1 but
+         encodes the instructions more compactly.  svndiff2 is not a
+         reasonable substitute for svndiff1 with default compression level,
+         because, while it is faster, it also gives worse compression ratio.
+         While we can use svndiff2 in some cases (see above), we can't do
+         this generally. */
       serf_bucket_headers_setn(
         headers, "Accept-Encoding",
-        "gzip,svndiff1;q=0.9,svndiff2;q=0.8,svndiff;q=0.7");
+        "gzip,svndiff3;q=0.9,svndiff1;q=0.85,svndiff2;q=0.8,svndiff;q=0.7");
     }
 }
 
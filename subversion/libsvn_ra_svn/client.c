@@ -47,6 +47,7 @@
 #include "svn_mergeinfo.h"
 #include "svn_version.h"
 #include "svn_ctype.h"
+#include "svn_sorts.h"
 
 #include "svn_private_config.h"
 
@@ -249,7 +250,15 @@ static svn_error_t *handle_auth_request(svn_ra_svn__session_baton_t *sess,
   SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, "lc", &mechlist, &realm));
   if (mechlist->nelts == 0)
     return SVN_NO_ERROR;
-  return DO_AUTH(sess, mechlist, realm, pool);
+  SVN_ERR(DO_AUTH(sess, mechlist, realm, pool));
+
+  /* Both auth implementations prefer EXTERNAL over ANONYMOUS over
+     everything else.  Anything but ANONYMOUS gives us a username. */
+  if ((sess->is_tunneled && svn_ra_svn__find_mech(mechlist, "EXTERNAL"))
+      || !svn_ra_svn__find_mech(mechlist, "ANONYMOUS"))
+    sess->has_username = TRUE;
+
+  return SVN_NO_ERROR;
 }
 
 /* --- REPORTER IMPLEMENTATION --- */
@@ -640,6 +649,7 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
   sess = apr_palloc(pool, sizeof(*sess));
   sess->pool = pool;
   sess->is_tunneled = (tunnel_name != NULL);
+  sess->has_username = FALSE;
   sess->parent = parent;
   sess->user = uri->user;
   sess->hostname = uri->hostname;
@@ -747,11 +757,12 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
    * capability list, and the URL, and subsequently there is an auth
    * request. */
   /* Client-side capabilities list: */
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwwww)cc(?c)",
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwwwww)cc(?c)",
                                   (apr_uint64_t) 2,
                                   SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                   SVN_RA_SVN_CAP_SVNDIFF1,
                                   SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED,
+                                  SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED,
                                   SVN_RA_SVN_CAP_ABSENT_ENTRIES,
                                   SVN_RA_SVN_CAP_DEPTH,
                                   SVN_RA_SVN_CAP_MERGEINFO,
@@ -1436,23 +1447,26 @@ parse_iproplist(apr_array_header_t **inherited_props,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
-                                    svn_revnum_t rev, svn_stream_t *stream,
-                                    svn_revnum_t *fetched_rev,
-                                    apr_hash_t **props,
-                                    apr_pool_t *pool)
+/* Read the response to a get-file command for PATH from SESS_BATON's
+ * connection.  Write the file contents to STREAM, unless that is NULL,
+ * and return the revision in *FETCHED_REV and the properties in *PROPS.
+ * The latter two may be NULL.  Allocate the results in POOL. */
+static svn_error_t *
+read_get_file_response(svn_ra_svn__session_baton_t *sess_baton,
+                       const char *path,
+                       svn_stream_t *stream,
+                       svn_revnum_t *fetched_rev,
+                       apr_hash_t **props,
+                       apr_pool_t *pool)
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
   svn_ra_svn_conn_t *conn = sess_baton->conn;
   svn_ra_svn__list_t *proplist;
   const char *expected_digest;
   svn_checksum_t *expected_checksum = NULL;
   svn_checksum_ctx_t *checksum_ctx;
+  svn_revnum_t rev;
   apr_pool_t *iterpool;
 
-  path = reparent_path(session, path, pool);
-  SVN_ERR(svn_ra_svn__write_cmd_get_file(conn, pool, path, rev,
-                                         (props != NULL), (stream != NULL)));
   SVN_ERR(handle_auth_request(sess_baton, pool));
   SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, "(?c)rl",
                                         &expected_digest,
@@ -1513,6 +1527,22 @@ static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *ra_svn_get_file(svn_ra_session_t *session, const char *path,
+                                    svn_revnum_t rev, svn_stream_t *stream,
+                                    svn_revnum_t *fetched_rev,
+                                    apr_hash_t **props,
+                                    apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+
+  path = reparent_path(session, path, pool);
+  SVN_ERR(svn_ra_svn__write_cmd_get_file(sess_baton->conn, pool, path, rev,
+                                         (props != NULL), (stream != NULL)));
+
+  return svn_error_trace(read_get_file_response(sess_baton, path, stream,
+                                                fetched_rev, props, pool));
+}
+
 /* Write the protocol words that correspond to DIRENT_FIELDS to CONN
  * and use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
@@ -1542,29 +1572,47 @@ send_dirent_fields(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *ra_svn_get_dir(svn_ra_session_t *session,
-                                   apr_hash_t **dirents,
-                                   svn_revnum_t *fetched_rev,
-                                   apr_hash_t **props,
-                                   const char *path,
-                                   svn_revnum_t rev,
-                                   apr_uint32_t dirent_fields,
-                                   apr_pool_t *pool)
+/* Send a get-dir command for PATH, already relative to the connection's
+ * URL, at REV to CONN.  WANT_PROPS, WANT_CONTENTS and DIRENT_FIELDS
+ * select what the server shall return.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+write_get_dir_cmd(svn_ra_svn_conn_t *conn,
+                  const char *path,
+                  svn_revnum_t rev,
+                  svn_boolean_t want_props,
+                  svn_boolean_t want_contents,
+                  apr_uint32_t dirent_fields,
+                  apr_pool_t *scratch_pool)
 {
-  svn_ra_svn__session_baton_t *sess_baton = session->priv;
-  svn_ra_svn_conn_t *conn = sess_baton->conn;
-  svn_ra_svn__list_t *proplist, *dirlist;
-  int i;
-
-  path = reparent_path(session, path, pool);
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w(c(?r)bb(!", "get-dir", path,
-                                  rev, (props != NULL), (dirents != NULL)));
-  SVN_ERR(send_dirent_fields(conn, dirent_fields, pool));
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "w(c(?r)bb(!",
+                                  "get-dir", path, rev,
+                                  want_props, want_contents));
+  SVN_ERR(send_dirent_fields(conn, dirent_fields, scratch_pool));
 
   /* Always send the, nominally optional, want-iprops as "false" to
      workaround a bug in svnserve 1.8.0-1.8.8 that causes the server
      to see "true" if it is omitted. */
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!)b)", FALSE));
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "!)b)", FALSE));
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the response to a get-dir command from SESS_BATON's connection
+ * and return the listing in *DIRENTS, the revision in *FETCHED_REV and
+ * the properties in *PROPS.  Any of these may be NULL.  Allocate the
+ * results in POOL. */
+static svn_error_t *
+read_get_dir_response(svn_ra_svn__session_baton_t *sess_baton,
+                      apr_hash_t **dirents,
+                      svn_revnum_t *fetched_rev,
+                      apr_hash_t **props,
+                      apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  svn_ra_svn__list_t *proplist, *dirlist;
+  svn_revnum_t rev;
+  int i;
 
   SVN_ERR(handle_auth_request(sess_baton, pool));
   SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, "rll", &rev, &proplist,
@@ -1628,6 +1676,96 @@ static svn_error_t *ra_svn_get_dir(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *ra_svn_get_dir(svn_ra_session_t *session,
+                                   apr_hash_t **dirents,
+                                   svn_revnum_t *fetched_rev,
+                                   apr_hash_t **props,
+                                   const char *path,
+                                   svn_revnum_t rev,
+                                   apr_uint32_t dirent_fields,
+                                   apr_pool_t *pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+
+  path = reparent_path(session, path, pool);
+  SVN_ERR(write_get_dir_cmd(sess_baton->conn, path, rev, (props != NULL),
+                            (dirents != NULL), dirent_fields, pool));
+
+  return svn_error_trace(read_get_dir_response(sess_baton, dirents,
+                                               fetched_rev, props, pool));
+}
+
+/* Maximum number of get-dir commands that ra_svn_get_dirs keeps in
+ * flight.  The commands are small enough for the whole window to fit
+ * into the socket buffers, so we never block on writing a command while
+ * the server is blocked writing a response. */
+#define GET_DIRS_WINDOW 32
+
+static svn_error_t *
+ra_svn_get_dirs(svn_ra_session_t *session,
+                apr_array_header_t **dirents_p,
+                const apr_array_header_t *paths,
+                svn_revnum_t revision,
+                apr_uint32_t dirent_fields,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  apr_array_header_t *dirents;
+  apr_pool_t *iterpool;
+  svn_error_t *err = SVN_NO_ERROR;
+  int window = GET_DIRS_WINDOW;
+  int sent = 0;
+  int received = 0;
+
+  /* An anonymous connection may get an auth request in reply to any
+     command, which would then be answered by the next pipelined
+     command.  Fall back to one command at a time in that case. */
+  if (!svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_COMMAND_PIPELINE)
+      || !sess_baton->has_username)
+    window = 1;
+
+  dirents = apr_array_make(result_pool, paths->nelts, sizeof(apr_hash_t *));
+  iterpool = svn_pool_create(scratch_pool);
+  while (received < sent || (!err && sent < paths->nelts))
+    {
+      apr_hash_t *dir_entries;
+      svn_error_t *read_err;
+
+      svn_pool_clear(iterpool);
+
+      /* Top up the window, unless a previous command failed. */
+      while (!err && sent < paths->nelts && sent - received < window)
+        {
+          const char *path = APR_ARRAY_IDX(paths, sent, const char *);
+
+          path = reparent_path(session, path, iterpool);
+          SVN_ERR(write_get_dir_cmd(conn, path, revision, FALSE, TRUE,
+                                    dirent_fields, iterpool));
+          ++sent;
+        }
+
+      /* Responses arrive in command order.  After a failure, we still
+         need to consume the responses to the commands in flight. */
+      read_err = read_get_dir_response(sess_baton, &dir_entries, NULL, NULL,
+                                       result_pool);
+      ++received;
+
+      if (err)
+        svn_error_clear(read_err);
+      else if (read_err)
+        err = read_err;
+      else
+        APR_ARRAY_PUSH(dirents, apr_hash_t *) = dir_entries;
+    }
+  svn_pool_destroy(iterpool);
+  SVN_ERR(err);
+
+  *dirents_p = dirents;
+  return SVN_NO_ERROR;
+}
+
 /* Converts a apr_uint64_t with values TRUE, FALSE or
    SVN_RA_SVN_UNSPECIFIED_NUMBER as provided by svn_ra_svn__parse_tuple
    to a svn_tristate_t */
@@ -1706,6 +1844,820 @@ static svn_error_t *ra_svn_get_mergeinfo(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+/* --- DEFERRED FILE CONTENTS --- */
+
+/* With the svn-max-connections option set above 1, a checkout-like
+ * update, i.e. one whose report starts with an empty target, asks the
+ * server to leave the file contents out of the editor drive.  There are
+ * no base texts to send deltas against in that case anyway.  All other
+ * updates get their text deltas over the primary connection as usual.
+ *
+ * The editor below keeps the file batons of changed files open
+ * ("postfix" text deltas, see svn_delta_editor_t) and fetches their
+ * contents with get-file over extra connections while the tree drive
+ * continues on the primary connection.  The requests are sent as soon
+ * as a small batch of files is due and the responses get handed to the
+ * wrapped editor as they come in.  The number of files whose contents
+ * are due is capped, so that we don't keep an open file baton for every
+ * file of a large checkout.  The working copy update editor as well as
+ * the export editor accept the text for a file after its parent
+ * directory has been closed.
+ *
+ * Editor paths do not tell where a file lives in the repository if the
+ * working copy contains switched paths.  The reporter wrapper further
+ * down therefore records the link_path() calls of the report, so that
+ * the contents can be fetched from the link targets instead. */
+
+/* Maximum number of get-file commands in flight per extra connection. */
+#define FETCH_WINDOW 8
+
+/* Number of files whose contents must be due before we open the extra
+ * connections. */
+#define FETCH_BATCH 16
+
+typedef struct fetch_file_baton_t fetch_file_baton_t;
+
+typedef struct fetch_edit_baton_t
+{
+  const svn_delta_editor_t *wrapped_editor;
+  void *wrapped_edit_baton;
+
+  /* The primary session.  Its URL is the root of the editor drive. */
+  svn_ra_svn__session_baton_t *sess_baton;
+
+  /* Repository relpath of the session URL. */
+  const char *base_relpath;
+
+  /* Maps editor relpaths given to link_path() to the repository relpaths
+     of the link URLs. */
+  apr_hash_t *links;
+
+  /* Maximum number of extra connections to open. */
+  int connections;
+
+  /* TRUE if the server leaves the file contents out of the drive and we
+     fetch them over extra connections.  FALSE if the server sends text
+     deltas and we simply pass the drive on. */
+  svn_boolean_t fetch_texts;
+
+  /* The revision being updated to. */
+  svn_revnum_t revision;
+
+  /* The extra connections, once opened.  They get closed when CONN_POOL
+     goes away. */
+  svn_ra_svn__session_baton_t **conns;
+  int conn_count;
+  apr_pool_t *conn_pool;
+
+  /* Number of get-file commands that may be in flight, in total. */
+  int window;
+
+  /* Connection to send the next get-file command to.  Since each
+     connection answers in order, reading the responses in request order
+     visits the connections round-robin while the others keep receiving. */
+  int next_conn;
+
+  /* Ring buffer of QUEUE_SIZE fetch_file_baton_t * of the files whose
+     contents are due, oldest first.  QUEUED of them start at index
+     FIRST, and get-file has been sent for the first REQUESTED ones. */
+  fetch_file_baton_t **queue;
+  int queue_size;
+  int first;
+  int queued;
+  int requested;
+
+  apr_pool_t *pool;
+} fetch_edit_baton_t;
+
+typedef struct fetch_dir_baton_t
+{
+  fetch_edit_baton_t *eb;
+  void *wrapped_dir_baton;
+} fetch_dir_baton_t;
+
+struct fetch_file_baton_t
+{
+  fetch_edit_baton_t *eb;
+  void *wrapped_file_baton;
+  const char *path;
+
+  /* TRUE if the server announced a content change for this file. */
+  svn_boolean_t fetch_text;
+  const char *text_checksum;
+
+  /* The connection that the get-file command went to. */
+  svn_ra_svn__session_baton_t *conn;
+
+  /* The wrapped file baton may outlive the driver's file pool, so it
+     gets a pool of its own if EB->FETCH_TEXTS is set. */
+  apr_pool_t *pool;
+};
+
+static svn_error_t *
+fetch_set_target_revision(void *edit_baton,
+                          svn_revnum_t target_revision,
+                          apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+
+  eb->revision = target_revision;
+  return eb->wrapped_editor->set_target_revision(eb->wrapped_edit_baton,
+                                                 target_revision, pool);
+}
+
+static svn_error_t *
+fetch_open_root(void *edit_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *dir_pool,
+                void **root_baton)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+  fetch_dir_baton_t *db = apr_palloc(dir_pool, sizeof(*db));
+
+  db->eb = eb;
+  SVN_ERR(eb->wrapped_editor->open_root(eb->wrapped_edit_baton,
+                                        base_revision, dir_pool,
+                                        &db->wrapped_dir_baton));
+  *root_baton = db;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_delete_entry(const char *path,
+                   svn_revnum_t base_revision,
+                   void *parent_baton,
+                   apr_pool_t *pool)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+
+  return pb->eb->wrapped_editor->delete_entry(path, base_revision,
+                                              pb->wrapped_dir_baton, pool);
+}
+
+static svn_error_t *
+fetch_add_directory(const char *path,
+                    void *parent_baton,
+                    const char *copyfrom_path,
+                    svn_revnum_t copyfrom_revision,
+                    apr_pool_t *dir_pool,
+                    void **child_baton)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+  fetch_dir_baton_t *db = apr_palloc(dir_pool, sizeof(*db));
+
+  db->eb = pb->eb;
+  SVN_ERR(pb->eb->wrapped_editor->add_directory(path, pb->wrapped_dir_baton,
+                                                copyfrom_path,
+                                                copyfrom_revision, dir_pool,
+                                                &db->wrapped_dir_baton));
+  *child_baton = db;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_open_directory(const char *path,
+                     void *parent_baton,
+                     svn_revnum_t base_revision,
+                     apr_pool_t *dir_pool,
+                     void **child_baton)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+  fetch_dir_baton_t *db = apr_palloc(dir_pool, sizeof(*db));
+
+  db->eb = pb->eb;
+  SVN_ERR(pb->eb->wrapped_editor->open_directory(path, pb->wrapped_dir_baton,
+                                                 base_revision, dir_pool,
+                                                 &db->wrapped_dir_baton));
+  *child_baton = db;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_change_dir_prop(void *dir_baton,
+                      const char *name,
+                      const svn_string_t *value,
+                      apr_pool_t *pool)
+{
+  fetch_dir_baton_t *db = dir_baton;
+
+  return db->eb->wrapped_editor->change_dir_prop(db->wrapped_dir_baton,
+                                                 name, value, pool);
+}
+
+static svn_error_t *
+fetch_close_directory(void *dir_baton,
+                      apr_pool_t *pool)
+{
+  fetch_dir_baton_t *db = dir_baton;
+
+  return db->eb->wrapped_editor->close_directory(db->wrapped_dir_baton,
+                                                 pool);
+}
+
+static svn_error_t *
+fetch_absent_directory(const char *path,
+                       void *parent_baton,
+                       apr_pool_t *pool)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+
+  return pb->eb->wrapped_editor->absent_directory(path,
+                                                  pb->wrapped_dir_baton,
+                                                  pool);
+}
+
+/* Return a new file baton for PATH in the directory PB.  FILE_POOL is
+ * the pool that the driver passed in. */
+static fetch_file_baton_t *
+make_fetch_file_baton(fetch_dir_baton_t *pb,
+                      const char *path,
+                      apr_pool_t *file_pool)
+{
+  fetch_file_baton_t *fb;
+
+  if (pb->eb->fetch_texts)
+    file_pool = svn_pool_create(pb->eb->pool);
+
+  fb = apr_pcalloc(file_pool, sizeof(*fb));
+  fb->eb = pb->eb;
+  fb->path = apr_pstrdup(file_pool, path);
+  fb->pool = file_pool;
+
+  return fb;
+}
+
+static svn_error_t *
+fetch_add_file(const char *path,
+               void *parent_baton,
+               const char *copyfrom_path,
+               svn_revnum_t copyfrom_revision,
+               apr_pool_t *file_pool,
+               void **file_baton)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+  fetch_file_baton_t *fb = make_fetch_file_baton(pb, path, file_pool);
+
+  SVN_ERR(pb->eb->wrapped_editor->add_file(path, pb->wrapped_dir_baton,
+                                           copyfrom_path, copyfrom_revision,
+                                           fb->pool,
+                                           &fb->wrapped_file_baton));
+  *file_baton = fb;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_open_file(const char *path,
+                void *parent_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *file_pool,
+                void **file_baton)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+  fetch_file_baton_t *fb = make_fetch_file_baton(pb, path, file_pool);
+
+  SVN_ERR(pb->eb->wrapped_editor->open_file(path, pb->wrapped_dir_baton,
+                                            base_revision, fb->pool,
+                                            &fb->wrapped_file_baton));
+  *file_baton = fb;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_apply_textdelta(void *file_baton,
+                      const char *base_checksum,
+                      apr_pool_t *pool,
+                      svn_txdelta_window_handler_t *handler,
+                      void **handler_baton)
+{
+  fetch_file_baton_t *fb = file_baton;
+
+  if (!fb->eb->fetch_texts)
+    return fb->eb->wrapped_editor->apply_textdelta(fb->wrapped_file_baton,
+                                                   base_checksum, pool,
+                                                   handler, handler_baton);
+
+  /* The server only tells us that the contents changed. */
+  fb->fetch_text = TRUE;
+  *handler = svn_delta_noop_window_handler;
+  *handler_baton = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_change_file_prop(void *file_baton,
+                       const char *name,
+                       const svn_string_t *value,
+                       apr_pool_t *pool)
+{
+  fetch_file_baton_t *fb = file_baton;
+
+  return fb->eb->wrapped_editor->change_file_prop(fb->wrapped_file_baton,
+                                                  name, value, pool);
+}
+
+/* Return the repository relpath of the file FB, allocated in POOL. */
+static const char *
+get_fetch_relpath(fetch_file_baton_t *fb,
+                  apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = fb->eb;
+  const char *relpath = fb->path;
+
+  /* The innermost link wins. */
+  while (TRUE)
+    {
+      const char *link_relpath = svn_hash_gets(eb->links, relpath);
+
+      if (link_relpath)
+        return svn_relpath_join(link_relpath,
+                                svn_relpath_skip_ancestor(relpath, fb->path),
+                                pool);
+      if (*relpath == '\0')
+        break;
+
+      relpath = svn_relpath_dirname(relpath, pool);
+    }
+
+  return svn_relpath_join(eb->base_relpath, fb->path, pool);
+}
+
+/* Read the response to the get-file command sent for FB over FB->CONN,
+ * pass the contents to the wrapped editor as a delta against the empty
+ * text and close the file.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+apply_fetched_text(fetch_file_baton_t *fb,
+                   apr_pool_t *scratch_pool)
+{
+  const svn_delta_editor_t *editor = fb->eb->wrapped_editor;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *target;
+
+  SVN_ERR(editor->apply_textdelta(fb->wrapped_file_baton, NULL, fb->pool,
+                                  &handler, &handler_baton));
+  target = svn_txdelta_target_push(handler, handler_baton,
+                                   svn_stream_empty(scratch_pool),
+                                   scratch_pool);
+  SVN_ERR(read_get_file_response(fb->conn,
+                                 get_fetch_relpath(fb, scratch_pool),
+                                 target, NULL, NULL, scratch_pool));
+  SVN_ERR(svn_stream_close(target));
+
+  SVN_ERR(editor->close_file(fb->wrapped_file_baton, fb->text_checksum,
+                             scratch_pool));
+  svn_pool_destroy(fb->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open up to EB->CONNECTIONS, but no more than EB->QUEUED, extra
+ * connections to the repository root. */
+static svn_error_t *
+open_fetch_connections(fetch_edit_baton_t *eb)
+{
+  svn_ra_svn__session_baton_t *sess = eb->sess_baton;
+  const char *url = sess->conn->repos_root;
+  apr_uri_t uri;
+  int window = FETCH_WINDOW;
+  int i;
+
+  eb->conn_count = MIN(eb->connections, eb->queued);
+  eb->conn_pool = svn_pool_create(eb->pool);
+  SVN_ERR(parse_url(url, &uri, eb->conn_pool));
+  eb->conns = apr_palloc(eb->conn_pool, eb->conn_count * sizeof(*eb->conns));
+  for (i = 0; i < eb->conn_count; i++)
+    {
+      SVN_ERR(open_session(&eb->conns[i], url, &uri, NULL, NULL,
+                           sess->config, sess->callbacks,
+                           sess->callbacks_baton, sess->auth_baton,
+                           eb->conn_pool, eb->conn_pool));
+
+      /* See ra_svn_get_dirs(). */
+      if (!svn_ra_svn_has_capability(eb->conns[i]->conn,
+                                     SVN_RA_SVN_CAP_COMMAND_PIPELINE)
+          || !eb->conns[i]->has_username)
+        window = 1;
+    }
+
+  eb->window = eb->conn_count * window;
+
+  return SVN_NO_ERROR;
+}
+
+/* Send get-file commands for the files due in EB, read the responses
+ * that have arrived and hand them to the wrapped editor.  Wait for a
+ * response only if the queue of EB is full.  If FINISH is set, wait for
+ * all of them and close the extra connections.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+fetch_queued_texts(fetch_edit_baton_t *eb,
+                   svn_boolean_t finish,
+                   apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  int i;
+
+  /* Wait for a small batch before we open the connections. */
+  if (!eb->conns && (eb->queued == 0
+                     || (!finish && eb->queued < FETCH_BATCH)))
+    return SVN_NO_ERROR;
+
+  if (!eb->conns)
+    SVN_ERR(open_fetch_connections(eb));
+
+  iterpool = svn_pool_create(scratch_pool);
+  while (eb->queued > 0)
+    {
+      fetch_file_baton_t *fb;
+
+      svn_pool_clear(iterpool);
+
+      if (eb->requested < MIN(eb->queued, eb->window))
+        {
+          while (eb->requested < MIN(eb->queued, eb->window))
+            {
+              fb = eb->queue[(eb->first + eb->requested) % eb->queue_size];
+              fb->conn = eb->conns[eb->next_conn];
+              eb->next_conn = (eb->next_conn + 1) % eb->conn_count;
+
+              SVN_ERR(svn_ra_svn__write_cmd_get_file(
+                        fb->conn->conn, iterpool,
+                        get_fetch_relpath(fb, iterpool), eb->revision,
+                        FALSE, TRUE));
+              ++eb->requested;
+            }
+
+          /* Don't leave the requests sitting in the write buffers. */
+          for (i = 0; i < eb->conn_count; i++)
+            SVN_ERR(svn_ra_svn__flush(eb->conns[i]->conn, iterpool));
+        }
+
+      fb = eb->queue[eb->first];
+
+      /* Don't hold up the tree drive if we can make progress without
+         waiting for the response. */
+      if (!finish && eb->queued < eb->queue_size)
+        {
+          svn_boolean_t has_response, terminated;
+
+          SVN_ERR(svn_ra_svn__has_command(&has_response, &terminated,
+                                          fb->conn->conn, iterpool));
+          if (!has_response && !terminated)
+            break;
+        }
+
+      SVN_ERR(apply_fetched_text(fb, iterpool));
+      eb->first = (eb->first + 1) % eb->queue_size;
+      --eb->queued;
+      --eb->requested;
+    }
+  svn_pool_destroy(iterpool);
+
+  if (finish)
+    {
+      svn_pool_destroy(eb->conn_pool);
+      eb->conn_pool = NULL;
+      eb->conns = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_close_file(void *file_baton,
+                 const char *text_checksum,
+                 apr_pool_t *pool)
+{
+  fetch_file_baton_t *fb = file_baton;
+  fetch_edit_baton_t *eb = fb->eb;
+
+  if (fb->fetch_text)
+    {
+      /* Make room in the queue first. */
+      if (eb->queued == eb->queue_size)
+        SVN_ERR(fetch_queued_texts(eb, FALSE, pool));
+
+      fb->text_checksum = apr_pstrdup(fb->pool, text_checksum);
+      eb->queue[(eb->first + eb->queued) % eb->queue_size] = fb;
+      ++eb->queued;
+
+      return svn_error_trace(fetch_queued_texts(eb, FALSE, pool));
+    }
+
+  SVN_ERR(eb->wrapped_editor->close_file(fb->wrapped_file_baton,
+                                         text_checksum, pool));
+  if (eb->fetch_texts)
+    svn_pool_destroy(fb->pool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_absent_file(const char *path,
+                  void *parent_baton,
+                  apr_pool_t *pool)
+{
+  fetch_dir_baton_t *pb = parent_baton;
+
+  return pb->eb->wrapped_editor->absent_file(path, pb->wrapped_dir_baton,
+                                             pool);
+}
+
+static svn_error_t *
+fetch_close_edit(void *edit_baton,
+                 apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+
+  SVN_ERR(fetch_queued_texts(eb, TRUE, pool));
+  return eb->wrapped_editor->close_edit(eb->wrapped_edit_baton, pool);
+}
+
+static svn_error_t *
+fetch_abort_edit(void *edit_baton,
+                 apr_pool_t *pool)
+{
+  fetch_edit_baton_t *eb = edit_baton;
+
+  if (eb->conn_pool)
+    {
+      svn_pool_destroy(eb->conn_pool);
+      eb->conn_pool = NULL;
+      eb->conns = NULL;
+    }
+
+  return eb->wrapped_editor->abort_edit(eb->wrapped_edit_baton, pool);
+}
+
+/* Set *EDITOR and *EDIT_BATON to an editor that passes the drive on to
+ * WRAPPED_EDITOR and WRAPPED_BATON, but may fetch the contents of changed
+ * files over up to CONNECTIONS extra connections to the repository of
+ * SESS_BATON.  Allocate the editor in POOL. */
+static void
+get_fetch_editor(const svn_delta_editor_t **editor,
+                 fetch_edit_baton_t **edit_baton,
+                 const svn_delta_editor_t *wrapped_editor,
+                 void *wrapped_baton,
+                 svn_ra_svn__session_baton_t *sess_baton,
+                 int connections,
+                 apr_pool_t *pool)
+{
+  svn_delta_editor_t *fetch_editor = svn_delta_default_editor(pool);
+  fetch_edit_baton_t *eb = apr_pcalloc(pool, sizeof(*eb));
+
+  eb->wrapped_editor = wrapped_editor;
+  eb->wrapped_edit_baton = wrapped_baton;
+  eb->sess_baton = sess_baton;
+  eb->base_relpath
+    = svn_uri_skip_ancestor(sess_baton->conn->repos_root,
+                            sess_baton->parent->client_url->data, pool);
+  eb->links = apr_hash_make(pool);
+  eb->connections = connections;
+  eb->revision = SVN_INVALID_REVNUM;
+  eb->queue_size = MAX(FETCH_BATCH, connections * FETCH_WINDOW);
+  eb->queue = apr_palloc(pool, eb->queue_size * sizeof(*eb->queue));
+  eb->pool = pool;
+
+  fetch_editor->set_target_revision = fetch_set_target_revision;
+  fetch_editor->open_root = fetch_open_root;
+  fetch_editor->delete_entry = fetch_delete_entry;
+  fetch_editor->add_directory = fetch_add_directory;
+  fetch_editor->open_directory = fetch_open_directory;
+  fetch_editor->change_dir_prop = fetch_change_dir_prop;
+  fetch_editor->close_directory = fetch_close_directory;
+  fetch_editor->absent_directory = fetch_absent_directory;
+  fetch_editor->add_file = fetch_add_file;
+  fetch_editor->open_file = fetch_open_file;
+  fetch_editor->apply_textdelta = fetch_apply_textdelta;
+  fetch_editor->change_file_prop = fetch_change_file_prop;
+  fetch_editor->close_file = fetch_close_file;
+  fetch_editor->absent_file = fetch_absent_file;
+  fetch_editor->close_edit = fetch_close_edit;
+  fetch_editor->abort_edit = fetch_abort_edit;
+
+  *editor = fetch_editor;
+  *edit_baton = eb;
+}
+
+typedef struct fetch_report_baton_t
+{
+  fetch_edit_baton_t *eb;
+
+  /* The parameters of the update command.  Report paths are relative to
+     TARGET. */
+  svn_revnum_t rev;
+  const char *target;
+  svn_depth_t depth;
+  svn_boolean_t send_copyfrom_args;
+  svn_boolean_t ignore_ancestry;
+
+  /* TRUE once the update command has been sent. */
+  svn_boolean_t started;
+
+  const svn_ra_reporter3_t *wrapped_reporter;
+  void *wrapped_report_baton;
+
+  apr_pool_t *pool;
+} fetch_report_baton_t;
+
+/* Send the update command for the report RB unless that already
+ * happened.  Let the server leave out the file contents if FETCH_TEXTS
+ * is set. */
+static svn_error_t *
+start_fetch_report(fetch_report_baton_t *rb,
+                   svn_boolean_t fetch_texts)
+{
+  svn_ra_svn__session_baton_t *sess_baton = rb->eb->sess_baton;
+
+  if (rb->started)
+    return SVN_NO_ERROR;
+
+  rb->started = TRUE;
+  rb->eb->fetch_texts = fetch_texts;
+  SVN_ERR(svn_ra_svn__write_cmd_update(sess_baton->conn, rb->pool, rb->rev,
+                                       rb->target,
+                                       DEPTH_TO_RECURSE(rb->depth),
+                                       rb->depth, rb->send_copyfrom_args,
+                                       rb->ignore_ancestry, !fetch_texts));
+  SVN_ERR(handle_auth_request(sess_baton, rb->pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+fetch_set_path(void *report_baton,
+               const char *path,
+               svn_revnum_t revision,
+               svn_depth_t depth,
+               svn_boolean_t start_empty,
+               const char *lock_token,
+               apr_pool_t *pool)
+{
+  fetch_report_baton_t *rb = report_baton;
+
+  /* The first call describes the update target.  If it starts empty,
+     e.g. for a checkout, there is no base to send deltas against. */
+  SVN_ERR(start_fetch_report(rb, *path == '\0' && start_empty));
+
+  return rb->wrapped_reporter->set_path(rb->wrapped_report_baton, path,
+                                        revision, depth, start_empty,
+                                        lock_token, pool);
+}
+
+static svn_error_t *
+fetch_delete_path(void *report_baton,
+                  const char *path,
+                  apr_pool_t *pool)
+{
+  fetch_report_baton_t *rb = report_baton;
+
+  SVN_ERR(start_fetch_report(rb, FALSE));
+
+  return rb->wrapped_reporter->delete_path(rb->wrapped_report_baton, path,
+                                           pool);
+}
+
+static svn_error_t *
+fetch_link_path(void *report_baton,
+                const char *path,
+                const char *url,
+                svn_revnum_t revision,
+                svn_depth_t depth,
+                svn_boolean_t start_empty,
+                const char *lock_token,
+                apr_pool_t *pool)
+{
+  fetch_report_baton_t *rb = report_baton;
+  fetch_edit_baton_t *eb = rb->eb;
+  const char *link_relpath;
+
+  SVN_ERR(start_fetch_report(rb, FALSE));
+
+  /* The server rejects URLs outside the repository. */
+  link_relpath = svn_uri_skip_ancestor(eb->sess_baton->conn->repos_root,
+                                       url, eb->pool);
+  if (link_relpath)
+    svn_hash_sets(eb->links, svn_relpath_join(rb->target, path, eb->pool),
+                  link_relpath);
+
+  return rb->wrapped_reporter->link_path(rb->wrapped_report_baton, path, url,
+                                         revision, depth, start_empty,
+                                         lock_token, pool);
+}
+
+static svn_error_t *
+fetch_finish_report(void *report_baton,
+                    apr_pool_t *pool)
+{
+  fetch_report_baton_t *rb = report_baton;
+
+  SVN_ERR(start_fetch_report(rb, FALSE));
+
+  return rb->wrapped_reporter->finish_report(rb->wrapped_report_baton, pool);
+}
+
+static svn_error_t *
+fetch_abort_report(void *report_baton,
+                   apr_pool_t *pool)
+{
+  fetch_report_baton_t *rb = report_baton;
+
+  /* The server does not know about this report yet. */
+  if (!rb->started)
+    return SVN_NO_ERROR;
+
+  return rb->wrapped_reporter->abort_report(rb->wrapped_report_baton, pool);
+}
+
+static const svn_ra_reporter3_t fetch_reporter = {
+  fetch_set_path,
+  fetch_delete_path,
+  fetch_link_path,
+  fetch_finish_report,
+  fetch_abort_report
+};
+
+/* Set *REPORTER and *REPORT_BATON to a reporter that passes the report
+ * on to WRAPPED_REPORTER and WRAPPED_BATON and tells EB about the
+ * switched paths.  It sends the update command for REV, TARGET, DEPTH,
+ * SEND_COPYFROM_ARGS and IGNORE_ANCESTRY once it knows whether EB shall
+ * fetch the file contents.  Allocate the reporter in POOL. */
+static void
+get_fetch_reporter(const svn_ra_reporter3_t **reporter,
+                   void **report_baton,
+                   fetch_edit_baton_t *eb,
+                   svn_revnum_t rev,
+                   const char *target,
+                   svn_depth_t depth,
+                   svn_boolean_t send_copyfrom_args,
+                   svn_boolean_t ignore_ancestry,
+                   const svn_ra_reporter3_t *wrapped_reporter,
+                   void *wrapped_baton,
+                   apr_pool_t *pool)
+{
+  fetch_report_baton_t *rb = apr_pcalloc(pool, sizeof(*rb));
+
+  rb->eb = eb;
+  rb->rev = rev;
+  rb->target = apr_pstrdup(pool, target);
+  rb->depth = depth;
+  rb->send_copyfrom_args = send_copyfrom_args;
+  rb->ignore_ancestry = ignore_ancestry;
+  rb->wrapped_reporter = wrapped_reporter;
+  rb->wrapped_report_baton = wrapped_baton;
+  rb->pool = pool;
+
+  *reporter = &fetch_reporter;
+  *report_baton = rb;
+}
+
+/* Set *CONNECTIONS to the number of extra connections that an update
+ * on SESS_BATON shall use to fetch file contents; 0 for none. */
+static svn_error_t *
+get_update_connections(int *connections,
+                       svn_ra_svn__session_baton_t *sess_baton)
+{
+  svn_config_t *cfg = NULL;
+  const char *server_group;
+  apr_int64_t max_connections;
+
+  *connections = 0;
+
+  /* Every extra tunnel would mean another agent process and possibly
+     another password prompt. */
+  if (sess_baton->is_tunneled
+      || !sess_baton->conn->repos_root
+      || !svn_ra_svn_has_capability(sess_baton->conn,
+                                    SVN_RA_SVN_CAP_UPDATE_TEXT_DELTAS))
+    return SVN_NO_ERROR;
+
+  if (sess_baton->config)
+    cfg = svn_hash_gets(sess_baton->config, SVN_CONFIG_CATEGORY_SERVERS);
+  server_group = svn_auth_get_parameter(sess_baton->auth_baton,
+                                        SVN_AUTH_PARAM_SERVER_GROUP);
+
+  SVN_ERR(svn_config_get_int64(cfg, &max_connections,
+                               SVN_CONFIG_SECTION_GLOBAL,
+                               SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS,
+                               SVN_CONFIG_DEFAULT_OPTION_SVN_MAX_CONNECTIONS));
+  if (server_group)
+    SVN_ERR(svn_config_get_int64(cfg, &max_connections, server_group,
+                                 SVN_CONFIG_OPTION_SVN_MAX_CONNECTIONS,
+                                 max_connections));
+
+  /* The primary connection counts, too.  Be nice to the server. */
+  if (max_connections > 1)
+    *connections = (int)(max_connections > 16 ? 15 : max_connections - 1);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *ra_svn_update(svn_ra_session_t *session,
                                   const svn_ra_reporter3_t **reporter,
                                   void **report_baton, svn_revnum_t rev,
@@ -1720,20 +2672,43 @@ static svn_error_t *ra_svn_update(svn_ra_session_t *session,
   svn_ra_svn__session_baton_t *sess_baton = session->priv;
   svn_ra_svn_conn_t *conn = sess_baton->conn;
   svn_boolean_t recurse = DEPTH_TO_RECURSE(depth);
+  fetch_edit_baton_t *fetch_baton = NULL;
+  int connections;
 
   /* Callbacks may assume that all data is relative the sessions's URL. */
   SVN_ERR(ensure_exact_server_parent(session, scratch_pool));
 
-  /* Tell the server we want to start an update. */
-  SVN_ERR(svn_ra_svn__write_cmd_update(conn, pool, rev, target, recurse,
-                                       depth, send_copyfrom_args,
-                                       ignore_ancestry));
-  SVN_ERR(handle_auth_request(sess_baton, pool));
+  /* Fetch the file contents separately if we may use extra connections. */
+  SVN_ERR(get_update_connections(&connections, sess_baton));
+  if (connections > 0)
+    {
+      get_fetch_editor(&update_editor, &fetch_baton, update_editor,
+                       update_baton, sess_baton, connections, pool);
+      update_baton = fetch_baton;
+    }
+
+  /* Tell the server we want to start an update.  With the fetch editor,
+   * the reporter will do that once it knows whether the server shall
+   * send the file contents. */
+  if (!fetch_baton)
+    {
+      SVN_ERR(svn_ra_svn__write_cmd_update(conn, pool, rev, target, recurse,
+                                           depth, send_copyfrom_args,
+                                           ignore_ancestry, TRUE));
+      SVN_ERR(handle_auth_request(sess_baton, pool));
+    }
 
   /* Fetch a reporter for the caller to drive.  The reporter will drive
    * update_editor upon finish_report(). */
   SVN_ERR(ra_svn_get_reporter(sess_baton, pool, update_editor, update_baton,
                               target, depth, reporter, report_baton));
+
+  /* The fetch editor needs to know about switched paths. */
+  if (fetch_baton)
+    get_fetch_reporter(reporter, report_baton, fetch_baton, rev, target,
+                       depth, send_copyfrom_args, ignore_ancestry,
+                       *reporter, *report_baton, pool);
+
   return SVN_NO_ERROR;
 }
 
@@ -3300,7 +4275,8 @@ static const svn_ra__vtable_t ra_svn_vtable = {
   ra_svn_list,
   ra_svn_register_editor_shim_callbacks,
   NULL /* commit_ev2 */,
-  NULL /* replay_range_ev2 */
+  NULL /* replay_range_ev2 */,
+  ra_svn_get_dirs
 };
 
 svn_error_t *
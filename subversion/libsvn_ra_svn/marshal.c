@@ -210,6 +210,12 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
   conn->current_in = 0;
   conn->max_out = max_out;
   conn->current_out = 0;
+  conn->total_in = 0;
+  conn->total_out = 0;
+  conn->command_start_func = NULL;
+  conn->command_done_func = NULL;
+  conn->command_baton = NULL;
+  conn->command_depth = 0;
   conn->block_handler = NULL;
   conn->block_baton = NULL;
   conn->capabilities = apr_hash_make(result_pool);
@@ -273,13 +279,23 @@ svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn)
   if (svn_ra_svn_compression_level(conn) <= 0)
     return 0;
 
+  /* Prefer SVNDIFF3 for its more compact encoding, unless compression
+   * level 1 asks for the faster LZ4 compression of SVNDIFF2.  SVNDIFF3
+   * uses zlib, just like SVNDIFF1. */
+  if (svn_ra_svn_compression_level(conn) > 1
+      && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED))
+    return 3;
+
   /* Prefer SVNDIFF2 over SVNDIFF1. */
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED))
     return 2;
+  if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED))
+    return 3;
   if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF1))
     return 1;
 
-  /* The connection does not support SVNDIFF1/2; default to "version 0". */
+  /* The connection does not support SVNDIFF1/2/3; default to
+   * "version 0". */
   return 0;
 }
 
@@ -289,6 +305,17 @@ svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn)
   return conn->pool;
 }
 
+void
+svn_ra_svn__set_command_hooks(svn_ra_svn_conn_t *conn,
+                              svn_ra_svn__command_start_func_t start_func,
+                              svn_ra_svn__command_done_func_t done_func,
+                              void *baton)
+{
+  conn->command_start_func = start_func;
+  conn->command_done_func = done_func;
+  conn->command_baton = baton;
+}
+
 svn_error_t *
 svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
                                svn_delta_shim_callbacks_t *shim_callbacks)
@@ -376,6 +403,7 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
    * This is to limit the server load in case users e.g. accidentally ran
    * an export on the root folder. */
   conn->current_out += len;
+  conn->total_out += len;
   SVN_ERR(check_io_limits(conn));
 
   while (data < end)
@@ -509,6 +537,7 @@ static svn_error_t *readbuf_input(svn_ra_svn_conn_t *conn, char *data,
   if (*len == 0)
     return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
   conn->current_in += *len;
+  conn->total_in += *len;
 
   if (session)
     {
@@ -771,6 +800,52 @@ svn_ra_svn__write_cstring(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_ra_svn__write_string_from_file(svn_ra_svn_conn_t *conn,
+                                   apr_pool_t *pool,
+                                   apr_file_t *file,
+                                   apr_off_t offset,
+                                   apr_size_t len)
+{
+  svn_boolean_t sent;
+
+  /* The length prefix must hit the wire before the contents. */
+  SVN_ERR(write_number(conn, pool, len, ':'));
+  SVN_ERR(writebuf_flush(conn, pool));
+
+  SVN_ERR(svn_ra_svn__stream_sendfile(&sent, conn->stream, file, offset,
+                                      len));
+  if (sent)
+    {
+      /* Do the bookkeeping that writebuf_output would have done. */
+      conn->current_out += len;
+      conn->total_out += len;
+      conn->written_since_error_check += len;
+      conn->may_check_for_error
+        = conn->written_since_error_check >= conn->error_check_interval;
+      if (conn->session)
+        conn->session->bytes_written += len;
+
+      SVN_ERR(check_io_limits(conn));
+    }
+  else
+    {
+      /* Fall back to reading the data through our (empty) write buffer. */
+      SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+      while (len > 0)
+        {
+          apr_size_t count = MIN(len, sizeof(conn->write_buf));
+          SVN_ERR(svn_io_file_read_full2(file, conn->write_buf, count,
+                                         NULL, NULL, pool));
+          conn->write_pos = count;
+          SVN_ERR(writebuf_flush(conn, pool));
+          len -= count;
+        }
+    }
+
+  return writebuf_writechar(conn, pool, ' ');
+}
+
 svn_error_t *
 svn_ra_svn__write_word(svn_ra_svn_conn_t *conn,
                        apr_pool_t *pool,
@@ -1915,6 +1990,11 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
   svn_error_t *err, *write_err;
   svn_ra_svn__list_t *params;
   const svn_ra_svn__cmd_entry_t *command;
+  svn_boolean_t notify, failed;
+  apr_time_t start_time = 0;
+  apr_uint64_t start_in = conn->total_in
+                        - (apr_size_t)(conn->read_end - conn->read_ptr);
+  apr_uint64_t start_out = conn->total_out + conn->write_pos;
 
   *terminate = FALSE;
 
@@ -1935,8 +2015,21 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
     }
 
   command = svn_hash_gets(cmd_hash, cmdname);
+
+  /* Only top-level commands get reported to the hooks. */
+  notify = command && conn->command_depth == 0;
+  if (notify)
+    {
+      start_time = apr_time_now();
+      if (conn->command_start_func)
+        SVN_ERR(conn->command_start_func(conn->command_baton, cmdname,
+                                         pool));
+    }
+
   if (command)
     {
+      ++conn->command_depth;
+
       /* Call the standard command handler.
        * If that is not set, then this is a lecagy API call and we invoke
        * the legacy command handler. */
@@ -1952,6 +2045,8 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
                                                baton);
         }
 
+      --conn->command_depth;
+
       /* The command implementation may have swallowed or wrapped the I/O
        * error not knowing that we may no longer be able to send data.
        *
@@ -1968,15 +2063,32 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
       err = svn_error_create(SVN_ERR_RA_SVN_CMD_ERR, err, NULL);
     }
 
+  failed = (err != SVN_NO_ERROR);
   if (err && err->apr_err == SVN_ERR_RA_SVN_CMD_ERR)
     {
       write_err = svn_ra_svn__write_cmd_failure(
                       conn, pool,
                       svn_ra_svn__locate_real_error_child(err));
       svn_error_clear(err);
-      return write_err ? write_err : SVN_NO_ERROR;
+      err = write_err;
     }
 
+  /* Report the command only now that its failure response, if any, has
+   * been written as well.  Count what is still in our write buffer, too.
+   * Pipelining clients may already have sent the next command(s), so
+   * whatever we read but did not parse yet belongs to those. */
+  if (notify && conn->command_done_func)
+    err = svn_error_compose_create(
+              err,
+              conn->command_done_func(conn->command_baton, cmdname,
+                                      apr_time_now() - start_time,
+                                      conn->total_in - start_in
+                                        - (apr_size_t)(conn->read_end
+                                                       - conn->read_ptr),
+                                      conn->total_out + conn->write_pos
+                                        - start_out,
+                                      failed, pool));
+
   return err;
 }
 
@@ -2463,7 +2575,8 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
                              svn_boolean_t recurse,
                              svn_depth_t depth,
                              svn_boolean_t send_copyfrom_args,
-                             svn_boolean_t ignore_ancestry)
+                             svn_boolean_t ignore_ancestry,
+                             svn_boolean_t text_deltas)
 {
   SVN_ERR(writebuf_write_literal(conn, pool, "( update ( "));
   SVN_ERR(write_tuple_start_list(conn, pool));
@@ -2474,6 +2587,7 @@ svn_ra_svn__write_cmd_update(svn_ra_svn_conn_t *conn,
   SVN_ERR(write_tuple_depth(conn, pool, depth));
   SVN_ERR(write_tuple_boolean(conn, pool, send_copyfrom_args));
   SVN_ERR(write_tuple_boolean(conn, pool, ignore_ancestry));
+  SVN_ERR(write_tuple_boolean(conn, pool, text_deltas));
   SVN_ERR(writebuf_write_literal(conn, pool, ") ) "));
 
   return SVN_NO_ERROR;
@@ -102,6 +102,17 @@ struct svn_ra_svn_conn_st {
   apr_uint64_t max_out;
   apr_uint64_t current_out;
 
+  /* Bytes transferred over the lifetime of the connection */
+  apr_uint64_t total_in;
+  apr_uint64_t total_out;
+
+  /* Per-command callbacks and the nesting level of the command currently
+     being handled */
+  svn_ra_svn__command_start_func_t command_start_func;
+  svn_ra_svn__command_done_func_t command_done_func;
+  void *command_baton;
+  int command_depth;
+
   /* repository info */
   const char *uuid;
   const char *repos_root;
@@ -147,6 +158,9 @@ struct svn_ra_svn__session_baton_t {
   apr_pool_t *pool;
   svn_ra_svn_conn_t *conn;
   svn_boolean_t is_tunneled;
+  /* TRUE once the connection authenticated with a username, i.e. the
+   * server will not start another auth exchange in mid-command. */
+  svn_boolean_t has_username;
   svn_auth_baton_t *auth_baton;
   svn_ra_svn__parent_t *parent;
   const char *user;
@@ -222,6 +236,17 @@ svn_ra_svn__stream_t *svn_ra_svn__stream_create(svn_stream_t *in_stream,
 svn_error_t *svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
                                       const char *data, apr_size_t *len);
 
+/* Send LEN bytes from FILE, starting at OFFSET, directly to the socket
+ * behind STREAM using sendfile() and set *SENT to TRUE.  If STREAM is not
+ * a plain socket or the platform does not support sendfile(), don't send
+ * anything and set *SENT to FALSE.
+ */
+svn_error_t *svn_ra_svn__stream_sendfile(svn_boolean_t *sent,
+                                         svn_ra_svn__stream_t *stream,
+                                         apr_file_t *file,
+                                         apr_off_t offset,
+                                         apr_size_t len);
+
 /* Read *LEN bytes from STREAM into DATA, returning the number of bytes
  * read in *LEN.
  */
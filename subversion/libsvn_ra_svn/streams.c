@@ -42,6 +42,9 @@ struct svn_ra_svn__stream_st {
   svn_stream_t *out_stream;
   void *timeout_baton;
   ra_svn_timeout_fn_t timeout_fn;
+
+  /* The plain socket behind OUT_STREAM, if any.  NULL otherwise. */
+  apr_socket_t *sock;
 };
 
 typedef struct sock_baton_t {
@@ -167,6 +170,7 @@ svn_ra_svn__stream_from_sock(apr_socket_t *sock,
 {
   sock_baton_t *b = apr_palloc(result_pool, sizeof(*b));
   svn_stream_t *sock_stream;
+  svn_ra_svn__stream_t *stream;
 
   b->sock = sock;
   b->pool = svn_pool_create(result_pool);
@@ -177,8 +181,11 @@ svn_ra_svn__stream_from_sock(apr_socket_t *sock,
   svn_stream_set_write(sock_stream, sock_write_cb);
   svn_stream_set_data_available(sock_stream, sock_pending_cb);
 
-  return svn_ra_svn__stream_create(sock_stream, sock_stream,
-                                   b, sock_timeout_cb, result_pool);
+  stream = svn_ra_svn__stream_create(sock_stream, sock_stream,
+                                     b, sock_timeout_cb, result_pool);
+  stream->sock = sock;
+
+  return stream;
 }
 
 svn_ra_svn__stream_t *
@@ -193,6 +200,7 @@ svn_ra_svn__stream_create(svn_stream_t *in_stream,
   s->out_stream = out_stream;
   s->timeout_baton = timeout_baton;
   s->timeout_fn = timeout_cb;
+  s->sock = NULL;
   return s;
 }
 
@@ -203,6 +211,50 @@ svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
   return svn_error_trace(svn_stream_write(stream->out_stream, data, len));
 }
 
+svn_error_t *
+svn_ra_svn__stream_sendfile(svn_boolean_t *sent,
+                            svn_ra_svn__stream_t *stream,
+                            apr_file_t *file,
+                            apr_off_t offset,
+                            apr_size_t len)
+{
+#if APR_HAS_SENDFILE
+  if (stream->sock)
+    {
+      apr_interval_time_t interval;
+      apr_status_t status;
+
+      status = apr_socket_timeout_get(stream->sock, &interval);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't get socket timeout"));
+
+      /* Like sock_read_cb, always block until all data has been sent. */
+      apr_socket_timeout_set(stream->sock, -1);
+      while (len > 0 && !status)
+        {
+          apr_size_t count = len;
+          status = apr_socket_sendfile(stream->sock, file, NULL, &offset,
+                                       &count, 0);
+          if (!status && count == 0)
+            status = APR_EOF;
+
+          offset += count;
+          len -= count;
+        }
+      apr_socket_timeout_set(stream->sock, interval);
+
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't write to connection"));
+
+      *sent = TRUE;
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  *sent = FALSE;
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__stream_read(svn_ra_svn__stream_t *stream, char *data,
                         apr_size_t *len)
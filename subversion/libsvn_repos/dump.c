@@ -45,6 +45,7 @@
 #include "private/svn_utf_private.h"
 #include "private/svn_cache.h"
 #include "private/svn_fspath.h"
+#include "private/svn_task.h"
 
 #define ARE_VALID_COPY_ARGS(p,r) ((p) && SVN_IS_VALID_REVNUM(r))
 
@@ -2459,12 +2460,401 @@ report_error(svn_revnum_t revision,
     }
 }
 
+/*** Concurrent revision verification. ***/
+
+/* Verify ranges of up to this many revisions within a single task.
+ * Larger ranges get split into up to VERIFY_FAN_OUT sub-ranges. */
+#define VERIFY_BATCH_SIZE 16
+#define VERIFY_FAN_OUT 16
+
+/* A notification or FS warning produced while verifying some revision in
+ * a worker thread.  Exactly one of the members is not NULL. */
+typedef struct verify_event_t
+{
+  svn_repos_notify_t *notify;
+  svn_error_t *warning;
+} verify_event_t;
+
+/* Outcome of verifying a single REVISION. */
+typedef struct verified_rev_t
+{
+  svn_revnum_t revision;
+
+  /* Array of verify_event_t, in the order they occurred. */
+  apr_array_header_t *events;
+
+  /* The verification error or SVN_NO_ERROR. */
+  svn_error_t *err;
+} verified_rev_t;
+
+/* Thread context for verification tasks. */
+typedef struct verify_context_t
+{
+  /* FS instance to be used by this thread only. */
+  svn_fs_t *fs;
+
+  /* Array of verify_event_t for the revision currently being verified.
+   * Points to PENDING between revisions. */
+  apr_array_header_t *events;
+
+  /* Array of verify_event_t for FS warnings that occurred while no
+   * revision was being verified.  They will be reported together with
+   * the next revision verified by this thread. */
+  apr_array_header_t *pending;
+} verify_context_t;
+
+/* Parameters shared by all verification tasks.  Treat as read-only while
+ * the tasks are running. */
+typedef struct verify_shared_t
+{
+  /* Used to open the per-thread FS instances. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+
+  /* Parameters to pass to verify_one_revision(). */
+  svn_revnum_t start_rev;
+  svn_boolean_t check_normalization;
+
+  /* Where to report to, in the main thread.  NOTIFY may be NULL if
+   * NOTIFY_FUNC is NULL. */
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+  svn_repos_notify_t *notify;
+  svn_fs_warning_callback_t warning_func;
+  void *warning_baton;
+  svn_repos_verify_callback_t verify_callback;
+  void *verify_baton;
+} verify_shared_t;
+
+/* Process baton for the verification tasks. */
+typedef struct verify_range_t
+{
+  verify_shared_t *shared;
+
+  /* Revisions to verify, inclusive. */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+} verify_range_t;
+
+/* Implements svn_repos_notify_func_t.
+ *
+ * Append a copy of NOTIFY to the current events list of the
+ * verify_context_t given as BATON.
+ */
+static void
+collect_verify_notification(void *baton,
+                            const svn_repos_notify_t *notify,
+                            apr_pool_t *scratch_pool)
+{
+  verify_context_t *context = baton;
+  apr_pool_t *pool = context->events->pool;
+  verify_event_t *event = apr_array_push(context->events);
+
+  event->notify = apr_pmemdup(pool, notify, sizeof(*notify));
+  event->notify->warning_str = apr_pstrdup(pool, notify->warning_str);
+  event->notify->path = apr_pstrdup(pool, notify->path);
+  event->warning = NULL;
+}
+
+/* Implements svn_fs_warning_callback_t.
+ *
+ * Append a copy of ERR to the current events list of the
+ * verify_context_t given as BATON.
+ */
+static void
+collect_verify_warning(void *baton,
+                       svn_error_t *err)
+{
+  verify_context_t *context = baton;
+  verify_event_t *event = apr_array_push(context->events);
+
+  event->notify = NULL;
+  event->warning = svn_error_dup(err);
+}
+
+/* Pool cleanup function clearing all warnings in the array of
+ * verify_event_t given as DATA that have not been reported yet. */
+static apr_status_t
+clear_pending_warnings(void *data)
+{
+  apr_array_header_t *events = data;
+  int i;
+
+  for (i = 0; i < events->nelts; ++i)
+    svn_error_clear(APR_ARRAY_IDX(events, i, verify_event_t).warning);
+
+  return APR_SUCCESS;
+}
+
+/* Pool cleanup function clearing all errors and warnings in the array
+ * of verified_rev_t given as DATA that have not been reported yet. */
+static apr_status_t
+clear_verify_errors(void *data)
+{
+  apr_array_header_t *verified = data;
+  int i, k;
+
+  for (i = 0; i < verified->nelts; ++i)
+    {
+      verified_rev_t *entry = &APR_ARRAY_IDX(verified, i, verified_rev_t);
+      for (k = 0; k < entry->events->nelts; ++k)
+        svn_error_clear(APR_ARRAY_IDX(entry->events, k,
+                                      verify_event_t).warning);
+
+      svn_error_clear(entry->err);
+    }
+
+  return APR_SUCCESS;
+}
+
+/* Implements svn_task__thread_context_constructor_t.
+ *
+ * Open a new verify_context_t for the verify_shared_t given as
+ * CONTEXT_BATON and return it in *THREAD_CONTEXT.
+ */
+static svn_error_t *
+open_verify_context(void **thread_context,
+                    void *context_baton,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  verify_shared_t *shared = context_baton;
+  verify_context_t *context = apr_pcalloc(result_pool, sizeof(*context));
+
+  /* The FS may warn at any time, e.g. while being opened. */
+  context->pending = apr_array_make(result_pool, 0, sizeof(verify_event_t));
+  context->events = context->pending;
+  apr_pool_cleanup_register(result_pool, context->pending,
+                            clear_pending_warnings, apr_pool_cleanup_null);
+
+  SVN_ERR(svn_fs_open2(&context->fs, shared->fs_path, shared->fs_config,
+                       result_pool, scratch_pool));
+  svn_fs_set_warning_func(context->fs, collect_verify_warning, context);
+
+  *thread_context = context;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+ *
+ * Verify the revisions in the verify_range_t given as PROCESS_BATON,
+ * using the FS in the verify_context_t given as THREAD_CONTEXT.  Return
+ * the outcome as an array of verified_rev_t in *RESULT.  Large ranges
+ * will be split into sub-tasks instead.
+ *
+ * Verification errors are part of the result.  Only errors that prevent
+ * the verification from continuing, i.e. cancellation, get returned.
+ */
+static svn_error_t *
+verify_range(void **result,
+             svn_task__t *task,
+             void *thread_context,
+             void *process_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  verify_range_t *range = process_baton;
+  verify_shared_t *shared = range->shared;
+  verify_context_t *context = thread_context;
+  apr_array_header_t *verified;
+  apr_pool_t *iterpool;
+  svn_revnum_t count = range->end_rev - range->start_rev + 1;
+  svn_revnum_t rev;
+
+  if (count > VERIFY_BATCH_SIZE)
+    {
+      svn_revnum_t step = (count + VERIFY_FAN_OUT - 1) / VERIFY_FAN_OUT;
+      if (step < VERIFY_BATCH_SIZE)
+        step = VERIFY_BATCH_SIZE;
+
+      for (rev = range->start_rev; rev <= range->end_rev; rev += step)
+        {
+          apr_pool_t *process_pool = svn_task__create_process_pool(task);
+          verify_range_t *sub_range = apr_pcalloc(process_pool,
+                                                  sizeof(*sub_range));
+
+          sub_range->shared = shared;
+          sub_range->start_rev = rev;
+          sub_range->end_rev = MIN(rev + step - 1, range->end_rev);
+
+          SVN_ERR(svn_task__add_similar(task, process_pool, NULL,
+                                        sub_range));
+        }
+
+      *result = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  verified = apr_array_make(result_pool, (int)count, sizeof(verified_rev_t));
+  apr_pool_cleanup_register(result_pool, verified, clear_verify_errors,
+                            apr_pool_cleanup_null);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (rev = range->start_rev; rev <= range->end_rev; ++rev)
+    {
+      verified_rev_t *entry = apr_array_push(verified);
+
+      svn_pool_clear(iterpool);
+
+      entry->revision = rev;
+      entry->events = apr_array_make(result_pool, 0, sizeof(verify_event_t));
+      entry->err = SVN_NO_ERROR;
+
+      /* Report warnings from between revisions with this one. */
+      apr_array_cat(entry->events, context->pending);
+      apr_array_clear(context->pending);
+
+      context->events = entry->events;
+      entry->err = verify_one_revision(context->fs, rev,
+                                       shared->notify_func
+                                         ? collect_verify_notification
+                                         : NULL,
+                                       context,
+                                       shared->start_rev,
+                                       shared->check_normalization,
+                                       cancel_func, cancel_baton,
+                                       iterpool);
+      context->events = context->pending;
+
+      if (entry->err && entry->err->apr_err == SVN_ERR_CANCELLED)
+        {
+          svn_error_t *err = entry->err;
+          entry->err = SVN_NO_ERROR;
+
+          return svn_error_trace(err);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  *result = verified;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ *
+ * Report the array of verified_rev_t given as RESULT to the callbacks in
+ * the verify_shared_t given as OUTPUT_BATON, just like the serial loop in
+ * svn_repos_verify_fs4() would.
+ */
+static svn_error_t *
+report_verified_range(svn_task__t *task,
+                      void *result,
+                      void *output_baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *verified = result;
+  verify_shared_t *shared = output_baton;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i, k;
+
+  for (i = 0; i < verified->nelts; ++i)
+    {
+      verified_rev_t *entry = &APR_ARRAY_IDX(verified, i, verified_rev_t);
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+
+      for (k = 0; k < entry->events->nelts; ++k)
+        {
+          verify_event_t *event = &APR_ARRAY_IDX(entry->events, k,
+                                                 verify_event_t);
+          if (event->notify)
+            {
+              shared->notify_func(shared->notify_baton, event->notify,
+                                  iterpool);
+            }
+          else
+            {
+              shared->warning_func(shared->warning_baton, event->warning);
+              svn_error_clear(event->warning);
+              event->warning = SVN_NO_ERROR;
+            }
+        }
+
+      /* The error is ours now. */
+      err = entry->err;
+      entry->err = SVN_NO_ERROR;
+
+      if (err)
+        {
+          SVN_ERR(report_error(entry->revision, err, shared->verify_callback,
+                               shared->verify_baton, iterpool));
+        }
+      else if (shared->notify_func)
+        {
+          /* Tell the caller that we're done with this revision. */
+          shared->notify->revision = entry->revision;
+          shared->notify_func(shared->notify_baton, shared->notify, iterpool);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify revisions START_REV to END_REV in FS using up to THREAD_COUNT
+ * worker threads.  Notifications, FS warnings and verification errors
+ * are reported in the current thread and in revision order.
+ *
+ * The remaining parameters have the same meaning as for
+ * svn_repos_verify_fs4(), with NOTIFY being the reusable
+ * svn_repos_notify_verify_rev_end notification if NOTIFY_FUNC is set.
+ */
+static svn_error_t *
+verify_revisions_concurrently(svn_fs_t *fs,
+                              svn_revnum_t start_rev,
+                              svn_revnum_t end_rev,
+                              svn_boolean_t check_normalization,
+                              int thread_count,
+                              svn_repos_notify_func_t notify_func,
+                              void *notify_baton,
+                              svn_repos_notify_t *notify,
+                              svn_repos_verify_callback_t verify_callback,
+                              void *verify_baton,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *scratch_pool)
+{
+  verify_shared_t shared = { 0 };
+  verify_range_t range;
+
+  shared.fs_path = svn_fs_path(fs, scratch_pool);
+  shared.fs_config = svn_fs_config(fs, scratch_pool);
+  shared.start_rev = start_rev;
+  shared.check_normalization = check_normalization;
+  shared.notify_func = notify_func;
+  shared.notify_baton = notify_baton;
+  shared.notify = notify;
+  shared.verify_callback = verify_callback;
+  shared.verify_baton = verify_baton;
+  svn_fs__get_warning_func(&shared.warning_func, &shared.warning_baton, fs);
+
+  range.shared = &shared;
+  range.start_rev = start_rev;
+  range.end_rev = end_rev;
+
+  return svn_error_trace(svn_task__run(thread_count,
+                                       verify_range, &range,
+                                       report_verified_range, &shared,
+                                       open_verify_context, &shared,
+                                       cancel_func, cancel_baton,
+                                       scratch_pool, scratch_pool));
+}
+
 svn_error_t *
-svn_repos_verify_fs3(svn_repos_t *repos,
+svn_repos_verify_fs4(svn_repos_t *repos,
                      svn_revnum_t start_rev,
                      svn_revnum_t end_rev,
                      svn_boolean_t check_normalization,
                      svn_boolean_t metadata_only,
+                     int thread_count,
                      svn_repos_notify_func_t notify_func,
                      void *notify_baton,
                      svn_repos_verify_callback_t verify_callback,
@@ -2477,7 +2867,7 @@ svn_repos_verify_fs3(svn_repos_t *repos,
   svn_revnum_t youngest;
   svn_revnum_t rev;
   apr_pool_t *iterpool = svn_pool_create(pool);
-  svn_repos_notify_t *notify;
+  svn_repos_notify_t *notify = NULL;
   svn_fs_progress_notify_func_t verify_notify = NULL;
   struct verify_fs_notify_func_baton_t *verify_notify_baton = NULL;
   svn_error_t *err;
@@ -2537,7 +2927,14 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                            verify_baton, iterpool));
     }
 
-  if (!metadata_only)
+  if (!metadata_only && thread_count > 1)
+    SVN_ERR(verify_revisions_concurrently(fs, start_rev, end_rev,
+                                          check_normalization, thread_count,
+                                          notify_func, notify_baton, notify,
+                                          verify_callback, verify_baton,
+                                          cancel_func, cancel_baton,
+                                          iterpool));
+  else if (!metadata_only)
     for (rev = start_rev; rev <= end_rev; rev++)
       {
         svn_pool_clear(iterpool);
@@ -35,12 +35,17 @@
 #include "svn_private_config.h"
 
 #include "private/svn_dep_compat.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 
 #define NUM_CACHED_SOURCE_ROOTS 4
 
+/* Number of target files per call to svn_fs__prefetch_file_contents.
+   delta_dirs keeps the prefetching about this many entries ahead. */
+#define PREFETCH_WINDOW 16
+
 /* Theory of operation: we write report operations out to a spill-buffer
    as we receive them.  When the report is finished, we read the
    operations back out again, using them to guide the progression of
@@ -1099,6 +1104,48 @@ update_entry(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
 #define DEPTH_BELOW_HERE(depth) ((depth) == svn_depth_immediates) ? \
                                  svn_depth_empty : (depth)
 
+/* Ask the FS to start loading the contents of the next PREFETCH_WINDOW
+   entries in ORDERED_ENTRIES, beginning at index *NEXT, and advance *NEXT
+   past them.  The entries are the dirents of directory T_PATH in B's
+   target root.  Only files that differ from their counterpart in
+   S_ENTRIES, if any, will be prefetched.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+prefetch_file_contents(report_baton_t *b,
+                       const char *t_path,
+                       const apr_array_header_t *ordered_entries,
+                       apr_hash_t *s_entries,
+                       int *next,
+                       apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *paths
+    = apr_array_make(scratch_pool, PREFETCH_WINDOW, sizeof(const char *));
+  int end = ordered_entries->nelts - *next > PREFETCH_WINDOW
+          ? *next + PREFETCH_WINDOW
+          : ordered_entries->nelts;
+
+  for (; *next < end; ++*next)
+    {
+      const svn_fs_dirent_t *t_entry
+        = APR_ARRAY_IDX(ordered_entries, *next, svn_fs_dirent_t *);
+      const svn_fs_dirent_t *s_entry;
+
+      if (t_entry->kind != svn_node_file)
+        continue;
+
+      /* Unchanged files won't be sent. */
+      s_entry = s_entries ? svn_hash_gets(s_entries, t_entry->name) : NULL;
+      if (s_entry && svn_fs_compare_ids(s_entry->id, t_entry->id) == 0)
+        continue;
+
+      APR_ARRAY_PUSH(paths, const char *)
+        = svn_fspath__join(t_path, t_entry->name, scratch_pool);
+    }
+
+  return svn_error_trace(svn_fs__prefetch_file_contents(b->t_root, paths,
+                                                        scratch_pool));
+}
+
 /* Emit edits within directory DIR_BATON (with corresponding path
    E_PATH) with the changes from the directory S_REV/S_PATH to the
    directory B->t_rev/T_PATH.  S_PATH may be NULL if the entry does
@@ -1164,7 +1211,7 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
   apr_hash_index_t *hi;
   apr_pool_t *subpool = svn_pool_create(pool);
   apr_array_header_t *t_ordered_entries = NULL;
-  int i;
+  int i, prefetched = 0;
 
   /* Compare the property lists.  If we're starting empty, pass a NULL
      source path so that we add all the properties.
@@ -1313,6 +1360,15 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
 
           svn_pool_clear(iterpool);
 
+          /* Keep the FS loading file contents ahead of the editor drive,
+             so we won't have to wait for each delta chain in turn. */
+          if (b->text_deltas
+              && prefetched < i + PREFETCH_WINDOW
+              && prefetched < t_ordered_entries->nelts)
+            SVN_ERR(prefetch_file_contents(b, t_path, t_ordered_entries,
+                                           s_entries, &prefetched,
+                                           iterpool));
+
           if (is_depth_upgrade(wc_depth, requested_depth, t_entry->kind))
             {
               /* We're making the working copy deeper, pretend the source
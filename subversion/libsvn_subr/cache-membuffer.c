@@ -23,8 +23,14 @@
 
 #include <assert.h>
 #include <apr_md5.h>
+#include <apr_shm.h>
+#include <apr_thread_proc.h>
 #include <apr_thread_rwlock.h>
 
+#if APR_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include "svn_pools.h"
 #include "svn_checksum.h"
 #include "svn_private_config.h"
@@ -129,6 +135,15 @@
  * to scale well despite that bottleneck, we simply segment the cache into
  * a number of independent caches (segments). Items will be multiplexed based
  * on their hash key.
+ *
+ * The membuffer may also be placed in anonymous shared memory, such that
+ * all processes forked after its creation use the same cache contents.
+ * Since fork() preserves the address space, all pointers within the shared
+ * structures remain valid.  Process-local structures such as APR locks
+ * can't be used for serialization, though.  A shared membuffer uses robust
+ * process-shared mutexes stored within the shared memory instead.  If a
+ * process dies while holding a segment's mutex, the next process to lock
+ * it will find the segment in an undefined state and simply clear it.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -146,6 +161,25 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* Even an uncontended read lock is expensive on many-core machines because
+ * every reader has to modify the lock object, i.e. the respective cache
+ * line bounces between all cores that access the same segment.
+ *
+ * Therefore, lookups first try to read the segment without any lock and
+ * validate the result against the segment's UPDATE_COUNT afterwards
+ * (a "sequence lock").  Only if a writer interfered, they fall back to the
+ * read lock.  This requires full memory barriers, which we can only get
+ * from the compiler.  The checks in SVN_DEBUG_CACHE_MEMBUFFER mode need
+ * the locked code path.
+ */
+#if APR_HAS_THREADS && !defined(SVN_DEBUG_CACHE_MEMBUFFER) \
+    && SVN_CACHE__HAS_MEMORY_BARRIER
+#  define USE_OPTIMISTIC_READS 1
+#  define MEMORY_BARRIER() SVN_CACHE__MEMORY_BARRIER()
+#else
+#  define USE_OPTIMISTIC_READS 0
+#endif
+
 /* For more efficient copy operations, let's align all data items properly.
  * Since we can't portably align pointers, this is rather the item size
  * granularity which ensures *relative* alignment within the cache - still
@@ -267,19 +301,73 @@ typedef struct prefix_pool_t
    * the implementation may . */
   apr_size_t bytes_used;
 
+  /* If not NULL, this pool lives in shared memory and the strings in VALUES
+   * are allocated from this buffer of BYTES_MAX bytes.  MAP is then only a
+   * process-local index of VALUES that may lag behind VALUES_USED. */
+  char *arena;
+
+  /* Serializes modifications of VALUES across processes.
+   * Only used if ARENA is not NULL. */
+  svn_cache__shared_lock_t shared_lock;
+
   /* The serialization object. */
   svn_mutex__t *mutex;
 } prefix_pool_t;
 
-/* Set *PREFIX_POOL to a new instance that tries to limit allocation to
- * BYTES_MAX bytes.  If MUTEX_REQUIRED is set and multi-threading is
- * supported, serialize all access to the new instance.  Allocate the
- * object from *RESULT_POOL. */
-static svn_error_t *
-prefix_pool_create(prefix_pool_t **prefix_pool,
-                   apr_size_t bytes_max,
-                   svn_boolean_t mutex_required,
-                   apr_pool_t *result_pool)
+/* Memory to allocate the membuffer data structures from.  This is either
+ * an APR pool or, for shared caches, a pre-allocated shared memory block.
+ */
+typedef struct cache_memory_t
+{
+  /* Pool to allocate from if BASE is NULL.  Always used for process-local
+   * structures. */
+  apr_pool_t *pool;
+
+  /* Start of the shared memory block or NULL. */
+  char *base;
+
+  /* Size of the block at BASE in bytes. */
+  apr_size_t size;
+
+  /* Number of bytes at BASE already handed out. */
+  apr_size_t used;
+} cache_memory_t;
+
+/* Align integer VALUE to the next ITEM_ALIGNMENT boundary.
+ */
+#define ALIGN_VALUE(value) (((value) + ITEM_ALIGNMENT-1) & -ITEM_ALIGNMENT)
+
+/* Allocate SIZE bytes from MEMORY.  Zero them if CLEAR is set.  Return
+ * NULL if the shared memory block has been exhausted.
+ */
+static void *
+cache_memory_alloc(cache_memory_t *memory,
+                   apr_size_t size,
+                   svn_boolean_t clear)
+{
+  void *result;
+
+  if (memory->base == NULL)
+    return clear ? apr_pcalloc(memory->pool, size)
+                 : apr_palloc(memory->pool, size);
+
+  size = ALIGN_VALUE(size);
+  if (memory->size - memory->used < size)
+    return NULL;
+
+  result = memory->base + memory->used;
+  memory->used += size;
+  if (clear)
+    memset(result, 0, size);
+
+  return result;
+}
+
+/* Number of entries in the VALUES array of a prefix pool with BYTES_MAX
+ * bytes.
+ */
+static apr_size_t
+prefix_pool_capacity(apr_size_t bytes_max)
 {
   enum
     {
@@ -290,16 +378,44 @@ prefix_pool_create(prefix_pool_t **prefix_pool,
       ESTIMATED_BYTES_PER_ENTRY = 120
     };
 
+  return MIN(APR_UINT32_MAX, bytes_max / ESTIMATED_BYTES_PER_ENTRY);
+}
+
+/* Return the number of shared memory bytes that prefix_pool_create needs
+ * for a shared prefix pool with BYTES_MAX bytes.
+ */
+static apr_size_t
+prefix_pool_shared_size(apr_size_t bytes_max)
+{
+  return ALIGN_VALUE(sizeof(prefix_pool_t))
+       + ALIGN_VALUE(prefix_pool_capacity(bytes_max) * sizeof(const char *))
+       + ALIGN_VALUE(bytes_max);
+}
+
+/* Set *PREFIX_POOL to a new instance that tries to limit allocation to
+ * BYTES_MAX bytes.  If MUTEX_REQUIRED is set and multi-threading is
+ * supported, serialize all access to the new instance.  Allocate the
+ * object from MEMORY.  If that is a shared memory block, the pool contents
+ * will be shared between processes as well. */
+static svn_error_t *
+prefix_pool_create(prefix_pool_t **prefix_pool,
+                   apr_size_t bytes_max,
+                   svn_boolean_t mutex_required,
+                   cache_memory_t *memory)
+{
   /* Number of entries we are going to support. */
-  apr_size_t capacity = MIN(APR_UINT32_MAX,
-                            bytes_max / ESTIMATED_BYTES_PER_ENTRY);
+  apr_size_t capacity = prefix_pool_capacity(bytes_max);
 
   /* Construct the result struct. */
-  prefix_pool_t *result = apr_pcalloc(result_pool, sizeof(*result));
-  result->map = svn_hash__make(result_pool);
+  prefix_pool_t *result = cache_memory_alloc(memory, sizeof(*result), TRUE);
+  if (result == NULL)
+    return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+  result->map = svn_hash__make(memory->pool);
 
   result->values = capacity
-                 ? apr_pcalloc(result_pool, capacity * sizeof(const char *))
+                 ? cache_memory_alloc(memory, capacity * sizeof(const char *),
+                                      TRUE)
                  : NULL;
   result->values_max = (apr_uint32_t)capacity;
   result->values_used = 0;
@@ -307,7 +423,18 @@ prefix_pool_create(prefix_pool_t **prefix_pool,
   result->bytes_max = bytes_max;
   result->bytes_used = capacity * sizeof(svn_membuf_t);
 
-  SVN_ERR(svn_mutex__init(&result->mutex, mutex_required, result_pool));
+  /* Shared pools can't use the MAP's pool for the strings. */
+  if (memory->base)
+    {
+      result->arena = cache_memory_alloc(memory, bytes_max, FALSE);
+      result->bytes_used = 0;
+      if (result->arena == NULL)
+        return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+      SVN_ERR(svn_cache__shared_lock_init(&result->shared_lock));
+    }
+
+  SVN_ERR(svn_mutex__init(&result->mutex, mutex_required, memory->pool));
 
   /* Done. */
   *prefix_pool = result;
@@ -378,15 +505,83 @@ prefix_pool_get_internal(apr_uint32_t *prefix_idx,
   return SVN_NO_ERROR;
 }
 
+/* Variant of prefix_pool_get_internal for pools in shared memory.
+ * Other processes may have added entries to PREFIX_POOL that are not in
+ * our MAP, yet.  So, search the shared VALUES array and update MAP.
+ * To be called by prefix_pool_get() only. */
+static svn_error_t *
+prefix_pool_get_shared(apr_uint32_t *prefix_idx,
+                       prefix_pool_t *prefix_pool,
+                       const char *prefix)
+{
+  apr_size_t prefix_len = strlen(prefix);
+  const char **value;
+  apr_uint32_t i;
+  svn_boolean_t acquired, recovered;
+
+  /* Lookup.  If we already know that prefix, return its index. */
+  value = apr_hash_get(prefix_pool->map, prefix, prefix_len);
+  if (value != NULL)
+    {
+      *prefix_idx = (apr_uint32_t)(value - prefix_pool->values);
+      return SVN_NO_ERROR;
+    }
+
+  /* A dead lock owner can't have left VALUES_USED pointing to incomplete
+   * entries because that counter gets bumped last.  So, RECOVERED does
+   * not need any special treatment. */
+  SVN_ERR(svn_cache__shared_lock_acquire(&prefix_pool->shared_lock, TRUE,
+                                         &acquired, &recovered));
+
+  /* Someone else may have added it already. */
+  for (i = 0; i < prefix_pool->values_used; ++i)
+    if (strcmp(prefix_pool->values[i], prefix) == 0)
+      break;
+
+  /* Add new entry, if there is room left. */
+  if (   i == prefix_pool->values_used
+      && i < prefix_pool->values_max
+      && prefix_pool->bytes_max - prefix_pool->bytes_used > prefix_len)
+    {
+      char *copy = prefix_pool->arena + prefix_pool->bytes_used;
+      memcpy(copy, prefix, prefix_len + 1);
+      prefix_pool->bytes_used += prefix_len + 1;
+
+      prefix_pool->values[i] = copy;
+      ++prefix_pool->values_used;
+    }
+
+  if (i < prefix_pool->values_used)
+    {
+      /* The entries in VALUES never change, i.e. we may index them. */
+      value = &prefix_pool->values[i];
+      apr_hash_set(prefix_pool->map, *value, prefix_len, value);
+      *prefix_idx = i;
+    }
+  else
+    {
+      *prefix_idx = NO_INDEX;
+    }
+
+  return svn_error_trace(
+           svn_cache__shared_lock_release(&prefix_pool->shared_lock,
+                                          SVN_NO_ERROR));
+}
+
 /* Thread-safe wrapper around prefix_pool_get_internal. */
 static svn_error_t *
 prefix_pool_get(apr_uint32_t *prefix_idx,
                 prefix_pool_t *prefix_pool,
                 const char *prefix)
 {
-  SVN_MUTEX__WITH_LOCK(prefix_pool->mutex,
-                       prefix_pool_get_internal(prefix_idx, prefix_pool,
+  if (prefix_pool->arena)
+    SVN_MUTEX__WITH_LOCK(prefix_pool->mutex,
+                         prefix_pool_get_shared(prefix_idx, prefix_pool,
                                                 prefix));
+  else
+    SVN_MUTEX__WITH_LOCK(prefix_pool->mutex,
+                         prefix_pool_get_internal(prefix_idx, prefix_pool,
+                                                  prefix));
 
   return SVN_NO_ERROR;
 }
@@ -805,29 +1000,118 @@ struct svn_membuffer_t
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
   /* Same for read-write lock. */
   apr_thread_rwlock_t *lock;
+#endif
 
   /* If set, write access will wait until they get exclusive access.
    * Otherwise, they will become no-ops if the segment is currently
-   * read-locked.  Only used when LOCK is an r/w lock.
+   * read-locked.  Only used when LOCK is an r/w lock or for SHARED
+   * segments.
    */
   svn_boolean_t allow_blocking_writes;
-#endif
+
+  /* If set, this segment lives in shared memory and may be accessed by
+   * multiple processes.  LOCK will be NULL and SHARED_LOCK serializes all
+   * access to this segment instead. */
+  svn_boolean_t shared;
+
+  /* Mutex for SHARED segments.  Readers and writers alike need
+   * exclusive access but see USE_OPTIMISTIC_READS. */
+  svn_cache__shared_lock_t shared_lock;
 
   /* A write lock counter, must be either 0 or 1.
    * This one is only used in debug assertions to verify that you used
    * the correct multi-threading settings. */
   svn_atomic_t write_lock_count;
+
+  /* Incremented before and after every modification of this segment's
+   * directory or data buffer.  Odd values indicate that a writer is
+   * active.  Lock-free readers use this to detect concurrent updates.
+   * See USE_OPTIMISTIC_READS. */
+  svn_atomic_t update_count;
 };
 
-/* Align integer VALUE to the next ITEM_ALIGNMENT boundary.
+/* Remove all entries from the segment CACHE.  The caller must hold the
+ * write lock and notify lock-free readers.
  */
-#define ALIGN_VALUE(value) (((value) + ITEM_ALIGNMENT-1) & -ITEM_ALIGNMENT)
+static void
+clear_segment(svn_membuffer_t *cache)
+{
+  /* Length of the group_initialized array in bytes.
+     See also svn_cache__membuffer_cache_create(). */
+  apr_size_t group_init_size
+    = 1 + (cache->group_count + cache->spare_group_count)
+            / (8 * GROUP_INIT_GRANULARITY);
+
+  /* Mark all groups as "not initialized", which implies "empty". */
+  cache->first_spare_group = NO_INDEX;
+  cache->max_spare_used = 0;
+
+  memset(cache->group_initialized, 0, group_init_size);
+
+  /* Unlink L1 contents. */
+  cache->l1.first = NO_INDEX;
+  cache->l1.last = NO_INDEX;
+  cache->l1.next = NO_INDEX;
+  cache->l1.current_data = cache->l1.start_offset;
+
+  /* Unlink L2 contents. */
+  cache->l2.first = NO_INDEX;
+  cache->l2.last = NO_INDEX;
+  cache->l2.next = NO_INDEX;
+  cache->l2.current_data = cache->l2.start_offset;
+
+  /* Reset content counters. */
+  cache->data_used = 0;
+  cache->used_entries = 0;
+}
+
+/* Acquire the SHARED_LOCK of the shared segment CACHE.  If BLOCKING is
+ * not set, set *SUCCESS to FALSE if the lock is currently being held by
+ * someone else; leave it untouched otherwise.
+ */
+static svn_error_t *
+lock_shared_segment(svn_membuffer_t *cache,
+                    svn_boolean_t blocking,
+                    svn_boolean_t *success)
+{
+  svn_boolean_t acquired, recovered;
+
+  SVN_ERR(svn_cache__shared_lock_acquire(&cache->shared_lock, blocking,
+                                         &acquired, &recovered));
+  if (!acquired)
+    {
+      *success = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  /* The previous owner died and may have left the segment in any state.
+   * Start over with an empty segment.  Unless the owner died within a
+   * begin_update / end_update bracket, open one such that lock-free
+   * readers will ignore whatever they read in the meantime. */
+  if (recovered)
+    {
+      if ((svn_atomic_read(&cache->update_count) & 1) == 0)
+        svn_atomic_inc(&cache->update_count);
+
+      clear_segment(cache);
+      svn_atomic_set(&cache->write_lock_count, 0);
+      svn_atomic_inc(&cache->update_count);
+    }
+
+  return SVN_NO_ERROR;
+}
 
 /* If locking is supported for CACHE, acquire a read lock for it.
  */
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->shared)
+    {
+      svn_boolean_t success = TRUE;
+      return svn_error_trace(lock_shared_segment(cache, TRUE, &success));
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -851,6 +1135,11 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+  if (cache->shared)
+    return svn_error_trace(lock_shared_segment(cache,
+                                               cache->allow_blocking_writes,
+                                               success));
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -888,6 +1177,12 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+  if (cache->shared)
+    {
+      svn_boolean_t success = TRUE;
+      return svn_error_trace(lock_shared_segment(cache, TRUE, &success));
+    }
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -908,6 +1203,9 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+  if (cache->shared)
+    return svn_cache__shared_lock_release(&cache->shared_lock, err);
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -927,6 +1225,25 @@ unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 #endif
 }
 
+/* Signal lock-free readers of CACHE that we are about to modify it.
+ * The caller must hold the write lock.
+ */
+static APR_INLINE void
+begin_update(svn_membuffer_t *cache)
+{
+  svn_atomic_inc(&cache->update_count);
+}
+
+/* Signal lock-free readers of CACHE that the modification started by
+ * begin_update has been completed.  Return ERR.
+ */
+static APR_INLINE svn_error_t *
+end_update(svn_membuffer_t *cache, svn_error_t *err)
+{
+  svn_atomic_inc(&cache->update_count);
+  return err;
+}
+
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
  * The macro has been modeled after SVN_MUTEX__WITH_LOCK.
  */
@@ -959,7 +1276,8 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  begin_update(cache);                                          \
+  SVN_ERR(unlock_cache(cache, end_update(cache, (expr))));      \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1832,17 +2150,24 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+/* Implement svn_cache__membuffer_cache_create and
+ * svn_cache__membuffer_cache_create_shared.  If SHARED is set, allocate
+ * all data structures that must be visible to child processes from a new
+ * anonymous shared memory block.
+ */
+static svn_error_t *
+membuffer_cache_create(svn_membuffer_t **cache,
+                       apr_size_t total_size,
+                       apr_size_t directory_size,
+                       apr_size_t segment_count,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t allow_blocking_writes,
+                       svn_boolean_t shared,
+                       apr_pool_t *pool)
 {
   svn_membuffer_t *c;
   prefix_pool_t *prefix_pool;
+  cache_memory_t memory = { 0 };
 
   apr_uint32_t seg;
   apr_uint32_t group_count;
@@ -1851,12 +2176,13 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   apr_uint32_t group_init_size;
   apr_uint64_t data_size;
   apr_uint64_t max_entry_size;
+  apr_size_t prefix_pool_size;
 
   /* Allocate 1% of the cache capacity to the prefix string pool.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
-  total_size -= total_size / 100;
+  prefix_pool_size = total_size / 100;
+  total_size -= prefix_pool_size;
+  memory.pool = pool;
 
   /* Limit the total size (only relevant if we can address > 4GB)
    */
@@ -1910,9 +2236,6 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
          && segment_count < MAX_SEGMENT_COUNT)
     segment_count *= 2;
 
-  /* allocate cache as an array of segments / cache objects */
-  c = apr_palloc(pool, segment_count * sizeof(*c));
-
   /* Split total cache size into segments of equal size
    */
   total_size /= segment_count;
@@ -1963,6 +2286,50 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
+
+  /* Shared caches must be allocated en bloc. */
+  if (shared)
+    {
+#if APR_HAS_SHARED_MEMORY && SVN_CACHE__HAS_SHARED_LOCK
+      apr_shm_t *shm;
+      apr_status_t status;
+
+      memory.size = prefix_pool_shared_size(prefix_pool_size)
+                  + ALIGN_VALUE(segment_count * sizeof(*c))
+                  + segment_count
+                    * (  ALIGN_VALUE(group_count * sizeof(entry_group_t))
+                       + ALIGN_VALUE(group_init_size)
+                       + ALIGN_VALUE(data_size));
+
+      status = apr_shm_create(&shm, memory.size, NULL, pool);
+      if (APR_STATUS_IS_ENOTIMPL(status))
+        return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE,
+                                svn_error_wrap_apr(status, NULL),
+                                _("Anonymous shared memory is not "
+                                  "supported"));
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create shared memory for cache"));
+
+      memory.base = apr_shm_baseaddr_get(shm);
+#elif APR_HAS_SHARED_MEMORY
+      return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                              _("Robust process-shared mutexes are not "
+                                "supported"));
+#else
+      return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                              _("Shared memory is not supported"));
+#endif
+    }
+
+  SVN_ERR(prefix_pool_create(&prefix_pool, prefix_pool_size,
+                             thread_safe || shared, &memory));
+
+  /* allocate cache as an array of segments / cache objects */
+  c = cache_memory_alloc(&memory, segment_count * sizeof(*c), FALSE);
+  if (c == NULL)
+    return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
   for (seg = 0; seg < segment_count; ++seg)
     {
       /* allocate buffers and initialize cache members
@@ -1978,12 +2345,15 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       /* Allocate but don't clear / zero the directory because it would add
          significantly to the server start-up time if the caches are large.
          Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
+      c[seg].directory = cache_memory_alloc(&memory,
+                                            group_count
+                                              * sizeof(entry_group_t),
+                                            FALSE);
 
       /* Allocate and initialize directory entries as "not initialized",
          hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+      c[seg].group_initialized = cache_memory_alloc(&memory,
+                                                    group_init_size, TRUE);
 
       /* Allocate 1/4th of the data buffer to L1
        */
@@ -2004,7 +2374,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].l2.current_data = c[seg].l2.start_offset;
 
       /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
+      c[seg].data = cache_memory_alloc(&memory,
+                                       (apr_size_t)ALIGN_VALUE(data_size),
+                                       FALSE);
       c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
 
@@ -2016,7 +2388,9 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       /* were allocations successful?
        * If not, initialize a minimal cache structure.
        */
-      if (c[seg].data == NULL || c[seg].directory == NULL)
+      if (   c[seg].data == NULL
+          || c[seg].directory == NULL
+          || c[seg].group_initialized == NULL)
         {
           /* We are OOM. There is no need to proceed with "half a cache".
            */
@@ -2026,26 +2400,31 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
       /* A lock for intra-process synchronization to the cache, or NULL if
        * the cache's creator doesn't feel the cache needs to be
-       * thread-safe.
+       * thread-safe.  Shared caches use SHARED_LOCK instead.
        */
-      SVN_ERR(svn_mutex__init(&c[seg].lock, thread_safe, pool));
+      SVN_ERR(svn_mutex__init(&c[seg].lock, thread_safe && !shared, pool));
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
       /* Same for read-write lock. */
       c[seg].lock = NULL;
-      if (thread_safe)
+      if (thread_safe && !shared)
         {
           apr_status_t status =
               apr_thread_rwlock_create(&(c[seg].lock), pool);
           if (status)
             return svn_error_wrap_apr(status, _("Can't create cache mutex"));
         }
+#endif
 
       /* Select the behavior of write operations.
        */
       c[seg].allow_blocking_writes = allow_blocking_writes;
-#endif
+
+      c[seg].shared = shared;
+      if (shared)
+        SVN_ERR(svn_cache__shared_lock_init(&c[seg].shared_lock));
       /* No writers at the moment. */
       c[seg].write_lock_count = 0;
+      c[seg].update_count = 0;
     }
 
   /* done here
@@ -2054,18 +2433,45 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count,
+                                                thread_safe,
+                                                allow_blocking_writes,
+                                                FALSE, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count,
+                                                TRUE,
+                                                allow_blocking_writes,
+                                                TRUE, pool));
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
   apr_size_t seg;
   apr_size_t segment_count = cache->segment_count;
 
-  /* Length of the group_initialized array in bytes.
-     See also svn_cache__membuffer_cache_create(). */
-  apr_size_t group_init_size
-    = 1 + (cache->group_count + cache->spare_group_count)
-            / (8 * GROUP_INIT_GRANULARITY);
-
   /* Clear segment by segment.  This implies that other thread may read
      and write to other segments after we cleared them and before the
      last segment is done.
@@ -2078,31 +2484,12 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
     {
       /* Unconditionally acquire the write lock. */
       SVN_ERR(force_write_lock_cache(&cache[seg]));
-
-      /* Mark all groups as "not initialized", which implies "empty". */
-      cache[seg].first_spare_group = NO_INDEX;
-      cache[seg].max_spare_used = 0;
-
-      memset(cache[seg].group_initialized, 0, group_init_size);
-
-      /* Unlink L1 contents. */
-      cache[seg].l1.first = NO_INDEX;
-      cache[seg].l1.last = NO_INDEX;
-      cache[seg].l1.next = NO_INDEX;
-      cache[seg].l1.current_data = cache[seg].l1.start_offset;
-
-      /* Unlink L2 contents. */
-      cache[seg].l2.first = NO_INDEX;
-      cache[seg].l2.last = NO_INDEX;
-      cache[seg].l2.next = NO_INDEX;
-      cache[seg].l2.current_data = cache[seg].l2.start_offset;
-
-      /* Reset content counters. */
-      cache[seg].data_used = 0;
-      cache[seg].used_entries = 0;
+      begin_update(&cache[seg]);
+      clear_segment(&cache[seg]);
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(unlock_cache(&cache[seg], end_update(&cache[seg],
+                                                   SVN_NO_ERROR)));
     }
 
   /* done here */
@@ -2370,6 +2757,205 @@ increment_hit_counters(svn_membuffer_t *cache, entry_t *entry)
   cache->total_hits++;
 }
 
+#if USE_OPTIMISTIC_READS
+
+/* Return the current UPDATE_COUNT of CACHE, if no writer is currently
+ * modifying it.  Return an odd number otherwise.  In the latter case,
+ * any data read from CACHE before calling validate_optimistic_read must
+ * be discarded.
+ */
+static APR_INLINE apr_uint32_t
+begin_optimistic_read(svn_membuffer_t *cache)
+{
+  apr_uint32_t update_count = svn_atomic_read(&cache->update_count);
+  MEMORY_BARRIER();
+
+  return update_count;
+}
+
+/* Return TRUE, if no writer modified CACHE since begin_optimistic_read
+ * returned UPDATE_COUNT.  Only then may the data read from CACHE in the
+ * meantime be used.
+ */
+static APR_INLINE svn_boolean_t
+validate_optimistic_read(svn_membuffer_t *cache,
+                         apr_uint32_t update_count)
+{
+  MEMORY_BARRIER();
+  return (update_count & 1) == 0
+      && svn_atomic_read(&cache->update_count) == update_count;
+}
+
+/* Lock-free variant of find_entry for FIND_EMPTY==FALSE.
+ *
+ * Writers may modify CACHE while we are reading it.  Therefore, never
+ * follow references nor access data that are not within CACHE's
+ * bounds and never read an entry's location twice.  Return the location
+ * of the data found in *OFFSET, *SIZE and *KEY_LEN.  The result is only
+ * valid if validate_optimistic_read succeeds.
+ */
+static entry_t *
+find_entry_optimistic(svn_membuffer_t *cache,
+                      apr_uint32_t group_index,
+                      const full_key_t *to_find,
+                      apr_uint64_t *offset,
+                      apr_size_t *size,
+                      apr_size_t *key_len)
+{
+  apr_uint64_t data_size = cache->l2.start_offset + cache->l2.size;
+  apr_uint32_t group_limit = cache->group_count + cache->spare_group_count;
+  entry_group_t *group = &cache->directory[group_index];
+  int chain_length;
+
+  if (! is_group_initialized(cache, group_index))
+    return NULL;
+
+  for (chain_length = 0;
+       chain_length < MAX_GROUP_CHAIN_LENGTH;
+       ++chain_length)
+    {
+      apr_uint32_t used = group->header.used;
+      apr_uint32_t next = group->header.next;
+      apr_size_t i;
+
+      for (i = 0; i < used && i < GROUP_SIZE; ++i)
+        if (entry_keys_match(&group->entries[i].key, &to_find->entry_key))
+          {
+            entry_t *entry = &group->entries[i];
+
+            *offset = entry->offset;
+            *size = entry->size;
+            *key_len = entry->key.key_len;
+
+            /* Torn reads may produce arbitrary values. */
+            if (   *offset > data_size
+                || *size > data_size - *offset
+                || *key_len > *size)
+              return NULL;
+
+            /* Same logic as in find_entry. */
+            if (*key_len == 0)
+              return entry;
+
+            return memcmp(to_find->full_key.data, cache->data + *offset,
+                          *key_len) == 0
+                 ? entry
+                 : NULL;
+          }
+
+      if (next == NO_INDEX || next >= group_limit)
+        break;
+
+      group = &cache->directory[next];
+    }
+
+  return NULL;
+}
+
+/* Try to read the cache entry in group GROUP_INDEX of CACHE, identified
+ * by the hash value TO_FIND, without acquiring CACHE's lock.  Return TRUE
+ * and set *BUFFER and *ITEM_SIZE as membuffer_cache_get_internal would,
+ * if that succeeded.  Return FALSE if the caller must retry with the
+ * read lock being held.  Allocations will be done in RESULT_POOL.
+ */
+static svn_boolean_t
+membuffer_cache_get_optimistic(svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               apr_pool_t *result_pool)
+{
+  apr_uint32_t update_count;
+  entry_t *entry;
+  apr_uint64_t offset = 0;
+  apr_size_t size = 0;
+  apr_size_t key_len = 0;
+  char *data = NULL;
+
+  /* Single-threaded caches have no lock to avoid. */
+  if (cache->lock == NULL && !cache->shared)
+    return FALSE;
+
+  update_count = begin_optimistic_read(cache);
+  if (update_count & 1)
+    return FALSE;
+
+  entry = find_entry_optimistic(cache, group_index, to_find,
+                                &offset, &size, &key_len);
+  if (entry)
+    {
+      /* The aligned size may reach beyond the buffer for torn reads. */
+      apr_size_t to_copy = ALIGN_VALUE(size) - key_len;
+      if (offset + key_len + to_copy
+            > cache->l2.start_offset + cache->l2.size)
+        return FALSE;
+
+      data = apr_palloc(result_pool, to_copy);
+      memcpy(data, cache->data + offset + key_len, to_copy);
+    }
+
+  if (!validate_optimistic_read(cache, update_count))
+    return FALSE;
+
+  cache->total_reads++;
+  if (entry)
+    {
+      /* ENTRY may be reused by now, in which case we give the new content
+       * a small head start.  That is harmless for the LFU heuristics. */
+      increment_hit_counters(cache, entry);
+      *buffer = data;
+      *item_size = size - key_len;
+    }
+  else
+    {
+      *buffer = NULL;
+      *item_size = 0;
+    }
+
+  return TRUE;
+}
+
+/* Try to look for the cache entry in group GROUP_INDEX of CACHE,
+ * identified by the hash value TO_FIND, without acquiring CACHE's lock.
+ * Return TRUE and set *FOUND as membuffer_cache_has_key_internal would,
+ * if that succeeded.  Return FALSE if the caller must retry with the
+ * read lock being held.
+ */
+static svn_boolean_t
+membuffer_cache_has_key_optimistic(svn_membuffer_t *cache,
+                                   apr_uint32_t group_index,
+                                   const full_key_t *to_find,
+                                   svn_boolean_t *found)
+{
+  apr_uint32_t update_count;
+  entry_t *entry;
+  apr_uint64_t offset;
+  apr_size_t size;
+  apr_size_t key_len;
+
+  if (cache->lock == NULL && !cache->shared)
+    return FALSE;
+
+  update_count = begin_optimistic_read(cache);
+  if (update_count & 1)
+    return FALSE;
+
+  entry = find_entry_optimistic(cache, group_index, to_find,
+                                &offset, &size, &key_len);
+  if (!validate_optimistic_read(cache, update_count))
+    return FALSE;
+
+  /* See membuffer_cache_has_key_internal. */
+  if (entry)
+    increment_hit_counters(cache, entry);
+
+  *found = entry != NULL;
+  return TRUE;
+}
+
+#endif /* USE_OPTIMISTIC_READS */
+
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
  * by the hash value TO_FIND. If no item has been stored for KEY,
  * *BUFFER will be NULL. Otherwise, return a copy of the serialized
@@ -2453,6 +3039,11 @@ membuffer_cache_get(svn_membuffer_t *cache,
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
+
+#if USE_OPTIMISTIC_READS
+  if (!membuffer_cache_get_optimistic(cache, group_index, key,
+                                      &buffer, &size, result_pool))
+#endif
   WITH_READ_LOCK(cache,
                  membuffer_cache_get_internal(cache,
                                               group_index,
@@ -2517,6 +3108,11 @@ membuffer_cache_has_key(svn_membuffer_t *cache,
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
   cache->total_reads++;
 
+#if USE_OPTIMISTIC_READS
+  if (membuffer_cache_has_key_optimistic(cache, group_index, key, found))
+    return SVN_NO_ERROR;
+#endif
+
   WITH_READ_LOCK(cache,
                  membuffer_cache_has_key_internal(cache,
                                                   group_index,
@@ -3478,3 +4074,23 @@ svn_cache__membuffer_get_global_info(apr_pool_t *pool)
 
   return info;
 }
+
+void
+svn_cache__membuffer_get_global_access_counts(apr_uint64_t *gets,
+                                              apr_uint64_t *hits)
+{
+  apr_uint32_t i;
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+
+  *gets = 0;
+  *hits = 0;
+  if (membuffer == NULL)
+    return;
+
+  /* These are statistics only.  Don't bother locking the segments. */
+  for (i = 0; i < membuffer->segment_count; ++i)
+    {
+      *gets += membuffer[i].total_reads;
+      *hits += membuffer[i].total_hits;
+    }
+}
@@ -0,0 +1,1233 @@
+/*
+ * cache-persistent.c: a second-level cache backed by a memory-mapped file
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_mmap.h>
+
+#include "svn_pools.h"
+#include "svn_io.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_sorts.h"  /* get the MIN and MAX macros */
+
+#include "svn_private_config.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_subr_private.h"
+
+#include "cache.h"
+
+/* A note on the file format:
+ *
+ * The cache file begins with a header page that describes its geometry
+ * and contains the state of all segments.  The segments follow; each of
+ * them consists of an index of GROUP_SIZE-way associative bucket groups
+ * and a data area.  Keys get distributed over the segments by their hash
+ * value.
+ *
+ * The data area of a segment is used as a ring buffer, i.e. new records
+ * always get appended at the current write position and will eventually
+ * overwrite the oldest records.  Records never wrap around the end of the
+ * data area.
+ *
+ * All positions are absolute, i.e. they count the bytes ever written to
+ * the data area.  A record is valid if it has been written completely and
+ * has not been overwritten since; that is, if it lies within the last
+ * DATA_SIZE bytes before WRITE_POS.  Hence, there is no need to update the
+ * index when records get overwritten.
+ *
+ * Each record contains the full key and a checksum of its data.  Since the
+ * file is written through shared memory mappings, the OS may flush pages
+ * in any order and a system crash may leave partially written records
+ * behind.  The checksum lets us detect those.
+ *
+ * A note on the geometry:
+ *
+ * The geometry gets written to the header when the file is initialized.
+ * Every process that maps the file holds a shared file lock on it for as
+ * long as it is open.  Only a process that can get an exclusive lock, i.e.
+ * that finds nobody else using the file, may resize and initialize it.
+ * All others attach to the file with the geometry found in its header,
+ * regardless of the size they have been asked for, and refuse to use it
+ * if they don't understand that header.
+ *
+ * A note on synchronization:
+ *
+ * Each segment has a robust, process-shared mutex in the header page.
+ * Writers don't wait for it but simply drop the data if another thread
+ * is currently modifying the same segment.  Lookups don't take the mutex
+ * at all but validate what they read against the segment's UPDATE_COUNT
+ * in the same way the membuffer cache does.  Only if a writer interfered,
+ * they fall back to the mutex.
+ */
+
+/* Identifies a cache file in the first 8 bytes of its header. */
+#define PERSISTENT_CACHE_MAGIC "SVNPCACH"
+
+/* Current version of the file format. */
+#define PERSISTENT_CACHE_FORMAT 2
+
+/* Bytes reserved for the header page.  The first segment begins right
+ * after it. */
+#define HEADER_SIZE 4096
+
+/* Number of buckets per group, i.e. the index associativity. */
+#define GROUP_SIZE 4
+
+/* Expected average record size.  Used to size the index. */
+#define AVERAGE_RECORD_SIZE 2048
+
+/* All records in the data area are aligned to this. */
+#define ITEM_ALIGNMENT 8
+
+/* Cache files will have at least this size. */
+#define MIN_CACHE_SIZE 0x100000
+
+/* Cache files get one segment per this many bytes ... */
+#define MIN_SEGMENT_SIZE 0x400000
+
+/* ... but never more than this many segments. */
+#define MAX_SEGMENT_COUNT 32
+
+/* No single record may occupy more than this fraction of the data area. */
+#define MAX_ITEM_FRACTION 16
+
+/* Lookups can only go without locks if we have memory barriers. */
+#if SVN_CACHE__HAS_MEMORY_BARRIER
+#  define USE_OPTIMISTIC_READS 1
+#else
+#  define USE_OPTIMISTIC_READS 0
+#endif
+
+/* Round VALUE up to the next multiple of ITEM_ALIGNMENT. */
+#define ALIGN_VALUE(value) (((value) + ITEM_ALIGNMENT - 1) \
+                            & ~((apr_uint64_t)ITEM_ALIGNMENT - 1))
+
+/* The cache file header.  Describes the geometry of the file.  The
+ * SEGMENT_COUNT segment_t follow immediately. */
+typedef struct header_t
+{
+  /* PERSISTENT_CACHE_MAGIC (not NUL-terminated) */
+  char magic[8];
+
+  /* PERSISTENT_CACHE_FORMAT */
+  apr_uint32_t format;
+
+  /* sizeof(segment_t) in the process that initialized the file.  Processes
+   * built with a different mutex implementation can't share the file. */
+  apr_uint32_t segment_info_size;
+
+  /* Number of segments in the file. */
+  apr_uint32_t segment_count;
+
+  /* Number of bucket groups in the index of each segment. */
+  apr_uint32_t group_count;
+
+  /* Size of the data area of each segment in bytes. */
+  apr_uint64_t data_size;
+
+  /* Number of bytes of the file in use, i.e. the size of the mapping. */
+  apr_uint64_t total_size;
+} header_t;
+
+/* The state of a segment.  Kept in the header page. */
+typedef struct segment_t
+{
+  /* Serializes all modifications of this segment. */
+  svn_cache__shared_lock_t lock;
+
+  /* Incremented before and after every modification of this segment.
+   * Odd values indicate that a writer is active.  Lock-free readers use
+   * this to detect concurrent updates. */
+  svn_atomic_t update_count;
+
+  /* Keep WRITE_POS aligned. */
+  apr_uint32_t padding;
+
+  /* Absolute position at which the next record will be written. */
+  apr_uint64_t write_pos;
+} segment_t;
+
+/* An entry in the index. */
+typedef struct bucket_t
+{
+  /* Hash value of the full key.  0 for unused buckets. */
+  apr_uint64_t hash;
+
+  /* Absolute position of the respective record. */
+  apr_uint64_t position;
+} bucket_t;
+
+/* A record in the data area.  It will be followed by KEY_LEN bytes of key
+ * and DATA_LEN bytes of data. */
+typedef struct record_t
+{
+  /* Hash value of the full key. */
+  apr_uint64_t hash;
+
+  /* Length of the key following this struct. */
+  apr_uint32_t key_len;
+
+  /* Length of the serialized data following the key. */
+  apr_uint32_t data_len;
+
+  /* FNV-1a checksum over the serialized data. */
+  apr_uint32_t checksum;
+
+  /* Keep the struct size a multiple of ITEM_ALIGNMENT. */
+  apr_uint32_t padding;
+} record_t;
+
+/* The process-local representation of a cache file. */
+struct svn_cache__persistent_t
+{
+  /* Absolute path of the cache file. */
+  const char *path;
+
+  /* PATH in local style, for error messages. */
+  const char *local_path;
+
+  /* The open cache file.  We hold a shared lock on it for as long as it
+   * is open. */
+  apr_file_t *file;
+
+  /* The file contents, mapped as a whole. */
+  apr_mmap_t *mmap;
+
+  /* Pointers into MMAP. */
+  header_t *header;
+  segment_t *segments;
+  char *first_segment;
+
+  /* Copies of the geometry in HEADER. */
+  apr_uint32_t segment_count;
+  apr_uint32_t group_count;
+  apr_uint64_t data_size;
+
+  /* Distance between two segments in the file. */
+  apr_uint64_t segment_size;
+
+  /* Maximum size of a record in the data area. */
+  apr_uint64_t max_record_size;
+};
+
+/* The (internal) cache object. */
+typedef struct persistent_cache_t
+{
+  /* The in-memory cache that we put in front of STORE. */
+  svn_cache__t *l1_cache;
+
+  /* The cache file. */
+  svn_cache__persistent_t *store;
+
+  /* Prefix to all keys in STORE.  Includes the terminating NUL which
+   * separates it from the actual key. */
+  const char *prefix;
+  apr_size_t prefix_len;
+
+  /* The size of the key: either a fixed number of bytes or
+   * APR_HASH_KEY_STRING. */
+  apr_ssize_t klen;
+
+  /* Used to marshal values in and out of the cache. */
+  svn_cache__serialize_func_t serialize_func;
+  svn_cache__deserialize_func_t deserialize_func;
+} persistent_cache_t;
+
+
+/*** The cache file. ***/
+
+/* Return the 64 bit hash value for the LEN bytes of KEY.  Never returns
+ * 0 because that value marks unused buckets. */
+static apr_uint64_t
+hash_key(const char *key,
+         apr_size_t len)
+{
+  apr_uint64_t hash = ((apr_uint64_t)svn__fnv1a_32x4(key, len) << 32)
+                    | svn__fnv1a_32(key, len);
+
+  return hash ? hash : 1;
+}
+
+/* Return the segment of STORE that holds the records for HASH.  The lower
+ * 32 bits select the group within the segment. */
+static segment_t *
+get_segment(svn_cache__persistent_t *store,
+            apr_uint64_t hash)
+{
+  return store->segments + (hash >> 32) % store->segment_count;
+}
+
+/* Return the index of SEGMENT in STORE. */
+static bucket_t *
+get_buckets(svn_cache__persistent_t *store,
+            segment_t *segment)
+{
+  return (bucket_t *)(store->first_segment
+                      + (segment - store->segments) * store->segment_size);
+}
+
+/* Return the data area of SEGMENT in STORE. */
+static char *
+get_data(svn_cache__persistent_t *store,
+         segment_t *segment)
+{
+  return (char *)(get_buckets(store, segment)
+                  + store->group_count * GROUP_SIZE);
+}
+
+/* Return the record at absolute POSITION in SEGMENT of STORE, if it is
+ * still valid with the segment's write position being WRITE_POS.  Return
+ * NULL otherwise.  Lock-free readers may see any data, so the lengths
+ * are only read once and returned in *KEY_LEN and *DATA_LEN.
+ */
+static record_t *
+get_record(apr_uint32_t *key_len,
+           apr_uint32_t *data_len,
+           svn_cache__persistent_t *store,
+           segment_t *segment,
+           apr_uint64_t position,
+           apr_uint64_t write_pos)
+{
+  apr_uint64_t offset = position % store->data_size;
+  apr_uint64_t size;
+  record_t *record;
+
+  /* Not yet written or already overwritten? */
+  if (   position + sizeof(*record) > write_pos
+      || write_pos - position > store->data_size
+      || offset + sizeof(*record) > store->data_size)
+    return NULL;
+
+  record = (record_t *)(get_data(store, segment) + offset);
+  *key_len = record->key_len;
+  *data_len = record->data_len;
+  size = ALIGN_VALUE(sizeof(*record) + (apr_uint64_t)*key_len + *data_len);
+
+  /* Verify that the record lies completely within the valid range.
+   * Corrupted length info might point to anywhere. */
+  if (   size > store->max_record_size
+      || position + size > write_pos
+      || offset + size > store->data_size)
+    return NULL;
+
+  return record;
+}
+
+/* Return the bucket group for HASH in SEGMENT of STORE. */
+static bucket_t *
+get_group(svn_cache__persistent_t *store,
+          segment_t *segment,
+          apr_uint64_t hash)
+{
+  return get_buckets(store, segment)
+       + (hash % store->group_count) * GROUP_SIZE;
+}
+
+/* Return the record for the KEY_LEN bytes of KEY with the given HASH in
+ * SEGMENT of STORE, the bucket referencing it in *BUCKET_P and the length
+ * of its data in *DATA_LEN.  Return NULL if no such record exists.
+ *
+ * Without the lock to SEGMENT, the result is only meaningful if no writer
+ * interfered.  Even then, we won't access memory outside SEGMENT.
+ */
+static record_t *
+find_record(bucket_t **bucket_p,
+            apr_uint32_t *data_len,
+            svn_cache__persistent_t *store,
+            segment_t *segment,
+            apr_uint64_t hash,
+            const char *key,
+            apr_size_t key_len)
+{
+  bucket_t *group = get_group(store, segment, hash);
+  apr_uint64_t write_pos = segment->write_pos;
+  int i;
+
+  for (i = 0; i < GROUP_SIZE; ++i)
+    if (group[i].hash == hash)
+      {
+        apr_uint32_t record_key_len;
+        record_t *record = get_record(&record_key_len, data_len, store,
+                                      segment, group[i].position,
+                                      write_pos);
+        if (   record
+            && record->hash == hash
+            && record_key_len == key_len
+            && memcmp(record + 1, key, key_len) == 0)
+          {
+            *bucket_p = &group[i];
+            return record;
+          }
+      }
+
+  return NULL;
+}
+
+/* Return the bucket in SEGMENT of STORE that shall reference the new
+ * record for KEY with KEY_LEN and HASH.  That is either the bucket already
+ * referencing KEY, an unused one or the one referencing the oldest record
+ * in the respective group.  The caller must hold the lock to SEGMENT.
+ */
+static bucket_t *
+select_bucket(svn_cache__persistent_t *store,
+              segment_t *segment,
+              apr_uint64_t hash,
+              const char *key,
+              apr_size_t key_len)
+{
+  bucket_t *group = get_group(store, segment, hash);
+  bucket_t *result = group;
+  apr_uint32_t unused_key_len, unused_data_len;
+  int i;
+
+  if (find_record(&result, &unused_data_len, store, segment, hash, key,
+                  key_len))
+    return result;
+
+  for (i = 0; i < GROUP_SIZE; ++i)
+    {
+      if (   group[i].hash == 0
+          || !get_record(&unused_key_len, &unused_data_len, store, segment,
+                         group[i].position, segment->write_pos))
+        return &group[i];
+
+      if (group[i].position < result->position)
+        result = &group[i];
+    }
+
+  return result;
+}
+
+/* Signal lock-free readers of SEGMENT that we are about to modify it.
+ * The caller must hold the lock to SEGMENT.
+ */
+static APR_INLINE void
+begin_update(segment_t *segment)
+{
+  svn_atomic_inc(&segment->update_count);
+}
+
+/* Signal lock-free readers of SEGMENT that the modification started by
+ * begin_update has been completed.
+ */
+static APR_INLINE void
+end_update(segment_t *segment)
+{
+  svn_atomic_inc(&segment->update_count);
+}
+
+/* Acquire the lock to SEGMENT of STORE.  If BLOCKING is not set and
+ * somebody else holds the lock, set *LOCKED to FALSE and return
+ * immediately.  Otherwise, set it to TRUE.
+ */
+static svn_error_t *
+lock_segment(svn_boolean_t *locked,
+             svn_cache__persistent_t *store,
+             segment_t *segment,
+             svn_boolean_t blocking)
+{
+  svn_boolean_t recovered;
+
+  SVN_ERR(svn_cache__shared_lock_acquire(&segment->lock, blocking, locked,
+                                         &recovered));
+
+  /* The previous owner died and may have left the segment in any state.
+   * Start over with an empty segment.  Unless the owner died within a
+   * begin_update / end_update bracket, open one such that lock-free
+   * readers will ignore whatever they read in the meantime. */
+  if (*locked && recovered)
+    {
+      if ((svn_atomic_read(&segment->update_count) & 1) == 0)
+        begin_update(segment);
+
+      memset(get_buckets(store, segment), 0,
+             store->group_count * GROUP_SIZE * sizeof(bucket_t));
+      segment->write_pos = 0;
+      end_update(segment);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Release the lock to SEGMENT and combine any error with ERR.
+ */
+static svn_error_t *
+unlock_segment(segment_t *segment,
+               svn_error_t *err)
+{
+  return svn_error_trace(svn_cache__shared_lock_release(&segment->lock,
+                                                        err));
+}
+
+/* Copy the data stored for the KEY_LEN bytes of KEY with HASH in SEGMENT
+ * of STORE into *DATA, allocated in RESULT_POOL, and return its size in
+ * *SIZE.  Set *FOUND accordingly.
+ */
+static void
+read_record(char **data,
+            apr_size_t *size,
+            svn_boolean_t *found,
+            svn_cache__persistent_t *store,
+            segment_t *segment,
+            apr_uint64_t hash,
+            const char *key,
+            apr_size_t key_len,
+            apr_pool_t *result_pool)
+{
+  apr_uint32_t data_len;
+  bucket_t *bucket;
+  record_t *record;
+
+  record = find_record(&bucket, &data_len, store, segment, hash, key,
+                       key_len);
+  if (record)
+    {
+      apr_uint32_t checksum = record->checksum;
+
+      /* Add a terminating NUL for the benefit of the svn_stringbuf_t
+       * values. */
+      *size = data_len;
+      *data = apr_palloc(result_pool, *size + 1);
+      memcpy(*data, (const char *)(record + 1) + key_len, *size);
+      (*data)[*size] = '\0';
+
+      *found = svn__fnv1a_32(*data, *size) == checksum;
+    }
+  else
+    {
+      *found = FALSE;
+    }
+}
+
+/* Core functionality of our getter functions: copy the data stored for
+ * the KEY_LEN bytes of KEY in STORE into *DATA, allocated in RESULT_POOL,
+ * and return its size in *SIZE.  Set *FOUND accordingly.
+ */
+static svn_error_t *
+store_get(char **data,
+          apr_size_t *size,
+          svn_boolean_t *found,
+          svn_cache__persistent_t *store,
+          const char *key,
+          apr_size_t key_len,
+          apr_pool_t *result_pool)
+{
+  apr_uint64_t hash = hash_key(key, key_len);
+  segment_t *segment = get_segment(store, hash);
+  svn_boolean_t locked;
+
+#if USE_OPTIMISTIC_READS
+  apr_uint32_t update_count = svn_atomic_read(&segment->update_count);
+  SVN_CACHE__MEMORY_BARRIER();
+
+  if ((update_count & 1) == 0)
+    {
+      read_record(data, size, found, store, segment, hash, key, key_len,
+                  result_pool);
+
+      SVN_CACHE__MEMORY_BARRIER();
+      if (svn_atomic_read(&segment->update_count) == update_count)
+        return SVN_NO_ERROR;
+    }
+#endif
+
+  SVN_ERR(lock_segment(&locked, store, segment, TRUE));
+  read_record(data, size, found, store, segment, hash, key, key_len,
+              result_pool);
+
+  return svn_error_trace(unlock_segment(segment, SVN_NO_ERROR));
+}
+
+/* Store the SIZE bytes of DATA for the KEY_LEN bytes of KEY in STORE.
+ * Items that are too large will be ignored.  Silently drop the data if
+ * some other thread currently modifies the respective segment.
+ */
+static svn_error_t *
+store_set(svn_cache__persistent_t *store,
+          const char *key,
+          apr_size_t key_len,
+          const char *data,
+          apr_size_t size)
+{
+  apr_uint64_t hash = hash_key(key, key_len);
+  apr_uint64_t record_size = ALIGN_VALUE(sizeof(record_t) + key_len + size);
+  segment_t *segment = get_segment(store, hash);
+  apr_uint64_t position;
+  apr_uint64_t offset;
+  svn_boolean_t locked;
+  bucket_t *bucket;
+  record_t *record;
+
+  if (record_size > store->max_record_size)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(lock_segment(&locked, store, segment, FALSE));
+  if (!locked)
+    return SVN_NO_ERROR;
+
+  begin_update(segment);
+
+  /* Records must not wrap around the end of the data area. */
+  position = segment->write_pos;
+  offset = position % store->data_size;
+  if (offset + record_size > store->data_size)
+    {
+      position += store->data_size - offset;
+      offset = 0;
+    }
+
+  /* Write the record before publishing it in the segment and index. */
+  record = (record_t *)(get_data(store, segment) + offset);
+  record->hash = hash;
+  record->key_len = (apr_uint32_t)key_len;
+  record->data_len = (apr_uint32_t)size;
+  record->checksum = svn__fnv1a_32(data, size);
+  record->padding = 0;
+  memcpy(record + 1, key, key_len);
+  memcpy((char *)(record + 1) + key_len, data, size);
+
+  bucket = select_bucket(store, segment, hash, key, key_len);
+  segment->write_pos = position + record_size;
+  bucket->hash = hash;
+  bucket->position = position;
+
+  end_update(segment);
+
+  return svn_error_trace(unlock_segment(segment, SVN_NO_ERROR));
+}
+
+/* Remove any data stored for the KEY_LEN bytes of KEY from STORE.
+ */
+static svn_error_t *
+store_remove(svn_cache__persistent_t *store,
+             const char *key,
+             apr_size_t key_len)
+{
+  apr_uint64_t hash = hash_key(key, key_len);
+  segment_t *segment = get_segment(store, hash);
+  apr_uint32_t data_len;
+  svn_boolean_t locked;
+  bucket_t *bucket;
+
+  /* Unlike store_set(), we must not skip this step. */
+  SVN_ERR(lock_segment(&locked, store, segment, TRUE));
+
+  begin_update(segment);
+  if (find_record(&bucket, &data_len, store, segment, hash, key, key_len))
+    bucket->hash = 0;
+  end_update(segment);
+
+  return svn_error_trace(unlock_segment(segment, SVN_NO_ERROR));
+}
+
+/* Return the number of segments that fit into the header page. */
+static apr_uint32_t
+get_max_segment_count(void)
+{
+  return (apr_uint32_t)MIN(MAX_SEGMENT_COUNT,
+                           (HEADER_SIZE - sizeof(header_t))
+                             / sizeof(segment_t));
+}
+
+/* Return the distance between two segments in a file with the geometry
+ * given by HEADER. */
+static apr_uint64_t
+get_segment_size(const header_t *header)
+{
+  return (apr_uint64_t)header->group_count * GROUP_SIZE * sizeof(bucket_t)
+       + header->data_size;
+}
+
+/* Fill in the geometry of a cache file of at most TOTAL_SIZE bytes in
+ * HEADER.
+ */
+static void
+get_geometry(header_t *header,
+             apr_uint64_t total_size)
+{
+  apr_uint64_t segments = total_size / MIN_SEGMENT_SIZE;
+  apr_uint64_t segment_size;
+  apr_uint64_t groups;
+
+  segments = MAX(1, MIN(segments, get_max_segment_count()));
+  segment_size = (total_size - HEADER_SIZE) / segments;
+
+  groups = segment_size / (AVERAGE_RECORD_SIZE * GROUP_SIZE);
+  groups = MAX(1, MIN(groups, APR_UINT32_MAX / GROUP_SIZE));
+
+  header->segment_count = (apr_uint32_t)segments;
+  header->group_count = (apr_uint32_t)groups;
+  header->data_size = (segment_size - groups * GROUP_SIZE * sizeof(bucket_t))
+                    & ~((apr_uint64_t)ITEM_ALIGNMENT - 1);
+  header->total_size = HEADER_SIZE + segments * get_segment_size(header);
+}
+
+/* Return TRUE if HEADER, read from a cache file of FILE_SIZE bytes,
+ * describes a file that we can use.
+ */
+static svn_boolean_t
+is_valid_header(const header_t *header,
+                apr_uint64_t file_size)
+{
+  return memcmp(header->magic, PERSISTENT_CACHE_MAGIC,
+                sizeof(header->magic)) == 0
+      && header->format == PERSISTENT_CACHE_FORMAT
+      && header->segment_info_size == sizeof(segment_t)
+      && header->segment_count >= 1
+      && header->segment_count <= get_max_segment_count()
+      && header->group_count >= 1
+      && header->data_size >= MAX_ITEM_FRACTION * ITEM_ALIGNMENT
+      && header->data_size <= SVN_MAX_OBJECT_SIZE
+      && header->data_size % ITEM_ALIGNMENT == 0
+      && header->total_size == HEADER_SIZE + header->segment_count
+                                             * get_segment_size(header)
+      && header->total_size <= SVN_MAX_OBJECT_SIZE
+      && header->total_size <= file_size;
+}
+
+/* Read the header of the open cache FILE into *HEADER and its size into
+ * *FILE_SIZE.  Zero *HEADER if the file is too short.  Use SCRATCH_POOL
+ * for temporary allocations.
+ */
+static svn_error_t *
+read_header(header_t *header,
+            apr_uint64_t *file_size,
+            apr_file_t *file,
+            apr_pool_t *scratch_pool)
+{
+  svn_filesize_t size;
+  apr_size_t bytes_read;
+  svn_boolean_t hit_eof;
+
+  SVN_ERR(svn_io_file_size_get(&size, file, scratch_pool));
+  *file_size = (apr_uint64_t)size;
+
+  SVN_ERR(svn_io_file_read_full2(file, header, sizeof(*header),
+                                 &bytes_read, &hit_eof, scratch_pool));
+  if (bytes_read < sizeof(*header))
+    memset(header, 0, sizeof(*header));
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the cache file at absolute PATH and return it in *STORE_P,
+ * allocated in RESULT_POOL.  If no other process uses the file, make it
+ * SIZE bytes large unless it already has that geometry.  Otherwise,
+ * attach to it with the geometry stored in the file.
+ */
+static svn_error_t *
+open_store(svn_cache__persistent_t **store_p,
+           const char *path,
+           apr_uint64_t size,
+           apr_pool_t *result_pool)
+{
+#if APR_HAS_MMAP && SVN_CACHE__HAS_SHARED_LOCK
+  svn_cache__persistent_t *store = apr_pcalloc(result_pool, sizeof(*store));
+  header_t header;
+  header_t requested;
+  apr_uint64_t file_size;
+  svn_boolean_t alone;
+  svn_boolean_t initialize = FALSE;
+  apr_status_t status;
+  apr_uint32_t i;
+  char *base;
+
+  store->path = apr_pstrdup(result_pool, path);
+  store->local_path = svn_dirent_local_style(path, result_pool);
+
+  SVN_ERR(svn_io_file_open(&store->file, path,
+                           APR_READ | APR_WRITE | APR_CREATE | APR_BINARY,
+                           APR_OS_DEFAULT, result_pool));
+
+  /* If we get an exclusive lock, nobody else has the file mapped and we
+   * may change it as we see fit.  Otherwise, wait until whoever is
+   * initializing the file is done with it. */
+  status = apr_file_lock(store->file,
+                         APR_FLOCK_EXCLUSIVE | APR_FLOCK_NONBLOCK);
+  alone = (status == APR_SUCCESS);
+  if (!alone && APR_STATUS_IS_EAGAIN(status))
+    status = apr_file_lock(store->file, APR_FLOCK_SHARED);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't lock cache file '%s'"),
+                              store->local_path);
+
+  SVN_ERR(read_header(&header, &file_size, store->file, result_pool));
+
+  memset(&requested, 0, sizeof(requested));
+  get_geometry(&requested, size);
+
+  if (alone)
+    {
+      /* Start from scratch if the file does not match our expectations. */
+      if (   !is_valid_header(&header, file_size)
+          || header.segment_count != requested.segment_count
+          || header.group_count != requested.group_count
+          || header.data_size != requested.data_size)
+        {
+          initialize = TRUE;
+          header = requested;
+          memcpy(header.magic, PERSISTENT_CACHE_MAGIC, sizeof(header.magic));
+          header.format = PERSISTENT_CACHE_FORMAT;
+          header.segment_info_size = sizeof(segment_t);
+
+          SVN_ERR(svn_io_file_trunc(store->file, (apr_off_t)header.total_size,
+                                    result_pool));
+        }
+    }
+  else if (!is_valid_header(&header, file_size))
+    {
+      /* Never touch a file that other processes have mapped. */
+      return svn_error_createf(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
+                               _("Cache file '%s' is in use with an "
+                                 "incompatible format"),
+                               store->local_path);
+    }
+
+  status = apr_mmap_create(&store->mmap, store->file, 0,
+                           (apr_size_t)header.total_size,
+                           APR_MMAP_READ | APR_MMAP_WRITE, result_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't map cache file '%s'"),
+                              store->local_path);
+
+  base = store->mmap->mm;
+  store->header = (header_t *)base;
+  store->segments = (segment_t *)(store->header + 1);
+  store->first_segment = base + HEADER_SIZE;
+  store->segment_count = header.segment_count;
+  store->group_count = header.group_count;
+  store->data_size = header.data_size;
+  store->segment_size = get_segment_size(&header);
+  store->max_record_size = store->data_size / MAX_ITEM_FRACTION;
+
+  if (alone)
+    {
+      /* The mutexes may be left over from processes that are gone, maybe
+       * even from before a reboot.  Nobody else can be using them. */
+      if (initialize)
+        {
+          memset(base, 0, HEADER_SIZE);
+          for (i = 0; i < store->segment_count; ++i)
+            memset(get_buckets(store, &store->segments[i]), 0,
+                   store->group_count * GROUP_SIZE * sizeof(bucket_t));
+        }
+
+      for (i = 0; i < store->segment_count; ++i)
+        {
+          SVN_ERR(svn_cache__shared_lock_init(&store->segments[i].lock));
+          store->segments[i].update_count = 0;
+        }
+
+      /* Publish the header last. */
+      *store->header = header;
+
+      /* Let other processes attach. */
+      status = apr_file_lock(store->file, APR_FLOCK_SHARED);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't lock cache file '%s'"),
+                                  store->local_path);
+    }
+
+  *store_p = store;
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Persistent caches require memory-mapped "
+                            "files and process-shared mutexes"));
+#endif
+}
+
+/* All cache files opened by this process, mapping their absolute paths to
+ * svn_cache__persistent_t *.  Allocated in REGISTRY_POOL and protected by
+ * REGISTRY_MUTEX.
+ */
+static apr_hash_t *registry = NULL;
+static apr_pool_t *registry_pool = NULL;
+static svn_mutex__t *registry_mutex = NULL;
+
+/* Initialization state of REGISTRY as used by svn_atomic__init_once.
+ */
+static svn_atomic_t registry_initialized = 0;
+
+/* Initializer function as required by svn_atomic__init_once.  Create
+ * REGISTRY and its mutex.  BATON and UNUSED_POOL are unused.
+ */
+static svn_error_t *
+initialize_registry(void *baton,
+                    apr_pool_t *unused_pool)
+{
+  registry_pool = svn_pool_create(NULL);
+  registry = apr_hash_make(registry_pool);
+  SVN_ERR(svn_mutex__init(&registry_mutex, TRUE, registry_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *STORE_P to the cache file at absolute PATH from REGISTRY, opening
+ * it with SIZE bytes if necessary.  The caller must hold REGISTRY_MUTEX.
+ */
+static svn_error_t *
+get_store(svn_cache__persistent_t **store_p,
+          const char *path,
+          apr_uint64_t size)
+{
+  svn_cache__persistent_t *store = svn_hash_gets(registry, path);
+  if (!store)
+    {
+      apr_pool_t *store_pool = svn_pool_create(registry_pool);
+      svn_error_t *err = open_store(&store, path, size, store_pool);
+      if (err)
+        {
+          svn_pool_destroy(store_pool);
+          return svn_error_trace(err);
+        }
+
+      svn_hash_sets(registry, store->path, store);
+    }
+
+  *store_p = store;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__persistent_open(svn_cache__persistent_t **store_p,
+                           const char *path,
+                           apr_uint64_t size,
+                           apr_pool_t *scratch_pool)
+{
+  const char *abspath;
+
+  /* Not all platforms can map large files into the address space. */
+  size = MAX(MIN_CACHE_SIZE, MIN(size, (apr_uint64_t)SVN_MAX_OBJECT_SIZE));
+
+  SVN_ERR(svn_atomic__init_once(&registry_initialized, initialize_registry,
+                                NULL, scratch_pool));
+  SVN_ERR(svn_dirent_get_absolute(&abspath, path, scratch_pool));
+
+  SVN_MUTEX__WITH_LOCK(registry_mutex, get_store(store_p, abspath, size));
+
+  return SVN_NO_ERROR;
+}
+
+
+/*** The cache vtable. ***/
+
+/* Set *FULL_KEY to the key under which KEY of CACHE is being stored in the
+ * cache file and *FULL_KEY_LEN to its length.  Allocate it in POOL.
+ */
+static void
+build_key(const char **full_key,
+          apr_size_t *full_key_len,
+          persistent_cache_t *cache,
+          const void *key,
+          apr_pool_t *pool)
+{
+  apr_size_t key_len = cache->klen == APR_HASH_KEY_STRING
+                     ? strlen(key)
+                     : (apr_size_t)cache->klen;
+  char *result = apr_palloc(pool, cache->prefix_len + key_len);
+
+  memcpy(result, cache->prefix, cache->prefix_len);
+  memcpy(result + cache->prefix_len, key, key_len);
+
+  *full_key = result;
+  *full_key_len = cache->prefix_len + key_len;
+}
+
+/* Deserialize the SIZE bytes of DATA read from the cache file into
+ * *VALUE_P using the deserializer of CACHE.  Allocate the result in
+ * RESULT_POOL.
+ */
+static svn_error_t *
+deserialize(void **value_p,
+            persistent_cache_t *cache,
+            char *data,
+            apr_size_t size,
+            apr_pool_t *result_pool)
+{
+  if (cache->deserialize_func)
+    {
+      SVN_ERR((cache->deserialize_func)(value_p, data, size, result_pool));
+    }
+  else
+    {
+      svn_stringbuf_t *value = svn_stringbuf_create_empty(result_pool);
+      value->data = data;
+      value->blocksize = size;
+      value->len = size - 1; /* account for trailing NUL */
+      *value_p = value;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Copy the SIZE bytes of DATA read from the cache file for KEY into the
+ * L1 cache of CACHE.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+promote(persistent_cache_t *cache,
+        const void *key,
+        const char *data,
+        apr_size_t size,
+        apr_pool_t *scratch_pool)
+{
+  void *value;
+
+  /* Deserializers modify the buffer in-place. */
+  char *copy = apr_pmemdup(scratch_pool, data, size + 1);
+
+  SVN_ERR(deserialize(&value, cache, copy, size, scratch_pool));
+  SVN_ERR(svn_cache__set(cache->l1_cache, key, value, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+persistent_cache_get(void **value_p,
+                     svn_boolean_t *found,
+                     void *cache_void,
+                     const void *key,
+                     apr_pool_t *result_pool)
+{
+  persistent_cache_t *cache = cache_void;
+  apr_pool_t *subpool;
+  const char *full_key;
+  apr_size_t full_key_len;
+  char *data;
+  apr_size_t size;
+
+  SVN_ERR(svn_cache__get(value_p, found, cache->l1_cache, key,
+                         result_pool));
+  if (*found || key == NULL)
+    return SVN_NO_ERROR;
+
+  subpool = svn_pool_create(result_pool);
+  build_key(&full_key, &full_key_len, cache, key, subpool);
+  SVN_ERR(store_get(&data, &size, found, cache->store, full_key,
+                    full_key_len, result_pool));
+
+  if (*found)
+    {
+      SVN_ERR(promote(cache, key, data, size, subpool));
+      SVN_ERR(deserialize(value_p, cache, data, size, result_pool));
+    }
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+persistent_cache_has_key(svn_boolean_t *found,
+                         void *cache_void,
+                         const void *key,
+                         apr_pool_t *scratch_pool)
+{
+  persistent_cache_t *cache = cache_void;
+  const char *full_key;
+  apr_size_t full_key_len;
+  char *data;
+  apr_size_t size;
+
+  SVN_ERR(svn_cache__has_key(found, cache->l1_cache, key, scratch_pool));
+  if (*found || key == NULL)
+    return SVN_NO_ERROR;
+
+  build_key(&full_key, &full_key_len, cache, key, scratch_pool);
+  SVN_ERR(store_get(&data, &size, found, cache->store, full_key,
+                    full_key_len, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+persistent_cache_set(void *cache_void,
+                     const void *key,
+                     void *value,
+                     apr_pool_t *scratch_pool)
+{
+  persistent_cache_t *cache = cache_void;
+  apr_pool_t *subpool;
+  const char *full_key;
+  apr_size_t full_key_len;
+  void *data;
+  apr_size_t size;
+
+  SVN_ERR(svn_cache__set(cache->l1_cache, key, value, scratch_pool));
+  if (key == NULL || value == NULL)
+    return SVN_NO_ERROR;
+
+  subpool = svn_pool_create(scratch_pool);
+  if (cache->serialize_func)
+    {
+      SVN_ERR((cache->serialize_func)(&data, &size, value, subpool));
+    }
+  else
+    {
+      svn_stringbuf_t *value_str = value;
+      data = value_str->data;
+      size = value_str->len + 1; /* copy trailing NUL */
+    }
+
+  build_key(&full_key, &full_key_len, cache, key, subpool);
+  SVN_ERR(store_set(cache->store, full_key, full_key_len, data, size));
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+persistent_cache_iter(svn_boolean_t *completed,
+                      void *cache_void,
+                      svn_iter_apr_hash_cb_t user_cb,
+                      void *user_baton,
+                      apr_pool_t *scratch_pool)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Can't iterate a persistent cache"));
+}
+
+static svn_boolean_t
+persistent_cache_is_cachable(void *cache_void,
+                             apr_size_t size)
+{
+  persistent_cache_t *cache = cache_void;
+
+  return svn_cache__is_cachable(cache->l1_cache, size)
+      || size < cache->store->max_record_size - cache->prefix_len;
+}
+
+static svn_error_t *
+persistent_cache_get_partial(void **value_p,
+                             svn_boolean_t *found,
+                             void *cache_void,
+                             const void *key,
+                             svn_cache__partial_getter_func_t func,
+                             void *baton,
+                             apr_pool_t *result_pool)
+{
+  persistent_cache_t *cache = cache_void;
+  apr_pool_t *subpool;
+  const char *full_key;
+  apr_size_t full_key_len;
+  char *data;
+  apr_size_t size;
+
+  SVN_ERR(svn_cache__get_partial(value_p, found, cache->l1_cache, key,
+                                 func, baton, result_pool));
+  if (*found || key == NULL)
+    return SVN_NO_ERROR;
+
+  subpool = svn_pool_create(result_pool);
+  build_key(&full_key, &full_key_len, cache, key, subpool);
+  SVN_ERR(store_get(&data, &size, found, cache->store, full_key,
+                    full_key_len, subpool));
+
+  if (*found)
+    {
+      SVN_ERR(promote(cache, key, data, size, subpool));
+      SVN_ERR(func(value_p, data, size, baton, result_pool));
+    }
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+persistent_cache_set_partial(void *cache_void,
+                             const void *key,
+                             svn_cache__partial_setter_func_t func,
+                             void *baton,
+                             apr_pool_t *scratch_pool)
+{
+  persistent_cache_t *cache = cache_void;
+  const char *full_key;
+  apr_size_t full_key_len;
+
+  SVN_ERR(svn_cache__set_partial(cache->l1_cache, key, func, baton,
+                                 scratch_pool));
+  if (key == NULL)
+    return SVN_NO_ERROR;
+
+  /* The cache file would still contain the unmodified data. */
+  build_key(&full_key, &full_key_len, cache, key, scratch_pool);
+  SVN_ERR(store_remove(cache->store, full_key, full_key_len));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+persistent_cache_get_info(void *cache_void,
+                          svn_cache__info_t *info,
+                          svn_boolean_t reset,
+                          apr_pool_t *result_pool)
+{
+  persistent_cache_t *cache = cache_void;
+
+  return svn_error_trace(svn_cache__get_info(cache->l1_cache, info, reset,
+                                             result_pool));
+}
+
+static svn_cache__vtable_t persistent_cache_vtable = {
+  persistent_cache_get,
+  persistent_cache_has_key,
+  persistent_cache_set,
+  persistent_cache_iter,
+  persistent_cache_is_cachable,
+  persistent_cache_get_partial,
+  persistent_cache_set_partial,
+  persistent_cache_get_info
+};
+
+svn_error_t *
+svn_cache__create_persistent(svn_cache__t **cache_p,
+                             svn_cache__t *l1_cache,
+                             svn_cache__persistent_t *store,
+                             svn_cache__serialize_func_t serialize_func,
+                             svn_cache__deserialize_func_t deserialize_func,
+                             apr_ssize_t klen,
+                             const char *prefix,
+                             apr_pool_t *result_pool)
+{
+  svn_cache__t *wrapper = apr_pcalloc(result_pool, sizeof(*wrapper));
+  persistent_cache_t *cache = apr_pcalloc(result_pool, sizeof(*cache));
+
+  cache->l1_cache = l1_cache;
+  cache->store = store;
+  cache->serialize_func = serialize_func;
+  cache->deserialize_func = deserialize_func;
+  cache->klen = klen;
+  cache->prefix = apr_pstrdup(result_pool, prefix);
+  cache->prefix_len = strlen(prefix) + 1;
+
+  wrapper->vtable = &persistent_cache_vtable;
+  wrapper->cache_internal = cache;
+  wrapper->error_handler = 0;
+  wrapper->error_baton = 0;
+  wrapper->pretend_empty = !!getenv("SVN_X_DOES_NOT_MARK_THE_SPOT");
+
+  *cache_p = wrapper;
+  return SVN_NO_ERROR;
+}
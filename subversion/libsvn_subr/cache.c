@@ -21,6 +21,9 @@
  * ====================================================================
  */
 
+#include <errno.h>
+
+#include "svn_private_config.h"
 #include "cache.h"
 
 svn_error_t *
@@ -317,3 +320,79 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             info->total_entries,
                             histogram);
 }
+
+svn_error_t *
+svn_cache__shared_lock_init(svn_cache__shared_lock_t *lock)
+{
+#if SVN_CACHE__HAS_SHARED_LOCK
+  pthread_mutexattr_t attr;
+  int status;
+
+  status = pthread_mutexattr_init(&attr);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create cache mutex"));
+
+  status = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+  if (!status)
+    status = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+  if (!status)
+    status = pthread_mutex_init(lock, &attr);
+
+  pthread_mutexattr_destroy(&attr);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create cache mutex"));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__shared_lock_acquire(svn_cache__shared_lock_t *lock,
+                               svn_boolean_t blocking,
+                               svn_boolean_t *acquired,
+                               svn_boolean_t *recovered)
+{
+#if SVN_CACHE__HAS_SHARED_LOCK
+  int status = blocking ? pthread_mutex_lock(lock)
+                        : pthread_mutex_trylock(lock);
+
+  *acquired = TRUE;
+  *recovered = FALSE;
+
+  if (status == EOWNERDEAD)
+    {
+      /* We own the lock now.  Make it usable for the others again. */
+      *recovered = TRUE;
+      status = pthread_mutex_consistent(lock);
+    }
+  else if (status == EBUSY && !blocking)
+    {
+      *acquired = FALSE;
+      status = 0;
+    }
+
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't lock cache mutex"));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Process-shared mutexes are not supported"));
+#endif
+}
+
+svn_error_t *
+svn_cache__shared_lock_release(svn_cache__shared_lock_t *lock,
+                               svn_error_t *err)
+{
+#if SVN_CACHE__HAS_SHARED_LOCK
+  int status = pthread_mutex_unlock(lock);
+  if (err)
+    return err;
+
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't unlock cache mutex"));
+#endif
+
+  return err;
+}
@@ -24,6 +24,11 @@
 #ifndef SVN_LIBSVN_SUBR_CACHE_H
 #define SVN_LIBSVN_SUBR_CACHE_H
 
+#include <apr.h>
+#if APR_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include "private/svn_cache.h"
 
 #ifdef __cplusplus
@@ -111,6 +116,69 @@ struct svn_cache__t {
   svn_boolean_t pretend_empty;
 };
 
+/* Caches in shared memory need mutexes that live in that memory and that
+ * can be recovered if their owner process dies.  Robust mutexes are part
+ * of POSIX.1-2008.  Without them, we don't support such caches.
+ */
+#if APR_HAS_PROC_PTHREAD_SERIALIZE \
+    && defined(_POSIX_VERSION) && _POSIX_VERSION >= 200809L
+#  include <pthread.h>
+#  define SVN_CACHE__HAS_SHARED_LOCK 1
+#else
+#  define SVN_CACHE__HAS_SHARED_LOCK 0
+#endif
+
+/* A mutex that may be placed in shared memory and used to serialize
+ * access across processes.
+ */
+#if SVN_CACHE__HAS_SHARED_LOCK
+typedef pthread_mutex_t svn_cache__shared_lock_t;
+#else
+/* Never used because shared caches are not supported. */
+typedef int svn_cache__shared_lock_t;
+#endif
+
+/* Initialize the process-shared LOCK in shared memory.
+ */
+svn_error_t *
+svn_cache__shared_lock_init(svn_cache__shared_lock_t *lock);
+
+/* Acquire the LOCK shared between processes.  If BLOCKING is not set,
+ * set *ACQUIRED to FALSE if the lock is currently being held by someone
+ * else.  Otherwise, set it to TRUE once the lock has been acquired.
+ *
+ * If the previous owner died while holding the lock, set *RECOVERED to
+ * TRUE.  The data protected by LOCK must then be assumed inconsistent.
+ * Otherwise, set *RECOVERED to FALSE.
+ */
+svn_error_t *
+svn_cache__shared_lock_acquire(svn_cache__shared_lock_t *lock,
+                               svn_boolean_t blocking,
+                               svn_boolean_t *acquired,
+                               svn_boolean_t *recovered);
+
+/* Release the LOCK acquired with svn_cache__shared_lock_acquire.  Return
+ * ERR upon success.
+ */
+svn_error_t *
+svn_cache__shared_lock_release(svn_cache__shared_lock_t *lock,
+                               svn_error_t *err);
+
+/* Lock-free readers validate what they read against a sequence counter
+ * that writers update.  That requires full memory barriers, which we can
+ * only get from the compiler.  SVN_CACHE__HAS_MEMORY_BARRIER is 0 if we
+ * don't know how to get them.
+ */
+#if defined(__GNUC__) && defined(__ATOMIC_SEQ_CST)
+#  define SVN_CACHE__HAS_MEMORY_BARRIER 1
+#  define SVN_CACHE__MEMORY_BARRIER() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#elif defined(_MSC_VER)
+#  define SVN_CACHE__HAS_MEMORY_BARRIER 1
+#  define SVN_CACHE__MEMORY_BARRIER() MemoryBarrier()
+#else
+#  define SVN_CACHE__HAS_MEMORY_BARRIER 0
+#endif
+
 
 #ifdef __cplusplus
 }
@@ -28,6 +28,7 @@
 
 #include "svn_pools.h"
 #include "svn_sorts.h"
+#include "svn_private_config.h"
 
 /* The cache settings as a process-wide singleton.
  */
@@ -71,9 +72,23 @@ svn_cache_config_get(void)
   return &cache_settings;
 }
 
+/* The process-global (singleton) membuffer cache.  NULL if it has not
+ * been created (yet) or if caching has been disabled.
+ */
+static svn_membuffer_t *global_cache = NULL;
+
+/* Initialization state of GLOBAL_CACHE as used by svn_atomic__init_once.
+ */
+static svn_atomic_t global_cache_initialized = 0;
+
+/* Set if GLOBAL_CACHE lives in shared memory.
+ */
+static svn_boolean_t global_cache_shared = FALSE;
+
 /* Initializer function as required by svn_atomic__init_once.  Allocate
  * the process-global (singleton) membuffer cache and return it in the
- * svn_membuffer_t * in *BATON.  UNUSED_POOL is unused and should be NULL.
+ * svn_membuffer_t * in *BATON.  If GLOBAL_CACHE_SHARED is set, place it
+ * in shared memory.  UNUSED_POOL is unused and should be NULL.
  */
 static svn_error_t *
 initialize_cache(void *baton, apr_pool_t *unused_pool)
@@ -120,14 +135,23 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
         return SVN_NO_ERROR;
       apr_allocator_owner_set(allocator, pool);
 
-      err = svn_cache__membuffer_cache_create(
-          &cache,
-          (apr_size_t)cache_size,
-          (apr_size_t)(cache_size / 5),
-          0,
-          ! svn_cache_config_get()->single_threaded,
-          FALSE,
-          pool);
+      if (global_cache_shared)
+        err = svn_cache__membuffer_cache_create_shared(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            FALSE,
+            pool);
+      else
+        err = svn_cache__membuffer_cache_create(
+            &cache,
+            (apr_size_t)cache_size,
+            (apr_size_t)(cache_size / 5),
+            0,
+            ! svn_cache_config_get()->single_threaded,
+            FALSE,
+            pool);
 
       /* Some error occurred. Most likely it's an OOM error but we don't
        * really care. Simply release all cache memory and disable caching
@@ -158,11 +182,9 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
 svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void)
 {
-  static svn_membuffer_t *cache = NULL;
-  static svn_atomic_t initialized = 0;
-
   svn_error_t *err
-    = svn_atomic__init_once(&initialized, initialize_cache, &cache, NULL);
+    = svn_atomic__init_once(&global_cache_initialized, initialize_cache,
+                            &global_cache, NULL);
   if (err)
     {
       /* no caches today ... */
@@ -170,7 +192,7 @@ svn_cache__get_global_membuffer_cache(void)
       return NULL;
     }
 
-  return cache;
+  return global_cache;
 }
 
 void
@@ -179,3 +201,32 @@ svn_cache_config_set(const svn_cache_config_t *settings)
   cache_settings = *settings;
 }
 
+svn_error_t *
+svn_cache_config_share(void)
+{
+  apr_uint64_t cache_size = cache_settings.cache_size;
+  svn_error_t *err;
+
+  /* Nothing to do if we already succeeded before. */
+  if (global_cache_shared)
+    return SVN_NO_ERROR;
+
+  /* The process-local cache may be in use already. */
+  if (svn_atomic_read(&global_cache_initialized))
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("The cache has already been created"));
+
+  global_cache_shared = TRUE;
+  err = svn_atomic__init_once(&global_cache_initialized, initialize_cache,
+                              &global_cache, NULL);
+  if (err)
+    {
+      /* initialize_cache disabled caching altogether.  Undo that, so
+       * every process may still create a private cache later. */
+      global_cache_shared = FALSE;
+      cache_settings.cache_size = cache_size;
+      svn_atomic_set(&global_cache_initialized, 0);
+    }
+
+  return svn_error_trace(err);
+}
@@ -35,6 +35,8 @@
 
 #include "checksum.h"
 #include "fnv1a.h"
+#include "md5_sha1.h"
+#include "sha256.h"
 
 #include "private/svn_subr_private.h"
 
@@ -64,12 +66,21 @@ static const unsigned char fnv1a_32x4_empty_string_digest_array[] = {
   0xcd, 0x6d, 0x9a, 0x85
 };
 
+/* The SHA-256 digest for the empty string. */
+static const unsigned char sha256_empty_string_digest_array[] = {
+  0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14,
+  0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+  0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c,
+  0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55
+};
+
 /* Digests for an empty string, indexed by checksum type */
 static const unsigned char * empty_string_digests[] = {
   md5_empty_string_digest_array,
   sha1_empty_string_digest_array,
   fnv1a_32_empty_string_digest_array,
-  fnv1a_32x4_empty_string_digest_array
+  fnv1a_32x4_empty_string_digest_array,
+  sha256_empty_string_digest_array
 };
 
 /* Digest sizes in bytes, indexed by checksum type */
@@ -77,7 +88,8 @@ static const apr_size_t digest_sizes[] = {
   APR_MD5_DIGESTSIZE,
   APR_SHA1_DIGESTSIZE,
   sizeof(apr_uint32_t),
-  sizeof(apr_uint32_t)
+  sizeof(apr_uint32_t),
+  SVN__SHA256_DIGESTSIZE
 };
 
 /* Checksum type prefixes used in serialized checksums. */
@@ -86,15 +98,16 @@ static const char *ckind_str[] = {
   "$sha1$",
   "$fnv1$",
   "$fnvm$",
+  "$s256$",
   /* ### svn_checksum_deserialize() assumes all these have the same strlen() */
 };
 
 /* Returns the digest size of it's argument. */
 #define DIGESTSIZE(k) \
-  (((k) < svn_checksum_md5 || (k) > svn_checksum_fnv1a_32x4) ? 0 : digest_sizes[k])
+  (((k) < svn_checksum_md5 || (k) > svn_checksum_sha256) ? 0 : digest_sizes[k])
 
 /* Largest supported digest size */
-#define MAX_DIGESTSIZE (MAX(APR_MD5_DIGESTSIZE,APR_SHA1_DIGESTSIZE))
+#define MAX_DIGESTSIZE (SVN__SHA256_DIGESTSIZE)
 
 const unsigned char *
 svn__empty_string_digest(svn_checksum_kind_t kind)
@@ -153,7 +166,7 @@ svn__digests_match(const unsigned char d1[],
 static svn_error_t *
 validate_kind(svn_checksum_kind_t kind)
 {
-  if (kind >= svn_checksum_md5 && kind <= svn_checksum_fnv1a_32x4)
+  if (kind >= svn_checksum_md5 && kind <= svn_checksum_sha256)
     return SVN_NO_ERROR;
   else
     return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL, NULL);
@@ -202,6 +215,7 @@ svn_checksum_create(svn_checksum_kind_t kind,
       case svn_checksum_sha1:
       case svn_checksum_fnv1a_32:
       case svn_checksum_fnv1a_32x4:
+      case svn_checksum_sha256:
         digest_size = digest_sizes[kind];
         break;
 
@@ -242,6 +256,13 @@ svn_checksum__from_digest_fnv1a_32x4(const unsigned char *digest,
   return checksum_create(svn_checksum_fnv1a_32x4, digest, result_pool);
 }
 
+svn_checksum_t *
+svn_checksum__from_digest_sha256(const unsigned char *digest,
+                                 apr_pool_t *result_pool)
+{
+  return checksum_create(svn_checksum_sha256, digest, result_pool);
+}
+
 svn_error_t *
 svn_checksum_clear(svn_checksum_t *checksum)
 {
@@ -267,6 +288,7 @@ svn_checksum_match(const svn_checksum_t *checksum1,
       case svn_checksum_sha1:
       case svn_checksum_fnv1a_32:
       case svn_checksum_fnv1a_32x4:
+      case svn_checksum_sha256:
         return svn__digests_match(checksum1->digest,
                                   checksum2->digest,
                                   digest_sizes[checksum1->kind]);
@@ -287,6 +309,7 @@ svn_checksum_to_cstring_display(const svn_checksum_t *checksum,
       case svn_checksum_sha1:
       case svn_checksum_fnv1a_32:
       case svn_checksum_fnv1a_32x4:
+      case svn_checksum_sha256:
         return svn__digest_to_cstring_display(checksum->digest,
                                               digest_sizes[checksum->kind],
                                               pool);
@@ -310,6 +333,7 @@ svn_checksum_to_cstring(const svn_checksum_t *checksum,
       case svn_checksum_sha1:
       case svn_checksum_fnv1a_32:
       case svn_checksum_fnv1a_32x4:
+      case svn_checksum_sha256:
         return svn__digest_to_cstring(checksum->digest,
                                       digest_sizes[checksum->kind],
                                       pool);
@@ -327,7 +351,7 @@ svn_checksum_serialize(const svn_checksum_t *checksum,
                        apr_pool_t *scratch_pool)
 {
   SVN_ERR_ASSERT_NO_RETURN(checksum->kind >= svn_checksum_md5
-                           || checksum->kind <= svn_checksum_fnv1a_32x4);
+                           || checksum->kind <= svn_checksum_sha256);
   return apr_pstrcat(result_pool,
                      ckind_str[checksum->kind],
                      svn_checksum_to_cstring(checksum, scratch_pool),
@@ -353,7 +377,7 @@ svn_checksum_deserialize(const svn_checksum_t **checksum,
                              _("Invalid prefix in checksum '%s'"),
                              data);
 
-  for (kind = svn_checksum_md5; kind <= svn_checksum_fnv1a_32x4; ++kind)
+  for (kind = svn_checksum_md5; kind <= svn_checksum_sha256; ++kind)
     if (strncmp(ckind_str[kind], data, prefix_len) == 0)
       {
         SVN_ERR(svn_checksum_parse_hex(&parsed_checksum, kind,
@@ -460,6 +484,7 @@ svn_checksum_dup(const svn_checksum_t *checksum,
       case svn_checksum_sha1:
       case svn_checksum_fnv1a_32:
       case svn_checksum_fnv1a_32x4:
+      case svn_checksum_sha256:
         return checksum_create(checksum->kind, checksum->digest, pool);
 
       default:
@@ -502,6 +527,10 @@ svn_checksum(svn_checksum_t **checksum,
           = htonl(svn__fnv1a_32x4(data, len));
         break;
 
+      case svn_checksum_sha256:
+        svn__sha256((unsigned char *)(*checksum)->digest, data, len);
+        break;
+
       default:
         /* We really shouldn't get here, but if we do... */
         return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL, NULL);
@@ -521,6 +550,7 @@ svn_checksum_empty_checksum(svn_checksum_kind_t kind,
       case svn_checksum_sha1:
       case svn_checksum_fnv1a_32:
       case svn_checksum_fnv1a_32x4:
+      case svn_checksum_sha256:
         return checksum_create(kind, empty_string_digests[kind], pool);
 
       default:
@@ -562,6 +592,10 @@ svn_checksum_ctx_create(svn_checksum_kind_t kind,
         ctx->apr_ctx = svn_fnv1a_32x4__context_create(pool);
         break;
 
+      case svn_checksum_sha256:
+        ctx->apr_ctx = svn_sha256__context_create(pool);
+        break;
+
       default:
         SVN_ERR_MALFUNCTION_NO_RETURN();
     }
@@ -592,6 +626,10 @@ svn_checksum_ctx_reset(svn_checksum_ctx_t *ctx)
         svn_fnv1a_32x4__context_reset(ctx->apr_ctx);
         break;
 
+      case svn_checksum_sha256:
+        svn_sha256__context_reset(ctx->apr_ctx);
+        break;
+
       default:
         SVN_ERR_MALFUNCTION();
     }
@@ -622,6 +660,10 @@ svn_checksum_update(svn_checksum_ctx_t *ctx,
         svn_fnv1a_32x4__update(ctx->apr_ctx, data, len);
         break;
 
+      case svn_checksum_sha256:
+        svn_sha256__update(ctx->apr_ctx, data, len);
+        break;
+
       default:
         /* We really shouldn't get here, but if we do... */
         return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL, NULL);
@@ -657,6 +699,11 @@ svn_checksum_final(svn_checksum_t **checksum,
           = htonl(svn_fnv1a_32x4__finalize(ctx->apr_ctx));
         break;
 
+      case svn_checksum_sha256:
+        svn_sha256__finalize((unsigned char *)(*checksum)->digest,
+                             ctx->apr_ctx);
+        break;
+
       default:
         /* We really shouldn't get here, but if we do... */
         return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL, NULL);
@@ -708,6 +755,7 @@ svn_checksum_is_empty_checksum(svn_checksum_t *checksum)
       case svn_checksum_sha1:
       case svn_checksum_fnv1a_32:
       case svn_checksum_fnv1a_32x4:
+      case svn_checksum_sha256:
         return svn__digests_match(checksum->digest,
                                   svn__empty_string_digest(checksum->kind),
                                   digest_sizes[checksum->kind]);
@@ -718,6 +766,118 @@ svn_checksum_is_empty_checksum(svn_checksum_t *checksum)
     }
 }
 
+/* Multi-kind checksum contexts.
+ */
+
+struct svn_checksum__multi_ctx_t
+{
+  /* Number of elements in CONTEXTS. */
+  int count;
+
+  /* One context per checksum kind to calculate.  NULL if MD5_SHA1 is
+   * being used instead. */
+  svn_checksum_ctx_t **contexts;
+
+  /* If not NULL, calculate exactly an MD5 and a SHA-1 checksum in a
+   * single, interleaved pass.  That is the combination that FSFS and the
+   * working copy need for every file. */
+  svn__md5_sha1_ctx_t *md5_sha1;
+};
+
+svn_checksum__multi_ctx_t *
+svn_checksum__multi_ctx_create(const svn_checksum_kind_t *kinds,
+                               int count,
+                               apr_pool_t *pool)
+{
+  svn_checksum__multi_ctx_t *ctx = apr_pcalloc(pool, sizeof(*ctx));
+  int i;
+
+  ctx->count = count;
+  if (   count == 2
+      && (   (kinds[0] == svn_checksum_md5 && kinds[1] == svn_checksum_sha1)
+          || (kinds[0] == svn_checksum_sha1 && kinds[1] == svn_checksum_md5)))
+    {
+      ctx->md5_sha1 = apr_palloc(pool, sizeof(*ctx->md5_sha1));
+      svn__md5_sha1_init(ctx->md5_sha1);
+      return ctx;
+    }
+
+  ctx->contexts = apr_palloc(pool, count * sizeof(*ctx->contexts));
+  for (i = 0; i < count; ++i)
+    ctx->contexts[i] = svn_checksum_ctx_create(kinds[i], pool);
+
+  return ctx;
+}
+
+svn_error_t *
+svn_checksum__multi_ctx_reset(svn_checksum__multi_ctx_t *ctx)
+{
+  int i;
+
+  if (ctx->md5_sha1)
+    {
+      svn__md5_sha1_init(ctx->md5_sha1);
+      return SVN_NO_ERROR;
+    }
+
+  for (i = 0; i < ctx->count; ++i)
+    SVN_ERR(svn_checksum_ctx_reset(ctx->contexts[i]));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_checksum__multi_update(svn_checksum__multi_ctx_t *ctx,
+                           const void *data,
+                           apr_size_t len)
+{
+  int i;
+
+  if (ctx->md5_sha1)
+    {
+      svn__md5_sha1_update(ctx->md5_sha1, data, len);
+      return SVN_NO_ERROR;
+    }
+
+  for (i = 0; i < ctx->count; ++i)
+    SVN_ERR(svn_checksum_update(ctx->contexts[i], data, len));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_checksum__multi_final(svn_checksum_t **checksum,
+                          const svn_checksum__multi_ctx_t *ctx,
+                          svn_checksum_kind_t kind,
+                          apr_pool_t *pool)
+{
+  int i;
+
+  if (ctx->md5_sha1)
+    {
+      unsigned char md5_digest[SVN__MD5_DIGEST_SIZE];
+      unsigned char sha1_digest[SVN__SHA1_DIGEST_SIZE];
+
+      svn__md5_sha1_final(md5_digest, sha1_digest, ctx->md5_sha1);
+      if (kind == svn_checksum_md5)
+        *checksum = svn_checksum__from_digest_md5(md5_digest, pool);
+      else if (kind == svn_checksum_sha1)
+        *checksum = svn_checksum__from_digest_sha1(sha1_digest, pool);
+      else
+        *checksum = NULL;
+
+      return SVN_NO_ERROR;
+    }
+
+  for (i = 0; i < ctx->count; ++i)
+    if (ctx->contexts[i]->kind == kind)
+      return svn_error_trace(svn_checksum_final(checksum, ctx->contexts[i],
+                                                pool));
+
+  *checksum = NULL;
+  return SVN_NO_ERROR;
+}
+
 /* Checksum calculating stream wrappers.
  */
 
@@ -827,6 +987,81 @@ svn_checksum__wrap_write_stream(svn_checksum_t **checksum,
   return wrap_write_stream(checksum, NULL, inner_stream, kind, pool);
 }
 
+/* Baton used by multi_write_handler and multi_close_handler.
+ */
+typedef struct multi_stream_baton_t
+{
+  /* Stream we are wrapping. Forward write() and close() operations to it. */
+  svn_stream_t *inner_stream;
+
+  /* Build the checksums in here. */
+  svn_checksum__multi_ctx_t *context;
+
+  /* Kinds of checksums to calculate and where to write them to.
+   * Both have CONTEXT->COUNT elements. */
+  svn_checksum_kind_t *kinds;
+  svn_checksum_t ***checksums;
+
+  /* Allocate the resulting checksums here. */
+  apr_pool_t *pool;
+} multi_stream_baton_t;
+
+/* Implement svn_write_fn_t.
+ * Update checksums and pass data on to inner stream.
+ */
+static svn_error_t *
+multi_write_handler(void *baton,
+                    const char *data,
+                    apr_size_t *len)
+{
+  multi_stream_baton_t *b = baton;
+
+  SVN_ERR(svn_checksum__multi_update(b->context, data, *len));
+  SVN_ERR(svn_stream_write(b->inner_stream, data, len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_close_fn_t.
+ * Finalize checksum calculations and write results. Close inner stream.
+ */
+static svn_error_t *
+multi_close_handler(void *baton)
+{
+  multi_stream_baton_t *b = baton;
+  int i;
+
+  for (i = 0; i < b->context->count; ++i)
+    if (b->checksums[i])
+      SVN_ERR(svn_checksum__multi_final(b->checksums[i], b->context,
+                                        b->kinds[i], b->pool));
+
+  return svn_error_trace(svn_stream_close(b->inner_stream));
+}
+
+svn_stream_t *
+svn_checksum__wrap_write_stream_multi(svn_checksum_t **checksums[],
+                                      const svn_checksum_kind_t kinds[],
+                                      int count,
+                                      svn_stream_t *inner_stream,
+                                      apr_pool_t *pool)
+{
+  svn_stream_t *outer_stream;
+
+  multi_stream_baton_t *baton = apr_pcalloc(pool, sizeof(*baton));
+  baton->inner_stream = inner_stream;
+  baton->context = svn_checksum__multi_ctx_create(kinds, count, pool);
+  baton->kinds = apr_pmemdup(pool, kinds, count * sizeof(*kinds));
+  baton->checksums = apr_pmemdup(pool, checksums, count * sizeof(*checksums));
+  baton->pool = pool;
+
+  outer_stream = svn_stream_create(baton, pool);
+  svn_stream_set_write(outer_stream, multi_write_handler);
+  svn_stream_set_close(outer_stream, multi_close_handler);
+
+  return outer_stream;
+}
+
 /* Implement svn_close_fn_t.
  * For FNV-1a-like checksums, we want the checksum as 32 bit integer instead
  * of a big endian 4 byte sequence.  This simply wraps close_handler adding
@@ -1169,6 +1169,13 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "###   http-bulk-updates          Whether to request bulk update"    NL
         "###                              responses or to fetch each file"   NL
         "###                              in an individual request. "        NL
+        "###   svn-max-connections        Maximum number of parallel server" NL
+        "###                              connections to use for an svn://"  NL
+        "###                              checkout.  Values above 1 fetch"   NL
+        "###                              file contents over extra"          NL
+        "###                              connections.  Updates of existing" NL
+        "###                              working copies still receive"      NL
+        "###                              deltas over one connection."       NL
         "###   store-passwords            Specifies whether passwords used"  NL
         "###                              to authenticate against a"         NL
         "###                              Subversion server may be cached"   NL
@@ -1552,6 +1559,20 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### returning an error.  The default is 10000, i.e. 10 seconds."    NL
         "### Longer values may be useful when exclusive locking is enabled." NL
         "# busy-timeout = 10000"                                             NL
+        "### Set the maximum number of threads that may be used to scan"    NL
+        "### the working copy in parallel, e.g. during 'svn status', and"    NL
+        "### to install independent files in parallel during checkout and"   NL
+        "### update.  More threads mainly help with large working copies"    NL
+        "### on slow or network file systems and fast local SSDs.  The"      NL
+        "### default is 1, i.e. no parallelism.  Exclusive locking always"   NL
+        "### disables parallel processing."                                  NL
+        "# worker-threads = 1"                                               NL
+        "### Set to true to store the pristine copies of files that are"     NL
+        "### added to a working copy LZ4-compressed.  This saves disk space" NL
+        "### and I/O at the expense of some CPU time.  Pristine copies that" NL
+        "### are already stored are not affected.  Working copies of any"    NL
+        "### format supported by this client may hold compressed copies."    NL
+        "# compress-pristines = false"                                       NL
         ;
 
       err = svn_io_file_open(&f, path,
@@ -0,0 +1,387 @@
+/*
+ * md5_sha1.c :  calculate MD5 and SHA-1 checksums in a single pass
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "md5_sha1.h"
+
+/* The algorithms are specified in RFC 1321 (MD5) and RFC 3174 (SHA-1).
+ *
+ * Each MD5 step depends on the result of the previous one and the same is
+ * true for SHA-1.  A single checksum therefore leaves most of a modern
+ * CPU's execution units idle.  Processing the same block for both
+ * algorithms side by side fills them.  The total time is close to the
+ * time for SHA-1 alone instead of the time for MD5 plus SHA-1.
+ */
+
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* MD5 round functions. */
+#define MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+
+/* One MD5 step using round function F, message word X, rotation S and
+ * additive constant T. */
+#define MD5_STEP(f, a, b, c, d, x, s, t)                 \
+  do {                                                   \
+    (a) += f((b), (c), (d)) + (x) + (apr_uint32_t)(t);   \
+    (a) = ROTL((a), (s)) + (b);                          \
+  } while (0)
+
+/* SHA-1 round functions. */
+#define SHA1_F1(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define SHA1_F2(x, y, z) ((x) ^ (y) ^ (z))
+#define SHA1_F3(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+/* One SHA-1 step T using round function F and additive constant K.
+ * Take the message word from the 16 word ring buffer W. */
+#define SHA1_STEP(f, a, b, c, d, e, t, k)                          \
+  do {                                                             \
+    (e) += ROTL((a), 5) + f((b), (c), (d)) + (apr_uint32_t)(k)     \
+         + w[(t) & 15];                                            \
+    (b) = ROTL((b), 30);                                           \
+  } while (0)
+
+/* Like SHA1_STEP but extend the message schedule to word T first. */
+#define SHA1_STEP_X(f, a, b, c, d, e, t, k)                        \
+  do {                                                             \
+    w[(t) & 15] = ROTL(w[((t) - 3) & 15] ^ w[((t) - 8) & 15]       \
+                       ^ w[((t) - 14) & 15] ^ w[(t) & 15], 1);     \
+    SHA1_STEP(f, a, b, c, d, e, t, k);                             \
+  } while (0)
+
+/* Update the intermediate hash values in CONTEXT with the 64 byte blocks
+ * MD5_BLOCK and SHA1_BLOCK, respectively.  They only differ for the last
+ * block because the algorithms encode the total length differently.
+ */
+static void
+process_block(svn__md5_sha1_ctx_t *context,
+              const unsigned char *md5_block,
+              const unsigned char *sha1_block)
+{
+  apr_uint32_t x[16];
+  apr_uint32_t w[16];
+  apr_uint32_t ma = context->md5[0];
+  apr_uint32_t mb = context->md5[1];
+  apr_uint32_t mc = context->md5[2];
+  apr_uint32_t md = context->md5[3];
+  apr_uint32_t sa = context->sha1[0];
+  apr_uint32_t sb = context->sha1[1];
+  apr_uint32_t sc = context->sha1[2];
+  apr_uint32_t sd = context->sha1[3];
+  apr_uint32_t se = context->sha1[4];
+  int i;
+
+  /* MD5 reads the message as little endian words, SHA-1 as big endian. */
+  for (i = 0; i < 16; ++i)
+    {
+      const unsigned char *p = md5_block + 4 * i;
+      const unsigned char *q = sha1_block + 4 * i;
+
+      x[i] = (apr_uint32_t)p[0]
+           | ((apr_uint32_t)p[1] << 8)
+           | ((apr_uint32_t)p[2] << 16)
+           | ((apr_uint32_t)p[3] << 24);
+      w[i] = ((apr_uint32_t)q[0] << 24)
+           | ((apr_uint32_t)q[1] << 16)
+           | ((apr_uint32_t)q[2] << 8)
+           | (apr_uint32_t)q[3];
+    }
+
+  /* 4 MD5 steps go along with 5 SHA-1 steps, so both finish together. */
+  MD5_STEP(MD5_F, ma, mb, mc, md, x[ 0],  7, 0xd76aa478);
+  MD5_STEP(MD5_F, md, ma, mb, mc, x[ 1], 12, 0xe8c7b756);
+  MD5_STEP(MD5_F, mc, md, ma, mb, x[ 2], 17, 0x242070db);
+  MD5_STEP(MD5_F, mb, mc, md, ma, x[ 3], 22, 0xc1bdceee);
+  SHA1_STEP(SHA1_F1, sa, sb, sc, sd, se,  0, 0x5a827999);
+  SHA1_STEP(SHA1_F1, se, sa, sb, sc, sd,  1, 0x5a827999);
+  SHA1_STEP(SHA1_F1, sd, se, sa, sb, sc,  2, 0x5a827999);
+  SHA1_STEP(SHA1_F1, sc, sd, se, sa, sb,  3, 0x5a827999);
+  SHA1_STEP(SHA1_F1, sb, sc, sd, se, sa,  4, 0x5a827999);
+
+  MD5_STEP(MD5_F, ma, mb, mc, md, x[ 4],  7, 0xf57c0faf);
+  MD5_STEP(MD5_F, md, ma, mb, mc, x[ 5], 12, 0x4787c62a);
+  MD5_STEP(MD5_F, mc, md, ma, mb, x[ 6], 17, 0xa8304613);
+  MD5_STEP(MD5_F, mb, mc, md, ma, x[ 7], 22, 0xfd469501);
+  SHA1_STEP(SHA1_F1, sa, sb, sc, sd, se,  5, 0x5a827999);
+  SHA1_STEP(SHA1_F1, se, sa, sb, sc, sd,  6, 0x5a827999);
+  SHA1_STEP(SHA1_F1, sd, se, sa, sb, sc,  7, 0x5a827999);
+  SHA1_STEP(SHA1_F1, sc, sd, se, sa, sb,  8, 0x5a827999);
+  SHA1_STEP(SHA1_F1, sb, sc, sd, se, sa,  9, 0x5a827999);
+
+  MD5_STEP(MD5_F, ma, mb, mc, md, x[ 8],  7, 0x698098d8);
+  MD5_STEP(MD5_F, md, ma, mb, mc, x[ 9], 12, 0x8b44f7af);
+  MD5_STEP(MD5_F, mc, md, ma, mb, x[10], 17, 0xffff5bb1);
+  MD5_STEP(MD5_F, mb, mc, md, ma, x[11], 22, 0x895cd7be);
+  SHA1_STEP(SHA1_F1, sa, sb, sc, sd, se, 10, 0x5a827999);
+  SHA1_STEP(SHA1_F1, se, sa, sb, sc, sd, 11, 0x5a827999);
+  SHA1_STEP(SHA1_F1, sd, se, sa, sb, sc, 12, 0x5a827999);
+  SHA1_STEP(SHA1_F1, sc, sd, se, sa, sb, 13, 0x5a827999);
+  SHA1_STEP(SHA1_F1, sb, sc, sd, se, sa, 14, 0x5a827999);
+
+  MD5_STEP(MD5_F, ma, mb, mc, md, x[12],  7, 0x6b901122);
+  MD5_STEP(MD5_F, md, ma, mb, mc, x[13], 12, 0xfd987193);
+  MD5_STEP(MD5_F, mc, md, ma, mb, x[14], 17, 0xa679438e);
+  MD5_STEP(MD5_F, mb, mc, md, ma, x[15], 22, 0x49b40821);
+  SHA1_STEP(SHA1_F1, sa, sb, sc, sd, se, 15, 0x5a827999);
+  SHA1_STEP_X(SHA1_F1, se, sa, sb, sc, sd, 16, 0x5a827999);
+  SHA1_STEP_X(SHA1_F1, sd, se, sa, sb, sc, 17, 0x5a827999);
+  SHA1_STEP_X(SHA1_F1, sc, sd, se, sa, sb, 18, 0x5a827999);
+  SHA1_STEP_X(SHA1_F1, sb, sc, sd, se, sa, 19, 0x5a827999);
+
+  MD5_STEP(MD5_G, ma, mb, mc, md, x[ 1],  5, 0xf61e2562);
+  MD5_STEP(MD5_G, md, ma, mb, mc, x[ 6],  9, 0xc040b340);
+  MD5_STEP(MD5_G, mc, md, ma, mb, x[11], 14, 0x265e5a51);
+  MD5_STEP(MD5_G, mb, mc, md, ma, x[ 0], 20, 0xe9b6c7aa);
+  SHA1_STEP_X(SHA1_F2, sa, sb, sc, sd, se, 20, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, se, sa, sb, sc, sd, 21, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sd, se, sa, sb, sc, 22, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sc, sd, se, sa, sb, 23, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sb, sc, sd, se, sa, 24, 0x6ed9eba1);
+
+  MD5_STEP(MD5_G, ma, mb, mc, md, x[ 5],  5, 0xd62f105d);
+  MD5_STEP(MD5_G, md, ma, mb, mc, x[10],  9, 0x02441453);
+  MD5_STEP(MD5_G, mc, md, ma, mb, x[15], 14, 0xd8a1e681);
+  MD5_STEP(MD5_G, mb, mc, md, ma, x[ 4], 20, 0xe7d3fbc8);
+  SHA1_STEP_X(SHA1_F2, sa, sb, sc, sd, se, 25, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, se, sa, sb, sc, sd, 26, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sd, se, sa, sb, sc, 27, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sc, sd, se, sa, sb, 28, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sb, sc, sd, se, sa, 29, 0x6ed9eba1);
+
+  MD5_STEP(MD5_G, ma, mb, mc, md, x[ 9],  5, 0x21e1cde6);
+  MD5_STEP(MD5_G, md, ma, mb, mc, x[14],  9, 0xc33707d6);
+  MD5_STEP(MD5_G, mc, md, ma, mb, x[ 3], 14, 0xf4d50d87);
+  MD5_STEP(MD5_G, mb, mc, md, ma, x[ 8], 20, 0x455a14ed);
+  SHA1_STEP_X(SHA1_F2, sa, sb, sc, sd, se, 30, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, se, sa, sb, sc, sd, 31, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sd, se, sa, sb, sc, 32, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sc, sd, se, sa, sb, 33, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sb, sc, sd, se, sa, 34, 0x6ed9eba1);
+
+  MD5_STEP(MD5_G, ma, mb, mc, md, x[13],  5, 0xa9e3e905);
+  MD5_STEP(MD5_G, md, ma, mb, mc, x[ 2],  9, 0xfcefa3f8);
+  MD5_STEP(MD5_G, mc, md, ma, mb, x[ 7], 14, 0x676f02d9);
+  MD5_STEP(MD5_G, mb, mc, md, ma, x[12], 20, 0x8d2a4c8a);
+  SHA1_STEP_X(SHA1_F2, sa, sb, sc, sd, se, 35, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, se, sa, sb, sc, sd, 36, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sd, se, sa, sb, sc, 37, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sc, sd, se, sa, sb, 38, 0x6ed9eba1);
+  SHA1_STEP_X(SHA1_F2, sb, sc, sd, se, sa, 39, 0x6ed9eba1);
+
+  MD5_STEP(MD5_H, ma, mb, mc, md, x[ 5],  4, 0xfffa3942);
+  MD5_STEP(MD5_H, md, ma, mb, mc, x[ 8], 11, 0x8771f681);
+  MD5_STEP(MD5_H, mc, md, ma, mb, x[11], 16, 0x6d9d6122);
+  MD5_STEP(MD5_H, mb, mc, md, ma, x[14], 23, 0xfde5380c);
+  SHA1_STEP_X(SHA1_F3, sa, sb, sc, sd, se, 40, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, se, sa, sb, sc, sd, 41, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sd, se, sa, sb, sc, 42, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sc, sd, se, sa, sb, 43, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sb, sc, sd, se, sa, 44, 0x8f1bbcdc);
+
+  MD5_STEP(MD5_H, ma, mb, mc, md, x[ 1],  4, 0xa4beea44);
+  MD5_STEP(MD5_H, md, ma, mb, mc, x[ 4], 11, 0x4bdecfa9);
+  MD5_STEP(MD5_H, mc, md, ma, mb, x[ 7], 16, 0xf6bb4b60);
+  MD5_STEP(MD5_H, mb, mc, md, ma, x[10], 23, 0xbebfbc70);
+  SHA1_STEP_X(SHA1_F3, sa, sb, sc, sd, se, 45, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, se, sa, sb, sc, sd, 46, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sd, se, sa, sb, sc, 47, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sc, sd, se, sa, sb, 48, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sb, sc, sd, se, sa, 49, 0x8f1bbcdc);
+
+  MD5_STEP(MD5_H, ma, mb, mc, md, x[13],  4, 0x289b7ec6);
+  MD5_STEP(MD5_H, md, ma, mb, mc, x[ 0], 11, 0xeaa127fa);
+  MD5_STEP(MD5_H, mc, md, ma, mb, x[ 3], 16, 0xd4ef3085);
+  MD5_STEP(MD5_H, mb, mc, md, ma, x[ 6], 23, 0x04881d05);
+  SHA1_STEP_X(SHA1_F3, sa, sb, sc, sd, se, 50, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, se, sa, sb, sc, sd, 51, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sd, se, sa, sb, sc, 52, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sc, sd, se, sa, sb, 53, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sb, sc, sd, se, sa, 54, 0x8f1bbcdc);
+
+  MD5_STEP(MD5_H, ma, mb, mc, md, x[ 9],  4, 0xd9d4d039);
+  MD5_STEP(MD5_H, md, ma, mb, mc, x[12], 11, 0xe6db99e5);
+  MD5_STEP(MD5_H, mc, md, ma, mb, x[15], 16, 0x1fa27cf8);
+  MD5_STEP(MD5_H, mb, mc, md, ma, x[ 2], 23, 0xc4ac5665);
+  SHA1_STEP_X(SHA1_F3, sa, sb, sc, sd, se, 55, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, se, sa, sb, sc, sd, 56, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sd, se, sa, sb, sc, 57, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sc, sd, se, sa, sb, 58, 0x8f1bbcdc);
+  SHA1_STEP_X(SHA1_F3, sb, sc, sd, se, sa, 59, 0x8f1bbcdc);
+
+  MD5_STEP(MD5_I, ma, mb, mc, md, x[ 0],  6, 0xf4292244);
+  MD5_STEP(MD5_I, md, ma, mb, mc, x[ 7], 10, 0x432aff97);
+  MD5_STEP(MD5_I, mc, md, ma, mb, x[14], 15, 0xab9423a7);
+  MD5_STEP(MD5_I, mb, mc, md, ma, x[ 5], 21, 0xfc93a039);
+  SHA1_STEP_X(SHA1_F2, sa, sb, sc, sd, se, 60, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, se, sa, sb, sc, sd, 61, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sd, se, sa, sb, sc, 62, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sc, sd, se, sa, sb, 63, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sb, sc, sd, se, sa, 64, 0xca62c1d6);
+
+  MD5_STEP(MD5_I, ma, mb, mc, md, x[12],  6, 0x655b59c3);
+  MD5_STEP(MD5_I, md, ma, mb, mc, x[ 3], 10, 0x8f0ccc92);
+  MD5_STEP(MD5_I, mc, md, ma, mb, x[10], 15, 0xffeff47d);
+  MD5_STEP(MD5_I, mb, mc, md, ma, x[ 1], 21, 0x85845dd1);
+  SHA1_STEP_X(SHA1_F2, sa, sb, sc, sd, se, 65, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, se, sa, sb, sc, sd, 66, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sd, se, sa, sb, sc, 67, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sc, sd, se, sa, sb, 68, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sb, sc, sd, se, sa, 69, 0xca62c1d6);
+
+  MD5_STEP(MD5_I, ma, mb, mc, md, x[ 8],  6, 0x6fa87e4f);
+  MD5_STEP(MD5_I, md, ma, mb, mc, x[15], 10, 0xfe2ce6e0);
+  MD5_STEP(MD5_I, mc, md, ma, mb, x[ 6], 15, 0xa3014314);
+  MD5_STEP(MD5_I, mb, mc, md, ma, x[13], 21, 0x4e0811a1);
+  SHA1_STEP_X(SHA1_F2, sa, sb, sc, sd, se, 70, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, se, sa, sb, sc, sd, 71, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sd, se, sa, sb, sc, 72, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sc, sd, se, sa, sb, 73, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sb, sc, sd, se, sa, 74, 0xca62c1d6);
+
+  MD5_STEP(MD5_I, ma, mb, mc, md, x[ 4],  6, 0xf7537e82);
+  MD5_STEP(MD5_I, md, ma, mb, mc, x[11], 10, 0xbd3af235);
+  MD5_STEP(MD5_I, mc, md, ma, mb, x[ 2], 15, 0x2ad7d2bb);
+  MD5_STEP(MD5_I, mb, mc, md, ma, x[ 9], 21, 0xeb86d391);
+  SHA1_STEP_X(SHA1_F2, sa, sb, sc, sd, se, 75, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, se, sa, sb, sc, sd, 76, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sd, se, sa, sb, sc, 77, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sc, sd, se, sa, sb, 78, 0xca62c1d6);
+  SHA1_STEP_X(SHA1_F2, sb, sc, sd, se, sa, 79, 0xca62c1d6);
+
+  context->md5[0] += ma;
+  context->md5[1] += mb;
+  context->md5[2] += mc;
+  context->md5[3] += md;
+  context->sha1[0] += sa;
+  context->sha1[1] += sb;
+  context->sha1[2] += sc;
+  context->sha1[3] += sd;
+  context->sha1[4] += se;
+}
+
+void
+svn__md5_sha1_init(svn__md5_sha1_ctx_t *context)
+{
+  context->md5[0] = 0x67452301;
+  context->md5[1] = 0xefcdab89;
+  context->md5[2] = 0x98badcfe;
+  context->md5[3] = 0x10325476;
+
+  context->sha1[0] = 0x67452301;
+  context->sha1[1] = 0xefcdab89;
+  context->sha1[2] = 0x98badcfe;
+  context->sha1[3] = 0x10325476;
+  context->sha1[4] = 0xc3d2e1f0;
+
+  context->length = 0;
+}
+
+void
+svn__md5_sha1_update(svn__md5_sha1_ctx_t *context,
+                     const void *data,
+                     apr_size_t len)
+{
+  const unsigned char *input = data;
+  apr_size_t buffered = (apr_size_t)(context->length % 64);
+
+  context->length += len;
+
+  /* Complete the partial block from previous calls first. */
+  if (buffered)
+    {
+      apr_size_t to_copy = 64 - buffered;
+      if (to_copy > len)
+        to_copy = len;
+
+      memcpy(context->buffer + buffered, input, to_copy);
+      input += to_copy;
+      len -= to_copy;
+
+      if (buffered + to_copy < 64)
+        return;
+
+      process_block(context, context->buffer, context->buffer);
+    }
+
+  /* Process full blocks directly from the input. */
+  for (; len >= 64; input += 64, len -= 64)
+    process_block(context, input, input);
+
+  /* Keep the remainder for later. */
+  memcpy(context->buffer, input, len);
+}
+
+void
+svn__md5_sha1_final(unsigned char md5_digest[SVN__MD5_DIGEST_SIZE],
+                    unsigned char sha1_digest[SVN__SHA1_DIGEST_SIZE],
+                    const svn__md5_sha1_ctx_t *context)
+{
+  svn__md5_sha1_ctx_t final = *context;
+  unsigned char md5_block[64];
+  unsigned char sha1_block[64];
+  apr_size_t buffered = (apr_size_t)(context->length % 64);
+  apr_uint64_t bits = context->length * 8;
+  int i;
+
+  /* Both algorithms append a single 1 bit, pad with zeros up to the
+   * last 8 bytes of a block and put the message length in bits there. */
+  memcpy(md5_block, context->buffer, buffered);
+  md5_block[buffered] = 0x80;
+  memset(md5_block + buffered + 1, 0, 63 - buffered);
+
+  /* The length may not fit into this block anymore. */
+  if (buffered >= 56)
+    {
+      process_block(&final, md5_block, md5_block);
+      memset(md5_block, 0, 64);
+    }
+
+  memcpy(sha1_block, md5_block, 56);
+  for (i = 0; i < 8; ++i)
+    {
+      md5_block[56 + i] = (unsigned char)(bits >> (8 * i));
+      sha1_block[63 - i] = (unsigned char)(bits >> (8 * i));
+    }
+
+  process_block(&final, md5_block, sha1_block);
+
+  /* MD5 produces little endian words, SHA-1 big endian ones. */
+  for (i = 0; i < 4; ++i)
+    {
+      md5_digest[4 * i] = (unsigned char)final.md5[i];
+      md5_digest[4 * i + 1] = (unsigned char)(final.md5[i] >> 8);
+      md5_digest[4 * i + 2] = (unsigned char)(final.md5[i] >> 16);
+      md5_digest[4 * i + 3] = (unsigned char)(final.md5[i] >> 24);
+    }
+
+  for (i = 0; i < 5; ++i)
+    {
+      sha1_digest[4 * i] = (unsigned char)(final.sha1[i] >> 24);
+      sha1_digest[4 * i + 1] = (unsigned char)(final.sha1[i] >> 16);
+      sha1_digest[4 * i + 2] = (unsigned char)(final.sha1[i] >> 8);
+      sha1_digest[4 * i + 3] = (unsigned char)final.sha1[i];
+    }
+}
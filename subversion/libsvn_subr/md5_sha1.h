@@ -0,0 +1,81 @@
+/*
+ * md5_sha1.h :  calculate MD5 and SHA-1 checksums in a single pass
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_SUBR_MD5_SHA1_H
+#define SVN_LIBSVN_SUBR_MD5_SHA1_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Size of the MD5 and SHA-1 digests in bytes. */
+#define SVN__MD5_DIGEST_SIZE 16
+#define SVN__SHA1_DIGEST_SIZE 20
+
+/* Context for calculating the MD5 and the SHA-1 checksum over the same
+ * data.  Both algorithms process 64 byte blocks and use the same padding.
+ * Their rounds get interleaved, so that the CPU can execute the two
+ * otherwise strictly sequential chains of operations in parallel.
+ */
+typedef struct svn__md5_sha1_ctx_t
+{
+  /* Intermediate hash values. */
+  apr_uint32_t md5[4];
+  apr_uint32_t sha1[5];
+
+  /* Total number of bytes fed into the context. */
+  apr_uint64_t length;
+
+  /* Data of the incomplete last block. (LENGTH % 64) bytes are valid. */
+  unsigned char buffer[64];
+} svn__md5_sha1_ctx_t;
+
+/* Reset CONTEXT to the initial state.
+ */
+void
+svn__md5_sha1_init(svn__md5_sha1_ctx_t *context);
+
+/* Feed LEN bytes from DATA into CONTEXT.
+ */
+void
+svn__md5_sha1_update(svn__md5_sha1_ctx_t *context,
+                     const void *data,
+                     apr_size_t len);
+
+/* Write the MD5 and SHA-1 digests over all data fed into CONTEXT to
+ * MD5_DIGEST and SHA1_DIGEST, respectively.  CONTEXT remains unchanged.
+ */
+void
+svn__md5_sha1_final(unsigned char md5_digest[SVN__MD5_DIGEST_SIZE],
+                    unsigned char sha1_digest[SVN__SHA1_DIGEST_SIZE],
+                    const svn__md5_sha1_ctx_t *context);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_SUBR_MD5_SHA1_H */
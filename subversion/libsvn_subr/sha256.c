@@ -0,0 +1,466 @@
+/*
+ * sha256.c :  SHA-256 checksum routines
+ *
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+#include <apr.h>
+
+#include "private/svn_atomic.h"
+#include "sha256.h"
+
+/* SHA-256 is specified in FIPS 180-4.  Besides the portable implementation,
+ * we provide variants using the SHA extensions of x86 and ARMv8 CPUs.
+ * All of them process whole 64 byte blocks; buffering and padding is
+ * done by the shared code at the end of this file.
+ *
+ * On x86, we need compiler support for code that targets instruction sets
+ * not enabled for the whole build and select the implementation at runtime.
+ * On ARM, we only use the crypto extensions if they are enabled for the
+ * whole build, e.g. via -march=armv8-a+crypto.  SHA256_TARGET(isa) enables
+ * ISA for the following function.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && (__GNUC__ >= 5 || defined(__clang__))
+#  define SHA256_X86
+#  define SHA256_TARGET(isa) __attribute__((target(isa)))
+#  include <cpuid.h>
+#  include <immintrin.h>
+#elif defined(_MSC_VER) && _MSC_VER >= 1900 \
+      && (defined(_M_X64) || defined(_M_IX86))
+#  define SHA256_X86
+#  define SHA256_TARGET(isa)
+#  include <intrin.h>
+#  include <immintrin.h>
+#elif defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)
+#  define SHA256_ARM
+#  include <arm_neon.h>
+#endif
+
+/* Size of the blocks that the compression function processes. */
+#define BLOCK_SIZE 64
+
+/* Round constants. */
+static const apr_uint32_t K[64] =
+{
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+  0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+  0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+  0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+  0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/* Initial hash value. */
+static const apr_uint32_t H0[8] =
+{
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+/* Signature of the compression functions.  Update STATE with the COUNT
+ * blocks of BLOCK_SIZE bytes each starting at DATA.
+ */
+typedef void (*compress_func_t)(apr_uint32_t state[8],
+                                const unsigned char *data,
+                                apr_size_t count);
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define SIGMA0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define SIGMA1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define sigma0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define sigma1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+/* Implements compress_func_t in portable C. */
+static void
+compress_portable(apr_uint32_t state[8],
+                  const unsigned char *data,
+                  apr_size_t count)
+{
+  for (; count > 0; --count, data += BLOCK_SIZE)
+    {
+      apr_uint32_t w[64];
+      apr_uint32_t a, b, c, d, e, f, g, h;
+      int i;
+
+      for (i = 0; i < 16; ++i)
+        w[i] = ((apr_uint32_t)data[4 * i] << 24)
+             | ((apr_uint32_t)data[4 * i + 1] << 16)
+             | ((apr_uint32_t)data[4 * i + 2] << 8)
+             | (apr_uint32_t)data[4 * i + 3];
+      for (; i < 64; ++i)
+        w[i] = sigma1(w[i - 2]) + w[i - 7] + sigma0(w[i - 15]) + w[i - 16];
+
+      a = state[0];
+      b = state[1];
+      c = state[2];
+      d = state[3];
+      e = state[4];
+      f = state[5];
+      g = state[6];
+      h = state[7];
+
+      for (i = 0; i < 64; ++i)
+        {
+          apr_uint32_t t1 = h + SIGMA1(e) + CH(e, f, g) + K[i] + w[i];
+          apr_uint32_t t2 = SIGMA0(a) + MAJ(a, b, c);
+
+          h = g;
+          g = f;
+          f = e;
+          e = d + t1;
+          d = c;
+          c = b;
+          b = a;
+          a = t1 + t2;
+        }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+      state[5] += f;
+      state[6] += g;
+      state[7] += h;
+    }
+}
+
+#ifdef SHA256_X86
+
+/* Implements compress_func_t using the x86 SHA extensions.
+ *
+ * The SHA256RNDS2 instruction expects the state as ABEF and CDGH vectors
+ * and performs two rounds per call.  SHA256MSG1 and SHA256MSG2 compute
+ * the message schedule four words at a time.
+ */
+SHA256_TARGET("sha,sse4.1")
+static void
+compress_x86(apr_uint32_t state[8],
+             const unsigned char *data,
+             apr_size_t count)
+{
+  const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bLL,
+                                           0x0405060700010203LL);
+  __m128i state0, state1, tmp;
+
+  /* Convert the state from ABCD, EFGH to ABEF, CDGH. */
+  tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]),
+                          0xb1);
+  state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]),
+                             0x1b);
+  state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+  for (; count > 0; --count, data += BLOCK_SIZE)
+    {
+      const __m128i abef = state0;
+      const __m128i cdgh = state1;
+      __m128i w[4];
+      int i;
+
+      for (i = 0; i < 16; ++i)
+        {
+          __m128i msg;
+
+          /* The next 4 words of the message schedule. */
+          if (i < 4)
+            w[i] = _mm_shuffle_epi8(
+                     _mm_loadu_si128((const __m128i *)(data + 16 * i)),
+                     byte_swap);
+          else
+            w[i & 3] = _mm_sha256msg2_epu32(
+                         _mm_add_epi32(
+                           _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]),
+                           _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3],
+                                           4)),
+                         w[(i + 3) & 3]);
+
+          /* 4 rounds. */
+          msg = _mm_add_epi32(w[i & 3],
+                              _mm_loadu_si128((const __m128i *)&K[4 * i]));
+          state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+          state0 = _mm_sha256rnds2_epu32(state0, state1,
+                                         _mm_shuffle_epi32(msg, 0x0e));
+        }
+
+      state0 = _mm_add_epi32(state0, abef);
+      state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+  /* Convert back to ABCD, EFGH. */
+  tmp = _mm_shuffle_epi32(state0, 0x1b);
+  state1 = _mm_shuffle_epi32(state1, 0xb1);
+  state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+  state1 = _mm_alignr_epi8(state1, tmp, 8);
+  _mm_storeu_si128((__m128i *)&state[0], state0);
+  _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+
+#endif /* SHA256_X86 */
+
+#ifdef SHA256_ARM
+
+/* Implements compress_func_t using the ARMv8 crypto extensions.
+ */
+static void
+compress_arm(apr_uint32_t state[8],
+             const unsigned char *data,
+             apr_size_t count)
+{
+  uint32x4_t state0 = vld1q_u32(&state[0]);
+  uint32x4_t state1 = vld1q_u32(&state[4]);
+
+  for (; count > 0; --count, data += BLOCK_SIZE)
+    {
+      const uint32x4_t abcd = state0;
+      const uint32x4_t efgh = state1;
+      uint32x4_t w[4];
+      int i;
+
+      for (i = 0; i < 16; ++i)
+        {
+          uint32x4_t msg, tmp;
+
+          /* The next 4 words of the message schedule. */
+          if (i < 4)
+            w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+          else
+            w[i & 3] = vsha256su1q_u32(vsha256su0q_u32(w[i & 3],
+                                                       w[(i + 1) & 3]),
+                                       w[(i + 2) & 3], w[(i + 3) & 3]);
+
+          /* 4 rounds. */
+          msg = vaddq_u32(w[i & 3], vld1q_u32(&K[4 * i]));
+          tmp = state0;
+          state0 = vsha256hq_u32(state0, state1, msg);
+          state1 = vsha256h2q_u32(state1, tmp, msg);
+        }
+
+      state0 = vaddq_u32(state0, abcd);
+      state1 = vaddq_u32(state1, efgh);
+    }
+
+  vst1q_u32(&state[0], state0);
+  vst1q_u32(&state[4], state1);
+}
+
+#endif /* SHA256_ARM */
+
+/* The compression function to use. */
+#if defined(SHA256_ARM)
+static compress_func_t compress = compress_arm;
+#else
+static compress_func_t compress = compress_portable;
+#endif
+
+#ifdef SHA256_X86
+
+/* Initialization state of COMPRESS as used by svn_atomic__init_once. */
+static volatile svn_atomic_t compress_initialized = 0;
+
+/* Implements svn_atomic__str_init_func_t.
+ * Use the SHA extensions for COMPRESS if the CPU supports them.
+ */
+static const char *
+select_compress(void *baton)
+{
+  unsigned int max_leaf, sha, sse41;
+#ifdef _MSC_VER
+  int info[4];
+
+  __cpuid(info, 0);
+  max_leaf = info[0];
+  if (max_leaf < 7)
+    return NULL;
+
+  __cpuid(info, 1);
+  sse41 = info[2] & (1 << 19);
+  __cpuidex(info, 7, 0);
+  sha = info[1] & (1 << 29);
+#else
+  unsigned int eax, ebx, ecx, edx;
+
+  max_leaf = __get_cpuid_max(0, NULL);
+  if (max_leaf < 7)
+    return NULL;
+
+  __cpuid(1, eax, ebx, ecx, edx);
+  sse41 = ecx & bit_SSE4_1;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  sha = ebx & (1 << 29);
+#endif
+
+  if (sha && sse41)
+    compress = compress_x86;
+
+  return NULL;
+}
+
+#endif /* SHA256_X86 */
+
+/* Return the fastest compression function available. */
+static compress_func_t
+get_compress_func(void)
+{
+#ifdef SHA256_X86
+  svn_atomic__init_once_no_error(&compress_initialized, select_compress,
+                                 NULL);
+#endif
+
+  return compress;
+}
+
+struct svn_sha256__context_t
+{
+  /* Intermediate hash value. */
+  apr_uint32_t state[8];
+
+  /* Total number of bytes fed into the context so far. */
+  apr_uint64_t length;
+
+  /* Data not processed yet because it does not fill a whole block.
+   * The number of bytes used is LENGTH % BLOCK_SIZE. */
+  unsigned char buffer[BLOCK_SIZE];
+
+  /* The compression function to use. */
+  compress_func_t compress;
+};
+
+svn_sha256__context_t *
+svn_sha256__context_create(apr_pool_t *pool)
+{
+  svn_sha256__context_t *context = apr_palloc(pool, sizeof(*context));
+  svn_sha256__context_reset(context);
+
+  return context;
+}
+
+void
+svn_sha256__context_reset(svn_sha256__context_t *context)
+{
+  memcpy(context->state, H0, sizeof(H0));
+  context->length = 0;
+  context->compress = get_compress_func();
+}
+
+void
+svn_sha256__update(svn_sha256__context_t *context,
+                   const void *data,
+                   apr_size_t len)
+{
+  const unsigned char *input = data;
+  apr_size_t buffered = (apr_size_t)(context->length % BLOCK_SIZE);
+
+  context->length += len;
+
+  /* Complete a partially filled block. */
+  if (buffered)
+    {
+      apr_size_t to_copy = BLOCK_SIZE - buffered;
+      if (to_copy > len)
+        to_copy = len;
+
+      memcpy(context->buffer + buffered, input, to_copy);
+      input += to_copy;
+      len -= to_copy;
+
+      if (buffered + to_copy < BLOCK_SIZE)
+        return;
+
+      context->compress(context->state, context->buffer, 1);
+    }
+
+  /* Process all whole blocks directly from DATA. */
+  if (len >= BLOCK_SIZE)
+    {
+      context->compress(context->state, input, len / BLOCK_SIZE);
+      input += len - len % BLOCK_SIZE;
+      len %= BLOCK_SIZE;
+    }
+
+  /* Keep the remainder for later. */
+  if (len)
+    memcpy(context->buffer, input, len);
+}
+
+void
+svn_sha256__finalize(unsigned char digest[SVN__SHA256_DIGESTSIZE],
+                     const svn_sha256__context_t *context)
+{
+  apr_uint32_t state[8];
+  unsigned char buffer[BLOCK_SIZE];
+  apr_uint64_t bit_length = context->length * 8;
+  apr_size_t buffered = (apr_size_t)(context->length % BLOCK_SIZE);
+  int i;
+
+  /* Pad a copy of the context such that more data may be added later. */
+  memcpy(state, context->state, sizeof(state));
+  memcpy(buffer, context->buffer, buffered);
+
+  /* Append the 0x80 terminator, zero padding and the big-endian 64 bit
+   * message length in bits. */
+  buffer[buffered++] = 0x80;
+  if (buffered > BLOCK_SIZE - 8)
+    {
+      memset(buffer + buffered, 0, BLOCK_SIZE - buffered);
+      context->compress(state, buffer, 1);
+      buffered = 0;
+    }
+
+  memset(buffer + buffered, 0, BLOCK_SIZE - 8 - buffered);
+  for (i = 0; i < 8; ++i)
+    buffer[BLOCK_SIZE - 1 - i] = (unsigned char)(bit_length >> (8 * i));
+  context->compress(state, buffer, 1);
+
+  for (i = 0; i < 8; ++i)
+    {
+      digest[4 * i] = (unsigned char)(state[i] >> 24);
+      digest[4 * i + 1] = (unsigned char)(state[i] >> 16);
+      digest[4 * i + 2] = (unsigned char)(state[i] >> 8);
+      digest[4 * i + 3] = (unsigned char)state[i];
+    }
+}
+
+void
+svn__sha256(unsigned char digest[SVN__SHA256_DIGESTSIZE],
+            const void *input,
+            apr_size_t len)
+{
+  svn_sha256__context_t context;
+
+  svn_sha256__context_reset(&context);
+  svn_sha256__update(&context, input, len);
+  svn_sha256__finalize(digest, &context);
+}
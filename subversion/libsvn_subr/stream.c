@@ -63,6 +63,7 @@ struct svn_stream_t {
   svn_stream_data_available_fn_t data_available_fn;
   svn_stream_readline_fn_t readline_fn;
   apr_file_t *file; /* Maybe NULL */
+  apr_off_t file_end; /* End of the data within FILE or -1 for EOF */
 };
 
 
@@ -81,6 +82,7 @@ svn_stream_create(void *baton, apr_pool_t *pool)
 
   stream = apr_pcalloc(pool, sizeof(*stream));
   stream->baton = baton;
+  stream->file_end = -1;
   return stream;
 }
 
@@ -1125,6 +1127,103 @@ svn_stream__aprfile(svn_stream_t *stream)
   return stream->file;
 }
 
+apr_off_t
+svn_stream__aprfile_end(svn_stream_t *stream)
+{
+  return stream->file_end;
+}
+
+void
+svn_stream__set_aprfile(svn_stream_t *stream,
+                        apr_file_t *file,
+                        apr_off_t end)
+{
+  stream->file = file;
+  stream->file_end = end;
+}
+
+
+/*** Read-only streams for a section of an APR file ***/
+struct baton_apr_range {
+  apr_file_t *file;
+  apr_pool_t *pool;
+
+  /* Number of bytes left in the section. */
+  apr_off_t remaining;
+};
+
+static svn_error_t *
+read_full_handler_apr_range(void *baton, char *buffer, apr_size_t *len)
+{
+  struct baton_apr_range *btn = baton;
+  svn_boolean_t eof;
+
+  if ((apr_off_t)*len > btn->remaining)
+    *len = (apr_size_t)btn->remaining;
+
+  if (*len == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_io_file_read_full2(btn->file, buffer, *len, len, &eof,
+                                 btn->pool));
+  btn->remaining -= *len;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+skip_handler_apr_range(void *baton, apr_size_t len)
+{
+  struct baton_apr_range *btn = baton;
+  apr_off_t offset = (apr_off_t)len > btn->remaining
+                   ? btn->remaining
+                   : (apr_off_t)len;
+
+  btn->remaining -= offset;
+  return svn_error_trace(
+            svn_io_file_seek(btn->file, APR_CUR, &offset, btn->pool));
+}
+
+static svn_error_t *
+close_handler_apr_range(void *baton)
+{
+  struct baton_apr_range *btn = baton;
+
+  return svn_error_trace(svn_io_file_close(btn->file, btn->pool));
+}
+
+svn_error_t *
+svn_stream__from_aprfile_range(svn_stream_t **stream,
+                               apr_file_t *file,
+                               apr_off_t start,
+                               apr_off_t end,
+                               svn_boolean_t disown,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool)
+{
+  struct baton_apr_range *baton;
+  apr_off_t offset = start;
+
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+
+  baton = apr_palloc(result_pool, sizeof(*baton));
+  baton->file = file;
+  baton->pool = result_pool;
+  baton->remaining = end - start;
+
+  *stream = svn_stream_create(baton, result_pool);
+  svn_stream_set_read2(*stream, NULL /* only full read support */,
+                       read_full_handler_apr_range);
+  svn_stream_set_skip(*stream, skip_handler_apr_range);
+  (*stream)->file = file;
+  (*stream)->file_end = end;
+
+  if (! disown)
+    svn_stream_set_close(*stream, close_handler_apr_range);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* Compressed stream support */
 
@@ -1358,6 +1457,193 @@ svn_stream_compressed(svn_stream_t *stream, apr_pool_t *pool)
   return zstream;
 }
 
+
+/* LZ4 compressed stream support */
+
+/* Amount of uncompressed data per LZ4 block.  This matches LZ4's window
+   size, i.e. larger blocks would not improve the compression ratio much. */
+#define LZ4_BLOCK_SIZE 0x10000
+
+/* Upper limit for the size of a single compressed block including its
+   headers.  Anything larger indicates corrupted data. */
+#define LZ4_MAX_FRAME_SIZE (2 * LZ4_BLOCK_SIZE)
+
+struct lz4baton {
+  svn_stream_t *substream;      /* The substream */
+  svn_stringbuf_t *block;       /* Uncompressed data of the current block */
+  apr_size_t read_pos;          /* Offset of the next byte to read from
+                                   BLOCK */
+  svn_stringbuf_t *frame;       /* Buffer for compressed data */
+  svn_boolean_t reading;        /* Data has been read from this stream */
+  svn_boolean_t eof;            /* No more blocks in the substream */
+};
+
+/* Compress the data in BTN->BLOCK and write it as a new block to the
+   substream of BTN. */
+static svn_error_t *
+write_block_lz4(struct lz4baton *btn)
+{
+  unsigned char header[SVN__MAX_ENCODED_UINT_LEN];
+  apr_size_t len;
+
+  SVN_ERR(svn__compress_lz4(btn->block->data, btn->block->len, btn->frame));
+
+  len = svn__encode_uint(header, btn->frame->len) - header;
+  SVN_ERR(svn_stream_write(btn->substream, (const char *)header, &len));
+  len = btn->frame->len;
+  SVN_ERR(svn_stream_write(btn->substream, btn->frame->data, &len));
+
+  svn_stringbuf_setempty(btn->block);
+  return SVN_NO_ERROR;
+}
+
+/* Read the next block from the substream of BTN and decompress it into
+   BTN->BLOCK.  Set BTN->EOF when the end of the substream is reached. */
+static svn_error_t *
+read_block_lz4(struct lz4baton *btn)
+{
+  unsigned char header[SVN__MAX_ENCODED_UINT_LEN];
+  apr_uint64_t frame_len = 0;
+  apr_size_t header_len;
+  apr_size_t len;
+
+  svn_stringbuf_setempty(btn->block);
+  btn->read_pos = 0;
+
+  /* Read the variable-length frame size one byte at a time. */
+  for (header_len = 0; header_len < sizeof(header); ++header_len)
+    {
+      len = 1;
+      SVN_ERR(svn_stream_read_full(btn->substream,
+                                   (char *)&header[header_len], &len));
+      if (len == 0)
+        {
+          if (header_len == 0)
+            {
+              btn->eof = TRUE;
+              return SVN_NO_ERROR;
+            }
+
+          break;
+        }
+
+      if (header[header_len] < 0x80)
+        {
+          svn__decode_uint(&frame_len, header, header + header_len + 1);
+          break;
+        }
+    }
+
+  if (frame_len == 0 || frame_len > LZ4_MAX_FRAME_SIZE)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Invalid block header in LZ4 compressed "
+                              "stream"));
+
+  svn_stringbuf_ensure(btn->frame, (apr_size_t)frame_len);
+  len = (apr_size_t)frame_len;
+  SVN_ERR(svn_stream_read_full(btn->substream, btn->frame->data, &len));
+  if (len != frame_len)
+    return svn_error_create(SVN_ERR_SVNDIFF_INVALID_COMPRESSED_DATA, NULL,
+                            _("Unexpected end of LZ4 compressed stream"));
+
+  btn->frame->len = len;
+  return svn_error_trace(svn__decompress_lz4(btn->frame->data,
+                                             btn->frame->len,
+                                             btn->block, LZ4_BLOCK_SIZE));
+}
+
+/* Handle reading from an LZ4 compressed stream */
+static svn_error_t *
+read_handler_lz4(void *baton, char *buffer, apr_size_t *len)
+{
+  struct lz4baton *btn = baton;
+  apr_size_t remaining = *len;
+
+  btn->reading = TRUE;
+  while (remaining > 0)
+    {
+      apr_size_t to_copy;
+
+      if (btn->read_pos == btn->block->len)
+        {
+          if (btn->eof)
+            break;
+
+          SVN_ERR(read_block_lz4(btn));
+          continue;
+        }
+
+      to_copy = MIN(remaining, btn->block->len - btn->read_pos);
+      memcpy(buffer, btn->block->data + btn->read_pos, to_copy);
+      btn->read_pos += to_copy;
+      buffer += to_copy;
+      remaining -= to_copy;
+    }
+
+  *len -= remaining;
+  return SVN_NO_ERROR;
+}
+
+/* Compress data in blocks and write them to the substream */
+static svn_error_t *
+write_handler_lz4(void *baton, const char *buffer, apr_size_t *len)
+{
+  struct lz4baton *btn = baton;
+  apr_size_t remaining = *len;
+
+  while (remaining > 0)
+    {
+      apr_size_t to_copy = MIN(remaining,
+                               LZ4_BLOCK_SIZE - btn->block->len);
+
+      svn_stringbuf_appendbytes(btn->block, buffer, to_copy);
+      buffer += to_copy;
+      remaining -= to_copy;
+
+      if (btn->block->len == LZ4_BLOCK_SIZE)
+        SVN_ERR(write_block_lz4(btn));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Flush the last block, if any, and close the substream */
+static svn_error_t *
+close_handler_lz4(void *baton)
+{
+  struct lz4baton *btn = baton;
+
+  /* Only a stream that has been written to has pending data.  After
+     reading, BLOCK holds decompressed data that must not be written. */
+  if (!btn->reading && btn->block->len > 0)
+    SVN_ERR(write_block_lz4(btn));
+
+  return svn_error_trace(svn_stream_close(btn->substream));
+}
+
+
+svn_stream_t *
+svn_stream__lz4_compressed(svn_stream_t *stream, apr_pool_t *pool)
+{
+  struct svn_stream_t *lz4stream;
+  struct lz4baton *baton;
+
+  assert(stream != NULL);
+
+  baton = apr_pcalloc(pool, sizeof(*baton));
+  baton->substream = stream;
+  baton->block = svn_stringbuf_create_ensure(LZ4_BLOCK_SIZE, pool);
+  baton->frame = svn_stringbuf_create_empty(pool);
+
+  lz4stream = svn_stream_create(baton, pool);
+  svn_stream_set_read2(lz4stream, NULL /* only full read support */,
+                       read_handler_lz4);
+  svn_stream_set_write(lz4stream, write_handler_lz4);
+  svn_stream_set_close(lz4stream, close_handler_lz4);
+
+  return lz4stream;
+}
+
 
 /* Checksummed stream support */
 
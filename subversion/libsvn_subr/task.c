@@ -24,9 +24,14 @@
 
 #include <assert.h>
 
+#include <apr_thread_proc.h>
+
 #include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
 #include "private/svn_thread_cond.h"
 
+#include "svn_private_config.h"
+
 
 /* Top of the task tree.
  *
@@ -65,6 +70,22 @@ typedef struct root_t
   svn_task__thread_context_constructor_t context_constructor;
   void *context_baton;
 
+  /* Serializes all modifications to the task tree as well as all
+   * allocations from TASK_POOL.  NULL for single-threaded execution. */
+  svn_mutex__t *mutex;
+
+  /* Signalled whenever new tasks have become ready for processing or when
+   * the workers shall terminate.  NULL for single-threaded execution. */
+  svn_thread_cond__t *worker_wakeup;
+
+  /* Signalled whenever a worker finished processing a task.
+   * NULL for single-threaded execution. */
+  svn_thread_cond__t *task_processed;
+
+  /* Set, if the worker threads shall exit as soon as possible.
+   * Only to be accessed while holding MUTEX. */
+  svn_boolean_t terminate;
+
 } root_t;
 
 /* Sub-structure of svn_task__t containing that task's processing output.
@@ -308,6 +329,9 @@ static svn_error_t *alloc_callbacks(callbacks_t **result, apr_pool_t *pool)
  * to eventually be picked up by the task runner, i.e. execution is fully
  * controlled by the execution model and sub-tasks may only be added when
  * the new task itself is being processed.
+ *
+ * In multi-threaded environments, calls to this must be serialized with
+ * root_t changes.
  */
 static svn_error_t *add_task(
   svn_task__t *parent,
@@ -344,10 +368,21 @@ static svn_error_t *add_task(
 
   SVN_ERR(link_new_task(new_task));
 
+  /* Idle workers may pick up the new task now. */
+  if (parent->root->worker_wakeup)
+    SVN_ERR(svn_thread_cond__signal(parent->root->worker_wakeup));
+
   return SVN_NO_ERROR;
 }
 
-svn_error_t *svn_task__add(
+/* Allocate a new callbacks structure for PROCESS_FUNC, OUTPUT_FUNC and
+ * OUTPUT_BATON and pass it to add_task() together with the CURRENT,
+ * PROCESS_POOL, PARTIAL_OUTPUT and PROCESS_BATON parameters.
+ *
+ * In multi-threaded environments, calls to this must be serialized with
+ * root_t changes.
+ */
+static svn_error_t *add_task_with_callbacks(
   svn_task__t *current,
   apr_pool_t *process_pool,
   void *partial_output,
@@ -367,19 +402,42 @@ svn_error_t *svn_task__add(
                                   callbacks, process_baton));
 }
 
+svn_error_t *svn_task__add(
+  svn_task__t *current,
+  apr_pool_t *process_pool,
+  void *partial_output,
+  svn_task__process_func_t process_func,
+  void *process_baton,
+  svn_task__output_func_t output_func,
+  void *output_baton)
+{
+  SVN_MUTEX__WITH_LOCK(current->root->mutex,
+                       add_task_with_callbacks(current, process_pool,
+                                               partial_output,
+                                               process_func, process_baton,
+                                               output_func, output_baton));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t* svn_task__add_similar(
   svn_task__t* current,
   apr_pool_t *process_pool,
   void* partial_output,
   void* process_baton)
 {
-  return svn_error_trace(add_task(current, process_pool, partial_output,
-                                  current->callbacks, process_baton));
+  SVN_MUTEX__WITH_LOCK(current->root->mutex,
+                       add_task(current, process_pool, partial_output,
+                                current->callbacks, process_baton));
+
+  return SVN_NO_ERROR;
 }
 
 apr_pool_t *svn_task__create_process_pool(
   svn_task__t *parent)
 {
+  /* ROOT->PROCESS_POOL uses a thread-safe allocator in multi-threaded
+   * execution.  Creating sub-pools does not need further serialization. */
   return svn_pool_create(parent->root->process_pool);
 }
 
@@ -545,11 +603,43 @@ static void process(svn_task__t *task,
   svn_pool_destroy(task->process_pool);
 }
 
+/* Call CALLBACKS->OUTPUT_FUNC for TASK with the given OUTPUT.
+ *
+ * In multi-threaded execution, the caller must hold the ROOT->MUTEX.
+ * It will be released during the callback such that workers may continue
+ * processing and the output function itself may add new sub-tasks.
+ *
+ * Pass CANCEL_FUNC, CANCEL_BATON, RESULT_POOL and SCRATCH_POOL to the
+ * output function.
+ */
+static svn_error_t *call_output_func(
+  svn_task__t *task,
+  void *output,
+  callbacks_t *callbacks,
+  svn_cancel_func_t cancel_func,
+  void *cancel_baton,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool)
+{
+  svn_mutex__t *mutex = task->root->mutex;
+  svn_error_t *err;
+
+  SVN_ERR(svn_mutex__unlock(mutex, SVN_NO_ERROR));
+  err = callbacks->output_func(task, output, callbacks->output_baton,
+                               cancel_func, cancel_baton,
+                               result_pool, scratch_pool);
+
+  return svn_error_compose_create(err, svn_mutex__lock(mutex));
+}
+
 /* Output *TASK results in post-order until we encounter a task that has not
  * been processed, yet - which may be *TASK itself - and return it in *TASK.
  *
  * Pass CANCEL_FUNC, CANCEL_BATON and RESULT_POOL into the respective task
  * output functions.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * In multi-threaded execution, the caller must hold the ROOT->MUTEX.
+ * It will be held upon return as well, even in case of an error.
  */  
 static svn_error_t *output_processed(
   svn_task__t **task,
@@ -588,11 +678,11 @@ static svn_error_t *output_processed(
            * sub-tasks.  Also note that PRIOR_PARENT_OUTPUT not being NULL
            * implies that OUTPUT_FUNC is also not NULL. */
           if (results && results->prior_parent_output)
-            SVN_ERR(callbacks->output_func(
-                        current->parent, results->prior_parent_output,
-                        callbacks->output_baton,
-                        cancel_func, cancel_baton,
-                        result_pool, iterpool));
+            SVN_ERR(call_output_func(current->parent,
+                                     results->prior_parent_output,
+                                     callbacks,
+                                     cancel_func, cancel_baton,
+                                     result_pool, iterpool));
         }
       else
         {
@@ -609,11 +699,10 @@ static svn_error_t *output_processed(
               /* Handle remaining output of the CURRENT task. */
               callbacks = current->callbacks;
               if (results->output)
-                SVN_ERR(callbacks->output_func(
-                            current, results->output,
-                            callbacks->output_baton,
-                            cancel_func, cancel_baton,
-                            result_pool, iterpool));
+                SVN_ERR(call_output_func(current, results->output,
+                                         callbacks,
+                                         cancel_func, cancel_baton,
+                                         result_pool, iterpool));
             }
 
           /* The output function may have added further sub-tasks.
@@ -701,6 +790,208 @@ static svn_error_t *execute_serially(
 }
 
 
+#if APR_HAS_THREADS
+
+/* Per-thread data of a worker used in execute_concurrently().
+ */
+typedef struct worker_t
+{
+  /* The task tree that we work on. */
+  root_t *root;
+
+  /* APR thread handle. */
+  apr_thread_t *thread;
+
+  /* Thread-specific context as returned by ROOT->CONTEXT_CONSTRUCTOR. */
+  void *thread_context;
+
+  /* Root pool of this worker, using an unsynchronized allocator.
+   * Holds THREAD_CONTEXT and is only used by this worker's thread. */
+  apr_pool_t *pool;
+
+  /* Cancellation callback to pass into the process functions. */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* Internal, i.e. synchronization, error that terminated this worker.
+   * Errors returned by process functions will be reported through the
+   * task tree instead. */
+  svn_error_t *error;
+
+} worker_t;
+
+/* Process tasks of WORKER->ROOT until its TERMINATE flag gets set.
+ */
+static svn_error_t *worker_loop(worker_t *worker)
+{
+  root_t *root = worker->root;
+  apr_pool_t *iterpool = svn_pool_create(worker->pool);
+
+  SVN_ERR(svn_mutex__lock(root->mutex));
+  while (!root->terminate)
+    {
+      svn_task__t *task = root->task->first_ready;
+      if (!task)
+        {
+          /* Nothing to do right now.  Wait for new sub-tasks to be added
+           * or for the whole execution to terminate. */
+          SVN_ERR(svn_thread_cond__wait(root->worker_wakeup, root->mutex));
+          continue;
+        }
+
+      /* Take ownership of TASK and process it without holding the mutex.
+       * The process function may add sub-tasks, taking the mutex itself. */
+      unready_task(task);
+      SVN_ERR(svn_mutex__unlock(root->mutex, SVN_NO_ERROR));
+
+      svn_pool_clear(iterpool);
+      process(task, worker->thread_context,
+              worker->cancel_func, worker->cancel_baton, iterpool);
+
+      /* Hand the results over to the output thread. */
+      SVN_ERR(svn_mutex__lock(root->mutex));
+      set_processed(task);
+      SVN_ERR(svn_thread_cond__signal(root->task_processed));
+    }
+
+  SVN_ERR(svn_mutex__unlock(root->mutex, SVN_NO_ERROR));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread entry function for a worker.  DATA is the worker_t.
+ */
+static void * APR_THREAD_FUNC
+worker_thread(apr_thread_t *thread, void *data)
+{
+  worker_t *worker = data;
+
+  worker->error = worker_loop(worker);
+  if (worker->error)
+    {
+      /* This is fatal for the whole execution as we will not pick up any
+       * further tasks in this thread.  Make sure the main thread notices. */
+      root_t *root = worker->root;
+      svn_error_clear(svn_mutex__lock(root->mutex));
+      root->terminate = TRUE;
+      svn_error_clear(svn_thread_cond__broadcast(root->task_processed));
+      svn_error_clear(svn_mutex__unlock(root->mutex, SVN_NO_ERROR));
+    }
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Run the (root) TASK to completion, including dynamically added sub-tasks,
+ * using THREAD_COUNT worker threads for processing.  Task outputs will be
+ * produced in the current thread.
+ *
+ * Pass CANCEL_FUNC and CANCEL_BATON directly into the task callbacks.
+ * Pass the RESULT_POOL into the task output functions and use SCRATCH_POOL
+ * for everything else (unless covered by task pools).
+ */
+static svn_error_t *execute_concurrently(
+  svn_task__t *task,
+  apr_int32_t thread_count,
+  svn_cancel_func_t cancel_func,
+  void *cancel_baton,
+  apr_pool_t *result_pool,
+  apr_pool_t *scratch_pool)
+{
+  root_t *root = task->root;
+  svn_error_t *task_err = SVN_NO_ERROR;
+  svn_error_t *sync_err = SVN_NO_ERROR;
+  worker_t *workers = apr_pcalloc(scratch_pool,
+                                  thread_count * sizeof(*workers));
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_int32_t started = 0;
+  apr_int32_t i;
+
+  /* First task to output results for. */
+  svn_task__t *current = task;
+
+  /* Construct all thread contexts before starting any thread.  That way,
+   * construction errors can be reported easily and the constructors may
+   * safely use non-thread-safe resources. */
+  for (i = 0; i < thread_count; ++i)
+    {
+      worker_t *worker = &workers[i];
+      worker->root = root;
+      worker->pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      worker->cancel_func = cancel_func;
+      worker->cancel_baton = cancel_baton;
+
+      svn_pool_clear(iterpool);
+      if (root->context_constructor)
+        {
+          task_err = root->context_constructor(&worker->thread_context,
+                                               root->context_baton,
+                                               worker->pool, iterpool);
+          if (task_err)
+            break;
+        }
+    }
+
+  /* Start the workers. */
+  for (i = 0; i < thread_count && !task_err; ++i)
+    {
+      apr_status_t status = apr_thread_create(&workers[i].thread, NULL,
+                                              worker_thread, &workers[i],
+                                              scratch_pool);
+      if (status)
+        task_err = svn_error_wrap_apr(status, _("Can't create thread"));
+      else
+        ++started;
+    }
+
+  /* Output results in post-order as they become available. */
+  sync_err = svn_mutex__lock(root->mutex);
+  while (current && !task_err && !sync_err && !root->terminate)
+    {
+      svn_pool_clear(iterpool);
+
+      if (is_processed(current))
+        task_err = output_processed(&current,
+                                    cancel_func, cancel_baton,
+                                    result_pool, iterpool);
+      else
+        sync_err = svn_thread_cond__wait(root->task_processed, root->mutex);
+    }
+
+  /* Make all workers terminate.  Outstanding tasks will not be processed. */
+  root->terminate = TRUE;
+  sync_err = svn_error_compose_create(
+               sync_err,
+               svn_thread_cond__broadcast(root->worker_wakeup));
+  sync_err = svn_mutex__unlock(root->mutex, sync_err);
+
+  for (i = 0; i < started; ++i)
+    {
+      apr_status_t retval;
+      apr_status_t status = apr_thread_join(&retval, workers[i].thread);
+      if (status)
+        sync_err = svn_error_compose_create(
+                     sync_err,
+                     svn_error_wrap_apr(status, _("Can't join thread")));
+
+      sync_err = svn_error_compose_create(sync_err, workers[i].error);
+    }
+
+  /* All threads have terminated.  It is safe to release their contexts. */
+  for (i = 0; i < thread_count; ++i)
+    if (workers[i].pool)
+      svn_pool_destroy(workers[i].pool);
+
+  /* Explicitly release any (other) error.  Leave pools as they are. */
+  clear_errors(task);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_error_compose_create(task_err, sync_err));
+}
+
+#endif
+
 /* Root data structure */
 
 svn_error_t *svn_task__run(
@@ -717,22 +1008,36 @@ svn_error_t *svn_task__run(
   apr_pool_t *scratch_pool)
 {
   root_t *root = apr_pcalloc(scratch_pool, sizeof(*root));
+  svn_error_t *err;
 
   /* Allocation on stack is fine as this function will not exit before
    * all task processing has been completed. */
   callbacks_t callbacks;
 
-  /* For now, we only have single-threaded execution.
-   * So, no special consideration required regarding pools & serialization.*/
-  root->task_pool = scratch_pool;
-  root->process_pool = scratch_pool;
-  root->results_pool = scratch_pool;
+  /* Pool to allocate all task tree data from.  In multi-threaded execution,
+   * it will be shared between threads, hence needs to be thread-safe.
+   * It also makes sure that we don't depend on SCRATCH_POOL's allocator
+   * settings. */
+  apr_pool_t *tree_pool;
+
+#if APR_HAS_THREADS
+  svn_boolean_t concurrent = thread_count > 1;
+#else
+  svn_boolean_t concurrent = FALSE;
+#endif
+
+  tree_pool = apr_allocator_owner_get(svn_pool_create_allocator(concurrent));
+
+  /* Sub-pools for objects of different lifetimes, see root_t. */
+  root->task_pool = svn_pool_create(tree_pool);
+  root->process_pool = svn_pool_create(tree_pool);
+  root->results_pool = svn_pool_create(tree_pool);
 
   callbacks.process_func = process_func;
   callbacks.output_func = output_func;
   callbacks.output_baton = output_baton;
-  
-  root->task = apr_pcalloc(scratch_pool, sizeof(*root->task));
+
+  root->task = apr_pcalloc(root->task_pool, sizeof(*root->task));
   root->task->root = root;
   root->task->first_ready = root->task;
   root->task->callbacks = &callbacks;
@@ -742,10 +1047,30 @@ svn_error_t *svn_task__run(
   root->context_baton = context_baton;
   root->context_constructor = context_constructor;
 
-  /* For now, there is only single-threaded execution. */
-  SVN_ERR(execute_serially(root->task,
-                           cancel_func, cancel_baton,
-                           result_pool, scratch_pool));
+#if APR_HAS_THREADS
+  if (concurrent)
+    {
+      err = svn_mutex__init(&root->mutex, TRUE, tree_pool);
+      if (!err)
+        err = svn_thread_cond__create(&root->worker_wakeup, tree_pool);
+      if (!err)
+        err = svn_thread_cond__create(&root->task_processed, tree_pool);
+      if (!err)
+        err = execute_concurrently(root->task, thread_count,
+                                   cancel_func, cancel_baton,
+                                   result_pool, scratch_pool);
+    }
+  else
+#endif
+    {
+      err = execute_serially(root->task,
+                             cancel_func, cancel_baton,
+                             result_pool, scratch_pool);
+    }
+
+  /* All task data, including unprocessed task parameters and results,
+   * gets released at once. */
+  svn_pool_destroy(tree_pool);
 
-  return SVN_NO_ERROR;
+  return svn_error_trace(err);
 }
@@ -51,6 +51,7 @@
 #include "private/svn_wc_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_editor.h"
+#include "private/svn_task.h"
 
 
 /* The file internal variant of svn_wc_status3_t, with slightly more
@@ -1023,28 +1024,48 @@ send_unversioned_item(const struct walk_status_baton *wb,
   return SVN_NO_ERROR;
 }
 
+/* Status structure collected for later output, see collect_status(). */
+typedef struct stashed_status_t
+{
+  /* The node that the status belongs to. */
+  const char *local_abspath;
+
+  /* The status to report. */
+  const svn_wc__internal_status_t *status;
+} stashed_status_t;
+
+/* Per-task context used while gathering the status of a directory's
+   children in a directory status task, i.e. in dir_status_process(). */
+typedef struct status_collector_t
+{
+  /* The walk baton as passed into get_dir_status(), i.e. shared between
+     all tasks and using the caller's DB. */
+  const struct walk_status_baton *wb;
+
+  /* The task we are gathering status information for. */
+  svn_task__t *task;
+
+  /* stashed_status_t elements gathered since the last sub-task has been
+     added (or since the start of the task), in reporting order. */
+  apr_array_header_t *statii;
+
+  /* Pool to allocate STATII and its contents in. */
+  apr_pool_t *result_pool;
+} status_collector_t;
+
 static svn_error_t *
-get_dir_status(const struct walk_status_baton *wb,
-               const char *local_abspath,
-               svn_boolean_t skip_this_dir,
-               const char *parent_repos_root_url,
-               const char *parent_repos_relpath,
-               const char *parent_repos_uuid,
-               const struct svn_wc__db_info_t *dir_info,
-               const svn_io_dirent2_t *dirent,
-               const apr_array_header_t *ignore_patterns,
-               svn_depth_t depth,
-               svn_boolean_t get_all,
-               svn_boolean_t no_ignore,
-               svn_wc_status_func4_t status_func,
-               void *status_baton,
-               svn_cancel_func_t cancel_func,
-               void *cancel_baton,
-               apr_pool_t *scratch_pool);
+add_dir_status_task(status_collector_t *collector,
+                    const char *local_abspath,
+                    const char *dir_repos_root_url,
+                    const char *dir_repos_relpath,
+                    const char *dir_repos_uuid,
+                    const apr_array_header_t *ignore_patterns,
+                    svn_boolean_t get_all,
+                    svn_boolean_t no_ignore);
 
 /* Send out a status structure according to the information gathered on one
  * child node. (Basically this function is the guts of the loop in
- * get_dir_status() and of get_child_status().)
+ * dir_status_process() and of get_child_status().)
  *
  * Send a status structure of LOCAL_ABSPATH. PARENT_ABSPATH must be the
  * dirname of LOCAL_ABSPATH.
@@ -1072,9 +1093,14 @@ get_dir_status(const struct walk_status_baton *wb,
  * *COLLECTED_IGNORE_PATTERNS will be allocated in RESULT_POOL. All other
  * allocations are made in SCRATCH_POOL.
  *
+ * Sub-directories will not be walked directly.  Instead, a new directory
+ * status task will be added to COLLECTOR.  COLLECTOR may only be NULL if
+ * DEPTH is not svn_depth_infinity.
+ *
  * The remaining parameters correspond to get_dir_status(). */
 static svn_error_t *
 one_child_status(const struct walk_status_baton *wb,
+                 status_collector_t *collector,
                  const char *local_abspath,
                  const char *parent_abspath,
                  const struct svn_wc__db_info_t *info,
@@ -1119,19 +1145,26 @@ one_child_status(const struct walk_status_baton *wb,
                                     status_func, status_baton,
                                     scratch_pool));
 
-      /* Descend in subdirectories. */
+      /* Descend in subdirectories.  This will be done by a separate task,
+         possibly in parallel to the remaining siblings. */
       if (depth == svn_depth_infinity
           && info->has_descendants /* is dir, or was dir and tc descendants */)
         {
-          SVN_ERR(get_dir_status(wb, local_abspath, TRUE,
-                                 dir_repos_root_url, dir_repos_relpath,
-                                 dir_repos_uuid, info,
-                                 dirent, ignore_patterns,
-                                 svn_depth_infinity, get_all,
-                                 no_ignore,
-                                 status_func, status_baton,
-                                 cancel_func, cancel_baton,
-                                 scratch_pool));
+          const char *repos_relpath, *repos_root_url, *repos_uuid;
+
+          SVN_ERR_ASSERT(collector != NULL);
+          SVN_ERR(get_repos_root_url_relpath(&repos_relpath, &repos_root_url,
+                                             &repos_uuid, info,
+                                             dir_repos_relpath,
+                                             dir_repos_root_url,
+                                             dir_repos_uuid,
+                                             wb->db, local_abspath,
+                                             scratch_pool, scratch_pool));
+
+          SVN_ERR(add_dir_status_task(collector, local_abspath,
+                                      repos_root_url, repos_relpath,
+                                      repos_uuid, ignore_patterns,
+                                      get_all, no_ignore));
         }
 
       return SVN_NO_ERROR;
@@ -1188,48 +1221,92 @@ one_child_status(const struct walk_status_baton *wb,
   return SVN_NO_ERROR;
 }
 
-/* Send svn_wc_status3_t * structures for the directory LOCAL_ABSPATH and
-   for all its child nodes (according to DEPTH) through STATUS_FUNC /
-   STATUS_BATON.
+/* Parameters of a directory status task, i.e. of a single directory
+   level processed by dir_status_process().  See get_dir_status() for
+   their meaning.
 
-   If SKIP_THIS_DIR is TRUE, the directory's own status will not be reported.
-   All subdirs reached by recursion will be reported regardless of this
-   parameter's value.
+   For the top-level directory, the DIR_REPOS_* members are NULL and will
+   be determined from the PARENT_REPOS_* and DIR_INFO.  Sub-tasks get them
+   passed in from their parent task and always skip "this-dir". */
+typedef struct dir_status_baton_t
+{
+  const struct walk_status_baton *wb;
+  const char *local_abspath;
+  svn_boolean_t skip_this_dir;
+  const char *parent_repos_root_url;
+  const char *parent_repos_relpath;
+  const char *parent_repos_uuid;
+  const struct svn_wc__db_info_t *dir_info;
+  const svn_io_dirent2_t *dirent;
+  const char *dir_repos_root_url;
+  const char *dir_repos_relpath;
+  const char *dir_repos_uuid;
+  const apr_array_header_t *ignore_patterns;
+  svn_depth_t depth;
+  svn_boolean_t get_all;
+  svn_boolean_t no_ignore;
+} dir_status_baton_t;
 
-   PARENT_REPOS_* parameters can be set to refer to LOCAL_ABSPATH's parent's
-   URL, i.e. the URL the WC reflects at the dirname of LOCAL_ABSPATH, to avoid
-   retrieving them again. Otherwise they must be NULL.
+/* Baton for dir_status_output(). */
+typedef struct dir_status_output_baton_t
+{
+  svn_wc_status_func4_t status_func;
+  void *status_baton;
+} dir_status_output_baton_t;
 
-   DIR_INFO can be set to the information of LOCAL_ABSPATH, to avoid retrieving
-   it again. Otherwise it must be NULL.
+/* Implements svn_wc_status_func4_t.  Append a copy of STATUS for PATH to
+   the status_collector_t in BATON. */
+static svn_error_t *
+collect_status(void *baton,
+               const char *path,
+               const svn_wc_status3_t *status,
+               apr_pool_t *scratch_pool)
+{
+  status_collector_t *collector = baton;
+  stashed_status_t *item = apr_palloc(collector->result_pool, sizeof(*item));
+  svn_wc__internal_status_t *new_status
+    = (void *)svn_wc_dup_status3(status, collector->result_pool);
+  const svn_wc__internal_status_t *old_status = (const void *)status;
 
-   DIRENT is LOCAL_ABSPATH's own dirent and is only needed if it is reported,
-   so if SKIP_THIS_DIR is TRUE, DIRENT can be left NULL.
+  /* Copy the internal/private data. */
+  new_status->has_descendants = old_status->has_descendants;
+  new_status->op_root = old_status->op_root;
 
-   Other arguments are the same as those passed to
-   svn_wc_get_status_editor5().  */
+  item->local_abspath = apr_pstrdup(collector->result_pool, path);
+  item->status = new_status;
+  APR_ARRAY_PUSH(collector->statii, stashed_status_t *) = item;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+
+   Gather the status of the directory described by the dir_status_baton_t
+   in PROCESS_BATON and of its immediate children.  Sub-directories that
+   need to be walked will become sub-tasks of TASK.  Use THREAD_CONTEXT as
+   svn_wc__db_t, if not NULL.
+
+   Return an array of stashed_status_t * in *RESULT, or NULL if there is
+   nothing to report after the last sub-task. */
 static svn_error_t *
-get_dir_status(const struct walk_status_baton *wb,
-               const char *local_abspath,
-               svn_boolean_t skip_this_dir,
-               const char *parent_repos_root_url,
-               const char *parent_repos_relpath,
-               const char *parent_repos_uuid,
-               const struct svn_wc__db_info_t *dir_info,
-               const svn_io_dirent2_t *dirent,
-               const apr_array_header_t *ignore_patterns,
-               svn_depth_t depth,
-               svn_boolean_t get_all,
-               svn_boolean_t no_ignore,
-               svn_wc_status_func4_t status_func,
-               void *status_baton,
-               svn_cancel_func_t cancel_func,
-               void *cancel_baton,
-               apr_pool_t *scratch_pool)
+dir_status_process(void **result,
+                   svn_task__t *task,
+                   void *thread_context,
+                   void *process_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
 {
-  const char *dir_repos_root_url;
-  const char *dir_repos_relpath;
-  const char *dir_repos_uuid;
+  dir_status_baton_t *b = process_baton;
+  struct walk_status_baton wb = *b->wb;
+  const char *local_abspath = b->local_abspath;
+  const struct svn_wc__db_info_t *dir_info = b->dir_info;
+  const char *dir_repos_root_url = b->dir_repos_root_url;
+  const char *dir_repos_relpath = b->dir_repos_relpath;
+  const char *dir_repos_uuid = b->dir_repos_uuid;
+  svn_depth_t depth = b->depth;
+  status_collector_t collector;
   apr_hash_t *dirents, *nodes, *conflicts, *all_children;
   apr_array_header_t *sorted_children;
   apr_array_header_t *collected_ignore_patterns = NULL;
@@ -1237,6 +1314,16 @@ get_dir_status(const struct walk_status_baton *wb,
   svn_error_t *err;
   int i;
 
+  /* Worker threads must use their own DB handle. */
+  if (thread_context)
+    wb.db = thread_context;
+
+  collector.wb = b->wb;
+  collector.task = task;
+  collector.statii = apr_array_make(result_pool, 16,
+                                    sizeof(stashed_status_t *));
+  collector.result_pool = result_pool;
+
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
@@ -1245,10 +1332,10 @@ get_dir_status(const struct walk_status_baton *wb,
 
   iterpool = svn_pool_create(scratch_pool);
 
-  if (wb->check_working_copy)
+  if (wb.check_working_copy)
     {
       err = svn_io_get_dirents3(&dirents, local_abspath,
-                                wb->ignore_text_mods /* only_check_type*/,
+                                wb.ignore_text_mods /* only_check_type*/,
                                 scratch_pool, iterpool);
       if (err
           && (APR_STATUS_IS_ENOENT(err->apr_err)
@@ -1263,24 +1350,29 @@ get_dir_status(const struct walk_status_baton *wb,
   else
     dirents = apr_hash_make(scratch_pool);
 
-  if (!dir_info)
-    SVN_ERR(svn_wc__db_read_single_info(&dir_info, wb->db, local_abspath,
-                                        !wb->check_working_copy,
-                                        scratch_pool, iterpool));
-
-  SVN_ERR(get_repos_root_url_relpath(&dir_repos_relpath, &dir_repos_root_url,
-                                     &dir_repos_uuid, dir_info,
-                                     parent_repos_relpath,
-                                     parent_repos_root_url, parent_repos_uuid,
-                                     wb->db, local_abspath,
-                                     scratch_pool, iterpool));
+  if (!dir_repos_relpath)
+    {
+      if (!dir_info)
+        SVN_ERR(svn_wc__db_read_single_info(&dir_info, wb.db, local_abspath,
+                                            !wb.check_working_copy,
+                                            scratch_pool, iterpool));
+
+      SVN_ERR(get_repos_root_url_relpath(&dir_repos_relpath,
+                                         &dir_repos_root_url,
+                                         &dir_repos_uuid, dir_info,
+                                         b->parent_repos_relpath,
+                                         b->parent_repos_root_url,
+                                         b->parent_repos_uuid,
+                                         wb.db, local_abspath,
+                                         scratch_pool, iterpool));
+    }
 
   /* Create a hash containing all children.  The source hashes
      don't all map the same types, but only the keys of the result
      hash are subsequently used. */
   SVN_ERR(svn_wc__db_read_children_info(&nodes, &conflicts,
-                                        wb->db, local_abspath,
-                                        !wb->check_working_copy,
+                                        wb.db, local_abspath,
+                                        !wb.check_working_copy,
                                         scratch_pool, iterpool));
 
   all_children = apr_hash_overlay(scratch_pool, nodes, dirents);
@@ -1288,8 +1380,10 @@ get_dir_status(const struct walk_status_baton *wb,
     all_children = apr_hash_overlay(scratch_pool, conflicts, all_children);
 
   /* Handle "this-dir" first. */
-  if (! skip_this_dir)
+  if (! b->skip_this_dir)
     {
+      const svn_io_dirent2_t *dirent = b->dirent;
+
       /* This code is not conditional on HAVE_SYMLINK as some systems that do
          not allow creating symlinks (!HAVE_SYMLINK) can still encounter
          symlinks (or in case of Windows also 'Junctions') created by other
@@ -1314,79 +1408,273 @@ get_dir_status(const struct walk_status_baton *wb,
           SVN_ERR(svn_io_check_resolved_path(local_abspath,
                                              &this_dirent->kind, iterpool));
           this_dirent->special = FALSE;
-          SVN_ERR(send_status_structure(wb, local_abspath,
-                                        parent_repos_root_url,
-                                        parent_repos_relpath,
-                                        parent_repos_uuid,
-                                        dir_info, this_dirent, get_all,
-                                        status_func, status_baton,
+          SVN_ERR(send_status_structure(&wb, local_abspath,
+                                        b->parent_repos_root_url,
+                                        b->parent_repos_relpath,
+                                        b->parent_repos_uuid,
+                                        dir_info, this_dirent, b->get_all,
+                                        collect_status, &collector,
                                         iterpool));
         }
      else
-        SVN_ERR(send_status_structure(wb, local_abspath,
-                                      parent_repos_root_url,
-                                      parent_repos_relpath,
-                                      parent_repos_uuid,
-                                      dir_info, dirent, get_all,
-                                      status_func, status_baton,
+        SVN_ERR(send_status_structure(&wb, local_abspath,
+                                      b->parent_repos_root_url,
+                                      b->parent_repos_relpath,
+                                      b->parent_repos_uuid,
+                                      dir_info, dirent, b->get_all,
+                                      collect_status, &collector,
                                       iterpool));
     }
 
   /* If the requested depth is empty, we only need status on this-dir. */
-  if (depth == svn_depth_empty)
-    return SVN_NO_ERROR;
+  if (depth != svn_depth_empty)
+    {
+      /* Walk all the children of this directory. */
+      sorted_children = svn_sort__hash(all_children,
+                                       svn_sort_compare_items_lexically,
+                                       scratch_pool);
+      for (i = 0; i < sorted_children->nelts; i++)
+        {
+          const void *key;
+          apr_ssize_t klen;
+          svn_sort__item_t item;
+          const char *child_abspath;
+          svn_io_dirent2_t *child_dirent;
+          const struct svn_wc__db_info_t *child_info;
+
+          svn_pool_clear(iterpool);
+
+          item = APR_ARRAY_IDX(sorted_children, i, svn_sort__item_t);
+          key = item.key;
+          klen = item.klen;
+
+          child_abspath = svn_dirent_join(local_abspath, key, iterpool);
+          child_dirent = apr_hash_get(dirents, key, klen);
+          child_info = apr_hash_get(nodes, key, klen);
+
+          SVN_ERR(one_child_status(&wb,
+                                   &collector,
+                                   child_abspath,
+                                   local_abspath,
+                                   child_info,
+                                   child_dirent,
+                                   dir_repos_root_url,
+                                   dir_repos_relpath,
+                                   dir_repos_uuid,
+                                   apr_hash_get(conflicts, key, klen) != NULL,
+                                   &collected_ignore_patterns,
+                                   b->ignore_patterns,
+                                   depth,
+                                   b->get_all,
+                                   b->no_ignore,
+                                   collect_status,
+                                   &collector,
+                                   cancel_func,
+                                   cancel_baton,
+                                   scratch_pool,
+                                   iterpool));
+        }
+    }
+
+  /* Destroy our subpools. */
+  svn_pool_destroy(iterpool);
+
+  *result = collector.statii->nelts ? collector.statii : NULL;
 
-  /* Walk all the children of this directory. */
-  sorted_children = svn_sort__hash(all_children,
-                                   svn_sort_compare_items_lexically,
-                                   scratch_pool);
-  for (i = 0; i < sorted_children->nelts; i++)
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+
+   Send the stashed_status_t * array RESULT to the status callback in the
+   dir_status_output_baton_t OUTPUT_BATON. */
+static svn_error_t *
+dir_status_output(svn_task__t *task,
+                  void *result,
+                  void *output_baton,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  dir_status_output_baton_t *ob = output_baton;
+  apr_array_header_t *statii = result;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < statii->nelts; i++)
     {
-      const void *key;
-      apr_ssize_t klen;
-      svn_sort__item_t item;
-      const char *child_abspath;
-      svn_io_dirent2_t *child_dirent;
-      const struct svn_wc__db_info_t *child_info;
+      const stashed_status_t *item
+        = APR_ARRAY_IDX(statii, i, const stashed_status_t *);
 
       svn_pool_clear(iterpool);
-
-      item = APR_ARRAY_IDX(sorted_children, i, svn_sort__item_t);
-      key = item.key;
-      klen = item.klen;
-
-      child_abspath = svn_dirent_join(local_abspath, key, iterpool);
-      child_dirent = apr_hash_get(dirents, key, klen);
-      child_info = apr_hash_get(nodes, key, klen);
-
-      SVN_ERR(one_child_status(wb,
-                               child_abspath,
-                               local_abspath,
-                               child_info,
-                               child_dirent,
-                               dir_repos_root_url,
-                               dir_repos_relpath,
-                               dir_repos_uuid,
-                               apr_hash_get(conflicts, key, klen) != NULL,
-                               &collected_ignore_patterns,
-                               ignore_patterns,
-                               depth,
-                               get_all,
-                               no_ignore,
-                               status_func,
-                               status_baton,
-                               cancel_func,
-                               cancel_baton,
-                               scratch_pool,
-                               iterpool));
+      SVN_ERR((*ob->status_func)(ob->status_baton, item->local_abspath,
+                                 &item->status->s, iterpool));
     }
 
-  /* Destroy our subpools. */
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
 }
 
+/* Add a sub-task to COLLECTOR->TASK that walks the versioned directory
+   LOCAL_ABSPATH with infinite depth but without reporting LOCAL_ABSPATH
+   itself.  DIR_REPOS_* must be the repository location of LOCAL_ABSPATH.
+
+   The status gathered by COLLECTOR so far will be reported before the
+   results of the new sub-task.
+
+   The remaining parameters correspond to get_dir_status(). */
+static svn_error_t *
+add_dir_status_task(status_collector_t *collector,
+                    const char *local_abspath,
+                    const char *dir_repos_root_url,
+                    const char *dir_repos_relpath,
+                    const char *dir_repos_uuid,
+                    const apr_array_header_t *ignore_patterns,
+                    svn_boolean_t get_all,
+                    svn_boolean_t no_ignore)
+{
+  apr_pool_t *process_pool = svn_task__create_process_pool(collector->task);
+  dir_status_baton_t *b = apr_pcalloc(process_pool, sizeof(*b));
+  apr_array_header_t *partial_output = NULL;
+
+  b->wb = collector->wb;
+  b->local_abspath = apr_pstrdup(process_pool, local_abspath);
+  b->skip_this_dir = TRUE;
+  b->dir_repos_root_url = apr_pstrdup(process_pool, dir_repos_root_url);
+  b->dir_repos_relpath = apr_pstrdup(process_pool, dir_repos_relpath);
+  b->dir_repos_uuid = apr_pstrdup(process_pool, dir_repos_uuid);
+  b->ignore_patterns = ignore_patterns;
+  b->depth = svn_depth_infinity;
+  b->get_all = get_all;
+  b->no_ignore = no_ignore;
+
+  /* Everything collected so far must be reported before the sub-task's
+     output.  Start a new collection for the remainder of this task. */
+  if (collector->statii->nelts)
+    {
+      partial_output = collector->statii;
+      collector->statii = apr_array_make(collector->result_pool, 16,
+                                         sizeof(stashed_status_t *));
+    }
+
+  return svn_error_trace(svn_task__add_similar(collector->task, process_pool,
+                                               partial_output, b));
+}
+
+/* Implements svn_task__thread_context_constructor_t.
+
+   Open a new svn_wc__db_t in *THREAD_CONTEXT, configured like the
+   svn_wc__db_t given as CONTEXT_BATON. */
+static svn_error_t *
+open_thread_db(void **thread_context,
+               void *context_baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  svn_wc__db_t *db;
+  SVN_ERR(svn_wc__db_open_similar(&db, context_baton,
+                                  result_pool, scratch_pool));
+
+  *thread_context = db;
+  return SVN_NO_ERROR;
+}
+
+/* Send svn_wc_status3_t * structures for the directory LOCAL_ABSPATH and
+   for all its child nodes (according to DEPTH) through STATUS_FUNC /
+   STATUS_BATON.
+
+   If SKIP_THIS_DIR is TRUE, the directory's own status will not be reported.
+   All subdirs reached by recursion will be reported regardless of this
+   parameter's value.
+
+   PARENT_REPOS_* parameters can be set to refer to LOCAL_ABSPATH's parent's
+   URL, i.e. the URL the WC reflects at the dirname of LOCAL_ABSPATH, to avoid
+   retrieving them again. Otherwise they must be NULL.
+
+   DIR_INFO can be set to the information of LOCAL_ABSPATH, to avoid retrieving
+   it again. Otherwise it must be NULL.
+
+   DIRENT is LOCAL_ABSPATH's own dirent and is only needed if it is reported,
+   so if SKIP_THIS_DIR is TRUE, DIRENT can be left NULL.
+
+   Sub-directories will be walked in parallel, using up to the number of
+   worker threads configured for WB->DB, unless WB->DB owns a working copy
+   lock.  STATUS_FUNC will always be called from the current thread and in
+   the same order as for a serial walk.
+
+   Other arguments are the same as those passed to
+   svn_wc_get_status_editor5().  */
+static svn_error_t *
+get_dir_status(const struct walk_status_baton *wb,
+               const char *local_abspath,
+               svn_boolean_t skip_this_dir,
+               const char *parent_repos_root_url,
+               const char *parent_repos_relpath,
+               const char *parent_repos_uuid,
+               const struct svn_wc__db_info_t *dir_info,
+               const svn_io_dirent2_t *dirent,
+               const apr_array_header_t *ignore_patterns,
+               svn_depth_t depth,
+               svn_boolean_t get_all,
+               svn_boolean_t no_ignore,
+               svn_wc_status_func4_t status_func,
+               void *status_baton,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *scratch_pool)
+{
+  dir_status_baton_t b = { 0 };
+  dir_status_output_baton_t ob;
+  apr_int32_t thread_count = 1;
+
+  b.wb = wb;
+  b.local_abspath = local_abspath;
+  b.skip_this_dir = skip_this_dir;
+  b.parent_repos_root_url = parent_repos_root_url;
+  b.parent_repos_relpath = parent_repos_relpath;
+  b.parent_repos_uuid = parent_repos_uuid;
+  b.dir_info = dir_info;
+  b.dirent = dirent;
+  b.ignore_patterns = ignore_patterns;
+  b.depth = depth;
+  b.get_all = get_all;
+  b.no_ignore = no_ignore;
+
+  ob.status_func = status_func;
+  ob.status_baton = status_baton;
+
+  /* Only recursive walks may have sub-tasks that we could process in
+     parallel.  Don't pay for extra threads and DB handles otherwise. */
+  if (depth == svn_depth_infinity || depth == svn_depth_unknown)
+    thread_count = svn_wc__db_get_worker_threads(wb->db);
+
+  /* The walk repairs recorded timestamps and conflict markers if the
+     caller holds a write lock, e.g. during cleanup.  Worker DB handles
+     don't own the caller's locks and would silently skip these repairs,
+     so keep locked walks serial. */
+  if (thread_count > 1)
+    {
+      svn_boolean_t own_lock;
+
+      SVN_ERR(svn_wc__db_wclock_owns_any_lock(&own_lock, wb->db,
+                                              scratch_pool));
+      if (own_lock)
+        thread_count = 1;
+    }
+
+  return svn_error_trace(svn_task__run(thread_count,
+                                       dir_status_process, &b,
+                                       status_func ? dir_status_output : NULL,
+                                       &ob,
+                                       thread_count > 1 ? open_thread_db
+                                                        : NULL,
+                                       wb->db,
+                                       cancel_func, cancel_baton,
+                                       scratch_pool, scratch_pool));
+}
+
 /* Send an svn_wc_status3_t * structure for the versioned file, or for the
  * unversioned file or directory, LOCAL_ABSPATH, which is not ignored (an
  * explicit target). Does not recurse.
@@ -1444,6 +1732,7 @@ get_child_status(const struct walk_status_baton *wb,
    * ### Maybe svn_wc__db_read_children_info() and read_info() should be more
    * ### alike? */
   SVN_ERR(one_child_status(wb,
+                           NULL, /* collector.  We don't recurse. */
                            local_abspath,
                            parent_abspath,
                            info,
@@ -1425,6 +1425,18 @@ bump_to_31(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Format 32 has the format 31 schema; existing pristine texts all have a
+   NULL compression and stay as they are. */
+static svn_error_t *
+bump_to_32(void *baton,
+           svn_sqlite__db_t *sdb,
+           apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_sqlite__exec_statements(sdb, STMT_UPGRADE_TO_32));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 upgrade_apply_dav_cache(svn_sqlite__db_t *sdb,
                         const char *dir_relpath,
@@ -1686,6 +1698,12 @@ svn_wc__upgrade_sdb(int *result_format,
                                              scratch_pool));
         *result_format = 31;
         /* FALLTHROUGH  */
+
+      case 31:
+        SVN_ERR(svn_sqlite__with_transaction(sdb, bump_to_32, &bb,
+                                             scratch_pool));
+        *result_format = 32;
+        /* FALLTHROUGH  */
       /* ### future bumps go here.  */
 #if 0
       case XXX-1:
@@ -80,7 +80,7 @@ CREATE UNIQUE INDEX I_LOCAL_ABSPATH ON WCROOT (local_abspath);
    derived from the 'checksum' column.  Each pristine text is referenced by
    any number of rows in the NODES and ACTUAL_NODE tables.
 
-   In future, the pristine text file may be compressed.
+   The pristine text file may be compressed, see the 'compression' column.
  */
 CREATE TABLE PRISTINE (
   /* The SHA-1 checksum of the pristine text. This is a unique key. The
@@ -88,13 +88,15 @@ CREATE TABLE PRISTINE (
      pristine texts referenced from this database. */
   checksum  TEXT NOT NULL PRIMARY KEY,
 
-  /* Enumerated values specifying type of compression. The only value
-     supported so far is NULL, meaning that no compression has been applied
-     and the pristine text is stored verbatim in the file. */
+  /* Enumerated values specifying type of compression. NULL means that no
+     compression has been applied and the pristine text is stored verbatim
+     in the file.  Since format 32, 1 means that the file holds the text
+     as written by svn_stream__lz4_compressed(). */
   compression  INTEGER,
 
-  /* The size in bytes of the file in which the pristine text is stored.
-     Used to verify the pristine file is "proper". */
+  /* The size in bytes of the pristine text.  For uncompressed texts, this
+     is the size of the file in which it is stored and is used to verify
+     the pristine file is "proper". */
   size  INTEGER NOT NULL,
 
   /* The number of rows in the NODES table that have a 'checksum' column
@@ -699,9 +701,11 @@ WHERE l.op_depth = 0
 
 
 /* ------------------------------------------------------------------------- */
-/* Format 32 ....  */
-/* -- STMT_UPGRADE_TO_32
-PRAGMA user_version = 32; */
+/* Format 32 starts honoring PRISTINE.compression.  The schema is unchanged,
+   but older clients would read compressed pristine texts verbatim, so they
+   must not open these working copies. */
+-- STMT_UPGRADE_TO_32
+PRAGMA user_version = 32;
 
 
 /* ------------------------------------------------------------------------- */
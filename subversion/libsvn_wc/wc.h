@@ -161,10 +161,14 @@ extern "C" {
  * == 1.9.x shipped with format 31
  * == 1.10.x shipped with format 31
  *
+ * The bump to 32 started honoring the compression column of the PRISTINE
+ * table: pristine texts may now be stored LZ4-compressed, see the
+ * working-copy:compress-pristines option.  No schema change.
+ *
  * Please document any further format changes here.
  */
 
-#define SVN_WC__VERSION 31
+#define SVN_WC__VERSION 32
 
 
 /* Formats <= this have no concept of "revert text-base/props".  */
@@ -13686,6 +13686,92 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
 
 
 
+/* The body of svn_wc__db_wq_record_and_fetch_batch().
+ */
+static svn_error_t *
+wq_fetch_batch(apr_array_header_t **ids,
+               apr_array_header_t **work_items,
+               svn_wc__db_wcroot_t *wcroot,
+               const apr_array_header_t *completed_ids,
+               int max_items,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  int i;
+
+  if (completed_ids)
+    for (i = 0; i < completed_ids->nelts; ++i)
+      {
+        SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                          STMT_DELETE_WORK_ITEM));
+        SVN_ERR(svn_sqlite__bind_int64(stmt, 1,
+                                       APR_ARRAY_IDX(completed_ids, i,
+                                                     apr_uint64_t)));
+        SVN_ERR(svn_sqlite__step_done(stmt));
+      }
+
+  *ids = apr_array_make(result_pool, max_items, sizeof(apr_uint64_t));
+  *work_items = apr_array_make(result_pool, max_items, sizeof(svn_skel_t *));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_WORK_ITEMS));
+  SVN_ERR(svn_sqlite__bind_int(stmt, 1, max_items));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      apr_size_t len;
+      const void *val;
+
+      APR_ARRAY_PUSH(*ids, apr_uint64_t) = svn_sqlite__column_int64(stmt, 0);
+
+      val = svn_sqlite__column_blob(stmt, 1, &len, result_pool);
+      APR_ARRAY_PUSH(*work_items, svn_skel_t *)
+        = svn_skel__parse(val, len, result_pool);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+svn_error_t *
+svn_wc__db_wq_record_and_fetch_batch(apr_array_header_t **ids,
+                                     apr_array_header_t **work_items,
+                                     svn_wc__db_t *db,
+                                     const char *wri_abspath,
+                                     const apr_array_header_t *completed_ids,
+                                     apr_hash_t *record_map,
+                                     int max_items,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(ids != NULL);
+  SVN_ERR_ASSERT(work_items != NULL);
+  SVN_ERR_ASSERT(max_items > 0);
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  SVN_WC__DB_WITH_TXN(
+    svn_error_compose_create(
+            wq_fetch_batch(ids, work_items, wcroot, completed_ids, max_items,
+                           result_pool, scratch_pool),
+            record_map ? wq_record(wcroot, record_map, scratch_pool)
+                       : SVN_NO_ERROR),
+    wcroot);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* ### temporary API. remove before release.  */
 svn_error_t *
 svn_wc__db_temp_get_format(int *format,
@@ -14938,6 +15024,32 @@ svn_wc__db_wclock_owns_lock(svn_boolean_t *own_lock,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__db_wclock_owns_any_lock(svn_boolean_t *own_lock,
+                                svn_wc__db_t *db,
+                                apr_pool_t *scratch_pool)
+{
+  apr_hash_index_t *hi;
+
+  *own_lock = FALSE;
+
+  /* Many directories map to the same WCROOT but this is cheap enough. */
+  for (hi = apr_hash_first(scratch_pool, db->dir_data);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      svn_wc__db_wcroot_t *wcroot = apr_hash_this_val(hi);
+
+      if (wcroot->owned_locks->nelts)
+        {
+          *own_lock = TRUE;
+          break;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* The body of svn_wc__db_temp_op_end_directory_update().
  */
 static svn_error_t *
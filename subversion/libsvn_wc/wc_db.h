@@ -273,6 +273,41 @@ svn_wc__db_open(svn_wc__db_t **db,
                 apr_pool_t *scratch_pool);
 
 
+/* Open a new DB handle in *DB with the same configuration and open
+   options as SOURCE_DB.  The new handle shares no state with SOURCE_DB,
+   in particular no SQLite connections, and may therefore be used in
+   another thread.
+
+   Allocate *DB in RESULT_POOL and use SCRATCH_POOL for temporaries.  */
+svn_error_t *
+svn_wc__db_open_similar(svn_wc__db_t **db,
+                        svn_wc__db_t *source_db,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool);
+
+
+/* Return the maximum number of threads that DB's configuration allows
+   for parallel working copy operations.  The result is always at least 1.  */
+apr_int32_t
+svn_wc__db_get_worker_threads(svn_wc__db_t *db);
+
+
+/* Set *WORKER_DB to the INDEX-th auxiliary DB handle of DB, opening it
+   on first use.  Like handles returned by svn_wc__db_open_similar(),
+   these share no state with DB or each other and may be used from
+   different threads.  Unlike those, they never enforce an empty work
+   queue, so they can be used while the queue is being processed.
+
+   The handles are kept open for reuse until DB gets closed.  The caller
+   must make sure that each INDEX is in use by at most one thread at a time.
+   Use SCRATCH_POOL for temporary allocations.  */
+svn_error_t *
+svn_wc__db_get_worker_db(svn_wc__db_t **worker_db,
+                         svn_wc__db_t *db,
+                         int index,
+                         apr_pool_t *scratch_pool);
+
+
 /* Close DB.  */
 svn_error_t *
 svn_wc__db_close(svn_wc__db_t *db);
@@ -3055,6 +3090,28 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
                                     apr_pool_t *result_pool,
                                     apr_pool_t *scratch_pool);
 
+/* Batch variant of svn_wc__db_wq_record_and_fetch_next().
+
+   In a single transaction, mark all work items listed in COMPLETED_IDS
+   (apr_uint64_t, may be NULL) as completed, record timestamps and sizes
+   from RECORD_MAP (may be NULL) and return up to MAX_ITEMS of the next
+   work items in queue order.  Their identifiers are returned in *IDS
+   (apr_uint64_t) and their data in *WORK_ITEMS (svn_skel_t *).  If there
+   are no work items left, both arrays will be empty.
+
+   RESULT_POOL will be used to allocate the results, and SCRATCH_POOL
+   will be used for all temporary allocations.  */
+svn_error_t *
+svn_wc__db_wq_record_and_fetch_batch(apr_array_header_t **ids,
+                                     apr_array_header_t **work_items,
+                                     svn_wc__db_t *db,
+                                     const char *wri_abspath,
+                                     const apr_array_header_t *completed_ids,
+                                     apr_hash_t *record_map,
+                                     int max_items,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool);
+
 
 /* @} */
 
@@ -3106,6 +3163,12 @@ svn_wc__db_wclock_owns_lock(svn_boolean_t *own_lock,
                             svn_boolean_t exact,
                             apr_pool_t *scratch_pool);
 
+/* Checks whether DB currently owns any lock, in any working copy.  */
+svn_error_t *
+svn_wc__db_wclock_owns_any_lock(svn_boolean_t *own_lock,
+                                svn_wc__db_t *db,
+                                apr_pool_t *scratch_pool);
+
 
 
 /* @defgroup svn_wc__db_temp Various temporary functions during transition
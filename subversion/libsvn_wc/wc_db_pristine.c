@@ -30,6 +30,7 @@
 #include "svn_dirent_uri.h"
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "wc.h"
 #include "wc_db.h"
@@ -40,6 +41,32 @@
 #define PRISTINE_STORAGE_RELPATH "pristine"
 #define PRISTINE_TEMPDIR_RELPATH "tmp"
 
+/* Value of PRISTINE.compression for texts stored in the format written by
+   svn_stream__lz4_compressed().  NULL means that the text is stored
+   verbatim. */
+#define PRISTINE_COMPRESSION_LZ4 1
+
+/* Set *COMPRESSED to whether the pristine text identified by SHA1_CHECKSUM
+   is stored compressed in the pristine store of WCROOT.  The text must be
+   present. */
+static svn_error_t *
+pristine_is_compressed(svn_boolean_t *compressed,
+                       svn_wc__db_wcroot_t *wcroot,
+                       const svn_checksum_t *sha1_checksum,
+                       apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_PRISTINE_SIZE));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+
+  *compressed = !svn_sqlite__column_is_null(stmt, 1);
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
 
 
 /* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
@@ -104,6 +131,7 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
   svn_wc__db_wcroot_t *wcroot;
   const char *local_relpath;
   svn_boolean_t present;
+  svn_boolean_t compressed;
 
   SVN_ERR_ASSERT(pristine_abspath != NULL);
   SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
@@ -134,6 +162,26 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
                              sha1_checksum,
                              result_pool, scratch_pool));
 
+  /* Callers expect a plain file.  So, provide a decompressed copy outside
+     the working copy that lives as long as RESULT_POOL. */
+  SVN_ERR(pristine_is_compressed(&compressed, wcroot, sha1_checksum,
+                                 scratch_pool));
+  if (compressed)
+    {
+      svn_stream_t *src_stream;
+      svn_stream_t *dst_stream;
+
+      SVN_ERR(svn_stream_open_readonly(&src_stream, *pristine_abspath,
+                                       scratch_pool, scratch_pool));
+      src_stream = svn_stream__lz4_compressed(src_stream, scratch_pool);
+
+      SVN_ERR(svn_stream_open_unique(&dst_stream, pristine_abspath, NULL,
+                                     svn_io_file_del_on_pool_cleanup,
+                                     result_pool, scratch_pool));
+      SVN_ERR(svn_stream_copy3(src_stream, dst_stream, NULL, NULL,
+                               scratch_pool));
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -176,6 +224,7 @@ pristine_read_txn(svn_stream_t **contents,
 {
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+  svn_boolean_t compressed;
 
   /* Check that this pristine text is present in the store.  (The presence
    * of the file is not sufficient.) */
@@ -186,6 +235,7 @@ pristine_read_txn(svn_stream_t **contents,
 
   if (size)
     *size = svn_sqlite__column_int64(stmt, 0);
+  compressed = !svn_sqlite__column_is_null(stmt, 1);
 
   SVN_ERR(svn_sqlite__reset(stmt));
   if (! have_row)
@@ -209,6 +259,10 @@ pristine_read_txn(svn_stream_t **contents,
       SVN_ERR(svn_io_file_open(&file, pristine_abspath, APR_READ,
                                APR_OS_DEFAULT, result_pool));
       *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
+
+      /* Decompress on the fly. */
+      if (compressed)
+        *contents = svn_stream__lz4_compressed(*contents, result_pool);
     }
 
   return SVN_NO_ERROR;
@@ -281,6 +335,9 @@ static svn_error_t *
 pristine_install_txn(svn_sqlite__db_t *sdb,
                      /* The path to the source file that is to be moved into place. */
                      svn_stream_t *install_stream,
+                     /* The size of the pristine text if the file is
+                        LZ4-compressed.  SVN_INVALID_FILESIZE otherwise. */
+                     svn_filesize_t text_size,
                      /* The target path for the file (within the pristine store). */
                      const char *pristine_abspath,
                      /* The pristine text's SHA-1 checksum. */
@@ -291,18 +348,26 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
 {
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+#ifdef SVN_DEBUG
+  svn_boolean_t existing_compressed;
+#endif
 
   /* If this pristine text is already present in the store, just keep it:
-   * delete the new one and return. */
-  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_PRISTINE));
+   * delete the new one and return.  The existing text may have been stored
+   * with a different compression than the new one. */
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_PRISTINE_SIZE));
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
   SVN_ERR(svn_sqlite__step(&have_row, stmt));
+#ifdef SVN_DEBUG
+  existing_compressed = have_row && !svn_sqlite__column_is_null(stmt, 1);
+#endif
   SVN_ERR(svn_sqlite__reset(stmt));
 
   if (have_row)
     {
 #ifdef SVN_DEBUG
-      /* Consistency checks.  Verify both files exist and match.
+      /* Consistency checks.  Verify both files exist and, unless either
+       * is compressed, match in size.
        * ### We could check much more. */
       {
         apr_finfo_t finfo;
@@ -313,7 +378,8 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
 
         SVN_ERR(svn_io_stat(&finfo, pristine_abspath, APR_FINFO_SIZE,
                             scratch_pool));
-        if (size != finfo.size)
+        if (text_size == SVN_INVALID_FILESIZE && !existing_compressed
+            && size != finfo.size)
           {
             return svn_error_createf(
               SVN_ERR_WC_CORRUPT_TEXT_BASE, NULL,
@@ -343,7 +409,15 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
     SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_INSERT_PRISTINE));
     SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
     SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
-    SVN_ERR(svn_sqlite__bind_int64(stmt, 3, size));
+
+    /* The store records the size of the text, not that of the file. */
+    if (text_size != SVN_INVALID_FILESIZE)
+      {
+        SVN_ERR(svn_sqlite__bind_int64(stmt, 3, text_size));
+        SVN_ERR(svn_sqlite__bind_int(stmt, 4, PRISTINE_COMPRESSION_LZ4));
+      }
+    else
+      SVN_ERR(svn_sqlite__bind_int64(stmt, 3, size));
     SVN_ERR(svn_sqlite__insert(NULL, stmt));
 
     SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE, scratch_pool));
@@ -356,8 +430,39 @@ struct svn_wc__db_install_data_t
 {
   svn_wc__db_wcroot_t *wcroot;
   svn_stream_t *inner_stream;
+
+  /* If the text gets stored compressed: the stream that compresses into
+     INNER_STREAM and the number of bytes written to it.  Otherwise,
+     NULL and SVN_INVALID_FILESIZE, respectively. */
+  svn_stream_t *compress_stream;
+  svn_filesize_t text_size;
 };
 
+/* Implements svn_write_fn_t.  Pass data on to the compressing stream of
+   the svn_wc__db_install_data_t BATON and count the bytes. */
+static svn_error_t *
+install_compressed_write(void *baton,
+                         const char *data,
+                         apr_size_t *len)
+{
+  svn_wc__db_install_data_t *install_data = baton;
+
+  SVN_ERR(svn_stream_write(install_data->compress_stream, data, len));
+  install_data->text_size += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t.  Flush and close the compressing stream of
+   the svn_wc__db_install_data_t BATON. */
+static svn_error_t *
+install_compressed_close(void *baton)
+{
+  svn_wc__db_install_data_t *install_data = baton;
+
+  return svn_error_trace(svn_stream_close(install_data->compress_stream));
+}
+
 svn_error_t *
 svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
                                     svn_wc__db_install_data_t **install_data,
@@ -371,6 +476,9 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
   svn_wc__db_wcroot_t *wcroot;
   const char *local_relpath;
   const char *temp_dir_abspath;
+  svn_checksum_t **checksums[2];
+  svn_checksum_kind_t kinds[2];
+  int count = 0;
 
   SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
 
@@ -382,6 +490,7 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   *install_data = apr_pcalloc(result_pool, sizeof(**install_data));
   (*install_data)->wcroot = wcroot;
+  (*install_data)->text_size = SVN_INVALID_FILESIZE;
 
   SVN_ERR_W(svn_stream__create_for_install(stream,
                                            temp_dir_abspath,
@@ -390,12 +499,31 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   (*install_data)->inner_stream = *stream;
 
+  if (db->compress_pristines)
+    {
+      (*install_data)->compress_stream
+        = svn_stream__lz4_compressed(*stream, result_pool);
+      (*install_data)->text_size = 0;
+
+      *stream = svn_stream_create(*install_data, result_pool);
+      svn_stream_set_write(*stream, install_compressed_write);
+      svn_stream_set_close(*stream, install_compressed_close);
+    }
+
+  /* Calculate all requested checksums in a single pass. */
   if (md5_checksum)
-    *stream = svn_stream_checksummed2(*stream, NULL, md5_checksum,
-                                      svn_checksum_md5, FALSE, result_pool);
+    {
+      checksums[count] = md5_checksum;
+      kinds[count++] = svn_checksum_md5;
+    }
   if (sha1_checksum)
-    *stream = svn_stream_checksummed2(*stream, NULL, sha1_checksum,
-                                      svn_checksum_sha1, FALSE, result_pool);
+    {
+      checksums[count] = sha1_checksum;
+      kinds[count++] = svn_checksum_sha1;
+    }
+  if (count)
+    *stream = svn_checksum__wrap_write_stream_multi(checksums, kinds, count,
+                                                    *stream, result_pool);
 
   return SVN_NO_ERROR;
 }
@@ -422,7 +550,8 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
    * at the disk, to ensure no concurrent pristine install/delete txn. */
   SVN_SQLITE__WITH_IMMEDIATE_TXN(
     pristine_install_txn(wcroot->sdb,
-                         install_data->inner_stream, pristine_abspath,
+                         install_data->inner_stream,
+                         install_data->text_size, pristine_abspath,
                          sha1_checksum, md5_checksum,
                          scratch_pool),
     wcroot->sdb);
@@ -516,13 +645,16 @@ svn_wc__db_pristine_get_sha1(const svn_checksum_t **sha1_checksum,
 }
 
 /* Handle the moving of a pristine from SRC_WCROOT to DST_WCROOT. The existing
-   pristine in SRC_WCROOT is described by CHECKSUM, MD5_CHECKSUM and SIZE */
+   pristine in SRC_WCROOT is described by CHECKSUM, MD5_CHECKSUM, SIZE and
+   COMPRESSION, a PRISTINE.compression value or -1 for NULL.  The file is
+   copied as-is. */
 static svn_error_t *
 maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
                             svn_wc__db_wcroot_t *dst_wcroot,
                             const svn_checksum_t *checksum,
                             const svn_checksum_t *md5_checksum,
                             apr_int64_t size,
+                            int compression,
                             svn_cancel_func_t cancel_func,
                             void *cancel_baton,
                             apr_pool_t *scratch_pool)
@@ -541,6 +673,8 @@ maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, checksum, scratch_pool));
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
   SVN_ERR(svn_sqlite__bind_int64(stmt, 3, size));
+  if (compression != -1)
+    SVN_ERR(svn_sqlite__bind_int(stmt, 4, compression));
 
   SVN_ERR(svn_sqlite__update(&affected_rows, stmt));
 
@@ -625,6 +759,7 @@ pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
       const svn_checksum_t *checksum;
       const svn_checksum_t *md5_checksum;
       apr_int64_t size;
+      int compression;
       svn_error_t *err;
 
       svn_pool_clear(iterpool);
@@ -632,9 +767,12 @@ pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
       SVN_ERR(svn_sqlite__column_checksum(&checksum, stmt, 0, iterpool));
       SVN_ERR(svn_sqlite__column_checksum(&md5_checksum, stmt, 1, iterpool));
       size = svn_sqlite__column_int64(stmt, 2);
+      compression = svn_sqlite__column_is_null(stmt, 3)
+                      ? -1 : svn_sqlite__column_int(stmt, 3);
 
       err = maybe_transfer_one_pristine(src_wcroot, dst_wcroot,
                                         checksum, md5_checksum, size,
+                                        compression,
                                         cancel_func, cancel_baton,
                                         iterpool);
 
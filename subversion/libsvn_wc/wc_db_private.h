@@ -52,6 +52,17 @@ struct svn_wc__db_t {
   /* Busy timeout in ms., 0 for the libsvn_subr default. */
   apr_int32_t timeout;
 
+  /* Maximum number of threads to use for parallel working copy operations.
+     Always 1 if EXCLUSIVE is set. */
+  apr_int32_t worker_threads;
+
+  /* Should newly installed pristine texts be stored compressed? */
+  svn_boolean_t compress_pristines;
+
+  /* Lazily opened auxiliary DB handles for worker threads, see
+     svn_wc__db_get_worker_db().  svn_wc__db_t * elements; may be NULL. */
+  apr_array_header_t *worker_dbs;
+
   /* Map a given working copy directory to its relevant data.
      const char *local_abspath -> svn_wc__db_wcroot_t *wcroot  */
   apr_hash_t *dir_data;
@@ -232,6 +232,7 @@ svn_wc__db_open(svn_wc__db_t **db,
   (*db)->verify_format = !open_without_upgrade;
   (*db)->enforce_empty_wq = enforce_empty_wq;
   (*db)->dir_data = apr_hash_make(result_pool);
+  (*db)->worker_threads = 1;
 
   (*db)->state_pool = result_pool;
 
@@ -240,6 +241,7 @@ svn_wc__db_open(svn_wc__db_t **db,
     {
       svn_error_t *err;
       svn_boolean_t sqlite_exclusive = FALSE;
+      svn_boolean_t compress_pristines;
       apr_int64_t timeout;
 
       err = svn_config_get_bool(config, &sqlite_exclusive,
@@ -261,18 +263,128 @@ svn_wc__db_open(svn_wc__db_t **db,
         svn_error_clear(err);
       else
         (*db)->timeout = (apr_int32_t)timeout;
+
+      err = svn_config_get_bool(config, &compress_pristines,
+                                SVN_CONFIG_SECTION_WORKING_COPY,
+                                SVN_CONFIG_OPTION_COMPRESS_PRISTINES,
+                                FALSE);
+      if (err)
+        svn_error_clear(err);
+      else
+        (*db)->compress_pristines = compress_pristines;
+
+      /* Parallel scans need additional SQLite connections, which can't
+         coexist with exclusive locking. */
+      if (!(*db)->exclusive)
+        {
+          apr_int64_t worker_threads;
+
+          err = svn_config_get_int64(config, &worker_threads,
+                                     SVN_CONFIG_SECTION_WORKING_COPY,
+                                     SVN_CONFIG_OPTION_WORKER_THREADS,
+                                     1);
+          if (err || worker_threads < 1 || worker_threads > APR_INT32_MAX)
+            svn_error_clear(err);
+          else
+            (*db)->worker_threads = (apr_int32_t)worker_threads;
+        }
     }
 
   return SVN_NO_ERROR;
 }
 
 
+svn_error_t *
+svn_wc__db_open_similar(svn_wc__db_t **db,
+                        svn_wc__db_t *source_db,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_wc__db_open(db, source_db->config,
+                                         !source_db->verify_format,
+                                         source_db->enforce_empty_wq,
+                                         result_pool, scratch_pool));
+}
+
+
+apr_int32_t
+svn_wc__db_get_worker_threads(svn_wc__db_t *db)
+{
+  return db->worker_threads;
+}
+
+
+/* APR pool cleanup handler destroying the root pool given as BATON. */
+static apr_status_t
+destroy_worker_pool(void *baton)
+{
+  svn_pool_destroy(baton);
+  return APR_SUCCESS;
+}
+
+
+svn_error_t *
+svn_wc__db_get_worker_db(svn_wc__db_t **worker_db,
+                         svn_wc__db_t *db,
+                         int index,
+                         apr_pool_t *scratch_pool)
+{
+  SVN_ERR_ASSERT(index >= 0);
+
+  if (db->worker_dbs == NULL)
+    db->worker_dbs = apr_array_make(db->state_pool, index + 1,
+                                    sizeof(svn_wc__db_t *));
+
+  while (db->worker_dbs->nelts <= index)
+    APR_ARRAY_PUSH(db->worker_dbs, svn_wc__db_t *) = NULL;
+
+  if (APR_ARRAY_IDX(db->worker_dbs, index, svn_wc__db_t *) == NULL)
+    {
+      svn_wc__db_t *new_db;
+
+      /* The handle will be used from some other thread.  Give it a root
+         pool with its own, unsynchronized allocator and tie its lifetime
+         to DB. */
+      apr_pool_t *pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      apr_pool_cleanup_register(db->state_pool, pool, destroy_worker_pool,
+                                apr_pool_cleanup_null);
+
+      SVN_ERR(svn_wc__db_open(&new_db, db->config, !db->verify_format,
+                              FALSE /* enforce_empty_wq */,
+                              pool, scratch_pool));
+      APR_ARRAY_IDX(db->worker_dbs, index, svn_wc__db_t *) = new_db;
+    }
+
+  *worker_db = APR_ARRAY_IDX(db->worker_dbs, index, svn_wc__db_t *);
+
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_wc__db_close(svn_wc__db_t *db)
 {
   apr_pool_t *scratch_pool = db->state_pool;
   apr_hash_t *roots = apr_hash_make(scratch_pool);
   apr_hash_index_t *hi;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  /* Close the auxiliary worker handles first.  Their pools will be
+     reclaimed together with STATE_POOL. */
+  if (db->worker_dbs)
+    {
+      int i;
+      for (i = 0; i < db->worker_dbs->nelts; ++i)
+        {
+          svn_wc__db_t *worker_db
+            = APR_ARRAY_IDX(db->worker_dbs, i, svn_wc__db_t *);
+          if (worker_db)
+            err = svn_error_compose_create(err, svn_wc__db_close(worker_db));
+        }
+
+      db->worker_dbs = NULL;
+    }
 
   /* Collect all the unique WCROOT structures, and empty out DIR_DATA.  */
   for (hi = apr_hash_first(scratch_pool, db->dir_data);
@@ -289,8 +401,12 @@ svn_wc__db_close(svn_wc__db_t *db)
     }
 
   /* Run the cleanup for each WCROOT.  */
-  return svn_error_trace(svn_wc__db_close_many_wcroots(roots, db->state_pool,
-                                                       scratch_pool));
+  err = svn_error_compose_create(err,
+                                 svn_wc__db_close_many_wcroots(roots,
+                                                               db->state_pool,
+                                                               scratch_pool));
+
+  return svn_error_trace(err);
 }
 
 
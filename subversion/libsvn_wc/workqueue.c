@@ -22,6 +22,7 @@
  */
 
 #include <apr_pools.h>
+#include <apr_lib.h>
 
 #include "svn_private_config.h"
 #include "svn_types.h"
@@ -42,6 +43,7 @@
 #include "private/svn_io_private.h"
 #include "private/svn_wc_private.h"
 #include "private/svn_skel.h"
+#include "private/svn_task.h"
 
 
 /* Workqueue operation names.  */
@@ -66,6 +68,14 @@
 /* For work queue debugging. Generates output about its operation.  */
 /* #define SVN_DEBUG_WORK_QUEUE */
 
+/* Maximum number of work items to fetch at once when running the queue
+   with multiple worker threads. */
+#define WQ_BATCH_SIZE 256
+
+/* Only use worker threads if there are at least this many independent
+   work items in a row.  Smaller runs are not worth the overhead. */
+#define WQ_MIN_CONCURRENT_ITEMS 4
+
 typedef struct work_item_baton_t
 {
   apr_pool_t *result_pool; /* Pool to allocate result in */
@@ -555,10 +565,8 @@ run_file_install(work_item_baton_t *wqb,
     }
   else
     {
-      SVN_ERR(svn_wc__db_pristine_get_future_path(&source_abspath,
-                                                  wcroot_abspath,
-                                                  checksum,
-                                                  scratch_pool, scratch_pool));
+      /* Read from the pristine store, which may keep the text compressed. */
+      source_abspath = NULL;
     }
 
   /* Where is the Right Place to put a temp file in this working copy?  */
@@ -627,8 +635,12 @@ run_file_install(work_item_baton_t *wqb,
                                            scratch_pool,
                                            scratch_pool));
 
-  SVN_ERR(svn_stream_open_readonly(&src_stream, source_abspath,
-                                   scratch_pool, scratch_pool));
+  if (source_abspath)
+    SVN_ERR(svn_stream_open_readonly(&src_stream, source_abspath,
+                                     scratch_pool, scratch_pool));
+  else
+    SVN_ERR(svn_wc__db_pristine_read(&src_stream, NULL, db, wcroot_abspath,
+                                     checksum, scratch_pool, scratch_pool));
 
   SVN_ERR(svn_stream_copy3(src_stream,
                            svn_wc__working_file_writer_get_stream(file_writer),
@@ -1500,6 +1512,386 @@ dispatch_work_item(work_item_baton_t *wqb,
 }
 
 
+/* Return an error wrapping ERR, reporting that WORK_ITEM with identifier ID
+   in the work queue of WRI_ABSPATH failed.  Use SCRATCH_POOL for
+   temporaries. */
+static svn_error_t *
+work_item_error(svn_error_t *err,
+                const char *wri_abspath,
+                apr_uint64_t id,
+                const svn_skel_t *work_item,
+                apr_pool_t *scratch_pool)
+{
+  const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
+
+  return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
+                           _("Failed to run the WC DB work queue "
+                             "associated with '%s', work item %d %s"),
+                           svn_dirent_local_style(wri_abspath,
+                                                  scratch_pool),
+                           (int)id, skel);
+}
+
+/* If PATH has already been added to PATHS, return FALSE.  Otherwise,
+   add it and return TRUE.  Compare case-insensitively because different
+   paths may still refer to the same file on some file systems. */
+static svn_boolean_t
+claim_path(apr_hash_t *paths,
+           const svn_skel_t *path)
+{
+  apr_pool_t *pool = apr_hash_pool_get(paths);
+  char *key = apr_pstrmemdup(pool, path->data, path->len);
+  char *p;
+
+  for (p = key; *p; ++p)
+    *p = (char)apr_tolower(*p);
+
+  if (apr_hash_get(paths, key, path->len))
+    return FALSE;
+
+  apr_hash_set(paths, key, path->len, key);
+  return TRUE;
+}
+
+/* Return the number of work items in WORK_ITEMS, starting at index START,
+   that may be run in parallel.  These must be file installs or
+   translations that don't share any path.  Use SCRATCH_POOL for
+   temporaries. */
+static int
+count_independent_items(const apr_array_header_t *work_items,
+                        int start,
+                        apr_pool_t *scratch_pool)
+{
+  apr_hash_t *paths = apr_hash_make(scratch_pool);
+  int i;
+
+  for (i = start; i < work_items->nelts; ++i)
+    {
+      const svn_skel_t *work_item
+        = APR_ARRAY_IDX(work_items, i, const svn_skel_t *);
+      const svn_skel_t *arg1 = work_item->children->next;
+
+      if (svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL))
+        {
+          /* Target and, optionally, explicit source. */
+          const svn_skel_t *arg4 = arg1->next->next->next;
+
+          if (!claim_path(paths, arg1))
+            break;
+          if (arg4 && !claim_path(paths, arg4))
+            break;
+        }
+      else if (svn_skel__matches_atom(work_item->children,
+                                      OP_FILE_COPY_TRANSLATED))
+        {
+          /* Versioned node, source and destination. */
+          if (   !claim_path(paths, arg1)
+              || !claim_path(paths, arg1->next)
+              || !claim_path(paths, arg1->next->next))
+            break;
+        }
+      else
+        {
+          /* Anything else must be run in queue order. */
+          break;
+        }
+    }
+
+  return i - start;
+}
+
+/* Parameters of a single work item to run as a task. */
+typedef struct work_item_task_baton_t
+{
+  const char *wri_abspath;
+  apr_uint64_t id;
+  const svn_skel_t *work_item;
+} work_item_task_baton_t;
+
+/* Parameters for the root task that runs the first COUNT work items
+   from IDS and WORK_ITEMS. */
+typedef struct work_items_baton_t
+{
+  /* Collects the file info recorded by all items. */
+  work_item_baton_t *wib;
+
+  const char *wri_abspath;
+  const apr_array_header_t *ids;
+  const apr_array_header_t *work_items;
+  int count;
+} work_items_baton_t;
+
+/* Baton for open_worker_db(). */
+typedef struct worker_db_baton_t
+{
+  svn_wc__db_t *db;
+  int next_index;
+} worker_db_baton_t;
+
+/* Implements svn_task__thread_context_constructor_t.
+
+   Return the next auxiliary DB handle of the svn_wc__db_t given in the
+   worker_db_baton_t CONTEXT_BATON in *THREAD_CONTEXT. */
+static svn_error_t *
+open_worker_db(void **thread_context,
+               void *context_baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  worker_db_baton_t *b = context_baton;
+  svn_wc__db_t *worker_db;
+
+  SVN_ERR(svn_wc__db_get_worker_db(&worker_db, b->db, b->next_index++,
+                                   scratch_pool));
+  *thread_context = worker_db;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t.
+
+   Run the work item described by the work_item_task_baton_t PROCESS_BATON
+   against the svn_wc__db_t THREAD_CONTEXT.  Return the recorded file info
+   map, if any, in *RESULT. */
+static svn_error_t *
+work_item_process(void **result,
+                  svn_task__t *task,
+                  void *thread_context,
+                  void *process_baton,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  work_item_task_baton_t *b = process_baton;
+  work_item_baton_t wib = { 0 };
+  svn_error_t *err;
+
+  wib.result_pool = result_pool;
+
+  err = dispatch_work_item(&wib, thread_context, b->wri_abspath,
+                           b->work_item, cancel_func, cancel_baton,
+                           scratch_pool);
+  if (err)
+    return work_item_error(err, b->wri_abspath, b->id, b->work_item,
+                           scratch_pool);
+
+  *result = wib.used ? wib.record_map : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+
+   Add the file info map RESULT to the work_item_baton_t OUTPUT_BATON. */
+static svn_error_t *
+work_item_output(svn_task__t *task,
+                 void *result,
+                 void *output_baton,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  work_item_baton_t *wib = output_baton;
+  apr_hash_t *record_map = result;
+  apr_hash_index_t *hi;
+
+  if (!record_map)
+    return SVN_NO_ERROR;
+
+  for (hi = apr_hash_first(scratch_pool, record_map);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const svn_wc__db_fileinfo_t *info = apr_hash_this_val(hi);
+      wq_record_fileinfo(wib, apr_hash_this_key(hi), info->mtime,
+                         info->size);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__process_func_t for the root task.
+
+   Add one sub-task per work item described by the work_items_baton_t
+   PROCESS_BATON. */
+static svn_error_t *
+work_items_process(void **result,
+                   svn_task__t *task,
+                   void *thread_context,
+                   void *process_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  work_items_baton_t *b = process_baton;
+  int i;
+
+  for (i = 0; i < b->count; ++i)
+    {
+      apr_pool_t *process_pool = svn_task__create_process_pool(task);
+      work_item_task_baton_t *item_baton
+        = apr_pcalloc(process_pool, sizeof(*item_baton));
+
+      item_baton->wri_abspath = b->wri_abspath;
+      item_baton->id = APR_ARRAY_IDX(b->ids, i, apr_uint64_t);
+      item_baton->work_item = APR_ARRAY_IDX(b->work_items, i,
+                                            const svn_skel_t *);
+
+      SVN_ERR(svn_task__add(task, process_pool, NULL,
+                            work_item_process, item_baton,
+                            work_item_output, b->wib));
+    }
+
+  *result = NULL;
+  return SVN_NO_ERROR;
+}
+
+/* Run the first COUNT items of WORK_ITEMS, with identifiers IDS, in the
+   work queue of WRI_ABSPATH in DB using up to THREAD_COUNT worker threads.
+   The items must be independent of each other.  Add the file info that
+   they record to WIB.  Use SCRATCH_POOL for temporaries.
+
+   If any items fail, return the error of the first failing one in queue
+   order. */
+static svn_error_t *
+run_items_concurrently(work_item_baton_t *wib,
+                       svn_wc__db_t *db,
+                       const char *wri_abspath,
+                       const apr_array_header_t *ids,
+                       const apr_array_header_t *work_items,
+                       int count,
+                       apr_int32_t thread_count,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *scratch_pool)
+{
+  work_items_baton_t b;
+  worker_db_baton_t db_baton;
+
+  b.wib = wib;
+  b.wri_abspath = wri_abspath;
+  b.ids = ids;
+  b.work_items = work_items;
+  b.count = count;
+
+  db_baton.db = db;
+  db_baton.next_index = 0;
+
+  return svn_error_trace(svn_task__run(count < thread_count ? count
+                                                            : thread_count,
+                                       work_items_process, &b,
+                                       NULL, NULL,
+                                       open_worker_db, &db_baton,
+                                       cancel_func, cancel_baton,
+                                       scratch_pool, scratch_pool));
+}
+
+/* Implement svn_wc__wq_run for THREAD_COUNT > 1.
+
+   Fetch the queue in batches.  Runs of independent file installs and
+   translations get processed in parallel.  Everything else, including
+   the DB bookkeeping, happens in this thread and in queue order. */
+static svn_error_t *
+wq_run_concurrently(svn_wc__db_t *db,
+                    const char *wri_abspath,
+                    apr_int32_t thread_count,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *item_pool = svn_pool_create(scratch_pool);
+  apr_array_header_t *completed_ids = NULL;
+  work_item_baton_t wib = { 0 };
+  wib.result_pool = svn_pool_create(scratch_pool);
+
+  while (TRUE)
+    {
+      apr_array_header_t *ids;
+      apr_array_header_t *work_items;
+      int i;
+
+      svn_pool_clear(iterpool);
+
+      /* Mark everything processed so far as completed, store recorded
+         file info and get the next batch, all in one transaction. */
+      SVN_ERR(svn_wc__db_wq_record_and_fetch_batch(&ids, &work_items,
+                                                   db, wri_abspath,
+                                                   completed_ids,
+                                                   wib.used
+                                                     ? wib.record_map
+                                                     : NULL,
+                                                   WQ_BATCH_SIZE,
+                                                   iterpool, iterpool));
+
+      svn_pool_clear(wib.result_pool);
+      wib.record_map = NULL;
+      wib.used = FALSE;
+      completed_ids = apr_array_make(wib.result_pool, ids->nelts,
+                                     sizeof(apr_uint64_t));
+
+      /* Stop work queue processing, if requested. A future 'svn cleanup'
+         should be able to continue the processing. */
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      if (ids->nelts == 0)
+        break;
+
+      for (i = 0; i < ids->nelts; ++i)
+        {
+          apr_uint64_t id = APR_ARRAY_IDX(ids, i, apr_uint64_t);
+          const svn_skel_t *work_item
+            = APR_ARRAY_IDX(work_items, i, const svn_skel_t *);
+          int count;
+          svn_error_t *err;
+
+          svn_pool_clear(item_pool);
+
+          count = count_independent_items(work_items, i, item_pool);
+          if (count >= WQ_MIN_CONCURRENT_ITEMS)
+            {
+              /* Complete everything before this run first. */
+              if (i > 0)
+                break;
+
+              SVN_ERR(run_items_concurrently(&wib, db, wri_abspath,
+                                             ids, work_items, count,
+                                             thread_count,
+                                             cancel_func, cancel_baton,
+                                             item_pool));
+
+              for (; i < count; ++i)
+                APR_ARRAY_PUSH(completed_ids, apr_uint64_t)
+                  = APR_ARRAY_IDX(ids, i, apr_uint64_t);
+
+              break;
+            }
+
+          /* Recorded file info must be in the DB before processing
+             further items in order. */
+          if (wib.used)
+            break;
+
+          err = dispatch_work_item(&wib, db, wri_abspath, work_item,
+                                   cancel_func, cancel_baton, item_pool);
+          if (err)
+            return work_item_error(err, wri_abspath, id, work_item,
+                                   scratch_pool);
+
+          APR_ARRAY_PUSH(completed_ids, apr_uint64_t) = id;
+        }
+    }
+
+  svn_pool_destroy(item_pool);
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_wc__wq_run(svn_wc__db_t *db,
                const char *wri_abspath,
@@ -1507,10 +1899,10 @@ svn_wc__wq_run(svn_wc__db_t *db,
                void *cancel_baton,
                apr_pool_t *scratch_pool)
 {
-  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *iterpool;
   apr_uint64_t last_id = 0;
+  apr_int32_t thread_count = svn_wc__db_get_worker_threads(db);
   work_item_baton_t wib = { 0 };
-  wib.result_pool = svn_pool_create(scratch_pool);
 
 #ifdef SVN_DEBUG_WORK_QUEUE
   SVN_DBG(("wq_run: wri='%s'\n", wri_abspath));
@@ -1526,6 +1918,14 @@ svn_wc__wq_run(svn_wc__db_t *db,
   }
 #endif
 
+  if (thread_count > 1)
+    return svn_error_trace(wq_run_concurrently(db, wri_abspath, thread_count,
+                                               cancel_func, cancel_baton,
+                                               scratch_pool));
+
+  iterpool = svn_pool_create(scratch_pool);
+  wib.result_pool = svn_pool_create(scratch_pool);
+
   while (TRUE)
     {
       apr_uint64_t id;
@@ -1572,16 +1972,8 @@ svn_wc__wq_run(svn_wc__db_t *db,
       err = dispatch_work_item(&wib, db, wri_abspath, work_item,
                                cancel_func, cancel_baton, iterpool);
       if (err)
-        {
-          const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
-
-          return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
-                                   _("Failed to run the WC DB work queue "
-                                     "associated with '%s', work item %d %s"),
-                                   svn_dirent_local_style(wri_abspath,
-                                                          scratch_pool),
-                                   (int)id, skel);
-        }
+        return work_item_error(err, wri_abspath, id, work_item,
+                               scratch_pool);
 
       /* The work item finished without error. Mark it completed
          in the next loop.  */
@@ -120,6 +120,10 @@ extern module AP_MODULE_DECLARE_DATA dav_svn_module;
 /* The authz_svn provider for bypassing path authz. */
 static authz_svn__subreq_bypass_func_t pathauthz_bypass_func = NULL;
 
+/* Whether all httpd child processes shall share one in-memory cache
+ * (see SVNSharedCache). */
+static svn_boolean_t share_cache = FALSE;
+
 static int
 init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
 {
@@ -150,6 +154,21 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
   conf = ap_get_module_config(s->module_config, &dav_svn_module);
   svn_utf_initialize2(conf->use_utf8, p);
 
+  /* Create the cache before httpd forks its children.  If that fails,
+   * every child will simply use a private cache. */
+  if (share_cache)
+    {
+      serr = svn_cache_config_share();
+      if (serr)
+        {
+          ap_log_perror(APLOG_MARK, APLOG_WARNING, serr->apr_err, p,
+                        "mod_dav_svn: can't share the in-memory cache "
+                        "between processes: '%s'",
+                        serr->message ? serr->message : "(no more info)");
+          svn_error_clear(serr);
+        }
+    }
+
   return OK;
 }
 
@@ -631,6 +650,14 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNSharedCache_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  share_cache = arg;
+
+  return NULL;
+}
+
 static const char *
 SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -1395,6 +1422,14 @@ static const command_rec cmds[] =
                 "specifies the maximum size in kB per process of Subversion's "
                 "in-memory object cache (default value is 16384; 0 switches "
                 "to dynamically sized caches)."),
+
+  /* per server */
+  AP_INIT_FLAG("SVNSharedCache", SVNSharedCache_cmd, NULL,
+               RSRC_CONF,
+               "lets all httpd processes share a single in-memory object "
+               "cache of the size given by SVNInMemoryCacheSize "
+               "(default is Off)."),
+
   /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
@@ -53,6 +53,7 @@
 #include "mod_dav_svn.h"
 #include "svn_ra.h"  /* for SVN_RA_CAPABILITY_* */
 #include "svn_dirent_uri.h"
+#include "private/svn_io_private.h"
 #include "private/svn_log.h"
 #include "private/svn_fspath.h"
 #include "private/svn_repos_private.h"
@@ -1771,7 +1772,9 @@ static int sort_encoding_pref(const void *accept_rec1, const void *accept_rec2)
 
 static int get_svndiff_version(const struct accept_rec *rec)
 {
-  if (strcmp(rec->name, "svndiff2") == 0)
+  if (strcmp(rec->name, "svndiff3") == 0)
+    return 3;
+  else if (strcmp(rec->name, "svndiff2") == 0)
     return 2;
   else if (strcmp(rec->name, "svndiff1") == 0)
     return 1;
@@ -3943,6 +3946,7 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
   /* resource->info->delta_base is NULL, or we had an invalid base URL */
     {
       svn_stream_t *stream;
+      apr_file_t *file;
       char *block;
 
       serr = svn_fs_file_contents(&stream,
@@ -4027,6 +4031,45 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
             }
         }
 
+      /* Plain files, e.g. large FSX fulltexts or large PLAIN FSFS reps,
+         can be passed on as a file bucket.  That allows httpd to send
+         them using sendfile(). */
+      file = svn_stream__aprfile(stream);
+      if (file)
+        {
+          apr_off_t start;
+          apr_off_t end = svn_stream__aprfile_end(stream);
+
+          serr = svn_io_file_get_offset(&start, file, resource->pool);
+          if (serr == NULL && end < 0)
+            {
+              svn_filesize_t size;
+
+              serr = svn_io_file_size_get(&size, file, resource->pool);
+              end = size;
+            }
+          if (serr != NULL)
+            return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                        "could not read the file contents",
+                                        resource->pool);
+
+          bb = apr_brigade_create(resource->pool,
+                                  dav_svn__output_get_bucket_alloc(output));
+          apr_brigade_insert_file(bb, file, start, end - start,
+                                  resource->pool);
+          bkt = apr_bucket_eos_create(
+                  dav_svn__output_get_bucket_alloc(output));
+          APR_BRIGADE_INSERT_TAIL(bb, bkt);
+          serr = dav_svn__output_pass_brigade(output, bb);
+          apr_brigade_destroy(bb);
+          if (serr != NULL)
+            return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                        "Could not write data to filter.",
+                                        resource->pool);
+
+          return NULL;
+        }
+
       /* ### one day in the future, we can create a custom bucket type
          ### which will read from the FS stream on demand */
 
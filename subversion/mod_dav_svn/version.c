@@ -198,6 +198,7 @@ get_option(const dav_resource *resource,
     { SVN_DAV_NS_DAV_SVN_SVNDIFF1,            { 1, 10, 0, ""} },
     { SVN_DAV_NS_DAV_SVN_SVNDIFF2,            { 1, 10, 0, ""} },
     { SVN_DAV_NS_DAV_SVN_PUT_RESULT_CHECKSUM, { 1, 10, 0, ""} },
+    { SVN_DAV_NS_DAV_SVN_SVNDIFF3,            { 1, 15, 0, ""} },
   };
 
   /* ### DAV:version-history-collection-set */
@@ -495,6 +495,22 @@ print_progress(svn_revnum_t revision,
   fflush(stdout);
 }
 
+/* Implements svn_fs_fs__open_fs_func_t.
+ *
+ * Open another instance of the repository given by the svnfsfs__opt_state
+ * in BATON.
+ */
+static svn_error_t *
+open_worker_fs(svn_fs_t **fs,
+               void *baton,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+  return svn_error_trace(open_fs(fs, opt_state->repository_path,
+                                 result_pool));
+}
+
 /* This implements `svn_opt_subcommand_t'. */
 svn_error_t *
 subcommand__stats(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -508,6 +524,9 @@ subcommand__stats(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   SVN_ERR(open_fs(&fs, opt_state->repository_path, pool));
 
   input.progress_func = print_progress;
+  input.thread_count = opt_state->jobs;
+  input.open_fs_func = open_worker_fs;
+  input.open_fs_baton = opt_state;
   SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_STATS, &input, (void **)&output,
                        check_cancel, NULL, pool, pool));
   print_stats(output->stats, pool);
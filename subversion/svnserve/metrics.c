@@ -0,0 +1,530 @@
+/*
+ * metrics.c : Implementation of the svnserve command metrics
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#define APR_WANT_STRFUNC
+#include <apr_want.h>
+
+#include "svn_error.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_cache.h"
+#include "private/svn_mutex.h"
+#include "private/svn_ra_svn_private.h"
+#include "private/svn_sorts_private.h"
+
+#include "svn_private_config.h"
+#include "metrics.h"
+
+/* Upper bound of a histogram bucket and its label in the output. */
+typedef struct bucket_t
+{
+  apr_uint64_t bound;
+  const char *label;
+} bucket_t;
+
+/* Maximum number of finite buckets in any of our histograms. */
+#define MAX_BUCKETS 12
+
+/* Buckets for the command latency in microseconds. */
+static const bucket_t latency_buckets[] =
+  {
+    {     1000, "0.001" },
+    {     5000, "0.005" },
+    {    10000, "0.01" },
+    {    50000, "0.05" },
+    {   100000, "0.1" },
+    {   500000, "0.5" },
+    {  1000000, "1" },
+    {  5000000, "5" },
+    { 10000000, "10" },
+    { 60000000, "60" },
+    {        0, NULL }
+  };
+
+/* Buckets for request and response sizes in bytes. */
+static const bucket_t size_buckets[] =
+  {
+    {        256, "256" },
+    {       4096, "4096" },
+    {      65536, "65536" },
+    {    1048576, "1048576" },
+    {   16777216, "16777216" },
+    {  268435456, "268435456" },
+    {          0, NULL }
+  };
+
+/* A histogram over the values passed to histogram_add(). */
+typedef struct histogram_t
+{
+  /* Number of values that fell into the respective bucket, i.e. were
+   * larger than the previous bucket's bound but did not exceed the bound
+   * of this one.  The entry after the last finite bucket counts all
+   * values exceeding the largest bound. */
+  apr_uint64_t counts[MAX_BUCKETS + 1];
+
+  /* Sum of all values. */
+  apr_uint64_t sum;
+
+  /* Total number of values. */
+  apr_uint64_t count;
+} histogram_t;
+
+/* Statistics for a single command. */
+typedef struct command_metrics_t
+{
+  /* Name of the command, e.g. "get-file". */
+  const char *name;
+
+  /* Time spent processing the command, in microseconds. */
+  histogram_t latency;
+
+  /* Bytes received for and sent in response to the command. */
+  histogram_t bytes_in;
+  histogram_t bytes_out;
+
+  /* Number of times the command returned an error. */
+  apr_uint64_t failures;
+
+  /* Number of global membuffer cache reads and hits while processing the
+   * command.  With concurrent connections, this will include accesses
+   * made by other commands running at the same time. */
+  apr_uint64_t cache_gets;
+  apr_uint64_t cache_hits;
+} command_metrics_t;
+
+struct metrics_t
+{
+  /* command name -> command_metrics_t * */
+  apr_hash_t *commands;
+
+  /* mutex used to serialize access to this structure */
+  svn_mutex__t *mutex;
+
+  /* pool to allocate new COMMANDS entries in */
+  apr_pool_t *pool;
+};
+
+/* Per-connection baton for the ra_svn command hooks. */
+typedef struct connection_metrics_t
+{
+  /* The server-wide collection to update. */
+  metrics_t *metrics;
+
+  /* Global cache access counters at the start of the current command. */
+  apr_uint64_t cache_gets;
+  apr_uint64_t cache_hits;
+} connection_metrics_t;
+
+svn_error_t *
+metrics__create(metrics_t **metrics,
+                apr_pool_t *pool)
+{
+  metrics_t *result = apr_pcalloc(pool, sizeof(*result));
+  result->commands = apr_hash_make(pool);
+  result->pool = pool;
+
+  SVN_ERR(svn_mutex__init(&result->mutex, TRUE, pool));
+
+  *metrics = result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Add VALUE to HISTOGRAM using the bucket definitions in BUCKETS. */
+static void
+histogram_add(histogram_t *histogram,
+              const bucket_t *buckets,
+              apr_uint64_t value)
+{
+  int i;
+  for (i = 0; buckets[i].label && value > buckets[i].bound; ++i)
+    ;
+
+  histogram->counts[i]++;
+  histogram->sum += value;
+  histogram->count++;
+}
+
+/* Implement svn_ra_svn__command_start_func_t. */
+static svn_error_t *
+command_start(void *baton,
+              const char *cmdname,
+              apr_pool_t *scratch_pool)
+{
+  connection_metrics_t *cm = baton;
+  svn_cache__membuffer_get_global_access_counts(&cm->cache_gets,
+                                                &cm->cache_hits);
+
+  return SVN_NO_ERROR;
+}
+
+/* Update the statistics of command CMDNAME in METRICS with DURATION,
+ * BYTES_IN, BYTES_OUT, FAILED as well as CACHE_GETS and CACHE_HITS.
+ * The caller must hold METRICS->MUTEX.
+ */
+static svn_error_t *
+record_command(metrics_t *metrics,
+               const char *cmdname,
+               apr_interval_time_t duration,
+               apr_uint64_t bytes_in,
+               apr_uint64_t bytes_out,
+               svn_boolean_t failed,
+               apr_uint64_t cache_gets,
+               apr_uint64_t cache_hits)
+{
+  command_metrics_t *command = svn_hash_gets(metrics->commands, cmdname);
+  if (command == NULL)
+    {
+      command = apr_pcalloc(metrics->pool, sizeof(*command));
+      command->name = apr_pstrdup(metrics->pool, cmdname);
+      svn_hash_sets(metrics->commands, command->name, command);
+    }
+
+  histogram_add(&command->latency, latency_buckets,
+                duration > 0 ? (apr_uint64_t)duration : 0);
+  histogram_add(&command->bytes_in, size_buckets, bytes_in);
+  histogram_add(&command->bytes_out, size_buckets, bytes_out);
+
+  if (failed)
+    command->failures++;
+
+  command->cache_gets += cache_gets;
+  command->cache_hits += cache_hits;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_ra_svn__command_done_func_t. */
+static svn_error_t *
+command_done(void *baton,
+             const char *cmdname,
+             apr_interval_time_t duration,
+             apr_uint64_t bytes_in,
+             apr_uint64_t bytes_out,
+             svn_boolean_t failed,
+             apr_pool_t *scratch_pool)
+{
+  connection_metrics_t *cm = baton;
+  apr_uint64_t cache_gets, cache_hits;
+
+  svn_cache__membuffer_get_global_access_counts(&cache_gets, &cache_hits);
+
+  /* The counters are read without locking and may be reset. */
+  cache_gets = cache_gets >= cm->cache_gets ? cache_gets - cm->cache_gets : 0;
+  cache_hits = cache_hits >= cm->cache_hits ? cache_hits - cm->cache_hits : 0;
+
+  SVN_MUTEX__WITH_LOCK(cm->metrics->mutex,
+                       record_command(cm->metrics, cmdname, duration,
+                                      bytes_in, bytes_out, failed,
+                                      cache_gets, cache_hits));
+
+  return SVN_NO_ERROR;
+}
+
+void
+metrics__attach(metrics_t *metrics,
+                svn_ra_svn_conn_t *conn,
+                apr_pool_t *pool)
+{
+  connection_metrics_t *cm = apr_pcalloc(pool, sizeof(*cm));
+  cm->metrics = metrics;
+
+  svn_ra_svn__set_command_hooks(conn, command_start, command_done, cm);
+}
+
+/* Set *COMMANDS to a copy of all command_metrics_t in METRICS, sorted by
+ * command name.  Allocate the result in RESULT_POOL.
+ * The caller must hold METRICS->MUTEX.
+ */
+static svn_error_t *
+copy_commands(apr_array_header_t **commands,
+              metrics_t *metrics,
+              apr_pool_t *result_pool)
+{
+  apr_array_header_t *sorted
+    = svn_sort__hash(metrics->commands, svn_sort_compare_items_lexically,
+                     result_pool);
+  int i;
+
+  *commands = apr_array_make(result_pool, sorted->nelts,
+                             sizeof(command_metrics_t));
+  for (i = 0; i < sorted->nelts; ++i)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(sorted, i, svn_sort__item_t);
+      APR_ARRAY_PUSH(*commands, command_metrics_t)
+        = *(const command_metrics_t *)item->value;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the HELP and TYPE lines for metric NAME of type TYPE with
+ * description HELP to STREAM.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_header(svn_stream_t *stream,
+             const char *name,
+             const char *type,
+             const char *help,
+             apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_stream_printf(stream, scratch_pool,
+                                           "# HELP %s %s\n"
+                                           "# TYPE %s %s\n",
+                                           name, help, name, type));
+}
+
+/* Write the histogram metric NAME with description HELP for all COMMANDS
+ * to STREAM.  GET_HISTOGRAM selects the histogram from each command and
+ * BUCKETS defines its buckets.  Values get divided by SCALE for output.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_histograms(svn_stream_t *stream,
+                 const char *name,
+                 const char *help,
+                 const apr_array_header_t *commands,
+                 const histogram_t *(*get_histogram)(
+                                        const command_metrics_t *command),
+                 const bucket_t *buckets,
+                 apr_uint64_t scale,
+                 apr_pool_t *scratch_pool)
+{
+  int i, k;
+
+  SVN_ERR(write_header(stream, name, "histogram", help, scratch_pool));
+  for (i = 0; i < commands->nelts; ++i)
+    {
+      const command_metrics_t *command
+        = &APR_ARRAY_IDX(commands, i, command_metrics_t);
+      const histogram_t *histogram = get_histogram(command);
+      apr_uint64_t cumulative = 0;
+
+      /* Prometheus buckets are cumulative. */
+      for (k = 0; buckets[k].label; ++k)
+        {
+          cumulative += histogram->counts[k];
+          SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                                    "%s_bucket{command=\"%s\",le=\"%s\"} %"
+                                    APR_UINT64_T_FMT "\n",
+                                    name, command->name, buckets[k].label,
+                                    cumulative));
+        }
+
+      SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                                "%s_bucket{command=\"%s\",le=\"+Inf\"} %"
+                                APR_UINT64_T_FMT "\n",
+                                name, command->name, histogram->count));
+      if (scale == 1)
+        SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                                  "%s_sum{command=\"%s\"} %"
+                                  APR_UINT64_T_FMT "\n",
+                                  name, command->name, histogram->sum));
+      else
+        SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                                  "%s_sum{command=\"%s\"} %.6f\n",
+                                  name, command->name,
+                                  (double)histogram->sum / (double)scale));
+      SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                                "%s_count{command=\"%s\"} %"
+                                APR_UINT64_T_FMT "\n",
+                                name, command->name, histogram->count));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Selectors for write_histograms(). */
+static const histogram_t *
+get_latency(const command_metrics_t *command)
+{
+  return &command->latency;
+}
+
+static const histogram_t *
+get_bytes_in(const command_metrics_t *command)
+{
+  return &command->bytes_in;
+}
+
+static const histogram_t *
+get_bytes_out(const command_metrics_t *command)
+{
+  return &command->bytes_out;
+}
+
+/* Selectors for write_counters(). */
+static apr_uint64_t
+get_failures(const command_metrics_t *command)
+{
+  return command->failures;
+}
+
+static apr_uint64_t
+get_cache_gets(const command_metrics_t *command)
+{
+  return command->cache_gets;
+}
+
+static apr_uint64_t
+get_cache_hits(const command_metrics_t *command)
+{
+  return command->cache_hits;
+}
+
+/* Write the counter metric NAME with description HELP for all COMMANDS
+ * to STREAM.  GET_COUNTER selects the value from each command.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_counters(svn_stream_t *stream,
+               const char *name,
+               const char *help,
+               const apr_array_header_t *commands,
+               apr_uint64_t (*get_counter)(const command_metrics_t *command),
+               apr_pool_t *scratch_pool)
+{
+  int i;
+
+  SVN_ERR(write_header(stream, name, "counter", help, scratch_pool));
+  for (i = 0; i < commands->nelts; ++i)
+    {
+      const command_metrics_t *command
+        = &APR_ARRAY_IDX(commands, i, command_metrics_t);
+
+      SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                                "%s{command=\"%s\"} %" APR_UINT64_T_FMT "\n",
+                                name, command->name, get_counter(command)));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the global membuffer cache statistics to STREAM.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_cache_info(svn_stream_t *stream,
+                 apr_pool_t *scratch_pool)
+{
+  svn_cache__info_t *info;
+
+  /* svn_cache__membuffer_get_global_info() requires a cache. */
+  if (svn_cache__get_global_membuffer_cache() == NULL)
+    return SVN_NO_ERROR;
+
+  info = svn_cache__membuffer_get_global_info(scratch_pool);
+
+  SVN_ERR(write_header(stream, "svnserve_cache_gets_total", "counter",
+                       "Read accesses to the FS cache.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_cache_gets_total %"
+                            APR_UINT64_T_FMT "\n", info->gets));
+  SVN_ERR(write_header(stream, "svnserve_cache_hits_total", "counter",
+                       "Read accesses to the FS cache that found data.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_cache_hits_total %"
+                            APR_UINT64_T_FMT "\n", info->hits));
+  SVN_ERR(write_header(stream, "svnserve_cache_hit_ratio", "gauge",
+                       "Fraction of FS cache reads that found data.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_cache_hit_ratio %.6f\n",
+                            info->gets
+                              ? (double)info->hits / (double)info->gets
+                              : 0.0));
+  SVN_ERR(write_header(stream, "svnserve_cache_used_bytes", "gauge",
+                       "Size of the data currently in the FS cache.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_cache_used_bytes %"
+                            APR_UINT64_T_FMT "\n", info->used_size));
+  SVN_ERR(write_header(stream, "svnserve_cache_size_bytes", "gauge",
+                       "Memory allocated to the FS cache.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_cache_size_bytes %"
+                            APR_UINT64_T_FMT "\n", info->total_size));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+metrics__write(metrics_t *metrics,
+               svn_stream_t *stream,
+               apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *commands;
+
+  /* Don't block the connections while we format the output. */
+  SVN_MUTEX__WITH_LOCK(metrics->mutex,
+                       copy_commands(&commands, metrics, scratch_pool));
+
+  SVN_ERR(write_histograms(stream, "svnserve_command_duration_seconds",
+                           "Time spent processing svnserve commands.",
+                           commands, get_latency, latency_buckets,
+                           APR_USEC_PER_SEC, scratch_pool));
+  SVN_ERR(write_histograms(stream, "svnserve_command_request_bytes",
+                           "Bytes received for svnserve commands.",
+                           commands, get_bytes_in, size_buckets, 1,
+                           scratch_pool));
+  SVN_ERR(write_histograms(stream, "svnserve_command_response_bytes",
+                           "Bytes sent in response to svnserve commands.",
+                           commands, get_bytes_out, size_buckets, 1,
+                           scratch_pool));
+  SVN_ERR(write_counters(stream, "svnserve_command_failures_total",
+                         "svnserve commands that returned an error.",
+                         commands, get_failures, scratch_pool));
+  SVN_ERR(write_counters(stream, "svnserve_command_cache_gets_total",
+                         "FS cache reads while processing the command.",
+                         commands, get_cache_gets, scratch_pool));
+  SVN_ERR(write_counters(stream, "svnserve_command_cache_hits_total",
+                         "FS cache hits while processing the command.",
+                         commands, get_cache_hits, scratch_pool));
+
+  return svn_error_trace(write_cache_info(stream, scratch_pool));
+}
+
+svn_error_t *
+metrics__write_file(metrics_t *metrics,
+                    const char *filename,
+                    apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(scratch_pool);
+  svn_stream_t *stream = svn_stream_from_stringbuf(buffer, scratch_pool);
+
+  SVN_ERR(metrics__write(metrics, stream, scratch_pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  /* Scrapers must never see a partially written file. */
+  return svn_error_trace(svn_io_write_atomic2(filename, buffer->data,
+                                              buffer->len, NULL, FALSE,
+                                              scratch_pool));
+}
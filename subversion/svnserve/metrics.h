@@ -0,0 +1,76 @@
+/*
+ * metrics.h : Public definitions for the svnserve command metrics
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "server.h"
+
+
+
+/* Opaque per-process collection of svnserve command statistics.  Access
+ * to it will be serialized among threads within the same process.
+ */
+typedef struct metrics_t metrics_t;
+
+/* In POOL, create an empty metrics collection and return it in *METRICS.
+ */
+svn_error_t *
+metrics__create(metrics_t **metrics,
+                apr_pool_t *pool);
+
+/* Make every command processed on CONN update the per-command latency,
+ * request size, response size and cache access statistics in METRICS.
+ * POOL must live as long as CONN.
+ */
+void
+metrics__attach(metrics_t *metrics,
+                svn_ra_svn_conn_t *conn,
+                apr_pool_t *pool);
+
+/* Write the contents of METRICS as well as the global FS cache statistics
+ * to STREAM, using the Prometheus text exposition format.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+metrics__write(metrics_t *metrics,
+               svn_stream_t *stream,
+               apr_pool_t *scratch_pool);
+
+/* Like metrics__write() but atomically replace the file FILENAME with the
+ * output.
+ */
+svn_error_t *
+metrics__write_file(metrics_t *metrics,
+                    const char *filename,
+                    apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* METRICS_H */
@@ -51,6 +51,7 @@
 #include "svn_mergeinfo.h"
 #include "svn_user.h"
 
+#include "private/svn_io_private.h"
 #include "private/svn_log.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
@@ -62,6 +63,7 @@
 
 #include "server.h"
 #include "logger.h"
+#include "metrics.h"
 
 typedef struct commit_callback_baton_t {
   apr_pool_t *pool;
@@ -1582,6 +1584,43 @@ commit(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Upper limit for the strings sent by send_file_contents.  The client
+   buffers each string in memory, so don't make them too large. */
+#define SENDFILE_CHUNK_SIZE 0x100000
+
+/* Send FILE from its current offset up to offset END over CONN as a
+   sequence of strings, using sendfile() where available.  If END is -1,
+   send the remainder of FILE.  Use POOL for temporary allocations. */
+static svn_error_t *
+send_file_contents(svn_ra_svn_conn_t *conn,
+                   apr_pool_t *pool,
+                   apr_file_t *file,
+                   apr_off_t end)
+{
+  apr_off_t offset;
+
+  SVN_ERR(svn_io_file_get_offset(&offset, file, pool));
+  if (end < 0)
+    {
+      svn_filesize_t size;
+
+      SVN_ERR(svn_io_file_size_get(&size, file, pool));
+      end = size;
+    }
+
+  while (offset < end)
+    {
+      apr_size_t len = end - offset > SENDFILE_CHUNK_SIZE
+                     ? SENDFILE_CHUNK_SIZE
+                     : (apr_size_t)(end - offset);
+      SVN_ERR(svn_ra_svn__write_string_from_file(conn, pool, file, offset,
+                                                 len));
+      offset += len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 get_file(svn_ra_svn_conn_t *conn,
          apr_pool_t *pool,
@@ -1679,23 +1718,36 @@ get_file(svn_ra_svn_conn_t *conn,
   /* Now send the file's contents. */
   if (want_contents)
     {
+      /* Plain files, e.g. large FSX fulltexts or large PLAIN FSFS reps,
+         can be sent directly. */
+      apr_file_t *file = svn_stream__aprfile(contents);
+
       err = SVN_NO_ERROR;
-      while (1)
+      if (file)
         {
-          len = sizeof(buf);
-          err = svn_stream_read_full(contents, buf, &len);
-          if (err)
-            break;
-          if (len > 0)
-            {
-              write_str.data = buf;
-              write_str.len = len;
-              SVN_ERR(svn_ra_svn__write_string(conn, pool, &write_str));
-            }
-          if (len < sizeof(buf))
+          err = send_file_contents(conn, pool, file,
+                                   svn_stream__aprfile_end(contents));
+          err = svn_error_compose_create(err, svn_stream_close(contents));
+        }
+      else
+        {
+          while (1)
             {
-              err = svn_stream_close(contents);
-              break;
+              len = sizeof(buf);
+              err = svn_stream_read_full(contents, buf, &len);
+              if (err)
+                break;
+              if (len > 0)
+                {
+                  write_str.data = buf;
+                  write_str.len = len;
+                  SVN_ERR(svn_ra_svn__write_string(conn, pool, &write_str));
+                }
+              if (len < sizeof(buf))
+                {
+                  err = svn_stream_close(contents);
+                  break;
+                }
             }
         }
       write_err = svn_ra_svn__write_cstring(conn, pool, "");
@@ -1956,15 +2008,17 @@ update(svn_ra_svn_conn_t *conn,
   svn_boolean_t recurse;
   svn_tristate_t send_copyfrom_args; /* Optional; default FALSE */
   svn_tristate_t ignore_ancestry; /* Optional; default FALSE */
+  svn_tristate_t text_deltas; /* Optional; default TRUE */
   /* Default to unknown.  Old clients won't send depth, but we'll
      handle that by converting recurse if necessary. */
   svn_depth_t depth = svn_depth_unknown;
   svn_boolean_t is_checkout;
 
   /* Parse the arguments. */
-  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cb?w3?3", &rev, &target,
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)cb?w3?3?3", &rev, &target,
                                   &recurse, &depth_word,
-                                  &send_copyfrom_args, &ignore_ancestry));
+                                  &send_copyfrom_args, &ignore_ancestry,
+                                  &text_deltas));
   SVN_ERR(svn_relpath_canonicalize_safe(&canonical_target, NULL, target,
                                         pool, pool));
   target = canonical_target;
@@ -1982,7 +2036,8 @@ update(svn_ra_svn_conn_t *conn,
     SVN_CMD_ERR(svn_fs_youngest_rev(&rev, b->repository->fs, pool));
 
   SVN_ERR(accept_report(&is_checkout, NULL,
-                        conn, pool, b, rev, target, NULL, TRUE,
+                        conn, pool, b, rev, target, NULL,
+                        (text_deltas != svn_tristate_false),
                         depth,
                         (send_copyfrom_args == svn_tristate_true),
                         (ignore_ancestry == svn_tristate_true)));
@@ -4235,15 +4290,19 @@ construct_server_baton(server_baton_t **baton,
   b->logger = params->logger;
   b->client_info = get_client_info(conn, params, conn_pool);
 
+  if (params->metrics)
+    metrics__attach(params->metrics, conn, conn_pool);
+
   /* Send greeting.  We don't support version 1 any more, so we can
    * send an empty mechlist. */
   if (params->compression_level > 0)
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwwwwww)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_SVNDIFF1,
                                            SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED,
+                                           SVN_RA_SVN_CAP_SVNDIFF3_ACCEPTED,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
                                            SVN_RA_SVN_CAP_COMMIT_REVPROPS,
                                            SVN_RA_SVN_CAP_DEPTH,
@@ -4253,11 +4312,13 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_COMMAND_PIPELINE,
+                                           SVN_RA_SVN_CAP_UPDATE_TEXT_DELTAS
                                            ));
   else
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwww)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
@@ -4269,7 +4330,9 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_COMMAND_PIPELINE,
+                                           SVN_RA_SVN_CAP_UPDATE_TEXT_DELTAS
                                            ));
 
   /* Read client response, which we assume to be in version 2 format:
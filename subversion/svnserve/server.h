@@ -124,6 +124,12 @@ typedef struct serve_params_t {
   /* logging data structure; possibly NULL. */
   struct logger_t *logger;
 
+  /* per-command statistics; possibly NULL. */
+  struct metrics_t *metrics;
+
+  /* file to write METRICS to upon request; NULL if METRICS is NULL. */
+  const char *metrics_filename;
+
   /* all configurations should be opened through this factory */
   svn_repos__config_pool_t *config_pool;
 
@@ -70,6 +70,7 @@
 
 #include "server.h"
 #include "logger.h"
+#include "metrics.h"
 
 /* The strategy for handling incoming connections.  Some of these may be
    unavailable due to platform limitations. */
@@ -222,6 +223,8 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_METRICS_FILE    277
+#define SVNSERVE_OPT_SHARED_CACHE    278
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -325,6 +328,12 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is yes.\n"
         "                             "
         "[used for FSFS repositories only]")},
+    {"shared-cache", SVNSERVE_OPT_SHARED_CACHE, 0,
+     N_("let all connection processes share one cache\n"
+        "                             "
+        "instead of using one cache per process\n"
+        "                             "
+        "[mode: daemon without --threads]")},
     {"client-speed", SVNSERVE_OPT_CLIENT_SPEED, 1,
      N_("Optimize network handling based on the assumption\n"
         "                             "
@@ -396,6 +405,22 @@ static const apr_getopt_option_t svnserve__options[] =
         "process (useful for debugging)")},
     {"log-file",         SVNSERVE_OPT_LOG_FILE, 1,
      N_("svnserve log file")},
+    {"metrics-file",     SVNSERVE_OPT_METRICS_FILE, 1,
+#ifdef SIGUSR1
+     N_("collect per-command statistics and write them\n"
+        "                             "
+        "to file ARG upon SIGUSR1 (or at the end of the\n"
+        "                             "
+        "connection in listen-once mode)\n"
+        "                             "
+        "[mode: daemon with --threads or --single-thread,\n"
+        "                             "
+        " listen-once]")},
+#else
+     N_("collect per-command statistics and write them\n"
+        "                             "
+        "to file ARG when exiting [mode: listen-once]")},
+#endif
     {"pid-file",         SVNSERVE_OPT_PID_FILE, 1,
 #ifdef WIN32
      N_("write server process ID to file ARG\n"
@@ -492,6 +517,59 @@ static void sigchld_handler(int signo)
 }
 #endif
 
+#ifdef SIGUSR1
+/* Set by SIGUSR1 to request the metrics file to be written. */
+static volatile sig_atomic_t metrics_requested = FALSE;
+
+static void sigusr1_handler(int signo)
+{
+  /* The accept() gets interrupted and we will write the file there.
+     In threaded mode, a worker thread may get the signal instead. */
+  metrics_requested = TRUE;
+}
+#endif
+
+/* Write the metrics collected in PARAMS to their file, if enabled.  Log
+ * but otherwise ignore any errors.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static void
+write_metrics(serve_params_t *params,
+              apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+
+  if (!params->metrics)
+    return;
+
+  err = metrics__write_file(params->metrics, params->metrics_filename,
+                            scratch_pool);
+  if (err)
+    {
+      logger__log_error(params->logger, err, NULL, NULL);
+      svn_error_clear(err);
+    }
+}
+
+/* Call write_metrics() for PARAMS if that has been requested by a signal
+ * since the last call.  Use POOL for temporary allocations.
+ */
+static void
+write_requested_metrics(serve_params_t *params,
+                        apr_pool_t *pool)
+{
+#ifdef SIGUSR1
+  if (metrics_requested)
+    {
+      apr_pool_t *scratch_pool = svn_pool_create(pool);
+
+      metrics_requested = FALSE;
+      write_metrics(params, scratch_pool);
+      svn_pool_destroy(scratch_pool);
+    }
+#endif
+}
+
 /* Redirect stdout to stderr.  ARG is the pool.
  *
  * In tunnel or inetd mode, we don't want hook scripts corrupting the
@@ -547,6 +625,8 @@ accept_connection(connection_t **connection,
 
       status = apr_socket_accept(&(*connection)->usock, sock,
                                  connection_pool);
+
+      write_requested_metrics(params, pool);
       if (handling_mode == connection_mode_fork)
         {
           apr_proc_t proc;
@@ -645,6 +725,8 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
       svn_error_clear(err);
       done = TRUE;
     }
+
+  write_requested_metrics(connection->params, pool);
   svn_root_pools__release_pool(pool, connection_pools);
 
   /* Close or re-schedule connection. */
@@ -725,6 +807,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_boolean_t cache_txdeltas = TRUE;
   svn_boolean_t cache_revprops = FALSE;
   svn_boolean_t use_block_read = FALSE;
+  svn_boolean_t shared_cache = FALSE;
   apr_uint16_t port = SVN_RA_SVN_PORT;
   const char *host = NULL;
   int family = APR_INET;
@@ -739,6 +822,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   const char *config_filename = NULL;
   const char *pid_filename = NULL;
   const char *log_filename = NULL;
+  const char *metrics_filename = NULL;
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
   apr_size_t max_thread_count = THREADPOOL_MAX_SIZE;
@@ -765,6 +849,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.cfg = NULL;
   params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
   params.logger = NULL;
+  params.metrics = NULL;
+  params.metrics_filename = NULL;
   params.config_pool = NULL;
   params.fs_config = NULL;
   params.vhost = FALSE;
@@ -925,6 +1011,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           cache_nodeprops = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_SHARED_CACHE:
+          shared_cache = TRUE;
+          break;
+
         case SVNSERVE_OPT_BLOCK_READ:
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
@@ -995,6 +1085,14 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           SVN_ERR(svn_dirent_get_absolute(&log_filename, log_filename, pool));
           break;
 
+        case SVNSERVE_OPT_METRICS_FILE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&metrics_filename, arg, pool));
+          metrics_filename = svn_dirent_internal_style(metrics_filename,
+                                                       pool);
+          SVN_ERR(svn_dirent_get_absolute(&metrics_filename,
+                                          metrics_filename, pool));
+          break;
+
         }
     }
 
@@ -1079,6 +1177,29 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                _("Option --tunnel-user is only valid in tunnel mode"));
     }
 
+  /* Only forked connection processes can share the cache. */
+  if (shared_cache
+      && (run_mode != run_mode_daemon
+          || handling_mode != connection_mode_fork))
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+             _("Option --shared-cache requires daemon mode with one "
+               "process per connection"));
+
+  /* The statistics are per process.  Thus, they are only meaningful if
+   * all connections get served by this process. */
+  if (metrics_filename)
+    {
+      if (run_mode == run_mode_inetd || run_mode == run_mode_tunnel
+          || (run_mode != run_mode_listen_once
+              && handling_mode == connection_mode_fork))
+        return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                 _("Option --metrics-file requires all connections to be "
+                   "served by a single process"));
+
+      SVN_ERR(metrics__create(&params.metrics, pool));
+      params.metrics_filename = metrics_filename;
+    }
+
   if (run_mode == run_mode_inetd || run_mode == run_mode_tunnel)
     {
       apr_pool_t *connection_pool;
@@ -1244,6 +1365,11 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   apr_signal(SIGCHLD, sigchld_handler);
 #endif
 
+#ifdef SIGUSR1
+  if (params.metrics)
+    apr_signal(SIGUSR1, sigusr1_handler);
+#endif
+
 #ifdef SIGPIPE
   /* Disable SIGPIPE generation for the platforms that have it. */
   apr_signal(SIGPIPE, SIG_IGN);
@@ -1270,8 +1396,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 #endif
 
   /* Configure FS caches for maximum efficiency with svnserve.
-   * For pre-forked (i.e. multi-processed) mode of operation,
-   * keep the per-process caches smaller than the default.
+   * For forked (i.e. multi-processed) mode of operation, optionally let
+   * all connection processes share the same cache.
    * Also, apply the respective command line parameters, if given. */
   {
     svn_cache_config_t settings = *svn_cache_config_get();
@@ -1295,6 +1421,17 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       }
 
     svn_cache_config_set(&settings);
+
+    /* Falls back to per-process caches if not supported. */
+    if (shared_cache)
+      {
+        err = svn_cache_config_share();
+        if (err)
+          {
+            svn_handle_warning2(stderr, err, "svnserve: ");
+            svn_error_clear(err);
+          }
+      }
   }
 
 #if APR_HAS_THREADS
@@ -1339,6 +1476,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
         {
           err = serve_socket(connection, connection->pool);
           close_connection(connection);
+          write_metrics(&params, pool);
           return err;
         }
 
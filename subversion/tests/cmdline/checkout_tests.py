@@ -1187,6 +1187,166 @@ def checkout_wc_from_drive(sbox):
 
 #----------------------------------------------------------------------
 
+def checkout_with_worker_threads(sbox):
+  "checkout and update with worker threads"
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+
+  # Give update some files to change.
+  sbox.simple_append('iota', 'appended iota text\n')
+  sbox.simple_append('A/mu', 'appended mu text\n')
+  sbox.simple_append('A/D/G/rho', 'appended rho text\n')
+  sbox.simple_append('A/D/H/psi', 'appended psi text\n')
+  sbox.simple_propset('svn:eol-style', 'native', 'A/D/G/rho', 'A/D/H/psi')
+  sbox.simple_commit()
+
+  option = 'config:working-copy:worker-threads=4'
+
+  # Checkout r1 and update it to r2 with multiple threads.
+  checkout_target = sbox.add_wc_path('threads')
+  expected_output = svntest.main.greek_state.copy()
+  expected_output.wc_dir = checkout_target
+  expected_output.tweak(status='A ', contents=None)
+
+  svntest.actions.run_and_verify_checkout(sbox.repo_url, checkout_target,
+                                          expected_output,
+                                          svntest.main.greek_state,
+                                          [], '-r', '1',
+                                          '--config-option', option)
+
+  expected_output = svntest.wc.State(checkout_target, {
+    'iota'      : Item(status='U '),
+    'A/mu'      : Item(status='U '),
+    'A/D/G/rho' : Item(status='UU'),
+    'A/D/H/psi' : Item(status='UU'),
+  })
+  expected_disk = svntest.main.greek_state.copy()
+  expected_disk.tweak('iota', contents="This is the file 'iota'.\n"
+                                       "appended iota text\n")
+  expected_disk.tweak('A/mu', contents="This is the file 'mu'.\n"
+                                       "appended mu text\n")
+  expected_disk.tweak('A/D/G/rho', contents="This is the file 'rho'.\n"
+                                            "appended rho text\n",
+                      props={'svn:eol-style': 'native'})
+  expected_disk.tweak('A/D/H/psi', contents="This is the file 'psi'.\n"
+                                            "appended psi text\n",
+                      props={'svn:eol-style': 'native'})
+  expected_status = svntest.actions.get_virginal_state(checkout_target, 2)
+
+  svntest.actions.run_and_verify_update(checkout_target, expected_output,
+                                        expected_disk, expected_status,
+                                        [], True,
+                                        '--config-option', option)
+
+#----------------------------------------------------------------------
+
+def checkout_with_extra_connections(sbox):
+  "checkout and update over extra connections"
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+
+  # Give update text changes, a prop-only change and an added file.
+  sbox.simple_append('iota', 'appended iota text\n')
+  sbox.simple_append('A/D/G/rho', 'appended rho text\n')
+  sbox.simple_propset('svn:eol-style', 'native', 'A/D/G/rho', 'A/D/H/psi')
+  sbox.simple_add_text('new file\n', 'A/C/new')
+  sbox.simple_commit()
+
+  # Only ra_svn looks at this option; the others must not mind.
+  option = 'servers:global:svn-max-connections=4'
+
+  # Checkout r1 and update it to r2.
+  checkout_target = sbox.add_wc_path('conns')
+  expected_output = svntest.main.greek_state.copy()
+  expected_output.wc_dir = checkout_target
+  expected_output.tweak(status='A ', contents=None)
+
+  svntest.actions.run_and_verify_checkout(sbox.repo_url, checkout_target,
+                                          expected_output,
+                                          svntest.main.greek_state,
+                                          [], '-r', '1',
+                                          '--config-option', option)
+
+  expected_output = svntest.wc.State(checkout_target, {
+    'iota'      : Item(status='U '),
+    'A/D/G/rho' : Item(status='UU'),
+    'A/D/H/psi' : Item(status=' U'),
+    'A/C/new'   : Item(status='A '),
+  })
+  expected_disk = svntest.main.greek_state.copy()
+  expected_disk.tweak('iota', contents="This is the file 'iota'.\n"
+                                       "appended iota text\n")
+  expected_disk.tweak('A/D/G/rho', contents="This is the file 'rho'.\n"
+                                            "appended rho text\n",
+                      props={'svn:eol-style': 'native'})
+  expected_disk.tweak('A/D/H/psi', props={'svn:eol-style': 'native'})
+  expected_disk.add({'A/C/new' : Item(contents="new file\n")})
+  expected_status = svntest.actions.get_virginal_state(checkout_target, 2)
+  expected_status.add({'A/C/new' : Item(status='  ', wc_rev=2)})
+
+  svntest.actions.run_and_verify_update(checkout_target, expected_output,
+                                        expected_disk, expected_status,
+                                        [], True,
+                                        '--config-option', option)
+
+  # Switch A/D/G to A/B/E, change alpha and update.  The new alpha text
+  # must be fetched from its switched location.
+  sbox.simple_append('A/B/E/alpha', 'appended alpha text\n')
+  sbox.simple_commit()
+
+  G_path = os.path.join(checkout_target, 'A', 'D', 'G')
+  svntest.main.run_svn(None, 'switch', '-r', '2', '--ignore-ancestry',
+                       sbox.repo_url + '/A/B/E', G_path)
+
+  expected_output = svntest.wc.State(checkout_target, {
+    'A/B/E/alpha' : Item(status='U '),
+    'A/D/G/alpha' : Item(status='U '),
+  })
+  alpha_text = "This is the file 'alpha'.\nappended alpha text\n"
+  expected_disk.tweak('A/B/E/alpha', contents=alpha_text)
+  expected_disk.remove('A/D/G/pi', 'A/D/G/rho', 'A/D/G/tau')
+  expected_disk.add({
+    'A/D/G/alpha' : Item(contents=alpha_text),
+    'A/D/G/beta'  : Item(contents="This is the file 'beta'.\n"),
+  })
+  expected_status = svntest.actions.get_virginal_state(checkout_target, 3)
+  expected_status.add({'A/C/new' : Item(status='  ', wc_rev=3)})
+  expected_status.remove('A/D/G/pi', 'A/D/G/rho', 'A/D/G/tau')
+  expected_status.add({
+    'A/D/G/alpha' : Item(status='  ', wc_rev=3),
+    'A/D/G/beta'  : Item(status='  ', wc_rev=3),
+  })
+  expected_status.tweak('A/D/G', switched='S')
+
+  svntest.actions.run_and_verify_update(checkout_target, expected_output,
+                                        expected_disk, expected_status,
+                                        [], True,
+                                        '--config-option', option)
+
+  # Check out more files than get queued at a time, so that contents are
+  # fetched while the tree is still coming in.
+  os.mkdir(sbox.ospath('many'))
+  for i in range(100):
+    svntest.main.file_write(sbox.ospath('many/file%d' % i), 'file %d\n' % i)
+  sbox.simple_add('many')
+  sbox.simple_commit()
+
+  many_target = sbox.add_wc_path('many')
+  expected_output = svntest.wc.State(many_target, {})
+  expected_disk = svntest.wc.State('', {})
+  for i in range(100):
+    expected_output.add({'file%d' % i : Item(status='A ')})
+    expected_disk.add({'file%d' % i : Item(contents='file %d\n' % i)})
+
+  svntest.actions.run_and_verify_checkout(sbox.repo_url + '/many',
+                                          many_target,
+                                          expected_output, expected_disk,
+                                          [], '--config-option', option)
+
+#----------------------------------------------------------------------
+
 # list all tests here, starting with None:
 test_list = [ None,
               checkout_with_obstructions,
@@ -1202,7 +1362,9 @@ test_list = [ None,
               checkout_peg_rev,
               checkout_peg_rev_date,
               co_with_obstructing_local_adds,
-              checkout_wc_from_drive
+              checkout_wc_from_drive,
+              checkout_with_worker_threads,
+              checkout_with_extra_connections,
             ]
 
 if __name__ == "__main__":
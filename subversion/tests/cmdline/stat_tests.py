@@ -2301,6 +2301,68 @@ def status_missing_conflicts(sbox):
   # But not in status!
   svntest.actions.run_and_verify_status(wc_dir, expected_status)
 
+def status_parallel_walk(sbox):
+  "status output order with worker threads"
+
+  sbox.build()
+  wc_dir = sbox.wc_dir
+
+  # Spread some local changes over many directories.
+  sbox.simple_append('A/mu', 'appended mu text')
+  sbox.simple_append('A/D/G/rho', 'appended rho text')
+  sbox.simple_propset('p', 'v', 'A/B/E', 'A/D/H/psi')
+  sbox.simple_rm('A/B/lambda')
+  sbox.simple_mkdir('A/C/new', 'A/D/G/new')
+  sbox.simple_append('A/C/new/file', 'new file')
+  sbox.simple_add('A/C/new/file')
+  svntest.main.file_write(sbox.ospath('A/D/H/unversioned'), 'unversioned')
+  os.remove(sbox.ospath('A/B/E/alpha'))
+
+  exit_code, expected_output, expected_err = svntest.main.run_svn(
+    None, 'status', '-v', '--no-ignore', wc_dir)
+
+  # The output must be identical, line by line, for any number of threads.
+  for threads in ['2', '4', '16']:
+    option = 'config:working-copy:worker-threads=' + threads
+    svntest.actions.run_and_verify_svn(expected_output, [],
+                                       'status', '-v', '--no-ignore',
+                                       '--config-option', option, wc_dir)
+
+def cleanup_timestamps_parallel(sbox):
+  "cleanup repairs timestamps with worker threads"
+
+  sbox.build(read_only = True)
+  wc_dir = sbox.wc_dir
+
+  # Rewrite files in several directories with their own content.  This
+  # leaves their recorded timestamps stale.
+  paths = [sbox.ospath(p) for p in ['iota', 'A/mu', 'A/B/E/alpha',
+                                    'A/D/G/rho', 'A/D/H/omega']]
+  text_times = [get_text_timestamp(path) for path in paths]
+
+  time.sleep(1.1)
+  for path in paths:
+    contents = open(path, 'rb').read()
+    svntest.main.file_write(path, contents, 'wb')
+
+  # A status walk without a lock doesn't repair anything.
+  option = 'config:working-copy:worker-threads=4'
+  expected_status = svntest.actions.get_virginal_state(wc_dir, 1)
+  svntest.actions.run_and_verify_svn(None, [], 'status',
+                                     '--config-option', option, wc_dir)
+  for path, text_time in zip(paths, text_times):
+    if get_text_timestamp(path) != text_time:
+      raise svntest.Failure("Timestamp of '%s' repaired by status" % path)
+
+  # Cleanup holds a write lock and must repair all of them.
+  svntest.actions.run_and_verify_svn(None, [], 'cleanup',
+                                     '--config-option', option, wc_dir)
+  svntest.actions.run_and_verify_status(wc_dir, expected_status)
+  for path, text_time in zip(paths, text_times):
+    if get_text_timestamp(path) == text_time:
+      raise svntest.Failure("Timestamp of '%s' not repaired by cleanup"
+                            % path)
+
 
 
 
@@ -2355,6 +2417,8 @@ test_list = [ None,
               status_move_missing_direct,
               status_move_missing_direct_base,
               status_missing_conflicts,
+              status_parallel_walk,
+              cleanup_timestamps_parallel,
              ]
 
 if __name__ == '__main__':
@@ -269,6 +269,9 @@ def patch_format(repo_dir, shard_size):
   for line in contents.split(b"\n"):
     if line.startswith(b"layout "):
       processed_lines.append(("layout sharded %d" % shard_size).encode())
+    elif line.startswith(b"pack-stage-size "):
+      # stages must be smaller than the shards
+      processed_lines.append(b"pack-stage-size 0")
     else:
       processed_lines.append(line)
 
@@ -4059,6 +4062,66 @@ def build_repcache(sbox):
     raise svntest.Failure
 
 
+def verify_jobs(sbox):
+  "svnadmin verify --jobs"
+
+  sbox.build(create_wc = False)
+
+  # Enough revisions to be split across several verification tasks.
+  for i in range(25):
+    svntest.actions.run_and_verify_svn(None, [],
+                                       'mkdir', '-m', 'log_msg',
+                                       sbox.repo_url + '/dir%d' % i)
+
+  exit_code, expected_output, expected_err = svntest.main.run_svnadmin(
+    'verify', sbox.repo_dir)
+
+  # Progress must be reported in revision order, whatever the job count.
+  for jobs in ['2', '4', '16']:
+    svntest.actions.run_and_verify_svnadmin(expected_output, [],
+                                            'verify', '--jobs', jobs,
+                                            sbox.repo_dir)
+
+  svntest.actions.run_and_verify_svnadmin(
+    None, '.*Invalid number of jobs.*', 'verify', '--jobs', '0',
+    sbox.repo_dir)
+
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+def verify_jobs_keep_going(sbox):
+  "svnadmin verify --jobs --keep-going"
+
+  # No support for modifying pack files
+  if svntest.main.options.fsfs_packing:
+    raise svntest.Skip('fsfs packing set')
+
+  sbox.build(create_wc = False)
+
+  for i in range(25):
+    svntest.actions.run_and_verify_svn(None, [],
+                                       'mkdir', '-m', 'log_msg',
+                                       sbox.repo_url + '/dir%d' % i)
+
+  r12 = fsfs_file(sbox.repo_dir, 'revs', '12')
+  fp = open(r12, 'r+b')
+  fp.write(b"inserting junk to corrupt the rev")
+  fp.close()
+
+  exit_code, expected_output, expected_err = svntest.main.run_svnadmin(
+    'verify', '--keep-going', sbox.repo_dir)
+
+  # Errors and progress must be reported in the same order as before.
+  exit_code, output, errput = svntest.main.run_svnadmin(
+    'verify', '--keep-going', '--jobs', '4', sbox.repo_dir)
+
+  if svntest.verify.verify_outputs("Unexpected output of 'svnadmin verify'.",
+                                   output, errput,
+                                   expected_output, expected_err):
+    raise svntest.Failure
+
+  # Don't leave a corrupt repository
+  svntest.main.safe_rmtree(sbox.repo_dir, True)
+
+
 ########################################################################
 # Run the tests
 
@@ -4139,6 +4202,8 @@ test_list = [ None,
               dump_include_copied_directory,
               load_normalize_node_props,
               build_repcache,
+              verify_jobs,
+              verify_jobs_keep_going,
              ]
 
 if __name__ == '__main__':
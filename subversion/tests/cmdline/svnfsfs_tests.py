@@ -89,6 +89,9 @@ def patch_format(repo_dir, shard_size):
   for line in contents.split(b"\n"):
     if line.startswith(b"layout "):
       processed_lines.append(b"layout sharded %d" % shard_size)
+    elif line.startswith(b"pack-stage-size "):
+      # stages must be smaller than the shards
+      processed_lines.append(b"pack-stage-size 0")
     else:
       processed_lines.append(line)
 
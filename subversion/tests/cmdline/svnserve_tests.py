@@ -0,0 +1,286 @@
+#!/usr/bin/env python
+#
+#  svnserve_tests.py:  testing svnserve-specific server features.
+#
+#  Subversion is a tool for revision control.
+#  See http://subversion.apache.org for more information.
+#
+# ====================================================================
+#    Licensed to the Apache Software Foundation (ASF) under one
+#    or more contributor license agreements.  See the NOTICE file
+#    distributed with this work for additional information
+#    regarding copyright ownership.  The ASF licenses this file
+#    to you under the Apache License, Version 2.0 (the
+#    "License"); you may not use this file except in compliance
+#    with the License.  You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing,
+#    software distributed under the License is distributed on an
+#    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+#    KIND, either express or implied.  See the License for the
+#    specific language governing permissions and limitations
+#    under the License.
+######################################################################
+
+# General modules
+import os
+import re
+import socket
+import subprocess
+import time
+import logging
+
+logger = logging.getLogger()
+
+# Our testing module
+import svntest
+
+# (abbreviation)
+Skip = svntest.testcase.Skip_deco
+SkipUnless = svntest.testcase.SkipUnless_deco
+XFail = svntest.testcase.XFail_deco
+Issues = svntest.testcase.Issues_deco
+Issue = svntest.testcase.Issue_deco
+Wimp = svntest.testcase.Wimp_deco
+
+######################################################################
+# Helpers
+
+def not_sasl():
+  return not svntest.main.options.enable_sasl
+
+def require_authentication(sbox):
+  """Make svnserve authenticate every connection to SBOX's repository.
+  The ra_svn client only pipelines commands on authenticated sessions."""
+
+  svntest.main.file_write(svntest.main.get_svnserve_conf_file_path(
+                            sbox.repo_dir),
+                          "[general]\n"
+                          "anon-access = none\n"
+                          "auth-access = write\n"
+                          "password-db = passwd\n")
+
+def get_free_port():
+  "Return a TCP port on the loopback interface that is currently unused."
+
+  s = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+  try:
+    s.bind(('127.0.0.1', 0))
+    return s.getsockname()[1]
+  finally:
+    s.close()
+
+def wait_for(condition, what, timeout=30):
+  "Poll CONDITION until it returns true, fail after TIMEOUT seconds."
+
+  deadline = time.time() + timeout
+  while not condition():
+    if time.time() > deadline:
+      raise svntest.Failure("Timeout waiting for %s" % what)
+    time.sleep(0.1)
+
+def run_with_metrics(sbox, func):
+  """Start svnserve in listen-once mode with --metrics-file for SBOX's
+  repository, call FUNC with the URL of the repository root and return
+  the metrics written by svnserve as a dictionary mapping each sample
+  line's name and labels to its value."""
+
+  port = get_free_port()
+  pid_file = sbox.get_tempname('svnserve-pid')
+  metrics_file = sbox.get_tempname('svnserve-metrics')
+  args = [svntest.main.svnserve_binary, '-X',
+          '--listen-host', '127.0.0.1', '--listen-port', str(port),
+          '-r', os.path.abspath(sbox.repo_dir),
+          '--pid-file', os.path.abspath(pid_file),
+          '--metrics-file', os.path.abspath(metrics_file)]
+  logger.info('CMD: %s', ' '.join(args))
+  server = subprocess.Popen(args)
+  try:
+    # The pid file gets written once svnserve is listening.
+    wait_for(lambda: os.path.exists(pid_file) or server.poll() is not None,
+             'svnserve to start')
+    if server.poll() is not None:
+      raise svntest.Failure("svnserve exited with code %d"
+                            % server.returncode)
+
+    func('svn://127.0.0.1:%d' % port)
+
+    # svnserve writes the metrics after the connection has been closed.
+    wait_for(lambda: server.poll() is not None, 'svnserve to exit')
+  finally:
+    if server.poll() is None:
+      server.kill()
+      server.wait()
+
+  if server.returncode != 0:
+    raise svntest.Failure("svnserve exited with code %d" % server.returncode)
+
+  metrics = {}
+  for line in open(metrics_file):
+    if line.startswith('#'):
+      continue
+    name, value = line.rsplit(' ', 1)
+    metrics[name] = float(value)
+
+  return metrics
+
+def get_commands(metrics):
+  "Return the set of commands that METRICS has statistics for."
+
+  commands = set()
+  for name in metrics:
+    match = re.search(r'\{command="([^"]*)"', name)
+    if match:
+      commands.add(match.group(1))
+
+  return commands
+
+def get_histogram(metrics, name, command):
+  """Return the bucket counts, the sum and the count of histogram NAME
+  for COMMAND in METRICS and verify that they are consistent."""
+
+  prefix = '%s_bucket{command="%s",le="' % (name, command)
+  buckets = {}
+  for key, value in metrics.items():
+    if key.startswith(prefix):
+      buckets[key[len(prefix):-2]] = value
+
+  count = metrics['%s_count{command="%s"}' % (name, command)]
+  total = metrics['%s_sum{command="%s"}' % (name, command)]
+
+  # Prometheus buckets are cumulative and the last one covers everything.
+  limits = sorted((float(le), value) for le, value in buckets.items())
+  previous = 0
+  for limit, value in limits:
+    if value < previous:
+      raise svntest.Failure("Histogram %s for '%s' is not cumulative"
+                            % (name, command))
+    previous = value
+  if buckets['+Inf'] != count:
+    raise svntest.Failure("Histogram %s for '%s' has %d entries in '+Inf' "
+                          "but a count of %d"
+                          % (name, command, buckets['+Inf'], count))
+
+  return buckets, total, count
+
+def verify_command(metrics, command, count, failures=0):
+  """Verify that METRICS reports COMMAND to have been executed COUNT
+  times, FAILURES of which failed."""
+
+  for name in ['svnserve_command_duration_seconds',
+               'svnserve_command_request_bytes',
+               'svnserve_command_response_bytes']:
+    buckets, total, actual = get_histogram(metrics, name, command)
+    if actual != count:
+      raise svntest.Failure("Expected %d '%s' commands in %s, found %d"
+                            % (count, command, name, actual))
+
+  actual = metrics['svnserve_command_failures_total{command="%s"}'
+                   % command]
+  if actual != failures:
+    raise svntest.Failure("Expected %d '%s' failures, found %d"
+                          % (failures, command, actual))
+
+def verify_not_reported(metrics, commands):
+  """Verify that none of COMMANDS has been reported in METRICS on its
+  own.  Those are processed as part of other commands."""
+
+  reported = get_commands(metrics).intersection(commands)
+  if reported:
+    raise svntest.Failure("Nested commands reported separately: %s"
+                          % ', '.join(sorted(reported)))
+
+######################################################################
+# Tests
+#
+#   Each test must return on success or raise on failure.
+
+
+#----------------------------------------------------------------------
+
+@SkipUnless(not_sasl)
+def metrics_file(sbox):
+  "svnserve --metrics-file"
+
+  sbox.build(create_wc=False)
+  require_authentication(sbox)
+
+  # A commit through the editor.  The editor commands sent after 'commit'
+  # are part of that command.
+  dirs = ['dir-with-a-rather-long-name-%02d' % i for i in range(20)]
+  def mkdirs(url):
+    args = ['-U', url, '-m', 'log msg']
+    for name in dirs:
+      args += ['mkdir', name, 'mkdir', name + '/sub']
+    svntest.actions.run_and_verify_svnmucc(None, [], *args)
+
+  metrics = run_with_metrics(sbox, mkdirs)
+  verify_command(metrics, 'commit', 1)
+  verify_not_reported(metrics, ['open-root', 'add-dir', 'close-dir',
+                                'close-edit'])
+  buckets, total, count = get_histogram(metrics,
+                                        'svnserve_command_request_bytes',
+                                        'commit')
+  if total < 40 * len('dir-with-a-rather-long-name-00'):
+    raise svntest.Failure("Editor drive not accounted to 'commit'")
+
+  # A checkout.  The report commands sent after 'update' are part of that
+  # command.
+  wc_dir = sbox.add_wc_path('checkout')
+  def checkout(url):
+    svntest.actions.run_and_verify_svn(None, [], 'checkout', url, wc_dir)
+
+  metrics = run_with_metrics(sbox, checkout)
+  verify_command(metrics, 'update', 1)
+  verify_not_reported(metrics, ['set-path', 'delete-path', 'link-path',
+                                'finish-report', 'abort-report'])
+  buckets, total, count = get_histogram(metrics,
+                                        'svnserve_command_response_bytes',
+                                        'update')
+  if total < 20 * len('dir-with-a-rather-long-name-00'):
+    raise svntest.Failure("Response to 'update' is too small")
+
+  # The client pipelines 'get-dir' for all subdirectories of a directory.
+  # Each of these small requests must be accounted to its own command even
+  # if svnserve read them all at once.
+  def info(url):
+    svntest.actions.run_and_verify_svn(None, [], 'info', '--depth',
+                                       'infinity', url)
+
+  metrics = run_with_metrics(sbox, info)
+  buckets, total, count = get_histogram(metrics,
+                                        'svnserve_command_request_bytes',
+                                        'get-dir')
+  if count <= len(dirs):
+    raise svntest.Failure("Expected more than %d 'get-dir' commands, "
+                          "found %d" % (len(dirs), count))
+  if buckets['256'] != count:
+    raise svntest.Failure("Pipelined 'get-dir' requests accounted to "
+                          "the wrong command")
+
+  # Failed commands.
+  def cat(url):
+    svntest.actions.run_and_verify_svn(None, '.*', 'cat',
+                                       url + '/no-such-file')
+
+  metrics = run_with_metrics(sbox, cat)
+  verify_command(metrics, 'get-file', 1, 1)
+
+
+########################################################################
+# Run the tests
+
+
+# list all tests here, starting with None:
+test_list = [ None,
+              metrics_file,
+             ]
+
+if __name__ == '__main__':
+  svntest.main.run_tests(test_list)
+  # NOTREACHED
+
+
+### End of file.
@@ -36,6 +36,8 @@
 #include "svn_delta.h"
 #include "svn_pools.h"
 #include "svn_error.h"
+#include "svn_sorts.h"
+#include "private/svn_delta_private.h"
 
 #include "../../libsvn_delta/delta.h"
 #include "delta-window-test.h"
@@ -330,15 +332,15 @@ do_random_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 4,
                               i % 10, delta_pool);
 
-      /* Make stage 1: create the text delta.  */
-      svn_txdelta2(&txdelta_stream,
-                   svn_stream_from_aprfile(source, delta_pool),
-                   svn_stream_from_aprfile(target, delta_pool),
-                   FALSE,
-                   delta_pool);
+      /* Make stage 1: create the text delta with windows that suit the
+                       svndiff version used in stage 2.  */
+      svn_txdelta__create(&txdelta_stream,
+                          svn_stream_from_aprfile(source, delta_pool),
+                          svn_stream_from_aprfile(target, delta_pool),
+                          FALSE, i % 4, delta_pool);
 
       SVN_ERR(svn_txdelta_send_txstream(txdelta_stream,
                                         handler,
@@ -426,7 +428,7 @@ do_random_combine_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying svndiff versions and compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 3,
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, i % 4,
                               i % 10, delta_pool);
 
       /* Make stage 1: create the text deltas.  */
@@ -569,7 +571,7 @@ do_random_txdelta_to_svndiff_stream_test(apr_pool_t *pool,
                    svn_stream_from_aprfile2(source, TRUE, iterpool),
                    svn_stream_from_aprfile2(target, TRUE, iterpool),
                    FALSE, iterpool);
-      delta_stream = svn_txdelta_to_svndiff_stream(txstream, i % 3, i % 10,
+      delta_stream = svn_txdelta_to_svndiff_stream(txstream, i % 4, i % 10,
                                                    iterpool);
 
       /* Apply it to a copy of the source file to see if we get the
@@ -605,6 +607,226 @@ random_txdelta_to_svndiff_stream_test(apr_pool_t *pool)
   return err;
 }
 
+/* Fill BUF of size LEN with test data of the given KIND using SEED:
+   0 = random bytes, 1 = random letters from a two-character alphabet,
+   2 = a copy of SOURCE with some random mutations. */
+static void
+generate_xdelta_data(char *buf,
+                     apr_size_t len,
+                     int kind,
+                     const char *source,
+                     apr_uint32_t *seed)
+{
+  apr_size_t i;
+
+  if (kind == 2)
+    {
+      memcpy(buf, source, len);
+      for (i = svn_test_rand(seed) % 1000; i < len;
+           i += svn_test_rand(seed) % 1000)
+        buf[i] = (char)svn_test_rand(seed);
+    }
+  else
+    {
+      for (i = 0; i < len; ++i)
+        buf[i] = (char)(kind ? 'a' + svn_test_rand(seed) % 2
+                             : svn_test_rand(seed));
+    }
+}
+
+/* Compute the xdelta of the source and target in DATA of SOURCE_LEN and
+   TARGET_LEN bytes, respectively, and return it in *BATON.  Add the time
+   it took to *DURATION.  Allocate the result in POOL. */
+static void
+run_xdelta(svn_txdelta__ops_baton_t *baton,
+           const char *data,
+           apr_size_t source_len,
+           apr_size_t target_len,
+           apr_time_t *duration,
+           apr_pool_t *pool)
+{
+  apr_time_t start = apr_time_now();
+
+  memset(baton, 0, sizeof(*baton));
+  baton->new_data = svn_stringbuf_create_empty(pool);
+  svn_txdelta__xdelta(baton, data, source_len, target_len, pool);
+
+  *duration += apr_time_now() - start;
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+simd_xdelta_test(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  apr_uint32_t seed = (apr_uint32_t) apr_time_now();
+  apr_size_t len = SVN_DELTA_WINDOW_SIZE;
+  char *data = apr_palloc(pool, 2 * len);
+  apr_time_t scalar_time = 0, simd_time = 0;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_boolean_t simd;
+  int i, k;
+
+  /* Without vector support, both runs will use the scalar code. */
+  simd = svn_txdelta__enable_simd(TRUE);
+  if (opts->verbose)
+    printf("SEED: %lu, vector instructions: %s\n",
+           (unsigned long)seed, simd ? "yes" : "no");
+
+  for (i = 0; i < 30; ++i)
+    {
+      svn_txdelta__ops_baton_t scalar, vector;
+      apr_size_t source_len = len - svn_test_rand(&seed) % 1000;
+      apr_size_t target_len = len - svn_test_rand(&seed) % 1000;
+      int kind = i % 3;
+
+      svn_pool_clear(iterpool);
+
+      /* Source and target are consecutive in DATA. */
+      generate_xdelta_data(data, source_len, kind == 2 ? 0 : kind, NULL,
+                           &seed);
+      generate_xdelta_data(data + source_len, target_len, kind, data,
+                           &seed);
+
+      svn_txdelta__enable_simd(FALSE);
+      run_xdelta(&scalar, data, source_len, target_len, &scalar_time,
+                 iterpool);
+      svn_txdelta__enable_simd(TRUE);
+      run_xdelta(&vector, data, source_len, target_len, &simd_time,
+                 iterpool);
+
+      SVN_TEST_INT_ASSERT(vector.num_ops, scalar.num_ops);
+      for (k = 0; k < scalar.num_ops; ++k)
+        {
+          SVN_TEST_ASSERT(vector.ops[k].action_code
+                          == scalar.ops[k].action_code);
+          SVN_TEST_ASSERT(vector.ops[k].offset == scalar.ops[k].offset);
+          SVN_TEST_ASSERT(vector.ops[k].length == scalar.ops[k].length);
+        }
+      SVN_TEST_ASSERT(svn_stringbuf_compare(vector.new_data,
+                                            scalar.new_data));
+    }
+
+  if (opts->verbose)
+    printf("scalar: %.1f MB/s, vector: %.1f MB/s\n",
+           30.0 * len / (double)MAX(scalar_time, 1),
+           30.0 * len / (double)MAX(simd_time, 1));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Encode the delta from SOURCE to TARGET in svndiff version SVNDIFF_VERSION,
+   using svn_txdelta__target_push() if PUSH is set and svn_txdelta__create()
+   otherwise.  Verify that applying it to SOURCE reproduces TARGET and
+   return the length of the svndiff data in *SVNDIFF_LEN.  Use POOL for
+   all allocations. */
+static svn_error_t *
+svndiff_round_trip(apr_size_t *svndiff_len,
+                   const svn_string_t *source,
+                   const svn_string_t *target,
+                   int svndiff_version,
+                   svn_boolean_t push,
+                   apr_pool_t *pool)
+{
+  svn_stringbuf_t *svndiff = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *result = svn_stringbuf_create_empty(pool);
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+  apr_size_t len;
+
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_stringbuf(svndiff, pool),
+                          svndiff_version,
+                          SVN_DELTA_COMPRESSION_LEVEL_DEFAULT, pool);
+  if (push)
+    {
+      stream = svn_txdelta__target_push(handler, handler_baton,
+                                        svn_stream_from_string(source, pool),
+                                        svndiff_version, pool);
+      len = target->len;
+      SVN_ERR(svn_stream_write(stream, target->data, &len));
+      SVN_ERR(svn_stream_close(stream));
+    }
+  else
+    {
+      svn_txdelta_stream_t *txstream;
+      svn_txdelta__create(&txstream, svn_stream_from_string(source, pool),
+                          svn_stream_from_string(target, pool), FALSE,
+                          svndiff_version, pool);
+      SVN_ERR(svn_txdelta_send_txstream(txstream, handler, handler_baton,
+                                        pool));
+    }
+
+  svn_txdelta_apply(svn_stream_from_string(source, pool),
+                    svn_stream_from_stringbuf(result, pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE, pool);
+  len = svndiff->len;
+  SVN_ERR(svn_stream_write(stream, svndiff->data, &len));
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_TEST_ASSERT(result->len == target->len);
+  SVN_TEST_ASSERT(memcmp(result->data, target->data, target->len) == 0);
+
+  *svndiff_len = svndiff->len;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+sliding_window_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0x5eed;
+  apr_size_t source_len = 2 * SVN_DELTA_LARGE_WINDOW_SIZE;
+  svn_stringbuf_t *source = svn_stringbuf_create_ensure(source_len, pool);
+  svn_stringbuf_t *target = svn_stringbuf_create_ensure(source_len, pool);
+  svn_string_t source_str, target_str;
+  apr_size_t v1_len, v3_len, v3_push_len;
+  apr_size_t i;
+
+  /* Random data that does not compress. */
+  for (i = 0; i < source_len; ++i)
+    svn_stringbuf_appendbyte(source, (char)svn_test_rand(&seed));
+
+  /* The target inserts 1000 random bytes every 150 kB, shifting all
+     following data against fixed-size windows. */
+  for (i = 0; i < source_len; i += 150 * 1024)
+    {
+      apr_size_t k;
+      apr_size_t chunk_len = MIN(150 * 1024, source_len - i);
+
+      for (k = 0; k < 1000; ++k)
+        svn_stringbuf_appendbyte(target, (char)svn_test_rand(&seed));
+      svn_stringbuf_appendbytes(target, source->data + i, chunk_len);
+    }
+
+  source_str.data = source->data;
+  source_str.len = source->len;
+  target_str.data = target->data;
+  target_str.len = target->len;
+
+  SVN_ERR(svndiff_round_trip(&v1_len, &source_str, &target_str, 1, FALSE,
+                             pool));
+  SVN_ERR(svndiff_round_trip(&v3_len, &source_str, &target_str, 3, FALSE,
+                             pool));
+  SVN_ERR(svndiff_round_trip(&v3_push_len, &source_str, &target_str, 3,
+                             TRUE, pool));
+
+  /* Pull and push produce the same windows. */
+  SVN_TEST_INT_ASSERT(v3_push_len, v3_len);
+
+  /* The sliding windows keep finding the shifted source data while the
+     fixed ones have to resend most of it.  Allow for some overhead on top
+     of the inserted data. */
+  SVN_TEST_ASSERT(v3_len < v1_len);
+  SVN_TEST_ASSERT(v3_len < target->len - source->len + 10 * 1024);
+
+  return SVN_NO_ERROR;
+}
+
 /* Change to 1 to enable the unit test for the delta combiner's range index: */
 #if 0
 #include "range-index-test.h"
@@ -625,6 +847,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random combine delta test"),
     SVN_TEST_PASS2(random_txdelta_to_svndiff_stream_test,
                    "random txdelta to svndiff stream test"),
+    SVN_TEST_OPTS_PASS(simd_xdelta_test,
+                       "xdelta with and without vector instructions"),
+    SVN_TEST_PASS2(sliding_window_test,
+                   "svndiff3 with large sliding windows"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
@@ -26,6 +26,7 @@
 
 #include "../svn_test.h"
 #include "../../libsvn_fs/fs-loader.h"
+#include "../../libsvn_fs_fs/cached_data.h"
 #include "../../libsvn_fs_fs/fs.h"
 #include "../../libsvn_fs_fs/fs_fs.h"
 #include "../../libsvn_fs_fs/low_level.h"
@@ -36,6 +37,10 @@
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "private/svn_cache.h"
+#include "private/svn_fs_fs_private.h"
+#include "private/svn_fs_private.h"
+#include "private/svn_io_private.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -1889,6 +1894,655 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 #undef REPO_NAME
 
 
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-read-mapped-fs"
+#define SHARD_SIZE 5
+#define MAX_REV 12
+static svn_error_t *
+read_mapped_fs(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  apr_hash_t *fs_config;
+  apr_file_t *file;
+  const char *conf = "[" CONFIG_SECTION_IO "]\n"
+                     CONFIG_OPTION_MEMORY_MAP_REV_FILES " = true\n";
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t i;
+
+  /* Revisions 10 and up will remain non-packed. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+
+  /* Enable memory mapped rev file access. */
+  SVN_ERR(svn_io_file_open(&file,
+                           svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, conf, strlen(conf), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* Use a new FS instance with disjoint caches to make sure we actually
+   * read from disk. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  ffd = fs->fsap_data;
+  if (ffd->format >= SVN_FS_FS__MIN_LOG_ADDRESSING_FORMAT)
+    SVN_TEST_ASSERT(ffd->memory_map_rev_files);
+
+  for (i = 1; i <= MAX_REV; i++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stringbuf_t *rstring;
+      apr_hash_t *changes;
+      const char *expected;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, iterpool));
+      SVN_ERR(svn_test__get_file_contents(rev_root, "iota", &rstring,
+                                          iterpool));
+      expected = (i == 1) ? "This is the file 'iota'.\n"
+                          : get_rev_contents(i, iterpool);
+      SVN_TEST_STRING_ASSERT(rstring->data, expected);
+
+      SVN_ERR(svn_fs_paths_changed2(&changes, rev_root, iterpool));
+      if (i > 1)
+        SVN_TEST_ASSERT(apr_hash_count(changes) == 1);
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-pack-stages"
+#define SHARD_SIZE 8
+#define STAGE_SIZE 3
+
+/* Open REPO_NAME with FS_CONFIG and a new cache namespace, then read
+ * 'iota' in all revisions up to YOUNGEST, verify the repository and
+ * collect its statistics.  Use POOL for allocations. */
+static svn_error_t *
+check_pack_stages_repo(apr_hash_t *fs_config,
+                       svn_revnum_t youngest,
+                       apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_revnum_t rev;
+  svn_fs_fs__ioctl_get_stats_input_t input = {0};
+  svn_fs_fs__ioctl_get_stats_output_t *output;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Use disjoint caches to make sure we actually read from disk. */
+  fs_config = apr_hash_copy(pool, fs_config);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  for (rev = 1; rev <= youngest; rev++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stringbuf_t *rstring;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, rev, iterpool));
+      SVN_ERR(svn_test__get_file_contents(rev_root, "iota", &rstring,
+                                          iterpool));
+      SVN_TEST_STRING_ASSERT(rstring->data,
+                             rev == 1 ? "This is the file 'iota'.\n"
+                                      : get_rev_contents(rev, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  /* Every revision must be counted exactly once. */
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_STATS,
+                       &input, (void**)&output, NULL, NULL, pool, pool));
+  SVN_TEST_ASSERT(output->stats->revision_count == youngest + 1);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+pack_stages(const svn_test_opts_t *opts,
+            apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  const char *conflict;
+  svn_revnum_t rev;
+  svn_node_kind_t kind;
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 15))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't support pack stages");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_PACK_STAGE_SIZE,
+                apr_itoa(pool, STAGE_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+
+  /* Revision 1: the Greek tree */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+
+  /* Run into the second shard, packing after each commit. */
+  while (rev < SHARD_SIZE + 1)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          get_rev_contents(rev + 1,
+                                                           iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, iterpool));
+      SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+      SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, iterpool));
+
+      /* By now, r0 to r5 have been packed in two stages. */
+      if (rev == 6)
+        {
+          SVN_ERR(svn_io_check_path(svn_dirent_join_many(iterpool,
+                                      REPO_NAME, "revs", "0", "3.pack",
+                                      SVN_VA_NULL),
+                                    &kind, iterpool));
+          SVN_TEST_ASSERT(kind == svn_node_file);
+          SVN_ERR(svn_io_check_path(svn_dirent_join_many(iterpool,
+                                      REPO_NAME, "revs", "0", "5",
+                                      SVN_VA_NULL),
+                                    &kind, iterpool));
+          SVN_TEST_ASSERT(kind == svn_node_none);
+
+          /* The partial last stage of the shard remains loose. */
+          SVN_ERR(svn_io_check_path(svn_dirent_join_many(iterpool,
+                                      REPO_NAME, "revs", "0", "6",
+                                      SVN_VA_NULL),
+                                    &kind, iterpool));
+          SVN_TEST_ASSERT(kind == svn_node_file);
+        }
+
+      /* While the first shard is incomplete, its older revisions live in
+       * stage packs only.  Everything must still be readable. */
+      if (rev < SHARD_SIZE)
+        SVN_ERR(check_pack_stages_repo(fs_config, rev, iterpool));
+    }
+
+  /* The shard pack replaced the stage packs. */
+  SVN_ERR(svn_io_check_path(svn_dirent_join_many(pool, REPO_NAME, "revs",
+                                                 "0", SVN_VA_NULL),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  /* Read all revisions from the shard pack as well. */
+  SVN_ERR(check_pack_stages_repo(fs_config, rev, pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef STAGE_SIZE
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-plain-file-reps"
+
+/* Return LEN pseudo-random letters for SEED, allocated in POOL.
+ * That data will not deltify well. */
+static const char *
+get_plain_contents(apr_uint32_t seed,
+                   apr_size_t len,
+                   apr_pool_t *pool)
+{
+  char *result = apr_palloc(pool, len + 1);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      result[i] = (char)('a' + (seed >> 16) % 26);
+    }
+  result[len] = '\0';
+
+  return result;
+}
+
+/* Verify that PATH in revision REV of FS has the EXPECTED contents and
+ * that they are being read from a plain file exactly if IS_FILE_STREAM
+ * is set.  Use POOL for allocations. */
+static svn_error_t *
+verify_plain_file_rep(svn_fs_t *fs,
+                      svn_revnum_t rev,
+                      const char *path,
+                      const char *expected,
+                      svn_boolean_t is_file_stream,
+                      apr_pool_t *pool)
+{
+  svn_fs_root_t *root;
+  svn_stream_t *stream;
+  svn_stringbuf_t *contents;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_file_contents(&stream, root, path, pool));
+  SVN_TEST_ASSERT((svn_stream__aprfile(stream) != NULL) == is_file_stream);
+  if (is_file_stream)
+    SVN_TEST_ASSERT(svn_stream__aprfile_end(stream) >= 0);
+
+  SVN_ERR(svn_stringbuf_from_stream(&contents, stream, 0, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, expected);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+plain_file_reps(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  apr_file_t *file;
+  apr_hash_t *fs_config;
+  svn_stream_t *stream;
+  svn_stringbuf_t *contents;
+  svn_filesize_t size;
+  apr_off_t offset;
+  char c;
+  const char *conf = "[" CONFIG_SECTION_DELTIFICATION "]\n"
+                     CONFIG_OPTION_PLAIN_FILE_THRESHOLD " = 16\n";
+  const char *large1 = get_plain_contents(1, 0x140000, pool);
+  const char *large2 = get_plain_contents(2, 0x140000, pool);
+  const char *medium = get_plain_contents(3, 100000, pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 8))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.8 SVN doesn't support deltification "
+                            "settings");
+
+  /* Store file contents of 16kB and more as PLAIN reps. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_io_file_open(&file,
+                           svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, conf, strlen(conf), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  /* r1: add a large, a medium-sized and a small file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "large", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "large", large1, pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "medium", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "medium", medium, pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "small", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "small", "small\n", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 1);
+
+  /* r2: replace the large file's contents. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "large", large2, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 2);
+
+  /* Use a new FS instance with disjoint caches to make sure we actually
+   * read from disk.  Only large PLAIN reps get served from plain files. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  SVN_ERR(verify_plain_file_rep(fs, 1, "large", large1, TRUE, pool));
+  SVN_ERR(verify_plain_file_rep(fs, 2, "large", large2, TRUE, pool));
+  SVN_ERR(verify_plain_file_rep(fs, 2, "medium", medium, FALSE, pool));
+  SVN_ERR(verify_plain_file_rep(fs, 2, "small", "small\n", FALSE, pool));
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  /* Corrupt the large PLAIN rep in r2.  It makes up the bulk of the rev
+   * file, so flipping a bit in the middle of that file hits its data. */
+  SVN_ERR(svn_io_file_open(&file, svn_fs_fs__path_rev_absolute(fs, 2, pool),
+                           APR_READ | APR_WRITE, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_size_get(&size, file, pool));
+  offset = (apr_off_t)(size / 2);
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+  SVN_ERR(svn_io_file_getc(&c, file, pool));
+  c ^= 1;
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+  SVN_ERR(svn_io_file_putc(c, file, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* Reading the fulltext must detect the corruption. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, 2, pool));
+  SVN_ERR(svn_fs_file_contents(&stream, root, "large", pool));
+  SVN_TEST_ASSERT(svn_stream__aprfile(stream) != NULL);
+  SVN_TEST_ASSERT_ERROR(svn_stringbuf_from_stream(&contents, stream, 0,
+                                                  pool),
+                        SVN_ERR_FS_CORRUPT);
+
+  /* So must verification, which checks the items' low-level checksums.
+   * Physically addressed repositories have no such checksums and
+   * 'svnadmin verify' detects the corruption by reading the contents. */
+  if (svn_fs_fs__use_log_addressing(fs))
+    SVN_TEST_ASSERT_ANY_ERROR(svn_fs_verify(REPO_NAME, NULL, 0,
+                                            SVN_INVALID_REVNUM,
+                                            NULL, NULL, NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-prefetch_file_contents"
+#define FILE_COUNT 4
+#define REV_COUNT 5
+
+/* Set *CACHED to TRUE if the headers of all reps in the delta chain of
+ * PATH in ROOT are in FS's rep header cache.  Use POOL for allocations. */
+static svn_error_t *
+rep_headers_cached(svn_boolean_t *cached,
+                   svn_fs_t *fs,
+                   svn_fs_root_t *root,
+                   const char *path,
+                   apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const svn_fs_id_t *id;
+  node_revision_t *noderev;
+  svn_fs_fs__rep_header_t *header;
+  pair_cache_key_t key;
+
+  SVN_ERR(svn_fs_node_id(&id, root, path, pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+  key.revision = noderev->data_rep->revision;
+  key.second = noderev->data_rep->item_index;
+
+  do
+    {
+      SVN_ERR(svn_cache__has_key(cached, ffd->rep_header_cache, &key,
+                                 pool));
+      if (!*cached)
+        break;
+
+      SVN_ERR(svn_cache__get((void **)&header, cached,
+                             ffd->rep_header_cache, &key, pool));
+      key.revision = header->base_revision;
+      key.second = header->base_item_index;
+    }
+  while (*cached && header->type == svn_fs_fs__rep_delta);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+prefetch_file_contents(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  apr_array_header_t *paths;
+  fs_fs_data_t *ffd;
+  svn_boolean_t cached;
+  int i, k;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  /* Build delta chains for a few files in a sub-directory. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  for (k = 0; k < REV_COUNT; ++k)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, k, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      if (k == 0)
+        SVN_ERR(svn_fs_make_dir(txn_root, "dir", iterpool));
+
+      for (i = 0; i < FILE_COUNT; ++i)
+        {
+          const char *path = apr_psprintf(iterpool, "dir/file%d", i);
+          const char *contents = get_plain_contents(i, 1000 + k, iterpool);
+          if (k == 0)
+            SVN_ERR(svn_fs_make_file(txn_root, path, iterpool));
+          SVN_ERR(svn_test__set_file_contents(txn_root, path, contents,
+                                              iterpool));
+        }
+
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+      SVN_TEST_ASSERT(rev == k + 1);
+    }
+
+  /* Use a new FS instance with disjoint caches to make sure the prefetch
+   * actually has to read from disk. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  ffd = fs->fsap_data;
+
+  /* Without a rep header cache, we can't tell whether prefetching works. */
+  if (!ffd->rep_header_cache)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "rep header cache is disabled");
+
+  /* Prefetching can be disabled. */
+  ffd->prefetch_file_contents = FALSE;
+  SVN_ERR(svn_fs_revision_root(&root, fs, REV_COUNT, iterpool));
+  paths = apr_array_make(iterpool, 1, sizeof(const char *));
+  APR_ARRAY_PUSH(paths, const char *) = "/dir/file0";
+  SVN_ERR(svn_fs__prefetch_file_contents(root, paths, iterpool));
+  SVN_ERR(rep_headers_cached(&cached, fs, root, "/dir/file0", iterpool));
+  SVN_TEST_ASSERT(!cached);
+  ffd->prefetch_file_contents = TRUE;
+
+  /* Prefetching directories and unchanged contents is harmless. */
+  for (k = 1; k <= REV_COUNT; ++k)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, k, iterpool));
+
+      paths = apr_array_make(iterpool, FILE_COUNT + 1, sizeof(const char *));
+      APR_ARRAY_PUSH(paths, const char *) = "/dir";
+      for (i = 0; i < FILE_COUNT; ++i)
+        APR_ARRAY_PUSH(paths, const char *)
+          = apr_psprintf(iterpool, "/dir/file%d", i);
+
+      SVN_ERR(svn_fs__prefetch_file_contents(root, paths, iterpool));
+
+      /* All rep headers along the delta chains are now cached. */
+      for (i = 0; i < FILE_COUNT; ++i)
+        {
+          SVN_ERR(rep_headers_cached(&cached, fs, root,
+                                     APR_ARRAY_IDX(paths, i + 1,
+                                                   const char *),
+                                     iterpool));
+          SVN_TEST_ASSERT(cached);
+        }
+
+      /* Prefetching again takes everything from the cache. */
+      SVN_ERR(svn_fs__prefetch_file_contents(root, paths, iterpool));
+
+      /* The contents must not be affected. */
+      for (i = 0; i < FILE_COUNT; ++i)
+        {
+          svn_stringbuf_t *contents;
+          SVN_ERR(svn_test__get_file_contents(root,
+                                              APR_ARRAY_IDX(paths, i + 1,
+                                                            const char *),
+                                              &contents, iterpool));
+          SVN_TEST_STRING_ASSERT(contents->data,
+                                 get_plain_contents(i, 999 + k, iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef FILE_COUNT
+#undef REV_COUNT
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-persistent-cache-restore"
+
+/* Set file "f" in a new revision on top of r(REV-1) of the repository at
+ * REPO_PATH to CONTENTS.  Use POOL for allocations. */
+static svn_error_t *
+commit_f(const char *repo_path,
+         svn_revnum_t rev,
+         const char *contents,
+         apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t new_rev;
+
+  SVN_ERR(svn_fs_open2(&fs, repo_path, NULL, pool, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  if (rev == 1)
+    SVN_ERR(svn_fs_make_file(txn_root, "f", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "f", contents, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, pool));
+  SVN_TEST_ASSERT(new_rev == rev);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that file "f" in revision REV of the repository at REPO_PATH
+ * has the EXPECTED contents.  Use POOL for allocations. */
+static svn_error_t *
+check_f(const char *repo_path,
+        svn_revnum_t rev,
+        const char *expected,
+        apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_root_t *root;
+  svn_stringbuf_t *contents;
+
+  SVN_ERR(svn_fs_open2(&fs, repo_path, NULL, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "f", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, expected);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+persistent_cache_restore(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_membuffer_t *membuffer;
+  const char *backup_path = REPO_NAME "-backup";
+  const char *conf = "[" CONFIG_SECTION_CACHES "]\n"
+                     CONFIG_OPTION_PERSISTENT_CACHE " = ../"
+                     REPO_NAME ".cache\n"
+                     CONFIG_OPTION_PERSISTENT_CACHE_SIZE " = 1\n";
+  apr_file_t *file;
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  membuffer = svn_cache__get_global_membuffer_cache();
+  if (membuffer == NULL)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this test requires a membuffer cache");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, subpool));
+  SVN_ERR(svn_io_file_open(&file,
+                           svn_dirent_join(REPO_NAME, PATH_CONFIG, subpool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, subpool));
+  SVN_ERR(svn_io_file_write_full(file, conf, strlen(conf), NULL, subpool));
+  SVN_ERR(svn_io_file_close(file, subpool));
+  svn_pool_clear(subpool);
+
+  /* Back up r1. */
+  SVN_ERR(commit_f(REPO_NAME, 1, "one\n", subpool));
+  svn_pool_clear(subpool);
+  SVN_ERR(svn_io_remove_dir2(backup_path, TRUE, NULL, NULL, subpool));
+  SVN_ERR(svn_io_copy_dir_recursively(REPO_NAME, ".", backup_path, TRUE,
+                                      NULL, NULL, subpool));
+  svn_test_add_dir_cleanup(backup_path);
+
+  /* Put r2 into the persistent cache. */
+  SVN_ERR(commit_f(REPO_NAME, 2, "two\n", subpool));
+  svn_pool_clear(subpool);
+  SVN_ERR(check_f(REPO_NAME, 2, "two\n", subpool));
+  svn_pool_clear(subpool);
+
+  /* Let the backup diverge and restore it.  Since the new r2 does not
+   * pass through the caches of REPO_NAME, those can't get updated. */
+  SVN_ERR(commit_f(backup_path, 2, "restored\n", subpool));
+  svn_pool_clear(subpool);
+  SVN_ERR(svn_io_remove_dir2(REPO_NAME, FALSE, NULL, NULL, subpool));
+  SVN_ERR(svn_io_copy_dir_recursively(backup_path, ".", REPO_NAME, TRUE,
+                                      NULL, NULL, subpool));
+
+  /* After a restart, only the persistent cache could return stale data. */
+  SVN_ERR(svn_cache__membuffer_clear(membuffer));
+  SVN_ERR(check_f(REPO_NAME, 2, "restored\n", subpool));
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+
 
 /* The test table.  */
 
@@ -1943,6 +2597,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(read_mapped_fs,
+                       "read from memory mapped rev and pack files"),
+    SVN_TEST_OPTS_PASS(pack_stages,
+                       "pack incomplete shards in stages"),
+    SVN_TEST_OPTS_PASS(plain_file_reps,
+                       "store and read large files as PLAIN reps"),
+    SVN_TEST_OPTS_PASS(prefetch_file_contents,
+                       "prefetch file contents and their delta chains"),
+    SVN_TEST_OPTS_PASS(persistent_cache_restore,
+                       "persistent cache after restoring a backup"),
     SVN_TEST_NULL
   };
 
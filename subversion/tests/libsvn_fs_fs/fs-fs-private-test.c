@@ -25,6 +25,7 @@
 
 #include "../svn_test.h"
 
+#include "svn_dirent_uri.h"
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
@@ -34,6 +35,7 @@
 #include "private/svn_fs_fs_private.h"
 #include "private/svn_subr_private.h"
 
+#include "../../libsvn_fs_fs/fs.h"
 #include "../../libsvn_fs_fs/index.h"
 #include "../../libsvn_fs_fs/rep-cache.h"
 #include "../../libsvn_fs/fs-loader.h"
@@ -274,6 +276,309 @@ get_repo_stats(const svn_test_opts_t *opts,
 
 /* ------------------------------------------------------------------------ */
 
+#define REPO_NAME "test-repo-get-repo-stats-parallel-test"
+
+/* Implements svn_fs_fs__open_fs_func_t.
+ *
+ * Open another instance of the filesystem at the path given in BATON.
+ */
+static svn_error_t *
+open_fs_again(svn_fs_t **fs,
+              void *baton,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  const char *path = baton;
+  return svn_error_trace(svn_fs_open2(fs, path, NULL, result_pool,
+                                      scratch_pool));
+}
+
+/* Verify that the representation stats A and B are identical. */
+static svn_error_t *
+compare_representation_stats(const svn_fs_fs__representation_stats_t *a,
+                             const svn_fs_fs__representation_stats_t *b)
+{
+  SVN_TEST_ASSERT(a->total.count == b->total.count);
+  SVN_TEST_ASSERT(a->total.packed_size == b->total.packed_size);
+  SVN_TEST_ASSERT(a->total.expanded_size == b->total.expanded_size);
+  SVN_TEST_ASSERT(a->total.overhead_size == b->total.overhead_size);
+  SVN_TEST_ASSERT(a->shared.count == b->shared.count);
+  SVN_TEST_ASSERT(a->uniques.count == b->uniques.count);
+  SVN_TEST_ASSERT(a->references == b->references);
+  SVN_TEST_ASSERT(a->expanded_size == b->expanded_size);
+  SVN_TEST_ASSERT(a->chain_len == b->chain_len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the histograms A and B are identical. */
+static svn_error_t *
+compare_histograms(const svn_fs_fs__histogram_t *a,
+                   const svn_fs_fs__histogram_t *b)
+{
+  int i;
+
+  SVN_TEST_ASSERT(a->total.count == b->total.count);
+  SVN_TEST_ASSERT(a->total.sum == b->total.sum);
+  for (i = 0; i < 64; ++i)
+    {
+      SVN_TEST_ASSERT(a->lines[i].count == b->lines[i].count);
+      SVN_TEST_ASSERT(a->lines[i].sum == b->lines[i].sum);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+get_repo_stats_parallel(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_fs_fs__ioctl_get_stats_input_t input = {0};
+  svn_fs_fs__ioctl_get_stats_output_t *output;
+  const svn_fs_fs__stats_t *expected;
+  int thread_count;
+  apr_size_t i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 6))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.6 SVN doesn't support FSFS packing");
+
+  /* Create a filesystem with many small shards, so the revisions get
+   * split into several ranges. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE, "3");
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Modify nodes created in earlier shards, so that node revisions and
+   * deltas refer to representations in other ranges. */
+  while (rev < 13)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool,
+                                                       "iota in r%ld\n",
+                                                       rev + 1),
+                                          iterpool));
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, rev, iterpool));
+      SVN_ERR(svn_fs_copy(rev_root, "A/mu", txn_root,
+                          apr_psprintf(iterpool, "A/mu%ld", rev + 1),
+                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  /* Pack the first few shards only. */
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  while (rev < 20)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "A/B/lambda",
+                                          apr_psprintf(iterpool,
+                                                       "lambda in r%ld\n",
+                                                       rev + 1),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  /* The serial run is our reference. */
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_STATS,
+                       &input, (void**)&output, NULL, NULL, pool, pool));
+  expected = output->stats;
+  SVN_TEST_ASSERT(expected->revision_count == 21);
+
+  /* The concurrent runs must produce the exact same stats. */
+  input.open_fs_func = open_fs_again;
+  input.open_fs_baton = (void *)svn_fs_path(fs, pool);
+  for (thread_count = 2; thread_count <= 8; thread_count *= 2)
+    {
+      const svn_fs_fs__stats_t *actual;
+
+      input.thread_count = thread_count;
+      SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_STATS,
+                           &input, (void**)&output, NULL, NULL, pool, pool));
+      actual = output->stats;
+
+      SVN_TEST_ASSERT(actual->total_size == expected->total_size);
+      SVN_TEST_ASSERT(actual->revision_count == expected->revision_count);
+      SVN_TEST_ASSERT(actual->change_count == expected->change_count);
+      SVN_TEST_ASSERT(actual->change_len == expected->change_len);
+
+      SVN_ERR(compare_representation_stats(&actual->total_rep_stats,
+                                           &expected->total_rep_stats));
+      SVN_ERR(compare_representation_stats(&actual->file_rep_stats,
+                                           &expected->file_rep_stats));
+      SVN_ERR(compare_representation_stats(&actual->dir_rep_stats,
+                                           &expected->dir_rep_stats));
+
+      SVN_TEST_ASSERT(actual->total_node_stats.count
+                      == expected->total_node_stats.count);
+      SVN_TEST_ASSERT(actual->total_node_stats.size
+                      == expected->total_node_stats.size);
+
+      SVN_TEST_ASSERT(actual->largest_changes->count
+                      == expected->largest_changes->count);
+      SVN_TEST_ASSERT(actual->largest_changes->min_size
+                      == expected->largest_changes->min_size);
+      for (i = 0; i < actual->largest_changes->count; ++i)
+        SVN_TEST_ASSERT(actual->largest_changes->changes[i]->size
+                        == expected->largest_changes->changes[i]->size);
+
+      SVN_ERR(compare_histograms(&actual->rep_size_histogram,
+                                 &expected->rep_size_histogram));
+      SVN_ERR(compare_histograms(&actual->node_size_histogram,
+                                 &expected->node_size_histogram));
+      SVN_ERR(compare_histograms(&actual->added_rep_size_histogram,
+                                 &expected->added_rep_size_histogram));
+      SVN_ERR(compare_histograms(&actual->unused_rep_histogram,
+                                 &expected->unused_rep_histogram));
+      SVN_ERR(compare_histograms(&actual->file_histogram,
+                                 &expected->file_histogram));
+      SVN_ERR(compare_histograms(&actual->dir_histogram,
+                                 &expected->dir_histogram));
+
+      SVN_TEST_ASSERT(apr_hash_count(actual->by_extension)
+                      == apr_hash_count(expected->by_extension));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-get-repo-stats-stage-packed-test"
+#define SHARD_SIZE 8
+#define STAGE_SIZE 3
+
+static svn_error_t *
+get_repo_stats_stage_packed(const svn_test_opts_t *opts,
+                            apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t rev;
+  svn_node_kind_t kind;
+  apr_hash_t *fs_config;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_fs_fs__ioctl_get_stats_input_t input = {0};
+  svn_fs_fs__ioctl_get_stats_output_t *output;
+  const svn_fs_fs__stats_t *expected;
+  int thread_count;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 15))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't support pack stages");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_PACK_STAGE_SIZE,
+                apr_itoa(pool, STAGE_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Fill the first shard up to r6, leaving it incomplete. */
+  while (rev < SHARD_SIZE - 2)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool,
+                                                       "iota in r%ld\n",
+                                                       rev + 1),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  /* The stats of the non-packed repository are our reference. */
+  SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_STATS,
+                       &input, (void**)&output, NULL, NULL, pool, pool));
+  expected = output->stats;
+  SVN_TEST_ASSERT(expected->revision_count == SHARD_SIZE - 1);
+
+  /* Combine r0 to r5 into two stage packs and leave r6 loose. */
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_io_check_path(svn_dirent_join_many(pool, REPO_NAME, "revs",
+                                                 "0", "3.pack",
+                                                 SVN_VA_NULL),
+                            &kind, pool));
+  if (kind != svn_node_file)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pack stages are not enabled for this repo");
+
+  /* Each revision must be counted exactly once, no matter whether the
+   * stats get collected serially or concurrently. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  input.open_fs_func = open_fs_again;
+  input.open_fs_baton = (void *)svn_fs_path(fs, pool);
+  for (thread_count = 1; thread_count <= 4; thread_count *= 2)
+    {
+      const svn_fs_fs__stats_t *actual;
+
+      input.thread_count = thread_count;
+      SVN_ERR(svn_fs_ioctl(fs, SVN_FS_FS__IOCTL_GET_STATS,
+                           &input, (void**)&output, NULL, NULL, pool, pool));
+      actual = output->stats;
+
+      SVN_TEST_ASSERT(actual->revision_count == expected->revision_count);
+      SVN_TEST_ASSERT(actual->change_count == expected->change_count);
+      SVN_TEST_ASSERT(actual->change_len == expected->change_len);
+
+      SVN_ERR(compare_representation_stats(&actual->total_rep_stats,
+                                           &expected->total_rep_stats));
+      SVN_ERR(compare_representation_stats(&actual->file_rep_stats,
+                                           &expected->file_rep_stats));
+      SVN_ERR(compare_representation_stats(&actual->dir_rep_stats,
+                                           &expected->dir_rep_stats));
+
+      SVN_TEST_ASSERT(actual->total_node_stats.count
+                      == expected->total_node_stats.count);
+      SVN_TEST_ASSERT(actual->total_node_stats.size
+                      == expected->total_node_stats.size);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef STAGE_SIZE
+
+/* ------------------------------------------------------------------------ */
+
 #define REPO_NAME "test-repo-dump-index-test"
 
 typedef struct dump_baton_t
@@ -424,8 +729,8 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
   SVN_ERR(svn_fs_ioctl(svn_repos_fs(repos), SVN_FS_FS__IOCTL_LOAD_INDEX,
                        &load_input, NULL, NULL, NULL, pool, pool));
 
-  SVN_TEST_ASSERT_ERROR(svn_repos_verify_fs3(repos, rev, rev, FALSE, FALSE,
-                                             NULL, NULL, NULL, NULL, NULL,
+  SVN_TEST_ASSERT_ERROR(svn_repos_verify_fs4(repos, rev, rev, FALSE, FALSE,
+                                             1, NULL, NULL, NULL, NULL, NULL,
                                              NULL, pool),
                         SVN_ERR_FS_INDEX_CORRUPTION);
 
@@ -434,7 +739,7 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
   load_input.entries = entries;
   SVN_ERR(svn_fs_ioctl(svn_repos_fs(repos), SVN_FS_FS__IOCTL_LOAD_INDEX,
                        &load_input, NULL, NULL, NULL, pool, pool));
-  SVN_ERR(svn_repos_verify_fs3(repos, rev, rev, FALSE, FALSE, NULL, NULL,
+  SVN_ERR(svn_repos_verify_fs4(repos, rev, rev, FALSE, FALSE, 1, NULL, NULL,
                                NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
@@ -498,6 +803,164 @@ build_rep_cache(const svn_test_opts_t *opts, apr_pool_t *pool)
 
   return SVN_NO_ERROR;
 }
+/* ------------------------------------------------------------------------ */
+
+static svn_error_t *
+sharded_txn(const svn_test_opts_t *opts,
+            apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_fs_root_t *rev_root;
+  svn_revnum_t rev;
+  const char *txn_name;
+  const char *txn_dir;
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  svn_stringbuf_t *contents;
+  int shards = 0;
+  int i;
+  const char *fs_path = "test-repo-sharded-txn";
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 15))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't shard transactions");
+
+  /* Add a number of files in a single transaction. */
+  SVN_ERR(svn_test__create_fs2(&fs, fs_path, opts, NULL, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  for (i = 0; i < 100; ++i)
+    {
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_psprintf(iterpool, "file-%d", i);
+      SVN_ERR(svn_fs_make_file(txn_root, path, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, path,
+                                          apr_psprintf(iterpool, "%d\n", i),
+                                          iterpool));
+    }
+
+  /* The node files must live in shard sub-folders. */
+  SVN_ERR(svn_fs_txn_name(&txn_name, txn, pool));
+  txn_dir = svn_dirent_join_many(pool, fs_path, "transactions",
+                                 apr_pstrcat(pool, txn_name, ".txn",
+                                             SVN_VA_NULL),
+                                 SVN_VA_NULL);
+  SVN_ERR(svn_io_get_dirents3(&dirents, txn_dir, TRUE, pool, pool));
+  for (hi = apr_hash_first(pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+
+      SVN_TEST_ASSERT(strncmp(name, "node.", 5) != 0);
+      if (dirent->kind == svn_node_dir)
+        {
+          SVN_TEST_ASSERT(strlen(name) == 2);
+          ++shards;
+        }
+    }
+
+  SVN_TEST_ASSERT(shards > 1);
+
+  /* Commit and read the data back. */
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(rev_root, "file-42", &contents,
+                                      pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "42\n");
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-reopen-modified-fs"
+
+static svn_error_t *
+reopen_modified_fs(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs1;
+  svn_fs_t *fs2;
+  fs_fs_data_t *ffd;
+  apr_file_t *file;
+  const char *uuid1, *uuid2;
+  const char *format_path = svn_dirent_join(REPO_NAME, PATH_FORMAT, pool);
+  const char *new_uuid = svn_uuid_generate(pool);
+  svn_stringbuf_t *format;
+  apr_time_t mtime;
+  const char *conf = "[" CONFIG_SECTION_IO "]\n"
+                     CONFIG_OPTION_MEMORY_MAP_REV_FILES " = true\n";
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 15))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.15 SVN doesn't cache FSFS metadata");
+
+  /* Opening the FS populates the metadata cache. */
+  SVN_ERR(svn_test__create_fs2(&fs1, REPO_NAME, opts, NULL, pool));
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+  ffd = fs2->fsap_data;
+  SVN_TEST_ASSERT(!ffd->memory_map_rev_files);
+
+  /* Modify the repository IDs as well as the configuration. */
+  SVN_ERR(svn_fs_set_uuid(fs1, NULL, pool));
+  SVN_ERR(svn_io_file_open(&file,
+                           svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, conf, strlen(conf), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* A new FS instance must not use outdated cached metadata. */
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_get_uuid(fs1, &uuid1, pool));
+  SVN_ERR(svn_fs_get_uuid(fs2, &uuid2, pool));
+  SVN_TEST_STRING_ASSERT(uuid2, uuid1);
+
+  ffd = fs2->fsap_data;
+  SVN_TEST_ASSERT(ffd->memory_map_rev_files);
+
+  /* Change the UUID in the format file in-place, keeping its size and
+   * mtime.  The cache must still notice. */
+  SVN_ERR(svn_stringbuf_from_file2(&format, format_path, pool));
+  SVN_TEST_ASSERT(strstr(format->data, uuid1) != NULL);
+  SVN_TEST_ASSERT(strlen(new_uuid) == strlen(uuid1));
+  memcpy(strstr(format->data, uuid1), new_uuid, strlen(new_uuid));
+
+  SVN_ERR(svn_io_file_affected_time(&mtime, format_path, pool));
+  SVN_ERR(svn_io_set_file_read_write(format_path, FALSE, pool));
+  SVN_ERR(svn_io_file_open(&file, format_path, APR_WRITE, APR_OS_DEFAULT,
+                           pool));
+  SVN_ERR(svn_io_file_write_full(file, format->data, format->len, NULL,
+                                 pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+  SVN_ERR(svn_io_set_file_affected_time(mtime, format_path, pool));
+
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_get_uuid(fs2, &uuid2, pool));
+  SVN_TEST_STRING_ASSERT(uuid2, new_uuid);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
 
 
 
@@ -510,12 +973,20 @@ static struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_NULL,
     SVN_TEST_OPTS_PASS(get_repo_stats,
                        "get statistics on a FSFS filesystem"),
+    SVN_TEST_OPTS_PASS(get_repo_stats_parallel,
+                       "get statistics using multiple threads"),
+    SVN_TEST_OPTS_PASS(get_repo_stats_stage_packed,
+                       "get statistics from a stage-packed repo"),
     SVN_TEST_OPTS_PASS(dump_index,
                        "dump the P2L index"),
     SVN_TEST_OPTS_PASS(load_index,
                        "load the P2L index"),
     SVN_TEST_OPTS_PASS(build_rep_cache,
                        "build the representation cache"),
+    SVN_TEST_OPTS_PASS(sharded_txn,
+                       "shard the node files of transactions"),
+    SVN_TEST_OPTS_PASS(reopen_modified_fs,
+                       "re-open FSFS after changing its metadata"),
     SVN_TEST_NULL
   };
 
@@ -25,13 +25,15 @@
 #include <apr_pools.h>
 
 #include "../svn_test.h"
-#include "../../libsvn_fs_x/batch_fsync.h"
 #include "../../libsvn_fs_x/fs.h"
+#include "../../libsvn_fs_x/low_level.h"
 #include "../../libsvn_fs_x/reps.h"
 
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "private/svn_fs_util.h"
+#include "private/svn_io_private.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -820,6 +822,88 @@ test_reps(const svn_test_opts_t *opts,
 #undef SHARD_SIZE
 #undef MAX_REV
 
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-fsx-reps-base"
+#define SHARD_SIZE 3
+#define MAX_REV 5
+static svn_error_t *
+test_reps_base(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_fs_t *fs = NULL;
+  svn_fs_x__reps_builder_t *builder;
+  svn_fs_x__reps_t *container;
+  svn_stringbuf_t *serialized;
+  svn_stream_t *stream;
+  svn_stringbuf_t *base = svn_stringbuf_create_ensure(20000, pool);
+  apr_array_header_t *versions = apr_array_make(pool, 20,
+                                                sizeof(svn_string_t *));
+  svn_fs_x__id_t base_id;
+  apr_size_t idx;
+  int i;
+
+  /* A base text with little internal redundancy. */
+  for (i = 0; i < 2000; ++i)
+    svn_stringbuf_appendcstr(base, apr_psprintf(pool, "line %d\n", i * 7));
+
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  builder = svn_fs_x__reps_builder_create(fs, pool);
+  base_id.change_set = svn_fs_x__change_set_by_rev(1);
+  base_id.number = 2;
+  SVN_ERR(svn_fs_x__reps_add_base(&idx, builder, &base_id,
+                                  svn_string_create_from_buf(base, pool), 1));
+  SVN_TEST_ASSERT(idx == 0);
+  APR_ARRAY_PUSH(versions, svn_string_t *)
+    = svn_string_create_from_buf(base, pool);
+
+  /* Versions that each modify and insert a little bit of text. */
+  for (i = 1; i < 20; ++i)
+    {
+      svn_stringbuf_t *version = svn_stringbuf_dup(base, pool);
+      svn_stringbuf_replace(version, i * 500, 4, "LINE", 4);
+      svn_stringbuf_insert(version, i * 900, "inserted\n", 9);
+
+      SVN_ERR(svn_fs_x__reps_add(&idx, builder,
+                                 svn_string_create_from_buf(version, pool)));
+      SVN_TEST_ASSERT(idx == versions->nelts);
+      APR_ARRAY_PUSH(versions, svn_string_t *)
+        = svn_string_create_from_buf(version, pool);
+    }
+
+  /* Sharing the base should keep the container small. */
+  SVN_TEST_ASSERT(svn_fs_x__reps_estimate_size(builder) < base->len);
+
+  serialized = svn_stringbuf_create_empty(pool);
+  stream = svn_stream_from_stringbuf(serialized, pool);
+  SVN_ERR(svn_fs_x__write_reps_container(stream, builder, pool));
+
+  SVN_ERR(svn_stream_reset(stream));
+  SVN_ERR(svn_fs_x__read_reps_container(&container, stream, pool, pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  /* All fulltexts, including the base, must be restored correctly. */
+  for (i = 0; i < versions->nelts; ++i)
+    {
+      svn_fs_x__rep_extractor_t *extractor;
+      svn_stringbuf_t *contents;
+      svn_string_t *expected = APR_ARRAY_IDX(versions, i, svn_string_t *);
+
+      SVN_ERR(svn_fs_x__reps_get(&extractor, fs, container, i, pool));
+      SVN_ERR(svn_fs_x__extractor_drive(&contents, extractor, 0, 0,
+                                        pool, pool));
+      SVN_TEST_STRING_ASSERT(contents->data, expected->data);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
 /* ------------------------------------------------------------------------ */
 #define REPO_NAME "test-repo-fsx-pack-shard-size-one"
 #define SHARD_SIZE 1
@@ -851,7 +935,7 @@ test_batch_fsync(const svn_test_opts_t *opts,
                  apr_pool_t *pool)
 {
   const char *abspath;
-  svn_fs_x__batch_fsync_t *batch;
+  svn_fs__batch_fsync_t *batch;
   int i;
 
   /* Disable this test for non FSX backends because it has no relevance to
@@ -870,13 +954,13 @@ test_batch_fsync(const svn_test_opts_t *opts,
 
   /* Initialize infrastructure with a pool that lives as long as this
    * application. */
-  SVN_ERR(svn_fs_x__batch_fsync_init(pool));
+  SVN_ERR(svn_fs__batch_fsync_init(pool));
 
   /* We use and re-use the same batch object throughout this test. */
-  SVN_ERR(svn_fs_x__batch_fsync_create(&batch, TRUE, pool));
+  SVN_ERR(svn_fs__batch_fsync_create(&batch, TRUE, pool));
 
   /* The working directory is new. */
-  SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, abspath, pool));
+  SVN_ERR(svn_fs__batch_fsync_new_path(batch, abspath, pool));
 
   /* 1st run: Has to fire up worker threads etc. */
   for (i = 0; i < 10; ++i)
@@ -887,12 +971,12 @@ test_batch_fsync(const svn_test_opts_t *opts,
                                          pool);
       apr_size_t len = strlen(path);
 
-      SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, path, pool));
+      SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, path, pool));
 
       SVN_ERR(svn_io_file_write(file, path, &len, pool));
     }
 
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, pool));
+  SVN_ERR(svn_fs__batch_fsync_run(batch, pool));
 
   /* 2nd run: Running a batch must leave the container in an empty,
    * re-usable state. Hence, try to re-use it. */
@@ -904,12 +988,12 @@ test_batch_fsync(const svn_test_opts_t *opts,
                                          pool);
       apr_size_t len = strlen(path);
 
-      SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, path, pool));
+      SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, path, pool));
 
       SVN_ERR(svn_io_file_write(file, path, &len, pool));
     }
 
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, pool));
+  SVN_ERR(svn_fs__batch_fsync_run(batch, pool));
 
   /* 3rd run: Schedule but don't execute. POOL cleanup shall not fail. */
   for (i = 0; i < 10; ++i)
@@ -920,7 +1004,7 @@ test_batch_fsync(const svn_test_opts_t *opts,
                                          pool);
       apr_size_t len = strlen(path);
 
-      SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, path, pool));
+      SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, path, pool));
 
       SVN_ERR(svn_io_file_write(file, path, &len, pool));
     }
@@ -929,6 +1013,280 @@ test_batch_fsync(const svn_test_opts_t *opts,
 }
 #undef REPO_NAME
 /* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-fsx-large-file-storage"
+#define SHARD_SIZE 2
+
+/* Return LEN pseudo-random letters for SEED, allocated in POOL.
+ * That data will neither deltify nor compress well. */
+static const char *
+get_large_contents(apr_uint32_t seed,
+                   apr_size_t len,
+                   apr_pool_t *pool)
+{
+  char *result = apr_palloc(pool, len + 1);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      result[i] = (char)('a' + (seed >> 16) % 26);
+    }
+  result[len] = '\0';
+
+  return result;
+}
+
+/* Verify that "large" and "small" in revision REV of FS have the expected
+ * contents and that only the former is being served from a plain file.
+ * Use POOL for allocations. */
+static svn_error_t *
+verify_large_file_storage(svn_fs_t *fs,
+                          svn_revnum_t rev,
+                          const char *expected,
+                          apr_pool_t *pool)
+{
+  svn_fs_root_t *root;
+  svn_stream_t *stream;
+  svn_stringbuf_t *contents;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+
+  SVN_ERR(svn_fs_file_contents(&stream, root, "large", pool));
+  SVN_TEST_ASSERT(svn_stream__aprfile(stream) != NULL);
+  SVN_ERR(svn_stringbuf_from_stream(&contents, stream, 0, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, expected);
+
+  SVN_ERR(svn_fs_file_contents(&stream, root, "small", pool));
+  SVN_TEST_ASSERT(svn_stream__aprfile(stream) == NULL);
+  SVN_ERR(svn_stringbuf_from_stream(&contents, stream, 0, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "small\n");
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_large_file_storage(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  apr_file_t *file;
+  const char *conflict;
+  svn_revnum_t rev;
+  svn_node_kind_t kind;
+  int version;
+  struct pack_notify_baton pnb;
+  svn_fs_root_t *root;
+  svn_stream_t *stream;
+  svn_stringbuf_t *contents;
+  svn_checksum_t *sha1;
+  const char *name;
+  const char *path;
+  apr_off_t offset;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  const char *config = "[" CONFIG_SECTION_DELTIFICATION "]\n"
+                       CONFIG_OPTION_LARGE_FILE_THRESHOLD " = 16\n";
+  const char *large1 = get_large_contents(1, 100000, pool);
+  const char *large2 = get_large_contents(2, 100000, pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsx") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSX repositories only");
+
+  /* Create a sharded filesystem that stores reps with a deltified size
+   * of more than 16kB out-of-line. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, subpool));
+  svn_pool_destroy(subpool);
+
+  SVN_ERR(svn_io_read_version_file(&version,
+                                   svn_dirent_join(REPO_NAME, "format", pool),
+                                   pool));
+  SVN_ERR(write_format(REPO_NAME, version, SHARD_SIZE, pool));
+  SVN_ERR(svn_io_file_open(&file, svn_dirent_join(REPO_NAME, PATH_CONFIG,
+                                                  pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  /* r1: add a large and a small file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "large", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "large", large1, pool));
+  SVN_ERR(svn_fs_make_file(txn_root, "small", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "small", "small\n", pool));
+  SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 1);
+
+  /* r2: replace the large file's contents. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "large", large2, pool));
+  SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 2);
+
+  SVN_ERR(svn_io_check_path(svn_dirent_join(REPO_NAME, PATH_LARGE_DIR, pool),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_dir);
+
+  SVN_ERR(verify_large_file_storage(fs, 1, large1, pool));
+  SVN_ERR(verify_large_file_storage(fs, 2, large2, pool));
+
+  /* Packing must keep the out-of-line fulltexts accessible. */
+  pnb.expected_shard = 0;
+  pnb.expected_action = svn_fs_pack_notify_start;
+  SVN_ERR(svn_fs_pack(REPO_NAME, pack_notify, &pnb, NULL, NULL, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(verify_large_file_storage(fs, 1, large1, pool));
+  SVN_ERR(verify_large_file_storage(fs, 2, large2, pool));
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  /* Corrupt the r2 fulltext without changing its size. */
+  SVN_ERR(svn_checksum(&sha1, svn_checksum_sha1, large2, strlen(large2),
+                       pool));
+  name = svn_checksum_to_cstring(sha1, pool);
+  path = svn_dirent_join_many(pool, REPO_NAME, PATH_LARGE_DIR,
+                              apr_pstrndup(pool, name, 2), name,
+                              SVN_VA_NULL);
+  SVN_ERR(svn_io_set_file_read_write(path, FALSE, pool));
+  SVN_ERR(svn_io_file_open(&file, path, APR_WRITE, APR_OS_DEFAULT, pool));
+  offset = 1000;
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+  SVN_ERR(svn_io_file_write_full(file, "!", 1, NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* Both, reading the contents and verification, must detect that. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, 2, pool));
+  SVN_ERR(svn_fs_file_contents(&stream, root, "large", pool));
+  SVN_TEST_ASSERT_ERROR(svn_stringbuf_from_stream(&contents, stream, 0,
+                                                  pool),
+                        SVN_ERR_FS_CORRUPT);
+  SVN_TEST_ASSERT_ANY_ERROR(svn_fs_verify(REPO_NAME, NULL, 0,
+                                          SVN_INVALID_REVNUM,
+                                          NULL, NULL, NULL, NULL, pool));
+
+  /* The r1 contents are still fine. */
+  SVN_ERR(verify_large_file_storage(fs, 1, large1, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+/* ------------------------------------------------------------------------ */
+#define ENTRY_COUNT 1000
+
+/* Return a dirent for entry number I, allocated in POOL.  If ID_USED is
+ * FALSE, the entry represents a deletion. */
+static svn_fs_x__dirent_t *
+make_dirent(int i,
+            svn_boolean_t id_used,
+            apr_pool_t *pool)
+{
+  svn_fs_x__dirent_t *dirent = apr_pcalloc(pool, sizeof(*dirent));
+  dirent->name = apr_psprintf(pool, "entry-%04d", i);
+  dirent->kind = (i % 2) ? svn_node_file : svn_node_dir;
+  if (id_used)
+    {
+      dirent->id.change_set = i;
+      dirent->id.number = i * 3;
+    }
+  else
+    {
+      svn_fs_x__id_reset(&dirent->id);
+    }
+
+  return dirent;
+}
+
+static svn_error_t *
+test_dir_representation(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  apr_array_header_t *entries
+    = apr_array_make(pool, ENTRY_COUNT, sizeof(svn_fs_x__dirent_t *));
+  apr_array_header_t *parsed;
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  svn_stream_t *stream = svn_stream_from_stringbuf(data, pool);
+  svn_fs_x__id_t dir_id;
+  svn_fs_x__dirent_t *dirent;
+  int i;
+
+  /* Serialize all even entries. */
+  for (i = 0; i < ENTRY_COUNT; i += 2)
+    APR_ARRAY_PUSH(entries, svn_fs_x__dirent_t *) = make_dirent(i, TRUE,
+                                                                pool);
+
+  svn_fs_x__id_reset(&dir_id);
+  SVN_ERR(svn_fs_x__write_dir_entries(stream, entries, pool));
+
+  /* Find every entry through the index. */
+  for (i = 0; i < ENTRY_COUNT; ++i)
+    {
+      SVN_ERR(svn_fs_x__find_serialized_dir_entry(&dirent, data, FALSE,
+                              apr_psprintf(pool, "entry-%04d", i),
+                              &dir_id, pool, pool));
+      if (i % 2)
+        {
+          SVN_TEST_ASSERT(dirent == NULL);
+        }
+      else
+        {
+          SVN_TEST_ASSERT(dirent != NULL);
+          SVN_TEST_ASSERT(dirent->id.change_set == i);
+          SVN_TEST_ASSERT(dirent->id.number == (apr_uint64_t)i * 3);
+        }
+    }
+
+  /* Apply some changes like a transaction would: add odd entries in
+   * descending order and delete every fourth entry. */
+  for (i = ENTRY_COUNT - 1; i > 0; i -= 2)
+    SVN_ERR(svn_fs_x__write_dir_entry(stream, make_dirent(i, TRUE, pool),
+                                      pool));
+  for (i = 0; i < ENTRY_COUNT; i += 4)
+    SVN_ERR(svn_fs_x__write_dir_entry(stream, make_dirent(i, FALSE, pool),
+                                      pool));
+
+  /* The non-incremental parser must reject this. */
+  SVN_TEST_ASSERT_ERROR(svn_fs_x__parse_dir_entries(&parsed, data, FALSE,
+                                                    &dir_id, pool, pool),
+                        SVN_ERR_FS_CORRUPT);
+
+  /* Parse it and verify the result is sorted and complete. */
+  SVN_ERR(svn_fs_x__parse_dir_entries(&parsed, data, TRUE, &dir_id,
+                                      pool, pool));
+  SVN_TEST_ASSERT(parsed->nelts == ENTRY_COUNT - ENTRY_COUNT / 4);
+  for (i = 1; i < parsed->nelts; ++i)
+    SVN_TEST_ASSERT(strcmp(APR_ARRAY_IDX(parsed, i - 1,
+                                         svn_fs_x__dirent_t *)->name,
+                           APR_ARRAY_IDX(parsed, i,
+                                         svn_fs_x__dirent_t *)->name) < 0);
+
+  /* Direct lookups must see the same changes. */
+  for (i = 0; i < ENTRY_COUNT; ++i)
+    {
+      SVN_ERR(svn_fs_x__find_serialized_dir_entry(&dirent, data, TRUE,
+                              apr_psprintf(pool, "entry-%04d", i),
+                              &dir_id, pool, pool));
+      if (i % 4 == 0)
+        SVN_TEST_ASSERT(dirent == NULL);
+      else
+        SVN_TEST_ASSERT(dirent && dirent->id.change_set == i);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef ENTRY_COUNT
+/* ------------------------------------------------------------------------ */
+/* ------------------------------------------------------------------------ */
 
 /* The test table.  */
 
@@ -959,10 +1317,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test svn_fs_info"),
     SVN_TEST_OPTS_PASS(test_reps,
                        "test representations container"),
+    SVN_TEST_OPTS_PASS(test_reps_base,
+                       "base representations in star-delta containers"),
     SVN_TEST_OPTS_PASS(pack_shard_size_one,
                        "test packing with shard size = 1"),
     SVN_TEST_OPTS_PASS(test_batch_fsync,
                        "test batch fsync"),
+    SVN_TEST_OPTS_PASS(test_large_file_storage,
+                       "test out-of-line storage of large files"),
+    SVN_TEST_OPTS_PASS(test_dir_representation,
+                       "test sorted binary directory representation"),
     SVN_TEST_NULL
   };
 
@@ -37,6 +37,8 @@
 #include "svn_dirent_uri.h"
 #include "svn_hash.h"
 
+#include "private/svn_ra_private.h"
+
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
 #include "../../libsvn_ra_local/ra_local.h"
@@ -1877,6 +1879,91 @@ test_get_deleted_rev_errors(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Test svn_ra__get_dirs() over a tunnel, where the session has a username
+   and ra_svn may pipeline the requests. */
+static svn_error_t *
+tunnel_get_dirs(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  tunnel_baton_t *b = apr_pcalloc(pool, sizeof(*b));
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  const char *url;
+  svn_ra_callbacks2_t *cbtable;
+  svn_ra_session_t *session;
+  const char tunnel_repos_name[] = "test-get-dirs";
+  apr_array_header_t *paths, *listings;
+  apr_hash_t *dirents;
+
+  b->magic = TUNNEL_MAGIC;
+
+  SVN_ERR(svn_test__create_repos(NULL, tunnel_repos_name, opts, scratch_pool));
+
+  /* Immediately close the repository to avoid race condition with svnserve
+     (and then the cleanup code) with BDB when our pool is cleared. */
+  svn_pool_clear(scratch_pool);
+
+  url = apr_pstrcat(pool, "svn+test://localhost/", tunnel_repos_name,
+                    SVN_VA_NULL);
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  cbtable->check_tunnel_func = check_tunnel;
+  cbtable->open_tunnel_func = open_tunnel;
+  cbtable->tunnel_baton = b;
+  SVN_ERR(svn_cmdline_create_auth_baton2(&cbtable->auth_baton,
+                                         TRUE  /* non_interactive */,
+                                         "jrandom", "rayjandom",
+                                         NULL,
+                                         TRUE  /* no_auth_cache */,
+                                         FALSE /* trust_server_cert */,
+                                         FALSE, FALSE, FALSE, FALSE,
+                                         NULL, NULL, NULL, pool));
+
+  SVN_ERR(svn_ra_open5(&session, NULL, NULL, url, NULL, cbtable, NULL, NULL,
+                       pool));
+  SVN_ERR(commit_tree(session, pool));
+
+  /* Listings come back in request order, duplicates included. */
+  paths = apr_array_make(pool, 5, sizeof(const char *));
+  APR_ARRAY_PUSH(paths, const char *) = "A/B";
+  APR_ARRAY_PUSH(paths, const char *) = "";
+  APR_ARRAY_PUSH(paths, const char *) = "A/BB";
+  APR_ARRAY_PUSH(paths, const char *) = "A";
+  APR_ARRAY_PUSH(paths, const char *) = "A/B";
+  SVN_ERR(svn_ra__get_dirs(session, &listings, paths, 1, SVN_DIRENT_KIND,
+                           pool, pool));
+  SVN_TEST_INT_ASSERT(listings->nelts, 5);
+
+  dirents = APR_ARRAY_IDX(listings, 0, apr_hash_t *);
+  SVN_TEST_INT_ASSERT(apr_hash_count(dirents), 2);
+  SVN_TEST_ASSERT(svn_hash_gets(dirents, "f"));
+  dirents = APR_ARRAY_IDX(listings, 1, apr_hash_t *);
+  SVN_TEST_INT_ASSERT(apr_hash_count(dirents), 1);
+  SVN_TEST_ASSERT(svn_hash_gets(dirents, "A"));
+  dirents = APR_ARRAY_IDX(listings, 2, apr_hash_t *);
+  SVN_TEST_INT_ASSERT(apr_hash_count(dirents), 2);
+  SVN_TEST_ASSERT(svn_hash_gets(dirents, "g"));
+  dirents = APR_ARRAY_IDX(listings, 3, apr_hash_t *);
+  SVN_TEST_INT_ASSERT(apr_hash_count(dirents), 2);
+  SVN_TEST_ASSERT(svn_hash_gets(dirents, "BB"));
+  dirents = APR_ARRAY_IDX(listings, 4, apr_hash_t *);
+  SVN_TEST_INT_ASSERT(apr_hash_count(dirents), 2);
+
+  /* A failing request in the middle of the batch ... */
+  paths = apr_array_make(pool, 3, sizeof(const char *));
+  APR_ARRAY_PUSH(paths, const char *) = "A";
+  APR_ARRAY_PUSH(paths, const char *) = "A/non-existent";
+  APR_ARRAY_PUSH(paths, const char *) = "A/B";
+  SVN_TEST_ASSERT_ERROR(svn_ra__get_dirs(session, &listings, paths, 1,
+                                         SVN_DIRENT_KIND, pool, pool),
+                        SVN_ERR_FS_NOT_FOUND);
+
+  /* ... must leave the connection usable. */
+  SVN_ERR(svn_ra_get_dir2(session, &dirents, NULL, NULL, "A/BB", 1,
+                          SVN_DIRENT_KIND, pool));
+  SVN_TEST_INT_ASSERT(apr_hash_count(dirents), 2);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -1917,6 +2004,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test get-deleted-rev no delete"),
     SVN_TEST_OPTS_PASS(test_get_deleted_rev_errors,
                        "test get-deleted-rev errors"),
+    SVN_TEST_OPTS_PASS(tunnel_get_dirs,
+                       "test pipelined get-dir over a tunnel"),
     SVN_TEST_NULL
   };
 
@@ -22,12 +22,16 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <apr_general.h>
 #include <apr_lib.h>
 #include <apr_time.h>
+#include <apr_thread_proc.h>
 
 #include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
 
 #include "private/svn_cache.h"
 #include "svn_private_config.h"
@@ -590,6 +594,553 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+
+/* Number of distinct keys being read concurrently by all threads. */
+#define HOT_KEY_COUNT 64
+
+/* Number of lookups per reader thread. */
+#define LOOKUP_COUNT 20000
+
+/* Per-thread data for test_membuffer_concurrent_reads. */
+typedef struct reader_baton_t
+{
+  /* Cache to read from. */
+  svn_cache__t *cache;
+
+  /* Thread-local pool. */
+  apr_pool_t *pool;
+
+  /* If set, this thread also keeps re-writing the hot keys to trigger
+   * the fallback to the locked code path in the other threads. */
+  svn_boolean_t writer;
+
+  /* First error encountered. */
+  svn_error_t *err;
+} reader_baton_t;
+
+/* Return the cache key for hot key number I, allocated in POOL. */
+static const char *
+hot_key(int i, apr_pool_t *pool)
+{
+  return apr_psprintf(pool, "hot-key-%d", i);
+}
+
+/* Look up all hot keys in BATON->CACHE over and over again and verify
+ * that we always get the correct value. */
+static svn_error_t *
+read_hot_keys(reader_baton_t *baton)
+{
+  apr_pool_t *iterpool = svn_pool_create(baton->pool);
+  int i;
+
+  for (i = 0; i < LOOKUP_COUNT; ++i)
+    {
+      svn_revnum_t value = i % HOT_KEY_COUNT;
+      svn_revnum_t *answer;
+      svn_boolean_t found;
+      const char *key;
+
+      if (value == 0)
+        svn_pool_clear(iterpool);
+
+      key = hot_key(value, iterpool);
+      if (baton->writer && (i % 16) == 0)
+        SVN_ERR(svn_cache__set(baton->cache, key, &value, iterpool));
+
+      SVN_ERR(svn_cache__get((void **) &answer, &found, baton->cache, key,
+                             iterpool));
+
+      /* Concurrent writes may be dropped if they can't get the lock
+       * but lookups must never return wrong data. */
+      if (found && *answer != value)
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "expected %ld but found %ld",
+                                 value, *answer);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static void *
+APR_THREAD_FUNC reader_thread_func(apr_thread_t *tid, void *data)
+{
+  reader_baton_t *baton = data;
+
+  baton->err = read_hot_keys(baton);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return NULL;
+}
+
+#endif
+
+static svn_error_t *
+test_membuffer_concurrent_reads(const svn_test_opts_t *opts,
+                                apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  int thread_count;
+  int i;
+
+  /* Use a single segment to get maximum contention. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024*1024,
+                                            64*1024, 1, TRUE, FALSE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            TRUE,
+                                            FALSE,
+                                            pool, pool));
+
+  for (i = 0; i < HOT_KEY_COUNT; ++i)
+    {
+      svn_revnum_t value = i;
+      SVN_ERR(svn_cache__set(cache, hot_key(i, pool), &value, pool));
+    }
+
+  /* Measure the lookup rate for an increasing number of threads.
+   * Without lock contention, it should scale with the number of cores.
+   * Run with --verbose to see the numbers. */
+  for (thread_count = 1; thread_count <= 64; thread_count *= 2)
+    {
+      apr_pool_t *iterpool = svn_pool_create(pool);
+      apr_thread_t **threads = apr_pcalloc(iterpool,
+                                           thread_count * sizeof(*threads));
+      reader_baton_t *batons = apr_pcalloc(iterpool,
+                                           thread_count * sizeof(*batons));
+      svn_error_t *err = SVN_NO_ERROR;
+      apr_time_t start = apr_time_now();
+      apr_time_t duration;
+
+      for (i = 0; i < thread_count; ++i)
+        {
+          apr_status_t status;
+
+          batons[i].cache = cache;
+          batons[i].pool = svn_pool_create(NULL);
+          batons[i].writer = thread_count > 1 && i == 0;
+
+          status = apr_thread_create(&threads[i], NULL, reader_thread_func,
+                                     &batons[i], iterpool);
+          if (status)
+            return svn_error_wrap_apr(status, "Can't create thread");
+        }
+
+      for (i = 0; i < thread_count; ++i)
+        {
+          apr_status_t retval;
+          apr_status_t status = apr_thread_join(&retval, threads[i]);
+          if (status)
+            return svn_error_wrap_apr(status, "Can't join thread");
+
+          err = svn_error_compose_create(err, batons[i].err);
+          svn_pool_destroy(batons[i].pool);
+        }
+      SVN_ERR(err);
+
+      duration = apr_time_now() - start;
+      if (opts->verbose)
+        printf("%2d threads: %10.0f lookups/s\n", thread_count,
+               (double)thread_count * LOOKUP_COUNT * APR_USEC_PER_SEC
+                 / (duration ? duration : 1));
+
+      svn_pool_destroy(iterpool);
+    }
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "this test requires thread support");
+#endif
+}
+
+static svn_error_t *
+test_membuffer_shared(apr_pool_t *pool)
+{
+#if APR_HAS_SHARED_MEMORY && APR_HAS_FORK
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_revnum_t twenty = 20, thirty = 30, *answer;
+  svn_boolean_t found = FALSE;
+  apr_proc_t proc;
+  apr_status_t status;
+  int exitcode;
+  svn_error_t *err;
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, 1024*1024,
+                                                 64*1024, 1, TRUE, pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err,
+                            "shared memory not supported");
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            TRUE,
+                                            FALSE,
+                                            pool, pool));
+  SVN_ERR(svn_cache__set(cache, "twenty", &twenty, pool));
+
+  /* The child sees our data and adds its own. */
+  fflush(stdout);
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      err = svn_cache__get((void **) &answer, &found, cache, "twenty", pool);
+      if (!err && found && *answer == 20)
+        err = svn_cache__set(cache, "thirty", &thirty, pool);
+
+      exit(err || !found ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "Can't fork");
+
+  status = apr_proc_wait(&proc, &exitcode, NULL, APR_WAIT);
+  if (status != APR_CHILD_DONE)
+    return svn_error_wrap_apr(status, "Can't wait for child process");
+  if (exitcode != EXIT_SUCCESS)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "child process failed to read from the cache");
+
+  /* The child's data is visible to the parent process. */
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "thirty", pool));
+  if (! found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache failed to find entry added by child");
+  if (*answer != 30)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "expected 30 but found '%ld'", *answer);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "shared memory or fork() not supported");
+#endif
+}
+
+#if APR_HAS_SHARED_MEMORY && APR_HAS_FORK
+/* Implements svn_cache__partial_setter_func_t.
+ * Terminate the process while it holds the cache segment's lock. */
+static svn_error_t *
+exit_partial_setter_func(void **data,
+                         apr_size_t *data_len,
+                         void *baton,
+                         apr_pool_t *result_pool)
+{
+  exit(EXIT_SUCCESS);
+  return SVN_NO_ERROR;
+}
+#endif
+
+static svn_error_t *
+test_membuffer_shared_dead_owner(apr_pool_t *pool)
+{
+#if APR_HAS_SHARED_MEMORY && APR_HAS_FORK
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_revnum_t twenty = 20, thirty = 30, *answer;
+  svn_boolean_t found = FALSE;
+  apr_proc_t proc;
+  apr_status_t status;
+  int exitcode;
+  svn_error_t *err;
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, 1024*1024,
+                                                 64*1024, 1, TRUE, pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err,
+                            "shared memory not supported");
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            TRUE,
+                                            FALSE,
+                                            pool, pool));
+  SVN_ERR(svn_cache__set(cache, "twenty", &twenty, pool));
+
+  /* The child dies in the middle of a modification. */
+  fflush(stdout);
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      svn_error_clear(svn_cache__set_partial(cache, "twenty",
+                                             exit_partial_setter_func,
+                                             NULL, pool));
+      exit(EXIT_FAILURE);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "Can't fork");
+
+  status = apr_proc_wait(&proc, &exitcode, NULL, APR_WAIT);
+  if (status != APR_CHILD_DONE)
+    return svn_error_wrap_apr(status, "Can't wait for child process");
+  if (exitcode != EXIT_SUCCESS)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "child process did not modify the cache");
+
+  /* We must neither block nor see the half-modified entry. */
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "twenty", pool));
+  if (found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache segment has not been cleared");
+
+  /* The cache remains usable. */
+  SVN_ERR(svn_cache__set(cache, "thirty", &thirty, pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "thirty", pool));
+  if (! found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache failed to find new entry");
+  if (*answer != 30)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "expected 30 but found '%ld'", *answer);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "shared memory or fork() not supported");
+#endif
+}
+
+static svn_error_t *
+test_persistent_cache(apr_pool_t *pool)
+{
+  const char *dir = "cache-test-persistent";
+  const char *path = svn_dirent_join(dir, "fsfs.cache", pool);
+  svn_cache__persistent_t *store;
+  svn_cache__t *l1_cache, *cache;
+  svn_revnum_t *answer;
+  svn_stringbuf_t *value, *text;
+  svn_boolean_t found;
+  svn_error_t *err;
+  int i;
+
+  SVN_ERR(svn_io_remove_dir2(dir, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_io_make_dir_recursively(dir, pool));
+  svn_test_add_dir_cleanup(dir);
+
+  err = svn_cache__persistent_open(&store, path, 1024 * 1024, pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, err,
+                            "persistent caches not supported");
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cache__create_inprocess(&l1_cache,
+                                      serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING,
+                                      1,
+                                      1,
+                                      TRUE,
+                                      "",
+                                      pool));
+  SVN_ERR(svn_cache__create_persistent(&cache, l1_cache, store,
+                                       serialize_revnum,
+                                       deserialize_revnum,
+                                       APR_HASH_KEY_STRING,
+                                       "cache:",
+                                       pool));
+
+  /* The L1 cache can only hold one entry but the file keeps both. */
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+  /* A new L1 cache, as after a process restart, gets filled from the
+   * file. */
+  SVN_ERR(svn_cache__create_inprocess(&l1_cache,
+                                      serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING,
+                                      1,
+                                      1,
+                                      TRUE,
+                                      "",
+                                      pool));
+  SVN_ERR(svn_cache__create_persistent(&cache, l1_cache, store,
+                                       serialize_revnum,
+                                       deserialize_revnum,
+                                       APR_HASH_KEY_STRING,
+                                       "cache:",
+                                       pool));
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "twenty", pool));
+  if (! found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache file failed to provide 'twenty'");
+  if (*answer != 20)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "expected 20 but found '%ld'", *answer);
+
+  /* Keys are separated by prefix. */
+  SVN_ERR(svn_cache__create_null(&l1_cache, "null", pool));
+  SVN_ERR(svn_cache__create_persistent(&cache, l1_cache, store,
+                                       NULL, NULL,
+                                       APR_HASH_KEY_STRING,
+                                       "text:",
+                                       pool));
+  SVN_ERR(svn_cache__has_key(&found, cache, "twenty", pool));
+  if (found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache found an entry with a different prefix");
+
+  /* Writing more data than the file can hold, evicts the oldest entries. */
+  text = svn_stringbuf_create_ensure(4096, pool);
+  while (text->len < 4096)
+    svn_stringbuf_appendcstr(text, "0123456789abcdef");
+
+  for (i = 0; i < 1000; ++i)
+    {
+      const char *key = apr_psprintf(pool, "%d", i);
+      text->data[0] = (char)('a' + i % 26);
+      SVN_ERR(svn_cache__set(cache, key, text, pool));
+    }
+
+  SVN_ERR(svn_cache__has_key(&found, cache, "0", pool));
+  if (found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache file failed to evict the oldest entry");
+
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "999", pool));
+  if (! found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache file failed to find the latest entry");
+  SVN_TEST_ASSERT(value->len == text->len);
+  SVN_TEST_ASSERT(memcmp(value->data, text->data, text->len) == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_persistent_cache_shared(apr_pool_t *pool)
+{
+#if APR_HAS_FORK
+  const char *dir = "cache-test-persistent-shared";
+  const char *path = svn_dirent_join(dir, "fsfs.cache", pool);
+  svn_cache__persistent_t *store;
+  svn_cache__t *l1_cache, *cache;
+  svn_revnum_t twenty = 20, *answer;
+  svn_boolean_t found = FALSE;
+  apr_file_t *ready_in, *ready_out, *done_in, *done_out;
+  apr_finfo_t finfo;
+  apr_proc_t proc;
+  apr_status_t status;
+  int exitcode;
+  char c = 0;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(svn_io_remove_dir2(dir, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_io_make_dir_recursively(dir, pool));
+  svn_test_add_dir_cleanup(dir);
+
+  status = apr_file_pipe_create(&ready_in, &ready_out, pool);
+  if (!status)
+    status = apr_file_pipe_create(&done_in, &done_out, pool);
+  if (status)
+    return svn_error_wrap_apr(status, "Can't create pipe");
+
+  /* The child creates a small cache file and keeps it open until we are
+   * done with it. */
+  fflush(stdout);
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      err = svn_cache__persistent_open(&store, path, 1024 * 1024, pool);
+      if (!err)
+        err = svn_cache__create_null(&l1_cache, "null", pool);
+      if (!err)
+        err = svn_cache__create_persistent(&cache, l1_cache, store,
+                                           serialize_revnum,
+                                           deserialize_revnum,
+                                           APR_HASH_KEY_STRING,
+                                           "cache:", pool);
+      if (!err)
+        err = svn_cache__set(cache, "twenty", &twenty, pool);
+
+      if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+        c = 'u';
+      else
+        c = err ? 'e' : 'r';
+
+      apr_file_putc(c, ready_out);
+      apr_file_getc(&c, done_in);
+      exit(c == 'd' ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+  else if (status != APR_INPARENT)
+    return svn_error_wrap_apr(status, "Can't fork");
+
+  /* Don't wait forever if the child dies early. */
+  SVN_ERR(svn_io_file_close(ready_out, pool));
+  apr_file_getc(&c, ready_in);
+  if (c == 'r')
+    {
+      /* Asking for a larger file must not resize the one in use but
+       * attach to it with its original geometry. */
+      err = svn_cache__persistent_open(&store, path, 2 * 1024 * 1024, pool);
+      if (!err)
+        err = svn_cache__create_null(&l1_cache, "null", pool);
+      if (!err)
+        err = svn_cache__create_persistent(&cache, l1_cache, store,
+                                           serialize_revnum,
+                                           deserialize_revnum,
+                                           APR_HASH_KEY_STRING,
+                                           "cache:", pool);
+      if (!err)
+        err = svn_cache__get((void **) &answer, &found, cache, "twenty",
+                             pool);
+      if (!err)
+        err = svn_io_stat(&finfo, path, APR_FINFO_SIZE, pool);
+    }
+
+  apr_file_putc('d', done_out);
+  status = apr_proc_wait(&proc, &exitcode, NULL, APR_WAIT);
+  if (status != APR_CHILD_DONE)
+    return svn_error_compose_create(
+             err, svn_error_wrap_apr(status,
+                                     "Can't wait for child process"));
+  SVN_ERR(err);
+
+  if (c == 'u')
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "persistent caches not supported");
+  if (c != 'r' || exitcode != EXIT_SUCCESS)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "child process failed to use the cache file");
+
+  if (! found)
+    return svn_error_create(SVN_ERR_TEST_FAILED, NULL,
+                            "cache failed to find entry added by child");
+  if (*answer != 20)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "expected 20 but found '%ld'", *answer);
+  if (finfo.size > 1024 * 1024)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "cache file in use has been resized to %s "
+                             "bytes",
+                             apr_off_t_toa(pool, finfo.size));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "fork() not supported");
+#endif
+}
+
 
 /* The test table.  */
 
@@ -616,6 +1167,16 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_OPTS_PASS(test_membuffer_concurrent_reads,
+                       "concurrent membuffer cache lookups"),
+    SVN_TEST_PASS2(test_membuffer_shared,
+                   "membuffer cache shared between processes"),
+    SVN_TEST_PASS2(test_membuffer_shared_dead_owner,
+                   "recover shared membuffer from a dead lock owner"),
+    SVN_TEST_PASS2(test_persistent_cache,
+                   "file-backed second-level svn_cache"),
+    SVN_TEST_PASS2(test_persistent_cache_shared,
+                   "persistent cache file shared between processes"),
     SVN_TEST_NULL
   };
 
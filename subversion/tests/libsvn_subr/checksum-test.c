@@ -27,6 +27,10 @@
 
 #include "svn_error.h"
 #include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_subr_private.h"
 
 #include "../svn_test.h"
 
@@ -68,6 +72,9 @@ test_checksum_parse(apr_pool_t *pool)
   SVN_ERR(checksum_parse_kind("cafeaffe",
                               svn_checksum_fnv1a_32x4,
                               "modified fnv-1a", pool));
+  SVN_ERR(checksum_parse_kind("e3b0c44298fc1c149afbf4c8996fb924"
+                              "27ae41e4649b934ca495991b7852b855",
+                              svn_checksum_sha256, "sha256", pool));
 
   return SVN_NO_ERROR;
 }
@@ -76,7 +83,7 @@ static svn_error_t *
 test_checksum_empty(apr_pool_t *pool)
 {
   svn_checksum_kind_t kind;
-  for (kind = svn_checksum_md5; kind <= svn_checksum_fnv1a_32x4; ++kind)
+  for (kind = svn_checksum_md5; kind <= svn_checksum_sha256; ++kind)
     {
       svn_checksum_t *checksum;
       char data = '\0';
@@ -119,7 +126,7 @@ static svn_error_t *
 zero_match(apr_pool_t *pool)
 {
   svn_checksum_kind_t kind;
-  for (kind = svn_checksum_md5; kind <= svn_checksum_fnv1a_32x4; ++kind)
+  for (kind = svn_checksum_md5; kind <= svn_checksum_sha256; ++kind)
     SVN_ERR(zero_match_kind(kind, pool));
 
   return SVN_NO_ERROR;
@@ -132,7 +139,7 @@ zero_cross_match(apr_pool_t *pool)
   svn_checksum_kind_t k_kind;
 
   for (i_kind = svn_checksum_md5;
-       i_kind <= svn_checksum_fnv1a_32x4;
+       i_kind <= svn_checksum_sha256;
        ++i_kind)
     {
       svn_checksum_t *i_zero;
@@ -143,7 +150,7 @@ zero_cross_match(apr_pool_t *pool)
       SVN_ERR(svn_checksum(&i_A, i_kind, "A", 1, pool));
 
       for (k_kind = svn_checksum_md5;
-           k_kind <= svn_checksum_fnv1a_32x4;
+           k_kind <= svn_checksum_sha256;
            ++k_kind)
         {
           svn_checksum_t *k_zero;
@@ -258,7 +265,7 @@ static svn_error_t *
 test_serialization(apr_pool_t *pool)
 {
   svn_checksum_kind_t kind;
-  for (kind = svn_checksum_md5; kind <= svn_checksum_fnv1a_32x4; ++kind)
+  for (kind = svn_checksum_md5; kind <= svn_checksum_sha256; ++kind)
     {
       const svn_checksum_t *parsed_checksum;
       svn_checksum_t *checksum = svn_checksum_empty_checksum(kind, pool);
@@ -278,7 +285,7 @@ static svn_error_t *
 test_checksum_parse_all_zero(apr_pool_t *pool)
 {
   svn_checksum_kind_t kind;
-  for (kind = svn_checksum_md5; kind <= svn_checksum_fnv1a_32x4; ++kind)
+  for (kind = svn_checksum_md5; kind <= svn_checksum_sha256; ++kind)
     {
       svn_checksum_t *checksum;
       const char *hex;
@@ -302,7 +309,7 @@ test_checksummed_stream_read(apr_pool_t *pool)
   const svn_string_t *str = svn_string_create("abcde", pool);
   svn_checksum_kind_t kind;
 
-  for (kind = svn_checksum_md5; kind <= svn_checksum_fnv1a_32x4; ++kind)
+  for (kind = svn_checksum_md5; kind <= svn_checksum_sha256; ++kind)
     {
       svn_stream_t *stream;
       svn_checksum_t *expected_checksum;
@@ -333,7 +340,7 @@ test_checksummed_stream_reset(apr_pool_t *pool)
   const svn_string_t *str = svn_string_create("abcde", pool);
   svn_checksum_kind_t kind;
 
-  for (kind = svn_checksum_md5; kind <= svn_checksum_fnv1a_32x4; ++kind)
+  for (kind = svn_checksum_md5; kind <= svn_checksum_sha256; ++kind)
     {
       svn_stream_t *stream;
       svn_checksum_t *expected_checksum;
@@ -364,6 +371,184 @@ test_checksummed_stream_reset(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Verify the SHA-256 implementation against the test vectors from
+ * FIPS 180-4, feeding the data in chunks of varying size.
+ */
+static svn_error_t *
+test_sha256(apr_pool_t *pool)
+{
+  static const struct
+  {
+    const char *data;
+    const char *digest;
+  } vectors[] =
+  {
+    { "",
+      "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+    { "abc",
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+    { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+      "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+    { "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+      "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+      "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1" }
+  };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_checksum_ctx_t *ctx;
+  svn_checksum_t *checksum;
+  svn_stringbuf_t *million;
+  int i;
+
+  for (i = 0; i < sizeof(vectors) / sizeof(vectors[0]); ++i)
+    {
+      apr_size_t len = strlen(vectors[i].data);
+      apr_size_t chunk;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_checksum(&checksum, svn_checksum_sha256, vectors[i].data,
+                           len, iterpool));
+      SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring_display(checksum,
+                                                             iterpool),
+                             vectors[i].digest);
+
+      for (chunk = 1; chunk < 70; chunk += 3)
+        {
+          apr_size_t pos;
+
+          ctx = svn_checksum_ctx_create(svn_checksum_sha256, iterpool);
+          for (pos = 0; pos < len; pos += chunk)
+            SVN_ERR(svn_checksum_update(ctx, vectors[i].data + pos,
+                                        MIN(chunk, len - pos)));
+
+          SVN_ERR(svn_checksum_final(&checksum, ctx, iterpool));
+          SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring_display(checksum,
+                                                                 iterpool),
+                                 vectors[i].digest);
+        }
+    }
+
+  /* One million times 'a' spans many blocks. */
+  million = svn_stringbuf_create_ensure(1000000, pool);
+  svn_stringbuf_appendfill(million, 'a', 1000000);
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_sha256, million->data,
+                       million->len, pool));
+  SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring_display(checksum, pool),
+                         "cdc76e5c9914fb9281a1c7e284d73e67"
+                         "f1809a48a497200e046d39ccc7112cd0");
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that a multi-kind checksum context and stream for the COUNT
+ * KINDS produce the same checksums over DATA as individual contexts do.
+ * Feed the data in chunks of pseudo-random sizes based on *SEED.
+ * Use POOL for allocations.
+ */
+static svn_error_t *
+verify_checksum_multi(const svn_checksum_kind_t *kinds,
+                      int count,
+                      const svn_stringbuf_t *data,
+                      apr_uint32_t *seed,
+                      apr_pool_t *pool)
+{
+  svn_checksum_t **stream_checksums
+    = apr_pcalloc(pool, count * sizeof(*stream_checksums));
+  svn_checksum_t ***checksum_ptrs
+    = apr_pcalloc(pool, count * sizeof(*checksum_ptrs));
+  svn_checksum__multi_ctx_t *ctx;
+  svn_stream_t *stream;
+  svn_checksum_t *checksum;
+  apr_size_t pos, chunk;
+  int i;
+
+  ctx = svn_checksum__multi_ctx_create(kinds, count, pool);
+  for (i = 0; i < count; ++i)
+    checksum_ptrs[i] = &stream_checksums[i];
+  stream = svn_checksum__wrap_write_stream_multi(checksum_ptrs, kinds, count,
+                                                 svn_stream_empty(pool),
+                                                 pool);
+
+  for (pos = 0; pos < data->len; pos += chunk)
+    {
+      chunk = MIN(svn_test_rand(seed) % 20000, data->len - pos);
+      SVN_ERR(svn_checksum__multi_update(ctx, data->data + pos, chunk));
+      SVN_ERR(svn_stream_write(stream, data->data + pos, &chunk));
+    }
+  SVN_ERR(svn_stream_close(stream));
+
+  for (i = 0; i < count; ++i)
+    {
+      svn_checksum_t *expected;
+      SVN_ERR(svn_checksum(&expected, kinds[i], data->data, data->len,
+                           pool));
+
+      SVN_ERR(svn_checksum__multi_final(&checksum, ctx, kinds[i], pool));
+      SVN_TEST_ASSERT(svn_checksum_match(expected, checksum));
+      SVN_TEST_ASSERT(svn_checksum_match(expected, stream_checksums[i]));
+
+      /* Finalizing does not change the context. */
+      SVN_ERR(svn_checksum__multi_final(&checksum, ctx, kinds[i], pool));
+      SVN_TEST_ASSERT(svn_checksum_match(expected, checksum));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that a multi-kind checksum context and stream produce the same
+ * checksums as individual contexts do.
+ */
+static svn_error_t *
+test_checksum_multi(apr_pool_t *pool)
+{
+  const svn_checksum_kind_t all_kinds[] = { svn_checksum_md5,
+                                            svn_checksum_sha1,
+                                            svn_checksum_fnv1a_32x4,
+                                            svn_checksum_sha256 };
+  const svn_checksum_kind_t sha1_md5[] = { svn_checksum_sha1,
+                                           svn_checksum_md5 };
+  svn_checksum__multi_ctx_t *ctx;
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  svn_checksum_t *checksum;
+  apr_uint32_t seed = 0;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* MD5 and SHA-1 alone use the interleaved kernel.  Cover all ways in
+   * which the data may end relative to the 64 byte blocks. */
+  for (i = 0; i < 200; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(verify_checksum_multi(all_kinds, 2, data, &seed, iterpool));
+      SVN_ERR(verify_checksum_multi(sha1_md5, 2, data, &seed, iterpool));
+      svn_stringbuf_appendbyte(data, (char)svn_test_rand(&seed));
+    }
+
+  /* Now with large data and with all kinds. */
+  for (i = 0; i < 100000; ++i)
+    svn_stringbuf_appendbyte(data, (char)svn_test_rand(&seed));
+
+  SVN_ERR(verify_checksum_multi(all_kinds, 2, data, &seed, pool));
+  SVN_ERR(verify_checksum_multi(all_kinds, 4, data, &seed, pool));
+
+  /* Kinds not being calculated have no result. */
+  ctx = svn_checksum__multi_ctx_create(all_kinds, 1, pool);
+  SVN_ERR(svn_checksum__multi_final(&checksum, ctx, svn_checksum_sha1,
+                                    pool));
+  SVN_TEST_ASSERT(checksum == NULL);
+
+  ctx = svn_checksum__multi_ctx_create(all_kinds, 2, pool);
+  SVN_ERR(svn_checksum__multi_final(&checksum, ctx, svn_checksum_sha256,
+                                    pool));
+  SVN_TEST_ASSERT(checksum == NULL);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* An array of all test functions */
 
 static int max_threads = 1;
@@ -389,6 +574,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "read from checksummed stream"),
     SVN_TEST_PASS2(test_checksummed_stream_reset,
                    "reset checksummed stream"),
+    SVN_TEST_PASS2(test_sha256,
+                   "SHA-256 test vectors"),
+    SVN_TEST_PASS2(test_checksum_multi,
+                   "multi-kind checksum calculation"),
     SVN_TEST_NULL
   };
 
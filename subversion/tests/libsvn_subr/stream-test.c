@@ -1065,6 +1065,59 @@ test_stream_readline_file_nul(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_stream_lz4_compressed(apr_pool_t *pool)
+{
+  svn_stringbuf_t *bufs[4];
+  apr_pool_t *subpool = svn_pool_create(pool);
+  int i;
+
+  bufs[0] = svn_stringbuf_create_empty(pool);
+  bufs[1] = svn_stringbuf_create("This is a string.", pool);
+  /* Poorly compressible data spanning several blocks. */
+  bufs[2] = generate_test_bytes(200000, pool);
+  /* Well compressible data spanning several blocks. */
+  bufs[3] = svn_stringbuf_create_empty(pool);
+  for (i = 0; i < 30000; i++)
+    svn_stringbuf_appendcstr(bufs[3], "abcdefgh");
+
+  for (i = 0; i < sizeof(bufs) / sizeof(bufs[0]); i++)
+    {
+      svn_stream_t *stream;
+      svn_stringbuf_t *origbuf, *inbuf, *outbuf;
+      apr_size_t len;
+
+      origbuf = bufs[i];
+      outbuf = svn_stringbuf_create_empty(subpool);
+
+      stream = svn_stream__lz4_compressed(
+                 svn_stream_from_stringbuf(outbuf, subpool), subpool);
+      len = origbuf->len;
+      SVN_ERR(svn_stream_write(stream, origbuf->data, &len));
+      SVN_ERR(svn_stream_close(stream));
+
+      stream = svn_stream__lz4_compressed(
+                 svn_stream_from_stringbuf(outbuf, subpool), subpool);
+      SVN_ERR(svn_stringbuf_from_stream(&inbuf, stream, 0, subpool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(inbuf, origbuf));
+
+      /* Truncated data must be detected. */
+      if (outbuf->len > 1)
+        {
+          svn_stringbuf_chop(outbuf, 1);
+          stream = svn_stream__lz4_compressed(
+                     svn_stream_from_stringbuf(outbuf, subpool), subpool);
+          SVN_TEST_ASSERT_ANY_ERROR(svn_stringbuf_from_stream(&inbuf, stream,
+                                                              0, subpool));
+        }
+
+      svn_pool_clear(subpool);
+    }
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -1104,6 +1157,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test reading CRLF-terminated lines from file"),
     SVN_TEST_PASS2(test_stream_readline_file_nul,
                    "test reading line from file with nul bytes"),
+    SVN_TEST_PASS2(test_stream_lz4_compressed,
+                   "test LZ4 compressed streams"),
     SVN_TEST_NULL
   };
 
@@ -0,0 +1,226 @@
+/*
+ * task-test.c:  a collection of svn_task__* tests
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* ====================================================================
+   To add tests, look toward the bottom of this file.
+
+*/
+
+
+
+#include <apr_pools.h>
+
+#include "../svn_test.h"
+
+#include "svn_error.h"
+#include "svn_string.h"
+#include "private/svn_task.h"
+
+
+/* Parameters of a test task, i.e. a node in a tree of given DEPTH and
+ * FAN_OUT.  ID is the position of the node within the tree in pre-order. */
+typedef struct node_t
+{
+  int id;
+  int depth;
+  int fan_out;
+
+  /* Return an error when processing the node with this ID. */
+  int fail_id;
+} node_t;
+
+/* Return the number of nodes in a complete tree of the given DEPTH and
+ * FAN_OUT. */
+static int
+tree_size(int depth,
+          int fan_out)
+{
+  return depth ? 1 + fan_out * tree_size(depth - 1, fan_out) : 1;
+}
+
+/* Implements svn_task__process_func_t.
+ *
+ * Produce some output for the node_t given as PROCESS_BATON and add one
+ * sub-task per child with some partial output in front of each of them.
+ */
+static svn_error_t *
+process_node(void **result,
+             svn_task__t *task,
+             void *thread_context,
+             void *process_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  node_t *node = process_baton;
+  int child_id = node->id + 1;
+  int i;
+
+  if (node->id == node->fail_id)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Node %d failed", node->id);
+
+  for (i = 0; node->depth && i < node->fan_out; ++i)
+    {
+      apr_pool_t *process_pool = svn_task__create_process_pool(task);
+      node_t *child = apr_pmemdup(process_pool, node, sizeof(*node));
+
+      child->id = child_id;
+      child->depth = node->depth - 1;
+      child_id += tree_size(child->depth, child->fan_out);
+
+      SVN_ERR(svn_task__add_similar(task, process_pool,
+                                    apr_psprintf(result_pool, "(%d:%d",
+                                                 node->id, i),
+                                    child));
+    }
+
+  *result = apr_psprintf(result_pool, "[%d]", node->id);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__output_func_t.
+ *
+ * Append the string RESULT to the svn_stringbuf_t in OUTPUT_BATON.
+ */
+static svn_error_t *
+output_node(svn_task__t *task,
+            void *result,
+            void *output_baton,
+            svn_cancel_func_t cancel_func,
+            void *cancel_baton,
+            apr_pool_t *result_pool,
+            apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *output = output_baton;
+  svn_stringbuf_appendcstr(output, result);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_task__thread_context_constructor_t.
+ *
+ * Return some unique, non-NULL context object.
+ */
+static svn_error_t *
+construct_context(void **thread_context,
+                  void *context_baton,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  *thread_context = apr_pcalloc(result_pool, 1);
+  return SVN_NO_ERROR;
+}
+
+/* Run a task tree of DEPTH and FAN_OUT using THREAD_COUNT threads.
+ * Return the output in *OUTPUT and fail at task FAIL_ID.
+ */
+static svn_error_t *
+run_tree(svn_stringbuf_t **output,
+         apr_int32_t thread_count,
+         int depth,
+         int fan_out,
+         int fail_id,
+         apr_pool_t *pool)
+{
+  node_t root = { 0 };
+  root.depth = depth;
+  root.fan_out = fan_out;
+  root.fail_id = fail_id;
+
+  *output = svn_stringbuf_create_empty(pool);
+  return svn_error_trace(svn_task__run(thread_count,
+                                       process_node, &root,
+                                       output_node, *output,
+                                       construct_context, NULL,
+                                       NULL, NULL, pool, pool));
+}
+
+static svn_error_t *
+test_serial_execution(apr_pool_t *pool)
+{
+  svn_stringbuf_t *output;
+
+  SVN_ERR(run_tree(&output, 1, 2, 2, -1, pool));
+  SVN_TEST_STRING_ASSERT(output->data,
+                         "(0:0(1:0[2](1:1[3][1](0:1(4:0[5](4:1[6][4][0]");
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_parallel_execution(apr_pool_t *pool)
+{
+  svn_stringbuf_t *expected, *actual;
+  apr_int32_t thread_count;
+
+  SVN_ERR(run_tree(&expected, 1, 5, 5, -1, pool));
+  for (thread_count = 2; thread_count <= 16; thread_count *= 2)
+    {
+      SVN_ERR(run_tree(&actual, thread_count, 5, 5, -1, pool));
+      SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_error_order(apr_pool_t *pool)
+{
+  apr_int32_t thread_count;
+
+  for (thread_count = 1; thread_count <= 16; thread_count *= 2)
+    {
+      svn_stringbuf_t *output;
+      svn_error_t *err = run_tree(&output, thread_count, 3, 4, 7, pool);
+
+      /* The error must be reported in post-order, i.e. after all the
+       * output produced before the failing task. */
+      SVN_TEST_ASSERT_ERROR(err, SVN_ERR_TEST_FAILED);
+      SVN_TEST_STRING_ASSERT(output->data,
+                             "(0:0(1:0(2:0[3](2:1[4](2:2[5](2:3[6][2]"
+                             "(1:1");
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+/* The test table.  */
+
+static int max_threads = 1;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(test_serial_execution,
+                   "serial task execution"),
+    SVN_TEST_PASS2(test_parallel_execution,
+                   "parallel task execution"),
+    SVN_TEST_PASS2(test_error_order,
+                   "task error ordering"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
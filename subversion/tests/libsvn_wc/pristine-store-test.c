@@ -39,6 +39,7 @@
 #include "svn_repos.h"
 #include "svn_wc.h"
 #include "svn_client.h"
+#include "svn_config.h"
 
 #include "utils.h"
 
@@ -307,6 +308,149 @@ reject_mismatching_text(const svn_test_opts_t *opts,
 }
 
 
+/* Check that pristine texts round-trip through a compressed pristine
+ * store, that they actually get stored compressed and that the store may
+ * hold compressed and plain texts side by side. */
+static svn_error_t *
+compressed_pristine_write_read(const svn_test_opts_t *opts,
+                               apr_pool_t *pool)
+{
+  svn_config_t *config;
+  svn_wc_context_t *wc_ctx;
+  svn_wc_context_t *plain_wc_ctx;
+  const char *wc_abspath;
+  const char *pristine_abspath;
+  int format;
+  int i;
+
+  svn_wc__db_install_data_t *install_data;
+  svn_stream_t *pristine_stream;
+  svn_checksum_t *data_sha1, *data_md5;
+  svn_checksum_t *plain_sha1, *plain_md5;
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *plain_data = svn_stringbuf_create_empty(pool);
+  apr_size_t sz;
+
+  /* Create a new, empty working copy with a compressed pristine store. */
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set_bool(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                      SVN_CONFIG_OPTION_COMPRESS_PRISTINES, TRUE);
+  SVN_ERR(svn_wc_context_create(&wc_ctx, config, pool, pool));
+
+  SVN_ERR(svn_test_make_sandbox_dir(&wc_abspath,
+                                    "compressed_pristine_write_read", pool));
+  SVN_ERR(svn_wc_ensure_adm4(wc_ctx, wc_abspath,
+                             "http://example.com/repos",
+                             "http://example.com/repos",
+                             "00000000-0000-0000-0000-000000000000",
+                             0, svn_depth_infinity, pool));
+
+  SVN_ERR(svn_wc__db_temp_get_format(&format, wc_ctx->db, wc_abspath, pool));
+  SVN_TEST_INT_ASSERT(format, SVN_WC__VERSION);
+
+  /* Well compressible data, spanning several compression blocks. */
+  for (i = 0; i < 20000; i++)
+    svn_stringbuf_appendcstr(data, apr_psprintf(pool, "line %d\n", i % 97));
+
+  SVN_ERR(svn_wc__db_pristine_prepare_install(&pristine_stream,
+                                              &install_data,
+                                              &data_sha1, &data_md5,
+                                              wc_ctx->db, wc_abspath,
+                                              pool, pool));
+  sz = data->len;
+  SVN_ERR(svn_stream_write(pristine_stream, data->data, &sz));
+  SVN_ERR(svn_stream_close(pristine_stream));
+  SVN_ERR(svn_wc__db_pristine_install(install_data, data_sha1, data_md5,
+                                      pool));
+
+  /* The file in the store must be smaller than the text. */
+  {
+    apr_finfo_t finfo;
+
+    SVN_ERR(svn_wc__db_pristine_get_future_path(&pristine_abspath,
+                                                wc_abspath, data_sha1,
+                                                pool, pool));
+    SVN_ERR(svn_io_stat(&finfo, pristine_abspath, APR_FINFO_SIZE, pool));
+    SVN_TEST_ASSERT(finfo.size < data->len);
+  }
+
+  /* Reading reports the original size and content. */
+  {
+    svn_stream_t *data_read_back;
+    svn_filesize_t size;
+    svn_boolean_t same;
+
+    SVN_ERR(svn_wc__db_pristine_read(&data_read_back, &size, wc_ctx->db,
+                                     wc_abspath, data_sha1, pool, pool));
+    SVN_TEST_ASSERT(size == data->len);
+    SVN_ERR(svn_stream_contents_same2(
+              &same, data_read_back,
+              svn_stream_from_stringbuf(data, pool), pool));
+    SVN_TEST_ASSERT(same);
+  }
+
+  /* Files handed out for direct access are plain text. */
+  {
+    svn_stringbuf_t *contents;
+
+    SVN_ERR(svn_wc__db_pristine_get_path(&pristine_abspath, wc_ctx->db,
+                                         wc_abspath, data_sha1, pool, pool));
+    SVN_ERR(svn_stringbuf_from_file2(&contents, pristine_abspath, pool));
+    SVN_TEST_ASSERT(svn_stringbuf_compare(contents, data));
+  }
+
+  /* A client without the option stores new texts verbatim in the same
+     working copy and still reads the compressed one. */
+  SVN_ERR(svn_wc_context_create(&plain_wc_ctx, NULL, pool, pool));
+
+  for (i = 0; i < 20000; i++)
+    svn_stringbuf_appendcstr(plain_data,
+                             apr_psprintf(pool, "row %d\n", i % 89));
+
+  SVN_ERR(svn_wc__db_pristine_prepare_install(&pristine_stream,
+                                              &install_data,
+                                              &plain_sha1, &plain_md5,
+                                              plain_wc_ctx->db, wc_abspath,
+                                              pool, pool));
+  sz = plain_data->len;
+  SVN_ERR(svn_stream_write(pristine_stream, plain_data->data, &sz));
+  SVN_ERR(svn_stream_close(pristine_stream));
+  SVN_ERR(svn_wc__db_pristine_install(install_data, plain_sha1, plain_md5,
+                                      pool));
+
+  {
+    apr_finfo_t finfo;
+
+    SVN_ERR(svn_wc__db_pristine_get_future_path(&pristine_abspath,
+                                                wc_abspath, plain_sha1,
+                                                pool, pool));
+    SVN_ERR(svn_io_stat(&finfo, pristine_abspath, APR_FINFO_SIZE, pool));
+    SVN_TEST_ASSERT(finfo.size == plain_data->len);
+  }
+
+  /* Both texts read back correctly through either context. */
+  for (i = 0; i < 4; i++)
+    {
+      svn_wc__db_t *db = (i & 1) ? plain_wc_ctx->db : wc_ctx->db;
+      svn_checksum_t *sha1 = (i & 2) ? plain_sha1 : data_sha1;
+      svn_stringbuf_t *expected = (i & 2) ? plain_data : data;
+      svn_stream_t *data_read_back;
+      svn_filesize_t size;
+      svn_boolean_t same;
+
+      SVN_ERR(svn_wc__db_pristine_read(&data_read_back, &size, db,
+                                       wc_abspath, sha1, pool, pool));
+      SVN_TEST_ASSERT(size == expected->len);
+      SVN_ERR(svn_stream_contents_same2(
+                &same, data_read_back,
+                svn_stream_from_stringbuf(expected, pool), pool));
+      SVN_TEST_ASSERT(same);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
 static int max_threads = -1;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -318,6 +462,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pristine_delete_while_open"),
     SVN_TEST_OPTS_PASS(reject_mismatching_text,
                        "reject_mismatching_text"),
+    SVN_TEST_OPTS_PASS(compressed_pristine_write_read,
+                       "compressed_pristine_write_read"),
     SVN_TEST_NULL
   };
 